@@ -5,11 +5,18 @@
 #include "stdafx.h"
 #include "APIExample.h"
 #include "APIExampleDlg.h"
+#include <Psapi.h>
+#pragma comment(lib, "psapi.lib")
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
 #endif
 
+#define TIMER_ID_PREWARM_SCENE      1
+#define TIMER_ID_RELEASE_IDLE_SCENE 2
+//hidden scenes are destroyed after this long without use.
+#define SCENE_IDLE_TIMEOUT          (5 * 60 * 1000)
+
 
 // CAboutDlg dialog used for App About
 
@@ -88,6 +95,7 @@ BEGIN_MESSAGE_MAP(CAPIExampleDlg, CDialogEx)
     ON_BN_CLICKED(IDC_BUTTON_DOCUMENT_WEBSITE, &CAPIExampleDlg::OnBnClickedButtonDocumentWebsite)
 	ON_WM_DESTROY()
 	ON_WM_CLOSE()
+	ON_WM_TIMER()
 END_MESSAGE_MAP()
 
 
@@ -95,6 +103,8 @@ END_MESSAGE_MAP()
 
 BOOL CAPIExampleDlg::OnInitDialog()
 {
+	LARGE_INTEGER initStart;
+	QueryPerformanceCounter(&initStart);
 	CDialogEx::OnInitDialog();
 
 	// Add "About..." menu item to system menu.
@@ -132,6 +142,13 @@ BOOL CAPIExampleDlg::OnInitDialog()
     InitCtrlText();
     InitSceneDialog();
     InitSceneList();
+    //"/eagerscenes" creates every scene up front as startup did before.
+    if (_tcsstr(AfxGetApp()->m_lpCmdLine, _T("/eagerscenes")))
+        m_sceneRegistry.PrewarmAll();
+    LogStartupCost(initStart.QuadPart);
+    //create the last used scene once the main window is up.
+    SetTimer(TIMER_ID_PREWARM_SCENE, 500, NULL);
+    SetTimer(TIMER_ID_RELEASE_IDLE_SCENE, 30 * 1000, NULL);
     
 	return TRUE;  // return TRUE  unless you set the focus to a control
 }
@@ -185,6 +202,40 @@ HCURSOR CAPIExampleDlg::OnQueryDragIcon()
 	return static_cast<HCURSOR>(m_hIcon);
 }
 
+//startup time and memory at the end of OnInitDialog, shown below the scene
+//lists and written to the debugger output. run once with and once without
+//"/eagerscenes" to see what creating the scenes on first use saves.
+void CAPIExampleDlg::LogStartupCost(LONGLONG initStart)
+{
+    LARGE_INTEGER now, frequency;
+    QueryPerformanceCounter(&now);
+    QueryPerformanceFrequency(&frequency);
+    double initMs = (now.QuadPart - initStart) * 1000.0 / frequency.QuadPart;
+
+    //from process creation, this includes loading the SDK and the language file.
+    FILETIME creation, exit, kernel, user, current;
+    double processMs = 0;
+    if (GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+        GetSystemTimeAsFileTime(&current);
+        ULARGE_INTEGER begin, end;
+        begin.LowPart = creation.dwLowDateTime;
+        begin.HighPart = creation.dwHighDateTime;
+        end.LowPart = current.dwLowDateTime;
+        end.HighPart = current.dwHighDateTime;
+        processMs = (end.QuadPart - begin.QuadPart) / 10000.0;
+    }
+
+    PROCESS_MEMORY_COUNTERS_EX counters = { sizeof(counters) };
+    GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&counters, sizeof(counters));
+
+    CString strInfo;
+    strInfo.Format(_T("startup %.0f ms (OnInitDialog %.1f ms), working set %u KB, private %u KB, %d scenes created"),
+        processMs, initMs, (UINT)(counters.WorkingSetSize / 1024), (UINT)(counters.PrivateUsage / 1024),
+        m_sceneRegistry.GetCreatedCount());
+    m_stalstInfo.SetWindowText(strInfo);
+    OutputDebugString(strInfo + _T("\n"));
+}
+
 void CAPIExampleDlg::InitCtrlText()
 {
     m_staAdvancedScene.SetWindowText(commonAdvanceScene);
@@ -201,16 +252,18 @@ void CAPIExampleDlg::InitSceneDialog()
     //basic list
     m_vecBasic.push_back(basicLiveBroadcasting);
 
-   m_pLiveBroadcasting = new CLiveBroadcastingDlg(&m_staMainArea);
+   //scenes are created on first use, measure the scene size from the
+   //dialog template alone so no scene object is constructed here.
    RECT rcArea, rcWnd;
    m_staMainArea.GetWindowRect(&rcArea);
-   
-   m_pLiveBroadcasting->Create(CLiveBroadcastingDlg::IDD);
-   m_pLiveBroadcasting->GetWindowRect(&rcWnd);
+   CDialogEx dlgTemplate;
+   dlgTemplate.Create(CLiveBroadcastingDlg::IDD, &m_staMainArea);
+   dlgTemplate.GetWindowRect(&rcWnd);
+   dlgTemplate.DestroyWindow();
    int w = rcWnd.right - rcWnd.left;
    int h = rcWnd.bottom - rcWnd.top;
    rcWnd = { rcArea.left, rcArea.top - MAIN_AREA_TOP, rcArea.left + w, rcArea.top + h};
-   m_pLiveBroadcasting->MoveWindow(&rcWnd);
+   m_sceneRegistry.SetContainer(&m_staMainArea, rcWnd);
 
    //advanced list
    m_vecAdvanced.push_back(advancedRtmpStreaming);
@@ -238,127 +291,33 @@ void CAPIExampleDlg::InitSceneDialog()
    m_vecAdvanced.push_back(advancedCrossChannel);
    m_vecAdvanced.push_back(advancedMultiVideoSource);
    m_vecAdvanced.push_back(SpatialAudio);
-   //rtmp
-   m_pRtmpStreamingDlg = new CAgoraRtmpStreamingDlg(&m_staMainArea);
-   m_pRtmpStreamingDlg->Create(CAgoraRtmpStreamingDlg::IDD);
-   m_pRtmpStreamingDlg->MoveWindow(&rcWnd);
-
-   //video sei
-   m_pVideoSEIDlg = new CAgoraMetaDataDlg(&m_staMainArea);
-   m_pVideoSEIDlg->Create(CAgoraMetaDataDlg::IDD);
-   m_pVideoSEIDlg->MoveWindow(&rcWnd);
-
-   //screen share
-   m_pScreenCap = new CAgoraScreenCapture(&m_staMainArea);
-   m_pScreenCap->Create(CAgoraScreenCapture::IDD);
-   m_pScreenCap->MoveWindow(&rcWnd);
-
-   //beauty
-   m_pBeautyDlg = new CAgoraBeautyDlg(&m_staMainArea);
-   m_pBeautyDlg->Create(CAgoraBeautyDlg::IDD);
-   m_pBeautyDlg->MoveWindow(&rcWnd);
-
-   //beauty audio
-   m_pBeautyAudio = new CAgoraBeautyAudio(&m_staMainArea);
-   m_pBeautyAudio->Create(CAgoraBeautyAudio::IDD);
-   m_pBeautyAudio->MoveWindow(&rcWnd);
-   
-   //video profile
-   m_pVideoProfileDlg = new CAgoraVideoProfileDlg(&m_staMainArea);
-   m_pVideoProfileDlg->Create(CAgoraVideoProfileDlg::IDD);
-   m_pVideoProfileDlg->MoveWindow(&rcWnd);
-
-
-   //audio profile
-   m_pAudioProfileDlg = new CAgoraAudioProfile(&m_staMainArea);
-   m_pAudioProfileDlg->Create(CAgoraAudioProfile::IDD);
-   m_pAudioProfileDlg->MoveWindow(&rcWnd);
-
-   //audio mixing
-   m_pAudioMixingDlg = new CAgoraAudioMixingDlg(&m_staMainArea);
-   m_pAudioMixingDlg->Create(CAgoraAudioMixingDlg::IDD);
-   m_pAudioMixingDlg->MoveWindow(&rcWnd);
-
-   //audio effect
-   m_pAudioEffectDlg = new CAgoraEffectDlg(&m_staMainArea);
-   m_pAudioEffectDlg->Create(CAgoraEffectDlg::IDD);
-   m_pAudioEffectDlg->MoveWindow(&rcWnd);
-
-   //custom video capture
-   m_pCaputreVideoDlg = new CAgoraCaptureVideoDlg(&m_staMainArea);
-   m_pCaputreVideoDlg->Create(CAgoraCaptureVideoDlg::IDD);
-   m_pCaputreVideoDlg->MoveWindow(&rcWnd);
-
-   //media io video capture
-   m_pMediaIOVideoDlg = new CAgoraMediaIOVideoCaptureDlg(&m_staMainArea);
-   m_pMediaIOVideoDlg->Create(CAgoraMediaIOVideoCaptureDlg::IDD);
-   m_pMediaIOVideoDlg->MoveWindow(&rcWnd);
-   
-   //original video process
-   m_pOriginalVideoDlg = new CAgoraOriginalVideoDlg(&m_staMainArea);
-   m_pOriginalVideoDlg->Create(CAgoraOriginalVideoDlg::IDD);
-   m_pOriginalVideoDlg->MoveWindow(&rcWnd);
-
-
-   //custom audio capture
-   m_pCaptureAudioDlg = new CAgoraCaptureAduioDlg(&m_staMainArea);
-   m_pCaptureAudioDlg->Create(CAgoraCaptureAduioDlg::IDD);
-   m_pCaptureAudioDlg->MoveWindow(&rcWnd);
-
-   //original video process
-   m_pOriginalAudioDlg = new CAgoraOriginalAudioDlg(&m_staMainArea);
-   m_pOriginalAudioDlg->Create(CAgoraOriginalAudioDlg::IDD);
-   m_pOriginalAudioDlg->MoveWindow(&rcWnd);
-
-   //media encrypt
-   m_pMediaEncryptDlg = new CAgoraMediaEncryptDlg(&m_staMainArea);
-   m_pMediaEncryptDlg->Create(CAgoraMediaEncryptDlg::IDD);
-   m_pMediaEncryptDlg->MoveWindow(&rcWnd);
-
-   //custom encrypt
-   m_pCustomEncryptDlg = new CAgoraCustomEncryptDlg(&m_staMainArea);
-   m_pCustomEncryptDlg->Create(CAgoraCustomEncryptDlg::IDD);
-   m_pCustomEncryptDlg->MoveWindow(&rcWnd);
-
-
-
-   //multi channel
-   m_pMultiChannelDlg = new CAgoraMultiChannelDlg(&m_staMainArea);
-   m_pMultiChannelDlg->Create(CAgoraMultiChannelDlg::IDD);
-   m_pMultiChannelDlg->MoveWindow(&rcWnd);
-
-   //per call test
-   m_pPerCallTestDlg = new CAgoraPreCallTestDlg(&m_staMainArea);
-   m_pPerCallTestDlg->Create(CAgoraPreCallTestDlg::IDD);
-   m_pPerCallTestDlg->MoveWindow(&rcWnd);
-
-   //audio volume
-   m_pAudioVolumeDlg = new CAgoraAudioVolumeDlg(&m_staMainArea);
-   m_pAudioVolumeDlg->Create(CAgoraAudioVolumeDlg::IDD);
-   m_pAudioVolumeDlg->MoveWindow(&rcWnd);
-
-   //report in call
-   m_pReportInCallDlg = new CAgoraReportInCallDlg(&m_staMainArea);
-   m_pReportInCallDlg->Create(CAgoraReportInCallDlg::IDD);
-   m_pReportInCallDlg->MoveWindow(&rcWnd);
-
-   //Region Conn
-   m_pRegionConnDlg = new CAgoraRegionConnDlg(&m_staMainArea);
-   m_pRegionConnDlg->Create(CAgoraRegionConnDlg::IDD);
-   m_pRegionConnDlg->MoveWindow(&rcWnd);
-
-   //cross channel
-   m_pCrossChannelDlg = new CAgoraCrossChannelDlg(&m_staMainArea);
-   m_pCrossChannelDlg->Create(CAgoraCrossChannelDlg::IDD);
-   m_pCrossChannelDlg->MoveWindow(&rcWnd);
-
-   //multi video source
-   m_pMultiVideoSourceDlg = new CAgoraMutilVideoSourceDlg(&m_staMainArea);
-   m_pMultiVideoSourceDlg->Create(CAgoraMutilVideoSourceDlg::IDD);
-   m_pMultiVideoSourceDlg->MoveWindow(&rcWnd);
-
-
 
+   m_sceneRegistry.Register<CLiveBroadcastingDlg>(basicLiveBroadcasting);
+   m_sceneRegistry.Register<CAgoraRtmpStreamingDlg>(advancedRtmpStreaming);
+   m_sceneRegistry.Register<CAgoraMetaDataDlg>(advancedVideoMetadata);
+   m_sceneRegistry.Register<CAgoraScreenCapture>(advancedScreenCap);
+   m_sceneRegistry.Register<CAgoraBeautyDlg>(advancedBeauty);
+   m_sceneRegistry.Register<CAgoraBeautyAudio>(advancedBeautyAudio);
+   m_sceneRegistry.Register<CAgoraVideoProfileDlg>(advancedVideoProfile);
+   m_sceneRegistry.Register<CAgoraAudioProfile>(advancedAudioProfile);
+   m_sceneRegistry.Register<CAgoraAudioMixingDlg>(advancedAudioMixing);
+   m_sceneRegistry.Register<CAgoraEffectDlg>(advancedAudioEffect);
+   m_sceneRegistry.Register<CAgoraCaptureVideoDlg>(advancedCustomVideoCapture);
+   m_sceneRegistry.Register<CAgoraMediaIOVideoCaptureDlg>(advancedMediaIOCustomVideoCapture);
+   m_sceneRegistry.Register<CAgoraOriginalVideoDlg>(advancedOriginalVideo);
+   m_sceneRegistry.Register<CAgoraCaptureAduioDlg>(advancedCustomAudioCapture);
+   m_sceneRegistry.Register<CAgoraOriginalAudioDlg>(advancedOriginalAudio);
+   m_sceneRegistry.Register<CAgoraMediaEncryptDlg>(advancedMediaEncrypt);
+   m_sceneRegistry.Register<CAgoraCustomEncryptDlg>(advancedCustomEncrypt);
+   m_sceneRegistry.Register<CAgoraMultiChannelDlg>(advancedMultiChannel);
+   m_sceneRegistry.Register<CAgoraPreCallTestDlg>(advancedPerCallTest);
+   m_sceneRegistry.Register<CAgoraAudioVolumeDlg>(advancedAudioVolume);
+   m_sceneRegistry.Register<CAgoraReportInCallDlg>(advancedReportInCall);
+   //region conn initializes the engine itself when the area is chosen.
+   m_sceneRegistry.Register<CAgoraRegionConnDlg>(advancedRegionConn, false);
+   m_sceneRegistry.Register<CAgoraCrossChannelDlg>(advancedCrossChannel);
+   m_sceneRegistry.Register<CAgoraMutilVideoSourceDlg>(advancedMultiVideoSource);
+   m_sceneRegistry.Register<CAgoraSpatialAudioDlg>(SpatialAudio);
 }
 
 void CAPIExampleDlg::InitSceneList()
@@ -484,159 +443,13 @@ void CAPIExampleDlg::OnSelchangingListAdvanced(NMHDR *pNMHDR, LRESULT *pResult)
 //
 void CAPIExampleDlg::CreateScene(CTreeCtrl& treeScene, CString selectedText)
 {
-    if (selectedText.Compare(basicLiveBroadcasting) == 0) {
-        m_pLiveBroadcasting->InitAgora();
-        m_pLiveBroadcasting->ShowWindow(SW_SHOW);
-    }else if (selectedText.Compare(advancedRtmpStreaming) == 0) {
-        m_pRtmpStreamingDlg->InitAgora();
-        m_pRtmpStreamingDlg->ShowWindow(SW_SHOW);
-    }else if (selectedText.Compare(advancedVideoMetadata) == 0) {
-        m_pVideoSEIDlg->InitAgora();
-        m_pVideoSEIDlg->ShowWindow(SW_SHOW);
-    }else if (selectedText.Compare(advancedScreenCap) == 0) {
-        m_pScreenCap->InitAgora();
-        m_pScreenCap->ShowWindow(SW_SHOW);
-    }else if (selectedText.Compare(advancedCustomVideoCapture)==0) {
-        m_pCaputreVideoDlg->InitAgora();
-        m_pCaputreVideoDlg->ShowWindow(SW_SHOW);
-    }else if (selectedText.Compare(advancedCustomAudioCapture)==0) {
-        m_pCaptureAudioDlg->InitAgora();
-        m_pCaptureAudioDlg->ShowWindow(SW_SHOW);
-	}else if (selectedText.Compare(advancedBeauty) == 0) {
-		m_pBeautyDlg->InitAgora();
-		m_pBeautyDlg->ShowWindow(SW_SHOW);
-	}else if (selectedText.Compare(advancedAudioProfile) == 0) {
-		m_pAudioProfileDlg->InitAgora();
-		m_pAudioProfileDlg->ShowWindow(SW_SHOW);
-	}else if (selectedText.Compare(advancedBeautyAudio) == 0) {
-		m_pBeautyAudio->InitAgora();
-		m_pBeautyAudio->ShowWindow(SW_SHOW);
-	}else if (selectedText.Compare(advancedAudioMixing) == 0) {
-		m_pAudioMixingDlg->InitAgora();
-		m_pAudioMixingDlg->ShowWindow(SW_SHOW);
-	}else if (selectedText.Compare(advancedOriginalVideo) == 0) {
-		m_pOriginalVideoDlg->InitAgora();
-		m_pOriginalVideoDlg->ShowWindow(SW_SHOW);
-	}else if (selectedText.Compare(advancedOriginalAudio) == 0) {
-		m_pOriginalAudioDlg->InitAgora();
-		m_pOriginalAudioDlg->ShowWindow(SW_SHOW);
-	}else if (selectedText.Compare(advancedCustomEncrypt) == 0) {
-		m_pCustomEncryptDlg->InitAgora();
-		m_pCustomEncryptDlg->ShowWindow(SW_SHOW);
-	}else if (selectedText.Compare(advancedVideoProfile) == 0){
-		m_pVideoProfileDlg->InitAgora();
-		m_pVideoProfileDlg->ShowWindow(SW_SHOW);
-	}else if (selectedText.Compare(advancedMediaEncrypt) == 0) {
-		m_pMediaEncryptDlg->InitAgora();
-		m_pMediaEncryptDlg->ShowWindow(SW_SHOW);
-	}else if (selectedText.Compare(advancedMediaIOCustomVideoCapture) == 0) {
-		m_pMediaIOVideoDlg->InitAgora();
-		m_pMediaIOVideoDlg->ShowWindow(SW_SHOW);
-	}else if (selectedText.Compare(advancedAudioEffect) == 0) {
-		m_pAudioEffectDlg->InitAgora();
-		m_pAudioEffectDlg->ShowWindow(SW_SHOW);
-	}else if (selectedText.Compare(advancedMultiChannel) == 0) {
-		m_pMultiChannelDlg->InitAgora();
-		m_pMultiChannelDlg->ShowWindow(SW_SHOW);
-	}else if (selectedText.Compare(advancedPerCallTest) == 0) {
-		m_pPerCallTestDlg->InitAgora();
-		m_pPerCallTestDlg->ShowWindow(SW_SHOW);
-	}else if (selectedText.Compare(advancedAudioVolume) == 0) {
-		m_pAudioVolumeDlg->InitAgora();
-		m_pAudioVolumeDlg->ShowWindow(SW_SHOW);
-	}else if (selectedText.Compare(advancedReportInCall) == 0) {
-		m_pReportInCallDlg->InitAgora();
-		m_pReportInCallDlg->ShowWindow(SW_SHOW);
-	}else if (selectedText.Compare(advancedRegionConn) == 0) {
-		m_pRegionConnDlg->ShowWindow(SW_SHOW);
-	}else if (selectedText.Compare(advancedCrossChannel) == 0) {
-		m_pCrossChannelDlg->InitAgora();
-		m_pCrossChannelDlg->ShowWindow(SW_SHOW);
-	}
-	else if (selectedText.Compare(advancedMultiVideoSource) == 0) {
-		m_pMultiVideoSourceDlg->InitAgora();
-		m_pMultiVideoSourceDlg->ShowWindow(SW_SHOW);
-	}
+    m_sceneRegistry.ShowScene(selectedText);
 }
 
 void CAPIExampleDlg::ReleaseScene(CTreeCtrl& treeScene, HTREEITEM& hSelectItem)
 {
     CString str = treeScene.GetItemText(hSelectItem);
-    if (str.Compare(basicLiveBroadcasting) == 0
-        && m_pLiveBroadcasting->IsWindowVisible()) {//pre sel release first
-        m_pLiveBroadcasting->UnInitAgora();
-        m_pLiveBroadcasting->ShowWindow(SW_HIDE);
-    }else if (str.Compare(advancedRtmpStreaming) == 0) {
-        m_pRtmpStreamingDlg->UnInitAgora();
-        m_pRtmpStreamingDlg->ShowWindow(SW_HIDE);
-    }else if (str.Compare(advancedVideoMetadata) == 0) {
-        m_pVideoSEIDlg->UnInitAgora();
-        m_pVideoSEIDlg->ShowWindow(SW_HIDE);
-    }else if (str.Compare(advancedScreenCap) == 0){
-        m_pScreenCap->UnInitAgora();
-        m_pScreenCap->ShowWindow(SW_HIDE);
-    }else if (str.Compare(advancedCustomVideoCapture) == 0) {
-        m_pCaputreVideoDlg->UnInitAgora();
-        m_pCaputreVideoDlg->ShowWindow(SW_HIDE);
-    }else if (str.Compare(advancedCustomAudioCapture) == 0) {
-        m_pCaptureAudioDlg->UnInitAgora();
-        m_pCaptureAudioDlg->ShowWindow(SW_HIDE);
-	}else if (str.Compare(advancedBeauty) == 0) {
-		m_pBeautyDlg->UnInitAgora();
-		m_pBeautyDlg->ShowWindow(SW_HIDE);
-	}else if (str.Compare(advancedAudioProfile) == 0) {
-		m_pAudioProfileDlg->UnInitAgora();
-		m_pAudioProfileDlg->ShowWindow(SW_HIDE);
-	}else if (str.Compare(advancedBeautyAudio) == 0) {
-		m_pBeautyAudio->UnInitAgora();
-		m_pBeautyAudio->ShowWindow(SW_HIDE);
-	}else if (str.Compare(advancedAudioMixing) == 0) {
-		m_pAudioMixingDlg->UnInitAgora();
-		m_pAudioMixingDlg->ShowWindow(SW_HIDE);
-	}else if (str.Compare(advancedOriginalVideo) == 0) {
-		m_pOriginalVideoDlg->UnInitAgora();
-		m_pOriginalVideoDlg->ShowWindow(SW_HIDE);
-	}else if (str.Compare(advancedOriginalAudio) == 0) {
-		m_pOriginalAudioDlg->UnInitAgora();
-		m_pOriginalAudioDlg->ShowWindow(SW_HIDE);
-	}else if (str.Compare(advancedCustomEncrypt) == 0) {
-		m_pCustomEncryptDlg->UnInitAgora();
-		m_pCustomEncryptDlg->ShowWindow(SW_HIDE);
-	}else if (str.Compare(advancedVideoProfile) == 0) {
-		m_pVideoProfileDlg->UnInitAgora();
-		m_pVideoProfileDlg->ShowWindow(SW_HIDE);
-	}else if (str.Compare(advancedMediaEncrypt) == 0) {
-		m_pMediaEncryptDlg->UnInitAgora();
-		m_pMediaEncryptDlg->ShowWindow(SW_HIDE);
-	}else if (str.Compare(advancedMediaIOCustomVideoCapture) == 0) {
-		m_pMediaIOVideoDlg->UnInitAgora();
-		m_pMediaIOVideoDlg->ShowWindow(SW_HIDE);
-	}else if (str.Compare(advancedAudioEffect) == 0) {
-		m_pAudioEffectDlg->UnInitAgora();
-		m_pAudioEffectDlg->ShowWindow(SW_HIDE);
-	}else if (str.Compare(advancedMultiChannel) == 0) {
-		m_pMultiChannelDlg->UnInitAgora();
-		m_pMultiChannelDlg->ShowWindow(SW_HIDE);
-	}else if (str.Compare(advancedPerCallTest) == 0) {
-		m_pPerCallTestDlg->UnInitAgora();
-		m_pPerCallTestDlg->ShowWindow(SW_HIDE);
-	}else if (str.Compare(advancedAudioVolume) == 0) {
-		m_pAudioVolumeDlg->UnInitAgora();
-		m_pAudioVolumeDlg->ShowWindow(SW_HIDE);
-	}else if (str.Compare(advancedReportInCall) == 0) {
-		m_pReportInCallDlg->UnInitAgora();
-		m_pReportInCallDlg->ShowWindow(SW_HIDE);
-	}else if (str.Compare(advancedRegionConn) == 0) {
-		m_pRegionConnDlg->UnInitAgora();
-		m_pRegionConnDlg->ShowWindow(SW_HIDE);
-	}else if (str.Compare(advancedCrossChannel) == 0) {
-		m_pCrossChannelDlg->UnInitAgora();
-		m_pCrossChannelDlg->ShowWindow(SW_HIDE);
-	}
-	else if (str.Compare(advancedMultiVideoSource) == 0) {
-		m_pMultiVideoSourceDlg->UnInitAgora();
-		m_pMultiVideoSourceDlg->ShowWindow(SW_HIDE);
-	}
+    m_sceneRegistry.HideScene(str);
 }
 
 LRESULT CAPIExampleDlg::OnEIDJoinLeaveChannel(WPARAM wParam, LPARAM lParam)
@@ -670,9 +483,12 @@ BOOL CAPIExampleDlg::PreTranslateMessage(MSG* pMsg)
 
 void CAPIExampleDlg::OnDestroy()
 {
+	KillTimer(TIMER_ID_PREWARM_SCENE);
+	KillTimer(TIMER_ID_RELEASE_IDLE_SCENE);
+	AfxGetApp()->WriteProfileString(_T("Scene"), _T("MostRecent"), m_sceneRegistry.GetMostRecentScene());
+	m_sceneRegistry.DestroyAll();
+	CAgoraEngineHost::GetInstance()->Shutdown();
 	CDialogEx::OnDestroy();
-
-	
 }
 
 
@@ -692,3 +508,22 @@ void CAPIExampleDlg::OnClose()
 		ReleaseScene(m_lstBasicScene, hItem);
 	}
 }
+
+
+void CAPIExampleDlg::OnTimer(UINT_PTR nIDEvent)
+{
+	if (nIDEvent == TIMER_ID_PREWARM_SCENE) {
+		KillTimer(TIMER_ID_PREWARM_SCENE);
+		CString strScene = AfxGetApp()->GetProfileString(_T("Scene"), _T("MostRecent"));
+		if (!strScene.IsEmpty())
+			m_sceneRegistry.PrewarmScene(strScene);
+	}
+	else if (nIDEvent == TIMER_ID_RELEASE_IDLE_SCENE) {
+		m_sceneRegistry.ReleaseIdleScenes(SCENE_IDLE_TIMEOUT);
+		//pick up edits of the language file, scenes created from now on
+		//use the new strings.
+		if (CConfig::GetInstance()->ReloadIfChanged())
+			InitKeyInfomation();
+	}
+	CDialogEx::OnTimer(nIDEvent);
+}
@@ -28,6 +28,8 @@
 #include "Advanced/RegionConn/CAgoraRegionConnDlg.h"
 #include "Advanced/CrossChannel/CAgoraCrossChannelDlg.h"
 #include "Advanced/MultiVideoSource/CAgoraMutilVideoSourceDlg.h"
+#include "Advanced/SpatialAudio/CAgoraSpatialAudioDlg.h"
+#include "CSceneRegistry.h"
 #include <vector>
 #include <map>
 const int MAIN_AREA_BOTTOM = 15;
@@ -68,34 +70,12 @@ private:
     void InitSceneDialog();
     void InitSceneList();
     void InitCtrlText();
+    void LogStartupCost(LONGLONG initStart);
     HTREEITEM GetHitItem(NMHDR *pNMHDR);
     
     void ReleaseScene(CTreeCtrl& treeScene, HTREEITEM& hSelectItem);
     void CreateScene(CTreeCtrl& treeScene, CString selectedText);
-    CLiveBroadcastingDlg        *m_pLiveBroadcasting = nullptr;
-    CAgoraRtmpStreamingDlg      *m_pRtmpStreamingDlg = nullptr;
-    CAgoraMetaDataDlg           *m_pVideoSEIDlg      = nullptr;
-    CAgoraScreenCapture         *m_pScreenCap        = nullptr;
-    CAgoraCaptureVideoDlg       *m_pCaputreVideoDlg  = nullptr;
-	CAgoraMediaIOVideoCaptureDlg*m_pMediaIOVideoDlg = nullptr;
-    CAgoraCaptureAduioDlg       *m_pCaptureAudioDlg  = nullptr;
-	CAgoraBeautyDlg				*m_pBeautyDlg		 = nullptr;
-	CAgoraAudioProfile			*m_pAudioProfileDlg  = nullptr;
-	CAgoraBeautyAudio			*m_pBeautyAudio		 = nullptr;
-	CAgoraAudioMixingDlg		*m_pAudioMixingDlg   = nullptr;
-	CAgoraOriginalVideoDlg		*m_pOriginalVideoDlg = nullptr;
-	CAgoraOriginalAudioDlg		*m_pOriginalAudioDlg = nullptr;
-	CAgoraCustomEncryptDlg		*m_pCustomEncryptDlg = nullptr;
-	CAgoraVideoProfileDlg		*m_pVideoProfileDlg  = nullptr;
-	CAgoraMediaEncryptDlg		*m_pMediaEncryptDlg  = nullptr;
-	CAgoraEffectDlg				*m_pAudioEffectDlg	 = nullptr;
-	CAgoraMultiChannelDlg		*m_pMultiChannelDlg  = nullptr;
-	CAgoraPreCallTestDlg		*m_pPerCallTestDlg   = nullptr;
-	CAgoraAudioVolumeDlg		*m_pAudioVolumeDlg   = nullptr;
-	CAgoraReportInCallDlg		*m_pReportInCallDlg  = nullptr;
-	CAgoraRegionConnDlg			*m_pRegionConnDlg    = nullptr;
-	CAgoraCrossChannelDlg		*m_pCrossChannelDlg  = nullptr;
-	CAgoraMutilVideoSourceDlg	*m_pMultiVideoSourceDlg = nullptr;
+    CSceneRegistry m_sceneRegistry;
     CString m_preSelectedItemText = _T("");
     std::vector<CString> m_vecBasic, m_vecAdvanced;
     
@@ -127,5 +107,6 @@ public:
 	virtual BOOL PreTranslateMessage(MSG* pMsg);
 	afx_msg void OnDestroy();
 	afx_msg void OnClose();
+	afx_msg void OnTimer(UINT_PTR nIDEvent);
 };
 
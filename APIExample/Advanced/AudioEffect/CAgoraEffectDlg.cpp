@@ -74,6 +74,7 @@ BEGIN_MESSAGE_MAP(CAgoraEffectDlg, CDialogEx)
 	ON_MESSAGE(WM_MSGID(EID_USER_JOINED), &CAgoraEffectDlg::OnEIDUserJoined)
 	ON_MESSAGE(WM_MSGID(EID_USER_OFFLINE), &CAgoraEffectDlg::OnEIDUserOffline)
 	ON_MESSAGE(WM_MSGID(EID_REMOTE_VIDEO_STATE_CHANED), &CAgoraEffectDlg::OnEIDRemoteVideoStateChanged)
+	ON_MESSAGE(WM_MSGID(EID_EFFECT_READY), &CAgoraEffectDlg::OnEIDEffectReady)
 
 	ON_LBN_SELCHANGE(IDC_LIST_INFO_BROADCASTING, &CAgoraEffectDlg::OnSelchangeListInfoBroadcasting)
 	ON_WM_SHOWWINDOW()
@@ -112,12 +113,6 @@ void CAgoraEffectDlg::InitCtrlText()
 //Initialize the Agora SDK
 bool CAgoraEffectDlg::InitAgora()
 {
-	//create Agora RTC engine
-	m_rtcEngine = createAgoraRtcEngine();
-	if (!m_rtcEngine) {
-		m_lstInfo.InsertString(m_lstInfo.GetCount() - 1, _T("createAgoraRtcEngine failed"));
-		return false;
-	}
 	//set message notify receiver window
 	m_eventHandler.SetMsgReceiver(m_hWnd);
 
@@ -125,8 +120,9 @@ bool CAgoraEffectDlg::InitAgora()
 	std::string strAppID = GET_APP_ID;
 	context.appId = strAppID.c_str();
 	context.eventHandler = &m_eventHandler;
-	//initialize the Agora RTC engine context.
-	int ret = m_rtcEngine->initialize(context);
+	//borrow the shared engine, this registers our event handler.
+	int ret = m_engineLease.Acquire(context);
+	m_rtcEngine = m_engineLease.GetEngine();
 	if (ret != 0) {
 		m_initialize = false;
 		CString strInfo;
@@ -146,6 +142,13 @@ bool CAgoraEffectDlg::InitAgora()
 	//set client role in the engine to the CLIENT_ROLE_BROADCASTER.
 	m_rtcEngine->setClientRole(CLIENT_ROLE_BROADCASTER);
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("setClientRole broadcaster"));
+	//cached effects are mixed into the frames by our own observer,
+	//the lease puts the frame parameters back when the scene exits.
+	m_engineLease.SetRecordingAudioFrameParameters(EFFECT_SAMPLE_RATE, 1, RAW_AUDIO_FRAME_OP_MODE_READ_WRITE, EFFECT_SAMPLE_RATE / 100);
+	m_engineLease.SetPlaybackAudioFrameParameters(EFFECT_SAMPLE_RATE, 2, RAW_AUDIO_FRAME_OP_MODE_READ_WRITE, EFFECT_SAMPLE_RATE / 100);
+	m_effectObserver.SetMixer(&m_effectMixer);
+	m_engineLease.RegisterAudioFrameObserver(&m_effectObserver);
+	m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("registerAudioFrameObserver"));
 	return true;
 }
 
@@ -163,8 +166,10 @@ void CAgoraEffectDlg::UnInitAgora()
 		//disable video in the engine.
 		m_rtcEngine->disableVideo();
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("disableVideo"));
-		//release engine.
-		m_rtcEngine->release(true);
+		m_effectMixer.StopAll();
+		m_pendingPlays.clear();
+		//give the engine back to the host.
+		m_engineLease.Release();
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("release rtc engine"));
 		m_rtcEngine = NULL;
 	}
@@ -246,6 +251,8 @@ void CAgoraEffectDlg::OnBnClickedButtonAddEffect()
 	{
 		m_cmbEffect.InsertString(m_cmbEffect.GetCount(), strPath);
 		m_mapEffect.insert(std::make_pair(strPath, m_soundId++));
+		//decode in the background so the first play is a cache hit.
+		m_effectCache.Prefetch(cs2utf8(strPath));
 	}
 	else {
 		MessageBox(_T("url can not empty."));
@@ -266,6 +273,7 @@ void CAgoraEffectDlg::OnBnClickedButtonPreload()
 	std::string strPath = cs2utf8(strEffect);
 	//pre load effect
 	int nRet = m_rtcEngine->preloadEffect(m_mapEffect[strEffect], strPath.c_str());
+	m_effectCache.Prefetch(strPath);
 	CString strInfo;
 	strInfo.Format(_T("preload effect :path:%s"), strEffect);
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
@@ -282,6 +290,7 @@ void CAgoraEffectDlg::OnBnClickedButtonUnloadEffect()
 	m_cmbEffect.GetWindowText(strEffect);
 	// un load effect 
 	m_rtcEngine->unloadEffect(m_mapEffect[strEffect]);
+	m_effectCache.Unload(cs2utf8(strEffect));
 	CString strInfo;
 	strInfo.Format(_T("unload effect :path:%s"), strEffect);
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
@@ -298,6 +307,8 @@ void CAgoraEffectDlg::OnBnClickedButtonRemove()
 	CString strEffect;
 	m_cmbEffect.GetWindowText(strEffect);
 	m_cmbEffect.DeleteString(m_cmbEffect.GetCurSel());
+	m_effectMixer.Stop(m_mapEffect[strEffect]);
+	m_effectCache.Unload(cs2utf8(strEffect));
 	CString strInfo;
 	strInfo.Format(_T("remove effect :path:%s"), strEffect);
 	m_mapEffect.erase(m_mapEffect.find(strEffect));
@@ -316,6 +327,7 @@ void CAgoraEffectDlg::OnBnClickedButtonPauseEffect()
 	m_cmbEffect.GetWindowText(strEffect);
 	//pause effect by sound id
 	m_rtcEngine->pauseEffect(m_mapEffect[strEffect]);
+	m_effectMixer.Pause(m_mapEffect[strEffect]);
 
 	CString strInfo;
 	strInfo.Format(_T("pause effect :path:%s"), strEffect);
@@ -334,6 +346,7 @@ void CAgoraEffectDlg::OnBnClickedButtonResumeEffect()
 	m_cmbEffect.GetWindowText(strEffect);
 	// resume effect by sound id.
 	m_rtcEngine->resumeEffect(m_mapEffect[strEffect]);
+	m_effectMixer.Resume(m_mapEffect[strEffect]);
 
 	CString strInfo;
 	strInfo.Format(_T("resume effect :path:%s"), strEffect);
@@ -347,6 +360,7 @@ void CAgoraEffectDlg::OnBnClickedButtonPlayEffect()
 	{
 		return;
 	}
+	int64_t triggerNs = CEffectVoiceMixer::NowNs();
 	CString strEffect;
 	m_cmbEffect.GetWindowText(strEffect);
 	std::string strFile;
@@ -368,12 +382,87 @@ void CAgoraEffectDlg::OnBnClickedButtonPlayEffect()
 	double pan = _ttof(strPan);
 
 	BOOL publish = m_chkPublish.GetCheck();
+	PendingEffectPlay play = { strEffect, loops, pitch, pan, gain, publish, triggerNs };
+	//the mixer does not shift pitch, those plays stay with the SDK.
+	if (pitch == 1.0) {
+		std::shared_ptr<const CEffectClip> clip = m_effectCache.GetAsync(strFile);
+		if (clip && PlayCachedEffect(play, clip, _T("hit")))
+			return;
+		if (!clip && m_effectCache.IsOpen()) {
+			//decoded on the cache's worker, OnEIDEffectReady plays it.
+			m_pendingPlays[strFile].push_back(play);
+			CString strInfo;
+			strInfo.Format(_T("decoding effect :path:%s"), strEffect);
+			m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
+			return;
+		}
+	}
+	PlayEffectWithSdk(play);
+}
+
+bool CAgoraEffectDlg::PlayCachedEffect(const PendingEffectPlay& play, std::shared_ptr<const CEffectClip> clip, LPCTSTR lpSource)
+{
+	EffectVoiceParams params;
+	params.loops = play.loops;
+	params.gain = play.gain / 100.0f;
+	params.pan = (float)play.pan;
+	params.publish = play.publish != FALSE;
+	if (!m_effectMixer.Play(m_mapEffect[play.effect], clip, params, play.triggerNs))
+		return false;
+	CString strInfo;
+	strInfo.Format(_T("play cached effect :path:%s,loops:%d,pan:%.0f,gain:%d,publish:%d,%s"),
+		play.effect, play.loops, play.pan, play.gain, play.publish, lpSource);
+	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
+	LogEffectMetrics();
+	return true;
+}
+
+void CAgoraEffectDlg::PlayEffectWithSdk(const PendingEffectPlay& play)
+{
+	std::string strFile = cs2utf8(play.effect);
 	//play effect by effect path.
-	int nRet = m_rtcEngine->playEffect(m_mapEffect[strEffect], strFile.c_str(),
-		loops, pitch, pan, gain, publish);
+	int nRet = m_rtcEngine->playEffect(m_mapEffect[play.effect], strFile.c_str(),
+		play.loops, play.pitch, play.pan, play.gain, play.publish);
 	CString strInfo;
 	strInfo.Format(_T("play effect :path:%s,loops:%d,pitch:%.1f,pan:%.0f,gain:%d,publish:%d"),
-		strEffect, loops, pitch, pan, gain, publish);
+		play.effect, play.loops, play.pitch, play.pan, play.gain, play.publish);
+	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
+}
+
+//EID_EFFECT_READY message window handler.
+LRESULT CAgoraEffectDlg::OnEIDEffectReady(WPARAM wParam, LPARAM lParam)
+{
+	std::string* path = (std::string*)lParam;
+	auto it = m_pendingPlays.find(*path);
+	if (it != m_pendingPlays.end()) {
+		std::vector<PendingEffectPlay> plays;
+		plays.swap(it->second);
+		m_pendingPlays.erase(it);
+		std::shared_ptr<const CEffectClip> clip = wParam ? m_effectCache.Find(*path) : nullptr;
+		for (const PendingEffectPlay& play : plays) {
+			//removed while it decoded.
+			if (!m_rtcEngine || !m_mapEffect.count(play.effect))
+				continue;
+			//the SDK decodes what the cache could not.
+			if (!clip || !PlayCachedEffect(play, clip, _T("decoded")))
+				PlayEffectWithSdk(play);
+		}
+	}
+	delete path;
+	return 0;
+}
+
+void CAgoraEffectDlg::LogEffectMetrics()
+{
+	EffectCacheStats cacheStats = m_effectCache.GetStats();
+	EffectMixerStats mixerStats = m_effectMixer.GetStats();
+	CString strInfo;
+	strInfo.Format(_T("effect cache: hit rate %.0f%%, decoded %I64u, from disk %I64u, %.1f MB, %.1f MB on disk"),
+		cacheStats.GetHitRate() * 100, cacheStats.decodes, cacheStats.diskLoads, cacheStats.bytes / 1048576.0,
+		cacheStats.diskBytes / 1048576.0);
+	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
+	strInfo.Format(_T("first sample: avg %.1f ms, max %.1f ms, voices:%d, stolen:%I64u"),
+		mixerStats.GetFirstSampleMsAverage(), mixerStats.firstSampleNsMax / 1e6, mixerStats.active, mixerStats.stolen);
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
 }
 
@@ -388,6 +477,7 @@ void CAgoraEffectDlg::OnBnClickedButtonStopEffect()
 	m_cmbEffect.GetWindowText(strEffect);
 	//stop effect by sound id.
 	m_rtcEngine->stopEffect(m_mapEffect[strEffect]);
+	m_effectMixer.Stop(m_mapEffect[strEffect]);
 
 	CString strInfo;
 	strInfo.Format(_T("stop effect :path:%s"), strEffect);
@@ -401,6 +491,7 @@ void CAgoraEffectDlg::OnBnClickedButtonPauseAllEffect()
 	{
 		//pause all effect
 		m_rtcEngine->pauseAllEffects();
+		m_effectMixer.PauseAll();
 		CString strInfo;
 		strInfo.Format(_T("pause All Effects"));
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
@@ -409,6 +500,7 @@ void CAgoraEffectDlg::OnBnClickedButtonPauseAllEffect()
 	else {
 		//resume all effect
 		m_rtcEngine->resumeAllEffects();
+		m_effectMixer.ResumeAll();
 		CString strInfo;
 		strInfo.Format(_T("resume All Effects"));
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
@@ -422,6 +514,7 @@ void CAgoraEffectDlg::OnBnClickedButtonStopAllEffect2()
 {
 	//stop all effect
 	m_rtcEngine->stopAllEffects();
+	m_effectMixer.StopAll();
 	CString strInfo;
 	strInfo.Format(_T("stop All Effects"));
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
@@ -500,6 +593,18 @@ BOOL CAgoraEffectDlg::OnInitDialog()
 	m_cmbPan.InsertString(nIndex++, _T("1"));
 	ResumeStatus();
 	m_sldVolume.SetRange(0, 100);
+
+	TCHAR szTempPath[MAX_PATH] = { 0 };
+	GetTempPath(MAX_PATH, szTempPath);
+	CString strCacheDir = CString(szTempPath) + _T("APIExampleEffects");
+	HWND hWnd = GetSafeHwnd();
+	m_effectCache.SetReadyCallback([hWnd](const std::string& path, bool loaded) {
+		std::string* ready = new std::string(path);
+		if (!::PostMessage(hWnd, WM_MSGID(EID_EFFECT_READY), loaded, (LPARAM)ready))
+			delete ready;
+	});
+	if (!m_effectCache.Open(cs2utf8(strCacheDir), EFFECT_SAMPLE_RATE, 2))
+		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("effect cache unavailable"));
 	return TRUE;
 }
 
@@ -707,3 +812,21 @@ void CAgoraEffectDlg::OnReleasedcaptureSliderVolume(NMHDR *pNMHDR, LRESULT *pRes
 	//m_mediaPlayer->seek(pos);
 	*pResult = 0;
 }
+
+
+//effect frame observer
+bool CEffectAudioFrameObserver::onRecordAudioFrame(AudioFrame& audioFrame)
+{
+	if (m_mixer && audioFrame.bytesPerSample == 2)
+		m_mixer->Mix(static_cast<int16_t*>(audioFrame.buffer), audioFrame.samples, audioFrame.channels,
+			audioFrame.samplesPerSec, EFFECT_MIX_RECORD);
+	return true;
+}
+
+bool CEffectAudioFrameObserver::onPlaybackAudioFrame(AudioFrame& audioFrame)
+{
+	if (m_mixer && audioFrame.bytesPerSample == 2)
+		m_mixer->Mix(static_cast<int16_t*>(audioFrame.buffer), audioFrame.samples, audioFrame.channels,
+			audioFrame.samplesPerSec, EFFECT_MIX_PLAYBACK);
+	return true;
+}
@@ -1,6 +1,23 @@
 ﻿#pragma once
 #include "AGVideoWnd.h"
+#include "EffectVoiceMixer.h"
 #include <map>
+#include <vector>
+
+//mixes the cached effects into the SDK's record and playback frames.
+class CEffectAudioFrameObserver :
+	public agora::media::IAudioFrameObserver
+{
+public:
+	void SetMixer(CEffectVoiceMixer* mixer) { m_mixer = mixer; }
+
+	virtual bool onRecordAudioFrame(AudioFrame& audioFrame) override;
+	virtual bool onPlaybackAudioFrame(AudioFrame& audioFrame) override;
+	virtual bool onMixedAudioFrame(AudioFrame& audioFrame) override { return true; }
+	virtual bool onPlaybackAudioFrameBeforeMixing(unsigned int uid, AudioFrame& audioFrame) override { return true; }
+private:
+	CEffectVoiceMixer* m_mixer = nullptr;
+};
 
 class CAudioEffectEventHandler : public IRtcEngineEventHandler
 {
@@ -101,17 +118,40 @@ public:
 	void RenderLocalVideo();
 	//resume window status
 	void ResumeStatus();
+	//log cache hit rate and time to first sample.
+	void LogEffectMetrics();
 
 private:
+	//format of the effect cache and of the frames the observer mixes into.
+	enum { EFFECT_SAMPLE_RATE = 48000 };
+
 	bool m_joinChannel = false;
 	bool m_initialize = false;
 	bool m_audioMixing = false;
 	bool m_pauseAll = false;
 	IRtcEngine* m_rtcEngine = nullptr;
+	CAgoraEngineLease m_engineLease;
 	CAGVideoWnd m_localVideoWnd;
 	CAudioEffectEventHandler m_eventHandler;
 	int m_soundId = 0;
 	std::map<CString ,int> m_mapEffect;
+	CEffectPcmCache m_effectCache;
+	CEffectVoiceMixer m_effectMixer;
+	CEffectAudioFrameObserver m_effectObserver;
+	//a click on play and what it asked for.
+	struct PendingEffectPlay {
+		CString effect;
+		int loops;
+		double pitch;
+		double pan;
+		int gain;
+		BOOL publish;
+		int64_t triggerNs;
+	};
+	//plays waiting for their effect to decode, by UTF-8 path.
+	std::map<std::string, std::vector<PendingEffectPlay>> m_pendingPlays;
+	bool PlayCachedEffect(const PendingEffectPlay& play, std::shared_ptr<const CEffectClip> clip, LPCTSTR lpSource);
+	void PlayEffectWithSdk(const PendingEffectPlay& play);
 
 protected:
 	virtual void DoDataExchange(CDataExchange* pDX);  
@@ -121,6 +161,7 @@ protected:
 	LRESULT OnEIDUserJoined(WPARAM wParam, LPARAM lParam);
 	LRESULT OnEIDUserOffline(WPARAM wParam, LPARAM lParam);
 	LRESULT OnEIDRemoteVideoStateChanged(WPARAM wParam, LPARAM lParam);
+	LRESULT OnEIDEffectReady(WPARAM wParam, LPARAM lParam);
 public:
 	CStatic m_staVideoArea;
 	CListBox m_lstInfo;
@@ -0,0 +1,227 @@
+#include "EffectDecoder.h"
+#include "dsp/AudioResampler.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+//no stdafx.h, the decoder also builds without MFC.
+#ifdef _WIN32
+#include <windows.h>
+#include <mfapi.h>
+#include <mfidl.h>
+#include <mfreadwrite.h>
+#pragma comment(lib, "mfplat.lib")
+#pragma comment(lib, "mfreadwrite.lib")
+#pragma comment(lib, "mfuuid.lib")
+#endif
+
+namespace {
+	const uint16_t kWaveFormatPcm = 1;
+	const uint16_t kWaveFormatFloat = 3;
+	const uint16_t kWaveFormatExtensible = 0xFFFE;
+
+	uint16_t ReadLE16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+	uint32_t ReadLE32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+	FILE* OpenFile(const std::string& path)
+	{
+#ifdef _WIN32
+		int length = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, NULL, 0);
+		std::wstring wpath(length > 0 ? length - 1 : 0, L'\0');
+		if (length > 1)
+			MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &wpath[0], length);
+		FILE* file = nullptr;
+		_wfopen_s(&file, wpath.c_str(), L"rb");
+		return file;
+#else
+		return fopen(path.c_str(), "rb");
+#endif
+	}
+
+	//1: parsed, 0: not a WAV file, -1: a WAV file we can not read.
+	int ReadWave(const std::string& path, EffectPcm& pcm)
+	{
+		FILE* file = OpenFile(path);
+		if (!file)
+			return -1;
+		std::vector<uint8_t> data(12);
+		if (fread(data.data(), 1, 12, file) != 12 || memcmp(&data[0], "RIFF", 4) != 0 || memcmp(&data[8], "WAVE", 4) != 0) {
+			fclose(file);
+			return 0;
+		}
+		uint8_t buffer[64 * 1024];
+		size_t read;
+		while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+			data.insert(data.end(), buffer, buffer + read);
+		fclose(file);
+
+		uint16_t format = 0, channels = 0, bits = 0;
+		uint32_t sampleRate = 0;
+		const uint8_t* samples = nullptr;
+		size_t sampleBytes = 0;
+		size_t pos = 12;
+		while (pos + 8 <= data.size()) {
+			const uint8_t* chunk = &data[pos];
+			size_t size = ReadLE32(chunk + 4);
+			size_t body = pos + 8;
+			size_t available = (std::min)(size, data.size() - body);
+			if (memcmp(chunk, "fmt ", 4) == 0 && available >= 16) {
+				format = ReadLE16(chunk + 8);
+				channels = ReadLE16(chunk + 10);
+				sampleRate = ReadLE32(chunk + 12);
+				bits = ReadLE16(chunk + 22);
+				//the sub format GUID starts with the plain format tag.
+				if (format == kWaveFormatExtensible && available >= 26)
+					format = ReadLE16(chunk + 32);
+			}
+			else if (memcmp(chunk, "data", 4) == 0) {
+				samples = chunk + 8;
+				//writers that stream often leave the size at 0 or too large.
+				sampleBytes = size == 0 ? data.size() - body : available;
+			}
+			pos = body + size + (size & 1);
+		}
+		if (!samples || channels == 0 || sampleRate == 0)
+			return -1;
+		if (!(format == kWaveFormatPcm && (bits == 8 || bits == 16 || bits == 24 || bits == 32))
+			&& !(format == kWaveFormatFloat && bits == 32))
+			return -1;
+
+		int bytes = bits / 8;
+		size_t count = sampleBytes / bytes / channels * channels;
+		pcm.sampleRate = (int)sampleRate;
+		pcm.channels = channels;
+		pcm.samples.resize(count);
+		for (size_t i = 0; i < count; ++i) {
+			const uint8_t* p = samples + i * bytes;
+			int32_t value;
+			if (format == kWaveFormatFloat) {
+				float f;
+				memcpy(&f, p, 4);
+				value = (int32_t)(std::max)(-32768.f, (std::min)(32767.f, f * 32768.f));
+			}
+			else if (bits == 8)
+				value = ((int32_t)p[0] - 128) << 8;
+			else if (bits == 16)
+				value = (int16_t)ReadLE16(p);
+			else if (bits == 24)
+				value = (int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 24) >> 16;
+			else
+				value = (int32_t)ReadLE32(p) >> 16;
+			pcm.samples[i] = (int16_t)value;
+		}
+		return 1;
+	}
+
+#ifdef _WIN32
+	bool ReadMediaFoundation(const std::string& path, EffectPcm& pcm)
+	{
+		int length = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, NULL, 0);
+		if (length <= 1)
+			return false;
+		std::wstring wpath(length - 1, L'\0');
+		MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &wpath[0], length);
+
+		HRESULT hrCom = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+		bool ok = false;
+		if (SUCCEEDED(MFStartup(MF_VERSION, MFSTARTUP_LITE))) {
+			IMFSourceReader* reader = nullptr;
+			IMFMediaType* type = nullptr;
+			IMFMediaType* actual = nullptr;
+			HRESULT hr = MFCreateSourceReaderFromURL(wpath.c_str(), NULL, &reader);
+			if (SUCCEEDED(hr))
+				hr = MFCreateMediaType(&type);
+			if (SUCCEEDED(hr))
+				hr = type->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Audio);
+			if (SUCCEEDED(hr))
+				hr = type->SetGUID(MF_MT_SUBTYPE, MFAudioFormat_PCM);
+			if (SUCCEEDED(hr))
+				hr = type->SetUINT32(MF_MT_AUDIO_BITS_PER_SAMPLE, 16);
+			if (SUCCEEDED(hr))
+				hr = reader->SetCurrentMediaType((DWORD)MF_SOURCE_READER_FIRST_AUDIO_STREAM, NULL, type);
+			if (SUCCEEDED(hr))
+				hr = reader->GetCurrentMediaType((DWORD)MF_SOURCE_READER_FIRST_AUDIO_STREAM, &actual);
+			UINT32 sampleRate = 0, channels = 0;
+			if (SUCCEEDED(hr))
+				hr = actual->GetUINT32(MF_MT_AUDIO_SAMPLES_PER_SECOND, &sampleRate);
+			if (SUCCEEDED(hr))
+				hr = actual->GetUINT32(MF_MT_AUDIO_NUM_CHANNELS, &channels);
+			while (SUCCEEDED(hr)) {
+				DWORD flags = 0;
+				IMFSample* sample = nullptr;
+				hr = reader->ReadSample((DWORD)MF_SOURCE_READER_FIRST_AUDIO_STREAM, 0, NULL, &flags, NULL, &sample);
+				if (FAILED(hr) || (flags & MF_SOURCE_READERF_ENDOFSTREAM)) {
+					if (sample)
+						sample->Release();
+					break;
+				}
+				if (!sample)
+					continue;
+				IMFMediaBuffer* buffer = nullptr;
+				if (SUCCEEDED(sample->ConvertToContiguousBuffer(&buffer))) {
+					BYTE* data = nullptr;
+					DWORD size = 0;
+					if (SUCCEEDED(buffer->Lock(&data, NULL, &size))) {
+						const int16_t* begin = (const int16_t*)data;
+						pcm.samples.insert(pcm.samples.end(), begin, begin + size / sizeof(int16_t));
+						buffer->Unlock();
+					}
+					buffer->Release();
+				}
+				sample->Release();
+			}
+			ok = SUCCEEDED(hr) && sampleRate > 0 && channels > 0;
+			if (ok) {
+				pcm.sampleRate = (int)sampleRate;
+				pcm.channels = (int)channels;
+				pcm.samples.resize(pcm.samples.size() / channels * channels);
+			}
+			if (actual)
+				actual->Release();
+			if (type)
+				type->Release();
+			if (reader)
+				reader->Release();
+			MFShutdown();
+		}
+		if (SUCCEEDED(hrCom))
+			CoUninitialize();
+		return ok;
+	}
+#endif
+}
+
+bool DecodeEffectFile(const std::string& path, EffectPcm& pcm)
+{
+	pcm = EffectPcm();
+	int wave = ReadWave(path, pcm);
+	if (wave != 0)
+		return wave > 0 && !pcm.samples.empty();
+#ifdef _WIN32
+	return ReadMediaFoundation(path, pcm) && !pcm.samples.empty();
+#else
+	return false;
+#endif
+}
+
+bool ConvertEffectPcm(EffectPcm& pcm, int sampleRate, int channels)
+{
+	if (pcm.sampleRate == sampleRate && pcm.channels == channels)
+		return true;
+	CAudioResampler resampler;
+	if (!resampler.Init(pcm.sampleRate, pcm.channels, sampleRate, channels, CAudioResampler::QUALITY_HIGH))
+		return false;
+	int inFrames = (int)pcm.GetFrames();
+	int outFrames = resampler.GetOutputSamples(inFrames);
+	int latency = resampler.GetLatencySamples();
+	std::vector<int16_t> output((size_t)(outFrames + latency) * channels);
+	resampler.Process(pcm.samples.data(), inFrames, output.data(), outFrames);
+	//push silence through to get the tail out of the filter.
+	int flushFrames = (int)((int64_t)(latency + 1) * pcm.sampleRate / sampleRate) + 1;
+	std::vector<int16_t> silence((size_t)flushFrames * pcm.channels, 0);
+	resampler.Process(silence.data(), flushFrames, output.data() + (size_t)outFrames * channels, latency);
+	output.erase(output.begin(), output.begin() + (size_t)latency * channels);
+	pcm.samples.swap(output);
+	pcm.sampleRate = sampleRate;
+	pcm.channels = channels;
+	return true;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+//a whole decoded audio file, interleaved PCM16.
+struct EffectPcm {
+	int sampleRate = 0;
+	int channels = 0;
+	std::vector<int16_t> samples;
+
+	int64_t GetFrames() const { return channels > 0 ? (int64_t)samples.size() / channels : 0; }
+};
+
+/*
+	Decodes an audio file into memory. WAV (PCM 8/16/24/32 bit and 32 bit
+	float) is parsed directly; on Windows everything else goes through
+	Media Foundation, which covers mp3, aac/m4a and wma.
+	path is UTF-8.
+*/
+bool DecodeEffectFile(const std::string& path, EffectPcm& pcm);
+
+//resample / remix pcm in place to sampleRate and channels.
+bool ConvertEffectPcm(EffectPcm& pcm, int sampleRate, int channels);
@@ -0,0 +1,603 @@
+#include "EffectPcmCache.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+//no stdafx.h, the cache also builds without MFC.
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	const char kClipMagic[4] = { 'A', 'E', 'P', 'C' };
+	const uint32_t kClipVersion = 1;
+
+	//header of a cache file, the samples follow it.
+	struct ClipHeader {
+		char magic[4];
+		uint32_t version;
+		uint32_t sampleRate;
+		uint32_t channels;
+		uint64_t frames;
+		uint64_t sourceSize;
+		int64_t sourceTime;
+		uint8_t reserved[24];
+	};
+	static_assert(sizeof(ClipHeader) == 64, "the samples start 64 bytes in");
+
+#ifdef _WIN32
+	std::wstring ToWide(const std::string& utf8)
+	{
+		int length = MultiByteToWideChar(CP_UTF8, 0, utf8.c_str(), -1, NULL, 0);
+		std::wstring wide(length > 0 ? length - 1 : 0, L'\0');
+		if (length > 1)
+			MultiByteToWideChar(CP_UTF8, 0, utf8.c_str(), -1, &wide[0], length);
+		return wide;
+	}
+
+	std::string ToUtf8(const wchar_t* wide)
+	{
+		int length = WideCharToMultiByte(CP_UTF8, 0, wide, -1, NULL, 0, NULL, NULL);
+		std::string utf8(length > 0 ? length - 1 : 0, '\0');
+		if (length > 1)
+			WideCharToMultiByte(CP_UTF8, 0, wide, -1, &utf8[0], length, NULL, NULL);
+		return utf8;
+	}
+#endif
+
+	bool StatFile(const std::string& path, uint64_t* size, int64_t* time)
+	{
+#ifdef _WIN32
+		WIN32_FILE_ATTRIBUTE_DATA data;
+		if (!GetFileAttributesExW(ToWide(path).c_str(), GetFileExInfoStandard, &data)
+			|| (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+			return false;
+		*size = (uint64_t)data.nFileSizeHigh << 32 | data.nFileSizeLow;
+		*time = (int64_t)((uint64_t)data.ftLastWriteTime.dwHighDateTime << 32 | data.ftLastWriteTime.dwLowDateTime);
+#else
+		struct stat st;
+		if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+			return false;
+		*size = (uint64_t)st.st_size;
+		*time = (int64_t)st.st_mtime;
+#endif
+		return true;
+	}
+
+	//FNV-1a over the path and the source's size and time.
+	std::string MakeKey(const std::string& path, uint64_t size, int64_t time)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		auto add = [&hash](const void* data, size_t length) {
+			const uint8_t* bytes = (const uint8_t*)data;
+			for (size_t i = 0; i < length; ++i) {
+				hash ^= bytes[i];
+				hash *= 1099511628211ull;
+			}
+		};
+		add(path.c_str(), path.size() + 1);
+		add(&size, sizeof(size));
+		add(&time, sizeof(time));
+		char key[32];
+		snprintf(key, sizeof(key), "%016llx", (unsigned long long)hash);
+		return key;
+	}
+
+	FILE* OpenFile(const std::string& path, const char* mode)
+	{
+#ifdef _WIN32
+		FILE* file = nullptr;
+		_wfopen_s(&file, ToWide(path).c_str(), ToWide(mode).c_str());
+		return file;
+#else
+		return fopen(path.c_str(), mode);
+#endif
+	}
+
+	bool RemoveFile(const std::string& path)
+	{
+#ifdef _WIN32
+		return DeleteFileW(ToWide(path).c_str()) != FALSE;
+#else
+		return unlink(path.c_str()) == 0;
+#endif
+	}
+
+	//a remapped file counts as used now, PruneDisk goes by modification time.
+	void TouchFile(const std::string& path)
+	{
+#ifdef _WIN32
+		HANDLE hFile = CreateFileW(ToWide(path).c_str(), FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (hFile == INVALID_HANDLE_VALUE)
+			return;
+		FILETIME now;
+		GetSystemTimeAsFileTime(&now);
+		SetFileTime(hFile, NULL, NULL, &now);
+		CloseHandle(hFile);
+#else
+		utimes(path.c_str(), NULL);
+#endif
+	}
+
+	struct CacheFile {
+		std::string name;
+		uint64_t size;
+		int64_t time;
+	};
+
+	bool EndsWith(const std::string& name, const char* suffix)
+	{
+		size_t length = strlen(suffix);
+		return name.size() > length && name.compare(name.size() - length, length, suffix) == 0;
+	}
+
+	//the regular files directly in directory.
+	void ListFiles(const std::string& directory, std::vector<CacheFile>& files)
+	{
+#ifdef _WIN32
+		WIN32_FIND_DATAW data;
+		HANDLE hFind = FindFirstFileW(ToWide(directory + "/*").c_str(), &data);
+		if (hFind == INVALID_HANDLE_VALUE)
+			return;
+		do {
+			if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+				continue;
+			CacheFile file;
+			file.name = ToUtf8(data.cFileName);
+			file.size = (uint64_t)data.nFileSizeHigh << 32 | data.nFileSizeLow;
+			file.time = (int64_t)((uint64_t)data.ftLastWriteTime.dwHighDateTime << 32 | data.ftLastWriteTime.dwLowDateTime);
+			files.push_back(file);
+		} while (FindNextFileW(hFind, &data));
+		FindClose(hFind);
+#else
+		DIR* dir = opendir(directory.c_str());
+		if (!dir)
+			return;
+		while (dirent* entry = readdir(dir)) {
+			struct stat st;
+			std::string name = entry->d_name;
+			if (stat((directory + "/" + name).c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+				continue;
+			files.push_back(CacheFile{ name, (uint64_t)st.st_size, (int64_t)st.st_mtime });
+		}
+		closedir(dir);
+#endif
+	}
+}
+
+CEffectClip::CEffectClip()
+{
+}
+
+CEffectClip::~CEffectClip()
+{
+	if (!m_mapping)
+		return;
+#ifdef _WIN32
+	UnmapViewOfFile(m_mapping);
+#else
+	munmap((void*)m_mapping, m_mappedSize);
+#endif
+}
+
+CEffectPcmCache::CEffectPcmCache()
+	: m_decoder(DecodeEffectFile)
+{
+}
+
+CEffectPcmCache::~CEffectPcmCache()
+{
+	Close();
+}
+
+bool CEffectPcmCache::Open(const std::string& directory, int sampleRate, int channels, size_t maxBytes, uint64_t maxDiskBytes)
+{
+	Close();
+	if (directory.empty() || sampleRate <= 0 || channels <= 0)
+		return false;
+#ifdef _WIN32
+	if (!CreateDirectoryW(ToWide(directory).c_str(), NULL) && GetLastError() != ERROR_ALREADY_EXISTS)
+		return false;
+#else
+	if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST)
+		return false;
+#endif
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_directory = directory;
+	m_sampleRate = sampleRate;
+	m_channels = channels;
+	m_maxBytes = maxBytes;
+	m_maxDiskBytes = maxDiskBytes;
+	m_stats = EffectCacheStats();
+	m_stop = false;
+	lock.unlock();
+	//nothing loads yet, so the leftovers of an interrupted write go too.
+	PruneDisk(true);
+	return true;
+}
+
+void CEffectPcmCache::Close()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+		m_queue.clear();
+	}
+	m_queued.notify_all();
+	if (m_worker.joinable())
+		m_worker.join();
+	std::lock_guard<std::mutex> lock(m_mutex);
+	//clips still playing stay mapped until their voices let go.
+	m_entries.clear();
+	m_lru.clear();
+	m_stats.bytes = 0;
+	m_stats.entries = 0;
+	m_directory.clear();
+}
+
+void CEffectPcmCache::SetDecoder(DecodeFunction decoder)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_decoder = decoder ? decoder : DecodeFunction(DecodeEffectFile);
+}
+
+void CEffectPcmCache::SetReadyCallback(ReadyFunction ready)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_ready = ready;
+}
+
+void CEffectPcmCache::Prefetch(const std::string& path)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_directory.empty() || m_entries.count(path))
+		return;
+	QueueLoad(path);
+}
+
+std::shared_ptr<const CEffectClip> CEffectPcmCache::Get(const std::string& path, bool* hit)
+{
+	return Acquire(path, true, hit);
+}
+
+std::shared_ptr<const CEffectClip> CEffectPcmCache::GetAsync(const std::string& path, bool* hit)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (hit)
+		*hit = false;
+	if (m_directory.empty())
+		return nullptr;
+	auto it = m_entries.find(path);
+	if (it != m_entries.end()) {
+		m_lru.splice(m_lru.begin(), m_lru, it->second);
+		++m_stats.hits;
+		if (hit)
+			*hit = true;
+		return it->second->clip;
+	}
+	++m_stats.misses;
+	QueueLoad(path);
+	return nullptr;
+}
+
+std::shared_ptr<const CEffectClip> CEffectPcmCache::Find(const std::string& path)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_entries.find(path);
+	if (it == m_entries.end())
+		return nullptr;
+	m_lru.splice(m_lru.begin(), m_lru, it->second);
+	return it->second->clip;
+}
+
+void CEffectPcmCache::QueueLoad(const std::string& path)
+{
+	//a load in flight ends with the ready callback as well.
+	if (m_loading.count(path) || std::find(m_queue.begin(), m_queue.end(), path) != m_queue.end())
+		return;
+	m_queue.push_back(path);
+	if (!m_worker.joinable())
+		m_worker = std::thread(&CEffectPcmCache::WorkerThread, this);
+	m_queued.notify_one();
+}
+
+void CEffectPcmCache::Unload(const std::string& path)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_entries.find(path);
+	if (it == m_entries.end())
+		return;
+	m_stats.bytes -= it->second->clip->GetBytes();
+	m_lru.erase(it->second);
+	m_entries.erase(it);
+	m_stats.entries = m_entries.size();
+}
+
+bool CEffectPcmCache::IsLoaded(const std::string& path) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_entries.count(path) != 0;
+}
+
+EffectCacheStats CEffectPcmCache::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
+
+//count: a play request, prefetches do not move the hit rate.
+std::shared_ptr<const CEffectClip> CEffectPcmCache::Acquire(const std::string& path, bool count, bool* hit)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (hit)
+		*hit = false;
+	if (m_directory.empty())
+		return nullptr;
+	bool waited = false;
+	for (;;) {
+		auto it = m_entries.find(path);
+		if (it != m_entries.end()) {
+			m_lru.splice(m_lru.begin(), m_lru, it->second);
+			//waiting for a prefetch in flight still made the caller wait.
+			if (count && waited)
+				++m_stats.misses;
+			else if (count)
+				++m_stats.hits;
+			if (hit)
+				*hit = !waited;
+			return it->second->clip;
+		}
+		if (!m_loading.count(path))
+			break;
+		waited = true;
+		m_loaded.wait(lock);
+	}
+	if (count)
+		++m_stats.misses;
+	m_loading.insert(path);
+	lock.unlock();
+
+	std::string file;
+	bool wrote = false;
+	std::shared_ptr<const CEffectClip> clip = Load(path, file, wrote);
+
+	lock.lock();
+	m_loading.erase(path);
+	if (clip) {
+		m_lru.push_front(Entry{ path, file, clip });
+		m_entries[path] = m_lru.begin();
+		m_stats.bytes += clip->GetBytes();
+		m_stats.entries = m_entries.size();
+		Evict();
+	}
+	else
+		++m_stats.failures;
+	m_loaded.notify_all();
+	ReadyFunction ready = m_ready;
+	lock.unlock();
+	//after the entry went in, so its file is not a candidate.
+	if (wrote)
+		PruneDisk(false);
+	if (ready)
+		ready(path, clip != nullptr);
+	return clip;
+}
+
+std::shared_ptr<const CEffectClip> CEffectPcmCache::Load(const std::string& path, std::string& file, bool& wrote)
+{
+	uint64_t sourceSize = 0;
+	int64_t sourceTime = 0;
+	if (!StatFile(path, &sourceSize, &sourceTime))
+		return nullptr;
+	DecodeFunction decoder;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		file = m_directory + "/" + MakeKey(path, sourceSize, sourceTime) + ".pcm";
+		decoder = m_decoder;
+	}
+
+	std::shared_ptr<const CEffectClip> clip = MapClip(file, sourceSize, sourceTime);
+	if (clip) {
+		TouchFile(file);
+		std::lock_guard<std::mutex> lock(m_mutex);
+		++m_stats.diskLoads;
+		return clip;
+	}
+
+	auto begin = std::chrono::steady_clock::now();
+	EffectPcm pcm;
+	if (!decoder(path, pcm) || !ConvertEffectPcm(pcm, m_sampleRate, m_channels) || pcm.samples.empty())
+		return nullptr;
+	if (WriteClip(file, sourceSize, sourceTime, pcm)) {
+		wrote = true;
+		clip = MapClip(file, sourceSize, sourceTime);
+	}
+	if (!clip) {
+		//no writable cache directory, keep the samples on the heap.
+		CEffectClip* heap = new CEffectClip;
+		heap->m_heap.swap(pcm.samples);
+		heap->m_samples = heap->m_heap.data();
+		heap->m_frames = (int64_t)heap->m_heap.size() / m_channels;
+		heap->m_sampleRate = m_sampleRate;
+		heap->m_channels = m_channels;
+		clip.reset(heap);
+	}
+	int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - begin).count();
+	std::lock_guard<std::mutex> lock(m_mutex);
+	++m_stats.decodes;
+	m_stats.decodeNs += ns;
+	return clip;
+}
+
+//the cache file if it exists and was made from this version of the source in this format.
+std::shared_ptr<const CEffectClip> CEffectPcmCache::MapClip(const std::string& file, uint64_t sourceSize, int64_t sourceTime)
+{
+	const void* mapping = nullptr;
+	size_t mappedSize = 0;
+#ifdef _WIN32
+	HANDLE hFile = CreateFileW(ToWide(file).c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return nullptr;
+	LARGE_INTEGER fileSize;
+	if (GetFileSizeEx(hFile, &fileSize) && fileSize.QuadPart >= (LONGLONG)sizeof(ClipHeader)
+		&& (uint64_t)fileSize.QuadPart <= (uint64_t)SIZE_MAX) {
+		HANDLE hMapping = CreateFileMappingW(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (hMapping) {
+			mapping = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+			mappedSize = (size_t)fileSize.QuadPart;
+			//the view keeps the mapping alive.
+			CloseHandle(hMapping);
+		}
+	}
+	CloseHandle(hFile);
+#else
+	int fd = open(file.c_str(), O_RDONLY);
+	if (fd < 0)
+		return nullptr;
+	struct stat st;
+	if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(ClipHeader)) {
+		void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		if (data != MAP_FAILED) {
+			mapping = data;
+			mappedSize = (size_t)st.st_size;
+		}
+	}
+	close(fd);
+#endif
+	if (!mapping)
+		return nullptr;
+	std::shared_ptr<CEffectClip> clip(new CEffectClip);
+	clip->m_mapping = mapping;
+	clip->m_mappedSize = mappedSize;
+
+	const ClipHeader* header = (const ClipHeader*)mapping;
+	if (memcmp(header->magic, kClipMagic, sizeof(kClipMagic)) != 0 || header->version != kClipVersion
+		|| header->sampleRate != (uint32_t)m_sampleRate || header->channels != (uint32_t)m_channels
+		|| header->sourceSize != sourceSize || header->sourceTime != sourceTime
+		|| header->frames == 0 || header->frames * m_channels * sizeof(int16_t) != mappedSize - sizeof(ClipHeader))
+		return nullptr;
+	clip->m_samples = (const int16_t*)((const uint8_t*)mapping + sizeof(ClipHeader));
+	clip->m_frames = (int64_t)header->frames;
+	clip->m_sampleRate = m_sampleRate;
+	clip->m_channels = m_channels;
+	return clip;
+}
+
+//written to a temporary name and renamed, a reader never maps half a file.
+bool CEffectPcmCache::WriteClip(const std::string& file, uint64_t sourceSize, int64_t sourceTime, const EffectPcm& pcm)
+{
+	ClipHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, kClipMagic, sizeof(kClipMagic));
+	header.version = kClipVersion;
+	header.sampleRate = (uint32_t)pcm.sampleRate;
+	header.channels = (uint32_t)pcm.channels;
+	header.frames = (uint64_t)pcm.GetFrames();
+	header.sourceSize = sourceSize;
+	header.sourceTime = sourceTime;
+
+	std::string temp = file + ".tmp";
+	FILE* out = OpenFile(temp, "wb");
+	if (!out)
+		return false;
+	size_t bytes = (size_t)header.frames * pcm.channels * sizeof(int16_t);
+	bool ok = fwrite(&header, sizeof(header), 1, out) == 1 && fwrite(pcm.samples.data(), 1, bytes, out) == bytes;
+	ok = fclose(out) == 0 && ok;
+#ifdef _WIN32
+	ok = ok && MoveFileExW(ToWide(temp).c_str(), ToWide(file).c_str(), MOVEFILE_REPLACE_EXISTING);
+	if (!ok)
+		DeleteFileW(ToWide(temp).c_str());
+#else
+	ok = ok && rename(temp.c_str(), file.c_str()) == 0;
+	if (!ok)
+		unlink(temp.c_str());
+#endif
+	return ok;
+}
+
+//unmap least recently used clips nobody plays until the budget holds.
+void CEffectPcmCache::Evict()
+{
+	auto it = m_lru.end();
+	while (m_stats.bytes > m_maxBytes && it != m_lru.begin()) {
+		--it;
+		if (it->clip.use_count() > 1)
+			continue;
+		m_stats.bytes -= it->clip->GetBytes();
+		m_entries.erase(it->path);
+		it = m_lru.erase(it);
+		++m_stats.evictions;
+	}
+	m_stats.entries = m_entries.size();
+}
+
+void CEffectPcmCache::PruneDisk(bool removeTemp)
+{
+	std::string directory;
+	uint64_t maxDiskBytes;
+	std::set<std::string> mapped;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		directory = m_directory;
+		maxDiskBytes = m_maxDiskBytes;
+		for (const Entry& entry : m_lru)
+			mapped.insert(entry.file);
+	}
+	if (directory.empty())
+		return;
+	std::vector<CacheFile> files;
+	ListFiles(directory, files);
+	std::vector<CacheFile> clips;
+	uint64_t total = 0;
+	for (const CacheFile& file : files) {
+		if (EndsWith(file.name, ".pcm")) {
+			clips.push_back(file);
+			total += file.size;
+		}
+		else if (removeTemp && EndsWith(file.name, ".pcm.tmp"))
+			RemoveFile(directory + "/" + file.name);
+	}
+	std::sort(clips.begin(), clips.end(), [](const CacheFile& a, const CacheFile& b) { return a.time < b.time; });
+	uint64_t deleted = 0;
+	for (const CacheFile& file : clips) {
+		if (total <= maxDiskBytes)
+			break;
+		//mapped clips stay, a lone file over budget too.
+		std::string path = directory + "/" + file.name;
+		if (mapped.count(path) || !RemoveFile(path))
+			continue;
+		total -= file.size;
+		++deleted;
+	}
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stats.diskBytes = total;
+	m_stats.diskDeletes += deleted;
+}
+
+void CEffectPcmCache::WorkerThread()
+{
+	for (;;) {
+		std::string path;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_queued.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+			if (m_stop)
+				return;
+			path = m_queue.front();
+			m_queue.pop_front();
+		}
+		Acquire(path, false, nullptr);
+	}
+}
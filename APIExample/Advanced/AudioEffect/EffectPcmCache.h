@@ -0,0 +1,164 @@
+#pragma once
+#include "EffectDecoder.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <thread>
+
+/*
+	One decoded effect in the cache format, read only. The samples live in
+	a memory-mapped PCM file of the cache directory, or on the heap when
+	that file could not be written.
+*/
+class CEffectClip
+{
+public:
+	~CEffectClip();
+
+	const int16_t* GetSamples() const { return m_samples; }
+	int64_t GetFrames() const { return m_frames; }
+	int GetSampleRate() const { return m_sampleRate; }
+	int GetChannels() const { return m_channels; }
+	//bytes of PCM the clip keeps mapped or allocated.
+	size_t GetBytes() const { return (size_t)m_frames * m_channels * sizeof(int16_t); }
+	bool IsMapped() const { return m_mapping != nullptr; }
+
+private:
+	friend class CEffectPcmCache;
+	CEffectClip();
+	CEffectClip(const CEffectClip&) = delete;
+	CEffectClip& operator=(const CEffectClip&) = delete;
+
+	const int16_t* m_samples = nullptr;
+	int64_t m_frames = 0;
+	int m_sampleRate = 0;
+	int m_channels = 0;
+	//start and size of the whole mapped file.
+	const void* m_mapping = nullptr;
+	size_t m_mappedSize = 0;
+	std::vector<int16_t> m_heap;
+};
+
+struct EffectCacheStats {
+	//Get calls served from memory / that had to load.
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	//loads satisfied by remapping a PCM file decoded earlier.
+	uint64_t diskLoads = 0;
+	uint64_t decodes = 0;
+	uint64_t failures = 0;
+	uint64_t evictions = 0;
+	int64_t decodeNs = 0;
+	size_t bytes = 0;
+	size_t entries = 0;
+	//PCM files in the cache directory, and those deleted to stay in budget.
+	uint64_t diskBytes = 0;
+	uint64_t diskDeletes = 0;
+
+	double GetHitRate() const { return hits + misses ? (double)hits / (hits + misses) : 0; }
+};
+
+/*
+	Decoded effects ready to play, keyed by source path.
+	A source file is decoded once, converted to the cache format and
+	written to <directory>/<key>.pcm; the key hashes the path with the
+	source's size and modification time, so an edited file is decoded
+	again and an unchanged one is only remapped, also in the next session.
+	Mapped clips are kept in least recently used order and unmapped once
+	their bytes exceed the budget; a clip a voice still plays is never
+	unmapped under it. The PCM files have a budget of their own: on Open
+	and after each decode the least recently used files not mapped are
+	deleted until the directory fits, files of edited sources included.
+	Prefetch and GetAsync load on a worker thread so the first play is
+	already a hit, or does not wait on the caller's thread.
+*/
+class CEffectPcmCache
+{
+public:
+	typedef std::function<bool(const std::string& path, EffectPcm& pcm)> DecodeFunction;
+	//loaded is false if path could not be decoded.
+	typedef std::function<void(const std::string& path, bool loaded)> ReadyFunction;
+
+	enum {
+		DEFAULT_MAX_BYTES = 64 * 1024 * 1024,
+		DEFAULT_MAX_DISK_BYTES = 256 * 1024 * 1024,
+	};
+
+	CEffectPcmCache();
+	~CEffectPcmCache();
+
+	//directory is UTF-8 and created if needed.
+	bool Open(const std::string& directory, int sampleRate, int channels, size_t maxBytes = DEFAULT_MAX_BYTES,
+		uint64_t maxDiskBytes = DEFAULT_MAX_DISK_BYTES);
+	//stops the worker and unmaps everything not in use.
+	void Close();
+	bool IsOpen() const { return !m_directory.empty(); }
+	//DecodeEffectFile by default.
+	void SetDecoder(DecodeFunction decoder);
+	//called on the loading thread after each load.
+	void SetReadyCallback(ReadyFunction ready);
+
+	//load in the background.
+	void Prefetch(const std::string& path);
+	//the clip of path, loading it first on a miss. nullptr if it can not be decoded.
+	std::shared_ptr<const CEffectClip> Get(const std::string& path, bool* hit = nullptr);
+	//the clip of path if it is in memory. on a miss nullptr, the load runs
+	//on the worker and ends with the ready callback.
+	std::shared_ptr<const CEffectClip> GetAsync(const std::string& path, bool* hit = nullptr);
+	//the clip of path if it is in memory, not counted as a play.
+	std::shared_ptr<const CEffectClip> Find(const std::string& path);
+	//drop the clip from memory, its PCM file stays for a quick reload.
+	void Unload(const std::string& path);
+	bool IsLoaded(const std::string& path) const;
+
+	EffectCacheStats GetStats() const;
+
+private:
+	struct Entry {
+		std::string path;
+		//the PCM file it maps.
+		std::string file;
+		std::shared_ptr<const CEffectClip> clip;
+	};
+
+	std::shared_ptr<const CEffectClip> Acquire(const std::string& path, bool count, bool* hit);
+	//wrote: a new PCM file was written.
+	std::shared_ptr<const CEffectClip> Load(const std::string& path, std::string& file, bool& wrote);
+	std::shared_ptr<const CEffectClip> MapClip(const std::string& file, uint64_t sourceSize, int64_t sourceTime);
+	bool WriteClip(const std::string& file, uint64_t sourceSize, int64_t sourceTime, const EffectPcm& pcm);
+	void Evict();
+	//deletes unmapped PCM files, oldest use first, until the directory fits.
+	void PruneDisk(bool removeTemp);
+	//queues path for the worker, m_mutex held.
+	void QueueLoad(const std::string& path);
+	void WorkerThread();
+
+	std::string m_directory;
+	int m_sampleRate = 0;
+	int m_channels = 0;
+	size_t m_maxBytes = DEFAULT_MAX_BYTES;
+	uint64_t m_maxDiskBytes = DEFAULT_MAX_DISK_BYTES;
+	DecodeFunction m_decoder;
+	ReadyFunction m_ready;
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_loaded;
+	//most recently used first.
+	std::list<Entry> m_lru;
+	std::map<std::string, std::list<Entry>::iterator> m_entries;
+	std::set<std::string> m_loading;
+	EffectCacheStats m_stats;
+
+	std::condition_variable m_queued;
+	std::deque<std::string> m_queue;
+	std::thread m_worker;
+	bool m_stop = false;
+};
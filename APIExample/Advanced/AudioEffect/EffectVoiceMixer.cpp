@@ -0,0 +1,383 @@
+#include "EffectVoiceMixer.h"
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+namespace {
+	inline int16_t ClampToInt16(int32_t v)
+	{
+		if (v > 32767)
+			return 32767;
+		if (v < -32768)
+			return -32768;
+		return (int16_t)v;
+	}
+}
+
+CEffectVoiceMixer::CEffectVoiceMixer()
+{
+}
+
+void CEffectVoiceMixer::SetPolyphony(int maxVoices, int maxPerSound)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	maxVoices = (std::max)(1, (std::min)(maxVoices, (int)MAX_VOICES));
+	for (int i = maxVoices; i < m_maxVoices; ++i)
+		Release(i);
+	m_maxVoices = maxVoices;
+	m_maxPerSound = (std::max)(maxPerSound, 1);
+	Collect();
+}
+
+int64_t CEffectVoiceMixer::NowNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool CEffectVoiceMixer::Play(int soundId, std::shared_ptr<const CEffectClip> clip, const EffectVoiceParams& params, int64_t triggerNs)
+{
+	if (!clip || clip->GetFrames() == 0)
+		return false;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Collect();
+	int sameSound = 0;
+	int slot = -1;
+	for (int i = 0; i < m_maxVoices; ++i) {
+		if (!m_voices[i])
+			slot = slot < 0 ? i : slot;
+		else if (m_voices[i]->soundId == soundId)
+			++sameSound;
+	}
+	if (sameSound >= m_maxPerSound || slot < 0) {
+		int victim = FindVictim(sameSound >= m_maxPerSound ? soundId : -1);
+		if (victim < 0 || m_voices[victim]->params.priority > params.priority) {
+			++m_stats.dropped;
+			return false;
+		}
+		Release(victim);
+		++m_stats.stolen;
+		slot = victim;
+	}
+
+	std::unique_ptr<Voice> voice(new Voice);
+	//0 is an empty slot to the cursors.
+	if (++m_generation == 0)
+		++m_generation;
+	voice->generation = m_generation;
+	voice->soundId = soundId;
+	voice->clip = clip;
+	voice->params = params;
+	voice->params.gain = (std::max)(0.f, (std::min)(1.f, params.gain));
+	voice->params.pan = (std::max)(-1.f, (std::min)(1.f, params.pan));
+	voice->order = ++m_order;
+	voice->triggerNs = triggerNs;
+	Publish(slot, std::move(voice));
+	++m_stats.started;
+	return true;
+}
+
+//soundId -1: any voice.
+int CEffectVoiceMixer::FindVictim(int soundId) const
+{
+	int victim = -1;
+	for (int i = 0; i < m_maxVoices; ++i) {
+		const Voice* voice = m_voices[i].get();
+		if (!voice || (soundId != -1 && voice->soundId != soundId))
+			continue;
+		if (victim < 0) {
+			victim = i;
+			continue;
+		}
+		const Voice* current = m_voices[victim].get();
+		if (voice->params.priority != current->params.priority) {
+			if (voice->params.priority < current->params.priority)
+				victim = i;
+		}
+		else if (voice->params.gain != current->params.gain) {
+			if (voice->params.gain < current->params.gain)
+				victim = i;
+		}
+		else if (voice->order < current->order)
+			victim = i;
+	}
+	return victim;
+}
+
+void CEffectVoiceMixer::Publish(int slot, std::unique_ptr<Voice> voice)
+{
+	m_slots[slot].voice.store(voice.get());
+	m_voices[slot] = std::move(voice);
+}
+
+void CEffectVoiceMixer::Release(int slot)
+{
+	if (!m_voices[slot])
+		return;
+	//a Mix entered after the store no longer finds the voice in the slot,
+	//one entered before may still read it until it exits.
+	m_slots[slot].voice.store(nullptr);
+	Retired retired;
+	retired.voice = std::move(m_voices[slot]);
+	for (int target = 0; target < EFFECT_MIX_TARGET_COUNT; ++target)
+		retired.entered[target] = m_entered[target].load();
+	m_retired.push_back(std::move(retired));
+}
+
+void CEffectVoiceMixer::Stop(int soundId)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (int i = 0; i < m_maxVoices; ++i) {
+		if (m_voices[i] && m_voices[i]->soundId == soundId)
+			Release(i);
+	}
+	Collect();
+}
+
+void CEffectVoiceMixer::Pause(int soundId)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (int i = 0; i < m_maxVoices; ++i) {
+		if (m_voices[i] && m_voices[i]->soundId == soundId)
+			m_voices[i]->paused = true;
+	}
+}
+
+void CEffectVoiceMixer::Resume(int soundId)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (int i = 0; i < m_maxVoices; ++i) {
+		if (m_voices[i] && m_voices[i]->soundId == soundId)
+			m_voices[i]->paused = false;
+	}
+}
+
+void CEffectVoiceMixer::StopAll()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (int i = 0; i < m_maxVoices; ++i)
+		Release(i);
+	Collect();
+}
+
+void CEffectVoiceMixer::PauseAll()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (int i = 0; i < m_maxVoices; ++i) {
+		if (m_voices[i])
+			m_voices[i]->paused = true;
+	}
+}
+
+void CEffectVoiceMixer::ResumeAll()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (int i = 0; i < m_maxVoices; ++i) {
+		if (m_voices[i])
+			m_voices[i]->paused = false;
+	}
+}
+
+//idle: no Mix running and the last one long enough ago that the next
+//will find itself stale, nowNs taken before the counters are read.
+bool CEffectVoiceMixer::IsTargetIdle(int target, int64_t nowNs) const
+{
+	uint64_t entered = m_entered[target].load();
+	uint64_t exited = m_exited[target].load();
+	int64_t lastMixNs = m_lastMixNs[target].load();
+	return entered == exited && (lastMixNs == 0 || nowNs - lastMixNs >= (int64_t)TARGET_IDLE_MS * 1000000);
+}
+
+void CEffectVoiceMixer::Collect()
+{
+	//a voice is done once every target that is being mixed reached its end.
+	int64_t now = NowNs();
+	bool idle[EFFECT_MIX_TARGET_COUNT];
+	bool allIdle = true;
+	for (int target = 0; target < EFFECT_MIX_TARGET_COUNT; ++target) {
+		idle[target] = IsTargetIdle(target, now);
+		allIdle = allIdle && idle[target];
+	}
+	//with nothing mixing the voices wait for the first frame.
+	for (int i = 0; i < m_maxVoices && !allIdle; ++i) {
+		if (!m_voices[i])
+			continue;
+		bool done = true;
+		for (int target = 0; target < EFFECT_MIX_TARGET_COUNT; ++target) {
+			bool relevant = !idle[target] && (target != EFFECT_MIX_RECORD || m_voices[i]->params.publish);
+			if (relevant && m_slots[i].ended[target].load() != m_voices[i]->generation)
+				done = false;
+		}
+		if (done) {
+			Release(i);
+			++m_stats.finished;
+		}
+	}
+
+	//after the releases: a target idle now can not have read them.
+	now = NowNs();
+	for (int target = 0; target < EFFECT_MIX_TARGET_COUNT; ++target)
+		idle[target] = IsTargetIdle(target, now);
+	m_retired.erase(std::remove_if(m_retired.begin(), m_retired.end(), [this, &idle](const Retired& retired) {
+		//the first Mix entered after the release has moved its cursor on.
+		for (int target = 0; target < EFFECT_MIX_TARGET_COUNT; ++target) {
+			if (!idle[target] && m_exited[target].load() <= retired.entered[target])
+				return false;
+		}
+		return true;
+	}), m_retired.end());
+}
+
+bool CEffectVoiceMixer::MixVoice(Cursor& cursor, int32_t* mix, int samples, int outChannels, int fadeLength)
+{
+	const Voice& voice = *cursor.voice;
+	const CEffectClip& clip = *voice.clip;
+	const int16_t* data = clip.GetSamples();
+	int clipChannels = clip.GetChannels();
+	int64_t frames = clip.GetFrames();
+	float gain = voice.params.gain;
+	float pan = voice.params.pan;
+	//Q14 gains keep the integer products of the inner loop inside 32 bits.
+	int32_t left = (int32_t)(gain * (std::min)(1.f, 1.f - pan) * 16384);
+	int32_t right = (int32_t)(gain * (std::min)(1.f, 1.f + pan) * 16384);
+	int64_t& position = cursor.position;
+	//a fade ends within this frame, the voice is gone by the next.
+	int fade = fadeLength > 0 ? (std::min)(fadeLength, samples) : 0;
+	int end = fade ? fade : samples;
+	bool wrote = false;
+
+	int i = 0;
+	while (i < end) {
+		if (position >= frames) {
+			if (cursor.loopsLeft == 0) {
+				cursor.ended = true;
+				break;
+			}
+			if (cursor.loopsLeft > 0)
+				--cursor.loopsLeft;
+			position = 0;
+		}
+		int run = (int)(std::min)((int64_t)(end - i), frames - position);
+		const int16_t* src = data + position * clipChannels;
+		int32_t* dst = mix + i * outChannels;
+		if (!fade) {
+			for (int k = 0; k < run; ++k, src += clipChannels) {
+				int32_t l = src[0];
+				int32_t r = clipChannels > 1 ? src[1] : l;
+				if (outChannels == 1)
+					dst[k] += (l * left + r * right) >> 15;
+				else {
+					dst[2 * k] += (l * left) >> 14;
+					dst[2 * k + 1] += (r * right) >> 14;
+				}
+			}
+		}
+		else {
+			for (int k = 0; k < run; ++k, src += clipChannels) {
+				int32_t scale = (int32_t)((int64_t)(fade - i - k) * 16384 / fade);
+				int32_t l = (src[0] * scale) >> 14;
+				int32_t r = clipChannels > 1 ? (src[1] * scale) >> 14 : l;
+				if (outChannels == 1)
+					dst[k] += (l * left + r * right) >> 15;
+				else {
+					dst[2 * k] += (l * left) >> 14;
+					dst[2 * k + 1] += (r * right) >> 14;
+				}
+			}
+		}
+		position += run;
+		i += run;
+		wrote = true;
+	}
+	if (fade || (position >= frames && cursor.loopsLeft == 0))
+		cursor.ended = true;
+	return wrote;
+}
+
+void CEffectVoiceMixer::Mix(int16_t* frame, int samples, int channels, int sampleRate, EffectMixTarget target)
+{
+	if (!frame || samples <= 0 || channels <= 0 || target < 0 || target >= EFFECT_MIX_TARGET_COUNT)
+		return;
+	//every path from here walks all slots before it exits, see Collect.
+	m_entered[target].fetch_add(1);
+	int64_t now = NowNs();
+	int64_t lastMixNs = m_lastMixNs[target].load(std::memory_order_relaxed);
+	Cursor* cursors = m_cursors[target];
+	if (lastMixNs == 0 || now - lastMixNs >= (int64_t)TARGET_IDLE_MS * 1000000) {
+		//the voices these point at may be freed already.
+		for (int i = 0; i < MAX_VOICES; ++i)
+			cursors[i] = Cursor();
+	}
+	int outChannels = (std::min)(channels, 2);
+	size_t mixSize = (size_t)samples * outChannels;
+	std::vector<int32_t>& scratch = m_mix[target];
+	if (scratch.size() < mixSize)
+		scratch.resize(mixSize);
+	int32_t* mix = scratch.data();
+	memset(mix, 0, mixSize * sizeof(int32_t));
+	int fadeLength = (std::max)(1, sampleRate * STEAL_FADE_MS / 1000);
+
+	bool any = false;
+	for (int i = 0; i < MAX_VOICES; ++i) {
+		Cursor& cursor = cursors[i];
+		const Voice* voice = m_slots[i].voice.load();
+		uint32_t generation = voice ? voice->generation : 0;
+		if (generation != cursor.generation) {
+			//stolen or stopped: fade out what this target was playing instead of cutting it.
+			const Voice* old = cursor.voice;
+			if (old && !cursor.ended && cursor.position > 0 && !old->paused.load(std::memory_order_relaxed)
+				&& old->clip->GetSampleRate() == sampleRate && (target != EFFECT_MIX_RECORD || old->params.publish))
+				any = MixVoice(cursor, mix, samples, outChannels, fadeLength) || any;
+			cursor = Cursor();
+			cursor.generation = generation;
+			cursor.voice = voice;
+			if (voice) {
+				cursor.loopsLeft = voice->params.loops;
+				if (target == EFFECT_MIX_RECORD && !voice->params.publish) {
+					cursor.ended = true;
+					m_slots[i].ended[target].store(generation);
+				}
+			}
+		}
+		if (!voice || cursor.ended || voice->paused.load(std::memory_order_relaxed)
+			|| voice->clip->GetSampleRate() != sampleRate)
+			continue;
+		if (MixVoice(cursor, mix, samples, outChannels, 0)) {
+			any = true;
+			if (m_slots[i].started.exchange(generation) != generation) {
+				int64_t latency = now - voice->triggerNs;
+				m_firstSamples.fetch_add(1);
+				m_firstSampleNsTotal.fetch_add(latency);
+				int64_t max = m_firstSampleNsMax.load();
+				while (latency > max && !m_firstSampleNsMax.compare_exchange_weak(max, latency)) {
+				}
+			}
+		}
+		if (cursor.ended)
+			m_slots[i].ended[target].store(generation);
+	}
+
+	if (any) {
+		for (int i = 0; i < samples; ++i) {
+			int16_t* out = frame + i * channels;
+			for (int c = 0; c < outChannels; ++c)
+				out[c] = ClampToInt16(out[c] + mix[i * outChannels + c]);
+		}
+	}
+	m_lastMixNs[target].store(now);
+	m_exited[target].fetch_add(1);
+}
+
+EffectMixerStats CEffectVoiceMixer::GetStats()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Collect();
+	EffectMixerStats stats = m_stats;
+	stats.firstSamples = m_firstSamples.load();
+	stats.firstSampleNsTotal = m_firstSampleNsTotal.load();
+	stats.firstSampleNsMax = m_firstSampleNsMax.load();
+	stats.active = 0;
+	for (int i = 0; i < m_maxVoices; ++i)
+		stats.active += m_voices[i] ? 1 : 0;
+	return stats;
+}
@@ -0,0 +1,160 @@
+#pragma once
+#include "EffectPcmCache.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+//where a frame goes: the local speaker or the stream other users hear.
+enum EffectMixTarget {
+	EFFECT_MIX_PLAYBACK = 0,
+	EFFECT_MIX_RECORD,
+	EFFECT_MIX_TARGET_COUNT,
+};
+
+//playEffect's parameters, pitch aside.
+struct EffectVoiceParams {
+	//extra plays after the first, -1 for ever.
+	int loops = 0;
+	//0 to 1.
+	float gain = 1.f;
+	//-1 left to 1 right.
+	float pan = 0.f;
+	//also mixed into the recorded frame so remote users hear it.
+	bool publish = true;
+	//steals voices of lower priority before quieter ones of the same.
+	int priority = 0;
+};
+
+struct EffectMixerStats {
+	uint64_t started = 0;
+	uint64_t stolen = 0;
+	//plays refused because every voice had a higher priority.
+	uint64_t dropped = 0;
+	uint64_t finished = 0;
+	//from Play to the first sample written into a frame.
+	uint64_t firstSamples = 0;
+	int64_t firstSampleNsTotal = 0;
+	int64_t firstSampleNsMax = 0;
+	int active = 0;
+
+	double GetFirstSampleMsAverage() const { return firstSamples ? firstSampleNsTotal / 1e6 / firstSamples : 0; }
+};
+
+/*
+	Plays cached effects by mixing them into the frames of an audio frame
+	observer, so a play starts with the next frame instead of after a
+	decode. Voices are a fixed pool: when all MaxVoices play, or
+	MaxPerSound already play the same sound id, the voice of lowest
+	priority, then lowest gain, then the oldest is stolen and faded out
+	over a few milliseconds instead of being cut.
+	Playback and record frames each keep their own position in a voice;
+	a target that has not been mixed for a while does not hold voices.
+	Mix never blocks: the control calls publish each play as an immutable
+	voice through an atomic pointer per slot, and a replaced voice is only
+	freed once every target has mixed past it.
+*/
+class CEffectVoiceMixer
+{
+public:
+	enum {
+		DEFAULT_MAX_VOICES = 16,
+		DEFAULT_MAX_PER_SOUND = 4,
+		//upper bound of SetPolyphony, the slots Mix walks.
+		MAX_VOICES = 64,
+		//fade of a stolen voice, in ms.
+		STEAL_FADE_MS = 5,
+		//a target not mixed for this long stops holding voices, in ms.
+		TARGET_IDLE_MS = 200,
+	};
+
+	CEffectVoiceMixer();
+
+	void SetPolyphony(int maxVoices, int maxPerSound);
+	//nanoseconds of a monotonic clock, the trigger time for Play.
+	static int64_t NowNs();
+
+	//starts clip under soundId, returns false if it can not play.
+	bool Play(int soundId, std::shared_ptr<const CEffectClip> clip, const EffectVoiceParams& params, int64_t triggerNs);
+	void Stop(int soundId);
+	void Pause(int soundId);
+	void Resume(int soundId);
+	void StopAll();
+	void PauseAll();
+	void ResumeAll();
+
+	//adds the voices to interleaved PCM16 at the clips' sample rate, 1 or 2 channels.
+	//one thread per target, lock free.
+	void Mix(int16_t* frame, int samples, int channels, int sampleRate, EffectMixTarget target);
+
+	//also frees the voices that finished.
+	EffectMixerStats GetStats();
+
+private:
+	//one play, never changed once published but for paused.
+	struct Voice {
+		uint32_t generation = 0;
+		int soundId = 0;
+		std::shared_ptr<const CEffectClip> clip;
+		EffectVoiceParams params;
+		uint64_t order = 0;
+		int64_t triggerNs = 0;
+		std::atomic<bool> paused{ false };
+	};
+	//what Mix reads of a slot.
+	struct Slot {
+		std::atomic<const Voice*> voice{ nullptr };
+		//per target: the generation that reached its end there.
+		std::atomic<uint32_t> ended[EFFECT_MIX_TARGET_COUNT] = {};
+		//the generation whose first sample was counted.
+		std::atomic<uint32_t> started{ 0 };
+	};
+	//a target's progress through a voice, owned by its Mix thread.
+	struct Cursor {
+		uint32_t generation = 0;
+		const Voice* voice = nullptr;
+		int64_t position = 0;
+		int loopsLeft = 0;
+		bool ended = false;
+	};
+	//a replaced voice and the Mix calls each target had entered then.
+	struct Retired {
+		std::unique_ptr<Voice> voice;
+		uint64_t entered[EFFECT_MIX_TARGET_COUNT];
+	};
+
+	int FindVictim(int soundId) const;
+	//unpublishes slot, Mix fades the voice out where it was playing.
+	void Release(int slot);
+	void Publish(int slot, std::unique_ptr<Voice> voice);
+	//true if target is not mixing and, if it starts, drops its cursors unread.
+	bool IsTargetIdle(int target, int64_t nowNs) const;
+	//frees finished slots and the retired voices no target can still read.
+	void Collect();
+	//adds the voice at cursor to mix (samples x outChannels), true if it
+	//wrote anything. fadeLength > 0 fades it out over that many samples.
+	bool MixVoice(Cursor& cursor, int32_t* mix, int samples, int outChannels, int fadeLength);
+
+	//control side, Mix never takes it.
+	std::mutex m_mutex;
+	int m_maxVoices = DEFAULT_MAX_VOICES;
+	int m_maxPerSound = DEFAULT_MAX_PER_SOUND;
+	std::unique_ptr<Voice> m_voices[MAX_VOICES];
+	std::vector<Retired> m_retired;
+	uint32_t m_generation = 0;
+	uint64_t m_order = 0;
+	EffectMixerStats m_stats;
+
+	Slot m_slots[MAX_VOICES];
+	//Mix calls begun and done per target, Mix stores the last time it ran.
+	std::atomic<uint64_t> m_entered[EFFECT_MIX_TARGET_COUNT] = {};
+	std::atomic<uint64_t> m_exited[EFFECT_MIX_TARGET_COUNT] = {};
+	std::atomic<int64_t> m_lastMixNs[EFFECT_MIX_TARGET_COUNT] = {};
+	//Mix thread only.
+	Cursor m_cursors[EFFECT_MIX_TARGET_COUNT][MAX_VOICES];
+	std::vector<int32_t> m_mix[EFFECT_MIX_TARGET_COUNT];
+	std::atomic<uint64_t> m_firstSamples{ 0 };
+	std::atomic<int64_t> m_firstSampleNsTotal{ 0 };
+	std::atomic<int64_t> m_firstSampleNsMax{ 0 };
+};
@@ -36,12 +36,6 @@ void CAgoraAudioMixingDlg::InitCtrlText()
 //Initialize the Agora SDK
 bool CAgoraAudioMixingDlg::InitAgora()
 {
-	//create Agora RTC engine
-	m_rtcEngine = createAgoraRtcEngine();
-	if (!m_rtcEngine) {
-		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("createAgoraRtcEngine failed"));
-		return false;
-	}
 	//set message notify receiver window
 	m_eventHandler.SetMsgReceiver(m_hWnd);
 
@@ -49,8 +43,9 @@ bool CAgoraAudioMixingDlg::InitAgora()
 	std::string strAppID = GET_APP_ID;
 	context.appId = strAppID.c_str();
 	context.eventHandler = &m_eventHandler;
-	//initialize the Agora RTC engine context.
-	int ret = m_rtcEngine->initialize(context);
+	//borrow the shared engine, this registers our event handler.
+	int ret = m_engineLease.Acquire(context);
+	m_rtcEngine = m_engineLease.GetEngine();
 	if (ret != 0) {
 		m_initialize = false;
 		CString strInfo;
@@ -106,8 +101,8 @@ void CAgoraAudioMixingDlg::UnInitAgora()
 		//disable video in the engine.
 		m_rtcEngine->disableVideo();
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("disableVideo"));
-		//release engine.
-		m_rtcEngine->release(true);
+		//give the engine back to the host.
+		m_engineLease.Release();
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("release rtc engine"));
 		m_rtcEngine = NULL;
 	}
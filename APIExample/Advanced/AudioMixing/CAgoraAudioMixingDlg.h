@@ -118,6 +118,7 @@ private:
 	bool m_initialize = false;
 	bool m_audioMixing = false;
 	IRtcEngine* m_rtcEngine = nullptr;
+	CAgoraEngineLease m_engineLease;
 	CAGVideoWnd m_localVideoWnd;
 	CAudioMixingEventHandler m_eventHandler;
 
@@ -111,6 +111,7 @@ private:
 	bool m_initialize = false;
 	bool m_setAudio = false;
 	IRtcEngine* m_rtcEngine = nullptr;
+	CAgoraEngineLease m_engineLease;
 	CAGVideoWnd m_localVideoWnd;
 	CAudioProfileEventHandler m_eventHandler;
 public:
@@ -137,6 +137,7 @@ private:
 	bool m_joinChannel = false;
 	bool m_initialize = false;
 	IRtcEngine* m_rtcEngine = nullptr;
+	CAgoraEngineLease m_engineLease;
 	CAGVideoWnd m_localVideoWnd;
 	CAudioVolumeEventHandler m_eventHandler;
 	AudioIndication *m_audioIndiaction = nullptr;
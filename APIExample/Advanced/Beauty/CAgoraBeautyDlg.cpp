@@ -1,6 +1,7 @@
 ﻿#include "stdafx.h"
 #include "APIExample.h"
 #include "CAgoraBeautyDlg.h"
+#include "trace/Trace.h"
 
 
 IMPLEMENT_DYNAMIC(CAgoraBeautyDlg, CDialogEx)
@@ -30,12 +31,6 @@ void CAgoraBeautyDlg::InitCtrlText()
 //Initialize the Agora SDK
 bool CAgoraBeautyDlg::InitAgora()
 {
-	//create Agora RTC engine
-	m_rtcEngine = createAgoraRtcEngine();
-	if (!m_rtcEngine) {
-		m_lstInfo.InsertString(m_lstInfo.GetCount() - 1, _T("createAgoraRtcEngine failed"));
-		return false;
-	}
 	//set message notify receiver window
 	m_eventHandler.SetMsgReceiver(m_hWnd);
 
@@ -43,8 +38,9 @@ bool CAgoraBeautyDlg::InitAgora()
 	std::string strAppID = GET_APP_ID;
 	context.appId = strAppID.c_str();
 	context.eventHandler = &m_eventHandler;
-	//initialize the Agora RTC engine context.
-	int ret = m_rtcEngine->initialize(context);
+	//borrow the shared engine, this registers our event handler.
+	int ret = m_engineLease.Acquire(context);
+	m_rtcEngine = m_engineLease.GetEngine();
 	if (ret != 0) {
 		m_initialize = false;
 		CString strInfo;
@@ -81,8 +77,11 @@ void CAgoraBeautyDlg::UnInitAgora()
 		//disable video in the engine.
 		m_rtcEngine->disableVideo();
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("disableVideo"));
-		//release engine.
-		m_rtcEngine->release(true);
+		if (m_beautyObserverRegistered)
+			LogInProcessBeautyStats();
+		//give the engine back to the host, this unregisters the beauty observer.
+		m_engineLease.Release();
+		m_beautyObserverRegistered = false;
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("release rtc engine"));
 		m_rtcEngine = NULL;
 	}
@@ -115,7 +114,9 @@ void CAgoraBeautyDlg::ResumeStatus()
 	m_staDetail.SetWindowText(_T(""));
 
 	m_chkBeauty.SetCheck(BST_UNCHECKED);
+	m_chkInProcess.SetCheck(BST_UNCHECKED);
 	m_cmbBeautyLevel.SetCurSel(0);
+	m_cmbQuality.SetCurSel(BEAUTY_FILTER_QUALITY_BALANCED);
 	m_lstInfo.ResetContent();
 	SetBeauty(false);
 	m_joinChannel = false;
@@ -141,6 +142,8 @@ void CAgoraBeautyDlg::DoDataExchange(CDataExchange* pDX)
 	DDX_Control(pDX, IDC_STATIC_CHANNELNAME, m_staChannel);
 	DDX_Control(pDX, IDC_EDIT_CHANNELNAME, m_edtChannel);
 	DDX_Control(pDX, IDC_CHECK_BEAUTY_ENABLE, m_chkBeauty);
+	DDX_Control(pDX, IDC_CHECK_BEAUTY_IN_PROCESS, m_chkInProcess);
+	DDX_Control(pDX, IDC_COMBO_BEAUTY_QUALITY, m_cmbQuality);
 	DDX_Control(pDX, IDC_BUTTON_JOINCHANNEL, m_btnJoinChannel);
 	DDX_Control(pDX, IDC_COMBO_BEAUTE_LIGHTENING_CONTRAST_LEVEL, m_cmbBeautyLevel);
 
@@ -182,12 +185,18 @@ BEGIN_MESSAGE_MAP(CAgoraBeautyDlg, CDialogEx)
 	ON_BN_CLICKED(IDC_CHECK_ENHANCE, &CAgoraBeautyDlg::OnBnClickedCheckEnhance)
 	ON_BN_CLICKED(IDC_CHECK_VIDEO_DENOISE, &CAgoraBeautyDlg::OnBnClickedCheckVideoDenoise)
 	ON_CBN_SELCHANGE(IDC_COMBO_BEAUTE_LIGHTENING_CONTRAST_LEVEL, &CAgoraBeautyDlg::OnSelchangeComboBeauteLighteningContrastLevel)
+	ON_BN_CLICKED(IDC_CHECK_BEAUTY_IN_PROCESS, &CAgoraBeautyDlg::OnBnClickedCheckBeautyInProcess)
+	ON_CBN_SELCHANGE(IDC_COMBO_BEAUTY_QUALITY, &CAgoraBeautyDlg::OnSelchangeComboBeautyQuality)
 END_MESSAGE_MAP()
 
 
 void CAgoraBeautyDlg::SetBeauty()
 {
 	if (!m_rtcEngine) return;
+	if (m_chkInProcess.GetCheck() == BST_CHECKED) {
+		SetInProcessBeauty(m_chkBeauty.GetCheck() != 0);
+		return;
+	}
 	BeautyOptions option;
 	option.rednessLevel = m_sldRedness.GetPos() / 100.0f;
 	option.lighteningLevel = m_sdlLightening.GetPos() / 100.0f;
@@ -205,6 +214,49 @@ void CAgoraBeautyDlg::SetColorful()
 	m_rtcEngine->setColorEnhanceOptions(m_chkEnhance.GetCheck()!=0,options);
 }
 
+void CAgoraBeautyDlg::SetInProcessBeauty(bool enabled)
+{
+	if (!m_rtcEngine) return;
+	if (enabled) {
+		BeautyFilterOptions options;
+		options.smoothness = m_sldSmoothness.GetPos() / 100.0f;
+		options.lightening = m_sdlLightening.GetPos() / 100.0f;
+		options.redness = m_sldRedness.GetPos() / 100.0f;
+		options.contrast = (BEAUTY_FILTER_CONTRAST)m_cmbBeautyLevel.GetCurSel();
+		int quality = m_cmbQuality.GetCurSel();
+		options.quality = quality < 0 ? BEAUTY_FILTER_QUALITY_BALANCED : (BEAUTY_FILTER_QUALITY)quality;
+		//it runs on the capture thread, a 30 fps camera has the next frame
+		//ready in 33 ms.
+		options.budgetMs = 1000.0f / 30;
+		m_beautyObserver.GetFilter().SetOptions(options);
+		//the SDK beauty would run on top of ours.
+		BeautyOptions sdkOptions;
+		m_rtcEngine->setBeautyEffectOptions(false, sdkOptions);
+	}
+	if (enabled == m_beautyObserverRegistered)
+		return;
+	if (enabled)
+		m_beautyObserver.GetFilter().ResetStats();
+	else
+		LogInProcessBeautyStats();
+	//registering nullptr removes the observer.
+	if (0 == m_engineLease.RegisterVideoFrameObserver(enabled ? &m_beautyObserver : nullptr))
+		m_beautyObserverRegistered = enabled;
+}
+
+//per frame cost of the in-process filter since it was turned on.
+void CAgoraBeautyDlg::LogInProcessBeautyStats()
+{
+	BeautyFilterStats stats = m_beautyObserver.GetFilter().GetStats();
+	if (stats.frames == 0)
+		return;
+	CString strInfo;
+	strInfo.Format(_T("in-process beauty: %llu frames %dx%d,\navg %.2fms max %.2fms%s,\n1/%d scale after %llu budget steps, %llu frames reused"),
+		stats.frames, stats.width, stats.height, stats.GetMsAverage(), stats.nsMax / 1e6,
+		stats.avx2 ? _T(" avx2") : _T(""), stats.scale, stats.budgetSteps, stats.reusedFrames);
+	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
+}
+
 // join channel or level channel.
 void CAgoraBeautyDlg::OnBnClickedButtonJoinchannel()
 {
@@ -243,6 +295,11 @@ void CAgoraBeautyDlg::SetBeauty(bool enabled,
 	float rednessLevel,
 	float smoothnessLevel)
 {
+	//the in-process filter replaces the SDK beauty when it is checked.
+	bool inProcess = m_chkInProcess.GetCheck() == BST_CHECKED;
+	SetInProcessBeauty(enabled && inProcess);
+	if (inProcess)
+		enabled = false;
 	//Beauty options to set 
 	agora::rtc::BeautyOptions options;
 	options.lighteningContrastLevel = lighteningContrastLevel;
@@ -281,6 +338,11 @@ void CAgoraBeautyDlg::OnBnClickedCheckbeautyCtrlEnable()
 		strInfo.Format(_T("lighteningContrastLevel:%s,\nlightening:%.1f,\nredness:%.1f,\nsmoothness:%.1f"),
 			strlighteningContrastLevel,
 			lighteningLevel, rednessLevel, smoothnessLevel);
+		if (m_chkInProcess.GetCheck() == BST_CHECKED) {
+			CString strQuality;
+			m_cmbQuality.GetWindowText(strQuality);
+			strInfo.Append(_T(",\nin-process, quality:") + strQuality);
+		}
 	}
 	else {
 		strInfo.Format(_T("unset beauty."));
@@ -302,6 +364,11 @@ BOOL CAgoraBeautyDlg::OnInitDialog()
 	m_cmbBeautyLevel.InsertString(nIndex++, _T("Low contrast level"));
 	m_cmbBeautyLevel.InsertString(nIndex++, _T("Normal contrast level."));
 	m_cmbBeautyLevel.InsertString(nIndex++, _T("High contrast level"));
+	//same order as BEAUTY_FILTER_QUALITY.
+	nIndex = 0;
+	m_cmbQuality.InsertString(nIndex++, _T("High quality"));
+	m_cmbQuality.InsertString(nIndex++, _T("Balanced"));
+	m_cmbQuality.InsertString(nIndex++, _T("Fast"));
 
 	ResumeStatus();
 	return TRUE;
@@ -512,6 +579,27 @@ void CBeautyEventHandler::onRemoteVideoStateChanged(uid_t uid, REMOTE_VIDEO_STAT
 
 
 
+//see the header file for details
+bool CBeautyVideoFrameObserver::onCaptureVideoFrame(VideoFrame& videoFrame)
+{
+	AG_TRACE_THREAD_NAME("sdk video capture");
+	AG_TRACE_SCOPE1("sdk", "onCaptureVideoFrame", "renderTimeMs", videoFrame.renderTimeMs);
+	if (videoFrame.type == FRAME_TYPE_YUV420) {
+		m_filter.Process((uint8_t*)videoFrame.yBuffer, videoFrame.yStride,
+			(uint8_t*)videoFrame.uBuffer, videoFrame.uStride,
+			(uint8_t*)videoFrame.vBuffer, videoFrame.vStride,
+			videoFrame.width, videoFrame.height);
+	}
+	return true;
+}
+
+//see the header file for details
+bool CBeautyVideoFrameObserver::onRenderVideoFrame(unsigned int uid, VideoFrame& videoFrame)
+{
+	return true;
+}
+
+
 BOOL CAgoraBeautyDlg::PreTranslateMessage(MSG* pMsg)
 {
 	if (pMsg->message == WM_KEYDOWN && pMsg->wParam == VK_RETURN) {
@@ -581,3 +669,16 @@ void CAgoraBeautyDlg::OnSelchangeComboBeauteLighteningContrastLevel()
 {
 	SetBeauty();
 }
+
+
+//switch between the SDK beauty and the in-process filter.
+void CAgoraBeautyDlg::OnBnClickedCheckBeautyInProcess()
+{
+	OnBnClickedCheckbeautyCtrlEnable();
+}
+
+
+void CAgoraBeautyDlg::OnSelchangeComboBeautyQuality()
+{
+	SetBeauty();
+}
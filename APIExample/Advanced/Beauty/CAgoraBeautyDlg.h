@@ -1,5 +1,29 @@
 ﻿#pragma once
 #include "AGVideoWnd.h"
+#include "dsp/BeautyFilter.h"
+
+// In-process beauty Frame Observer
+class CBeautyVideoFrameObserver :
+	public agora::media::IVideoFrameObserver
+{
+public:
+	/*
+		Runs CBeautyFilter on each I420 frame from the local camera in place,
+		on the SDK's capture thread, before the frame is encoded.
+		parameter:
+		videoFrame :VideoFramedata, see VideoFrame for more details
+		return true, the frame is always sent on, unfiltered when it is not
+		I420.
+	*/
+	virtual bool onCaptureVideoFrame(VideoFrame& videoFrame);
+	//remote video is left alone.
+	virtual bool onRenderVideoFrame(unsigned int uid, VideoFrame& videoFrame);
+
+	CBeautyFilter& GetFilter() { return m_filter; }
+
+private:
+	CBeautyFilter m_filter;
+};
 
 
 class CBeautyEventHandler : public IRtcEngineEventHandler
@@ -111,12 +135,17 @@ public:
 	bool m_joinChannel = false;
 	bool m_initialize = false;
 	IRtcEngine* m_rtcEngine = nullptr;
+	CAgoraEngineLease m_engineLease;
 	CAGVideoWnd m_localVideoWnd;
 	CBeautyEventHandler m_eventHandler;
 
 protected:
 	void SetBeauty();
 	void SetColorful();
+	//apply the options to the in-process filter and register or unregister
+	//its observer, the SDK beauty is turned off while it runs.
+	void SetInProcessBeauty(bool enabled);
+	void LogInProcessBeautyStats();
 	virtual void DoDataExchange(CDataExchange* pDX);
 	LRESULT OnEIDJoinChannelSuccess(WPARAM wParam, LPARAM lParam);
 	LRESULT OnEIDLeaveChannel(WPARAM wParam, LPARAM lParam);
@@ -129,6 +158,10 @@ public:
 	CStatic m_staChannel;
 	CEdit m_edtChannel;
 	CButton m_chkBeauty;
+	CButton m_chkInProcess;
+	CComboBox m_cmbQuality;
+	CBeautyVideoFrameObserver m_beautyObserver;
+	bool m_beautyObserverRegistered = false;
 	CButton m_btnJoinChannel;
 	CComboBox m_cmbBeautyLevel;
 	
@@ -163,6 +196,8 @@ public:
 	afx_msg void OnBnClickedCheckEnhance();
 	afx_msg void OnBnClickedCheckVideoDenoise();
 	afx_msg void OnSelchangeComboBeauteLighteningContrastLevel();
+	afx_msg void OnBnClickedCheckBeautyInProcess();
+	afx_msg void OnSelchangeComboBeautyQuality();
 };
 
 
@@ -1,6 +1,7 @@
 ﻿#include "stdafx.h"
 #include "APIExample.h"
 #include "CAgoraBeautyAudio.h"
+#include "trace/Trace.h"
 
 
 
@@ -35,12 +36,6 @@ void CAgoraBeautyAudio::InitCtrlText()
 //Initialize the Agora SDK
 bool CAgoraBeautyAudio::InitAgora()
 {
-	//create Agora RTC engine
-	m_rtcEngine = createAgoraRtcEngine();
-	if (!m_rtcEngine) {
-		m_lstInfo.InsertString(m_lstInfo.GetCount() - 1, _T("createAgoraRtcEngine failed"));
-		return false;
-	}
 	//set message notify receiver window
 	m_eventHandler.SetMsgReceiver(m_hWnd);
 
@@ -48,8 +43,9 @@ bool CAgoraBeautyAudio::InitAgora()
 	std::string strAppID = GET_APP_ID;
 	context.appId = strAppID.c_str();
 	context.eventHandler = &m_eventHandler;
-	//initialize the Agora RTC engine context.
-	int ret = m_rtcEngine->initialize(context);
+	//borrow the shared engine, this registers our event handler.
+	int ret = m_engineLease.Acquire(context);
+	m_rtcEngine = m_engineLease.GetEngine();
 	if (ret != 0) {
 		m_initialize = false;
 		CString strInfo;
@@ -86,8 +82,11 @@ void CAgoraBeautyAudio::UnInitAgora()
 		//disable video in the engine.
 		m_rtcEngine->disableVideo();
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("disableVideo"));
-		//release engine.
-		m_rtcEngine->release(true);
+		if (m_voiceObserverRegistered)
+			LogVoiceChangerStats();
+		//give the engine back to the host, this unregisters the voice observer.
+		m_engineLease.Release();
+		m_voiceObserverRegistered = false;
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("release rtc engine"));
 		m_rtcEngine = NULL;
 	}
@@ -214,8 +213,21 @@ BOOL CAgoraBeautyAudio::OnInitDialog()
 				_T("TIMBRE_TRANSFORMATION_RINGING"), 
 				})));
 
+	m_mapBeauty.insert(
+		std::make_pair(CString(_T("LocalVoiceChanger")),
+			std::vector<CString>({
+				_T("LOCAL_VOICE_DEEP"),
+				_T("LOCAL_VOICE_CHILD"),
+				_T("LOCAL_VOICE_MONSTER"),
+				_T("LOCAL_VOICE_HIGHER"),
+				_T("LOCAL_VOICE_RADIO"),
+				_T("LOCAL_VOICE_KTV"),
+				_T("LOCAL_VOICE_HALL"),
+				})));
+
 	m_cmbAudioChange.InsertString(nIndex++, _T("AudioEffect"));
 	m_cmbAudioChange.InsertString(nIndex++, _T("VoiceBeautifier"));
+	m_cmbAudioChange.InsertString(nIndex++, _T("LocalVoiceChanger"));
 	
 
 	m_setChanger.insert(std::make_pair(_T("AUDIO_EFFECT_OFF"), AUDIO_EFFECT_OFF));
@@ -251,6 +263,31 @@ BOOL CAgoraBeautyAudio::OnInitDialog()
 	m_setReverbPreSet.insert(std::make_pair(_T("TIMBRE_TRANSFORMATION_RESOUNDING"), TIMBRE_TRANSFORMATION_RESOUNDING));
 	m_setReverbPreSet.insert(std::make_pair(_T("TIMBRE_TRANSFORMATION_RINGING"), TIMBRE_TRANSFORMATION_RINGING));
 
+	//pitch, formant, low, mid, mid Hz, high, reverb mix, time, room, damping.
+	auto localVoice = [this](LPCTSTR name, float pitch, float formant, float low, float mid, float midHz, float high,
+		float mix, float time, float room, float damping) {
+		VoiceChangerOptions options;
+		options.pitchSemitones = pitch;
+		options.formantSemitones = formant;
+		options.eqLowDb = low;
+		options.eqMidDb = mid;
+		options.eqMidHz = midHz;
+		options.eqHighDb = high;
+		options.reverbMix = mix;
+		options.reverbTime = time;
+		options.reverbRoom = room;
+		options.reverbDamping = damping;
+		m_setLocalVoice.insert(std::make_pair(CString(name), options));
+	};
+	localVoice(_T("LOCAL_VOICE_DEEP"), -3, -2, 3, 0, 1500, 0, 0, 1.2f, 0.5f, 0.5f);
+	localVoice(_T("LOCAL_VOICE_CHILD"), 6, 4, 0, 0, 1500, 2, 0, 1.2f, 0.5f, 0.5f);
+	localVoice(_T("LOCAL_VOICE_MONSTER"), -8, -5, 4, 0, 1500, 0, 0.2f, 1.5f, 0.8f, 0.6f);
+	//same speaker, higher notes.
+	localVoice(_T("LOCAL_VOICE_HIGHER"), 4, 0, 0, 0, 1500, 0, 0, 1.2f, 0.5f, 0.5f);
+	localVoice(_T("LOCAL_VOICE_RADIO"), 0, 0, -18, 8, 1800, -18, 0, 1.2f, 0.5f, 0.5f);
+	localVoice(_T("LOCAL_VOICE_KTV"), 0, 0, 0, 0, 1500, 2, 0.3f, 1.2f, 0.5f, 0.5f);
+	localVoice(_T("LOCAL_VOICE_HALL"), 0, 0, 0, 0, 1500, 0, 0.45f, 2.2f, 0.9f, 0.4f);
+
 	ResumeStatus();
 	return TRUE;  
 }
@@ -325,7 +362,33 @@ void CAgoraBeautyAudio::OnBnClickedButtonSetAudioChange()
 		{
 			m_rtcEngine->setVoiceBeautifierPreset(m_setReverbPreSet[str]);
 		}
-		strInfo.Format(_T("set :%s"));
+		if (m_setLocalVoice.find(str) != m_setLocalVoice.end())
+		{
+			//the SDK presets would run on top of ours.
+			m_rtcEngine->setAudioEffectPreset(AUDIO_EFFECT_OFF);
+			m_rtcEngine->setVoiceBeautifierPreset(VOICE_BEAUTIFIER_OFF);
+			VoiceChangerOptions options = m_setLocalVoice[str];
+			//param1 and param2 override the pitch and formant semitones.
+			CString strParam;
+			m_edtParam1.GetWindowText(strParam);
+			if (!strParam.IsEmpty())
+				options.pitchSemitones = (float)_ttof(strParam);
+			m_edtParam2.GetWindowText(strParam);
+			if (!strParam.IsEmpty())
+				options.formantSemitones = (float)_ttof(strParam);
+			m_voiceObserver.GetChanger().SetOptions(options);
+			m_voiceObserver.GetChanger().ResetStats();
+			if (!m_voiceObserverRegistered) {
+				//10 ms mono frames at 48 kHz, written back to the encoder. the
+				//lease sets the default format again when the scene exits.
+				m_engineLease.SetRecordingAudioFrameParameters(48000, 1, RAW_AUDIO_FRAME_OP_MODE_READ_WRITE, 480);
+				m_voiceObserverRegistered = m_engineLease.RegisterAudioFrameObserver(&m_voiceObserver) == 0;
+			}
+			strInfo.Format(_T("local voice pitch:%.1f formant:%.1f reverb:%.2f"),
+				options.pitchSemitones, options.formantSemitones, options.reverbMix);
+			m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
+		}
+		strInfo.Format(_T("set :%s"), str);
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
 		m_btnSetBeautyAudio.SetWindowText(beautyAudioCtrlUnSetAudioChange);
 	}
@@ -333,6 +396,11 @@ void CAgoraBeautyAudio::OnBnClickedButtonSetAudioChange()
 		//set audio beauty to VOICE_CHANGER_OFF.
 		m_rtcEngine->setAudioEffectPreset(AUDIO_EFFECT_OFF);
 		m_rtcEngine->setVoiceBeautifierPreset(VOICE_BEAUTIFIER_OFF);
+		if (m_voiceObserverRegistered) {
+			LogVoiceChangerStats();
+			m_engineLease.RegisterAudioFrameObserver(nullptr);
+			m_voiceObserverRegistered = false;
+		}
 		m_lstInfo.InsertString(m_lstInfo.GetCount(),_T("unset beauty voice"));
 		m_btnSetBeautyAudio.SetWindowText(beautyAudioCtrlSetAudioChange);
 	}
@@ -556,3 +624,30 @@ void CAgoraBeautyAudio::OnSelchangeComboAudioChanger()
 	}
 	m_cmbPerverbPreset.SetCurSel(0);
 }
+
+
+void CAgoraBeautyAudio::LogVoiceChangerStats()
+{
+	VoiceChangerStats stats = m_voiceObserver.GetChanger().GetStats();
+	if (stats.frames == 0 || stats.sampleRate == 0)
+		return;
+	CString strInfo;
+	strInfo.Format(_T("local voice: %llu frames, avg %.3f ms, max %.3f ms, load %.2f%%"),
+		stats.frames, stats.GetMsAverage(), stats.nsMax / 1e6, stats.GetLoadPercent());
+	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
+	strInfo.Format(_T("local voice: latency %.1f ms at %d Hz, avx2:%d"),
+		stats.latencySamples * 1000.0 / stats.sampleRate, stats.sampleRate, stats.avx2 ? 1 : 0);
+	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
+}
+
+
+//voice changer frame observer
+bool CVoiceChangerAudioFrameObserver::onRecordAudioFrame(AudioFrame& audioFrame)
+{
+	AG_TRACE_THREAD_NAME("sdk audio record");
+	AG_TRACE_SCOPE1("sdk", "onRecordAudioFrame", "renderTimeMs", audioFrame.renderTimeMs);
+	if (audioFrame.bytesPerSample == 2)
+		m_changer.Process(static_cast<int16_t*>(audioFrame.buffer), audioFrame.samples, audioFrame.channels,
+			audioFrame.samplesPerSec);
+	return true;
+}
@@ -1,8 +1,25 @@
 ﻿#pragma once
 #include "AGVideoWnd.h"
+#include "dsp/VoiceChanger.h"
 #include <map>
 #include <set>
 
+//runs CVoiceChanger on the recorded frames, before they are encoded.
+class CVoiceChangerAudioFrameObserver :
+	public agora::media::IAudioFrameObserver
+{
+public:
+	virtual bool onRecordAudioFrame(AudioFrame& audioFrame) override;
+	virtual bool onPlaybackAudioFrame(AudioFrame& audioFrame) override { return true; }
+	virtual bool onMixedAudioFrame(AudioFrame& audioFrame) override { return true; }
+	virtual bool onPlaybackAudioFrameBeforeMixing(unsigned int uid, AudioFrame& audioFrame) override { return true; }
+
+	CVoiceChanger& GetChanger() { return m_changer; }
+
+private:
+	CVoiceChanger m_changer;
+};
+
 class CAudioChangeEventHandler : public IRtcEngineEventHandler
 {
 public:
@@ -104,17 +121,24 @@ public:
 	void RenderLocalVideo();
 	//resume window status
 	void ResumeStatus();
+	//cost and delay of the in-process voice changer since it was set.
+	void LogVoiceChangerStats();
 
 private:
 	bool m_joinChannel = false;
 	bool m_initialize = false;
 	bool m_beautyAudio = false;
 	IRtcEngine* m_rtcEngine = nullptr;
+	CAgoraEngineLease m_engineLease;
 	CAGVideoWnd m_localVideoWnd;
 	CAudioChangeEventHandler m_eventHandler;
 	std::map<CString, std::vector<CString>> m_mapBeauty;
 	std::map<CString, AUDIO_EFFECT_PRESET>m_setChanger;
 	std::map<CString, VOICE_BEAUTIFIER_PRESET>m_setReverbPreSet;
+	//presets processed in-process by m_voiceObserver instead of the SDK.
+	std::map<CString, VoiceChangerOptions> m_setLocalVoice;
+	CVoiceChangerAudioFrameObserver m_voiceObserver;
+	bool m_voiceObserverRegistered = false;
 
 protected:
 	virtual void DoDataExchange(CDataExchange* pDX);   
@@ -3,10 +3,60 @@
 #include "CAgoraCrossChannelDlg.h"
 #include <algorithm>
 
+namespace {
+	int64_t RelayNowMs()
+	{
+		return (int64_t)GetTickCount64();
+	}
+}
+
+void CEngineChannelRelayApi::Build(const std::vector<RelayDestination>& destinations, ChannelMediaRelayConfiguration& cmrc)
+{
+	m_destInfos.resize(destinations.size());
+	for (size_t i = 0; i < destinations.size(); ++i) {
+		m_destInfos[i].channelName = destinations[i].channel.c_str();
+		//NULL when the App Certificate is not enabled.
+		m_destInfos[i].token = destinations[i].token.empty() ? NULL : destinations[i].token.c_str();
+		m_destInfos[i].uid = destinations[i].uid;
+	}
+	cmrc.srcInfo = m_srcInfo;
+	cmrc.destInfos = m_destInfos.data();
+	cmrc.destCount = (int)m_destInfos.size();
+}
+
+int CEngineChannelRelayApi::StartRelay(const std::vector<RelayDestination>& destinations)
+{
+	if (!m_rtcEngine)
+		return -1;
+	ChannelMediaRelayConfiguration cmrc;
+	Build(destinations, cmrc);
+	//start Channel Media Relay from cmrc.
+	return m_rtcEngine->startChannelMediaRelay(cmrc);
+}
+
+int CEngineChannelRelayApi::UpdateRelay(const std::vector<RelayDestination>& destinations)
+{
+	if (!m_rtcEngine)
+		return -1;
+	ChannelMediaRelayConfiguration cmrc;
+	Build(destinations, cmrc);
+	//update Channel Media Relay.
+	return m_rtcEngine->updateChannelMediaRelay(cmrc);
+}
+
+int CEngineChannelRelayApi::StopRelay()
+{
+	if (!m_rtcEngine)
+		return -1;
+	//stop Channel Media Relay.
+	return m_rtcEngine->stopChannelMediaRelay();
+}
+
 IMPLEMENT_DYNAMIC(CAgoraCrossChannelDlg, CDialogEx)
 
 CAgoraCrossChannelDlg::CAgoraCrossChannelDlg(CWnd* pParent /*=nullptr*/)
 	: CDialogEx(IDD_DIALOG_CROSS_CHANNEL, pParent)
+	, m_relayPlanner(&m_relayApi)
 {
 
 }
@@ -43,6 +93,7 @@ void CAgoraCrossChannelDlg::DoDataExchange(CDataExchange* pDX)
 
 BEGIN_MESSAGE_MAP(CAgoraCrossChannelDlg, CDialogEx)
 	ON_WM_SHOWWINDOW()
+	ON_WM_TIMER()
 	ON_MESSAGE(WM_MSGID(EID_JOINCHANNEL_SUCCESS), &CAgoraCrossChannelDlg::OnEIDJoinChannelSuccess)
 	ON_MESSAGE(WM_MSGID(EID_LEAVE_CHANNEL), &CAgoraCrossChannelDlg::OnEIDLeaveChannel)
 	ON_MESSAGE(WM_MSGID(EID_USER_JOINED), &CAgoraCrossChannelDlg::OnEIDUserJoined)
@@ -80,12 +131,6 @@ void CAgoraCrossChannelDlg::InitCtrlText()
 //Initialize the Agora SDK
 bool CAgoraCrossChannelDlg::InitAgora()
 {
-	//create Agora RTC engine
-	m_rtcEngine = createAgoraRtcEngine();
-	if (!m_rtcEngine) {
-		m_lstInfo.InsertString(m_lstInfo.GetCount() - 1, _T("createAgoraRtcEngine failed"));
-		return false;
-	}
 	//set message notify receiver window
 	m_eventHandler.SetMsgReceiver(m_hWnd);
 	m_srcInfo = new ChannelMediaInfo;
@@ -95,8 +140,9 @@ bool CAgoraCrossChannelDlg::InitAgora()
 	std::string strAppID = GET_APP_ID;
 	context.appId = strAppID.c_str();
 	context.eventHandler = &m_eventHandler;
-	//initialize the Agora RTC engine context.
-	int ret = m_rtcEngine->initialize(context);
+	//borrow the shared engine, this registers our event handler.
+	int ret = m_engineLease.Acquire(context);
+	m_rtcEngine = m_engineLease.GetEngine();
 	if (ret != 0) {
 		m_initialize = false;
 		CString strInfo;
@@ -106,6 +152,8 @@ bool CAgoraCrossChannelDlg::InitAgora()
 	}
 	else
 		m_initialize = true;
+	m_relayApi.SetEngine(m_rtcEngine);
+	m_relayApi.SetSource(m_srcInfo);
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("initialize success"));
 	//enable video in the engine.
 	m_rtcEngine->enableVideo();
@@ -124,6 +172,12 @@ bool CAgoraCrossChannelDlg::InitAgora()
 void CAgoraCrossChannelDlg::UnInitAgora()
 {
 	if (m_rtcEngine) {
+		//stop the relay before the engine goes.
+		KillTimer(RELAY_TIMER_ID);
+		m_relayPlanner.SetEnabled(false);
+		TickRelay();
+		m_relayApi.SetEngine(nullptr);
+		m_relayApi.SetSource(nullptr);
 		if (m_joinChannel)
 			//leave channel
 			m_joinChannel = !m_rtcEngine->leaveChannel();
@@ -133,8 +187,8 @@ void CAgoraCrossChannelDlg::UnInitAgora()
 		//disable video in the engine.
 		m_rtcEngine->disableVideo();
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("disableVideo"));
-		//release engine.
-		m_rtcEngine->release(true);
+		//give the engine back to the host.
+		m_engineLease.Release();
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("release rtc engine"));
 		m_rtcEngine = NULL;
 		if(m_srcInfo->channelName)
@@ -171,13 +225,9 @@ void CAgoraCrossChannelDlg::ResumeStatus()
 	m_edtCrossChannel.SetWindowText(_T(""));
 	m_edtToken.SetWindowText(_T(""));
 	m_edtUserID.SetWindowText(_T(""));
-	int offset = 0;
-	for (auto & mediaInfo : m_vecChannelMedias)
-	{
-		delete mediaInfo.channelName;
-		delete mediaInfo.token;
-	}
-	m_vecChannelMedias.clear();
+	m_cmbCrossChannelList.ResetContent();
+	m_relayPlanner.ClearDestinations();
+	m_relayPlanner.SetEnabled(false);
 	m_joinChannel = false;
 	m_initialize = false;
 	m_startMediaRelay = false;
@@ -270,18 +320,17 @@ void CAgoraCrossChannelDlg::OnBnClickedButtonAddCrossChannel()
 		AfxMessageBox(_T("The channel and user ID cannot be empty"));
 		return;
 	}
-	ChannelMediaInfo mediaInfo;
-	std::string szChannel = cs2utf8(strChannel);
-	std::string szToken = cs2utf8(strToken);
-	mediaInfo.channelName = new char[strChannel.GetLength() + 1];
-	mediaInfo.token = new char[strToken.GetLength() + 1];
-	mediaInfo.uid = _ttol(strUID);
-	strcpy_s(const_cast<char*>(mediaInfo.channelName), strChannel.GetLength() + 1, szChannel.data());
-	strcpy_s(const_cast<char*>(mediaInfo.token), strToken.GetLength() + 1, szToken.data());
-	//add mediaInfo to vector.
-	m_vecChannelMedias.push_back(mediaInfo);
-	m_cmbCrossChannelList.AddString(strChannel);
-	m_cmbCrossChannelList.SetCurSel(m_cmbCrossChannelList.GetCount() - 1);
+	RelayDestination destination;
+	destination.channel = cs2utf8(strChannel);
+	destination.token = cs2utf8(strToken);
+	destination.uid = _ttol(strUID);
+	//adding a channel again changes its token and uid.
+	m_relayPlanner.SetDestination(destination);
+	int nSel = m_cmbCrossChannelList.FindStringExact(-1, strChannel);
+	if (nSel < 0)
+		nSel = m_cmbCrossChannelList.AddString(strChannel);
+	m_cmbCrossChannelList.SetCurSel(nSel);
+	TickRelay();
 }
 
 //remove combobox item
@@ -291,22 +340,10 @@ void CAgoraCrossChannelDlg::OnBnClickedButtonRemoveCrossChannel2()
 	if (nSel < 0)return;
 	CString strChannelName;
 	m_cmbCrossChannelList.GetWindowText(strChannelName);
-	std::string szChannelName = cs2utf8(strChannelName);
-
-	int offset = 0;
-	//erase media info from m_vecChannelMedias
-	for (auto & mediaInfo : m_vecChannelMedias)
-	{
-		if (szChannelName.compare(mediaInfo.channelName) == 0)
-		{
-			delete mediaInfo.channelName;
-			delete mediaInfo.token;
-			m_vecChannelMedias.erase(m_vecChannelMedias.begin() + offset);
-		}
-		offset++;
-	}
+	m_relayPlanner.RemoveDestination(cs2utf8(strChannelName));
 	m_cmbCrossChannelList.DeleteString(nSel);
 	m_cmbCrossChannelList.SetCurSel(m_cmbCrossChannelList.GetCount() - 1);
+	TickRelay();
 }
 
 //start media relay or stop media relay
@@ -314,56 +351,78 @@ void CAgoraCrossChannelDlg::OnBnClickedButtonStartMediaRelay()
 {
 	if (!m_startMediaRelay)
 	{
-		int nDestCount = m_vecChannelMedias.size();
-		ChannelMediaInfo  *lpDestInfos = new ChannelMediaInfo[nDestCount];
-		for (int nIndex = 0; nIndex < nDestCount; nIndex++) {
-			lpDestInfos[nIndex].channelName = m_vecChannelMedias[nIndex].channelName;
-			lpDestInfos[nIndex].token = m_vecChannelMedias[nIndex].token;
-			lpDestInfos[nIndex].uid = m_vecChannelMedias[nIndex].uid;
-		}
-		ChannelMediaRelayConfiguration cmrc;
-		cmrc.srcInfo = m_srcInfo;
-		cmrc.destInfos = lpDestInfos;
-		cmrc.destCount = nDestCount;
-		int ret = 0;
-		//start Channel Media Relay from cmrc.
-		ret = m_rtcEngine->startChannelMediaRelay(cmrc);
-		m_lstInfo.AddString(_T("startChannelMediaRelay"));
-		delete lpDestInfos;
+		//the planner starts the relay once there are destinations and
+		//keeps it on them from here.
+		m_relayPlanner.SetEnabled(true);
+		SetTimer(RELAY_TIMER_ID, RELAY_TIMER_MS, NULL);
 		m_btnStartMediaRelay.SetWindowText(CrossChannelStopMediaRelay);
 	}
 	else {
-		//stop Channel Media Relay.
-		m_rtcEngine->stopChannelMediaRelay();
-		m_lstInfo.AddString(_T("stopChannelMediaRelay"));
+		m_relayPlanner.SetEnabled(false);
+		KillTimer(RELAY_TIMER_ID);
 		m_btnStartMediaRelay.SetWindowText(CrossChannelStartMediaRelay);
 	}
 	m_startMediaRelay = !m_startMediaRelay;
-	
+	TickRelay();
 }
 
 //update update Channel Media Relay.
 void CAgoraCrossChannelDlg::OnBnClickedButtonUpdate()
 {
+	//adding and removing update the relay already, this retries now and
+	//shows where each destination is.
 	if (m_startMediaRelay)
 	{
-		int nDestCount = m_vecChannelMedias.size();
-		ChannelMediaInfo  *lpDestInfos = new ChannelMediaInfo[nDestCount];
-		for (int nIndex = 0; nIndex < nDestCount; nIndex++) {
-			lpDestInfos[nIndex].channelName = m_vecChannelMedias[nIndex].channelName;
-			lpDestInfos[nIndex].token = m_vecChannelMedias[nIndex].token;
-			lpDestInfos[nIndex].uid = m_vecChannelMedias[nIndex].uid;
+		TickRelay();
+		LogRelayStatus();
+	}
+}
+
+void CAgoraCrossChannelDlg::TickRelay()
+{
+	RelayPlannerStats before = m_relayPlanner.GetStats();
+	if (!m_relayPlanner.Tick(RelayNowMs()))
+		return;
+	const RelayPlannerStats& after = m_relayPlanner.GetStats();
+	CString strInfo;
+	if (after.starts != before.starts)
+		strInfo = _T("startChannelMediaRelay");
+	else if (after.updates != before.updates)
+		strInfo = _T("updateChannelMediaRelay");
+	else if (after.stops != before.stops)
+		strInfo = _T("stopChannelMediaRelay");
+	else if (after.timeouts != before.timeouts)
+		strInfo = _T("media relay timed out, retry later");
+	else
+		strInfo = _T("media relay call failed, retry later");
+	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
+}
+
+void CAgoraCrossChannelDlg::LogRelayStatus()
+{
+	static const TCHAR* states[] = { _T("waiting"), _T("pending"), _T("active"), _T("suspect"), _T("backoff") };
+	int64_t now = RelayNowMs();
+	CString strInfo;
+	for (const RelayDestinationStatus& status : m_relayPlanner.GetStatus(now)) {
+		strInfo.Format(_T("%s: %s"), utf82cs(status.destination.channel), states[status.state]);
+		if (status.state == RELAY_DESTINATION_BACKOFF) {
+			CString strRetry;
+			strRetry.Format(_T(", %d failures, retry in %llds"), status.failures, (status.retryAtMs - now + 999) / 1000);
+			strInfo += strRetry;
 		}
-		ChannelMediaRelayConfiguration cmrc;
-		cmrc.srcInfo = m_srcInfo;
-		cmrc.destInfos = lpDestInfos;
-		cmrc.destCount = nDestCount;
-		int ret = 0;
-		//update Channel Media Relay.
-		ret = m_rtcEngine->updateChannelMediaRelay(cmrc);
-		m_lstInfo.AddString(_T("updateChannelMediaRelay"));
-		delete lpDestInfos;
+		m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
 	}
+	const RelayPlannerStats& stats = m_relayPlanner.GetStats();
+	strInfo.Format(_T("relay: %llu changes, %llu starts, %llu updates, %llu refused, %llu failures"),
+		stats.changes, stats.starts, stats.updates, stats.refused, stats.failures);
+	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
+}
+
+void CAgoraCrossChannelDlg::OnTimer(UINT_PTR nIDEvent)
+{
+	if (nIDEvent == RELAY_TIMER_ID)
+		TickRelay();
+	CDialogEx::OnTimer(nIDEvent);
 }
 
 void CAgoraCrossChannelDlg::OnSelchangeListInfoBroadcasting()
@@ -433,6 +492,17 @@ LRESULT CAgoraCrossChannelDlg::OnEIDChannelMediaRelayStateChanged(WPARAM wParam,
 	CString strInfo;
 	strInfo.Format(_T("channel state:%d, code:%d"), state, code);
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
+	if (state == RELAY_STATE_RUNNING)
+		m_relayPlanner.OnRelayRunning(RelayNowMs());
+	else if (state == RELAY_STATE_FAILURE) {
+		//these name a destination, the planner backs off the one it added last.
+		bool destinationFault = code == RELAY_ERROR_FAILED_JOIN_DEST
+			|| code == RELAY_ERROR_FAILED_PACKET_SENT_TO_DEST
+			|| code == RELAY_ERROR_DEST_TOKEN_EXPIRED;
+		m_relayPlanner.OnRelayFailed(destinationFault, RelayNowMs());
+		LogRelayStatus();
+	}
+	TickRelay();
 	return TRUE;
 }
 
@@ -443,6 +513,20 @@ LRESULT CAgoraCrossChannelDlg::OnEIDChannelMediaRelayEvent(WPARAM wParam, LPARAM
 	CString strInfo;
 	strInfo.Format(_T("channel media event:%d"), evt);
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
+	switch (evt) {
+	case RELAY_EVENT_PACKET_UPDATE_DEST_CHANNEL:
+	case RELAY_EVENT_PACKET_UPDATE_DEST_CHANNEL_NOT_CHANGE:
+		m_relayPlanner.OnUpdateAccepted(RelayNowMs());
+		break;
+	case RELAY_EVENT_PACKET_UPDATE_DEST_CHANNEL_REFUSED:
+	case RELAY_EVENT_PACKET_UPDATE_DEST_CHANNEL_IS_NULL:
+		m_relayPlanner.OnUpdateRefused(RelayNowMs());
+		break;
+	default:
+		return TRUE;
+	}
+	//changes made while the update was out go now.
+	TickRelay();
 	return TRUE;
 }
 
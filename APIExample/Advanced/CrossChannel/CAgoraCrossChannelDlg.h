@@ -1,5 +1,6 @@
 ﻿#pragma once
 #include "AGVideoWnd.h"
+#include "ChannelRelayPlanner.h"
 
 class CAgoraCrossChannelEventHandler : public IRtcEngineEventHandler
 {
@@ -109,6 +110,27 @@ private:
 	HWND m_hMsgHanlder;
 };
 
+//the relay planner's calls on the engine.
+class CEngineChannelRelayApi : public IChannelRelayApi
+{
+public:
+	void SetEngine(IRtcEngine* engine) { m_rtcEngine = engine; }
+	//the source channel, it must outlive the relay.
+	void SetSource(ChannelMediaInfo* srcInfo) { m_srcInfo = srcInfo; }
+
+	virtual int StartRelay(const std::vector<RelayDestination>& destinations) override;
+	virtual int UpdateRelay(const std::vector<RelayDestination>& destinations) override;
+	virtual int StopRelay() override;
+
+private:
+	//a configuration pointing into destinations.
+	void Build(const std::vector<RelayDestination>& destinations, ChannelMediaRelayConfiguration& cmrc);
+
+	IRtcEngine* m_rtcEngine = nullptr;
+	ChannelMediaInfo* m_srcInfo = nullptr;
+	std::vector<ChannelMediaInfo> m_destInfos;
+};
+
 class CAgoraCrossChannelDlg : public CDialogEx
 {
 	DECLARE_DYNAMIC(CAgoraCrossChannelDlg)
@@ -129,6 +151,9 @@ public:
 	void RenderLocalVideo();
 	//resume window status
 	void ResumeStatus();
+	//let the planner bring the relay to the wanted destinations.
+	void TickRelay();
+	void LogRelayStatus();
 
 
 private:
@@ -136,11 +161,18 @@ private:
 	bool m_initialize = false;
 	bool m_startMediaRelay = false;
 	IRtcEngine* m_rtcEngine = nullptr;
+	CAgoraEngineLease m_engineLease;
 	CAGVideoWnd m_localVideoWnd;
 	CAgoraCrossChannelEventHandler m_eventHandler;
-	std::vector<ChannelMediaInfo> m_vecChannelMedias;
 	ChannelMediaInfo * m_srcInfo;
-	
+	CEngineChannelRelayApi m_relayApi;
+	CChannelRelayPlanner m_relayPlanner;
+
+	enum {
+		RELAY_TIMER_ID = 1001,
+		//retries and answer timeouts are checked this often.
+		RELAY_TIMER_MS = 500,
+	};
 
 protected:
 	virtual void DoDataExchange(CDataExchange* pDX);   
@@ -181,4 +213,5 @@ public:
 	afx_msg void OnSelchangeListInfoBroadcasting();
 	CButton m_btnUpdate;
 	afx_msg void OnBnClickedButtonUpdate();
+	afx_msg void OnTimer(UINT_PTR nIDEvent);
 };
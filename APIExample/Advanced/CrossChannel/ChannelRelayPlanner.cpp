@@ -0,0 +1,350 @@
+#include "ChannelRelayPlanner.h"
+#include <algorithm>
+//no stdafx.h, the planner is tested against a mock relay.
+
+CChannelRelayPlanner::CChannelRelayPlanner(IChannelRelayApi* api)
+	: m_api(api)
+	, m_random(m_config.seed)
+{
+}
+
+void CChannelRelayPlanner::SetConfig(const RelayPlannerConfig& config)
+{
+	m_config = config;
+	if (m_config.maxDestinations < 1)
+		m_config.maxDestinations = 1;
+	if (m_config.backoffMaxMs < m_config.backoffMinMs)
+		m_config.backoffMaxMs = m_config.backoffMinMs;
+	m_random.seed(m_config.seed);
+}
+
+int CChannelRelayPlanner::FindWanted(const std::string& channel) const
+{
+	for (size_t i = 0; i < m_wanted.size(); ++i) {
+		if (m_wanted[i].destination.channel == channel)
+			return (int)i;
+	}
+	return -1;
+}
+
+int CChannelRelayPlanner::FindIn(const std::vector<RelayDestination>& list, const std::string& channel)
+{
+	for (size_t i = 0; i < list.size(); ++i) {
+		if (list[i].channel == channel)
+			return (int)i;
+	}
+	return -1;
+}
+
+bool CChannelRelayPlanner::SameSet(const std::vector<RelayDestination>& a, const std::vector<RelayDestination>& b)
+{
+	if (a.size() != b.size())
+		return false;
+	for (const RelayDestination& destination : a) {
+		int i = FindIn(b, destination.channel);
+		if (i < 0 || b[i].uid != destination.uid || b[i].token != destination.token)
+			return false;
+	}
+	return true;
+}
+
+void CChannelRelayPlanner::SetDestination(const RelayDestination& destination)
+{
+	int i = FindWanted(destination.channel);
+	if (i < 0) {
+		Wanted wanted;
+		wanted.destination = destination;
+		wanted.order = m_nextOrder++;
+		m_wanted.push_back(wanted);
+		++m_stats.changes;
+		return;
+	}
+	Wanted& wanted = m_wanted[i];
+	if (wanted.destination.uid != destination.uid || wanted.destination.token != destination.token) {
+		//a new token or uid is what fixes most failed joins, try it now.
+		wanted.failures = 0;
+		wanted.retryAtMs = 0;
+		wanted.suspect = false;
+		++m_stats.changes;
+	}
+	else if (wanted.destination.priority != destination.priority)
+		++m_stats.changes;
+	wanted.destination = destination;
+}
+
+bool CChannelRelayPlanner::RemoveDestination(const std::string& channel)
+{
+	int i = FindWanted(channel);
+	if (i < 0)
+		return false;
+	m_wanted.erase(m_wanted.begin() + i);
+	++m_stats.changes;
+	return true;
+}
+
+void CChannelRelayPlanner::ClearDestinations()
+{
+	if (!m_wanted.empty())
+		++m_stats.changes;
+	m_wanted.clear();
+}
+
+void CChannelRelayPlanner::SetEnabled(bool enabled)
+{
+	if (enabled && !m_enabled) {
+		//a fresh start does not wait out the last session's backoff.
+		m_failures = 0;
+		m_retryAtMs = 0;
+	}
+	m_enabled = enabled;
+}
+
+std::vector<RelayDestination> CChannelRelayPlanner::Plan(int64_t nowMs) const
+{
+	std::vector<const Wanted*> ranked;
+	for (const Wanted& wanted : m_wanted) {
+		if (wanted.retryAtMs <= nowMs)
+			ranked.push_back(&wanted);
+	}
+	std::stable_sort(ranked.begin(), ranked.end(), [this](const Wanted* a, const Wanted* b) {
+		if (a->destination.priority != b->destination.priority)
+			return a->destination.priority > b->destination.priority;
+		bool aActive = FindIn(m_active, a->destination.channel) >= 0;
+		bool bActive = FindIn(m_active, b->destination.channel) >= 0;
+		if (aActive != bActive)
+			return aActive;
+		return a->order < b->order;
+	});
+
+	//one suspect per call, so a failure has a single culprit.
+	std::vector<RelayDestination> plan;
+	bool suspectAdded = false;
+	for (const Wanted* wanted : ranked) {
+		if ((int)plan.size() >= m_config.maxDestinations)
+			break;
+		if (wanted->suspect && FindIn(m_active, wanted->destination.channel) < 0) {
+			if (suspectAdded)
+				continue;
+			suspectAdded = true;
+		}
+		plan.push_back(wanted->destination);
+	}
+	return plan;
+}
+
+int64_t CChannelRelayPlanner::Backoff(int failures)
+{
+	int64_t delay = m_config.backoffMinMs;
+	for (int i = 1; i < failures && delay < m_config.backoffMaxMs; ++i)
+		delay *= 2;
+	delay = (std::min)(delay, m_config.backoffMaxMs);
+	if (m_config.backoffJitter > 0) {
+		std::uniform_real_distribution<double> jitter(-m_config.backoffJitter, m_config.backoffJitter);
+		delay += (int64_t)(delay * jitter(m_random));
+	}
+	return (std::max)(delay, (int64_t)0);
+}
+
+void CChannelRelayPlanner::Commit(int64_t nowMs)
+{
+	for (const RelayDestination& destination : m_sent) {
+		int i = FindWanted(destination.channel);
+		if (i >= 0 && FindIn(m_active, destination.channel) < 0)
+			m_wanted[i].probationEndMs = nowMs + m_config.probationMs;
+	}
+	m_active = m_sent;
+	m_sent.clear();
+	m_inFlight = false;
+	m_failures = 0;
+	m_retryAtMs = 0;
+}
+
+void CChannelRelayPlanner::Retry(int64_t nowMs, bool relayStopped)
+{
+	++m_failures;
+	m_retryAtMs = nowMs + Backoff(m_failures);
+	m_inFlight = false;
+	m_sent.clear();
+	if (relayStopped) {
+		m_relay = RELAY_STOPPED;
+		m_active.clear();
+	}
+}
+
+void CChannelRelayPlanner::OnRelayRunning(int64_t nowMs)
+{
+	if (m_relay != RELAY_STARTING || !m_inFlight)
+		return;
+	m_relay = RELAY_RUNNING;
+	Commit(nowMs);
+}
+
+void CChannelRelayPlanner::OnUpdateAccepted(int64_t nowMs)
+{
+	if (m_relay == RELAY_RUNNING && m_inFlight)
+		Commit(nowMs);
+}
+
+void CChannelRelayPlanner::OnUpdateRefused(int64_t nowMs)
+{
+	if (m_relay != RELAY_RUNNING || !m_inFlight)
+		return;
+	++m_stats.refused;
+	//the relay keeps what it had.
+	Retry(nowMs, false);
+}
+
+void CChannelRelayPlanner::OnRelayFailed(bool destinationFault, int64_t nowMs)
+{
+	if (m_relay == RELAY_STOPPED)
+		return;
+	++m_stats.failures;
+	//destinations the relay took on last: added by the call in flight or
+	//still on probation.
+	std::vector<int> blamed;
+	int suspect = -1;
+	int64_t suspectAddedMs = 0;
+	if (destinationFault) {
+		for (size_t i = 0; i < m_wanted.size(); ++i) {
+			const std::string& channel = m_wanted[i].destination.channel;
+			bool adding = m_inFlight && FindIn(m_sent, channel) >= 0 && FindIn(m_active, channel) < 0;
+			bool probation = m_wanted[i].probationEndMs > nowMs && FindIn(m_active, channel) >= 0;
+			if (!adding && !probation)
+				continue;
+			blamed.push_back((int)i);
+			//the suspect added last is the likely culprit.
+			int64_t addedMs = adding ? INT64_MAX : m_wanted[i].probationEndMs;
+			if (m_wanted[i].suspect && (suspect < 0 || addedMs > suspectAddedMs)) {
+				suspect = (int)i;
+				suspectAddedMs = addedMs;
+			}
+		}
+	}
+	if (suspect >= 0)
+		blamed.assign(1, suspect);
+	if (m_api) {
+		//a failed relay has to be stopped before it can start again.
+		m_api->StopRelay();
+		++m_stats.stops;
+	}
+	if (blamed.empty()) {
+		Retry(nowMs, true);
+		return;
+	}
+	if (blamed.size() == 1) {
+		Wanted& wanted = m_wanted[blamed[0]];
+		++wanted.failures;
+		wanted.retryAtMs = nowMs + Backoff(wanted.failures);
+		wanted.suspect = false;
+		wanted.probationEndMs = 0;
+		++m_stats.destinationBackoffs;
+	}
+	else {
+		for (int i : blamed) {
+			m_wanted[i].suspect = true;
+			m_wanted[i].probationEndMs = 0;
+		}
+	}
+	//the others restart right away.
+	m_relay = RELAY_STOPPED;
+	m_active.clear();
+	m_inFlight = false;
+	m_sent.clear();
+}
+
+bool CChannelRelayPlanner::Tick(int64_t nowMs)
+{
+	if (!m_api)
+		return false;
+	//destinations that made it through probation are trusted again.
+	for (Wanted& wanted : m_wanted) {
+		if (wanted.probationEndMs && nowMs >= wanted.probationEndMs) {
+			wanted.probationEndMs = 0;
+			wanted.suspect = false;
+			wanted.failures = 0;
+		}
+	}
+	if (!m_enabled || (m_wanted.empty() && !m_inFlight)) {
+		if (m_relay == RELAY_STOPPED)
+			return false;
+		m_api->StopRelay();
+		++m_stats.stops;
+		m_relay = RELAY_STOPPED;
+		m_active.clear();
+		m_inFlight = false;
+		m_sent.clear();
+		return true;
+	}
+	if (m_inFlight) {
+		if (nowMs - m_sentAtMs < m_config.ackTimeoutMs)
+			return false;
+		++m_stats.timeouts;
+		if (m_relay == RELAY_STARTING) {
+			//half started, clean up before the next try.
+			m_api->StopRelay();
+			++m_stats.stops;
+		}
+		Retry(nowMs, m_relay == RELAY_STARTING);
+		return true;
+	}
+	if (nowMs < m_retryAtMs)
+		return false;
+
+	std::vector<RelayDestination> plan = Plan(nowMs);
+	if (plan.empty()) {
+		//everything wanted is in backoff.
+		if (m_relay == RELAY_STOPPED)
+			return false;
+		m_api->StopRelay();
+		++m_stats.stops;
+		m_relay = RELAY_STOPPED;
+		m_active.clear();
+		return true;
+	}
+	if (m_relay == RELAY_RUNNING && SameSet(plan, m_active))
+		return false;
+
+	bool start = m_relay == RELAY_STOPPED;
+	int ret = start ? m_api->StartRelay(plan) : m_api->UpdateRelay(plan);
+	if (start)
+		++m_stats.starts;
+	else
+		++m_stats.updates;
+	if (ret != 0) {
+		++m_stats.failures;
+		Retry(nowMs, start);
+		return true;
+	}
+	if (start)
+		m_relay = RELAY_STARTING;
+	m_inFlight = true;
+	m_sent = plan;
+	m_sentAtMs = nowMs;
+	return true;
+}
+
+std::vector<RelayDestinationStatus> CChannelRelayPlanner::GetStatus(int64_t nowMs) const
+{
+	std::vector<RelayDestinationStatus> status;
+	for (const Wanted& wanted : m_wanted) {
+		RelayDestinationStatus item;
+		item.destination = wanted.destination;
+		item.failures = wanted.failures;
+		item.retryAtMs = wanted.retryAtMs;
+		const std::string& channel = wanted.destination.channel;
+		int active = FindIn(m_active, channel);
+		int sent = m_inFlight ? FindIn(m_sent, channel) : -1;
+		if (wanted.retryAtMs > nowMs)
+			item.state = RELAY_DESTINATION_BACKOFF;
+		else if (sent >= 0 && (active < 0 || !SameSet({ m_sent[sent] }, { m_active[active] })))
+			item.state = RELAY_DESTINATION_PENDING;
+		else if (active >= 0)
+			item.state = RELAY_DESTINATION_ACTIVE;
+		else if (wanted.suspect)
+			item.state = RELAY_DESTINATION_SUSPECT;
+		else
+			item.state = RELAY_DESTINATION_WAITING;
+		status.push_back(item);
+	}
+	return status;
+}
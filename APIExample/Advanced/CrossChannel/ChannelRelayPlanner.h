@@ -0,0 +1,166 @@
+#pragma once
+#include <random>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+//one destination channel of the media relay.
+struct RelayDestination {
+	std::string channel;
+	std::string token;
+	unsigned int uid = 0;
+	//when there are more destinations than the relay takes, higher
+	//priorities go first, then the ones already relayed, then the oldest.
+	int priority = 0;
+};
+
+//the relay calls the planner makes: the engine in the dialog, a mock in tests.
+class IChannelRelayApi
+{
+public:
+	virtual ~IChannelRelayApi() {}
+	//0 or an error code, like the engine methods.
+	virtual int StartRelay(const std::vector<RelayDestination>& destinations) = 0;
+	virtual int UpdateRelay(const std::vector<RelayDestination>& destinations) = 0;
+	virtual int StopRelay() = 0;
+};
+
+enum RELAY_DESTINATION_STATE {
+	//wanted, but the relay is stopped or full with higher ranked ones.
+	RELAY_DESTINATION_WAITING = 0,
+	//in a start or update that has not been acknowledged yet.
+	RELAY_DESTINATION_PENDING,
+	RELAY_DESTINATION_ACTIVE,
+	//one of several destinations added together when the relay failed;
+	//they are added back one per call to find which one was at fault.
+	RELAY_DESTINATION_SUSPECT,
+	//failed on its own, waits for its retry time.
+	RELAY_DESTINATION_BACKOFF,
+};
+
+struct RelayDestinationStatus {
+	RelayDestination destination;
+	RELAY_DESTINATION_STATE state = RELAY_DESTINATION_WAITING;
+	int failures = 0;
+	//for RELAY_DESTINATION_BACKOFF.
+	int64_t retryAtMs = 0;
+};
+
+struct RelayPlannerConfig {
+	//destinations per relay, the SDK takes up to 4.
+	int maxDestinations = 4;
+	//retry delays double from backoffMinMs up to backoffMaxMs, each varied
+	//by up to +-backoffJitter so many clients do not retry in step.
+	int64_t backoffMinMs = 1000;
+	int64_t backoffMaxMs = 60000;
+	double backoffJitter = 0.2;
+	//a start or update without an answer for this long failed.
+	int64_t ackTimeoutMs = 10000;
+	//destinations just added are blamed for a relay failure within this time.
+	int64_t probationMs = 5000;
+	uint32_t seed = 1;
+};
+
+struct RelayPlannerStats {
+	uint64_t starts = 0;
+	uint64_t updates = 0;
+	uint64_t stops = 0;
+	//changes to the wanted set, and how many calls they took.
+	uint64_t changes = 0;
+	uint64_t refused = 0;
+	uint64_t timeouts = 0;
+	uint64_t failures = 0;
+	uint64_t destinationBackoffs = 0;
+};
+
+/*
+	Keeps the channel media relay on the wanted destinations. The wanted
+	set changes freely; Tick compares the best destinations that fit the
+	relay with what the relay has and makes at most one call:
+	StartRelay when it is stopped, UpdateRelay when the sets differ,
+	StopRelay when nothing is wanted. Changes made while a call waits for
+	its answer are folded into the next one, so a burst of edits costs one
+	update. Failures are retried with exponential backoff; a failure the
+	relay blames on a destination goes to the destinations the last call
+	added, alone in backoff if it was one, or made suspects and re-added
+	one per call if it was several. No SDK types are used here.
+*/
+class CChannelRelayPlanner
+{
+public:
+	explicit CChannelRelayPlanner(IChannelRelayApi* api = nullptr);
+
+	void SetApi(IChannelRelayApi* api) { m_api = api; }
+	void SetConfig(const RelayPlannerConfig& config);
+
+	//adds a destination or changes its token, uid or priority.
+	void SetDestination(const RelayDestination& destination);
+	bool RemoveDestination(const std::string& channel);
+	void ClearDestinations();
+	//the relay runs only while enabled.
+	void SetEnabled(bool enabled);
+	bool IsEnabled() const { return m_enabled; }
+
+	//answers from the relay.
+	void OnRelayRunning(int64_t nowMs);
+	void OnUpdateAccepted(int64_t nowMs);
+	void OnUpdateRefused(int64_t nowMs);
+	//the relay stopped on an error; destinationFault when the error names
+	//a destination, a failed join or an expired token.
+	void OnRelayFailed(bool destinationFault, int64_t nowMs);
+
+	//call after changes and answers, and from a timer for retries and
+	//timeouts. true if a call was made.
+	bool Tick(int64_t nowMs);
+
+	bool IsRunning() const { return m_relay == RELAY_RUNNING; }
+	//what the relay has acknowledged.
+	const std::vector<RelayDestination>& GetActive() const { return m_active; }
+	std::vector<RelayDestinationStatus> GetStatus(int64_t nowMs) const;
+	const RelayPlannerStats& GetStats() const { return m_stats; }
+
+private:
+	enum RelayState {
+		RELAY_STOPPED = 0,
+		RELAY_STARTING,
+		RELAY_RUNNING,
+	};
+
+	struct Wanted {
+		RelayDestination destination;
+		uint64_t order = 0;
+		int failures = 0;
+		int64_t retryAtMs = 0;
+		bool suspect = false;
+		//end of the probation after it was added to the relay, 0 if past.
+		int64_t probationEndMs = 0;
+	};
+
+	int FindWanted(const std::string& channel) const;
+	static int FindIn(const std::vector<RelayDestination>& list, const std::string& channel);
+	static bool SameSet(const std::vector<RelayDestination>& a, const std::vector<RelayDestination>& b);
+	std::vector<RelayDestination> Plan(int64_t nowMs) const;
+	int64_t Backoff(int failures);
+	//the call in flight is over; what it carried is the relay's now.
+	void Commit(int64_t nowMs);
+	//the relay is gone or refused a call, retry after a backoff.
+	void Retry(int64_t nowMs, bool relayStopped);
+
+	IChannelRelayApi* m_api = nullptr;
+	RelayPlannerConfig m_config;
+	std::mt19937 m_random;
+	bool m_enabled = false;
+	std::vector<Wanted> m_wanted;
+	uint64_t m_nextOrder = 0;
+
+	RelayState m_relay = RELAY_STOPPED;
+	std::vector<RelayDestination> m_active;
+	//the call waiting for an answer.
+	bool m_inFlight = false;
+	std::vector<RelayDestination> m_sent;
+	int64_t m_sentAtMs = 0;
+	//relay wide retries, after refused or failed calls without a culprit.
+	int m_failures = 0;
+	int64_t m_retryAtMs = 0;
+	RelayPlannerStats m_stats;
+};
@@ -2,6 +2,7 @@
 #include "APIExample.h"
 #include "CAgoraCaptureAudioDlg.h"
 #include "DirectShow/CircleBuffer.hpp"
+#include "trace/Trace.h"
 
 IMPLEMENT_DYNAMIC(CAgoraCaptureAduioDlg, CDialogEx)
 
@@ -99,6 +100,7 @@ CAgoraCaptureAduioDlg::CAgoraCaptureAduioDlg(CWnd* pParent /*=nullptr*/)
 
 CAgoraCaptureAduioDlg::~CAgoraCaptureAduioDlg()
 {
+	StopAudioFilePush();
 	if (m_audioFrame.buffer)
 	{
 		delete m_audioFrame.buffer;
@@ -111,20 +113,15 @@ CAgoraCaptureAduioDlg::~CAgoraCaptureAduioDlg()
 */
 bool CAgoraCaptureAduioDlg::InitAgora()
 {
-	//create Agora RTC engine
-	m_rtcEngine = createAgoraRtcEngine();
-	if (!m_rtcEngine) {
-		m_lstInfo.InsertString(m_lstInfo.GetCount() - 1, _T("createAgoraRtcEngine failed"));
-		return false;
-	}
 	//set message notify receiver window
 	m_eventHandler.SetMsgReceiver(m_hWnd);
 	RtcEngineContext context;
 	std::string strAppID = GET_APP_ID;
 	context.appId = strAppID.c_str();
 	context.eventHandler = &m_eventHandler;
-	//initialize the Agora RTC engine context.  
-	int ret = m_rtcEngine->initialize(context);
+	//borrow the shared engine, this registers our event handler.
+	int ret = m_engineLease.Acquire(context);
+	m_rtcEngine = m_engineLease.GetEngine();
 	mediaEngine.queryInterface(m_rtcEngine, agora::AGORA_IID_MEDIA_ENGINE);
 	if (ret != 0) {
 		m_initialize = false;
@@ -168,9 +165,10 @@ void CAgoraCaptureAduioDlg::UnInitAgora()
 		m_rtcEngine->disableVideo();
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("disableVideo"));
 		m_agAudioCaptureDevice.Stop();
+		StopAudioFilePush();
 		mediaEngine->release();
-		//release engine.
-		m_rtcEngine->release(true);
+		//give the engine back to the host.
+		m_engineLease.Release();
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("release rtc engine"));
 		m_rtcEngine = NULL;
 	}
@@ -273,29 +271,68 @@ void CAgoraCaptureAduioDlg::EnableCaputre(BOOL bEnable) {
 		return;
 	if (bEnable)
 	{
-		//select media capture.
-		m_agAudioCaptureDevice.SelectMediaCap(m_cmbAudioType.GetCurSel());
-		//get current audio capture format.
-		m_agAudioCaptureDevice.GetCurrentAudioCap(&waveFormat);
-		nBufferSize = waveFormat.nAvgBytesPerSec / AUDIO_CALLBACK_TIMES;
-		//create capture Buffer.
-		m_agAudioCaptureDevice.SetCaptureBuffer(nBufferSize, 16, waveFormat.nBlockAlign);
+		if (IsAudioFileSelected()) {
+			if (!m_audioFileReader.IsOpen())
+				return;
+			//the file is resampled to the external audio source format like a device.
+			const AudioFileFormat& fileFormat = m_audioFileReader.GetFormat();
+			if (!m_resampler.Init(fileFormat.sampleRate, fileFormat.channels,
+				m_capAudioInfo.sampleRate, m_capAudioInfo.channels))
+				return;
+		}
+		else {
+			//select media capture.
+			m_agAudioCaptureDevice.SelectMediaCap(m_cmbAudioType.GetCurSel());
+			//get current audio capture format.
+			m_agAudioCaptureDevice.GetCurrentAudioCap(&waveFormat);
+			nBufferSize = waveFormat.nAvgBytesPerSec / AUDIO_CALLBACK_TIMES;
+			//create capture Buffer.
+			m_agAudioCaptureDevice.SetCaptureBuffer(nBufferSize, 16, waveFormat.nBlockAlign);
+			//the external audio source was set with m_capAudioInfo, resample
+			//whatever the device delivers to that format.
+			if (!m_resampler.Init(waveFormat.nSamplesPerSec, waveFormat.nChannels,
+				m_capAudioInfo.sampleRate, m_capAudioInfo.channels))
+				return;
+		}
 		m_audioFrame.avsync_type = 0;
 		m_audioFrame.bytesPerSample = 2;
 		m_audioFrame.type = IAudioFrameObserver::FRAME_TYPE_PCM16;
-		m_audioFrame.channels = waveFormat.nChannels;
-		m_audioFrame.samplesPerSec = waveFormat.nSamplesPerSec;
+		m_audioFrame.channels = m_capAudioInfo.channels;
+		m_audioFrame.samplesPerSec = m_capAudioInfo.sampleRate;
 		m_audioFrame.samples = m_audioFrame.samplesPerSec / 100;
+		//trace the run from its first frame.
+		CTracer::GetInstance()->Clear();
+		CTracer::GetInstance()->SetEnabled(true);
 		
-		//create audio capture filter.
-		if (!m_agAudioCaptureDevice.CreateCaptureFilter())
-			return;
-		//start audio capture.
-		m_agAudioCaptureDevice.Start();
+		if (IsAudioFileSelected()) {
+			//loop the file from its start.
+			m_audioFileReader.SetLoop(true);
+			m_audioFileReader.Seek(0);
+			m_audioFilePushing = true;
+			m_audioFileThread = std::thread(PushAudioFileThread, this);
+		}
+		else {
+			//create audio capture filter.
+			if (!m_agAudioCaptureDevice.CreateCaptureFilter())
+				return;
+			//start audio capture.
+			m_agAudioCaptureDevice.Start();
+		}
 	}
 	else {
 		//stop audio capture.
 		m_agAudioCaptureDevice.Stop();
+		StopAudioFilePush();
+		CTracer::GetInstance()->SetEnabled(false);
+		TraceStats traceStats = CTracer::GetInstance()->GetStats();
+		//open it in chrome://tracing or ui.perfetto.dev.
+		CString strTracePath = GetExePath() + _T("\\captureAudioTrace.json");
+		if (traceStats.records > 0 && CTracer::GetInstance()->WriteChromeTrace(cs2utf8(strTracePath))) {
+			CString strInfo;
+			strInfo.Format(_T("trace: %I64u events, %I64u overwritten, %s"),
+				traceStats.records, traceStats.overwritten, strTracePath);
+			m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
+		}
 	}
 	m_extenalCaptureAudio = !m_extenalCaptureAudio;
 }
@@ -303,18 +340,78 @@ void CAgoraCaptureAduioDlg::EnableCaputre(BOOL bEnable) {
 void CAgoraCaptureAduioDlg::PushAudioFrame(uint8_t* data, int size, uint64_t ts)
 {
 	if (m_extenalCaptureAudio && mediaEngine) {
-		memcpy(m_audioFrame.buffer, data, size);
+		int inSamples = size / (m_resampler.GetInChannels() * sizeof(int16_t));
+		AG_TRACE_SCOPE1("push", "PushAudioFrame", "samples", inSamples);
+		AG_TRACE_BEGIN1("convert", "Resample", "samples", inSamples);
+		m_resampler.Process((const int16_t*)data, inSamples, (int16_t*)m_audioFrame.buffer, m_audioFrame.samples);
+		AG_TRACE_END("convert", "Resample");
 		m_audioFrame.renderTimeMs = ts;
 		mediaEngine->pushAudioFrame(&m_audioFrame);
 	}
 }
 
+bool CAgoraCaptureAduioDlg::IsAudioFileSelected()
+{
+	int nSel = m_cmbAudioDevice.GetCurSel();
+	return nSel != -1 && nSel == m_cmbAudioDevice.GetCount() - 1;
+}
+
+void CAgoraCaptureAduioDlg::StopAudioFilePush()
+{
+	m_audioFilePushing = false;
+	if (!m_audioFileThread.joinable())
+		return;
+	m_audioFileThread.join();
+	//not from the destructor, the list is gone by then.
+	if (!::IsWindow(m_lstInfo.GetSafeHwnd()))
+		return;
+	AudioFileReaderStats stats = m_audioFileReader.GetStats();
+	CString strInfo;
+	strInfo.Format(_T("audio file: %I64u underruns, %I64u reads, %.2f ms per read, %.2f ms max"),
+		stats.underruns, stats.reads, stats.GetReadMsAverage(), stats.readNsMax / 1e6);
+	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
+}
+
+void CAgoraCaptureAduioDlg::PushAudioFileThread(CAgoraCaptureAduioDlg* self)
+{
+	CAudioFileReader& reader = self->m_audioFileReader;
+	int sampleRate = reader.GetFormat().sampleRate;
+	int channels = reader.GetFormat().channels;
+	//rates like 22050 do not split into whole 10 ms frames: the fraction
+	//carries into the next frame so the resampler gets the exact rate.
+	int remainder = 0;
+	std::vector<int16_t> samples((size_t)(sampleRate / 100 + 1) * channels);
+	//start on a filled read-ahead rather than with an underrun.
+	reader.WaitBuffered(sampleRate / 10, 500);
+	std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+	AG_TRACE_THREAD_NAME("push audio file");
+	while (self->m_audioFilePushing) {
+		int frames = (sampleRate + remainder) / 100;
+		remainder = (sampleRate + remainder) % 100;
+		//an underrun pushes silence, the external source keeps its clock.
+		{
+			AG_TRACE_SCOPE1("capture", "CAudioFileReader::Read", "frames", frames);
+			reader.Read(samples.data(), frames);
+		}
+		AudioFileReaderStats stats = reader.GetStats();
+		AG_TRACE_COUNTER("capture", "audio file buffered frames", stats.bufferedFrames);
+		AG_TRACE_COUNTER("capture", "audio file underruns", stats.underruns);
+		self->PushAudioFrame((uint8_t*)samples.data(), frames * channels * (int)sizeof(int16_t), GetTickCount64());
+		next += std::chrono::milliseconds(10);
+		//do not push a backlog after a stall.
+		if (std::chrono::steady_clock::now() - next > std::chrono::milliseconds(100))
+			next = std::chrono::steady_clock::now();
+		std::this_thread::sleep_until(next);
+	}
+}
+
 void CAgoraCaptureAduioDlg::PushAudioFrameThread(CAgoraCaptureAduioDlg * self)
 {
 	agora::util::AutoPtr<agora::media::IMediaEngine> mediaEngine;
 	//query interface agora::AGORA_IID_MEDIA_ENGINE in the engine.
 	mediaEngine.queryInterface(self->m_rtcEngine, agora::AGORA_IID_MEDIA_ENGINE);
 	int fps = self->m_audioFrame.samplesPerSec / self->m_audioFrame.samples;
+	AG_TRACE_THREAD_NAME("push audio");
 	while (self->m_extenalCaptureAudio) 
 	{
 		SIZE_T nSize = self->m_audioFrame.samples * self->m_audioFrame.channels * self->m_audioFrame.bytesPerSample;
@@ -324,9 +421,8 @@ void CAgoraCaptureAduioDlg::PushAudioFrameThread(CAgoraCaptureAduioDlg * self)
 			Sleep(1);
 			continue;
 		}
-		CString strInfo;
-		strInfo.Format(_T("audio Frame buffer size:%d, readByte:%d, timestamp:%d \n"), nSize, readByte, timestamp);
-		OutputDebugString(strInfo);
+		//a trace point instead of a debug string per frame.
+		AG_TRACE_SCOPE2("push", "PushAudioFrameThread", "readByte", readByte, "timestamp", timestamp);
 		self->m_audioFrame.renderTimeMs = 1000 / fps;
 		mediaEngine->pushAudioFrame(&self->m_audioFrame);
 		Sleep(1000 / fps);
@@ -596,11 +692,11 @@ void CAgoraCaptureAduioDlg::UpdateDevice()
 			m_agAudioCaptureDevice.GetDeviceInfo(nIndex, &agDeviceInfo);
 			m_cmbAudioDevice.InsertString(nIndex, agDeviceInfo.szDeviceName);
 		}
-		if (m_cmbAudioDevice.GetCount() > 0) {
-			m_cmbAudioDevice.SetCurSel(0);
-			OnSelchangeComboCaptureAudioDevice();
-		}
 	}
+	//a WAV or PCM file next to the exe can be pushed instead of a device.
+	m_cmbAudioDevice.InsertString(m_cmbAudioDevice.GetCount(), _T("customAudio.wav"));
+	m_cmbAudioDevice.SetCurSel(0);
+	OnSelchangeComboCaptureAudioDevice();
 }
 
 // resume window status.
@@ -648,6 +744,26 @@ void CAgoraCaptureAduioDlg::OnSelchangeComboCaptureAudioDevice()
 	BOOL bSuccess = m_agAudioCaptureDevice.GetCurrentDevice(szDevicePath, &nPathLen);
 	if (bSuccess)
 		m_agAudioCaptureDevice.CloseDevice();
+	//like closing the device, this stops a running file push.
+	StopAudioFilePush();
+
+	if (IsAudioFileSelected()) {
+		m_cmbAudioType.ResetContent();
+		//a headerless file is taken as the external audio source format.
+		AudioFileFormat rawFormat;
+		rawFormat.sampleRate = m_capAudioInfo.sampleRate;
+		rawFormat.channels = m_capAudioInfo.channels;
+		if (m_audioFileReader.Open(cs2utf8(GetExePath() + _T("\\customAudio.wav")), &rawFormat)) {
+			const AudioFileFormat& format = m_audioFileReader.GetFormat();
+			strInfo.Format(_T("%.1fkHz %dbits %dCh"), format.sampleRate / 1000.0, format.GetBytesPerSample() * 8, format.channels);
+		}
+		else
+			strInfo = _T("customAudio.wav not found");
+		m_cmbAudioType.InsertString(0, strInfo);
+		m_cmbAudioType.SetCurSel(0);
+		return;
+	}
+	m_audioFileReader.Close();
 
 	if (nSel != -1)
 		if (!m_agAudioCaptureDevice.OpenDevice(nSel))return;
@@ -4,6 +4,10 @@
 #include "DirectShow/AGDShowAudioCapture.h"
 #include <IAgoraMediaEngine.h>
 #include "dsound/DSoundRender.h"
+#include "dsp/AudioResampler.h"
+#include "capture/AudioFileReader.h"
+#include <atomic>
+#include <thread>
 
 
 class CAgoraCaptureAduioDlgEngineEventHandler : public IRtcEngineEventHandler {
@@ -130,6 +134,9 @@ public:
 	// if bEnable is true start capture otherwise stop capture.
 	void EnableCaputre(BOOL bEnable);
 	void PushAudioFrame(uint8_t* data, int size, uint64_t ts);
+	// the last entry of the device list is the audio file next to the exe.
+	bool IsAudioFileSelected();
+	void StopAudioFilePush();
 
 
 	bool m_joinChannel = false;
@@ -138,6 +145,7 @@ public:
 	bool m_extenalCaptureAudio = false;
 	bool m_extenalRenderAudio = false;
     IRtcEngine* m_rtcEngine = nullptr;
+    CAgoraEngineLease m_engineLease;
 	agora::util::AutoPtr<agora::media::IMediaEngine> mediaEngine;
 	
 	CAGVideoWnd m_localVideoWnd;
@@ -146,6 +154,12 @@ public:
 	AudioInfo									m_capAudioInfo;
 	AudioInfo									m_renderAudioInfo;
 	IAudioFrameObserver::AudioFrame				m_audioFrame;
+	//converts the capture device format to m_capAudioInfo.
+	CAudioResampler								m_resampler;
+	//streams customAudio.wav when it is picked instead of a device.
+	CAudioFileReader							m_audioFileReader;
+	std::thread									m_audioFileThread;
+	std::atomic<bool>							m_audioFilePushing{ false };
 	DSoundRender								m_audioRender;
 
 	enum { IDD = IDD_DIALOG_CUSTOM_CAPTURE_AUDIO };
@@ -154,6 +168,8 @@ protected:
 	//push audio frame in work thread.
 	static void PushAudioFrameThread(CAgoraCaptureAduioDlg* self);
 	static void PullAudioFrameThread(CAgoraCaptureAduioDlg* self);
+	//push the audio file in 10 ms frames.
+	static void PushAudioFileThread(CAgoraCaptureAduioDlg* self);
 	virtual void DoDataExchange(CDataExchange* pDX);   
 	afx_msg void OnBnClickedButtonJoinchannel();
 	//set external audio capture click handler.
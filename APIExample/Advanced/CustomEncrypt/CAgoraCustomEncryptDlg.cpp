@@ -56,12 +56,6 @@ void CAgoraCustomEncryptDlg::InitCtrlText()
 //Initialize the Agora SDK
 bool CAgoraCustomEncryptDlg::InitAgora()
 {
-	//create Agora RTC engine
-	m_rtcEngine = createAgoraRtcEngine();
-	if (!m_rtcEngine) {
-		m_lstInfo.InsertString(m_lstInfo.GetCount() - 1, _T("createAgoraRtcEngine failed"));
-		return false;
-	}
 	//set message notify receiver window
 	m_eventHandler.SetMsgReceiver(m_hWnd);
 
@@ -69,8 +63,9 @@ bool CAgoraCustomEncryptDlg::InitAgora()
 	std::string strAppID = GET_APP_ID;
 	context.appId = strAppID.c_str();
 	context.eventHandler = &m_eventHandler;
-	//initialize the Agora RTC engine context.
-	int ret = m_rtcEngine->initialize(context);
+	//borrow the shared engine, this registers our event handler.
+	int ret = m_engineLease.Acquire(context);
+	m_rtcEngine = m_engineLease.GetEngine();
 	if (ret != 0) {
 		m_initialize = false;
 		CString strInfo;
@@ -107,8 +102,8 @@ void CAgoraCustomEncryptDlg::UnInitAgora()
 		//disable video in the engine.
 		m_rtcEngine->disableVideo();
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("disableVideo"));
-		//release engine.
-		m_rtcEngine->release(true);
+		//give the engine back to the host.
+		m_engineLease.Release();
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("release rtc engine"));
 		m_rtcEngine = NULL;
 	}
@@ -222,13 +217,13 @@ void CAgoraCustomEncryptDlg::OnBnClickedButtonSetCustomEncrypt()
 		CString strInfo;
 		CString strEncryptMode;
 		m_cmbEncrypt.GetWindowText(strEncryptMode);
-		m_rtcEngine->registerPacketObserver(m_mapPacketObserver[strEncryptMode]);
+		m_engineLease.RegisterPacketObserver(m_mapPacketObserver[strEncryptMode]);
 		strInfo.Format(_T("register:%s"), strEncryptMode);
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
 		m_btnSetEncrypt.SetWindowText(customEncryptCtrlCancelEncrypt);
 	}
 	else {
-		m_rtcEngine->registerPacketObserver(NULL);
+		m_engineLease.RegisterPacketObserver(NULL);
 		m_lstInfo.InsertString(m_lstInfo.GetCount(),_T("unregister success."));
 		m_btnSetEncrypt.SetWindowText(customEncryptCtrlSetEncrypt);
 	}
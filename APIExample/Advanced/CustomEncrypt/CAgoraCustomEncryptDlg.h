@@ -195,6 +195,7 @@ private:
 	bool m_initialize = false;
 	bool m_setEncrypt = false;
 	IRtcEngine* m_rtcEngine = nullptr;
+	CAgoraEngineLease m_engineLease;
 	CAGVideoWnd m_localVideoWnd;
 	CAgoraCustomEncryptHandler m_eventHandler;
 	AgoraPacketObserver m_customPacketObserver;
@@ -1,6 +1,7 @@
 ﻿#include "stdafx.h"
 #include "APIExample.h"
 #include "CAgoraCaptureVideoDlg.h"
+#include "trace/Trace.h"
 #include <dsound.h>
 
 BEGIN_MESSAGE_MAP(CAgoraCaptureVideoDlg, CDialogEx)
@@ -13,6 +14,7 @@ BEGIN_MESSAGE_MAP(CAgoraCaptureVideoDlg, CDialogEx)
 	ON_BN_CLICKED(IDC_BUTTON_START_CAPUTRE, &CAgoraCaptureVideoDlg::OnClickedButtonStartCaputre)
 	ON_BN_CLICKED(IDC_BUTTON_JOINCHANNEL, &CAgoraCaptureVideoDlg::OnClickedButtonJoinchannel)
 	ON_CBN_SELCHANGE(IDC_COMBO_CAPTURE_VIDEO_DEVICE, &CAgoraCaptureVideoDlg::OnSelchangeComboCaptureVideoDevice)
+	ON_CBN_SELCHANGE(IDC_COMBO_CAPTURE_TARGET, &CAgoraCaptureVideoDlg::OnSelchangeComboCaptureTarget)
 END_MESSAGE_MAP()
 
 
@@ -30,12 +32,6 @@ void CAgoraCaptureVideoDlg::InitCtrlText()
 */
 bool CAgoraCaptureVideoDlg::InitAgora()
 {
-	//create Agora RTC engine
-	m_rtcEngine = createAgoraRtcEngine();
-	if (!m_rtcEngine) {
-		m_lstInfo.InsertString(m_lstInfo.GetCount() - 1, _T("createAgoraRtcEngine failed"));
-		return false;
-	}
 	//set message notify receiver window
 	m_eventHandler.SetMsgReceiver(m_hWnd);
 
@@ -43,8 +39,9 @@ bool CAgoraCaptureVideoDlg::InitAgora()
 	std::string strAppID = GET_APP_ID;
 	context.appId = strAppID.c_str();
 	context.eventHandler = &m_eventHandler;
-	//initialize the Agora RTC engine context.
-	int ret = m_rtcEngine->initialize(context);
+	//borrow the shared engine, this registers our event handler.
+	int ret = m_engineLease.Acquire(context);
+	m_rtcEngine = m_engineLease.GetEngine();
 	if (ret != 0) {
 		m_initialize = false;
 		CString strInfo;
@@ -72,6 +69,7 @@ void CAgoraCaptureVideoDlg::UnInitAgora()
 {
 	m_cmbVideoDevice.EnableWindow(TRUE);
 	m_cmbVideoType.EnableWindow(TRUE);
+	m_cmbCaptureTarget.EnableWindow(TRUE);
 	m_btnSetExtCapture.EnableWindow(TRUE);
 	if (m_rtcEngine) {
 		if (m_joinChannel)
@@ -84,8 +82,8 @@ void CAgoraCaptureVideoDlg::UnInitAgora()
 		//disable video in the engine.
 		m_rtcEngine->disableVideo();
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("disableVideo"));
-		//release engine.
-		m_rtcEngine->release(true);
+		//give the engine back to the host.
+		m_engineLease.Release();
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("release rtc engine"));
 		m_rtcEngine = NULL;
 	}
@@ -115,6 +113,43 @@ void CAgoraCaptureVideoDlgEngineEventHandler::onRemoteVideoStateChanged(uid_t ui
 	}
 }
 
+namespace {
+	//what the format is negotiated for, the entries of m_cmbCaptureTarget.
+	const struct {
+		LPCTSTR name;
+		int width;
+		int height;
+		int fps;
+	} CAPTURE_TARGETS[] = {
+		{ _T("640*360 15fps"), 640, 360, 15 },
+		{ _T("640*480 30fps"), 640, 480, 30 },
+		{ _T("1280*720 30fps"), 1280, 720, 30 },
+		{ _T("1920*1080 30fps"), 1920, 1080, 30 },
+	};
+	//1280*720 30fps, what CaptureRequest asks for by default.
+	const int DEFAULT_CAPTURE_TARGET = 2;
+
+	//name of a format in the format list, nullptr for formats it leaves
+	//out. DirectShow RGB24 is bottom-up and never was offered.
+	LPCTSTR GetCaptureFormatName(uint32_t fourcc)
+	{
+		switch (fourcc) {
+		case CAPTURE_FOURCC_I420:
+			return _T("YUV420");
+		case CAPTURE_FOURCC_NV12:
+			return _T("NV12");
+		case CAPTURE_FOURCC_YUY2:
+			return _T("YUY2");
+		case CAPTURE_FOURCC_MJPG:
+			return _T("MJPEG");
+		case CAPTURE_FOURCC_UYVY:
+			return _T("UYVY");
+		default:
+			return nullptr;
+		}
+	}
+}
+
 /*
 	initialize dialog, and set control property.
 */
@@ -125,8 +160,20 @@ BOOL CAgoraCaptureVideoDlg::OnInitDialog()
 	RECT rcArea;
 	m_staVideoArea.GetClientRect(&rcArea);
 	m_localVideoWnd.MoveWindow(&rcArea);
-	//create and initialize video capture object.
-	m_agVideoCaptureDevice.Create();
+	//create the video capture backend.
+	m_captureBackend = CreateCaptureBackend(CAPTURE_BACKEND_DSHOW);
+	for (int i = 0; i < _countof(CAPTURE_TARGETS); i++)
+		m_cmbCaptureTarget.InsertString(i, CAPTURE_TARGETS[i].name);
+	m_cmbCaptureTarget.SetCurSel(DEFAULT_CAPTURE_TARGET);
+	//conversion costs measured on earlier runs.
+	TCHAR szFile[MAX_PATH] = { 0 };
+	GetModuleFileName(NULL, szFile, MAX_PATH);
+	CString strDir = szFile;
+	strDir = strDir.Mid(0, strDir.ReverseFind(_T('\\')) + 1);
+	m_captureCostPath = cs2utf8(strDir + _T("captureCost.txt"));
+	//open it in chrome://tracing or ui.perfetto.dev.
+	m_tracePath = cs2utf8(strDir + _T("captureVideoTrace.json"));
+	m_captureCosts.Load(m_captureCostPath);
 	ResumeStatus();
 	return TRUE;
 }
@@ -165,17 +212,13 @@ void CAgoraCaptureVideoDlg::UpdateViews()
 // enumerate device and show device in combobox.
 void CAgoraCaptureVideoDlg::UpdateDevice()
 {
-	TCHAR				szDevicePath[MAX_PATH] = { 0 };
-	SIZE_T				nPathLen = MAX_PATH;
-	CString				strInfo;
-	AGORA_DEVICE_INFO	agDeviceInfo;
+	std::vector<CaptureDeviceInfo> devices;
 	m_cmbVideoDevice.ResetContent();
 	//enum video capture device.
-	m_agVideoCaptureDevice.EnumDeviceList();
-	for (int nIndex = 0; nIndex < m_agVideoCaptureDevice.GetDeviceCount(); nIndex++) {
-		m_agVideoCaptureDevice.GetDeviceInfo(nIndex, &agDeviceInfo);
-		m_cmbVideoDevice.InsertString(nIndex, agDeviceInfo.szDeviceName);
-	}
+	if (m_captureBackend)
+		m_captureBackend->EnumDevices(devices);
+	for (size_t nIndex = 0; nIndex < devices.size(); nIndex++)
+		m_cmbVideoDevice.InsertString((int)nIndex, utf82cs(devices[nIndex].name));
 	m_cmbVideoDevice.SetCurSel(0);
 	OnSelchangeComboCaptureVideoDevice();
 }
@@ -202,16 +245,22 @@ void CAgoraCaptureVideoDlg::EnableCaputre(BOOL bEnable)
 	if (bEnable)
 	{
 		//select video capture type.
-		m_agVideoCaptureDevice.SelectMediaCap(nIndex == -1 ? 0 : nIndex);
-		VIDEOINFOHEADER videoInfo;
+		if (m_capFormats.empty() || !m_captureBackend)
+			return;
+		//the list is sorted, entries carry their position in m_capFormats.
+		size_t nFormat = nIndex == -1 ? 0 : m_cmbVideoType.GetItemData(nIndex);
+		m_captureFormat = m_capFormats[nFormat];
+		//open the device in the selected format.
+		if (!m_captureBackend->Open(m_cmbVideoDevice.GetCurSel(), m_captureFormat)) {
+			m_lstInfo.InsertString(m_lstInfo.GetCount(),
+				_T("open capture failed: ") + utf82cs(DescribeCaptureFormat(m_captureFormat)));
+			return;
+		}
 		VideoEncoderConfiguration config;
-		//create video capture filter.
-		m_agVideoCaptureDevice.CreateCaptureFilter();
-		m_agVideoCaptureDevice.GetCurrentVideoCap(&videoInfo);
-		config.dimensions.width = videoInfo.bmiHeader.biWidth;
-		config.dimensions.height = videoInfo.bmiHeader.biHeight;
-		m_videoFrame.stride = videoInfo.bmiHeader.biWidth;
-		m_videoFrame.height = videoInfo.bmiHeader.biHeight;
+		config.dimensions.width = m_captureFormat.width;
+		config.dimensions.height = m_captureFormat.height;
+		m_videoFrame.stride = m_captureFormat.width;
+		m_videoFrame.height = m_captureFormat.height;
 		m_videoFrame.rotation = 0;
 		m_videoFrame.cropBottom = 0;
 		m_videoFrame.cropLeft = 0;
@@ -219,20 +268,50 @@ void CAgoraCaptureVideoDlg::EnableCaputre(BOOL bEnable)
 		m_videoFrame.cropTop = 0;
 		m_videoFrame.format = agora::media::ExternalVideoFrame::VIDEO_PIXEL_I420;
 		m_videoFrame.type = agora::media::ExternalVideoFrame::VIDEO_BUFFER_TYPE::VIDEO_BUFFER_RAW_DATA;
-		m_fps = (int)(10000000ll / videoInfo.AvgTimePerFrame);
+		m_fps = m_captureFormat.fps;
 		//set video encoder configuration.
 		m_rtcEngine->setVideoEncoderConfiguration(config);
 		//set render hwnd,image width,image height,identify yuv.
 		m_d3dRender.Init(m_localVideoWnd.GetSafeHwnd(),
-			videoInfo.bmiHeader.biWidth, videoInfo.bmiHeader.biHeight, true);
-		//start video capture.
-		m_agVideoCaptureDevice.Start();
+			m_captureFormat.width, m_captureFormat.height, true);
+		//trace the run from its first frame.
+		CTracer::GetInstance()->Clear();
+		CTracer::GetInstance()->SetEnabled(true);
+		//start video capture, frames arrive as I420 in CAgVideoBuffer.
+		m_captureSink.Start(m_captureFormat, [](const uint8_t* i420, size_t size, int64_t timestampUs, uint64_t sequence) {
+			CAgVideoBuffer::GetInstance()->writeBuffer(const_cast<BYTE*>(i420), (int)size, (int)(timestampUs / 1000), sequence);
+		});
+		m_captureBackend->Start([this](const CaptureFrame& frame) { m_captureSink.Push(frame); });
 	}
 	else {
 		//video capture stop.
-		m_agVideoCaptureDevice.Stop();
-		//remove video capture filter.
-		m_agVideoCaptureDevice.RemoveCaptureFilter();
+		if (m_captureBackend)
+			m_captureBackend->Stop();
+		m_captureSink.Stop();
+		CTracer::GetInstance()->SetEnabled(false);
+		TraceStats traceStats = CTracer::GetInstance()->GetStats();
+		if (traceStats.records > 0 && CTracer::GetInstance()->WriteChromeTrace(m_tracePath)) {
+			CString strInfo;
+			strInfo.Format(_T("trace: %I64u events, %I64u overwritten, %s"),
+				traceStats.records, traceStats.overwritten, utf82cs(m_tracePath));
+			m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
+		}
+		//what the conversions of this run cost, for the next negotiation.
+		long long frames = 0, ns = 0;
+		m_captureSink.GetConvertStats(&frames, &ns);
+		if (frames > 0) {
+			m_captureCosts.Report(m_captureFormat.fourcc,
+				(long long)m_captureFormat.width * m_captureFormat.height, ns, frames);
+			CString strInfo;
+			strInfo.Format(_T("convert %s: %lldus/frame over %lld frames"),
+				utf82cs(DescribeCaptureFormat(m_captureFormat)), ns / frames / 1000, frames);
+			m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
+		}
+		//with what the negotiations measured, the file is only written here.
+		m_captureCosts.Save(m_captureCostPath);
+		//release the device.
+		if (m_captureBackend)
+			m_captureBackend->Close();
 		if (m_rtcEngine)
 		{
 			m_rtcEngine->stopPreview();
@@ -248,13 +327,15 @@ void CAgoraCaptureVideoDlg::PushVideoFrameThread(CAgoraCaptureVideoDlg * self)
 	mediaEngine.queryInterface(self->m_rtcEngine, agora::AGORA_IID_MEDIA_ENGINE);
 	//start preview in the engine.
 	self -> m_rtcEngine->startPreview();
+	AG_TRACE_THREAD_NAME("push video");
 	while (self->m_extenalCaptureVideo && self->m_joinChannel)
 	{
 		if (self->m_videoFrame.format == agora::media::ExternalVideoFrame::VIDEO_PIXEL_I420) {
 			int bufSize = self->m_videoFrame.stride * self->m_videoFrame.height * 3 / 2;
 			int timestamp = GetTickCount();
+			ULONGLONG sequence = 0;
 			//read data from custom capture.
-			if (CAgVideoBuffer::GetInstance()->readBuffer(self->m_buffer, bufSize, timestamp)) {
+			if (CAgVideoBuffer::GetInstance()->readBuffer(self->m_buffer, bufSize, timestamp, sequence)) {
 				self->m_videoFrame.timestamp = timestamp;
 			}
 			else
@@ -263,10 +344,15 @@ void CAgoraCaptureVideoDlg::PushVideoFrameThread(CAgoraCaptureVideoDlg * self)
 				continue;
 			}
 			self->m_videoFrame.buffer = self->m_buffer;
-			//render image buffer to hwnd.
-			self->m_d3dRender.Render((char*)self->m_buffer);
-			//push video frame.
-			mediaEngine->pushVideoFrame(&self->m_videoFrame);
+			{
+				AG_TRACE_SCOPE1("push", "PushVideoFrame", "timestamp", timestamp);
+				//the capture's frame sequence, see CCaptureI420Sink::Push.
+				AG_TRACE_FLOW_END("frame", "video frame", sequence);
+				//render image buffer to hwnd.
+				self->m_d3dRender.Render((char*)self->m_buffer);
+				//push video frame.
+				mediaEngine->pushVideoFrame(&self->m_videoFrame);
+			}
 			Sleep(1000 / self->m_fps);
 		}
 		else {
@@ -376,6 +462,7 @@ LRESULT CAgoraCaptureVideoDlg::OnEIDJoinChannelSuccess(WPARAM wParam, LPARAM lPa
 {
 	m_cmbVideoDevice.EnableWindow(FALSE);
 	m_cmbVideoType.EnableWindow(FALSE);
+	m_cmbCaptureTarget.EnableWindow(FALSE);
 	m_btnSetExtCapture.EnableWindow(FALSE);
 	m_joinChannel = true;
 	m_btnJoinChannel.EnableWindow(TRUE);
@@ -396,6 +483,7 @@ LRESULT CAgoraCaptureVideoDlg::OnEIDLeaveChannel(WPARAM wParam, LPARAM lParam)
 {
 	m_cmbVideoDevice.EnableWindow(TRUE);
 	m_cmbVideoType.EnableWindow(TRUE);
+	m_cmbCaptureTarget.EnableWindow(TRUE);
 	m_btnSetExtCapture.EnableWindow(TRUE);
 	m_joinChannel = false;
 	m_btnJoinChannel.SetWindowText(commonCtrlJoinChannel);
@@ -487,6 +575,7 @@ void CAgoraCaptureVideoDlg::DoDataExchange(CDataExchange* pDX)
 	DDX_Control(pDX, IDC_BUTTON_START_CAPUTRE, m_btnSetExtCapture);
 	DDX_Control(pDX, IDC_COMBO_CAPTURE_VIDEO_DEVICE, m_cmbVideoDevice);
 	DDX_Control(pDX, IDC_COMBO_CAPTURE_VIDEO_TYPE, m_cmbVideoType);
+	DDX_Control(pDX, IDC_COMBO_CAPTURE_TARGET, m_cmbCaptureTarget);
 	DDX_Control(pDX, IDC_LIST_INFO_BROADCASTING, m_lstInfo);
 }
 
@@ -494,55 +583,62 @@ void CAgoraCaptureVideoDlg::DoDataExchange(CDataExchange* pDX)
 //and inserts them into the ComboBox
 void CAgoraCaptureVideoDlg::OnSelchangeComboCaptureVideoDevice()
 {
-	TCHAR	szDevicePath[MAX_PATH] = { 0 };
-	SIZE_T	nPathLen = MAX_PATH;
 	int		nSel = m_cmbVideoDevice.GetCurSel();
-
-	VIDEOINFOHEADER		vidInfoHeader;
-	CString				strInfo;
-	CString				strCompress;
-	//get current device name.
+	CString	strInfo;
+	std::vector<CaptureFormat> formats;
 	m_cmbVideoType.ResetContent();
+	m_capFormats.clear();
+	//open the device and enumerate its formats.
+	if (nSel == -1 || !m_captureBackend || !m_captureBackend->GetFormats(nSel, formats))
+		return;
+	for (const CaptureFormat& format : formats) {
+		LPCTSTR lpszFormat = GetCaptureFormatName(format.fourcc);
+		if (!lpszFormat)
+			continue;
+		strInfo.Format(_T("%d*%d %dfps(%s)"), format.width, format.height, format.fps, lpszFormat);
+		int nItem = m_cmbVideoType.AddString(strInfo);
+		m_cmbVideoType.SetItemData(nItem, m_capFormats.size());
+		m_capFormats.push_back(format);
+	}
+	NegotiateCaptureFormat();
+}
 
-	BOOL bSuccess = m_agVideoCaptureDevice.GetCurrentDevice(szDevicePath, &nPathLen);
-	if (bSuccess)
-		m_agVideoCaptureDevice.CloseDevice();
-
-	if (nSel != -1) {
-		//open device.
-		if (!m_agVideoCaptureDevice.OpenDevice(nSel))
-		{
-			return;
-		}
-		//create capture filter.
-		//m_agVideoCaptureDevice.CreateCaptureFilter();
+CaptureRequest CAgoraCaptureVideoDlg::GetCaptureRequest()
+{
+	CaptureRequest request;
+	int nSel = m_cmbCaptureTarget.GetCurSel();
+	if (nSel >= 0 && nSel < _countof(CAPTURE_TARGETS)) {
+		request.width = CAPTURE_TARGETS[nSel].width;
+		request.height = CAPTURE_TARGETS[nSel].height;
+		request.fps = CAPTURE_TARGETS[nSel].fps;
 	}
-	//enumerate video capture device type. 
-	int count = m_agVideoCaptureDevice.GetMediaCapCount();
-	for (int nIndex = 0; nIndex < count; nIndex++) {
-		m_agVideoCaptureDevice.GetVideoCap(nIndex, &vidInfoHeader);
-		if (vidInfoHeader.bmiHeader.biCompression == 0)continue;
-		switch (vidInfoHeader.bmiHeader.biCompression)
-		{
-		case MAKEFOURCC('I', '4', '2', '0'):
-			strInfo.Format(_T("%d*%d %dfps(YUV420)"), vidInfoHeader.bmiHeader.biWidth, vidInfoHeader.bmiHeader.biHeight, 10000000ll / vidInfoHeader.AvgTimePerFrame);
-			break;
-		case 0x00000000:
-			strInfo.Format(_T("%d*%d %dfps(RGB24)"), vidInfoHeader.bmiHeader.biWidth, vidInfoHeader.bmiHeader.biHeight, 10000000ll / vidInfoHeader.AvgTimePerFrame);
-			break;
-		case MAKEFOURCC('Y', 'U', 'Y', '2'):
-			strInfo.Format(_T("%d*%d %dfps(YUY2)"), vidInfoHeader.bmiHeader.biWidth, vidInfoHeader.bmiHeader.biHeight, 10000000ll / vidInfoHeader.AvgTimePerFrame);
-			break;
-		case MAKEFOURCC('M', 'J', 'P', 'G'):
-			strInfo.Format(_T("%d*%d %dfps(MJPEG)"), vidInfoHeader.bmiHeader.biWidth, vidInfoHeader.bmiHeader.biHeight, 10000000ll / vidInfoHeader.AvgTimePerFrame);
-			break;
-		case MAKEFOURCC('U', 'Y', 'V', 'Y'):
-			strInfo.Format(_T("%d*%d %dfps(UYVY)"), vidInfoHeader.bmiHeader.biWidth, vidInfoHeader.bmiHeader.biHeight, 10000000ll / vidInfoHeader.AvgTimePerFrame);
-			break;
+	return request;
+}
+
+//preselect the format that is cheapest to get into I420 at the size and
+//frame rate of m_cmbCaptureTarget, the list still lets the user pick
+//another one. costs measured here are saved when the capture stops.
+void CAgoraCaptureVideoDlg::NegotiateCaptureFormat()
+{
+	if (m_capFormats.empty())
+		return;
+	CCaptureNegotiator negotiator(m_captureCosts);
+	CaptureNegotiation negotiation = negotiator.Negotiate(m_capFormats, GetCaptureRequest());
+	if (negotiation.valid) {
+		for (int nItem = 0; nItem < m_cmbVideoType.GetCount(); nItem++) {
+			if (m_cmbVideoType.GetItemData(nItem) == (DWORD_PTR)negotiation.chosen.index)
+				m_cmbVideoType.SetCurSel(nItem);
 		}
-		m_cmbVideoType.InsertString(nIndex, strInfo);
+		m_lstInfo.InsertString(m_lstInfo.GetCount(),
+			_T("capture plan: ") + utf82cs(CCaptureNegotiator::DescribePlan(negotiation.chosen)));
 	}
-	m_cmbVideoType.SetCurSel(0);
+	else
+		m_cmbVideoType.SetCurSel(0);
+}
+
+void CAgoraCaptureVideoDlg::OnSelchangeComboCaptureTarget()
+{
+	NegotiateCaptureFormat();
 }
 
 
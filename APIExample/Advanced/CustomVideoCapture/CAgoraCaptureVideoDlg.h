@@ -1,8 +1,11 @@
 ﻿#pragma once
 #include "AGVideoWnd.h"
 #include "DirectShow/AgVideoBuffer.h"
-#include "DirectShow/AGDShowVideoCapture.h"
 #include "d3d/D3DRender.h"
+#include "capture/CaptureBackend.h"
+#include "capture/CaptureI420Sink.h"
+#include "capture/CaptureNegotiator.h"
+#include <memory>
 
 class CAgoraCaptureVideoDlgEngineEventHandler : public IRtcEngineEventHandler {
 public:
@@ -112,6 +115,10 @@ public:
 	void UpdateViews();
 	// enumerate device and show device in combobox.
 	void UpdateDevice();
+	// what m_cmbCaptureTarget asks the camera for.
+	CaptureRequest GetCaptureRequest();
+	// preselect the best format of the device for the request.
+	void NegotiateCaptureFormat();
 	// resume window status.
 	void ResumeStatus();
 	// start or stop capture.
@@ -126,12 +133,25 @@ protected:
 	virtual void DoDataExchange(CDataExchange* pDX);
 
 	CAgoraCaptureVideoDlgEngineEventHandler m_eventHandler;
-	CAGDShowVideoCapture m_agVideoCaptureDevice;
+	//the cameras, through the DirectShow capture backend.
+	std::unique_ptr<ICaptureBackend> m_captureBackend;
+	//converts what the backend delivers into CAgVideoBuffer.
+	CCaptureI420Sink m_captureSink;
+	//conversion costs of this machine, kept next to the exe.
+	CCaptureCostModel m_captureCosts;
+	std::string m_captureCostPath;
+	//the trace of the last capture run.
+	std::string m_tracePath;
+	//formats listed in m_cmbVideoType, an entry's item data is its
+	//position here.
+	std::vector<CaptureFormat> m_capFormats;
+	CaptureFormat m_captureFormat;
 	CAGVideoWnd m_localVideoWnd;
 	agora::media::ExternalVideoFrame m_videoFrame;
 	int m_fps;
 
 	IRtcEngine* m_rtcEngine = nullptr;
+	CAgoraEngineLease m_engineLease;
 	bool m_joinChannel = false;
 	bool m_initialize = false;
 	bool m_remoteJoined = false;
@@ -149,11 +169,13 @@ public:
 	CButton m_btnSetExtCapture;
 	CComboBox m_cmbVideoDevice;
 	CComboBox m_cmbVideoType;
+	CComboBox m_cmbCaptureTarget;
 	CListBox m_lstInfo;
 	virtual BOOL OnInitDialog();
 	afx_msg	void OnShowWindow(BOOL bShow, UINT nStatus);
 	afx_msg void OnClickedButtonStartCaputre();
 	afx_msg void OnClickedButtonJoinchannel();
 	afx_msg void OnSelchangeComboCaptureVideoDevice();
+	afx_msg void OnSelchangeComboCaptureTarget();
 	virtual BOOL PreTranslateMessage(MSG* pMsg);
 };
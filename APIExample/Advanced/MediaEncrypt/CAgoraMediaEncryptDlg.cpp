@@ -43,6 +43,7 @@ BEGIN_MESSAGE_MAP(CAgoraMediaEncryptDlg, CDialogEx)
 	ON_BN_CLICKED(IDC_BUTTON_JOINCHANNEL, &CAgoraMediaEncryptDlg::OnBnClickedButtonJoinchannel)
 	ON_BN_CLICKED(IDC_BUTTON_SET_MEDIA_ENCRYPT, &CAgoraMediaEncryptDlg::OnBnClickedButtonSetMediaEncrypt)
 	ON_LBN_SELCHANGE(IDC_LIST_INFO_BROADCASTING, &CAgoraMediaEncryptDlg::OnSelchangeListInfoBroadcasting)
+	ON_WM_TIMER()
 END_MESSAGE_MAP()
 
 //Initialize the Ctrl Text.
@@ -58,12 +59,6 @@ void CAgoraMediaEncryptDlg::InitCtrlText()
 //Initialize the Agora SDK
 bool CAgoraMediaEncryptDlg::InitAgora()
 {
-	//create Agora RTC engine
-	m_rtcEngine = createAgoraRtcEngine();
-	if (!m_rtcEngine) {
-		m_lstInfo.InsertString(m_lstInfo.GetCount() - 1, _T("createAgoraRtcEngine failed"));
-		return false;
-	}
 	//set message notify receiver window
 	m_eventHandler.SetMsgReceiver(m_hWnd);
 
@@ -71,8 +66,9 @@ bool CAgoraMediaEncryptDlg::InitAgora()
 	std::string strAppID = GET_APP_ID;
 	context.appId = strAppID.c_str();
 	context.eventHandler = &m_eventHandler;
-	//initialize the Agora RTC engine context.
-	int ret = m_rtcEngine->initialize(context);
+	//borrow the shared engine, this registers our event handler.
+	int ret = m_engineLease.Acquire(context);
+	m_rtcEngine = m_engineLease.GetEngine();
 	if (ret != 0) {
 		m_initialize = false;
 		CString strInfo;
@@ -109,8 +105,9 @@ void CAgoraMediaEncryptDlg::UnInitAgora()
 		//disable video in the engine.
 		m_rtcEngine->disableVideo();
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("disableVideo"));
-		//release engine.
-		m_rtcEngine->release(true);
+		SetKeyRotation(false);
+		//give the engine back to the host.
+		m_engineLease.Release();
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("release rtc engine"));
 		m_rtcEngine = NULL;
 	}
@@ -170,6 +167,7 @@ BOOL CAgoraMediaEncryptDlg::OnInitDialog()
 
 	m_cmbEncryptMode.InsertString(nIndex++, _T("AES_128_GCM2"));
 	m_cmbEncryptMode.InsertString(nIndex++, _T("AES_256_GCM2"));
+	m_cmbEncryptMode.InsertString(nIndex++, _T("ROTATING_CHACHA20_POLY1305"));
 	m_cmbEncryptMode.SetCurSel(0);
 	m_mapEncryptMode.insert(std::make_pair("AES_128_GCM2", AES_128_GCM2));
 	m_mapEncryptMode.insert(std::make_pair("AES_256_GCM2", AES_256_GCM2));
@@ -246,18 +244,98 @@ void CAgoraMediaEncryptDlg::OnBnClickedButtonSetMediaEncrypt()
 	CString strSecret;
 	m_edtEncryptKey.GetWindowText(strSecret);
 	std::string secret = cs2utf8(strSecret);
+	CString strInfo;
+	if (strEncryptMode == _T("ROTATING_CHACHA20_POLY1305")) {
+		//epoch keys from the secret, bound to the channel name, so every
+		//client in the channel derives the same ones.
+		CString strChannelName;
+		m_edtChannel.GetWindowText(strChannelName);
+		MediaKeyScheduleConfig keyConfig;
+		keyConfig.masterSecret = secret;
+		keyConfig.salt = getEncryptionSaltFromServer();
+		keyConfig.context = cs2utf8(strChannelName);
+		keyConfig.epochMs = KEY_ROTATION_EPOCH_MS;
+		keyConfig.overlapMs = KEY_ROTATION_OVERLAP_MS;
+		if (!m_keyRotationObserver.GetSchedule().SetConfig(keyConfig)) {
+			AfxMessageBox(_T("Fill encrypt key first"));
+			return;
+		}
+		//the SDK's own encryption would run on top of ours.
+		EncryptionConfig off;
+		m_rtcEngine->enableEncryption(false, off);
+		SetKeyRotation(true);
+		strInfo.Format(_T("encrypt mode:%s epoch:%ds overlap:%ds"), strEncryptMode,
+			KEY_ROTATION_EPOCH_MS / 1000, KEY_ROTATION_OVERLAP_MS / 1000);
+		m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
+		return;
+	}
+	SetKeyRotation(false);
 	EncryptionConfig config;
 	config.encryptionMode = m_mapEncryptMode[encryption.c_str()];
 	config.encryptionKey = secret.c_str();
 	memcpy(config.encryptionKdfSalt, getEncryptionSaltFromServer().c_str(), 32);
 	//set encrypt mode
 	m_rtcEngine->enableEncryption(true, config);
-	CString strInfo;
 	strInfo.Format(_T("encrypt mode:%s secret:%s"), strEncryptMode,
 		strSecret);
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
 }
 
+void CAgoraMediaEncryptDlg::SetKeyRotation(bool enable)
+{
+	if (enable) {
+		//keys for this and the next epochs before the first packet.
+		int64_t now = CMediaKeySchedule::NowMs();
+		m_keyRotationObserver.GetSchedule().Advance(now);
+		m_keyRotationEpoch = m_keyRotationObserver.GetSchedule().GetEpoch(now);
+		if (!m_keyRotation) {
+			m_keyRotationObserver.ResetStats();
+			m_keyRotationObserver.GetSchedule().ResetStats();
+			m_engineLease.RegisterPacketObserver(&m_keyRotationObserver);
+			SetTimer(KEY_ROTATION_TIMER_ID, 1000, NULL);
+			m_keyRotation = true;
+		}
+	}
+	else if (m_keyRotation) {
+		KillTimer(KEY_ROTATION_TIMER_ID);
+		m_engineLease.RegisterPacketObserver(NULL);
+		LogKeyRotationStats();
+		m_keyRotationObserver.GetSchedule().Clear();
+		m_keyRotation = false;
+	}
+}
+
+void CAgoraMediaEncryptDlg::LogKeyRotationStats()
+{
+	KeyRotationPacketStats packets = m_keyRotationObserver.GetStats();
+	MediaKeyScheduleStats keys = m_keyRotationObserver.GetSchedule().GetStats();
+	CString strInfo;
+	strInfo.Format(_T("key epoch %u: sent %llu (%.0f MB/s), received %llu (%.0f MB/s), rotations %llu"),
+		m_keyRotationEpoch, packets.sent, packets.GetSealMBps(), packets.received, packets.GetOpenMBps(), packets.rotations);
+	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
+	strInfo.Format(_T("rejected: epoch %llu, tag %llu, replay %llu, short %llu"),
+		packets.rejectedEpoch, packets.rejectedTag, packets.rejectedReplay, packets.rejectedFormat);
+	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
+	strInfo.Format(_T("keys derived %llu, avg %.1f us, max %.1f us, late %llu"),
+		keys.derivations, keys.GetDeriveUsAverage(), keys.nsDeriveMax / 1e3, keys.misses);
+	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
+}
+
+void CAgoraMediaEncryptDlg::OnTimer(UINT_PTR nIDEvent)
+{
+	if (nIDEvent == KEY_ROTATION_TIMER_ID && m_keyRotation) {
+		//derive the coming keys here, off the packet threads.
+		int64_t now = CMediaKeySchedule::NowMs();
+		m_keyRotationObserver.GetSchedule().Advance(now);
+		uint32_t epoch = m_keyRotationObserver.GetSchedule().GetEpoch(now);
+		if (epoch != m_keyRotationEpoch) {
+			m_keyRotationEpoch = epoch;
+			LogKeyRotationStats();
+		}
+	}
+	CDialogEx::OnTimer(nIDEvent);
+}
+
 // select change for list control handler
 void CAgoraMediaEncryptDlg::OnSelchangeListInfoBroadcasting()
 {
@@ -1,5 +1,6 @@
 ﻿#pragma once
 #include "AGVideoWnd.h"
+#include "crypto/KeyRotatingPacketObserver.h"
 #include <map>
 
 
@@ -108,14 +109,30 @@ public:
 	void RenderLocalVideo();
 	//resume window status
 	void ResumeStatus();
+	//turn the rotating key packet encryption on or off.
+	void SetKeyRotation(bool enable);
+	//rekey cost and packet throughput of the rotating keys.
+	void LogKeyRotationStats();
 
 private:
+	//the rotating key mode runs in a packet observer instead of the SDK,
+	//with a new key every epoch and the old one accepted for the overlap.
+	enum {
+		KEY_ROTATION_TIMER_ID = 1001,
+		KEY_ROTATION_EPOCH_MS = 60000,
+		KEY_ROTATION_OVERLAP_MS = 5000,
+	};
+
 	bool m_joinChannel = false;
 	bool m_initialize = false;
 	bool m_setEncrypt = false;
 	IRtcEngine* m_rtcEngine = nullptr;
+	CAgoraEngineLease m_engineLease;
 	CAGVideoWnd m_localVideoWnd;
 	CAgoraMediaEncryptHandler m_eventHandler;
+	CKeyRotatingPacketObserver m_keyRotationObserver;
+	bool m_keyRotation = false;
+	uint32_t m_keyRotationEpoch = 0;
 	// agora sdk message window handler
 	LRESULT OnEIDJoinChannelSuccess(WPARAM wParam, LPARAM lParam);
 	LRESULT OnEIDLeaveChannel(WPARAM wParam, LPARAM lParam);
@@ -143,4 +160,5 @@ public:
 	afx_msg void OnBnClickedButtonJoinchannel();
 	afx_msg void OnBnClickedButtonSetMediaEncrypt();
 	afx_msg void OnSelchangeListInfoBroadcasting();
+	afx_msg void OnTimer(UINT_PTR nIDEvent);
 };
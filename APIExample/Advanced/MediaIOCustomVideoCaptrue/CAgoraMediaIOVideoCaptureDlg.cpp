@@ -9,6 +9,7 @@ BEGIN_MESSAGE_MAP(CAgoraMediaIOVideoCaptureDlg, CDialogEx)
 	ON_MESSAGE(WM_MSGID(EID_USER_JOINED), &CAgoraMediaIOVideoCaptureDlg::OnEIDUserJoined)
 	ON_MESSAGE(WM_MSGID(EID_USER_OFFLINE), &CAgoraMediaIOVideoCaptureDlg::OnEIDUserOffline)
 	ON_MESSAGE(WM_MSGID(EID_REMOTE_VIDEO_STATE_CHANED), &CAgoraMediaIOVideoCaptureDlg::OnEIDRemoteVideoStateChanged)
+	ON_MESSAGE(WM_MSGID(EID_HOST_PROFILE), &CAgoraMediaIOVideoCaptureDlg::OnEIDHostProfile)
 	//ON_BN_CLICKED(IDC_BUTTON_START_CAPUTRE, &CAgoraMediaIOVideoCaptureDlg::OnClickedButtonStartCaputre)
 	ON_BN_CLICKED(IDC_BUTTON_JOINCHANNEL, &CAgoraMediaIOVideoCaptureDlg::OnClickedButtonJoinchannel)
 	ON_CBN_SELCHANGE(IDC_COMBO_CAPTURE_VIDEO_DEVICE, &CAgoraMediaIOVideoCaptureDlg::OnSelchangeComboCaptureVideoDevice)
@@ -33,12 +34,6 @@ void CAgoraMediaIOVideoCaptureDlg::InitCtrlText()
 */
 bool CAgoraMediaIOVideoCaptureDlg::InitAgora()
 {
-	//create Agora RTC engine
-	m_rtcEngine = createAgoraRtcEngine();
-	if (!m_rtcEngine) {
-		m_lstInfo.InsertString(m_lstInfo.GetCount() - 1, _T("createAgoraRtcEngine failed"));
-		return false;
-	}
 	//set message notify receiver window
 	m_eventHandler.SetMsgReceiver(m_hWnd);
 
@@ -46,8 +41,9 @@ bool CAgoraMediaIOVideoCaptureDlg::InitAgora()
 	std::string strAppID = GET_APP_ID;
 	context.appId = strAppID.c_str();
 	context.eventHandler = &m_eventHandler;
-	//initialize the Agora RTC engine context.
-	int ret = m_rtcEngine->initialize(context);
+	//borrow the shared engine, this registers our event handler.
+	int ret = m_engineLease.Acquire(context);
+	m_rtcEngine = m_engineLease.GetEngine();
 	if (ret != 0) {
 		m_initialize = false;
 		CString strInfo;
@@ -80,6 +76,10 @@ bool CAgoraMediaIOVideoCaptureDlg::InitAgora()
 	m_cmbSDKCamera.SetCurSel(0);
 	//start preview default camera
 	m_rtcEngine->startPreview();
+	//encode with the selected configuration, the advised one by default.
+	int sel = m_cmbSDKResolution.GetCurSel();
+	if (sel >= 0)
+		m_rtcEngine->setVideoEncoderConfiguration(encoderConfigs[sel]);
 	
 	EnableControl();
 	return true;
@@ -100,8 +100,8 @@ void CAgoraMediaIOVideoCaptureDlg::UnInitAgora()
 		//disable video in the engine.
 		m_rtcEngine->disableVideo();
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("disableVideo"));
-		//release engine.
-		m_rtcEngine->release(true);
+		//give the engine back to the host.
+		m_engineLease.Release();
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("release rtc engine"));
 		m_rtcEngine = NULL;
 	}
@@ -131,6 +131,28 @@ void CAgoraMediaIOVideoCaptureDlgEngineEventHandler::onRemoteVideoStateChanged(u
 	}
 }
 
+namespace {
+	//name of a format in the resolution list, nullptr for formats it leaves
+	//out. DirectShow RGB24 is bottom-up and never was offered.
+	LPCTSTR GetCaptureFormatName(uint32_t fourcc)
+	{
+		switch (fourcc) {
+		case CAPTURE_FOURCC_I420:
+			return _T("YUV420");
+		case CAPTURE_FOURCC_NV12:
+			return _T("NV12");
+		case CAPTURE_FOURCC_YUY2:
+			return _T("YUY2");
+		case CAPTURE_FOURCC_MJPG:
+			return _T("MJPEG");
+		case CAPTURE_FOURCC_UYVY:
+			return _T("UYVY");
+		default:
+			return nullptr;
+		}
+	}
+}
+
 /*
 	initialize dialog, and set control property.
 */
@@ -146,19 +168,17 @@ BOOL CAgoraMediaIOVideoCaptureDlg::OnInitDialog()
 	strPath = strPath.Mid(0, pos + 1);
 	//screen.yuv path
 	strPath += _T("screen.yuv");
-	//video size is external_screen_w * external_screen_h * 3 / 2
-	screenBuffer = new uint8_t[external_screen_w * external_screen_h * 3 / 2];
-	//read screen buffer, yuv420sp
-	_tfopen_s(&m_screenFile, strPath.GetBuffer(), L"rb");
-	if (m_screenFile)
-		fread(screenBuffer, 1, external_screen_w * external_screen_h * 3 / 2, m_screenFile);
+	//frames are mapped a window at a time and played in a loop.
+	m_screenFile = std::make_shared<CRawVideoFile>();
+	if (!m_screenFile->Open(strPath, RAW_VIDEO_I420, external_screen_w, external_screen_h))
+		m_screenFile.reset();
 
 	m_localVideoWnd.Create(NULL, NULL, WS_CHILD | WS_VISIBLE | WS_BORDER | WS_CLIPCHILDREN | WS_CLIPSIBLINGS, CRect(0, 0, 1, 1), this, ID_BASEWND_VIDEO + 100);
 	RECT rcArea;
 	m_staVideoArea.GetClientRect(&rcArea);
 	m_localVideoWnd.MoveWindow(&rcArea);
-	//create and initialize video capture object.
-	m_agVideoCaptureDevice.Create();
+	//create the video capture backend.
+	m_captureBackend = CreateCaptureBackend(CAPTURE_BACKEND_DSHOW);
 	ResumeStatus();
 	int i = 0;
 	m_cmbCaptureType.InsertString(i++, mediaIOCaptureTypeSDKCamera);
@@ -186,6 +206,10 @@ BOOL CAgoraMediaIOVideoCaptureDlg::OnInitDialog()
 	encoderConfigs[i].dimensions.width = 1280;
 	encoderConfigs[i].dimensions.height = 720;
 	encoderConfigs[i++].frameRate = FRAME_RATE_FPS_15;
+
+	//advised from the host benchmark cached next to the exe and the first
+	//camera, the first entry until there is advice.
+	encoderConfigs[i++] = encoderConfigs[0];
 	
 	for (int i = 0; i < ENCODER_CONFIG_COUNT; ++i) {
 		CString strInfo;
@@ -193,13 +217,70 @@ BOOL CAgoraMediaIOVideoCaptureDlg::OnInitDialog()
 			encoderConfigs[i].dimensions.width,
 			encoderConfigs[i].dimensions.height,
 			encoderConfigs[i].frameRate);
+		if (i == ENCODER_CONFIG_COUNT - 1)
+			strInfo += _T(" advised");
 		m_cmbSDKResolution.InsertString(i, strInfo);
 	}
 	m_cmbSDKResolution.SetCurSel(0);
-	
+
+	//DirectShow enumerates on this thread, it has COM.
+	GetCaptureDeviceFormats(CAPTURE_BACKEND_DSHOW, 0, m_adviceFormats);
+	std::string strProfile = cs2utf8(GetExePath() + _T("\\hostProfile.txt"));
+	HostProfile host;
+	if (LoadHostProfile(strProfile, host)) {
+		ApplyHostProfile(host);
+		return TRUE;
+	}
+	//the benchmark takes a few hundred milliseconds, once per machine.
+	m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("benchmarking the host"));
+	HWND hWnd = GetSafeHwnd();
+	m_benchmarkThread = std::thread([hWnd, strProfile]() {
+		HostProfile* measured = new HostProfile(GetHostProfile(strProfile));
+		if (!::PostMessage(hWnd, WM_MSGID(EID_HOST_PROFILE), 0, (LPARAM)measured))
+			delete measured;
+	});
 	return TRUE;
 }
 
+// advise the last encoder configuration from the host's numbers and the
+// first camera, and select it unless another one was picked.
+void CAgoraMediaIOVideoCaptureDlg::ApplyHostProfile(const HostProfile& host)
+{
+	EncoderAdvice advice = CEncoderAdvisor(host).Advise(m_adviceFormats, EncoderAdviceRequest());
+	if (!advice.valid)
+		return;
+	const int advised = ENCODER_CONFIG_COUNT - 1;
+	encoderConfigs[advised] = advice.config;
+	CString strInfo;
+	strInfo.Format(_T("%dx%d %dfps advised"),
+		advice.config.dimensions.width,
+		advice.config.dimensions.height,
+		advice.config.frameRate);
+	int sel = m_cmbSDKResolution.GetCurSel();
+	m_cmbSDKResolution.DeleteString(advised);
+	m_cmbSDKResolution.InsertString(advised, strInfo);
+	if (sel == 0 || sel == advised) {
+		m_cmbSDKResolution.SetCurSel(advised);
+		if (m_rtcEngine)
+			m_rtcEngine->setVideoEncoderConfiguration(encoderConfigs[advised]);
+	}
+	else
+		m_cmbSDKResolution.SetCurSel(sel);
+	m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("advised: ") + utf82cs(CEncoderAdvisor::DescribeAdvice(advice)));
+}
+
+//EID_HOST_PROFILE message window handler.
+LRESULT CAgoraMediaIOVideoCaptureDlg::OnEIDHostProfile(WPARAM wParam, LPARAM lParam)
+{
+	HostProfile* host = reinterpret_cast<HostProfile*>(lParam);
+	m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("host measured: ") + utf82cs(DescribeHostProfile(*host)));
+	ApplyHostProfile(*host);
+	delete host;
+	if (m_benchmarkThread.joinable())
+		m_benchmarkThread.join();
+	return 0;
+}
+
 
 // update window view and control.
 void CAgoraMediaIOVideoCaptureDlg::UpdateViews()
@@ -213,17 +294,13 @@ void CAgoraMediaIOVideoCaptureDlg::UpdateViews()
 // enumerate device and show device in combobox.
 void CAgoraMediaIOVideoCaptureDlg::UpdateDevice()
 {
-	TCHAR				szDevicePath[MAX_PATH] = { 0 };
-	SIZE_T				nPathLen = MAX_PATH;
-	CString				strInfo;
-	AGORA_DEVICE_INFO	agDeviceInfo;
+	std::vector<CaptureDeviceInfo> devices;
 	m_cmbVideoDevice.ResetContent();
 	//enum video capture device.
-	m_agVideoCaptureDevice.EnumDeviceList();
-	for (int nIndex = 0; nIndex < m_agVideoCaptureDevice.GetDeviceCount(); nIndex++) {
-		m_agVideoCaptureDevice.GetDeviceInfo(nIndex, &agDeviceInfo);
-		m_cmbVideoDevice.InsertString(nIndex, agDeviceInfo.szDeviceName);
-	}
+	if (m_captureBackend)
+		m_captureBackend->EnumDevices(devices);
+	for (size_t nIndex = 0; nIndex < devices.size(); nIndex++)
+		m_cmbVideoDevice.InsertString((int)nIndex, utf82cs(devices[nIndex].name));
 	m_cmbVideoDevice.SetCurSel(0);
 	OnSelchangeComboCaptureVideoDevice();
 }
@@ -250,29 +327,41 @@ void CAgoraMediaIOVideoCaptureDlg::EnableCaputure(BOOL bEnable)
 	int nIndex = m_cmbVideoResoliton.GetCurSel();
 	if (bEnable)
 	{
-		VIDEOINFOHEADER videoInfo;
-		//create video capture filter.
-		m_agVideoCaptureDevice.CreateCaptureFilter();
 		//select video capture type.
-		m_agVideoCaptureDevice.SelectMediaCap(nIndex == -1 ? 0 : nIndex);
-		m_agVideoCaptureDevice.GetCurrentVideoCap(&videoInfo);
-
-		CAgVideoBuffer::GetInstance()->SetVideoFormat(&videoInfo.bmiHeader);
+		if (m_capFormats.empty() || !m_captureBackend)
+			return;
+		const CaptureFormat& format = m_capFormats[nIndex == -1 ? 0 : m_cmbVideoResoliton.GetItemData(nIndex)];
+		//open the device in the selected format.
+		if (!m_captureBackend->Open(m_cmbVideoDevice.GetCurSel(), format)) {
+			m_lstInfo.InsertString(m_lstInfo.GetCount(),
+				_T("open capture failed: ") + utf82cs(DescribeCaptureFormat(format)));
+			return;
+		}
+		BITMAPINFOHEADER bmiHeader = { sizeof(BITMAPINFOHEADER) };
+		bmiHeader.biWidth = format.width;
+		bmiHeader.biHeight = format.height;
+		bmiHeader.biCompression = format.fourcc;
+		CAgVideoBuffer::GetInstance()->SetVideoFormat(&bmiHeader);
 		
 		//set video encoder configuration.
-		m_externalCameraConfig.dimensions.width = videoInfo.bmiHeader.biWidth;
-		m_externalCameraConfig.dimensions.height = videoInfo.bmiHeader.biHeight;
-		m_externalCameraConfig.frameRate = (FRAME_RATE)(10000000ll / videoInfo.AvgTimePerFrame);
+		m_externalCameraConfig.dimensions.width = format.width;
+		m_externalCameraConfig.dimensions.height = format.height;
+		m_externalCameraConfig.frameRate = (FRAME_RATE)format.fps;
 		m_rtcEngine->setVideoEncoderConfiguration(m_externalCameraConfig);
-		//start video capture.
-		m_agVideoCaptureDevice.Start();
+		//start video capture, frames arrive as I420 in CAgVideoBuffer.
+		m_captureSink.Start(format, [](const uint8_t* i420, size_t size, int64_t timestampUs, uint64_t sequence) {
+			CAgVideoBuffer::GetInstance()->writeBuffer(const_cast<BYTE*>(i420), (int)size, (int)(timestampUs / 1000), sequence);
+		});
+		m_captureBackend->Start([this](const CaptureFrame& frame) { m_captureSink.Push(frame); });
 	}
 	else {
 		//video capture stop.
-		m_agVideoCaptureDevice.Stop();
-		//remove video capture filter.
-		m_agVideoCaptureDevice.RemoveCaptureFilter();
-		
+		if (m_captureBackend) {
+			m_captureBackend->Stop();
+			m_captureSink.Stop();
+			//release the device.
+			m_captureBackend->Close();
+		}
 	}
 }
 
@@ -438,17 +527,12 @@ CAgoraMediaIOVideoCaptureDlg::CAgoraMediaIOVideoCaptureDlg(CWnd* pParent /*=null
 
 CAgoraMediaIOVideoCaptureDlg::~CAgoraMediaIOVideoCaptureDlg()
 {
+	if (m_benchmarkThread.joinable())
+		m_benchmarkThread.join();
 	EnableCaputure(FALSE);
 	m_videoSouce.Stop();
-	if (m_screenFile) {
-		fclose(m_screenFile);
-		m_screenFile = NULL;
-	}
-
-	if (screenBuffer) {
-		delete[] screenBuffer;
-		screenBuffer = NULL;
-	}
+	m_videoSouce.SetFileSource(nullptr);
+	m_screenFile.reset();
 }
 
 void CAgoraMediaIOVideoCaptureDlg::DoDataExchange(CDataExchange* pDX)
@@ -473,55 +557,22 @@ void CAgoraMediaIOVideoCaptureDlg::DoDataExchange(CDataExchange* pDX)
 //and inserts them into the ComboBox
 void CAgoraMediaIOVideoCaptureDlg::OnSelchangeComboCaptureVideoDevice()
 {
-	TCHAR	szDevicePath[MAX_PATH] = { 0 };
-	SIZE_T	nPathLen = MAX_PATH;
 	int		nSel = m_cmbVideoDevice.GetCurSel();
-
-	VIDEOINFOHEADER		vidInfoHeader;
-	CString				strInfo;
-	CString				strCompress;
-	//get current device name.
+	CString	strInfo;
+	std::vector<CaptureFormat> formats;
 	m_cmbVideoResoliton.ResetContent();
-
-	BOOL bSuccess = m_agVideoCaptureDevice.GetCurrentDevice(szDevicePath, &nPathLen);
-	if (bSuccess)
-		m_agVideoCaptureDevice.CloseDevice();
-
-	if (nSel != -1) {
-		//open device.
-		if (!m_agVideoCaptureDevice.OpenDevice(nSel))
-		{
-			return;
-		}
-		//create capture filter.
-		//m_agVideoCaptureDevice.CreateCaptureFilter();
-	}
-	//enumerate video capture device type. 
-	int count = m_agVideoCaptureDevice.GetMediaCapCount();
-	for (int nIndex = 0; nIndex < count; nIndex++) {
-		m_agVideoCaptureDevice.GetVideoCap(nIndex, &vidInfoHeader);
-		if (vidInfoHeader.bmiHeader.biCompression == 0)continue;
-		switch (vidInfoHeader.bmiHeader.biCompression)
-		{
-		case MAKEFOURCC('I', '4', '2', '0'):
-
-			strInfo.Format(_T("%d*%d %dfps(YUV420)"), vidInfoHeader.bmiHeader.biWidth, vidInfoHeader.bmiHeader.biHeight, 10000000ll / vidInfoHeader.AvgTimePerFrame);
-			break;
-		case 0x00000000:
-
-			strInfo.Format(_T("%d*%d %dfps(RGB24)"), vidInfoHeader.bmiHeader.biWidth, vidInfoHeader.bmiHeader.biHeight, 10000000ll / vidInfoHeader.AvgTimePerFrame);
-			break;
-		case MAKEFOURCC('Y', 'U', 'Y', '2'):
-			strInfo.Format(_T("%d*%d %dfps(YUY2)"), vidInfoHeader.bmiHeader.biWidth, vidInfoHeader.bmiHeader.biHeight, 10000000ll / vidInfoHeader.AvgTimePerFrame);
-			break;
-		case MAKEFOURCC('M', 'J', 'P', 'G'):
-			strInfo.Format(_T("%d*%d %dfps(MJPEG)"), vidInfoHeader.bmiHeader.biWidth, vidInfoHeader.bmiHeader.biHeight, 10000000ll / vidInfoHeader.AvgTimePerFrame);
-			break;
-		case MAKEFOURCC('U', 'Y', 'V', 'Y'):
-			strInfo.Format(_T("%d*%d %dfps(UYVY)"), vidInfoHeader.bmiHeader.biWidth, vidInfoHeader.bmiHeader.biHeight, 10000000ll / vidInfoHeader.AvgTimePerFrame);
-			break;
-		}
-		m_cmbVideoResoliton.InsertString(nIndex, strInfo);
+	m_capFormats.clear();
+	//open the device and enumerate its formats.
+	if (nSel == -1 || !m_captureBackend || !m_captureBackend->GetFormats(nSel, formats))
+		return;
+	for (const CaptureFormat& format : formats) {
+		LPCTSTR lpszFormat = GetCaptureFormatName(format.fourcc);
+		if (!lpszFormat)
+			continue;
+		strInfo.Format(_T("%d*%d %dfps(%s)"), format.width, format.height, format.fps, lpszFormat);
+		int nItem = m_cmbVideoResoliton.AddString(strInfo);
+		m_cmbVideoResoliton.SetItemData(nItem, m_capFormats.size());
+		m_capFormats.push_back(format);
 	}
 	m_cmbVideoResoliton.SetCurSel(0);
 }
@@ -667,6 +718,7 @@ void CAgoraMediaIOVideoCaptureDlg::OnSelchangeCmbMedioCapturetype()
 		m_videoSouce.SetParameters( m_externalCameraConfig.dimensions.width,
 			m_externalCameraConfig.dimensions.height, 0, m_externalCameraConfig.frameRate);
 		m_videoSouce.SetVideoCaptureType(VIDEO_CAPTURE_CAMERA);
+		m_videoSouce.SetFileSource(nullptr);
 		m_rtcEngine->setVideoSource(&m_videoSouce);
 		
 		m_videoSouce.SetConsumeEvent();
@@ -684,8 +736,16 @@ void CAgoraMediaIOVideoCaptureDlg::OnSelchangeCmbMedioCapturetype()
 		
 		//set video source parameter
 		m_videoSouce.SetParameters( external_screen_w, external_screen_h, 0, external_screen_fps);
+		//frames come straight from the mapped screen.yuv
+		m_videoSouce.SetFileSource(m_screenFile);
 		m_rtcEngine->setVideoSource(&m_videoSouce);
-		CAgVideoBuffer::GetInstance()->writeBuffer(screenBuffer, external_screen_w * external_screen_h * 3 / 2, GetTickCount());
+		if (!m_screenFile) {
+			//without screen.yuv push a black frame through the video buffer.
+			m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("screen.yuv not found, pushing a black frame"));
+			std::vector<BYTE> blackFrame(external_screen_w * external_screen_h * 3 / 2, 128);
+			memset(blackFrame.data(), 16, external_screen_w * external_screen_h);
+			CAgVideoBuffer::GetInstance()->writeBuffer(blackFrame.data(), (int)blackFrame.size(), GetTickCount());
+		}
 		//active external screen capture thread
 		m_videoSouce.SetConsumeEvent();
 		
@@ -1,8 +1,15 @@
 ﻿#pragma once
 #include "AGVideoWnd.h"
 #include "DirectShow/AgVideoBuffer.h"
-#include "DirectShow/AGDShowVideoCapture.h"
+#include "DirtyRegionDetector.h"
+#include "RawVideoFile.h"
+#include "capture/CaptureBackend.h"
+#include "capture/CaptureI420Sink.h"
+#include "capture/EncoderAdvisor.h"
+#include <atomic>
+#include <memory>
 #include <mutex>
+#include <thread>
 
 class CAgoraMediaIOVideoCaptureDlgEngineEventHandler : public IRtcEngineEventHandler {
 public:
@@ -141,6 +148,12 @@ class CAgoraVideoSource :public IVideoSource {
 		//wait for consume event until consume event is signaled
 		while (WaitForSingleObject(self->m_hConsumeEvent, INFINITE) == WAIT_OBJECT_0)
 		{
+			if (self->PushFileFrame())
+				continue;
+			//screen frames are paced at the configured frame rate. wait before
+			//reading, so the frame pushed is the newest one, not a frame old.
+			if (self->m_capType == VIDEO_CAPTURE_SCREEN)
+				Sleep(1000 / (self->m_fps > 0 ? self->m_fps : 15));
 			//std::lock_guard<std::mutex> m(self->mutex);
 			int bufSize = self->m_width * self->m_height * 3 / 2;
 			int timestamp = GetTickCount();
@@ -148,6 +161,9 @@ class CAgoraVideoSource :public IVideoSource {
 				Sleep(1);
 				continue;
 			}
+			if (self->m_capType == VIDEO_CAPTURE_SCREEN
+				&& !self->ShouldPushScreenFrame(self->m_buffer, self->m_width, self->m_height, GetTickCount()))
+				continue;
 			self->m_mutex.lock();//lock consumer and buffer
 			if (self->m_videoConsumer)
 			{
@@ -182,7 +198,7 @@ class CAgoraVideoSource :public IVideoSource {
 	 */
 	virtual agora::media::ExternalVideoFrame::VIDEO_PIXEL_FORMAT getBufferType() override
 	{
-		return ExternalVideoFrame::VIDEO_PIXEL_I420;
+		return m_bufferType;
 	}
 
 	/** Gets the capture type of the custom video source.
@@ -264,9 +280,83 @@ public:
 		m_rotation = rotation;
 		m_fps = fps;
 	}
+	//push frames of a mapped raw video file instead of CAgVideoBuffer, looping
+	//at the frame rate of SetParameters. nullptr goes back to CAgVideoBuffer.
+	//call before setVideoSource, the sdk asks for the buffer type once.
+	void SetFileSource(std::shared_ptr<const CRawVideoFile> file)
+	{
+		std::lock_guard<std::mutex> m(m_mutex);
+		m_fileReader.reset();
+		m_bufferType = ExternalVideoFrame::VIDEO_PIXEL_I420;
+		if (!file || !file->IsOpen())
+			return;
+		m_fileReader.reset(new CRawVideoReader(file));
+		m_fileReader->SetFrameRate(m_fps);
+		switch (file->GetFormat()) {
+		case RAW_VIDEO_NV12:
+			m_bufferType = ExternalVideoFrame::VIDEO_PIXEL_NV12;
+			break;
+		case RAW_VIDEO_RGBA:
+			m_bufferType = ExternalVideoFrame::VIDEO_PIXEL_RGBA;
+			break;
+		default:
+			break;
+		}
+	}
 	void SetConsumeEvent() { SetEvent(m_hConsumeEvent); }
 	void ResetConsumeEvent() { ResetEvent(m_hConsumeEvent); }
+	//screen frames pushed to and skipped before the sdk, and the changed
+	//share of the last detected frame, 0 to 1.
+	void GetScreenFrameStats(uint64_t& pushed, uint64_t& skipped, double& changedRatio) const
+	{
+		pushed = m_screenPushed;
+		skipped = m_screenSkipped;
+		changedRatio = m_screenChangedRatio;
+	}
 private:
+	//an unchanged screen frame is not pushed again, only once per
+	//SCREEN_KEEPALIVE_MS so the encoder keeps a frame to send.
+	enum { SCREEN_KEEPALIVE_MS = 1000 };
+	bool ShouldPushScreenFrame(const uint8_t* frame, int width, int height, DWORD now)
+	{
+		if (m_dirtyDetector.GetWidth() != width || m_dirtyDetector.GetHeight() != height)
+			m_dirtyDetector.Configure(width, height);
+		int dirtyBlocks = m_dirtyDetector.Detect(frame);
+		m_screenChangedRatio = m_dirtyDetector.GetChangedRatio();
+		if (dirtyBlocks == 0 && now - m_lastScreenPush < SCREEN_KEEPALIVE_MS) {
+			++m_screenSkipped;
+			return false;
+		}
+		m_lastScreenPush = now;
+		++m_screenPushed;
+		return true;
+	}
+
+	//capture thread. pushes the due file frame straight from the mapping
+	//and sleeps until the next one, false without a file source.
+	bool PushFileFrame()
+	{
+		DWORD wait = 0;
+		{
+			std::lock_guard<std::mutex> m(m_mutex);
+			if (!m_fileReader)
+				return false;
+			RawVideoFrame frame;
+			DWORD now = GetTickCount();
+			if (m_fileReader->NextFrame(now, frame) && m_videoConsumer) {
+				bool push = true;
+				if (m_capType == VIDEO_CAPTURE_SCREEN && frame.format == RAW_VIDEO_I420)
+					push = ShouldPushScreenFrame(frame.data, frame.width, frame.height, now);
+				if (push)
+					m_videoConsumer->consumeRawVideoFrame(frame.data, m_bufferType,
+						frame.width, frame.height, m_rotation, now);
+			}
+			wait = m_fileReader->IsFinished() ? 100 : (DWORD)m_fileReader->GetWaitMs(GetTickCount());
+		}
+		Sleep(wait > 0 ? wait : 1);
+		return true;
+	}
+
 	IVideoFrameConsumer * m_videoConsumer;
 	//bool m_isExit;
 	BYTE * m_buffer;
@@ -279,9 +369,18 @@ private:
 	VIDEO_CAPTURE_TYPE m_capType = VIDEO_CAPTURE_UNKNOWN;
 	VideoContentHint m_videoHintContent = CONTENT_HINT_NONE;
 	HANDLE m_hConsumeEvent = NULL;
+	//only used on the capture thread.
+	CDirtyRegionDetector m_dirtyDetector;
+	DWORD m_lastScreenPush = 0;
+	std::atomic<uint64_t> m_screenPushed{ 0 };
+	std::atomic<uint64_t> m_screenSkipped{ 0 };
+	std::atomic<double> m_screenChangedRatio{ 0.0 };
+	std::unique_ptr<CRawVideoReader> m_fileReader;
+	agora::media::ExternalVideoFrame::VIDEO_PIXEL_FORMAT m_bufferType = ExternalVideoFrame::VIDEO_PIXEL_I420;
 };
 
-#define ENCODER_CONFIG_COUNT 4
+//the fixed configurations and the one advised for this machine.
+#define ENCODER_CONFIG_COUNT 5
 class CAgoraMediaIOVideoCaptureDlg : public CDialogEx
 {
 	DECLARE_DYNAMIC(CAgoraMediaIOVideoCaptureDlg)
@@ -293,6 +392,7 @@ public:
 	LRESULT OnEIDUserJoined(WPARAM wParam, LPARAM lParam);
 	LRESULT OnEIDUserOffline(WPARAM wParam, LPARAM lParam);
 	LRESULT OnEIDRemoteVideoStateChanged(WPARAM wParam, LPARAM lParam);
+	LRESULT OnEIDHostProfile(WPARAM wParam, LPARAM lParam);
 
 	CAgoraMediaIOVideoCaptureDlg(CWnd* pParent = nullptr);
 	virtual ~CAgoraMediaIOVideoCaptureDlg();
@@ -314,6 +414,9 @@ public:
 	// start or stop capture.
 	// if bEnable is true start capture otherwise stop capture.
 	void EnableCaputure(BOOL bEnable);
+	// advise the last encoder configuration from the host's numbers and
+	// the first camera, and select it unless another one was picked.
+	void ApplyHostProfile(const HostProfile& host);
 
 	enum {
 		IDD = IDD_DIALOG_CUSTOM_CAPTURE_MEDIA_IO_VIDEO
@@ -331,11 +434,18 @@ protected:
 	virtual void DoDataExchange(CDataExchange* pDX);
 	void EnableControl();
 	CAgoraMediaIOVideoCaptureDlgEngineEventHandler m_eventHandler;
-	CAGDShowVideoCapture m_agVideoCaptureDevice;
+	//the cameras, through the DirectShow capture backend.
+	std::unique_ptr<ICaptureBackend> m_captureBackend;
+	//converts what the backend delivers into CAgVideoBuffer.
+	CCaptureI420Sink m_captureSink;
+	//formats listed in m_cmbVideoResoliton, an entry's item data is its
+	//position here.
+	std::vector<CaptureFormat> m_capFormats;
 	CAGVideoWnd m_localVideoWnd;
 	CAgoraVideoSource m_videoSouce;
 
 	IRtcEngine* m_rtcEngine = nullptr;
+	CAgoraEngineLease m_engineLease;
 	AVideoDeviceManager* m_videoDeviceManager = nullptr;
 	agora::rtc::IVideoDeviceCollection* m_lpVideoCollection = nullptr;
 	bool m_joinChannel = false;
@@ -343,8 +453,8 @@ protected:
 	bool m_remoteJoined = false;
 	bool m_extenalCaptureVideo = false;
 	
-	uint8_t * screenBuffer = NULL;
-	FILE* m_screenFile = NULL;
+	//screen.yuv next to the exe, I420 external_screen_w x external_screen_h.
+	std::shared_ptr<CRawVideoFile> m_screenFile;
 	const int external_screen_w = 1920;
 	const int external_screen_h = 1080;
 	const int external_screen_fps = 15;
@@ -352,6 +462,10 @@ protected:
 	VideoEncoderConfiguration m_externalCameraConfig;
 
 	VideoEncoderConfiguration encoderConfigs[ENCODER_CONFIG_COUNT];
+	//formats of the first camera the advice is for.
+	std::vector<CaptureFormat> m_adviceFormats;
+	//measures the host on the first run, posts EID_HOST_PROFILE.
+	std::thread m_benchmarkThread;
 	DECLARE_MESSAGE_MAP()
 public:
 	CStatic m_staVideoArea;
@@ -0,0 +1,222 @@
+#include "DirtyRegionDetector.h"
+#include <string.h>
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define DIRTY_REGION_SSE2
+#endif
+//no stdafx.h, the detector is tested and benchmarked on its own.
+
+/*
+	Both lanes of the hash state take one 8 byte word per row:
+		x = state ^ word
+		state = low32(x) * MIX + high32(x)
+	The luma rows feed 16 bytes, the left half into lane 0 and the right
+	half into lane 1; each chroma row feeds the 8 U bytes into lane 0 and
+	the 8 V bytes into lane 1. SSE2 runs both lanes at once with
+	_mm_mul_epu32, the scalar code gives the same result.
+*/
+namespace {
+	const uint64_t MIX = 0x9E3779B1ull;
+	const uint64_t SEED0 = 0x243F6A8885A308D3ull;
+	const uint64_t SEED1 = 0x13198A2E03707344ull;
+
+	inline uint64_t Step(uint64_t state, uint64_t word)
+	{
+		uint64_t x = state ^ word;
+		return (x & 0xFFFFFFFFull) * MIX + (x >> 32);
+	}
+
+	inline uint64_t Load64(const uint8_t* p)
+	{
+		uint64_t word;
+		memcpy(&word, p, sizeof(word));
+		return word;
+	}
+
+	inline uint64_t Finish(uint64_t lane0, uint64_t lane1)
+	{
+		uint64_t h = lane0 ^ (lane1 * 0xC2B2AE3D27D4EB4Full);
+		h ^= h >> 33;
+		h *= 0xFF51AFD7ED558CCDull;
+		h ^= h >> 33;
+		h *= 0xC4CEB9FE1A85EC53ull;
+		h ^= h >> 33;
+		return h;
+	}
+}
+
+CDirtyRegionDetector::CDirtyRegionDetector()
+{
+}
+
+CDirtyRegionDetector::~CDirtyRegionDetector()
+{
+}
+
+void CDirtyRegionDetector::Configure(int width, int height)
+{
+	m_width = width > 0 ? width : 0;
+	m_height = height > 0 ? height : 0;
+	m_blocksX = (m_width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	m_blocksY = (m_height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	m_hashes.assign((size_t)m_blocksX * m_blocksY, 0);
+	m_generations.assign((size_t)m_blocksX * m_blocksY, 0);
+	m_generation = 0;
+	m_rects.clear();
+	m_changedArea = 0;
+	m_open.reserve(m_blocksX);
+	m_nextOpen.reserve(m_blocksX);
+}
+
+uint64_t CDirtyRegionDetector::HashBlockScalar(const uint8_t* y, int yStride, const uint8_t* u, int uStride, const uint8_t* v, int vStride)
+{
+	uint64_t lane0 = SEED0, lane1 = SEED1;
+	for (int row = 0; row < BLOCK_SIZE; ++row, y += yStride) {
+		lane0 = Step(lane0, Load64(y));
+		lane1 = Step(lane1, Load64(y + 8));
+	}
+	for (int row = 0; row < BLOCK_SIZE / 2; ++row, u += uStride, v += vStride) {
+		lane0 = Step(lane0, Load64(u));
+		lane1 = Step(lane1, Load64(v));
+	}
+	return Finish(lane0, lane1);
+}
+
+uint64_t CDirtyRegionDetector::HashBlock(const uint8_t* y, int yStride, const uint8_t* u, int uStride, const uint8_t* v, int vStride)
+{
+#ifdef DIRTY_REGION_SSE2
+	const __m128i mix = _mm_set1_epi64x((long long)MIX);
+	__m128i state = _mm_set_epi64x((long long)SEED1, (long long)SEED0);
+	for (int row = 0; row < BLOCK_SIZE; ++row, y += yStride) {
+		__m128i x = _mm_xor_si128(state, _mm_loadu_si128((const __m128i*)y));
+		state = _mm_add_epi64(_mm_mul_epu32(x, mix), _mm_srli_epi64(x, 32));
+	}
+	for (int row = 0; row < BLOCK_SIZE / 2; ++row, u += uStride, v += vStride) {
+		__m128i word = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)u), _mm_loadl_epi64((const __m128i*)v));
+		__m128i x = _mm_xor_si128(state, word);
+		state = _mm_add_epi64(_mm_mul_epu32(x, mix), _mm_srli_epi64(x, 32));
+	}
+	uint64_t lanes[2];
+	_mm_storeu_si128((__m128i*)lanes, state);
+	return Finish(lanes[0], lanes[1]);
+#else
+	return HashBlockScalar(y, yStride, u, uStride, v, vStride);
+#endif
+}
+
+//blocks on the right and bottom edge, only the pixels inside the frame count.
+uint64_t CDirtyRegionDetector::HashPartialBlock(const uint8_t* y, int yStride, const uint8_t* u, int uStride,
+	const uint8_t* v, int vStride, int width, int height)
+{
+	uint64_t lane0 = SEED0 ^ (uint64_t)width, lane1 = SEED1 ^ (uint64_t)height;
+	uint8_t row[BLOCK_SIZE];
+	for (int r = 0; r < height; ++r, y += yStride) {
+		memset(row, 0, sizeof(row));
+		memcpy(row, y, width);
+		lane0 = Step(lane0, Load64(row));
+		lane1 = Step(lane1, Load64(row + 8));
+	}
+	int chromaWidth = (width + 1) / 2;
+	int chromaHeight = (height + 1) / 2;
+	for (int r = 0; r < chromaHeight; ++r, u += uStride, v += vStride) {
+		memset(row, 0, sizeof(row));
+		memcpy(row, u, chromaWidth);
+		memcpy(row + 8, v, chromaWidth);
+		lane0 = Step(lane0, Load64(row));
+		lane1 = Step(lane1, Load64(row + 8));
+	}
+	return Finish(lane0, lane1);
+}
+
+int CDirtyRegionDetector::Detect(const uint8_t* frame)
+{
+	const uint8_t* u = frame + (size_t)m_width * m_height;
+	int chromaWidth = (m_width + 1) / 2;
+	const uint8_t* v = u + (size_t)chromaWidth * ((m_height + 1) / 2);
+	return Detect(frame, m_width, u, chromaWidth, v, chromaWidth);
+}
+
+int CDirtyRegionDetector::Detect(const uint8_t* y, int yStride, const uint8_t* u, int uStride, const uint8_t* v, int vStride)
+{
+	++m_generation;
+	//generation 0 marks "never seen", skip it when wrapping around.
+	if (m_generation == 0)
+		m_generation = 1;
+	bool first = m_generation == 1;
+	int dirty = 0;
+	m_changedArea = 0;
+	for (int by = 0; by < m_blocksY; ++by) {
+		int py = by * BLOCK_SIZE;
+		int height = m_height - py < BLOCK_SIZE ? m_height - py : BLOCK_SIZE;
+		const uint8_t* yRow = y + (size_t)py * yStride;
+		const uint8_t* uRow = u + (size_t)(py / 2) * uStride;
+		const uint8_t* vRow = v + (size_t)(py / 2) * vStride;
+		for (int bx = 0; bx < m_blocksX; ++bx) {
+			int px = bx * BLOCK_SIZE;
+			int width = m_width - px < BLOCK_SIZE ? m_width - px : BLOCK_SIZE;
+			uint64_t hash;
+			if (width == BLOCK_SIZE && height == BLOCK_SIZE)
+				hash = HashBlock(yRow + px, yStride, uRow + px / 2, uStride, vRow + px / 2, vStride);
+			else
+				hash = HashPartialBlock(yRow + px, yStride, uRow + px / 2, uStride, vRow + px / 2, vStride, width, height);
+			size_t index = (size_t)by * m_blocksX + bx;
+			if (first || hash != m_hashes[index]) {
+				m_hashes[index] = hash;
+				m_generations[index] = m_generation;
+				m_changedArea += width * height;
+				++dirty;
+			}
+		}
+	}
+	MergeRects(m_generation, m_rects);
+	return dirty;
+}
+
+double CDirtyRegionDetector::GetChangedRatio() const
+{
+	int64_t area = (int64_t)m_width * m_height;
+	return area ? (double)m_changedArea / area : 0.0;
+}
+
+void CDirtyRegionDetector::CollectDirtySince(uint32_t generation, std::vector<DirtyRect>& rects)
+{
+	MergeRects(generation + 1, rects);
+}
+
+//merge blocks with a generation of at least the given one.
+void CDirtyRegionDetector::MergeRects(uint32_t generation, std::vector<DirtyRect>& rects)
+{
+	rects.clear();
+	m_open.clear();
+	for (int by = 0; by < m_blocksY; ++by) {
+		m_nextOpen.clear();
+		const uint32_t* row = &m_generations[(size_t)by * m_blocksX];
+		int py = by * BLOCK_SIZE;
+		int height = m_height - py < BLOCK_SIZE ? m_height - py : BLOCK_SIZE;
+		size_t open = 0;
+		for (int bx = 0; bx < m_blocksX;) {
+			if (row[bx] < generation) {
+				++bx;
+				continue;
+			}
+			int start = bx;
+			while (bx < m_blocksX && row[bx] >= generation)
+				++bx;
+			int x = start * BLOCK_SIZE;
+			int width = (bx * BLOCK_SIZE < m_width ? bx * BLOCK_SIZE : m_width) - x;
+			//open rects are sorted by x, so one forward scan finds a match.
+			while (open < m_open.size() && rects[m_open[open]].x < x)
+				++open;
+			if (open < m_open.size() && rects[m_open[open]].x == x && rects[m_open[open]].width == width) {
+				rects[m_open[open]].height += height;
+				m_nextOpen.push_back(m_open[open]);
+			}
+			else {
+				DirtyRect rect = { x, py, width, height };
+				m_nextOpen.push_back((int)rects.size());
+				rects.push_back(rect);
+			}
+		}
+		m_open.swap(m_nextOpen);
+	}
+}
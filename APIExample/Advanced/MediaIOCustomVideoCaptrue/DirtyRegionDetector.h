@@ -0,0 +1,78 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+//changed area of a frame in pixels.
+struct DirtyRect {
+	int x;
+	int y;
+	int width;
+	int height;
+};
+
+/*
+	Finds the parts of an I420 frame that changed since the previous one.
+	The frame is cut into 16x16 blocks (plus the matching 8x8 chroma
+	blocks), every block is hashed and compared with its hash from the
+	previous frame, so no copy of the previous frame is kept. A block
+	that changed gets the current frame number as its generation, which
+	also answers "what changed since frame N" for consumers that fall
+	behind. Dirty blocks are merged into rectangles: runs of blocks per
+	block row, and runs with the same columns in consecutive rows.
+	Full blocks are hashed with SSE2 where available.
+*/
+class CDirtyRegionDetector
+{
+public:
+	enum {
+		BLOCK_SIZE = 16,
+	};
+
+	CDirtyRegionDetector();
+	~CDirtyRegionDetector();
+
+	//frame size in pixels, forgets all hashes.
+	void Configure(int width, int height);
+	int GetWidth() const { return m_width; }
+	int GetHeight() const { return m_height; }
+
+	//hash the frame and return the number of dirty blocks. the first frame
+	//after Configure is all dirty.
+	int Detect(const uint8_t* y, int yStride, const uint8_t* u, int uStride, const uint8_t* v, int vStride);
+	//contiguous I420 frame.
+	int Detect(const uint8_t* frame);
+
+	//generation of the last Detect, starts at 1.
+	uint32_t GetGeneration() const { return m_generation; }
+	//rectangles of the last Detect.
+	const std::vector<DirtyRect>& GetDirtyRects() const { return m_rects; }
+	//pixels covered by the dirty blocks of the last Detect.
+	int64_t GetChangedArea() const { return m_changedArea; }
+	double GetChangedRatio() const;
+	//blocks changed after the given generation, merged like GetDirtyRects.
+	void CollectDirtySince(uint32_t generation, std::vector<DirtyRect>& rects);
+
+	//exposed for checking the SIMD and scalar hashes against each other.
+	static uint64_t HashBlock(const uint8_t* y, int yStride, const uint8_t* u, int uStride, const uint8_t* v, int vStride);
+	static uint64_t HashBlockScalar(const uint8_t* y, int yStride, const uint8_t* u, int uStride, const uint8_t* v, int vStride);
+
+private:
+	static uint64_t HashPartialBlock(const uint8_t* y, int yStride, const uint8_t* u, int uStride,
+		const uint8_t* v, int vStride, int width, int height);
+	void MergeRects(uint32_t generation, std::vector<DirtyRect>& rects);
+
+	int m_width = 0;
+	int m_height = 0;
+	int m_blocksX = 0;
+	int m_blocksY = 0;
+	std::vector<uint64_t> m_hashes;
+	std::vector<uint32_t> m_generations;
+	uint32_t m_generation = 0;
+
+	std::vector<DirtyRect> m_rects;
+	int64_t m_changedArea = 0;
+	//rectangles still open for extension into the next block row, reused.
+	std::vector<int> m_open;
+	std::vector<int> m_nextOpen;
+};
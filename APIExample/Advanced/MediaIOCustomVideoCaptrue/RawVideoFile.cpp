@@ -0,0 +1,274 @@
+#include "RawVideoFile.h"
+//no stdafx.h, the file capture backend builds this without MFC.
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+CRawVideoFile::CRawVideoFile()
+{
+}
+
+CRawVideoFile::~CRawVideoFile()
+{
+	Close();
+}
+
+size_t CRawVideoFile::GetFrameSize(RawVideoFormat format, int width, int height)
+{
+	if (width <= 0 || height <= 0)
+		return 0;
+	size_t luma = (size_t)width * height;
+	size_t chroma = (size_t)((width + 1) / 2) * ((height + 1) / 2);
+	switch (format) {
+	case RAW_VIDEO_I420:
+	case RAW_VIDEO_NV12:
+		return luma + chroma * 2;
+	case RAW_VIDEO_RGBA:
+		return luma * 4;
+	}
+	return 0;
+}
+
+#ifdef _WIN32
+bool CRawVideoFile::Open(const wchar_t* path, RawVideoFormat format, int width, int height)
+{
+	Close();
+	HANDLE hFile = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+	m_hFile = hFile;
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(hFile, &fileSize) || !Setup(fileSize.QuadPart, format, width, height)) {
+		Close();
+		return false;
+	}
+	//a mapping object of the whole file takes no address space, only views do.
+	m_hMapping = CreateFileMappingW(m_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!m_hMapping) {
+		Close();
+		return false;
+	}
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	m_granularity = info.dwAllocationGranularity;
+	return true;
+}
+
+void CRawVideoFile::Close()
+{
+	if (m_hMapping)
+		CloseHandle(m_hMapping);
+	if (m_hFile)
+		CloseHandle(m_hFile);
+	m_hMapping = nullptr;
+	m_hFile = nullptr;
+	m_frameCount = 0;
+}
+
+void* CRawVideoFile::MapView(uint64_t offset, size_t size, const uint8_t*& data, size_t& mappedSize) const
+{
+	uint64_t aligned = offset / m_granularity * m_granularity;
+	mappedSize = (size_t)(offset - aligned) + size;
+	void* base = MapViewOfFile(m_hMapping, FILE_MAP_READ, (DWORD)(aligned >> 32), (DWORD)aligned, mappedSize);
+	if (base)
+		data = (const uint8_t*)base + (offset - aligned);
+	return base;
+}
+
+void CRawVideoFile::UnmapView(void* base, size_t)
+{
+	UnmapViewOfFile(base);
+}
+#else
+bool CRawVideoFile::Open(const char* path, RawVideoFormat format, int width, int height)
+{
+	Close();
+	m_fd = open(path, O_RDONLY);
+	if (m_fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(m_fd, &st) != 0 || !Setup((int64_t)st.st_size, format, width, height)) {
+		Close();
+		return false;
+	}
+	m_granularity = (size_t)sysconf(_SC_PAGESIZE);
+	return true;
+}
+
+void CRawVideoFile::Close()
+{
+	if (m_fd >= 0)
+		close(m_fd);
+	m_fd = -1;
+	m_frameCount = 0;
+}
+
+void* CRawVideoFile::MapView(uint64_t offset, size_t size, const uint8_t*& data, size_t& mappedSize) const
+{
+	uint64_t aligned = offset / m_granularity * m_granularity;
+	mappedSize = (size_t)(offset - aligned) + size;
+	void* base = mmap(NULL, mappedSize, PROT_READ, MAP_SHARED, m_fd, (off_t)aligned);
+	if (base == MAP_FAILED)
+		return nullptr;
+	madvise(base, mappedSize, MADV_SEQUENTIAL);
+	data = (const uint8_t*)base + (offset - aligned);
+	return base;
+}
+
+void CRawVideoFile::UnmapView(void* base, size_t mappedSize)
+{
+	munmap(base, mappedSize);
+}
+#endif
+
+//the whole frames of the open file.
+bool CRawVideoFile::Setup(int64_t fileSize, RawVideoFormat format, int width, int height)
+{
+	size_t frameSize = GetFrameSize(format, width, height);
+	if (frameSize == 0 || fileSize < (int64_t)frameSize)
+		return false;
+	int64_t frameCount = fileSize / (int64_t)frameSize;
+	if (frameCount > INT32_MAX)
+		frameCount = INT32_MAX;
+	m_format = format;
+	m_width = width;
+	m_height = height;
+	m_frameSize = frameSize;
+	m_frameCount = (int)frameCount;
+	return true;
+}
+
+CRawVideoWindow::CRawVideoWindow(std::shared_ptr<const CRawVideoFile> file, size_t windowBytes)
+	: m_file(file)
+{
+	if (m_file && m_file->GetFrameSize() && windowBytes / m_file->GetFrameSize() > 1)
+		m_windowFrames = (int)(windowBytes / m_file->GetFrameSize());
+}
+
+CRawVideoWindow::~CRawVideoWindow()
+{
+	Unmap();
+}
+
+void CRawVideoWindow::Unmap()
+{
+	if (m_base)
+		CRawVideoFile::UnmapView(m_base, m_mappedSize);
+	m_base = nullptr;
+	m_data = nullptr;
+	m_mappedSize = 0;
+	m_count = 0;
+}
+
+bool CRawVideoWindow::GetFrame(int index, RawVideoFrame& frame)
+{
+	if (!m_file || index < 0 || index >= m_file->GetFrameCount())
+		return false;
+	size_t frameSize = m_file->GetFrameSize();
+	if (index < m_first || index >= m_first + m_count) {
+		Unmap();
+		int count = m_file->GetFrameCount() - index < m_windowFrames ? m_file->GetFrameCount() - index : m_windowFrames;
+		m_base = m_file->MapView((uint64_t)index * frameSize, (size_t)count * frameSize, m_data, m_mappedSize);
+		if (!m_base)
+			return false;
+		m_first = index;
+		m_count = count;
+		++m_mapCount;
+	}
+	int width = m_file->GetWidth();
+	int height = m_file->GetHeight();
+	frame.index = index;
+	frame.width = width;
+	frame.height = height;
+	frame.format = m_file->GetFormat();
+	frame.data = m_data + (size_t)(index - m_first) * frameSize;
+	frame.size = frameSize;
+	size_t luma = (size_t)width * height;
+	int chromaWidth = (width + 1) / 2;
+	switch (frame.format) {
+	case RAW_VIDEO_I420:
+		frame.planes[0] = frame.data;
+		frame.planes[1] = frame.data + luma;
+		frame.planes[2] = frame.planes[1] + (size_t)chromaWidth * ((height + 1) / 2);
+		frame.strides[0] = width;
+		frame.strides[1] = chromaWidth;
+		frame.strides[2] = chromaWidth;
+		break;
+	case RAW_VIDEO_NV12:
+		frame.planes[0] = frame.data;
+		frame.planes[1] = frame.data + luma;
+		frame.planes[2] = nullptr;
+		frame.strides[0] = width;
+		frame.strides[1] = chromaWidth * 2;
+		frame.strides[2] = 0;
+		break;
+	case RAW_VIDEO_RGBA:
+		frame.planes[0] = frame.data;
+		frame.planes[1] = frame.planes[2] = nullptr;
+		frame.strides[0] = width * 4;
+		frame.strides[1] = frame.strides[2] = 0;
+		break;
+	}
+	return true;
+}
+
+CRawVideoReader::CRawVideoReader(std::shared_ptr<const CRawVideoFile> file)
+	: m_file(file), m_window(file)
+{
+}
+
+bool CRawVideoReader::Seek(int index)
+{
+	if (!m_file || index < 0 || index >= m_file->GetFrameCount())
+		return false;
+	m_position = index;
+	return true;
+}
+
+bool CRawVideoReader::IsFinished() const
+{
+	return !m_file || m_file->GetFrameCount() == 0 || (!m_loop && m_position >= m_file->GetFrameCount());
+}
+
+int64_t CRawVideoReader::GetDueMs() const
+{
+	return m_startMs + m_sinceStart * 1000 / m_fps;
+}
+
+bool CRawVideoReader::NextFrame(int64_t nowMs, RawVideoFrame& frame)
+{
+	if (IsFinished())
+		return false;
+	if (m_startMs < 0 || nowMs - GetDueMs() > 1000 / m_fps) {
+		if (m_startMs >= 0)
+			++m_late;
+		m_startMs = nowMs;
+		m_sinceStart = 0;
+	}
+	if (nowMs < GetDueMs())
+		return false;
+	if (m_position >= m_file->GetFrameCount())
+		m_position = 0;
+	if (!m_window.GetFrame(m_position, frame))
+		return false;
+	++m_position;
+	if (m_loop && m_position >= m_file->GetFrameCount())
+		m_position = 0;
+	++m_sinceStart;
+	++m_delivered;
+	return true;
+}
+
+int64_t CRawVideoReader::GetWaitMs(int64_t nowMs) const
+{
+	if (m_startMs < 0)
+		return 0;
+	int64_t wait = GetDueMs() - nowMs;
+	return wait > 0 ? wait : 0;
+}
@@ -0,0 +1,166 @@
+#pragma once
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+
+enum RawVideoFormat {
+	//planar Y, U, V.
+	RAW_VIDEO_I420,
+	//planar Y, interleaved UV.
+	RAW_VIDEO_NV12,
+	//packed 4 bytes per pixel.
+	RAW_VIDEO_RGBA,
+};
+
+//view of one frame inside a mapped window, valid until the window that
+//handed it out maps another part of the file.
+struct RawVideoFrame {
+	int index = -1;
+	int width = 0;
+	int height = 0;
+	RawVideoFormat format = RAW_VIDEO_I420;
+	//whole frame, contiguous.
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+	//Y/U/V for I420, Y/UV for NV12, RGBA only in plane 0.
+	const uint8_t* planes[3] = {};
+	int strides[3] = {};
+};
+
+/*
+	A raw video file (frames back to back, no header) opened read only.
+	The file itself maps nothing: CRawVideoWindow maps a window of whole
+	frames at a time and hands out views into it, nothing is copied, so
+	neither memory nor the address space of a 32 bit process limits the
+	file size. A trailing partial frame is ignored.
+	The file never changes after Open, any number of windows and readers
+	can share one through a shared_ptr.
+*/
+class CRawVideoFile
+{
+public:
+	CRawVideoFile();
+	~CRawVideoFile();
+
+	static size_t GetFrameSize(RawVideoFormat format, int width, int height);
+
+#ifdef _WIN32
+	bool Open(const wchar_t* path, RawVideoFormat format, int width, int height);
+#else
+	bool Open(const char* path, RawVideoFormat format, int width, int height);
+#endif
+	void Close();
+
+	bool IsOpen() const { return m_frameCount > 0; }
+	int GetFrameCount() const { return m_frameCount; }
+	int GetWidth() const { return m_width; }
+	int GetHeight() const { return m_height; }
+	RawVideoFormat GetFormat() const { return m_format; }
+	size_t GetFrameSize() const { return m_frameSize; }
+
+private:
+	friend class CRawVideoWindow;
+	CRawVideoFile(const CRawVideoFile&) = delete;
+	CRawVideoFile& operator=(const CRawVideoFile&) = delete;
+	bool Setup(int64_t fileSize, RawVideoFormat format, int width, int height);
+	//maps size bytes at offset, rounded out to the allocation granularity.
+	//returns the view base, data points at offset inside it.
+	void* MapView(uint64_t offset, size_t size, const uint8_t*& data, size_t& mappedSize) const;
+	static void UnmapView(void* base, size_t mappedSize);
+
+#ifdef _WIN32
+	void* m_hFile = nullptr;
+	void* m_hMapping = nullptr;
+#else
+	int m_fd = -1;
+#endif
+	size_t m_granularity = 0;
+	RawVideoFormat m_format = RAW_VIDEO_I420;
+	int m_width = 0;
+	int m_height = 0;
+	size_t m_frameSize = 0;
+	int m_frameCount = 0;
+};
+
+/*
+	Maps a CRawVideoFile a window of whole frames at a time and hands out
+	frame views into it. Asking for a frame outside the window moves the
+	window so it starts at that frame. The window holds at least one frame,
+	otherwise as many as fit into windowBytes.
+	One thread at a time, each reader has its own window.
+*/
+class CRawVideoWindow
+{
+public:
+	enum {
+		DEFAULT_WINDOW_BYTES = 32 * 1024 * 1024,
+	};
+
+	explicit CRawVideoWindow(std::shared_ptr<const CRawVideoFile> file, size_t windowBytes = DEFAULT_WINDOW_BYTES);
+	~CRawVideoWindow();
+
+	//false if the index is out of range or the window can not be mapped.
+	bool GetFrame(int index, RawVideoFrame& frame);
+	int GetWindowFrames() const { return m_windowFrames; }
+	//windows mapped so far.
+	uint64_t GetMapCount() const { return m_mapCount; }
+
+private:
+	CRawVideoWindow(const CRawVideoWindow&) = delete;
+	CRawVideoWindow& operator=(const CRawVideoWindow&) = delete;
+	void Unmap();
+
+	std::shared_ptr<const CRawVideoFile> m_file;
+	int m_windowFrames = 1;
+	void* m_base = nullptr;
+	size_t m_mappedSize = 0;
+	//first frame of the window and where it starts in memory.
+	int m_first = 0;
+	int m_count = 0;
+	const uint8_t* m_data = nullptr;
+	uint64_t m_mapCount = 0;
+};
+
+/*
+	One virtual source reading a CRawVideoFile through its own window: its
+	own position, looping and frame rate. Frames are due at fixed intervals from the first one;
+	a reader that falls more than a frame behind restarts the clock
+	instead of bursting to catch up.
+*/
+class CRawVideoReader
+{
+public:
+	explicit CRawVideoReader(std::shared_ptr<const CRawVideoFile> file);
+
+	void SetFrameRate(int fps) { m_fps = fps > 0 ? fps : 1; m_startMs = -1; }
+	void SetLoop(bool loop) { m_loop = loop; }
+	//next frame to deliver, false if the index is out of range.
+	bool Seek(int index);
+	int GetPosition() const { return m_position; }
+	//past the last frame of a file that does not loop.
+	bool IsFinished() const;
+
+	//the frame due at nowMs, false if it is not due yet or the reader is
+	//finished. the frame stays valid until the next call.
+	bool NextFrame(int64_t nowMs, RawVideoFrame& frame);
+	//ms until the next frame is due, 0 if it is due now.
+	int64_t GetWaitMs(int64_t nowMs) const;
+
+	uint64_t GetDeliveredCount() const { return m_delivered; }
+	//times the clock was restarted because the reader fell behind.
+	uint64_t GetLateCount() const { return m_late; }
+
+private:
+	int64_t GetDueMs() const;
+
+	std::shared_ptr<const CRawVideoFile> m_file;
+	CRawVideoWindow m_window;
+	int m_fps = 15;
+	bool m_loop = true;
+	int m_position = 0;
+	//frame n is due at m_startMs + n * 1000 / m_fps, -1 before the first one.
+	int64_t m_startMs = -1;
+	int64_t m_sinceStart = 0;
+	uint64_t m_delivered = 0;
+	uint64_t m_late = 0;
+};
@@ -39,6 +39,7 @@ BEGIN_MESSAGE_MAP(CAgoraMultiChannelDlg, CDialogEx)
 	ON_MESSAGE(WM_MSGID(EID_USER_JOINED), &CAgoraMultiChannelDlg::OnEIDUserJoined)
 	ON_MESSAGE(WM_MSGID(EID_USER_OFFLINE), &CAgoraMultiChannelDlg::OnEIDUserOffline)
 	ON_MESSAGE(WM_MSGID(EID_REMOTE_VIDEO_STATE_CHANED), &CAgoraMultiChannelDlg::OnEIDRemoteVideoStateChanged)
+	ON_MESSAGE(WM_MSGID(EID_EVENT_BUS), &CAgoraMultiChannelDlg::OnEIDEventBus)
 	ON_BN_CLICKED(IDC_BUTTON_JOINCHANNEL, &CAgoraMultiChannelDlg::OnBnClickedButtonJoinchannel)
 	ON_BN_CLICKED(IDC_BUTTON_LEAVE_CHANNEL, &CAgoraMultiChannelDlg::OnBnClickedButtonLeaveChannel)
 	ON_LBN_SELCHANGE(IDC_LIST_INFO_BROADCASTING, &CAgoraMultiChannelDlg::OnSelchangeListInfoBroadcasting)
@@ -59,12 +60,6 @@ void CAgoraMultiChannelDlg::InitCtrlText()
 //Initialize the Agora SDK
 bool CAgoraMultiChannelDlg::InitAgora()
 {
-	//create Agora RTC engine
-	m_rtcEngine = createAgoraRtcEngine();
-	if (!m_rtcEngine) {
-		m_lstInfo.InsertString(m_lstInfo.GetCount() - 1, _T("createAgoraRtcEngine failed"));
-		return false;
-	}
 	//set message notify receiver window
 	m_eventHandler.SetMsgReceiver(m_hWnd);
 
@@ -72,8 +67,9 @@ bool CAgoraMultiChannelDlg::InitAgora()
 	std::string strAppID = GET_APP_ID;
 	context.appId = strAppID.c_str();
 	context.eventHandler = &m_eventHandler;
-	//initialize the Agora RTC engine context.
-	int ret = m_rtcEngine->initialize(context);
+	//borrow the shared engine, this registers our event handler.
+	int ret = m_engineLease.Acquire(context);
+	m_rtcEngine = m_engineLease.GetEngine();
 	if (ret != 0) {
 		m_initialize = false;
 		CString strInfo;
@@ -98,20 +94,15 @@ bool CAgoraMultiChannelDlg::InitAgora()
 void CAgoraMultiChannelDlg::UnInitAgora()
 {
 	if (m_rtcEngine) {
-		for (auto &info : m_channels)
-		{
-			info.channel->release();
-			delete info.evnetHandler;
-		}
-		m_channels.clear();
+		ReleaseAllChannels();
 		//stop preview in the engine.
 		m_rtcEngine->stopPreview();
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("stopPreview"));
 		//disable video in the engine.
 		m_rtcEngine->disableVideo();
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("disableVideo"));
-		//release engine.
-		m_rtcEngine->release(true);
+		//give the engine back to the host.
+		m_engineLease.Release();
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("release rtc engine"));
 		m_rtcEngine = NULL;
 	}
@@ -143,12 +134,7 @@ void CAgoraMultiChannelDlg::ResumeStatus()
 	m_staDetail.SetWindowText(_T(""));
 	m_edtChannel.SetWindowText(_T(""));
 	m_cmbChannelList.ResetContent();
-	for (auto &info:m_channels)
-	{
-		info.channel->release();
-		delete info.evnetHandler;
-	}
-	m_channels.clear();
+	ReleaseAllChannels();
 	m_joinChannel = false;
 	m_initialize = false;
 	m_audioMixing = false;
@@ -158,6 +144,29 @@ void CAgoraMultiChannelDlg::ResumeStatus()
 }
 
 
+//release the channel and forget it.
+void CAgoraMultiChannelDlg::ReleaseChannel(ChannelHandle handle)
+{
+	if (!m_channelManager.IsValid(handle))
+		return;
+	ChannelInfo& info = m_channels[CChannelManager::GetSlot(handle)];
+	//no callbacks after release, the channel queue can go.
+	info.channel->release();
+	delete info.evnetHandler;
+	info = ChannelInfo();
+	m_channelManager.RemoveChannel(handle);
+}
+
+//release every channel.
+void CAgoraMultiChannelDlg::ReleaseAllChannels()
+{
+	std::vector<ChannelView> views;
+	m_channelManager.GetChannelViews(views);
+	for (auto &view : views)
+		ReleaseChannel(view.handle);
+}
+
+
 
 void CAgoraMultiChannelDlg::OnShowWindow(BOOL bShow, UINT nStatus)
 {
@@ -184,6 +193,14 @@ BOOL CAgoraMultiChannelDlg::OnInitDialog()
 
 	m_chkPublishAudio.SetWindowText(mediaPlayerCtrlPublishAudio);
 	m_chkPublishVideo.SetWindowText(mediaPlayerCtrlPublishVideo);
+
+	//every channel has its own event queue, one wakeup message for all of them.
+	HWND hWnd = m_hWnd;
+	m_channelManager.SetWakeup([hWnd]() { ::PostMessage(hWnd, WM_MSGID(EID_EVENT_BUS), 0, 0); });
+	m_channelManager.Subscribe(EID_JOINCHANNEL_SUCCESS, [this](ChannelHandle handle, const AgoraEvent& event) { OnChannelJoinSuccess(handle, event); });
+	m_channelManager.Subscribe(EID_LEAVE_CHANNEL, [this](ChannelHandle handle, const AgoraEvent& event) { OnChannelLeave(handle, event); });
+	m_channelManager.Subscribe(EID_USER_JOINED, [this](ChannelHandle handle, const AgoraEvent& event) { OnChannelUserJoined(handle, event); });
+	m_channelManager.Subscribe(EID_USER_OFFLINE, [this](ChannelHandle handle, const AgoraEvent& event) { OnChannelUserOffline(handle, event); });
 	ResumeStatus();
 	return TRUE;  
 }
@@ -220,14 +237,22 @@ void CAgoraMultiChannelDlg::OnBnClickedButtonJoinchannel()
 			return;
 		}
 	}
+	//add the channel to the channel manager, it gets its own event queue.
+	ChannelHandle handle = m_channelManager.AddChannel(szChannelId);
+	if (!handle) {
+		AfxMessageBox(_T("too many channels!"));
+		return;
+	}
 	//create channel by channel id.
 	IChannel * pChannel = static_cast<IRtcEngine2 *>(m_rtcEngine)->createChannel(szChannelId.c_str());
 	//create channel event handler.
 	ChannelEventHandler* pEvt = new ChannelEventHandler;
-	//set message receiver window.
-	pEvt->setMsgHandler(GetSafeHwnd());
+	//post the channel events into its queue.
+	pEvt->setChannelManager(&m_channelManager, handle);
 	//add channels.
-	m_channels.emplace_back(szChannelId, pChannel, pEvt);
+	ChannelInfo& info = m_channels[CChannelManager::GetSlot(handle)];
+	info.channel = pChannel;
+	info.evnetHandler = pEvt;
 	//set channel event handler.
 	pChannel->setChannelEventHandler(pEvt);
 	ChannelMediaOptions options;
@@ -262,22 +287,14 @@ void CAgoraMultiChannelDlg::OnBnClickedButtonLeaveChannel()
 	CString strChannelName;
 	m_cmbChannelList.GetWindowText(strChannelName);
 	std::string szChannelName = cs2utf8(strChannelName);
-	bool bFind = false;
-
-	int i = 0;
-	for (auto & channelInfo : m_channels)
+	ChannelHandle handle = m_channelManager.FindChannel(szChannelName);
+	if (handle)
 	{
-		if (channelInfo.channelName == szChannelName)
-		{
-			//leave other channel
-			channelInfo.channel->leaveChannel();
-			strInfo.Format(_T("leave channel %s"), strChannelName);
-			bFind = true;
-			break;
-		}
-		i++;
+		//leave other channel
+		m_channels[CChannelManager::GetSlot(handle)].channel->leaveChannel();
+		strInfo.Format(_T("leave channel %s"), strChannelName);
 	}
-	if (!bFind)
+	else
 	{
 		//leave main channel in the engine.
 		if (0 == m_rtcEngine->leaveChannel()) {
@@ -303,80 +320,31 @@ void CAgoraMultiChannelDlg::OnSelchangeListInfoBroadcasting()
 //EID_JOINCHANNEL_SUCCESS message window handler
 LRESULT CAgoraMultiChannelDlg::OnEIDJoinChannelSuccess(WPARAM wParam, LPARAM lParam)
 {
-	IChannel* pChannel = (IChannel*)wParam;
 	m_joinChannel = true;
 	m_btnJoinChannel.EnableWindow(TRUE);
 	CString strInfo;
-	if (pChannel == 0)
-	{
-		strInfo.Format(_T("join :%s success, uid=:%u"), m_strMainChannel, lParam);
-		m_localVideoWnd.SetUID(lParam);
-		m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
-	}
-	else {
-		for (auto & info:m_channels)
-		{
-			if (info.channel == pChannel)
-			{
-				strInfo.Format(_T("join :%s success, uid=:%u"),utf82cs(info.channelName), lParam);
-				m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
-			}
-		}
-	}
+	strInfo.Format(_T("join :%s success, uid=:%u"), m_strMainChannel, lParam);
+	m_localVideoWnd.SetUID(lParam);
+	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
 	return 0;
 }
 
 //EID_LEAVEHANNEL_SUCCESS message window handler
 LRESULT CAgoraMultiChannelDlg::OnEIDLeaveChannel(WPARAM wParam, LPARAM lParam)
 {
-	IChannel* pChannel = (IChannel*)wParam;
 	CString strInfo;
-	if (pChannel == 0)
-	{
-		strInfo.Format(_T("leave %s channel success"), m_strMainChannel);
-		m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
-		m_joinChannel = false;
-	}
-	else {
-		int i = 0;
-		for (auto & info:m_channels)
-		{
-			if (info.channel == pChannel)
-			{
-				strInfo.Format(_T("leave %s channel success"), utf82cs(info.channelName));
-				m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
-				info.channel->release();
-				delete info.evnetHandler;
-				m_channels.erase(m_channels.begin() + i);
-				break;
-			}
-			i++;
-		}
-	}
+	strInfo.Format(_T("leave %s channel success"), m_strMainChannel);
+	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
+	m_joinChannel = false;
 	return 0;
 }
 
 //EID_USER_JOINED message window handler
 LRESULT CAgoraMultiChannelDlg::OnEIDUserJoined(WPARAM wParam, LPARAM lParam)
 {
-	IChannel* pChannel = (IChannel*)wParam;
 	CString strInfo;
-	if (pChannel == 0)
-	{
-		strInfo.Format(_T("%u joined %s"), lParam, m_strMainChannel);
-		m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
-	}
-	else {
-		for (auto & info : m_channels)
-		{
-			if (info.channel == pChannel)
-			{
-				strInfo.Format(_T("%u joined %s"), lParam, utf82cs(info.channelName));
-				m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
-				break;
-			}
-		}
-	}
+	strInfo.Format(_T("%u joined %s"), lParam, m_strMainChannel);
+	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
 	return 0;
 }
 
@@ -384,29 +352,13 @@ LRESULT CAgoraMultiChannelDlg::OnEIDUserJoined(WPARAM wParam, LPARAM lParam)
 LRESULT CAgoraMultiChannelDlg::OnEIDUserOffline(WPARAM wParam, LPARAM lParam)
 {
 	CString strInfo;
-	IChannel* pChannel = (IChannel*)wParam;
 	uid_t remoteUid = (uid_t)lParam;
 	VideoCanvas canvas;
 	canvas.uid = remoteUid;
 	canvas.view = NULL;
-	
-	if (pChannel == 0)
-	{
-		strInfo.Format(_T("%u offline %s"), remoteUid, m_strMainChannel);
-		m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
-		m_rtcEngine->setupRemoteVideo(canvas);
-	}
-	else {
-		for (auto & info : m_channels)
-		{
-			if (info.channel == pChannel)
-			{
-				strInfo.Format(_T("%u offline %s"), remoteUid, utf82cs(info.channelName));
-				m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
-				break;
-			}
-		}
-	}
+	strInfo.Format(_T("%u offline %s"), remoteUid, m_strMainChannel);
+	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
+	m_rtcEngine->setupRemoteVideo(canvas);
 	return 0;
 }
 
@@ -441,6 +393,49 @@ LRESULT CAgoraMultiChannelDlg::OnEIDRemoteVideoStateChanged(WPARAM wParam, LPARA
 	return 0;
 }
 
+//wakeup message from the channel manager.
+LRESULT CAgoraMultiChannelDlg::OnEIDEventBus(WPARAM wParam, LPARAM lParam)
+{
+	m_channelManager.Dispatch();
+	return 0;
+}
+
+//join success of a channel created by createChannel.
+void CAgoraMultiChannelDlg::OnChannelJoinSuccess(ChannelHandle handle, const AgoraEvent& event)
+{
+	m_btnJoinChannel.EnableWindow(TRUE);
+	CString strInfo;
+	strInfo.Format(_T("join :%s success, uid=:%u"), utf82cs(m_channelManager.GetChannelId(handle)), event.uid);
+	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
+}
+
+//leave success of a channel created by createChannel.
+void CAgoraMultiChannelDlg::OnChannelLeave(ChannelHandle handle, const AgoraEvent& event)
+{
+	if (!m_channelManager.IsValid(handle))
+		return;
+	CString strInfo;
+	strInfo.Format(_T("leave %s channel success"), utf82cs(m_channelManager.GetChannelId(handle)));
+	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
+	ReleaseChannel(handle);
+}
+
+//remote user joined a channel created by createChannel.
+void CAgoraMultiChannelDlg::OnChannelUserJoined(ChannelHandle handle, const AgoraEvent& event)
+{
+	CString strInfo;
+	strInfo.Format(_T("%u joined %s"), event.uid, utf82cs(m_channelManager.GetChannelId(handle)));
+	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
+}
+
+//remote user left a channel created by createChannel.
+void CAgoraMultiChannelDlg::OnChannelUserOffline(ChannelHandle handle, const AgoraEvent& event)
+{
+	CString strInfo;
+	strInfo.Format(_T("%u offline %s"), event.uid, utf82cs(m_channelManager.GetChannelId(handle)));
+	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
+}
+
 
 
 /*
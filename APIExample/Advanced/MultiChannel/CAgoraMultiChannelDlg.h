@@ -1,5 +1,6 @@
 ﻿#pragma once
 #include "AGVideoWnd.h"
+#include "ChannelManager.h"
 
 class CMultiChannelEventHandler : public IRtcEngineEventHandler
 {
@@ -84,14 +85,27 @@ private:
 class ChannelEventHandler :public agora::rtc::IChannelEventHandler
 {
 private:
-	HWND m_hMsgHanlder;
+	CChannelManager* m_channelManager = nullptr;
+	ChannelHandle m_channelHandle = 0;
+
+	void PostEvent(int type, uid_t uid, int param0)
+	{
+		if (!m_channelManager)
+			return;
+		AgoraEvent event;
+		event.type = type;
+		event.uid = uid;
+		event.data.params[0] = param0;
+		m_channelManager->PostEvent(m_channelHandle, event);
+	}
 
 public:
 
-	void setMsgHandler(HWND msgHandler)
+	//events go into the queue of this channel in the channel manager.
+	void setChannelManager(CChannelManager* channelManager, ChannelHandle channelHandle)
 	{
-		this->m_hMsgHanlder = msgHandler;
-
+		m_channelManager = channelManager;
+		m_channelHandle = channelHandle;
 	}
 
 	/** Reports the warning code of `IChannel`.
@@ -120,8 +134,7 @@ public:
 	 @param elapsed Time elapsed (ms) from the local user calling \ref IChannel::joinChannel "joinChannel" until this callback is triggered.
 	 */
 	virtual void onJoinChannelSuccess(IChannel *rtcChannel, uid_t uid, int elapsed) {
-		if (m_hMsgHanlder)
-			::PostMessage(m_hMsgHanlder, WM_MSGID(EID_JOINCHANNEL_SUCCESS), (WPARAM)rtcChannel, uid);
+		PostEvent(EID_JOINCHANNEL_SUCCESS, uid, elapsed);
 	}
 	/** Occurs when a user rejoins the channel after being disconnected due to network problems.
 
@@ -142,8 +155,7 @@ public:
 	 @param stats The call statistics: RtcStats.
 	 */
 	virtual void onLeaveChannel(IChannel *rtcChannel, const RtcStats& stats) {
-		if (m_hMsgHanlder)
-			::PostMessage(m_hMsgHanlder, WM_MSGID(EID_LEAVE_CHANNEL), (WPARAM)rtcChannel, 0);
+		PostEvent(EID_LEAVE_CHANNEL, 0, 0);
 	}
 	/** Occurs when the user role switches in the live interactive streaming. For example, from a host to an audience or vice versa.
 
@@ -178,8 +190,7 @@ public:
 	 @param elapsed Time delay (ms) from the local user calling the \ref IChannel::joinChannel "joinChannel" method until the SDK triggers this callback.
 	 */
 	virtual void onUserJoined(IChannel *rtcChannel, uid_t uid, int elapsed) {
-		if (m_hMsgHanlder)
-			::PostMessage(m_hMsgHanlder, WM_MSGID(EID_USER_JOINED), (WPARAM)rtcChannel, (LPARAM)uid);
+		PostEvent(EID_USER_JOINED, uid, elapsed);
 	}
 	/** Occurs when a remote user ( `COMMUNICATION`)/host (`LIVE_BROADCASTING`) leaves the channel.
 
@@ -193,8 +204,7 @@ public:
 	 @param reason Reason why the user is offline: #USER_OFFLINE_REASON_TYPE.
 	 */
 	virtual void onUserOffline(IChannel *rtcChannel, uid_t uid, USER_OFFLINE_REASON_TYPE reason) {
-		if (m_hMsgHanlder)
-			::PostMessage(m_hMsgHanlder, WM_MSGID(EID_USER_OFFLINE), (WPARAM)rtcChannel, (LPARAM)uid);
+		PostEvent(EID_USER_OFFLINE, uid, reason);
 	}
 	/** Occurs when the SDK cannot reconnect to Agora's edge server 10 seconds after its connection to the server is interrupted.
 
@@ -545,14 +555,11 @@ public:
 };
 
 
+//SDK objects of one channel, kept in the slot of its channel handle.
 struct ChannelInfo
 {
-	std::string channelName;
-	IChannel* channel;
-	IChannelEventHandler* evnetHandler;
-
-	ChannelInfo(std::string channelName_,IChannel* channel_,IChannelEventHandler *eventHandler_):
-		channelName(channelName_), channel(channel_), evnetHandler(eventHandler_){}
+	IChannel* channel = nullptr;
+	IChannelEventHandler* evnetHandler = nullptr;
 };
 
 class CAgoraMultiChannelDlg : public CDialogEx
@@ -575,14 +582,20 @@ public:
 	void RenderLocalVideo();
 	//resume window status
 	void ResumeStatus();
+	//release the channel and forget it.
+	void ReleaseChannel(ChannelHandle handle);
+	//release every channel.
+	void ReleaseAllChannels();
 private:
 	bool m_joinChannel = false;
 	bool m_initialize = false;
 	bool m_audioMixing = false;
 	IRtcEngine* m_rtcEngine = nullptr;
+	CAgoraEngineLease m_engineLease;
 	CAGVideoWnd m_localVideoWnd;
 	CMultiChannelEventHandler m_eventHandler;
-	std::vector<ChannelInfo> m_channels;
+	CChannelManager m_channelManager;
+	ChannelInfo m_channels[CChannelManager::MAX_CHANNELS];
 	CString m_strMainChannel;
 
 protected:
@@ -592,6 +605,12 @@ protected:
 	LRESULT OnEIDUserJoined(WPARAM wParam, LPARAM lParam);
 	LRESULT OnEIDUserOffline(WPARAM wParam, LPARAM lParam);
 	LRESULT OnEIDRemoteVideoStateChanged(WPARAM wParam, LPARAM lParam);
+	LRESULT OnEIDEventBus(WPARAM wParam, LPARAM lParam);
+	//events of the channels created by createChannel.
+	void OnChannelJoinSuccess(ChannelHandle handle, const AgoraEvent& event);
+	void OnChannelLeave(ChannelHandle handle, const AgoraEvent& event);
+	void OnChannelUserJoined(ChannelHandle handle, const AgoraEvent& event);
+	void OnChannelUserOffline(ChannelHandle handle, const AgoraEvent& event);
 	DECLARE_MESSAGE_MAP()
 public:
 	CStatic m_staVideoArea;
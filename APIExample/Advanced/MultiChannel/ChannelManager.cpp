@@ -0,0 +1,287 @@
+#include "ChannelManager.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+//no stdafx.h, the manager is tested against mock channels.
+
+namespace {
+	int LowestBit(uint64_t bits)
+	{
+#if defined(_MSC_VER) && defined(_WIN64)
+		unsigned long index = 0;
+		_BitScanForward64(&index, bits);
+		return (int)index;
+#elif defined(_MSC_VER)
+		//no 64 bit scan on x86.
+		unsigned long index = 0;
+		if (_BitScanForward(&index, (unsigned long)bits))
+			return (int)index;
+		_BitScanForward(&index, (unsigned long)(bits >> 32));
+		return (int)index + 32;
+#else
+		return __builtin_ctzll(bits);
+#endif
+	}
+
+	ChannelHandle MakeHandle(uint32_t generation, int slot)
+	{
+		return (generation << 8) | (uint32_t)slot;
+	}
+}
+
+CChannelManager::CChannelManager()
+	: m_ready(0)
+	, m_wakePending(false)
+{
+	for (int i = 0; i < MAX_CHANNELS; ++i)
+		m_generation[i] = 0;
+	for (int i = 0; i < CAgoraEventBus::MAX_EVENT_TYPE; ++i)
+		m_coalesce[i] = false;
+}
+
+CChannelManager::~CChannelManager()
+{
+	RemoveAll();
+}
+
+void CChannelManager::SetWakeup(WakeupFunc wakeup)
+{
+	m_wakeup = wakeup;
+}
+
+void CChannelManager::Subscribe(int type, EventHandler handler)
+{
+	if (type >= 0 && type < CAgoraEventBus::MAX_EVENT_TYPE)
+		m_handlers[type] = handler;
+}
+
+void CChannelManager::SubscribeWorker(int type, EventHandler handler)
+{
+	if (type >= 0 && type < CAgoraEventBus::MAX_EVENT_TYPE)
+		m_workerHandlers[type] = handler;
+}
+
+void CChannelManager::SetCoalesce(int type, bool coalesce)
+{
+	if (type >= 0 && type < CAgoraEventBus::MAX_EVENT_TYPE)
+		m_coalesce[type] = coalesce;
+}
+
+CAgoraEventBus* CChannelManager::GetUIQueue(Channel& channel) const
+{
+	return channel.uiQueue ? channel.uiQueue.get() : channel.queue.get();
+}
+
+//bind the queues of a new channel to the handlers, with its handle.
+void CChannelManager::SetupQueues(int slot)
+{
+	Channel& channel = *m_channels[slot];
+	ChannelHandle handle = channel.handle.load(std::memory_order_relaxed);
+	CAgoraEventBus* uiQueue = GetUIQueue(channel);
+	for (int type = 0; type < CAgoraEventBus::MAX_EVENT_TYPE; ++type) {
+		uiQueue->SetCoalesce(type, m_coalesce[type]);
+		if (m_handlers[type]) {
+			EventHandler& handler = m_handlers[type];
+			uiQueue->Subscribe(type, [&handler, &channel, handle](const AgoraEvent& event) {
+				++channel.delivered;
+				handler(handle, event);
+			});
+		}
+		else {
+			uiQueue->Subscribe(type, nullptr);
+		}
+		if (!channel.uiQueue)
+			continue;
+		//worker channels: run the worker handler, then hand the event to the UI.
+		if (m_handlers[type] || m_workerHandlers[type]) {
+			EventHandler& workerHandler = m_workerHandlers[type];
+			bool forward = m_handlers[type] != nullptr;
+			channel.queue->Subscribe(type, [&workerHandler, uiQueue, forward, handle](const AgoraEvent& event) {
+				if (workerHandler)
+					workerHandler(handle, event);
+				if (forward)
+					uiQueue->Post(event);
+			});
+		}
+		else {
+			channel.queue->Subscribe(type, nullptr);
+		}
+	}
+}
+
+ChannelHandle CChannelManager::AddChannel(const std::string& channelId, bool dedicatedWorker)
+{
+	if (m_ids.find(channelId) != m_ids.end())
+		return 0;
+	int slot = 0;
+	while (slot < MAX_CHANNELS && m_channels[slot] && m_channels[slot]->handle.load(std::memory_order_relaxed))
+		++slot;
+	if (slot == MAX_CHANNELS)
+		return 0;
+	if (!m_channels[slot])
+		m_channels[slot].reset(new Channel);
+	Channel& channel = *m_channels[slot];
+	//generation 0 would make the handle of slot 0 look invalid.
+	if (++m_generation[slot] > 0xFFFFFF)
+		m_generation[slot] = 1;
+	ChannelHandle handle = MakeHandle(m_generation[slot], slot);
+	channel.channelId = channelId;
+	channel.delivered = 0;
+	channel.workerLatency = 0;
+	//fresh queues, so counters and handlers of the previous channel are gone.
+	channel.queue.reset(new CAgoraEventBus(QUEUE_CAPACITY));
+	channel.uiQueue.reset(dedicatedWorker ? new CAgoraEventBus(QUEUE_CAPACITY) : nullptr);
+	channel.handle.store(handle, std::memory_order_release);
+	SetupQueues(slot);
+
+	if (dedicatedWorker) {
+		Channel* pChannel = &channel;
+		channel.queue->SetWakeup([pChannel]() {
+			{
+				std::lock_guard<std::mutex> lock(pChannel->mutex);
+				pChannel->workPending = true;
+			}
+			pChannel->wakeup.notify_one();
+		});
+		channel.uiQueue->SetWakeup([this, slot]() { SignalReady(slot); });
+		channel.stopWorker = false;
+		channel.workPending = false;
+		channel.worker = std::thread(&CChannelManager::RunWorker, this, slot);
+	}
+	else {
+		channel.queue->SetWakeup([this, slot]() { SignalReady(slot); });
+	}
+	m_ids[channelId] = handle;
+	return handle;
+}
+
+bool CChannelManager::RemoveChannel(ChannelHandle handle)
+{
+	if (!IsValid(handle))
+		return false;
+	Channel& channel = *m_channels[GetSlot(handle)];
+	channel.handle.store(0, std::memory_order_release);
+	StopWorker(channel);
+	channel.queue->Clear();
+	if (channel.uiQueue)
+		channel.uiQueue->Clear();
+	m_ids.erase(channel.channelId);
+	channel.channelId.clear();
+	return true;
+}
+
+void CChannelManager::RemoveAll()
+{
+	for (int slot = 0; slot < MAX_CHANNELS; ++slot) {
+		if (m_channels[slot])
+			RemoveChannel(m_channels[slot]->handle.load(std::memory_order_relaxed));
+	}
+	m_ready.store(0, std::memory_order_relaxed);
+	m_wakePending.store(false, std::memory_order_relaxed);
+}
+
+ChannelHandle CChannelManager::FindChannel(const std::string& channelId) const
+{
+	auto it = m_ids.find(channelId);
+	return it == m_ids.end() ? 0 : it->second;
+}
+
+bool CChannelManager::IsValid(ChannelHandle handle) const
+{
+	int slot = GetSlot(handle);
+	return handle != 0 && slot < MAX_CHANNELS && m_channels[slot]
+		&& m_channels[slot]->handle.load(std::memory_order_acquire) == handle;
+}
+
+const std::string& CChannelManager::GetChannelId(ChannelHandle handle) const
+{
+	static const std::string empty;
+	return IsValid(handle) ? m_channels[GetSlot(handle)]->channelId : empty;
+}
+
+bool CChannelManager::PostEvent(ChannelHandle handle, const AgoraEvent& event)
+{
+	if (!IsValid(handle))
+		return false;
+	return m_channels[GetSlot(handle)]->queue->Post(event);
+}
+
+void CChannelManager::SignalReady(int slot)
+{
+	m_ready.fetch_or(1ULL << slot, std::memory_order_acq_rel);
+	if (!m_wakePending.exchange(true, std::memory_order_acq_rel) && m_wakeup)
+		m_wakeup();
+}
+
+int CChannelManager::Dispatch()
+{
+	//clear the flag before taking the ready set, a channel that gets ready
+	//from now on wakes us again.
+	m_wakePending.exchange(false, std::memory_order_acq_rel);
+	uint64_t ready = m_ready.exchange(0, std::memory_order_acq_rel);
+	int delivered = 0;
+	while (ready) {
+		int slot = LowestBit(ready);
+		ready &= ready - 1;
+		Channel& channel = *m_channels[slot];
+		if (channel.handle.load(std::memory_order_relaxed))
+			delivered += GetUIQueue(channel)->Dispatch();
+	}
+	return delivered;
+}
+
+void CChannelManager::RunWorker(int slot)
+{
+	Channel& channel = *m_channels[slot];
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(channel.mutex);
+			channel.wakeup.wait(lock, [&channel]() { return channel.stopWorker || channel.workPending; });
+			if (channel.stopWorker)
+				return;
+			channel.workPending = false;
+		}
+		channel.queue->Dispatch();
+		std::lock_guard<std::mutex> lock(channel.mutex);
+		channel.workerLatency = channel.queue->GetMaxLatency();
+	}
+}
+
+void CChannelManager::StopWorker(Channel& channel)
+{
+	if (!channel.worker.joinable())
+		return;
+	{
+		std::lock_guard<std::mutex> lock(channel.mutex);
+		channel.stopWorker = true;
+	}
+	channel.wakeup.notify_one();
+	channel.worker.join();
+}
+
+void CChannelManager::GetChannelViews(std::vector<ChannelView>& views) const
+{
+	views.clear();
+	for (int slot = 0; slot < MAX_CHANNELS; ++slot) {
+		Channel* channel = m_channels[slot].get();
+		if (!channel || !channel->handle.load(std::memory_order_relaxed))
+			continue;
+		ChannelView view;
+		view.handle = channel->handle.load(std::memory_order_relaxed);
+		view.channelId = channel->channelId;
+		view.worker = channel->uiQueue != nullptr;
+		view.posted = channel->queue->GetPostedCount();
+		view.dropped = channel->queue->GetDroppedCount();
+		view.delivered = channel->delivered;
+		if (channel->uiQueue) {
+			std::lock_guard<std::mutex> lock(channel->mutex);
+			//queue wait on the worker plus queue wait on the UI thread.
+			view.maxLatency = channel->workerLatency + channel->uiQueue->GetMaxLatency();
+			view.dropped += channel->uiQueue->GetDroppedCount();
+		}
+		else {
+			view.maxLatency = channel->queue->GetMaxLatency();
+		}
+		views.push_back(view);
+	}
+}
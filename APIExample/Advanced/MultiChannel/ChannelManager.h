@@ -0,0 +1,131 @@
+#pragma once
+#include "CAgoraEventBus.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+//generation in the high bits, slot in the low byte. 0 is never a valid handle.
+typedef uint32_t ChannelHandle;
+
+//one row of the aggregated view, see CChannelManager::GetChannelViews.
+struct ChannelView {
+	ChannelHandle handle = 0;
+	std::string channelId;
+	bool worker = false;
+	//events posted by the SDK, dropped because the channel queue was full,
+	//and delivered to the UI handlers.
+	uint64_t posted = 0;
+	uint64_t dropped = 0;
+	uint64_t delivered = 0;
+	//largest post-to-handler delay of the channel queue, in microseconds.
+	int64_t maxLatency = 0;
+};
+
+/*
+	Keeps every joined IChannel apart from the others so a noisy channel
+	can not hold back the events of the rest:
+	- channels are looked up by id and addressed by a stable handle, a slot
+	  index plus a generation so a handle of a removed channel never
+	  reaches the channel that reuses its slot;
+	- each channel posts into its own event queue, a full queue only drops
+	  events of that channel;
+	- a channel can have a dedicated worker thread that runs the worker
+	  handlers off the UI thread before the events go on to the UI;
+	- the UI thread is woken up once for any number of ready channels and
+	  Dispatches them in turn, every channel at most one queue worth.
+*/
+class CChannelManager
+{
+public:
+	typedef std::function<void(ChannelHandle handle, const AgoraEvent& event)> EventHandler;
+	typedef std::function<void()> WakeupFunc;
+	enum {
+		//bounded by the ready mask.
+		MAX_CHANNELS = 64,
+		//per channel queue size.
+		QUEUE_CAPACITY = 256,
+	};
+
+	CChannelManager();
+	~CChannelManager();
+
+	//handlers and coalescing are bound to a channel when it is added,
+	//set them up first.
+	//called from the posting thread when the UI has work again.
+	void SetWakeup(WakeupFunc wakeup);
+	//UI thread handler for one event type, same for every channel.
+	void Subscribe(int type, EventHandler handler);
+	//worker thread handler for channels added with a dedicated worker.
+	void SubscribeWorker(int type, EventHandler handler);
+	//only deliver the latest event per uid of this type in a batch.
+	void SetCoalesce(int type, bool coalesce);
+
+	//0 if the id is taken or every slot is in use.
+	ChannelHandle AddChannel(const std::string& channelId, bool dedicatedWorker = false);
+	//stops the worker and drops whatever is queued. the channel must have
+	//stopped posting, i.e. the IChannel is released.
+	bool RemoveChannel(ChannelHandle handle);
+	void RemoveAll();
+
+	ChannelHandle FindChannel(const std::string& channelId) const;
+	bool IsValid(ChannelHandle handle) const;
+	//slot of a valid handle, for callers keeping their own per channel array.
+	static int GetSlot(ChannelHandle handle) { return (int)(handle & 0xFF); }
+	const std::string& GetChannelId(ChannelHandle handle) const;
+	int GetChannelCount() const { return (int)m_ids.size(); }
+
+	//any thread. false if the handle is stale or the channel queue is full.
+	bool PostEvent(ChannelHandle handle, const AgoraEvent& event);
+	//UI thread. delivers the events of every ready channel, returns the
+	//number of events delivered.
+	int Dispatch();
+
+	//UI thread. one row per channel, in slot order.
+	void GetChannelViews(std::vector<ChannelView>& views) const;
+
+private:
+	struct Channel {
+		std::atomic<ChannelHandle> handle;
+		std::string channelId;
+		//SDK threads post here.
+		std::unique_ptr<CAgoraEventBus> queue;
+		//worker channels only: the worker forwards to the UI through here.
+		std::unique_ptr<CAgoraEventBus> uiQueue;
+		std::thread worker;
+		std::mutex mutex;
+		std::condition_variable wakeup;
+		bool workPending = false;
+		bool stopWorker = false;
+		//written by the worker under mutex.
+		int64_t workerLatency = 0;
+		uint64_t delivered = 0;
+
+		Channel() : handle(0) {}
+	};
+
+	void SetupQueues(int slot);
+	void RunWorker(int slot);
+	void StopWorker(Channel& channel);
+	void SignalReady(int slot);
+	CAgoraEventBus* GetUIQueue(Channel& channel) const;
+
+	std::unique_ptr<Channel> m_channels[MAX_CHANNELS];
+	uint32_t m_generation[MAX_CHANNELS];
+	std::unordered_map<std::string, ChannelHandle> m_ids;
+
+	EventHandler m_handlers[CAgoraEventBus::MAX_EVENT_TYPE];
+	EventHandler m_workerHandlers[CAgoraEventBus::MAX_EVENT_TYPE];
+	bool m_coalesce[CAgoraEventBus::MAX_EVENT_TYPE];
+
+	//bit set per channel with events for the UI.
+	std::atomic<uint64_t> m_ready;
+	std::atomic<bool> m_wakePending;
+	WakeupFunc m_wakeup;
+};
@@ -123,6 +123,7 @@ private:
 	std::string m_strChannel;
 
 	agora::rtc::IRtcEngine* m_rtcEngine = nullptr;
+	CAgoraEngineLease m_engineLease;
 	CScreenShareEventHandler screenVidoeSourceEventHandler;
 	
 	bool m_bPublishScreen = false;
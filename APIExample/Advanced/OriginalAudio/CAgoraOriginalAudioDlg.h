@@ -156,6 +156,7 @@ private:
 	bool m_initialize = false;
 	bool m_setAudioProc = false;
 	IRtcEngine* m_rtcEngine = nullptr;
+	CAgoraEngineLease m_engineLease;
 	CAGVideoWnd m_localVideoWnd;
 	COriginalAudioEventHandler m_eventHandler;
 	COriginalAudioProcFrameObserver m_originalAudioProcFrameObserver;
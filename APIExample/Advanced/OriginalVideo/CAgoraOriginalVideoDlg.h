@@ -204,6 +204,7 @@ private:
 	bool m_initialize = false;
 	bool m_setVideoProc = false;
 	IRtcEngine* m_rtcEngine = nullptr;
+	CAgoraEngineLease m_engineLease;
 	CAGVideoWnd m_localVideoWnd;
 	COriginalVideoEventHandler m_eventHandler;
 
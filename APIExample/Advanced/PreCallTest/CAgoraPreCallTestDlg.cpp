@@ -52,6 +52,7 @@ BEGIN_MESSAGE_MAP(CAgoraPreCallTestDlg, CDialogEx)
 	ON_MESSAGE(WM_MSGID(EID_LASTMILE_QUAILTY), &CAgoraPreCallTestDlg::OnEIDLastmileQuality)
 	ON_MESSAGE(WM_MSGID(EID_AUDIO_VOLUME_INDICATION), &CAgoraPreCallTestDlg::OnEIDAudioVolumeIndication)
 	ON_WM_PAINT()
+	ON_WM_TIMER()
 	ON_BN_CLICKED(IDC_BUTTON_ECHO_TEST1, &CAgoraPreCallTestDlg::OnEchoTest1)
 	ON_BN_CLICKED(IDC_BUTTON_ECHO_TEST2, &CAgoraPreCallTestDlg::OnEchoTest2)
 END_MESSAGE_MAP()
@@ -74,21 +75,17 @@ void CAgoraPreCallTestDlg::InitCtrlText()
 //Initialize the Agora SDK
 bool CAgoraPreCallTestDlg::InitAgora()
 {
-	//create Agora RTC engine
-	m_rtcEngine = createAgoraRtcEngine();
-	if (!m_rtcEngine) {
-		m_lstInfo.InsertString(m_lstInfo.GetCount() - 1, _T("createAgoraRtcEngine failed"));
-		return false;
-	}
 	//set message notify receiver window
 	m_eventHandler.SetMsgReceiver(m_hWnd);
 	RtcEngineContext context;
 	std::string strAppID = GET_APP_ID;
 	context.appId = strAppID.c_str();
 	context.eventHandler = &m_eventHandler;
-	//initialize the Agora RTC engine context.
-	int ret = m_rtcEngine->initialize(context);
+	//borrow the shared engine, this registers our event handler.
+	int ret = m_engineLease.Acquire(context);
+	m_rtcEngine = m_engineLease.GetEngine();
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("initialize rtc engine"));
+	LoadNetworkScript();
 	LastmileProbeConfig config;
 	config.probeUplink = true;
 	config.probeDownlink = true;
@@ -113,8 +110,10 @@ void CAgoraPreCallTestDlg::UnInitAgora()
 		m_videoDeviceManager->release();
 		m_rtcEngine->stopLastmileProbeTest();
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("stopLastmileProbeTest"));
-		//release engine.
-		m_rtcEngine->release(true);
+		KillTimer(ECHO_TEST1_TIMER_ID);
+		m_networkSimulated = false;
+		//give the engine back to the host, it also unregisters the simulator.
+		m_engineLease.Release();
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("release rtc engine"));
 		m_rtcEngine = NULL;
 	}
@@ -393,7 +392,21 @@ void CAgoraPreCallTestDlg::OnEchoTest1()
 {
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("Start Audio Call Loop Test."));
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("You will hear your voice after 10 secs"));
-	m_rtcEngine->startEchoTest(10);
+	m_packetImpairer.Reset();
+	m_rtcEngine->startEchoTest(ECHO_TEST1_INTERVAL);
+	//the stats are logged once the recording has been played back.
+	SetTimer(ECHO_TEST1_TIMER_ID, (ECHO_TEST1_INTERVAL * 2 + 1) * 1000, NULL);
+}
+
+void CAgoraPreCallTestDlg::OnTimer(UINT_PTR nIDEvent)
+{
+	if (nIDEvent == ECHO_TEST1_TIMER_ID) {
+		KillTimer(ECHO_TEST1_TIMER_ID);
+		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("Stop Audio Call Loop Test."));
+		m_rtcEngine->stopEchoTest();
+		LogNetworkStats();
+	}
+	CDialogEx::OnTimer(nIDEvent);
 }
 
 
@@ -407,6 +420,10 @@ void CAgoraPreCallTestDlg::OnEchoTest2()
 		config.enableAudio = true;
 		config.enableVideo = true;
 		config.view = m_VideoTest.GetVideoSafeHwnd();
+		//the network script starts over with each test, and this one
+		//takes over from an audio loop test still running.
+		KillTimer(ECHO_TEST1_TIMER_ID);
+		m_packetImpairer.Reset();
 		m_rtcEngine->startEchoTest(config);
 		m_echoTest = true;
 		m_btnEchoTest2.SetWindowText(PerCallTestCtrlStopEchoTest);
@@ -415,7 +432,58 @@ void CAgoraPreCallTestDlg::OnEchoTest2()
 	{
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("Stop Audio and Video Call Loop Test."));
 		m_rtcEngine->stopEchoTest();
+		LogNetworkStats();
 		m_echoTest = false;
 		m_btnEchoTest2.SetWindowText(PerCallTestCtrlStartEchoTest);
 	}
 }
+
+
+/*
+	With a netsim.txt next to the exe (see ParseImpairmentScript for the
+	format) all audio and video packets of the echo tests pass a simulated
+	uplink and downlink, for reproducible runs without a real network.
+*/
+void CAgoraPreCallTestDlg::LoadNetworkScript()
+{
+	FILE* file = nullptr;
+	CString path = GetExePath() + _T("\\netsim.txt");
+	if (_wfopen_s(&file, path, L"rb") != 0 || !file)
+		return;
+	std::string text;
+	char buffer[4096];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		text.append(buffer, read);
+	fclose(file);
+
+	CString strInfo;
+	std::string error;
+	if (!m_packetImpairer.LoadScript(text, &error)) {
+		strInfo.Format(_T("netsim.txt: %S"), error.c_str());
+		m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
+		return;
+	}
+	m_networkSimulated = m_engineLease.RegisterPacketObserver(&m_packetImpairer) == 0;
+	m_lstInfo.InsertString(m_lstInfo.GetCount(), m_networkSimulated
+		? _T("simulated network from netsim.txt") : _T("registerPacketObserver failed"));
+}
+
+//what the simulator did to the packets of the last test.
+void CAgoraPreCallTestDlg::LogNetworkStats()
+{
+	if (!m_networkSimulated)
+		return;
+	const TCHAR* names[] = { _T("uplink"), _T("downlink") };
+	CNetworkImpairment* links[] = { &m_packetImpairer.GetUplink(), &m_packetImpairer.GetDownlink() };
+	for (int i = 0; i < 2; ++i) {
+		ImpairmentStats stats = links[i]->GetStats();
+		CString strInfo;
+		strInfo.Format(_T("%s: %I64u packets, lost %.1f%% (%I64u random, %I64u burst, %I64u queue)"),
+			names[i], stats.packets, stats.GetLossRate() * 100, stats.lost, stats.burstLost, stats.queueLost);
+		m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
+		strInfo.Format(_T("%s: delay %.1f ms avg, %.1f ms max, %I64u reordered"),
+			names[i], stats.GetDelayMsAverage(), stats.delayUsMax / 1e3, stats.reordered);
+		m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
+	}
+}
@@ -1,5 +1,6 @@
 ﻿#pragma once
 #include "AGVideoTestWnd.h"
+#include "netsim/ImpairedPacketObserver.h"
 
 class CAgoraPreCallTestEvnetHandler :public IRtcEngineEventHandler
 {
@@ -82,11 +83,15 @@ public:
 	void ResumeStatus();
 	
 	void UpdateViews();
+	//run the echo tests over the network simulated by netsim.txt next to the exe.
+	void LoadNetworkScript();
+	void LogNetworkStats();
 	 
 
 private:
 	
 	IRtcEngine* m_rtcEngine;
+	CAgoraEngineLease m_engineLease;
 	CImageList m_imgNetQuality;
 	int m_netQuality;
 	CAGVideoTestWnd m_VideoTest;
@@ -100,6 +105,14 @@ private:
 	bool m_audioOutputTest;
 	bool m_cameraTest;
 	bool m_echoTest;
+	CImpairedPacketObserver m_packetImpairer;
+	bool m_networkSimulated = false;
+	//the audio loop test records this long, plays it back as long and is
+	//stopped by the timer after that.
+	enum {
+		ECHO_TEST1_TIMER_ID = 1001,
+		ECHO_TEST1_INTERVAL = 10,
+	};
 
 protected:
 	virtual void DoDataExchange(CDataExchange* pDX);  
@@ -117,6 +130,7 @@ protected:
 	afx_msg void OnReleasedcaptureSliderInputVol(NMHDR *pNMHDR, LRESULT *pResult);
 	afx_msg void OnReleasedcaptureSliderOutputVol(NMHDR *pNMHDR, LRESULT *pResult);
 	afx_msg void OnPaint();
+	afx_msg void OnTimer(UINT_PTR nIDEvent);
 	DECLARE_MESSAGE_MAP()
 public:
 	CStatic m_staAudioInput;
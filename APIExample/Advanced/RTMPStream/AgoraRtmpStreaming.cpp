@@ -147,6 +147,7 @@ void CAgoraRtmpStreamingDlg::DoDataExchange(CDataExchange* pDX)
 	DDX_Control(pDX, IDC_CHK_TRANS_CODING, m_chkTransCoding);
 
 	DDX_Control(pDX, IDC_CHK_TRANS_CODING, m_chkTransCoding);
+	DDX_Control(pDX, IDC_COMBO_TRANSCODING_LAYOUT, m_cmbTranscodingLayout);
 }
 
 
@@ -164,18 +165,13 @@ BEGIN_MESSAGE_MAP(CAgoraRtmpStreamingDlg, CDialogEx)
 	ON_LBN_SELCHANGE(IDC_LIST_INFO_BROADCASTING, &CAgoraRtmpStreamingDlg::OnSelchangeListInfoBroadcasting)
 	ON_MESSAGE(WM_MSGID(EID_RTMP_STREAM_EVENT), &CAgoraRtmpStreamingDlg::OnEIDRtmpEvent)
 	ON_WM_TIMER()
+	ON_CBN_SELCHANGE(IDC_COMBO_TRANSCODING_LAYOUT, &CAgoraRtmpStreamingDlg::OnSelchangeComboTranscodingLayout)
 END_MESSAGE_MAP()
 
 
 //Initialize the Agora SDK
 bool CAgoraRtmpStreamingDlg::InitAgora()
 {
-	//create Agora RTC engine
-	m_rtcEngine = createAgoraRtcEngine();
-	if (!m_rtcEngine) {
-		m_lstInfo.InsertString(m_lstInfo.GetCount() - 1, _T("createAgoraRtcEngine failed"));
-		return false;
-	}
 	//set message notify receiver window
 	m_eventHandler.SetMsgReceiver(m_hWnd);
 
@@ -183,8 +179,9 @@ bool CAgoraRtmpStreamingDlg::InitAgora()
 	std::string strAppID = GET_APP_ID;
 	context.appId = strAppID.c_str();
 	context.eventHandler = &m_eventHandler;
-	//initialize the Agora RTC engine context.  
-	int ret = m_rtcEngine->initialize(context);
+	//borrow the shared engine, this registers our event handler.
+	int ret = m_engineLease.Acquire(context);
+	m_rtcEngine = m_engineLease.GetEngine();
 	if (ret != 0) {
 		m_initialize = false;
 		CString strInfo;
@@ -219,8 +216,8 @@ void CAgoraRtmpStreamingDlg::UnInitAgora()
 		//disable video in the engine.
 		m_rtcEngine->disableVideo();
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("disableVideo"));
-		//release engine.
-		m_rtcEngine->release(true);
+		//give the engine back to the host.
+		m_engineLease.Release();
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("release rtc engine"));
 		m_rtcEngine = NULL;
 	}
@@ -251,6 +248,11 @@ BOOL CAgoraRtmpStreamingDlg::OnInitDialog()
 	m_staVideoArea.GetClientRect(&rcArea);
 	m_localVideoWnd.MoveWindow(&rcArea);
 	m_localVideoWnd.ShowWindow(SW_SHOW);
+	//same order as CTranscodingLayout::LayoutTemplate.
+	m_cmbTranscodingLayout.InsertString(CTranscodingLayout::LAYOUT_GRID, rtmpStreamingCtrlLayoutGrid);
+	m_cmbTranscodingLayout.InsertString(CTranscodingLayout::LAYOUT_SPEAKER, rtmpStreamingCtrlLayoutSpeaker);
+	m_cmbTranscodingLayout.InsertString(CTranscodingLayout::LAYOUT_PIP, rtmpStreamingCtrlLayoutPip);
+	m_transcodingLayout.SetCanvas(m_liveTransCoding.width, m_liveTransCoding.height);
 	ResumeStatus();
 	return TRUE;
 }
@@ -307,6 +309,7 @@ void CAgoraRtmpStreamingDlg::ResumeStatus()
 	m_bRemoveAll = false;
 	m_edtRtmpUrl.SetWindowText(_T(""));
 	m_chkTransCoding.SetCheck(0);
+	m_cmbTranscodingLayout.SetCurSel(m_transcodingLayout.GetTemplate());
 	m_edtChannelName.SetWindowText(_T(""));
 	m_staDetail.SetWindowText(_T(""));
 
@@ -431,6 +434,10 @@ LRESULT CAgoraRtmpStreamingDlg::OnEIDJoinChannelSuccess(WPARAM wParam, LPARAM lP
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
 
 	m_btnAddStream.EnableWindow(TRUE);
+	//the local host takes the main tile.
+	m_transcodingLayout.AddUser((unsigned int)wParam);
+	m_transcodingLayout.SetSpeaker((unsigned int)wParam);
+	UpdateTranscodingLayout();
 	::PostMessage(GetParent()->GetSafeHwnd(), WM_MSGID(EID_JOINCHANNEL_SUCCESS), TRUE, 0);
 	return 0;
 }
@@ -439,27 +446,9 @@ LRESULT CAgoraRtmpStreamingDlg::OnEIDJoinChannelSuccess(WPARAM wParam, LPARAM lP
 //Change liveTranscoding when users joined
 LRESULT CAgoraRtmpStreamingDlg::OnEIDUserJoined(WPARAM wParam, LPARAM lParam)
 {
-	TranscodingUser tanrsCodingUser;
-	auto p = new TranscodingUser[++m_liveTransCoding.userCount];
-	if (m_liveTransCoding.userCount != 1)
-	{
-		memcpy(p, m_liveTransCoding.transcodingUsers, sizeof(TranscodingUser)*m_liveTransCoding.userCount++);
-		free(m_liveTransCoding.transcodingUsers);
-	}
-	tanrsCodingUser.uid = wParam;
-	tanrsCodingUser.alpha = 1;
-	tanrsCodingUser.y = 0;
-	tanrsCodingUser.height = m_liveTransCoding.height;
-	tanrsCodingUser.width = m_liveTransCoding.width / m_liveTransCoding.userCount;
-	p[m_liveTransCoding.userCount - 1] = tanrsCodingUser;
-	for (size_t i = 0; i < m_liveTransCoding.userCount; i++)
-	{
-		p[i].x = tanrsCodingUser.width;
-	}
-	//add user info to TranscodingUsers.
-	m_liveTransCoding.transcodingUsers = p;
-	//set current live trans coding.
-	m_rtcEngine->updateRtmpTranscoding(m_liveTransCoding);
+	//the new host takes a free slot, hosts already on screen keep theirs.
+	if (m_transcodingLayout.AddUser((unsigned int)wParam))
+		UpdateTranscodingLayout();
 	return TRUE;
 }
 
@@ -467,26 +456,44 @@ LRESULT CAgoraRtmpStreamingDlg::OnEIDUserJoined(WPARAM wParam, LPARAM lParam)
 //Change liveTranscoding when users leave
 LRESULT CAgoraRtmpStreamingDlg::OnEIDUserOffline(WPARAM wParam, LPARAM lParam)
 {
-	for (size_t i = 0; i < m_liveTransCoding.userCount; i++)
-	{
-		if (m_liveTransCoding.transcodingUsers[i].uid == wParam)
-		{
-			for (size_t j = i; j < m_liveTransCoding.userCount; j++)
-			{
-				m_liveTransCoding.transcodingUsers[j] = m_liveTransCoding.transcodingUsers[j + 1];
-			}
-		}
-	}
-	m_liveTransCoding.userCount--;
-	int width = m_liveTransCoding.width / m_liveTransCoding.userCount;
-	for (size_t i = 0; i < m_liveTransCoding.userCount; i++)
+	if (m_transcodingLayout.RemoveUser((unsigned int)wParam))
+		UpdateTranscodingLayout();
+	return TRUE;
+}
+
+//send the transcoding layout to the engine if it changed.
+void CAgoraRtmpStreamingDlg::UpdateTranscodingLayout()
+{
+	if (!m_transcodingLayout.CommitChanges())
+		return;
+	const std::vector<LayoutTile>& tiles = m_transcodingLayout.GetTiles();
+	m_transcodingUsers.resize(tiles.size());
+	for (size_t i = 0; i < tiles.size(); i++)
 	{
-		m_liveTransCoding.transcodingUsers[i].x = width * i;
-		m_liveTransCoding.transcodingUsers[i].width = width;
-	}
+		TranscodingUser& user = m_transcodingUsers[i];
+		user.uid = tiles[i].uid;
+		user.x = tiles[i].x;
+		user.y = tiles[i].y;
+		user.width = tiles[i].width;
+		user.height = tiles[i].height;
+		user.zOrder = tiles[i].zOrder;
+		user.alpha = 1;
+	}
+	m_liveTransCoding.userCount = (unsigned int)m_transcodingUsers.size();
+	m_liveTransCoding.transcodingUsers = m_transcodingUsers.empty() ? NULL : &m_transcodingUsers[0];
 	//set current live trans coding.
-	m_rtcEngine->updateRtmpTranscoding(m_liveTransCoding);
-	return TRUE;
+	if (m_rtcEngine && m_joinChannle)
+		m_rtcEngine->updateRtmpTranscoding(m_liveTransCoding);
+}
+
+//transcoding layout combobox handler.
+void CAgoraRtmpStreamingDlg::OnSelchangeComboTranscodingLayout()
+{
+	int nSel = m_cmbTranscodingLayout.GetCurSel();
+	if (nSel < 0)
+		return;
+	m_transcodingLayout.SetTemplate((CTranscodingLayout::LayoutTemplate)nSel);
+	UpdateTranscodingLayout();
 }
 
 //EID_LEAVE_CHANNEL message window handler.
@@ -494,6 +501,10 @@ LRESULT CAgoraRtmpStreamingDlg::OnEIDLeaveChannel(WPARAM wParam, LPARAM lParam)
 {
 	m_btnJoinChannel.EnableWindow(TRUE);
 	m_joinChannle = false;
+	m_transcodingLayout.Clear();
+	m_transcodingUsers.clear();
+	m_liveTransCoding.userCount = 0;
+	m_liveTransCoding.transcodingUsers = NULL;
 	m_btnJoinChannel.SetWindowText(commonCtrlJoinChannel);
 	CString strInfo;
 	strInfo.Format(_T("leave channel success"));
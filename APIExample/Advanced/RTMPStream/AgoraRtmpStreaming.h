@@ -1,5 +1,6 @@
 ﻿#pragma once
 #include "AGVideoWnd.h"
+#include "TranscodingLayout.h"
 #include <set>
 
 class CAgoraRtmpStreamingDlgRtcEngineEventHandler
@@ -109,9 +110,12 @@ public:
 	void RemoveAllRtmpUrls();
 	// resume window status.
 	void ResumeStatus();
+	//send the transcoding layout to the engine if it changed.
+	void UpdateTranscodingLayout();
 
 private:
 	IRtcEngine* m_rtcEngine = nullptr;
+	CAgoraEngineLease m_engineLease;
 	CAgoraRtmpStreamingDlgRtcEngineEventHandler m_eventHandler;
 	CAGVideoWnd m_localVideoWnd;
 	bool m_joinChannle = false;
@@ -124,6 +128,9 @@ private:
 	std::map<std::string, bool> m_mapRemoveFlag;// remove falg when leavechannel 
 
 	LiveTranscoding m_liveTransCoding;
+	CTranscodingLayout m_transcodingLayout;
+	//storage for m_liveTransCoding.transcodingUsers.
+	std::vector<TranscodingUser> m_transcodingUsers;
 public:
 	virtual BOOL OnInitDialog();
 	afx_msg void OnShowWindow(BOOL bShow, UINT nStatus);
@@ -140,6 +147,7 @@ public:
 	afx_msg void OnSelchangeListInfoBroadcasting();
 	afx_msg LRESULT OnEIDRtmpEvent(WPARAM wParam, LPARAM lParam);
 	afx_msg void OnTimer(UINT_PTR nIDEvent);
+	afx_msg void OnSelchangeComboTranscodingLayout();
 	
 	virtual BOOL PreTranslateMessage(MSG* pMsg);
 
@@ -158,6 +166,7 @@ public:
 	CStatic m_staVideoArea;
 	CStatic m_staDetail;
 	CButton m_chkTransCoding;
+	CComboBox m_cmbTranscodingLayout;
 	int LastTimer_Republish_id = 100000;
 	
 	std::map<std::string, int> m_mapUrlToTimer;
@@ -0,0 +1,224 @@
+#include "TranscodingLayout.h"
+#include <math.h>
+
+namespace {
+	void GridShape(int cells, int& cols, int& rows)
+	{
+		cols = (int)ceil(sqrt((double)cells));
+		if (cols < 1)
+			cols = 1;
+		rows = (cells + cols - 1) / cols;
+		if (rows < 1)
+			rows = 1;
+	}
+
+	//columns of the picture-in-picture strip: tiles are canvas / cols and
+	//take rows * canvas / cols of the height, at most canvas / PIP_COLUMNS.
+	int PipColumns(int cells)
+	{
+		int cols = CTranscodingLayout::PIP_COLUMNS;
+		while ((cells + cols - 1) / cols > cols / CTranscodingLayout::PIP_COLUMNS)
+			cols += CTranscodingLayout::PIP_COLUMNS;
+		return cols;
+	}
+}
+
+CTranscodingLayout::CTranscodingLayout()
+{
+}
+
+CTranscodingLayout::~CTranscodingLayout()
+{
+}
+
+void CTranscodingLayout::SetCanvas(int width, int height)
+{
+	m_width = width;
+	m_height = height;
+	Relayout();
+}
+
+void CTranscodingLayout::SetTemplate(LayoutTemplate layoutTemplate)
+{
+	m_template = layoutTemplate;
+	Compact();
+	Relayout();
+}
+
+int CTranscodingLayout::FindSlot(unsigned int uid) const
+{
+	for (size_t i = 0; i < m_slots.size(); ++i) {
+		if (m_slots[i] == uid)
+			return (int)i;
+	}
+	return -1;
+}
+
+bool CTranscodingLayout::AddUser(unsigned int uid)
+{
+	if (uid == 0 || m_userCount >= MAX_USERS || FindSlot(uid) >= 0)
+		return false;
+	int slot = FindSlot(0);
+	if (slot < 0) {
+		slot = (int)m_slots.size();
+		m_slots.push_back(0);
+	}
+	m_slots[slot] = uid;
+	++m_userCount;
+	Relayout();
+	return true;
+}
+
+bool CTranscodingLayout::RemoveUser(unsigned int uid)
+{
+	int slot = uid ? FindSlot(uid) : -1;
+	if (slot < 0)
+		return false;
+	m_slots[slot] = 0;
+	--m_userCount;
+	//the main tile is never left empty, the user in the last slot takes it.
+	if (slot == 0 && m_userCount > 0) {
+		int last = (int)m_slots.size() - 1;
+		while (m_slots[last] == 0)
+			--last;
+		m_slots[0] = m_slots[last];
+		m_slots[last] = 0;
+	}
+	Compact();
+	Relayout();
+	return true;
+}
+
+bool CTranscodingLayout::SetSpeaker(unsigned int uid)
+{
+	int slot = uid ? FindSlot(uid) : -1;
+	if (slot < 0)
+		return false;
+	if (slot != 0) {
+		m_slots[slot] = m_slots[0];
+		m_slots[0] = uid;
+		Relayout();
+	}
+	return true;
+}
+
+unsigned int CTranscodingLayout::GetSpeaker() const
+{
+	return m_slots.empty() ? 0 : m_slots[0];
+}
+
+void CTranscodingLayout::Clear()
+{
+	m_slots.clear();
+	m_userCount = 0;
+	m_tiles.clear();
+	m_committed.clear();
+}
+
+//number of slots the current template has room for with m_userCount users.
+int CTranscodingLayout::GetRequiredSlots() const
+{
+	int cols, rows;
+	switch (m_template) {
+	case LAYOUT_SPEAKER:
+		if (m_userCount <= 1)
+			return m_userCount;
+		GridShape(m_userCount - 1, cols, rows);
+		return 1 + cols * rows;
+	case LAYOUT_PIP:
+		//pip cells do not depend on the user count, holes can stay.
+		return MAX_USERS;
+	default:
+		GridShape(m_userCount, cols, rows);
+		return m_userCount ? cols * rows : 0;
+	}
+}
+
+//move users out of slots the template no longer has room for.
+void CTranscodingLayout::Compact()
+{
+	int required = GetRequiredSlots();
+	for (int slot = (int)m_slots.size() - 1; slot >= required; --slot) {
+		if (m_slots[slot] != 0) {
+			int hole = FindSlot(0);
+			m_slots[hole] = m_slots[slot];
+			m_slots[slot] = 0;
+		}
+	}
+	while (!m_slots.empty() && m_slots.back() == 0)
+		m_slots.pop_back();
+}
+
+//cell index of a grid with room for cells tiles inside the given rect.
+void CTranscodingLayout::GridCell(int x, int y, int width, int height, int cells, int index, LayoutTile& tile) const
+{
+	int cols, rows;
+	GridShape(cells, cols, rows);
+	int col = index % cols;
+	int row = index / cols;
+	//edges are computed from the cell index so neighbours never overlap or leave gaps.
+	tile.x = x + col * width / cols;
+	tile.y = y + row * height / rows;
+	tile.width = x + (col + 1) * width / cols - tile.x;
+	tile.height = y + (row + 1) * height / rows - tile.y;
+}
+
+void CTranscodingLayout::Relayout()
+{
+	m_tiles.clear();
+	for (size_t slot = 0; slot < m_slots.size(); ++slot) {
+		if (m_slots[slot] == 0)
+			continue;
+		LayoutTile tile;
+		tile.uid = m_slots[slot];
+		int index = (int)slot - 1;
+		switch (m_template) {
+		case LAYOUT_SPEAKER: {
+			int mainHeight = m_userCount > 1 ? m_height * 3 / 4 : m_height;
+			if (slot == 0) {
+				tile.width = m_width;
+				tile.height = mainHeight;
+			}
+			else {
+				GridCell(0, mainHeight, m_width, m_height - mainHeight, m_userCount - 1, index, tile);
+			}
+			break;
+		}
+		case LAYOUT_PIP:
+			if (slot == 0) {
+				tile.width = m_width;
+				tile.height = m_height;
+			}
+			else {
+				//fill rows from the bottom-right corner, holes keep their cell.
+				int cols = PipColumns((int)m_slots.size() - 1);
+				int col = cols - 1 - index % cols;
+				int row = index / cols;
+				tile.width = m_width / cols;
+				tile.height = m_height / cols;
+				tile.x = col * m_width / cols;
+				tile.y = m_height - (row + 1) * tile.height;
+				tile.zOrder = 1;
+			}
+			break;
+		default:
+			GridCell(0, 0, m_width, m_height, m_userCount, (int)slot, tile);
+			break;
+		}
+		m_tiles.push_back(tile);
+	}
+}
+
+bool CTranscodingLayout::CommitChanges()
+{
+	bool changed = m_tiles.size() != m_committed.size();
+	for (size_t i = 0; !changed && i < m_tiles.size(); ++i) {
+		const LayoutTile& a = m_tiles[i];
+		const LayoutTile& b = m_committed[i];
+		changed = a.uid != b.uid || a.x != b.x || a.y != b.y
+			|| a.width != b.width || a.height != b.height || a.zOrder != b.zOrder;
+	}
+	if (changed)
+		m_committed = m_tiles;
+	return changed;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <vector>
+
+//position of one host in the transcoded picture.
+struct LayoutTile {
+	unsigned int uid = 0;
+	int x = 0;
+	int y = 0;
+	int width = 0;
+	int height = 0;
+	int zOrder = 0;
+};
+
+/*
+	Computes the transcoding layout for the hosts pushed to the CDN.
+	Every host owns a slot; slot 0 is the main tile in the speaker and
+	picture-in-picture templates and the top-left cell of the grid. A host
+	keeps its slot until it leaves, joins take the lowest free slot and
+	hosts are only moved into holes when the grid gets smaller, so a
+	join or leave moves as few tiles as possible. CommitChanges tells
+	whether the geometry differs from what was last sent to the engine.
+	No SDK types are used here.
+*/
+class CTranscodingLayout
+{
+public:
+	enum LayoutTemplate {
+		LAYOUT_GRID = 0,
+		//main tile on top, the others in a grid strip below it.
+		LAYOUT_SPEAKER,
+		//main tile fills the canvas, the others float above it along the
+		//bottom edge.
+		LAYOUT_PIP,
+	};
+	enum {
+		//transcoding supports at most 17 hosts.
+		MAX_USERS = 17,
+		//picture-in-picture tiles are at most 1/PIP_COLUMNS of the canvas;
+		//more of them get smaller, so together they never cover more than
+		//the bottom 1/PIP_COLUMNS of the main tile.
+		PIP_COLUMNS = 4,
+	};
+
+	CTranscodingLayout();
+	~CTranscodingLayout();
+
+	void SetCanvas(int width, int height);
+	void SetTemplate(LayoutTemplate layoutTemplate);
+	LayoutTemplate GetTemplate() const { return m_template; }
+
+	//false if the user is already in the layout or the layout is full.
+	bool AddUser(unsigned int uid);
+	bool RemoveUser(unsigned int uid);
+	//move the user to the main tile, swapping with the current one.
+	bool SetSpeaker(unsigned int uid);
+	unsigned int GetSpeaker() const;
+	void Clear();
+
+	int GetUserCount() const { return m_userCount; }
+	//tiles of all users in slot order.
+	const std::vector<LayoutTile>& GetTiles() const { return m_tiles; }
+	//true if the tiles changed since the last call; the current tiles
+	//become the committed ones.
+	bool CommitChanges();
+
+private:
+	int FindSlot(unsigned int uid) const;
+	int GetRequiredSlots() const;
+	void Compact();
+	void Relayout();
+	void GridCell(int x, int y, int width, int height, int cells, int index, LayoutTile& tile) const;
+
+	LayoutTemplate m_template = LAYOUT_GRID;
+	int m_width = 0;
+	int m_height = 0;
+	//uid per slot, 0 for a free slot.
+	std::vector<unsigned int> m_slots;
+	int m_userCount = 0;
+	std::vector<LayoutTile> m_tiles;
+	std::vector<LayoutTile> m_committed;
+};
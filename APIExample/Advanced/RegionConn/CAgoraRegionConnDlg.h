@@ -113,6 +113,7 @@ private:
 	bool m_joinChannel = false;
 	bool m_initialize = false;
 	IRtcEngine* m_rtcEngine = nullptr;
+	CAgoraEngineLease m_engineLease;
 	CAGVideoWnd m_localVideoWnd;
 	CAgoraRegionConnHandler m_eventHandler;
 	std::map<CString,AREA_CODE> m_mapAreaCode;
@@ -50,16 +50,7 @@ BEGIN_MESSAGE_MAP(CAgoraReportInCallDlg, CDialogEx)
 	ON_WM_SHOWWINDOW()
 	ON_BN_CLICKED(IDC_BUTTON_JOINCHANNEL, &CAgoraReportInCallDlg::OnBnClickedButtonJoinchannel)
 	ON_LBN_SELCHANGE(IDC_LIST_INFO_BROADCASTING, &CAgoraReportInCallDlg::OnSelchangeListInfoBroadcasting)
-	ON_MESSAGE(WM_MSGID(EID_JOINCHANNEL_SUCCESS), &CAgoraReportInCallDlg::OnEIDJoinChannelSuccess)
-	ON_MESSAGE(WM_MSGID(EID_LEAVE_CHANNEL), &CAgoraReportInCallDlg::OnEIDLeaveChannel)
-	ON_MESSAGE(WM_MSGID(EID_USER_JOINED), &CAgoraReportInCallDlg::OnEIDUserJoined)
-	ON_MESSAGE(WM_MSGID(EID_USER_OFFLINE), &CAgoraReportInCallDlg::OnEIDUserOffline)
-	ON_MESSAGE(WM_MSGID(EID_REMOTE_VIDEO_STATE_CHANED), &CAgoraReportInCallDlg::OnEIDRemoteVideoStateChanged)
-
-	ON_MESSAGE(WM_MSGID(EID_RTC_STATS), &CAgoraReportInCallDlg::OnEIDRtcStats)
-	ON_MESSAGE(WM_MSGID(EID_REMOTE_VIDEO_STATS), &CAgoraReportInCallDlg::OnEIDRemoteVideoStats)
-	ON_MESSAGE(WM_MSGID(EID_REMOTE_AUDIO_STATS), &CAgoraReportInCallDlg::OnEIDRemoteAudioStats)
-	ON_MESSAGE(WM_MSGID(EID_LOCAL_VIDEO_STATS), &CAgoraReportInCallDlg::OnEIDLocalVideoStats)
+	ON_MESSAGE(WM_MSGID(EID_EVENT_BUS), &CAgoraReportInCallDlg::OnEIDEventBus)
 
 END_MESSAGE_MAP()
 
@@ -84,21 +75,16 @@ void CAgoraReportInCallDlg::InitCtrlText()
 //Initialize the Agora SDK
 bool CAgoraReportInCallDlg::InitAgora()
 {
-	//create Agora RTC engine
-	m_rtcEngine = createAgoraRtcEngine();
-	if (!m_rtcEngine) {
-		m_lstInfo.InsertString(m_lstInfo.GetCount() - 1, _T("createAgoraRtcEngine failed"));
-		return false;
-	}
-	//set message notify receiver window
-	m_eventHandler.SetMsgReceiver(m_hWnd);
+	//sdk callbacks go through the event bus.
+	m_eventHandler.SetEventBus(&m_eventBus);
 
 	RtcEngineContext context;
 	std::string strAppID = GET_APP_ID;
 	context.appId = strAppID.c_str();
 	context.eventHandler = &m_eventHandler;
-	//initialize the Agora RTC engine context.
-	int ret = m_rtcEngine->initialize(context);
+	//borrow the shared engine, this registers our event handler.
+	int ret = m_engineLease.Acquire(context);
+	m_rtcEngine = m_engineLease.GetEngine();
 	if (ret != 0) {
 		m_initialize = false;
 		CString strInfo;
@@ -135,10 +121,12 @@ void CAgoraReportInCallDlg::UnInitAgora()
 		//disable video in the engine.
 		m_rtcEngine->disableVideo();
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("disableVideo"));
-		//release engine.
-		m_rtcEngine->release(true);
+		//give the engine back to the host.
+		m_engineLease.Release();
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("release rtc engine"));
 		m_rtcEngine = NULL;
+		//drop callbacks that arrived after the scene was left.
+		m_eventBus.Clear();
 	}
 }
 
@@ -207,6 +195,23 @@ BOOL CAgoraReportInCallDlg::OnInitDialog()
 	m_staVideoArea.GetClientRect(&rcArea);
 	m_localVideoWnd.MoveWindow(&rcArea);
 	m_localVideoWnd.ShowWindow(SW_SHOW);
+
+	HWND hWnd = m_hWnd;
+	m_eventBus.SetWakeup([hWnd]() { ::PostMessage(hWnd, WM_MSGID(EID_EVENT_BUS), 0, 0); });
+	m_eventBus.Subscribe(EID_JOINCHANNEL_SUCCESS, [this](const AgoraEvent& event) { OnEIDJoinChannelSuccess(event); });
+	m_eventBus.Subscribe(EID_LEAVE_CHANNEL, [this](const AgoraEvent& event) { OnEIDLeaveChannel(event); });
+	m_eventBus.Subscribe(EID_USER_JOINED, [this](const AgoraEvent& event) { OnEIDUserJoined(event); });
+	m_eventBus.Subscribe(EID_USER_OFFLINE, [this](const AgoraEvent& event) { OnEIDUserOffline(event); });
+	m_eventBus.Subscribe(EID_REMOTE_VIDEO_STATE_CHANED, [this](const AgoraEvent& event) { OnEIDRemoteVideoStateChanged(event); });
+	m_eventBus.Subscribe(EID_RTC_STATS, [this](const AgoraEvent& event) { OnEIDRtcStats(event); });
+	m_eventBus.Subscribe(EID_REMOTE_VIDEO_STATS, [this](const AgoraEvent& event) { OnEIDRemoteVideoStats(event); });
+	m_eventBus.Subscribe(EID_REMOTE_AUDIO_STATS, [this](const AgoraEvent& event) { OnEIDRemoteAudioStats(event); });
+	m_eventBus.Subscribe(EID_LOCAL_VIDEO_STATS, [this](const AgoraEvent& event) { OnEIDLocalVideoStats(event); });
+	//the statistics only show the latest value.
+	m_eventBus.SetCoalesce(EID_RTC_STATS, true);
+	m_eventBus.SetCoalesce(EID_REMOTE_VIDEO_STATS, true);
+	m_eventBus.SetCoalesce(EID_REMOTE_AUDIO_STATS, true);
+	m_eventBus.SetCoalesce(EID_LOCAL_VIDEO_STATS, true);
 	ResumeStatus();
 	return TRUE;
 }
@@ -261,23 +266,29 @@ void CAgoraReportInCallDlg::OnSelchangeListInfoBroadcasting()
 }
 
 
-//EID_JOINCHANNEL_SUCCESS message window handler.
-LRESULT CAgoraReportInCallDlg::OnEIDJoinChannelSuccess(WPARAM wParam, LPARAM lParam)
+//wakeup message from the event bus.
+LRESULT CAgoraReportInCallDlg::OnEIDEventBus(WPARAM wParam, LPARAM lParam)
+{
+	m_eventBus.Dispatch();
+	return 0;
+}
+
+//EID_JOINCHANNEL_SUCCESS event handler.
+void CAgoraReportInCallDlg::OnEIDJoinChannelSuccess(const AgoraEvent& event)
 {
 	m_joinChannel = true;
 	m_btnJoinChannel.EnableWindow(TRUE);
 	m_btnJoinChannel.SetWindowText(commonCtrlLeaveChannel);
 	CString strInfo;
-	strInfo.Format(_T("%s:join success, uid=%u"), getCurrentTime(), wParam);
+	strInfo.Format(_T("%s:join success, uid=%u"), getCurrentTime(), event.uid);
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
-	m_localVideoWnd.SetUID(wParam);
+	m_localVideoWnd.SetUID(event.uid);
 	//notify parent window
 	::PostMessage(GetParent()->GetSafeHwnd(), WM_MSGID(EID_JOINCHANNEL_SUCCESS), TRUE, 0);
-	return 0;
 }
 
-//EID_LEAVE_CHANNEL message window handler.
-LRESULT CAgoraReportInCallDlg::OnEIDLeaveChannel(WPARAM wParam, LPARAM lParam)
+//EID_LEAVE_CHANNEL event handler.
+void CAgoraReportInCallDlg::OnEIDLeaveChannel(const AgoraEvent& event)
 {
 
 	m_joinChannel = false;
@@ -287,128 +298,98 @@ LRESULT CAgoraReportInCallDlg::OnEIDLeaveChannel(WPARAM wParam, LPARAM lParam)
 	strInfo.Format(_T("leave channel success %s"), getCurrentTime());
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
 	::PostMessage(GetParent()->GetSafeHwnd(), WM_MSGID(EID_JOINCHANNEL_SUCCESS), FALSE, 0);
-	return 0;
 }
 
-//EID_USER_JOINED message window handler.
-LRESULT CAgoraReportInCallDlg::OnEIDUserJoined(WPARAM wParam, LPARAM lParam)
+//EID_USER_JOINED event handler.
+void CAgoraReportInCallDlg::OnEIDUserJoined(const AgoraEvent& event)
 {
 	CString strInfo;
-	strInfo.Format(_T("%u joined"), wParam);
+	strInfo.Format(_T("%u joined"), event.uid);
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
-	return 0;
 }
 
 
-//EID_USER_OFFLINE message window handler.
-LRESULT CAgoraReportInCallDlg::OnEIDUserOffline(WPARAM wParam, LPARAM lParam)
+//EID_USER_OFFLINE event handler.
+void CAgoraReportInCallDlg::OnEIDUserOffline(const AgoraEvent& event)
 {
-	uid_t remoteUid = (uid_t)wParam;
+	uid_t remoteUid = event.uid;
 	VideoCanvas canvas;
 	canvas.uid = remoteUid;
 	canvas.view = NULL;
 	m_rtcEngine->setupRemoteVideo(canvas);
 	CString strInfo;
-	strInfo.Format(_T("%u offline, reason:%d"), remoteUid, lParam);
+	strInfo.Format(_T("%u offline, reason:%d"), remoteUid, event.data.params[0]);
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
-
-	return 0;
 }
 
-//EID_REMOTE_VIDEO_STATE_CHANED message window handler.
-LRESULT CAgoraReportInCallDlg::OnEIDRemoteVideoStateChanged(WPARAM wParam, LPARAM lParam)
+//EID_REMOTE_VIDEO_STATE_CHANED event handler.
+void CAgoraReportInCallDlg::OnEIDRemoteVideoStateChanged(const AgoraEvent& event)
 {
-	PVideoStateStateChanged stateChanged = (PVideoStateStateChanged)wParam;
-	if (stateChanged) {
-		//onRemoteVideoStateChanged
-		CString strSateInfo;
-		switch (stateChanged->state) {
-		case REMOTE_VIDEO_STATE_STARTING:
-			strSateInfo = _T("REMOTE_VIDEO_STATE_STARTING");
-			break;
-		case REMOTE_VIDEO_STATE_STOPPED:
-			strSateInfo = _T("strSateInfo");
-			break;
-		case REMOTE_VIDEO_STATE_DECODING:
-			strSateInfo = _T("REMOTE_VIDEO_STATE_DECODING");
-			break;
-		case REMOTE_VIDEO_STATE_FAILED:
-			strSateInfo = _T("REMOTE_VIDEO_STATE_FAILED ");
-			break;
-		case REMOTE_VIDEO_STATE_FROZEN:
-			strSateInfo = _T("REMOTE_VIDEO_STATE_FROZEN  ");
-			break;
-		}
-		CString strInfo;
-		strInfo.Format(_T("onRemoteVideoStateChanged: uid=%u, %s"), stateChanged->uid, strSateInfo);
-		m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
+	//onRemoteVideoStateChanged
+	CString strSateInfo;
+	switch (event.data.params[0]) {
+	case REMOTE_VIDEO_STATE_STARTING:
+		strSateInfo = _T("REMOTE_VIDEO_STATE_STARTING");
+		break;
+	case REMOTE_VIDEO_STATE_STOPPED:
+		strSateInfo = _T("strSateInfo");
+		break;
+	case REMOTE_VIDEO_STATE_DECODING:
+		strSateInfo = _T("REMOTE_VIDEO_STATE_DECODING");
+		break;
+	case REMOTE_VIDEO_STATE_FAILED:
+		strSateInfo = _T("REMOTE_VIDEO_STATE_FAILED ");
+		break;
+	case REMOTE_VIDEO_STATE_FROZEN:
+		strSateInfo = _T("REMOTE_VIDEO_STATE_FROZEN  ");
+		break;
 	}
-	return 0;
+	CString strInfo;
+	strInfo.Format(_T("onRemoteVideoStateChanged: uid=%u, %s"), event.uid, strSateInfo);
+	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
 }
 
 //refresh remote video stats
-LRESULT CAgoraReportInCallDlg::OnEIDRemoteVideoStats(WPARAM wParam, LPARAM lParam)
+void CAgoraReportInCallDlg::OnEIDRemoteVideoStats(const AgoraEvent& event)
 {
-	RemoteVideoStats * p = reinterpret_cast<RemoteVideoStats*>(wParam);
-	if (p)
-	{
-		CString tmp;
-		tmp.Format(_T("%dms"), p->delay);
-		m_staVideoNetWorkDelayVal.SetWindowText(tmp);
-		tmp.Format(_T("%dKbps"), p->receivedBitrate);
-		m_staVideoRecvBitrateVal.SetWindowText(tmp);
-
-		delete p;
-	}
-	return TRUE;
+	const RemoteVideoStats* p = &event.data.remoteVideoStats;
+	CString tmp;
+	tmp.Format(_T("%dms"), p->delay);
+	m_staVideoNetWorkDelayVal.SetWindowText(tmp);
+	tmp.Format(_T("%dKbps"), p->receivedBitrate);
+	m_staVideoRecvBitrateVal.SetWindowText(tmp);
 }
 
 //refresh remote audio stats
-LRESULT CAgoraReportInCallDlg::OnEIDRemoteAudioStats(WPARAM wParam, LPARAM lParam)
+void CAgoraReportInCallDlg::OnEIDRemoteAudioStats(const AgoraEvent& event)
 {
-	RemoteAudioStats *p = reinterpret_cast<RemoteAudioStats *>(wParam);
-	if (p)
-	{
-		CString tmp;
-		tmp.Format(_T("%dms"), p->networkTransportDelay);
-		m_staAudioNetWorkDelayVal.SetWindowText(tmp);
-
-		tmp.Format(_T("%dKbps"), p->receivedBitrate);
-		m_staAudioRecvBitrateVal.SetWindowText(tmp);
+	const RemoteAudioStats* p = &event.data.remoteAudioStats;
+	CString tmp;
+	tmp.Format(_T("%dms"), p->networkTransportDelay);
+	m_staAudioNetWorkDelayVal.SetWindowText(tmp);
 
-		delete p;
-	}
-	return TRUE;
+	tmp.Format(_T("%dKbps"), p->receivedBitrate);
+	m_staAudioRecvBitrateVal.SetWindowText(tmp);
 }
 
 //refresh total bitrate and total bytes.
-LRESULT CAgoraReportInCallDlg::OnEIDRtcStats(WPARAM wParam, LPARAM lParam)
+void CAgoraReportInCallDlg::OnEIDRtcStats(const AgoraEvent& event)
 {
-	RtcStats *p = reinterpret_cast<RtcStats *>(wParam);
-	if (p)
-	{
-		CString tmp;
-		tmp.Format(_T("%dKbps/%dKbps"), p->txKBitRate, p->rxKBitRate);
-		m_staTotalBitrateVal.SetWindowText(tmp);
-		tmp.Format(_T("%.2fMB/%.2fMB"), p->txBytes ? p->txBytes / 1024.0 / 1024 : 0, p->rxBytes ? p->rxBytes / 1024.0 / 1024 : 0);
-		m_staTotalBytesVal.SetWindowText(tmp);
-		delete p;
-	}
-	return TRUE;
+	const RtcStats* p = &event.data.rtcStats;
+	CString tmp;
+	tmp.Format(_T("%dKbps/%dKbps"), p->txKBitRate, p->rxKBitRate);
+	m_staTotalBitrateVal.SetWindowText(tmp);
+	tmp.Format(_T("%.2fMB/%.2fMB"), p->txBytes ? p->txBytes / 1024.0 / 1024 : 0, p->rxBytes ? p->rxBytes / 1024.0 / 1024 : 0);
+	m_staTotalBytesVal.SetWindowText(tmp);
 }
 
 //refresh local video stats
-LRESULT CAgoraReportInCallDlg::OnEIDLocalVideoStats(WPARAM wParam, LPARAM lParam)
+void CAgoraReportInCallDlg::OnEIDLocalVideoStats(const AgoraEvent& event)
 {
-	LocalVideoStats *p = reinterpret_cast<LocalVideoStats *>(wParam);
-	if (p)
-	{
-		CString tmp;
-		tmp.Format(_T("%d fps"), p->sentFrameRate);
-		m_staLocalVideoFPSVal.SetWindowText(tmp);
-		tmp.Format(_T("%d X %d"), p->encodedFrameWidth, p->encodedFrameHeight);
-		m_staLocalVideoResoultionVal.SetWindowText(tmp);
-		delete p;
-	}
-	return TRUE;
+	const LocalVideoStats* p = &event.data.localVideoStats;
+	CString tmp;
+	tmp.Format(_T("%d fps"), p->sentFrameRate);
+	m_staLocalVideoFPSVal.SetWindowText(tmp);
+	tmp.Format(_T("%d X %d"), p->encodedFrameWidth, p->encodedFrameHeight);
+	m_staLocalVideoResoultionVal.SetWindowText(tmp);
 }
@@ -6,8 +6,8 @@
 class CAgoraReportInCallHandler : public IRtcEngineEventHandler
 {
 public:
-	//set the message notify window handler
-	void SetMsgReceiver(HWND hWnd) { m_hMsgHanlder = hWnd; }
+	//set the event bus the callbacks are posted to.
+	void SetEventBus(CAgoraEventBus* eventBus) { m_eventBus = eventBus; }
 	/*
 	note:
 		Join the channel callback.This callback method indicates that the client
@@ -22,9 +22,7 @@ public:
 	*/
 	virtual void onJoinChannelSuccess(const char* channel, uid_t uid, int elapsed) override
 	{
-		if (m_hMsgHanlder) {
-			::PostMessage(m_hMsgHanlder, WM_MSGID(EID_JOINCHANNEL_SUCCESS), (WPARAM)uid, (LPARAM)elapsed);
-		}
+		PostEvent(EID_JOINCHANNEL_SUCCESS, uid, elapsed);
 	}
 	/*
 	note:
@@ -41,9 +39,7 @@ public:
 	*/
 	virtual void onUserJoined(uid_t uid, int elapsed) override
 	{
-		if (m_hMsgHanlder) {
-			::PostMessage(m_hMsgHanlder, WM_MSGID(EID_USER_JOINED), (WPARAM)uid, (LPARAM)elapsed);
-		}
+		PostEvent(EID_USER_JOINED, uid, elapsed);
 	}
 	/*
 	note:
@@ -63,9 +59,7 @@ public:
 	*/
 	virtual void onUserOffline(uid_t uid, USER_OFFLINE_REASON_TYPE reason) override
 	{
-		if (m_hMsgHanlder) {
-			::PostMessage(m_hMsgHanlder, WM_MSGID(EID_USER_OFFLINE), (WPARAM)uid, (LPARAM)reason);
-		}
+		PostEvent(EID_USER_OFFLINE, uid, reason);
 	}
 	/*
 	note:
@@ -79,9 +73,7 @@ public:
 	*/
 	virtual void onLeaveChannel(const RtcStats& stats) override
 	{
-		if (m_hMsgHanlder) {
-			::PostMessage(m_hMsgHanlder, WM_MSGID(EID_LEAVE_CHANNEL), 0, 0);
-		}
+		PostEvent(EID_LEAVE_CHANNEL, 0, 0);
 
 	}
 	/**
@@ -98,13 +90,8 @@ public:
 	 */
 	virtual void onRemoteVideoStateChanged(uid_t uid, REMOTE_VIDEO_STATE state, REMOTE_VIDEO_STATE_REASON reason, int elapsed) override
 	{
-		if (m_hMsgHanlder) {
-			PVideoStateStateChanged stateChanged = new VideoStateStateChanged;
-			stateChanged->uid = uid;
-			stateChanged->reason = reason;
-			stateChanged->state = state;
-			::PostMessage(m_hMsgHanlder, WM_MSGID(EID_REMOTE_VIDEO_STATE_CHANED), (WPARAM)stateChanged, 0);
-		}
+		//params: state, reason.
+		PostEvent(EID_REMOTE_VIDEO_STATE_CHANED, uid, state, reason);
 	}
 
 	/** 
@@ -133,8 +120,12 @@ public:
 		@param stats Statistics of the IRtcEngine: RtcStats.
 	*/
 	virtual void onRtcStats(const RtcStats& stats) {
-		if (m_hMsgHanlder)
-			::PostMessage(m_hMsgHanlder, WM_MSGID(EID_RTC_STATS),(WPARAM)new RtcStats(stats), 0);
+		if (m_eventBus) {
+			AgoraEvent event;
+			event.type = EID_RTC_STATS;
+			event.data.rtcStats = stats;
+			m_eventBus->Post(event);
+		}
 	}
 
 	/** 
@@ -172,8 +163,13 @@ public:
 		@param stats Pointer to the statistics of the received remote audio streams. See RemoteAudioStats.
 	 */
 	virtual void onRemoteAudioStats(const RemoteAudioStats& stats) {
-		if (m_hMsgHanlder)
-			::PostMessage(m_hMsgHanlder, WM_MSGID(EID_REMOTE_AUDIO_STATS), (WPARAM)new RemoteAudioStats(stats), 0);
+		if (m_eventBus) {
+			AgoraEvent event;
+			event.type = EID_REMOTE_AUDIO_STATS;
+			event.uid = stats.uid;
+			event.data.remoteAudioStats = stats;
+			m_eventBus->Post(event);
+		}
 	}
 
 
@@ -213,8 +209,12 @@ public:
 	 * @param stats Statistics of the local video stream. See LocalVideoStats.
 	 */
 	virtual void onLocalVideoStats(const LocalVideoStats& stats) {
-		if (m_hMsgHanlder)
-			::PostMessage(m_hMsgHanlder, WM_MSGID(EID_LOCAL_VIDEO_STATS), (WPARAM)new LocalVideoStats(stats), 0);
+		if (m_eventBus) {
+			AgoraEvent event;
+			event.type = EID_LOCAL_VIDEO_STATS;
+			event.data.localVideoStats = stats;
+			m_eventBus->Post(event);
+		}
 	}
 
 	/** Occurs when the local video stream state changes.
@@ -238,12 +238,29 @@ public:
 	* RemoteVideoStats.
 	*/
 	virtual void onRemoteVideoStats(const RemoteVideoStats& stats) {
-		if (m_hMsgHanlder)
-			::PostMessage(m_hMsgHanlder, WM_MSGID(EID_REMOTE_VIDEO_STATS), (WPARAM)new RemoteVideoStats(stats), 0);
+		if (m_eventBus) {
+			AgoraEvent event;
+			event.type = EID_REMOTE_VIDEO_STATS;
+			event.uid = stats.uid;
+			event.data.remoteVideoStats = stats;
+			m_eventBus->Post(event);
+		}
 	}
 
 private:
-	HWND m_hMsgHanlder;
+	void PostEvent(int type, uid_t uid, int param0, int param1 = 0)
+	{
+		if (!m_eventBus)
+			return;
+		AgoraEvent event;
+		event.type = type;
+		event.uid = uid;
+		event.data.params[0] = param0;
+		event.data.params[1] = param1;
+		m_eventBus->Post(event);
+	}
+
+	CAgoraEventBus* m_eventBus = nullptr;
 };
 
 
@@ -273,8 +290,10 @@ private:
 	bool m_initialize = false;
 	bool m_setEncrypt = false;
 	IRtcEngine* m_rtcEngine = nullptr;
+	CAgoraEngineLease m_engineLease;
 	CAGVideoWnd m_localVideoWnd;
 	CAgoraReportInCallHandler m_eventHandler;
+	CAgoraEventBus m_eventBus;
 
 	RemoteVideoStats m_remoteVideStats;
 	RemoteAudioStats m_remoteAudioStats;
@@ -284,16 +303,18 @@ private:
 protected:
 	virtual void DoDataExchange(CDataExchange* pDX);    
 	DECLARE_MESSAGE_MAP()
-	// agora sdk message window handler
-	LRESULT OnEIDJoinChannelSuccess(WPARAM wParam, LPARAM lParam);
-	LRESULT OnEIDLeaveChannel(WPARAM wParam, LPARAM lParam);
-	LRESULT OnEIDUserJoined(WPARAM wParam, LPARAM lParam);
-	LRESULT OnEIDUserOffline(WPARAM wParam, LPARAM lParam);
-	LRESULT OnEIDRemoteVideoStateChanged(WPARAM wParam, LPARAM lParam);
-	LRESULT OnEIDRemoteVideoStats(WPARAM wParam, LPARAM lParam);
-	LRESULT OnEIDRemoteAudioStats(WPARAM wParam, LPARAM lParam);
-	LRESULT OnEIDRtcStats(WPARAM wParam, LPARAM lParam);
-	LRESULT OnEIDLocalVideoStats(WPARAM wParam, LPARAM lParam);
+	// wakeup from the event bus, dispatches the queued sdk events.
+	LRESULT OnEIDEventBus(WPARAM wParam, LPARAM lParam);
+	// agora sdk event handlers, called from the event bus.
+	void OnEIDJoinChannelSuccess(const AgoraEvent& event);
+	void OnEIDLeaveChannel(const AgoraEvent& event);
+	void OnEIDUserJoined(const AgoraEvent& event);
+	void OnEIDUserOffline(const AgoraEvent& event);
+	void OnEIDRemoteVideoStateChanged(const AgoraEvent& event);
+	void OnEIDRemoteVideoStats(const AgoraEvent& event);
+	void OnEIDRemoteAudioStats(const AgoraEvent& event);
+	void OnEIDRtcStats(const AgoraEvent& event);
+	void OnEIDLocalVideoStats(const AgoraEvent& event);
 
 
 
@@ -4,6 +4,117 @@
 #include <dwmapi.h>
 #pragma comment(lib,"dwmapi.lib")
 
+namespace {
+	//size of the shared area sample fed to the adaptive controller.
+	const int SAMPLE_WIDTH = 128;
+	const int SAMPLE_HEIGHT = 72;
+	const UINT SAMPLE_INTERVAL = 200;
+
+	//a small top-down 32 bit DIB the shared area is stretched into, and the
+	//system times CPU usage is computed from. lives on the sampling thread.
+	class CAreaSampler
+	{
+	public:
+		CAreaSampler() : m_luma(SAMPLE_WIDTH * SAMPLE_HEIGHT) {}
+		~CAreaSampler()
+		{
+			if (m_hBitmap) {
+				SelectObject(m_hDC, m_hOldBitmap);
+				DeleteObject(m_hBitmap);
+			}
+			if (m_hDC)
+				DeleteDC(m_hDC);
+		}
+
+		bool Init()
+		{
+			BITMAPINFO bmi = { 0 };
+			bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+			bmi.bmiHeader.biWidth = SAMPLE_WIDTH;
+			bmi.bmiHeader.biHeight = -SAMPLE_HEIGHT;
+			bmi.bmiHeader.biPlanes = 1;
+			bmi.bmiHeader.biBitCount = 32;
+			bmi.bmiHeader.biCompression = BI_RGB;
+			HDC hdcScreen = ::GetDC(NULL);
+			m_hDC = CreateCompatibleDC(hdcScreen);
+			::ReleaseDC(NULL, hdcScreen);
+			if (!m_hDC)
+				return false;
+			m_hBitmap = CreateDIBSection(m_hDC, &bmi, DIB_RGB_COLORS, (void**)&m_bits, NULL, 0);
+			if (!m_hBitmap)
+				return false;
+			m_hOldBitmap = SelectObject(m_hDC, m_hBitmap);
+			SetStretchBltMode(m_hDC, HALFTONE);
+			SetBrushOrgEx(m_hDC, 0, 0, NULL);
+			SampleCpuUsage();
+			return true;
+		}
+
+		//grab a luma thumbnail of the shared window, or of rcShared without one.
+		bool SampleArea(HWND hSharedWnd, RECT rcShared)
+		{
+			if (hSharedWnd) {
+				//a minimized window has nothing to sample, keep the last decision.
+				if (!::IsWindow(hSharedWnd) || ::IsIconic(hSharedWnd))
+					return false;
+				::GetWindowRect(hSharedWnd, &rcShared);
+			}
+			int width = rcShared.right - rcShared.left;
+			int height = rcShared.bottom - rcShared.top;
+			if (width <= 0 || height <= 0)
+				return false;
+			HDC hdcScreen = ::GetDC(NULL);
+			BOOL ret = StretchBlt(m_hDC, 0, 0, SAMPLE_WIDTH, SAMPLE_HEIGHT,
+				hdcScreen, rcShared.left, rcShared.top, width, height, SRCCOPY);
+			::ReleaseDC(NULL, hdcScreen);
+			if (!ret)
+				return false;
+			GdiFlush();
+			//BGRA to BT.601 luma.
+			const uint8_t* src = m_bits;
+			for (int i = 0; i < SAMPLE_WIDTH * SAMPLE_HEIGHT; ++i, src += 4)
+				m_luma[i] = (uint8_t)((src[2] * 77 + src[1] * 150 + src[0] * 29) >> 8);
+			return true;
+		}
+
+		//total CPU usage since the last call in percent, -1 on the first call.
+		int SampleCpuUsage()
+		{
+			FILETIME idle, kernel, user;
+			if (!GetSystemTimes(&idle, &kernel, &user))
+				return -1;
+			//kernel time includes idle time.
+			ULONGLONG idleTime = ((ULONGLONG)idle.dwHighDateTime << 32) | idle.dwLowDateTime;
+			ULONGLONG totalTime = (((ULONGLONG)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime)
+				+ (((ULONGLONG)user.dwHighDateTime << 32) | user.dwLowDateTime);
+			int usage = -1;
+			if (m_lastTotalTime && totalTime > m_lastTotalTime)
+				usage = (int)(100 - (idleTime - m_lastIdleTime) * 100 / (totalTime - m_lastTotalTime));
+			m_lastIdleTime = idleTime;
+			m_lastTotalTime = totalTime;
+			return usage;
+		}
+
+		const uint8_t* GetLuma() const { return m_luma.data(); }
+
+	private:
+		HDC m_hDC = NULL;
+		HBITMAP m_hBitmap = NULL;
+		HGDIOBJ m_hOldBitmap = NULL;
+		uint8_t* m_bits = nullptr;
+		std::vector<uint8_t> m_luma;
+		ULONGLONG m_lastIdleTime = 0;
+		ULONGLONG m_lastTotalTime = 0;
+	};
+
+	//what EID_ADAPTIVE_CAPTURE_TARGET carries, the handler deletes it.
+	struct AdaptiveCaptureTarget {
+		ScreenShareProfile profile;
+		bool motion;
+		int cpuLevel;
+	};
+}
+
 IMPLEMENT_DYNAMIC(CAgoraScreenCapture, CDialogEx)
 
 CAgoraScreenCapture::CAgoraScreenCapture(CWnd* pParent /*=nullptr*/)
@@ -45,6 +156,7 @@ void CAgoraScreenCapture::DoDataExchange(CDataExchange* pDX)
 	DDX_Control(pDX, IDC_STATIC_WND_LIST, m_staExcludeWndList);
 	DDX_Control(pDX, IDC_CHECK_WINDOW_FOCUS, m_chkWndFocus);
 	DDX_Control(pDX, IDC_STATIC_DETAIL, m_staDetails);
+	DDX_Control(pDX, IDC_CHECK_ADAPTIVE_CAPTURE, m_chkAdaptive);
 }
 //set control text from config.
 void CAgoraScreenCapture::InitCtrlText()
@@ -67,12 +179,6 @@ void CAgoraScreenCapture::InitCtrlText()
 //Initialize the Agora SDK
 bool CAgoraScreenCapture::InitAgora()
 {
-	//create Agora RTC engine
-	m_rtcEngine = createAgoraRtcEngine();
-	if (!m_rtcEngine) {
-		m_lstInfo.InsertString(m_lstInfo.GetCount() - 1, _T("createAgoraRtcEngine failed"));
-		return false;
-	}
 	//set message notify receiver window
 	m_eventHandler.SetMsgReceiver(m_hWnd);
 
@@ -80,8 +186,9 @@ bool CAgoraScreenCapture::InitAgora()
 	std::string strAppID = GET_APP_ID;
 	context.appId = strAppID.c_str();
 	context.eventHandler = &m_eventHandler;
-	//initialize the Agora RTC engine context.  
-	int ret = m_rtcEngine->initialize(context);
+	//borrow the shared engine, this registers our event handler.
+	int ret = m_engineLease.Acquire(context);
+	m_rtcEngine = m_engineLease.GetEngine();
 	if (ret != 0) {
 		m_initialize = false;
 		CString strInfo;
@@ -111,6 +218,7 @@ bool CAgoraScreenCapture::InitAgora()
 //UnInitialize the Agora SDK
 void CAgoraScreenCapture::UnInitAgora()
 {
+	StopAdaptiveCapture();
 	if (m_rtcEngine) {
 		if(m_joinChannel)
 			m_joinChannel = !m_rtcEngine->leaveChannel();
@@ -120,8 +228,8 @@ void CAgoraScreenCapture::UnInitAgora()
 		//disable video in the engine.
 		m_rtcEngine->disableVideo();
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("disableVideo"));
-		//release engine.
-		m_rtcEngine->release(true);
+		//give the engine back to the host.
+		m_engineLease.Release();
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("release rtc engine"));
 		m_rtcEngine = NULL;
 	}
@@ -322,6 +430,7 @@ BEGIN_MESSAGE_MAP(CAgoraScreenCapture, CDialogEx)
 	ON_MESSAGE(WM_MSGID(EID_REMOTE_VIDEO_STATE_CHANED), &CAgoraScreenCapture::OnEIDRemoteVideoStateChanged)
 	ON_MESSAGE(WM_MSGID(EID_LOCAL_VIDEO_STATE_CHANGED), &CAgoraScreenCapture::OnEIDLocalVideoStateChanged)
 	ON_MESSAGE(WM_MSGID(EID_SCREEN_CAPTURE_INFO_UPDATED), &CAgoraScreenCapture::OnEIDScreenCaptureInfoUpdated)
+	ON_MESSAGE(WM_MSGID(EID_ADAPTIVE_CAPTURE_TARGET), &CAgoraScreenCapture::OnEIDAdaptiveCaptureTarget)
 
 	ON_WM_SHOWWINDOW()
     ON_BN_CLICKED(IDC_BUTTON_UPDATEPARAM, &CAgoraScreenCapture::OnBnClickedButtonUpdateparam)
@@ -329,6 +438,7 @@ BEGIN_MESSAGE_MAP(CAgoraScreenCapture, CDialogEx)
    // ON_CBN_SELCHANGE(IDC_COMBO_SCREEN_REGION, &CAgoraScreenCapture::OnCbnSelchangeComboScreenRegion)
     ON_BN_CLICKED(IDC_BUTTON_START_SHARE_SCREEN, &CAgoraScreenCapture::OnBnClickedButtonStartShareScreen)
 	ON_LBN_SELCHANGE(IDC_LIST_INFO_BROADCASTING, &CAgoraScreenCapture::OnSelchangeListInfoBroadcasting)
+	ON_BN_CLICKED(IDC_CHECK_ADAPTIVE_CAPTURE, &CAgoraScreenCapture::OnBnClickedCheckAdaptiveCapture)
 END_MESSAGE_MAP()
 
 
@@ -448,12 +558,17 @@ void CAgoraScreenCapture::OnBnClickedButtonStartShare()
         else
             m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("start share window failed！"));
 
+        m_hSharedWnd = hWnd;
+        if (ret == 0 && m_chkAdaptive.GetCheck())
+            StartAdaptiveCapture();
+
         m_btnStartCap.SetWindowText(screenShareCtrlEndCap);
 
         m_btnShareScreen.EnableWindow(FALSE);
 
     }
     else {
+        StopAdaptiveCapture();
         //stop screen capture in the engine.
         ret = m_rtcEngine->stopScreenCapture();
         if (ret == 0)
@@ -543,6 +658,8 @@ void CAgoraScreenCapture::ResumeStatus()
 
     m_chkShareCursor.SetCheck(TRUE);
 	m_chkWndFocus.SetCheck(TRUE);
+	StopAdaptiveCapture();
+	m_chkAdaptive.SetCheck(FALSE);
     m_edtFPS.SetWindowText(_T("15"));
     m_edtBitrate.SetWindowText(_T(""));
 }
@@ -728,6 +845,9 @@ void CAgoraScreenCapture::OnBnClickedButtonUpdateparam()
     ScreenCaptureParameters capParam;
     GetCaptureParameterFromCtrl(capParam);
     m_rtcEngine->updateScreenCaptureParameters(capParam);
+    //the ctrl changed, derive the adaptive profiles again.
+    if (m_adaptive)
+        StartAdaptiveCapture();
 }
 
 
@@ -904,6 +1024,20 @@ void CAgoraScreenCapture::OnBnClickedButtonStartShareScreen()
 			m_btnShareScreen.SetWindowText(screenShareCtrlStopShare);
 			m_btnStartCap.EnableWindow(FALSE);
 
+			//the source has no position, sample the primary monitor or the whole desktop.
+			m_hSharedWnd = NULL;
+			if (info.primaryMonitor) {
+				MONITORINFO monitorInfo = { sizeof(MONITORINFO) };
+				GetMonitorInfo(MonitorFromPoint(CPoint(0, 0), MONITOR_DEFAULTTOPRIMARY), &monitorInfo);
+				m_rcShared = monitorInfo.rcMonitor;
+			}
+			else {
+				agora::rtc::Rectangle rcScreen = m_monitors.GetScreenRect();
+				m_rcShared = { rcScreen.x, rcScreen.y, rcScreen.x + rcScreen.width, rcScreen.y + rcScreen.height };
+			}
+			if (m_chkAdaptive.GetCheck())
+				StartAdaptiveCapture();
+
 			m_rtcEngine->enableLocalVideo(true);
             m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("enableLocalVideo"));
 			return;
@@ -934,9 +1068,18 @@ void CAgoraScreenCapture::OnBnClickedButtonStartShareScreen()
 		m_btnShareScreen.SetWindowText(screenShareCtrlStopShare);
 
         m_btnStartCap.EnableWindow(FALSE);
+
+		m_hSharedWnd = NULL;
+		m_rcShared.left = screenRegion.x + regionRect.x;
+		m_rcShared.top = screenRegion.y + regionRect.y;
+		m_rcShared.right = m_rcShared.left + (regionRect.width ? regionRect.width : screenRegion.width);
+		m_rcShared.bottom = m_rcShared.top + (regionRect.height ? regionRect.height : screenRegion.height);
+		if (m_chkAdaptive.GetCheck())
+			StartAdaptiveCapture();
        
     }
     else {
+        StopAdaptiveCapture();
         m_rtcEngine->stopScreenCapture();
 		m_btnShareScreen.SetWindowText(screenShareCtrlShareSCreen);
         m_btnStartCap.EnableWindow(TRUE);
@@ -953,3 +1096,107 @@ void CAgoraScreenCapture::OnSelchangeListInfoBroadcasting()
 	m_lstInfo.GetText(sel, strDetail);
 	m_staDetails.SetWindowText(strDetail);
 }
+
+
+//switch adaptive capture on or off while sharing, otherwise it starts with the next share.
+void CAgoraScreenCapture::OnBnClickedCheckAdaptiveCapture()
+{
+	if (!m_rtcEngine || !(m_windowShare || m_screenShare))
+		return;
+	if (m_chkAdaptive.GetCheck()) {
+		StartAdaptiveCapture();
+	}
+	else {
+		StopAdaptiveCapture();
+		//back to the parameters from the ctrl.
+		ScreenCaptureParameters capParam;
+		GetCaptureParameterFromCtrl(capParam);
+		m_rtcEngine->updateScreenCaptureParameters(capParam);
+	}
+}
+
+void CAgoraScreenCapture::StartAdaptiveCapture()
+{
+	StopAdaptiveCapture();
+	//static content: full size at a low frame rate so text stays sharp.
+	//motion: at most 720p at the frame rate from the ctrl.
+	ScreenCaptureParameters capParam;
+	GetCaptureParameterFromCtrl(capParam);
+	ScreenShareProfile staticProfile, motionProfile;
+	staticProfile.width = capParam.dimensions.width;
+	staticProfile.height = capParam.dimensions.height;
+	staticProfile.frameRate = 5;
+	staticProfile.bitrate = capParam.bitrate;
+	motionProfile.width = min(1280, staticProfile.width);
+	motionProfile.height = min(720, staticProfile.height);
+	motionProfile.frameRate = capParam.frameRate > staticProfile.frameRate ? capParam.frameRate : 15;
+	motionProfile.bitrate = capParam.bitrate;
+	m_shareController.SetProfiles(staticProfile, motionProfile);
+	m_shareController.Reset();
+
+	m_hStopAdaptive = CreateEvent(NULL, TRUE, FALSE, NULL);
+	m_adaptiveThread = std::thread(AdaptiveCaptureThread, this, m_hSharedWnd, m_rcShared);
+	m_adaptive = true;
+	m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("adaptive capture on"));
+}
+
+void CAgoraScreenCapture::StopAdaptiveCapture()
+{
+	if (!m_adaptive)
+		return;
+	SetEvent(m_hStopAdaptive);
+	if (m_adaptiveThread.joinable())
+		m_adaptiveThread.join();
+	CloseHandle(m_hStopAdaptive);
+	m_hStopAdaptive = NULL;
+	m_adaptive = false;
+	m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("adaptive capture off"));
+}
+
+void CAgoraScreenCapture::AdaptiveCaptureThread(CAgoraScreenCapture* self, HWND hSharedWnd, RECT rcShared)
+{
+	CAreaSampler sampler;
+	if (!sampler.Init())
+		return;
+	HWND hWnd = self->GetSafeHwnd();
+	//a stretched full area blit takes milliseconds, so it runs here and
+	//only the new target goes to the UI thread.
+	while (WaitForSingleObject(self->m_hStopAdaptive, SAMPLE_INTERVAL) == WAIT_TIMEOUT) {
+		int64_t now = (int64_t)GetTickCount64();
+		if (sampler.SampleArea(hSharedWnd, rcShared))
+			self->m_shareController.OnLumaFrame(sampler.GetLuma(), SAMPLE_WIDTH, SAMPLE_HEIGHT, SAMPLE_WIDTH, now);
+		int cpuUsage = sampler.SampleCpuUsage();
+		if (cpuUsage >= 0)
+			self->m_shareController.OnCpuUsage(cpuUsage, now);
+		if (self->m_shareController.Evaluate(now)) {
+			AdaptiveCaptureTarget* target = new AdaptiveCaptureTarget;
+			target->profile = self->m_shareController.GetTarget();
+			target->motion = self->m_shareController.GetMode() == CScreenShareController::MODE_MOTION;
+			target->cpuLevel = self->m_shareController.GetCpuLevel();
+			::PostMessage(hWnd, WM_MSGID(EID_ADAPTIVE_CAPTURE_TARGET), 0, (LPARAM)target);
+		}
+	}
+}
+
+//EID_ADAPTIVE_CAPTURE_TARGET message window handler.
+LRESULT CAgoraScreenCapture::OnEIDAdaptiveCaptureTarget(WPARAM wParam, LPARAM lParam)
+{
+	AdaptiveCaptureTarget* target = (AdaptiveCaptureTarget*)lParam;
+	//posted before the sampling thread stopped.
+	if (m_adaptive && m_rtcEngine) {
+		ScreenCaptureParameters capParam;
+		GetCaptureParameterFromCtrl(capParam);
+		capParam.dimensions.width = target->profile.width;
+		capParam.dimensions.height = target->profile.height;
+		capParam.frameRate = target->profile.frameRate;
+		capParam.bitrate = target->profile.bitrate;
+		m_rtcEngine->updateScreenCaptureParameters(capParam);
+		CString strInfo;
+		strInfo.Format(_T("adaptive capture %s: %dx%d %dfps, cpu level %d"),
+			target->motion ? _T("motion") : _T("static"),
+			target->profile.width, target->profile.height, target->profile.frameRate, target->cpuLevel);
+		m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
+	}
+	delete target;
+	return 0;
+}
@@ -1,5 +1,7 @@
 ﻿#include "stdafx.h"
 #include"AGVideoWnd.h"
+#include "ScreenShareController.h"
+#include <thread>
 
 
 class CScreenCaptureEventHandler : public IRtcEngineEventHandler
@@ -159,6 +161,7 @@ public:
     afx_msg LRESULT OnEIDRemoteVideoStateChanged(WPARAM wParam, LPARAM lParam);
 	afx_msg LRESULT OnEIDLocalVideoStateChanged(WPARAM wParam, LPARAM lParam);
 	afx_msg LRESULT OnEIDScreenCaptureInfoUpdated(WPARAM wParam, LPARAM lParam);
+	afx_msg LRESULT OnEIDAdaptiveCaptureTarget(WPARAM wParam, LPARAM lParam);
 	
 protected:
     virtual void DoDataExchange(CDataExchange* pDX);   
@@ -169,6 +172,7 @@ protected:
     CScreenCaptureEventHandler m_eventHandler;
 
     IRtcEngine* m_rtcEngine = nullptr;
+    CAgoraEngineLease m_engineLease;
     bool m_joinChannel = false;
     bool m_initialize = false;
     bool m_addInjectStream = false;
@@ -178,6 +182,22 @@ protected:
 
     void GetCaptureParameterFromCtrl(agora::rtc::ScreenCaptureParameters& capParam);
     void InitMonitorInfos();
+
+    //adaptive capture: follow the content of the shared area and update
+    //the capture parameters. the profiles are derived from the ctrl.
+    void StartAdaptiveCapture();
+    void StopAdaptiveCapture();
+    //samples the shared area every SAMPLE_INTERVAL off the UI thread and posts
+    //EID_ADAPTIVE_CAPTURE_TARGET when the controller picks a new target.
+    static void AdaptiveCaptureThread(CAgoraScreenCapture* self, HWND hSharedWnd, RECT rcShared);
+    //owned by the sampling thread while it runs.
+    CScreenShareController m_shareController;
+    std::thread m_adaptiveThread;
+    HANDLE m_hStopAdaptive = NULL;
+    bool m_adaptive = false;
+    //shared window if any, else the shared area in screen coordinates.
+    HWND m_hSharedWnd = NULL;
+    RECT m_rcShared = { 0 };
 public:
     virtual BOOL OnInitDialog();
     afx_msg void OnBnClickedButtonJoinchannel();
@@ -216,4 +236,6 @@ public:
 	CButton m_chkWndFocus;
 	afx_msg void OnSelchangeListInfoBroadcasting();
 	CStatic m_staDetails;
+	CButton m_chkAdaptive;
+	afx_msg void OnBnClickedCheckAdaptiveCapture();
 };
@@ -0,0 +1,173 @@
+#include "ScreenShareController.h"
+#include <string.h>
+//no stdafx.h, the controller is tested on its own by replaying frame sequences.
+
+namespace {
+	//a thumbnail cell changed if its mean luma moved more than this.
+	const int CELL_THRESHOLD = 3;
+	//weight of the newest sample in the smoothed change rate.
+	const double CHANGE_SMOOTHING = 0.3;
+	//enter motion when every sample for ENTER_MS changed more than ENTER_RATE,
+	//leave when the smoothed rate stayed below LEAVE_RATE for LEAVE_MS.
+	const double ENTER_RATE = 0.08;
+	const double LEAVE_RATE = 0.02;
+	const int64_t ENTER_MS = 600;
+	const int64_t LEAVE_MS = 3000;
+	//step down after CPU_OVER_MS over budget, up after CPU_UNDER_MS with headroom.
+	const int CPU_HEADROOM = 15;
+	const int64_t CPU_OVER_MS = 2000;
+	const int64_t CPU_UNDER_MS = 8000;
+	const int MIN_FRAME_RATE = 1;
+
+	bool SameProfile(const ScreenShareProfile& a, const ScreenShareProfile& b)
+	{
+		return a.width == b.width && a.height == b.height
+			&& a.frameRate == b.frameRate && a.bitrate == b.bitrate;
+	}
+}
+
+CScreenShareController::CScreenShareController()
+{
+	m_motionProfile.width = 1280;
+	m_motionProfile.height = 720;
+	m_motionProfile.frameRate = 15;
+	Reset();
+}
+
+CScreenShareController::~CScreenShareController()
+{
+}
+
+void CScreenShareController::SetProfiles(const ScreenShareProfile& staticProfile, const ScreenShareProfile& motionProfile)
+{
+	m_staticProfile = staticProfile;
+	m_motionProfile = motionProfile;
+}
+
+void CScreenShareController::Reset()
+{
+	memset(m_thumb, 0, sizeof(m_thumb));
+	m_hasThumb = false;
+	m_changeRate = 0.0;
+	m_mode = MODE_STATIC;
+	m_crossedAt = -1;
+	m_cpuLevel = 0;
+	m_cpuOverAt = -1;
+	m_cpuUnderAt = -1;
+	m_target = MakeTarget();
+	m_targetReported = false;
+}
+
+//box filter the frame down to THUMB_WIDTH x THUMB_HEIGHT cells.
+void CScreenShareController::MakeThumbnail(const uint8_t* luma, int width, int height, int stride, uint8_t* thumb) const
+{
+	for (int ty = 0; ty < THUMB_HEIGHT; ++ty) {
+		int y0 = ty * height / THUMB_HEIGHT;
+		int y1 = (ty + 1) * height / THUMB_HEIGHT;
+		if (y1 <= y0)
+			y1 = y0 + 1;
+		for (int tx = 0; tx < THUMB_WIDTH; ++tx) {
+			int x0 = tx * width / THUMB_WIDTH;
+			int x1 = (tx + 1) * width / THUMB_WIDTH;
+			if (x1 <= x0)
+				x1 = x0 + 1;
+			uint32_t sum = 0;
+			for (int y = y0; y < y1; ++y) {
+				const uint8_t* row = luma + (size_t)y * stride;
+				for (int x = x0; x < x1; ++x)
+					sum += row[x];
+			}
+			thumb[ty * THUMB_WIDTH + tx] = (uint8_t)(sum / ((y1 - y0) * (x1 - x0)));
+		}
+	}
+}
+
+void CScreenShareController::OnLumaFrame(const uint8_t* luma, int width, int height, int stride, int64_t timeMs)
+{
+	if (!luma || width < THUMB_WIDTH || height < THUMB_HEIGHT)
+		return;
+	uint8_t thumb[THUMB_WIDTH * THUMB_HEIGHT];
+	MakeThumbnail(luma, width, height, stride, thumb);
+	double rate = 0.0;
+	if (m_hasThumb) {
+		int changed = 0;
+		for (int i = 0; i < THUMB_WIDTH * THUMB_HEIGHT; ++i) {
+			int diff = (int)thumb[i] - (int)m_thumb[i];
+			if (diff > CELL_THRESHOLD || diff < -CELL_THRESHOLD)
+				++changed;
+		}
+		rate = (double)changed / (THUMB_WIDTH * THUMB_HEIGHT);
+		m_changeRate += CHANGE_SMOOTHING * (rate - m_changeRate);
+	}
+	memcpy(m_thumb, thumb, sizeof(m_thumb));
+	m_hasThumb = true;
+
+	//entering looks at the raw rate: a page flip or a short scroll lifts the
+	//smoothed rate for a second or more, but only changes a sample or two.
+	bool crossed = m_mode == MODE_STATIC ? rate > ENTER_RATE : m_changeRate < LEAVE_RATE;
+	if (!crossed)
+		m_crossedAt = -1;
+	else if (m_crossedAt < 0)
+		m_crossedAt = timeMs;
+}
+
+void CScreenShareController::OnCpuUsage(int percent, int64_t timeMs)
+{
+	if (percent > m_cpuBudget) {
+		m_cpuUnderAt = -1;
+		if (m_cpuOverAt < 0)
+			m_cpuOverAt = timeMs;
+	}
+	else if (percent < m_cpuBudget - CPU_HEADROOM) {
+		m_cpuOverAt = -1;
+		if (m_cpuUnderAt < 0)
+			m_cpuUnderAt = timeMs;
+	}
+	else {
+		m_cpuOverAt = -1;
+		m_cpuUnderAt = -1;
+	}
+}
+
+bool CScreenShareController::Evaluate(int64_t timeMs)
+{
+	if (m_crossedAt >= 0) {
+		int64_t hold = m_mode == MODE_STATIC ? ENTER_MS : LEAVE_MS;
+		if (timeMs - m_crossedAt >= hold) {
+			m_mode = m_mode == MODE_STATIC ? MODE_MOTION : MODE_STATIC;
+			m_crossedAt = -1;
+		}
+	}
+	//one step per hold period, the next step needs another full period.
+	if (m_cpuOverAt >= 0 && timeMs - m_cpuOverAt >= CPU_OVER_MS && m_cpuLevel < MAX_CPU_LEVEL) {
+		++m_cpuLevel;
+		m_cpuOverAt = timeMs;
+	}
+	else if (m_cpuUnderAt >= 0 && timeMs - m_cpuUnderAt >= CPU_UNDER_MS && m_cpuLevel > 0) {
+		--m_cpuLevel;
+		m_cpuUnderAt = timeMs;
+	}
+
+	ScreenShareProfile target = MakeTarget();
+	if (m_targetReported && SameProfile(target, m_target))
+		return false;
+	m_target = target;
+	m_targetReported = true;
+	return true;
+}
+
+//profile of the mode, scaled down by 3/4 in size and 2/3 in frame rate per CPU level.
+ScreenShareProfile CScreenShareController::MakeTarget() const
+{
+	ScreenShareProfile target = m_mode == MODE_MOTION ? m_motionProfile : m_staticProfile;
+	for (int level = 0; level < m_cpuLevel; ++level) {
+		//keep the sizes even for the encoder.
+		target.width = (target.width * 3 / 4) & ~1;
+		target.height = (target.height * 3 / 4) & ~1;
+		target.frameRate = target.frameRate * 2 / 3;
+		target.bitrate = target.bitrate * 9 / 16;
+	}
+	if (target.frameRate < MIN_FRAME_RATE)
+		target.frameRate = MIN_FRAME_RATE;
+	return target;
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <stdint.h>
+
+//encoding parameters the controller asks for.
+struct ScreenShareProfile {
+	int width = 1920;
+	int height = 1080;
+	int frameRate = 5;
+	//Kbps, 0 lets the SDK choose.
+	int bitrate = 0;
+};
+
+/*
+	Picks screen share encoding parameters from what is on the screen:
+	- slides, documents and code barely change, they get the static
+	  profile, full size at a low frame rate so text stays sharp;
+	- scrolling, animations and video change a lot, they get the motion
+	  profile, smaller frames at a higher frame rate.
+	Content change is measured on a small luma thumbnail of every sampled
+	frame: the share of thumbnail cells that changed since the previous
+	sample, smoothed over time. Motion is entered once every sample for a
+	while changed, and left once the smoothed rate stayed low for longer,
+	with a lower threshold, so page flips and short scrolls do not flap.
+	When the CPU stays over budget the target steps down (lower frame rate
+	and size), and steps back up once the CPU has had headroom for a while.
+	Only plain luma buffers and millisecond timestamps go in, recorded
+	sequences can be replayed into it.
+*/
+class CScreenShareController
+{
+public:
+	enum Mode {
+		MODE_STATIC,
+		MODE_MOTION,
+	};
+	enum {
+		THUMB_WIDTH = 32,
+		THUMB_HEIGHT = 18,
+		MAX_CPU_LEVEL = 2,
+	};
+
+	CScreenShareController();
+	~CScreenShareController();
+
+	void SetProfiles(const ScreenShareProfile& staticProfile, const ScreenShareProfile& motionProfile);
+	//percent of total CPU the process may keep the machine at.
+	void SetCpuBudget(int percent) { m_cpuBudget = percent; }
+	//forget all history and start over in the static profile.
+	void Reset();
+
+	//one sampled frame, 8 bit luma of any size.
+	void OnLumaFrame(const uint8_t* luma, int width, int height, int stride, int64_t timeMs);
+	//total CPU usage in percent, sampled at timeMs.
+	void OnCpuUsage(int percent, int64_t timeMs);
+	//true if the target changed since the last call that returned true.
+	bool Evaluate(int64_t timeMs);
+
+	const ScreenShareProfile& GetTarget() const { return m_target; }
+	Mode GetMode() const { return m_mode; }
+	int GetCpuLevel() const { return m_cpuLevel; }
+	//smoothed share of changed thumbnail cells, 0 to 1.
+	double GetChangeRate() const { return m_changeRate; }
+
+private:
+	void MakeThumbnail(const uint8_t* luma, int width, int height, int stride, uint8_t* thumb) const;
+	ScreenShareProfile MakeTarget() const;
+
+	ScreenShareProfile m_staticProfile;
+	ScreenShareProfile m_motionProfile;
+	int m_cpuBudget = 70;
+
+	uint8_t m_thumb[THUMB_WIDTH * THUMB_HEIGHT];
+	bool m_hasThumb = false;
+	double m_changeRate = 0.0;
+
+	Mode m_mode = MODE_STATIC;
+	//time the change rate crossed the threshold of the other mode, -1 if it
+	//is on the side of the current mode.
+	int64_t m_crossedAt = -1;
+
+	int m_cpuLevel = 0;
+	int64_t m_cpuOverAt = -1;
+	int64_t m_cpuUnderAt = -1;
+
+	ScreenShareProfile m_target;
+	bool m_targetReported = false;
+};
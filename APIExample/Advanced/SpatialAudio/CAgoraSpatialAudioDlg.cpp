@@ -1,13 +1,14 @@
 ﻿#include "stdafx.h"
 #include "APIExample.h"
 #include "CAgoraSpatialAudioDlg.h"
+#include <math.h>
 
 
 
 IMPLEMENT_DYNAMIC(CAgoraSpatialAudioDlg, CDialogEx)
 
 CAgoraSpatialAudioDlg::CAgoraSpatialAudioDlg(CWnd* pParent /*=nullptr*/)
-	: CDialogEx(IDD_DIALOG_AUDIO_MIX, pParent)
+	: CDialogEx(IDD_DIALOG_SPATIAL_AUDIO, pParent)
 {
 
 }
@@ -28,12 +29,6 @@ void CAgoraSpatialAudioDlg::InitCtrlText()
 //Initialize the Agora SDK
 bool CAgoraSpatialAudioDlg::InitAgora()
 {
-	//create Agora RTC engine
-	m_rtcEngine = createAgoraRtcEngine();
-	if (!m_rtcEngine) {
-		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("createAgoraRtcEngine failed"));
-		return false;
-	}
 	//set message notify receiver window
 	m_eventHandler.SetMsgReceiver(m_hWnd);
 
@@ -41,8 +36,9 @@ bool CAgoraSpatialAudioDlg::InitAgora()
 	std::string strAppID = GET_APP_ID;
 	context.appId = strAppID.c_str();
 	context.eventHandler = &m_eventHandler;
-	//initialize the Agora RTC engine context.
-	int ret = m_rtcEngine->initialize(context);
+	//borrow the shared engine, this registers our event handler.
+	int ret = m_engineLease.Acquire(context);
+	m_rtcEngine = m_engineLease.GetEngine();
 	if (ret != 0) {
 		m_initialize = false;
 		CString strInfo;
@@ -87,6 +83,16 @@ bool CAgoraSpatialAudioDlg::InitAgora()
 void CAgoraSpatialAudioDlg::UnInitAgora()
 {
 	if (m_rtcEngine) {
+		//leaving in the middle of the test.
+		if (m_SpatialAudio) {
+			KillTimer(echoTestId);
+			KillTimer(disableSpatialId);
+			m_rtcEngine->stopAudioMixing();
+			m_rtcEngine->stopEchoTest();
+			canmove = false;
+		}
+		if (m_spatialRendering)
+			RegisterSpatialAudioObserver(FALSE);
 		if (m_joinChannel)
 			//leave channel
 			m_joinChannel = !m_rtcEngine->leaveChannel();
@@ -96,8 +102,8 @@ void CAgoraSpatialAudioDlg::UnInitAgora()
 		//disable video in the engine.
 		m_rtcEngine->disableVideo();
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("disableVideo"));
-		//release engine.
-		m_rtcEngine->release(true);
+		//give the engine back to the host.
+		m_engineLease.Release();
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("release rtc engine"));
 		m_rtcEngine = NULL;
 	}
@@ -232,8 +238,13 @@ BOOL CAgoraSpatialAudioDlg::OnInitDialog()
 
 	int deltaX = abs(rcRemote.left - rcLocal.left);
 	int deltaY = abs(rcRemote.top - rcLocal.top);
-	int maxdis = sqrt(deltaX*deltaX + deltaY * deltaY);
+	int maxdis = (int)sqrt((double)(deltaX * deltaX + deltaY * deltaY));
 	distanceRate = maxdis / 30.0f;
+	//the corner of the area is 30 meters away.
+	m_spatialRenderer.SetDistanceModel(1.0f, 40.0f, 0.5f);
+	if (!m_spatialRenderer.Init(48000))
+		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("spatial audio renderer init failed"));
+	m_spatialObserver.SetRenderer(&m_spatialRenderer);
 	//remoteImage.Create(70, 70, ILC_COLOR32 | ILC_MASK, 1, 1);
 	//CBitmap bmp;
 	//bmp.LoadBitmap(IDB_BITMAP_NETWORK_STATE);
@@ -268,7 +279,7 @@ LRESULT CAgoraSpatialAudioDlg::OnEIDUserJoined(WPARAM wParam, LPARAM lParam)
 	CString strInfo;
 	strInfo.Format(_T("%u joined"), wParam);
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
-	uid = wParam;
+	uid = (unsigned int)wParam;
 	SetSpatialAudioParam();
 	return 0;
 }
@@ -281,6 +292,7 @@ LRESULT CAgoraSpatialAudioDlg::OnEIDUserOffline(WPARAM wParam, LPARAM lParam)
 	canvas.uid = remoteUid;
 	canvas.view = NULL;
 	m_rtcEngine->setupRemoteVideo(canvas);
+	m_spatialRenderer.RemoveSource(remoteUid);
 	CString strInfo;
 	strInfo.Format(_T("%u offline, reason:%d"), remoteUid, lParam);
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
@@ -294,7 +306,7 @@ LRESULT CAgoraSpatialAudioDlg::OnLButtonDownVideo(WPARAM wParam, LPARAM lParam)
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), L"Start first");
 		return 0;
 	}
-	POINT pt = { wParam, lParam };
+	POINT pt = { (LONG)wParam, (LONG)lParam };
 	if (PtInRect(&rcRemote, pt)) {
 		moveRemote = true;
 		origin = pt;
@@ -304,53 +316,51 @@ LRESULT CAgoraSpatialAudioDlg::OnLButtonDownVideo(WPARAM wParam, LPARAM lParam)
 
 void CAgoraSpatialAudioDlg::SetSpatialAudioParam()
 {
-	POINT ptLocal = { rcLocal.left + localWidth / 2.0f,rcLocal.top + localWidth / 2.0f };
-	POINT ptRemote = { rcRemote.left + remoteWidth / 2.0f,rcRemote.top + remoteWidth / 2.0f };
-
-	SpatialAudioParams spatial_audio_params;
-	int deltaX = ptRemote.x - ptLocal.x;
-	int deltaY = ptLocal.y - ptRemote.y;
-
-	int tanAngle = 0;
-	float tanValue = 1;
-	if (deltaX == 0) {
-		if (deltaY > 0)
-			tanAngle = 360;
-		else if (deltaY < 0)
-			tanAngle = 180;
-	}else{
-		tanValue = fabs(deltaY) / fabs(deltaX);
-		tanAngle = atan(tanValue) * 180.0 / 3.1415926;
-	}
+	POINT ptLocal = { rcLocal.left + localWidth / 2, rcLocal.top + localWidth / 2 };
+	POINT ptRemote = { rcRemote.left + remoteWidth / 2, rcRemote.top + remoteWidth / 2 };
+
+	//screen right is the listener's right, screen up is ahead.
+	float deltaX = (float)(ptRemote.x - ptLocal.x);
+	float deltaY = (float)(ptLocal.y - ptRemote.y);
+	float x = deltaX / distanceRate;
+	float y = deltaY / distanceRate;
+	m_spatialRenderer.SetSourcePosition(uid, x, y, 0);
+	//the echo test plays our own voice back, it has no remote uid of its own.
+	m_spatialRenderer.SetDefaultPosition(x, y, 0);
+
+	//angle 0 is ahead and grows counterclockwise.
+	double spatialAngle = fmod(atan2(-deltaX, deltaY) * 180.0 / 3.14159265358979 + 360.0, 360.0);
+	CString str;
+	str.Format(_T("azimuth %.1f distance %.1fm\n"), spatialAngle, sqrt(x * x + y * y));
+	OutputDebugString(str);
+}
 
-	int spatialAngle = 0.0; // It is Angle 0 when at Y direction
-	if (deltaX > 0 && deltaY > 0) { // scope I
-		spatialAngle = 270.0 + tanAngle;
-	}
-	else if (deltaX < 0 && deltaY > 0) { // scope II
-		spatialAngle = 90.0 - tanAngle;
-	}
-	else if (deltaX < 0 && deltaY < 0) { // scope III
-		spatialAngle = 90.0 + tanAngle;
+BOOL CAgoraSpatialAudioDlg::RegisterSpatialAudioObserver(BOOL bEnable)
+{
+	agora::util::AutoPtr<agora::media::IMediaEngine> mediaEngine;
+	//query interface agora::AGORA_IID_MEDIA_ENGINE in the engine.
+	mediaEngine.queryInterface(m_rtcEngine, agora::AGORA_IID_MEDIA_ENGINE);
+	if (mediaEngine.get() == NULL)
+		return FALSE;
+	int nRet = 0;
+	if (bEnable) {
+		//the renderer writes stereo at its own rate into the playback frame.
+		m_engineLease.SetPlaybackAudioFrameParameters(m_spatialRenderer.GetSampleRate(), 2,
+			RAW_AUDIO_FRAME_OP_MODE_READ_WRITE, m_spatialRenderer.GetSampleRate() / 100);
+		m_spatialRenderer.Reset();
+		nRet = m_engineLease.RegisterAudioFrameObserver(&m_spatialObserver);
 	}
-	else if (deltaX > 0 && deltaY < 0) { // scope VI
-		spatialAngle = 270.0 - tanAngle;
+	else {
+		nRet = mediaEngine->registerAudioFrameObserver(NULL);
+		m_spatialRenderer.Reset();
 	}
-
-	CString str;
-	str.Format(_T("%d\n"), spatialAngle);
-	OutputDebugString(str);
-	int spatialDistance =  sqrt(deltaX*deltaX + deltaY * deltaY) / distanceRate;
-	spatial_audio_params.speaker_distance = 0;// spatialDistance;
-	spatial_audio_params.speaker_azimuth = spatialAngle;
-	spatial_audio_params.speaker_elevation = 0;
-	spatial_audio_params.speaker_orientation = 0;
-	m_rtcEngine->setRemoteUserSpatialAudioParams(uid, spatial_audio_params);
+	m_spatialRendering = bEnable && nRet == 0;
+	return nRet == 0 ? TRUE : FALSE;
 }
 
 LRESULT CAgoraSpatialAudioDlg::OnLButtonUpVideo(WPARAM wParam, LPARAM lParam)
 {
-	POINT pt = { wParam, lParam };
+	POINT pt = { (LONG)wParam, (LONG)lParam };
 	if (moveRemote) {
 		moveRemote = true;
 		int x = rcRemote.left + (pt.x - origin.x);
@@ -381,7 +391,7 @@ LRESULT CAgoraSpatialAudioDlg::OnLButtonUpVideo(WPARAM wParam, LPARAM lParam)
 
 void CAgoraSpatialAudioDlg::OnBnClickedButtonStart()
 {
-	m_SpatialAudio = !m_SpatialAudio;
+	m_SpatialAudio = true;
 	SetTimer(echoTestId, 10000, NULL);
 	m_rtcEngine->startEchoTest(10);
 	CString strInfo;
@@ -403,8 +413,8 @@ void CAgoraSpatialAudioDlg::OnTimer(UINT_PTR nIDEvent)
 		strInfo.Format(_T("stopAudioMixing "));
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
 		m_rtcEngine->stopAudioMixing();
-		m_rtcEngine->enableSpatialAudio(true);
-		strInfo.Format(_T("enableSpatialAudio true "));
+		RegisterSpatialAudioObserver(TRUE);
+		strInfo.Format(_T("spatial audio renderer on"));
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
 		SetTimer(disableSpatialId, 10000, NULL);
 		KillTimer(echoTestId);
@@ -412,15 +422,16 @@ void CAgoraSpatialAudioDlg::OnTimer(UINT_PTR nIDEvent)
 		canmove = true;
 	}
 	else if (disableSpatialId == nIDEvent) {
-		m_rtcEngine->enableSpatialAudio(false);
+		RegisterSpatialAudioObserver(FALSE);
 		CString strInfo;
-		strInfo.Format(_T("enableSpatialAudio false "));
+		strInfo.Format(_T("spatial audio renderer off"));
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
 		KillTimer(disableSpatialId);
 		m_rtcEngine->stopEchoTest();
 		strInfo.Format(_T("stopEchoTest"));
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
 		canmove = false;
+		m_SpatialAudio = false;
 		m_localVideoWnd.ShowVideoInfo(SpatialAudioInitInfo, TRUE);
 
 		m_btnStart.EnableWindow(TRUE);
@@ -530,6 +541,27 @@ void CSpatialAudioEventHandler::onRemoteVideoStateChanged(uid_t uid, REMOTE_VIDE
 	}
 }
 
+//spatial audio frame observer
+bool CSpatialAudioFrameObserver::onPlaybackAudioFrame(AudioFrame& audioFrame)
+{
+	if (!m_renderer || audioFrame.samplesPerSec != m_renderer->GetSampleRate()
+		|| audioFrame.bytesPerSample != 2)
+		return true;
+	m_renderer->Render(static_cast<int16_t*>(audioFrame.buffer), audioFrame.samples, audioFrame.channels, true);
+	return true;
+}
+
+bool CSpatialAudioFrameObserver::onPlaybackAudioFrameBeforeMixing(unsigned int uid, AudioFrame& audioFrame)
+{
+	//a user at another rate stays in the SDK mix unspatialized.
+	if (!m_renderer || audioFrame.samplesPerSec != m_renderer->GetSampleRate()
+		|| audioFrame.bytesPerSample != 2)
+		return true;
+	m_renderer->SubmitSource(uid, static_cast<const int16_t*>(audioFrame.buffer), audioFrame.samples, audioFrame.channels);
+	memset(audioFrame.buffer, 0, audioFrame.samples * audioFrame.channels * audioFrame.bytesPerSample);
+	return true;
+}
+
 void CSpatialAudioEventHandler::onAudioMixingStateChanged(AUDIO_MIXING_STATE_TYPE state, AUDIO_MIXING_REASON_TYPE reason)
 {
 	if (m_hMsgHanlder) {
@@ -1,7 +1,27 @@
 ﻿#pragma once
 #include "AGVideoWnd.h"
+#include "dsp/SpatialAudioRenderer.h"
 #include <map>
 
+/*
+	Spatializes remote users in the client: every user's frame is handed
+	to the renderer before mixing and silenced in the SDK mix, the
+	renderer's binaural mix then replaces the playback frame.
+*/
+class CSpatialAudioFrameObserver :
+	public agora::media::IAudioFrameObserver
+{
+public:
+	void SetRenderer(CSpatialAudioRenderer* renderer) { m_renderer = renderer; }
+
+	virtual bool onRecordAudioFrame(AudioFrame& audioFrame) override { return true; }
+	virtual bool onPlaybackAudioFrame(AudioFrame& audioFrame) override;
+	virtual bool onMixedAudioFrame(AudioFrame& audioFrame) override { return true; }
+	virtual bool onPlaybackAudioFrameBeforeMixing(unsigned int uid, AudioFrame& audioFrame) override;
+private:
+	CSpatialAudioRenderer* m_renderer = nullptr;
+};
+
 class CSpatialAudioEventHandler : public IRtcEngineEventHandler
 {
 public:
@@ -114,11 +134,14 @@ protected:
 	LRESULT OnLButtonDownVideo(WPARAM wParam, LPARAM lParam);
 	LRESULT OnLButtonUpVideo(WPARAM wParam, LPARAM lParam);
 	void SetSpatialAudioParam();
+	//register or unregister the spatial audio frame observer.
+	BOOL RegisterSpatialAudioObserver(BOOL bEnable);
 private:
 	bool m_joinChannel = false;
 	bool m_initialize = false;
 	bool m_SpatialAudio = false;
 	IRtcEngine* m_rtcEngine = nullptr;
+	CAgoraEngineLease m_engineLease;
 	CAGVideoWnd m_localVideoWnd;
 	CSpatialAudioEventHandler m_eventHandler;
 	CStatic m_staLocal;
@@ -132,9 +155,12 @@ private:
 	int localWidth = 70;
 	UINT echoTestId = 10086;
 	UINT disableSpatialId = 10087;
-	unsigned int uid;
+	unsigned int uid = 0;
 
 	float distanceRate = 1.0f;
+	CSpatialAudioRenderer m_spatialRenderer;
+	CSpatialAudioFrameObserver m_spatialObserver;
+	bool m_spatialRendering = false;
 	bool canmove = false;
 
 	CImageList remoteImage;
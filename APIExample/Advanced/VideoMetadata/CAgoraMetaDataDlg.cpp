@@ -280,12 +280,6 @@ void CAgoraMetaDataDlg::InitCtrlText()
 //Initialize the Agora SDK
 bool CAgoraMetaDataDlg::InitAgora()
 {
-    //create Agora RTC engine
-    m_rtcEngine = createAgoraRtcEngine();
-    if (!m_rtcEngine) {
-        m_lstInfo.InsertString(m_lstInfo.GetCount() - 1, _T("createAgoraRtcEngine failed"));
-        return false;
-    }
     //set message notify receiver window
     m_eventHandler.SetMsgReceiver(m_hWnd);
 
@@ -293,8 +287,9 @@ bool CAgoraMetaDataDlg::InitAgora()
 	std::string strAppID = GET_APP_ID;
 	context.appId = strAppID.c_str();
     context.eventHandler = &m_eventHandler;
-    //initialize the Agora RTC engine context.  
-    int ret = m_rtcEngine->initialize(context);
+    //borrow the shared engine, this registers our event handler.
+    int ret = m_engineLease.Acquire(context);
+    m_rtcEngine = m_engineLease.GetEngine();
     if (ret != 0) {
         m_initialize = false;
         CString strInfo;
@@ -317,7 +312,7 @@ bool CAgoraMetaDataDlg::InitAgora()
     //set meta data observer notify window.
     m_metaDataObserver.SetMsgReceiver(m_hWnd);
     //register media meta data observer.
-    m_rtcEngine->registerMediaMetadataObserver(&m_metaDataObserver, IMetadataObserver::VIDEO_METADATA);
+    m_engineLease.RegisterMediaMetadataObserver(&m_metaDataObserver, IMetadataObserver::VIDEO_METADATA);
 
     m_btnJoinChannel.EnableWindow(TRUE);
     return true;
@@ -335,8 +330,8 @@ void CAgoraMetaDataDlg::UnInitAgora()
         //disable video in the engine.
         m_rtcEngine->disableVideo();
         m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("disableVideo"));
-        //release engine.
-        m_rtcEngine->release(true);
+        //give the engine back to the host.
+        m_engineLease.Release();
         m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("release rtc engine"));
         m_rtcEngine = NULL;
     }
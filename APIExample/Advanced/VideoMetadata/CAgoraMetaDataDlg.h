@@ -164,6 +164,7 @@ public:
 
 private:
     IRtcEngine* m_rtcEngine = nullptr;
+    CAgoraEngineLease m_engineLease;
     CAgoraMetaDataEventHanlder m_eventHandler;
 
     bool m_joinChannel    = false;
@@ -14,6 +14,8 @@ CAgoraVideoProfileDlg::CAgoraVideoProfileDlg(CWnd* pParent /*=nullptr*/)
 
 CAgoraVideoProfileDlg::~CAgoraVideoProfileDlg()
 {
+	if (m_benchmarkThread.joinable())
+		m_benchmarkThread.join();
 }
 
 void CAgoraVideoProfileDlg::DoDataExchange(CDataExchange* pDX)
@@ -46,6 +48,7 @@ BEGIN_MESSAGE_MAP(CAgoraVideoProfileDlg, CDialogEx)
 	ON_MESSAGE(WM_MSGID(EID_USER_JOINED), &CAgoraVideoProfileDlg::OnEIDUserJoined)
 	ON_MESSAGE(WM_MSGID(EID_USER_OFFLINE), &CAgoraVideoProfileDlg::OnEIDUserOffline)
 	ON_MESSAGE(WM_MSGID(EID_REMOTE_VIDEO_STATE_CHANED), &CAgoraVideoProfileDlg::OnEIDRemoteVideoStateChanged)
+	ON_MESSAGE(WM_MSGID(EID_HOST_PROFILE), &CAgoraVideoProfileDlg::OnEIDHostProfile)
 	ON_BN_CLICKED(IDC_BUTTON_JOINCHANNEL, &CAgoraVideoProfileDlg::OnBnClickedButtonJoinchannel)
 	ON_BN_CLICKED(IDC_BUTTON_SET_VIDEO_PROFILE, &CAgoraVideoProfileDlg::OnBnClickedButtonSetVideoProfile)
 	ON_LBN_SELCHANGE(IDC_LIST_INFO_BROADCASTING, &CAgoraVideoProfileDlg::OnSelchangeListInfoBroadcasting)
@@ -68,12 +71,6 @@ void CAgoraVideoProfileDlg::InitCtrlText()
 //Initialize the Agora SDK
 bool CAgoraVideoProfileDlg::InitAgora()
 {
-	//create Agora RTC engine
-	m_rtcEngine = createAgoraRtcEngine();
-	if (!m_rtcEngine) {
-		m_lstInfo.InsertString(m_lstInfo.GetCount() - 1, _T("createAgoraRtcEngine failed"));
-		return false;
-	}
 	//set message notify receiver window
 	m_eventHandler.SetMsgReceiver(m_hWnd);
 
@@ -81,8 +78,9 @@ bool CAgoraVideoProfileDlg::InitAgora()
 	std::string strAppID = GET_APP_ID;
 	context.appId = strAppID.c_str();
 	context.eventHandler = &m_eventHandler;
-	//initialize the Agora RTC engine context.
-	int ret = m_rtcEngine->initialize(context);
+	//borrow the shared engine, this registers our event handler.
+	int ret = m_engineLease.Acquire(context);
+	m_rtcEngine = m_engineLease.GetEngine();
 	if (ret != 0) {
 		m_initialize = false;
 		CString strInfo;
@@ -117,8 +115,8 @@ void CAgoraVideoProfileDlg::UnInitAgora()
 		//disable video in the engine.
 		m_rtcEngine->disableVideo();
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("disableVideo"));
-		//release engine.
-		m_rtcEngine->release(true);
+		//give the engine back to the host.
+		m_engineLease.Release();
 		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("release rtc engine"));
 		m_rtcEngine = NULL;
 	}
@@ -156,6 +154,7 @@ void CAgoraVideoProfileDlg::ResumeStatus()
 	m_btnSetVideoProfile.SetWindowText(videoProfileCtrlSetVideoProfile);
 	
 	m_lstInfo.ResetContent();
+	PrefillEncoderAdvice();
 	m_joinChannel = false;
 	m_initialize = false;
 	m_setVideo = false;
@@ -195,12 +194,87 @@ BOOL CAgoraVideoProfileDlg::OnInitDialog()
 	m_mapFrameRate.insert(std::make_pair(_T("FRAME_RATE_FPS_30"), FRAME_RATE_FPS_30));
 	m_mapFrameRate.insert(std::make_pair(_T("FRAME_RATE_FPS_60"), FRAME_RATE_FPS_60));
 
-
+	AdviseEncoderConfiguration();
 
 	ResumeStatus();
 	return TRUE;
 }
 
+//load the numbers cached for the host and advise an encoder
+//configuration for it and the first camera, or benchmark it on a worker
+//that posts EID_HOST_PROFILE.
+void CAgoraVideoProfileDlg::AdviseEncoderConfiguration()
+{
+	//the SDK opens the same camera, its formats bound what it can capture.
+	//DirectShow enumerates on this thread, it has COM.
+	GetCaptureDeviceFormats(CAPTURE_BACKEND_DSHOW, 0, m_captureFormats);
+	std::string strProfile = cs2utf8(GetExePath() + _T("\\hostProfile.txt"));
+	HostProfile host;
+	if (LoadHostProfile(strProfile, host)) {
+		ApplyHostProfile(host, true);
+		return;
+	}
+	//the benchmark takes a few hundred milliseconds, once per machine.
+	m_strHostInfo = _T("benchmarking the host");
+	HWND hWnd = GetSafeHwnd();
+	m_benchmarkThread = std::thread([hWnd, strProfile]() {
+		HostProfile* measured = new HostProfile(GetHostProfile(strProfile));
+		if (!::PostMessage(hWnd, WM_MSGID(EID_HOST_PROFILE), 0, (LPARAM)measured))
+			delete measured;
+	});
+}
+
+//advise from the host's numbers and the camera formats.
+void CAgoraVideoProfileDlg::ApplyHostProfile(const HostProfile& host, bool cached)
+{
+	m_strHostInfo.Format(_T("host %s: %s"), cached ? _T("cached") : _T("measured"),
+		utf82cs(DescribeHostProfile(host)));
+	CEncoderAdvisor advisor(host);
+	m_encoderAdvice = advisor.Advise(m_captureFormats, EncoderAdviceRequest());
+}
+
+//start the controls from the advice.
+void CAgoraVideoProfileDlg::PrefillEncoderAdvice()
+{
+	if (!m_strHostInfo.IsEmpty())
+		m_lstInfo.InsertString(m_lstInfo.GetCount(), m_strHostInfo);
+	if (!m_encoderAdvice.valid)
+		return;
+	//start from what this machine and camera are advised to do.
+	const VideoEncoderConfiguration& config = m_encoderAdvice.config;
+	CString strValue;
+	strValue.Format(_T("%d"), config.dimensions.width);
+	m_edtWidth.SetWindowText(strValue);
+	strValue.Format(_T("%d"), config.dimensions.height);
+	m_edtHeight.SetWindowText(strValue);
+	//the control is sent as an explicit bitrate, STANDARD_BITRATE would
+	//show as 0.
+	strValue.Format(_T("%d"), m_encoderAdvice.estimate.baseKbps);
+	m_edtBitrate.SetWindowText(strValue);
+	strValue.Format(_T("FRAME_RATE_FPS_%d"), config.frameRate);
+	m_cmbFPS.SetCurSel((std::max)(m_cmbFPS.FindStringExact(-1, strValue), 0));
+	m_cmbDegradationPre.SetCurSel(config.degradationPreference);
+	m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("advised: ") + utf82cs(CEncoderAdvisor::DescribeAdvice(m_encoderAdvice)));
+}
+
+//EID_HOST_PROFILE message window handler.
+LRESULT CAgoraVideoProfileDlg::OnEIDHostProfile(WPARAM wParam, LPARAM lParam)
+{
+	HostProfile* host = reinterpret_cast<HostProfile*>(lParam);
+	ApplyHostProfile(*host, false);
+	delete host;
+	if (m_benchmarkThread.joinable())
+		m_benchmarkThread.join();
+	//once the user has set a profile or joined, only report the advice.
+	if (m_setVideo || m_joinChannel) {
+		m_lstInfo.InsertString(m_lstInfo.GetCount(), m_strHostInfo);
+		m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("advised: ") + utf82cs(CEncoderAdvisor::DescribeAdvice(m_encoderAdvice)));
+	}
+	else
+		PrefillEncoderAdvice();
+	return 0;
+}
+
 // set video profile
 void CAgoraVideoProfileDlg::OnBnClickedButtonSetVideoProfile()
 {
@@ -1,5 +1,7 @@
 ﻿#pragma once
 #include "AGVideoWnd.h"
+#include "capture/EncoderAdvisor.h"
+#include <thread>
 
 
 class CAgoraVideoProfileEventHandler : public IRtcEngineEventHandler
@@ -103,14 +105,28 @@ public:
 	void RenderLocalVideo();
 	//resume window status
 	void ResumeStatus();
+	//load the numbers cached for the host and advise an encoder
+	//configuration for it and the first camera, or benchmark it on a worker
+	//that posts EID_HOST_PROFILE.
+	void AdviseEncoderConfiguration();
+	//advise from the host's numbers and the camera formats.
+	void ApplyHostProfile(const HostProfile& host, bool cached);
+	//start the controls from the advice.
+	void PrefillEncoderAdvice();
 
 private:
 	bool m_joinChannel = false;
 	bool m_initialize = false;
 	bool m_setVideo = false;
 	IRtcEngine* m_rtcEngine = nullptr;
+	CAgoraEngineLease m_engineLease;
 	CAGVideoWnd m_localVideoWnd;
 	CAgoraVideoProfileEventHandler m_eventHandler;
+	//prefilled into the controls on every reset.
+	EncoderAdvice m_encoderAdvice;
+	CString m_strHostInfo;
+	std::vector<CaptureFormat> m_captureFormats;
+	std::thread m_benchmarkThread;
 
 public:
 	LRESULT OnEIDJoinChannelSuccess(WPARAM wParam, LPARAM lParam);
@@ -118,6 +134,7 @@ public:
 	LRESULT OnEIDUserJoined(WPARAM wParam, LPARAM lParam);
 	LRESULT OnEIDUserOffline(WPARAM wParam, LPARAM lParam);
 	LRESULT OnEIDRemoteVideoStateChanged(WPARAM wParam, LPARAM lParam);
+	LRESULT OnEIDHostProfile(WPARAM wParam, LPARAM lParam);
 
 
 protected:
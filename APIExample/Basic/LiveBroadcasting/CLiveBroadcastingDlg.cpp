@@ -18,9 +18,7 @@ parameters:
 */
 void CLiveBroadcastingRtcEngineEventHandler::onJoinChannelSuccess(const char* channel, uid_t uid, int elapsed)
 {
-    if (m_hMsgHanlder) {
-        ::PostMessage(m_hMsgHanlder, WM_MSGID(EID_JOINCHANNEL_SUCCESS), (WPARAM)uid, (LPARAM)elapsed);
-    }
+    PostEvent(EID_JOINCHANNEL_SUCCESS, uid, elapsed);
 }
 
 /*
@@ -37,9 +35,7 @@ parameters:
     by the callback(ms).
 */
 void CLiveBroadcastingRtcEngineEventHandler::onUserJoined(uid_t uid, int elapsed) {
-    if (m_hMsgHanlder) {
-        ::PostMessage(m_hMsgHanlder, WM_MSGID(EID_USER_JOINED), (WPARAM)uid, (LPARAM)elapsed);
-    }
+    PostEvent(EID_USER_JOINED, uid, elapsed);
 }
 
 /*
@@ -60,9 +56,7 @@ parameters:
 */
 void CLiveBroadcastingRtcEngineEventHandler::onUserOffline(uid_t uid, USER_OFFLINE_REASON_TYPE reason)
 {
-    if (m_hMsgHanlder) {
-        ::PostMessage(m_hMsgHanlder, WM_MSGID(EID_USER_OFFLINE), (WPARAM)uid, (LPARAM)reason);
-    }
+    PostEvent(EID_USER_OFFLINE, uid, reason);
 }
 
 /*
@@ -77,16 +71,12 @@ parametes:
 */
 void CLiveBroadcastingRtcEngineEventHandler::onLeaveChannel(const RtcStats& stats)
 {
-    if (m_hMsgHanlder) {
-        ::PostMessage(m_hMsgHanlder, WM_MSGID(EID_LEAVE_CHANNEL), 0, 0);
-    }
+    PostEvent(EID_LEAVE_CHANNEL, 0, 0);
 }
 
 void CLiveBroadcastingRtcEngineEventHandler::onAudioDeviceStateChanged(const char* deviceId, int deviceType, int deviceState)
 {
-	if (m_hMsgHanlder) {
-		::PostMessage(m_hMsgHanlder, WM_MSGID(EID_AUDIO_DEVICE_STATE_CHANGED), 0, 0);
-	}
+	PostEvent(EID_AUDIO_DEVICE_STATE_CHANGED, 0, deviceType, deviceState);
 }
 
 // CLiveBroadcastingDlg dialog
@@ -137,10 +127,7 @@ BEGIN_MESSAGE_MAP(CLiveBroadcastingDlg, CDialogEx)
     ON_BN_CLICKED(IDC_BUTTON_JOINCHANNEL, &CLiveBroadcastingDlg::OnBnClickedButtonJoinchannel)
     ON_CBN_SELCHANGE(IDC_COMBO_PERSONS, &CLiveBroadcastingDlg::OnSelchangeComboPersons)
     ON_CBN_SELCHANGE(IDC_COMBO_ROLE, &CLiveBroadcastingDlg::OnSelchangeComboRole)
-    ON_MESSAGE(WM_MSGID(EID_JOINCHANNEL_SUCCESS), &CLiveBroadcastingDlg::OnEIDJoinChannelSuccess)
-    ON_MESSAGE(WM_MSGID(EID_LEAVE_CHANNEL), &CLiveBroadcastingDlg::OnEIDLeaveChannel)
-    ON_MESSAGE(WM_MSGID(EID_USER_JOINED), &CLiveBroadcastingDlg::OnEIDUserJoined)
-    ON_MESSAGE(WM_MSGID(EID_USER_OFFLINE), &CLiveBroadcastingDlg::OnEIDUserOffline)
+    ON_MESSAGE(WM_MSGID(EID_EVENT_BUS), &CLiveBroadcastingDlg::OnEIDEventBus)
     ON_WM_SHOWWINDOW()
     ON_LBN_SELCHANGE(IDC_LIST_INFO_BROADCASTING, &CLiveBroadcastingDlg::OnSelchangeListInfoBroadcasting)
     ON_STN_CLICKED(IDC_STATIC_VIDEO, &CLiveBroadcastingDlg::OnStnClickedStaticVideo)
@@ -151,17 +138,6 @@ BEGIN_MESSAGE_MAP(CLiveBroadcastingDlg, CDialogEx)
 	ON_BN_CLICKED(IDC_BUTTON_IMAGE, &CLiveBroadcastingDlg::OnBnClickedButtonImage)
 	ON_BN_CLICKED(IDC_CHECK_ENABLE_BACKGROUND, &CLiveBroadcastingDlg::OnBnClickedCheckEnableBackground)
 	ON_CBN_SELCHANGE(IDC_COMBO_BACKGROUND_TYPE, &CLiveBroadcastingDlg::OnSelchangeComboBackgroundType)
-
-
-	ON_MESSAGE(WM_MSGID(EID_NETWORK_QUALITY), &CLiveBroadcastingDlg::OnEIDNetworkQuality)
-	ON_MESSAGE(WM_MSGID(EID_RTC_STATS), &CLiveBroadcastingDlg::onEIDRtcStats)
-	ON_MESSAGE(WM_MSGID(EID_LOCAL_AUDIO_STATS), &CLiveBroadcastingDlg::onEIDLocalAudioStats)
-	ON_MESSAGE(WM_MSGID(EID_LOCAL_AUDIO_STATE_CHANED), &CLiveBroadcastingDlg::onEIDLocalAudioStateChanged)
-	ON_MESSAGE(WM_MSGID(EID_REMOTE_AUDIO_STATS), &CLiveBroadcastingDlg::onEIDRemoteAudioStats)
-	ON_MESSAGE(WM_MSGID(EID_REMOTE_AUDIO_STATE_CHANGED), &CLiveBroadcastingDlg::onEIDRemoteAudioStateChanged)
-	ON_MESSAGE(WM_MSGID(EID_LOCAL_VIDEO_STATS), &CLiveBroadcastingDlg::onEIDLocalVideoStats)
-	ON_MESSAGE(WM_MSGID(EID_LOCAL_VIDEO_STATE_CHANGED), &CLiveBroadcastingDlg::onEIDLocalVideoStateChanged)
-	ON_MESSAGE(WM_MSGID(EID_REMOTE_VIDEO_STATS), &CLiveBroadcastingDlg::onEIDRemoteVideoStats)
 	ON_BN_CLICKED(IDC_CHECK_REPORT, &CLiveBroadcastingDlg::OnBnClickedCheckReport)
 	ON_CBN_SELCHANGE(IDC_COMBO_COLOR, &CLiveBroadcastingDlg::OnSelchangeComboColor)
 END_MESSAGE_MAP()
@@ -209,6 +185,31 @@ BOOL CLiveBroadcastingDlg::OnInitDialog()
 	m_staLoopVolume.SetWindowText(liveCtrlLoopbackVolume);
 	m_chkEnable.SetWindowText(liveCtrlLoopbackEnable);
 	m_cmbLatency.EnableWindow(FALSE);
+
+	HWND hWnd = m_hWnd;
+	m_eventBus.SetWakeup([hWnd]() { ::PostMessage(hWnd, WM_MSGID(EID_EVENT_BUS), 0, 0); });
+	m_eventBus.Subscribe(EID_JOINCHANNEL_SUCCESS, [this](const AgoraEvent& event) { OnEIDJoinChannelSuccess(event); });
+	m_eventBus.Subscribe(EID_LEAVE_CHANNEL, [this](const AgoraEvent& event) { OnEIDLeaveChannel(event); });
+	m_eventBus.Subscribe(EID_USER_JOINED, [this](const AgoraEvent& event) { OnEIDUserJoined(event); });
+	m_eventBus.Subscribe(EID_USER_OFFLINE, [this](const AgoraEvent& event) { OnEIDUserOffline(event); });
+	m_eventBus.Subscribe(EID_AUDIO_ACTIVE_SPEAKER, [this](const AgoraEvent& event) { OnEIDActiveSpeaker(event); });
+	m_eventBus.Subscribe(EID_NETWORK_QUALITY, [this](const AgoraEvent& event) { OnEIDNetworkQuality(event); });
+	m_eventBus.Subscribe(EID_RTC_STATS, [this](const AgoraEvent& event) { onEIDRtcStats(event); });
+	m_eventBus.Subscribe(EID_LOCAL_AUDIO_STATS, [this](const AgoraEvent& event) { onEIDLocalAudioStats(event); });
+	m_eventBus.Subscribe(EID_LOCAL_AUDIO_STATE_CHANED, [this](const AgoraEvent& event) { onEIDLocalAudioStateChanged(event); });
+	m_eventBus.Subscribe(EID_REMOTE_AUDIO_STATS, [this](const AgoraEvent& event) { onEIDRemoteAudioStats(event); });
+	m_eventBus.Subscribe(EID_REMOTE_AUDIO_STATE_CHANGED, [this](const AgoraEvent& event) { onEIDRemoteAudioStateChanged(event); });
+	m_eventBus.Subscribe(EID_LOCAL_VIDEO_STATS, [this](const AgoraEvent& event) { onEIDLocalVideoStats(event); });
+	m_eventBus.Subscribe(EID_LOCAL_VIDEO_STATE_CHANGED, [this](const AgoraEvent& event) { onEIDLocalVideoStateChanged(event); });
+	m_eventBus.Subscribe(EID_REMOTE_VIDEO_STATS, [this](const AgoraEvent& event) { onEIDRemoteVideoStats(event); });
+	m_eventBus.Subscribe(EID_REMOTE_VIDEO_STATE_CHANED, [this](const AgoraEvent& event) { onEIDRemoteVideoStateChanged(event); });
+	//the report lists the latest statistics of every user.
+	m_eventBus.SetCoalesce(EID_NETWORK_QUALITY, true);
+	m_eventBus.SetCoalesce(EID_RTC_STATS, true);
+	m_eventBus.SetCoalesce(EID_LOCAL_AUDIO_STATS, true);
+	m_eventBus.SetCoalesce(EID_REMOTE_AUDIO_STATS, true);
+	m_eventBus.SetCoalesce(EID_LOCAL_VIDEO_STATS, true);
+	m_eventBus.SetCoalesce(EID_REMOTE_VIDEO_STATS, true);
     return TRUE;
 }
 
@@ -302,32 +303,47 @@ void CLiveBroadcastingDlg::ShowVideoWnds()
 
     for (int i = m_maxVideoCount; i < VIDEO_COUNT; i++) {
         m_videoWnds[i].ShowWindow(0);
-        if (m_videoWnds[i].GetUID() != 0) {
-            VideoCanvas canvas;
-            canvas.uid = m_videoWnds[i].GetUID();
-            canvas.view = m_videoWnds[i].GetSafeHwnd();
-            m_rtcEngine->setupRemoteVideo(canvas);
+    }
+    //users in the hidden views move to free views or wait for one.
+    m_participants.SetViewCount(m_maxVideoCount);
+    ApplyViewChanges();
+}
+
+//bind and unbind remote video for the views the registry reassigned.
+void CLiveBroadcastingDlg::ApplyViewChanges()
+{
+    m_participants.TakeChanges(m_viewChanges);
+    for (auto& change : m_viewChanges) {
+        if (change.oldView != CParticipantRegistry::NO_VIEW && m_videoWnds[change.oldView].GetUID() == change.uid) {
+            m_videoWnds[change.oldView].SetUID(0);
+            m_videoWnds[change.oldView].Invalidate();
         }
+        if (change.newView != CParticipantRegistry::NO_VIEW)
+            m_videoWnds[change.newView].SetUID(change.uid);
+        //the local user is rendered by setupLocalVideo.
+        if (change.pinned || !m_rtcEngine)
+            continue;
+        VideoCanvas canvas;
+        canvas.uid = change.uid;
+        canvas.renderMode = RENDER_MODE_FIT;
+        canvas.view = change.newView != CParticipantRegistry::NO_VIEW ? m_videoWnds[change.newView].GetSafeHwnd() : NULL;
+        //setup remote video in engine to the canvas.
+        m_rtcEngine->setupRemoteVideo(canvas);
     }
 }
 //Initialize the Agora SDK
 bool CLiveBroadcastingDlg::InitAgora()
 {
-    //create Agora RTC engine
-    m_rtcEngine = createAgoraRtcEngine();
-    if (!m_rtcEngine) {
-        m_lstInfo.InsertString(m_lstInfo.GetCount()-1, _T("createAgoraRtcEngine failed"));
-        return false;
-    }
-    //set message notify receiver window
-    m_eventHandler.SetMsgReceiver(m_hWnd);
+    //sdk callbacks go through the event bus.
+    m_eventHandler.SetEventBus(&m_eventBus);
 
     RtcEngineContext context;
 	std::string strAppID = GET_APP_ID;
 	context.appId = strAppID.c_str();
     context.eventHandler = &m_eventHandler;
-    //initialize the Agora RTC engine context.
-    int ret = m_rtcEngine->initialize(context);
+    //borrow the shared engine, this registers our event handler.
+    int ret = m_engineLease.Acquire(context);
+    m_rtcEngine = m_engineLease.GetEngine();
     if (ret != 0) {
         m_initialize = false;
         CString strInfo;
@@ -349,6 +365,8 @@ bool CLiveBroadcastingDlg::InitAgora()
     //set client role in the engine to the CLIENT_ROLE_BROADCASTER.
     m_rtcEngine->setClientRole(CLIENT_ROLE_BROADCASTER);
     m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("setClientRole broadcaster"));
+    //active speaker reports decide who gets a view when there are more users than views.
+    m_rtcEngine->enableAudioVolumeIndication(1000, 3, false);
 
 	m_audioDeviceManager = new AAudioDeviceManager(m_rtcEngine);
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("cereate audio device manager"));
@@ -389,10 +407,12 @@ void CLiveBroadcastingDlg::UnInitAgora()
         //disable video in the engine.
         m_rtcEngine->disableVideo();
         m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("disableVideo"));
-        //release engine.
-        m_rtcEngine->release(true);
+        //give the engine back to the host.
+        m_engineLease.Release();
         m_lstInfo.InsertString(m_lstInfo.GetCount(), _T("release rtc engine"));
         m_rtcEngine = NULL;
+        //drop callbacks that arrived after the scene was left.
+        m_eventBus.Clear();
     }
 }
 
@@ -497,25 +517,33 @@ void CLiveBroadcastingDlg::OnShowWindow(BOOL bShow, UINT nStatus)
 	}
 }
 
-LRESULT CLiveBroadcastingDlg::OnEIDJoinChannelSuccess(WPARAM wParam, LPARAM lParam)
+//wakeup message from the event bus.
+LRESULT CLiveBroadcastingDlg::OnEIDEventBus(WPARAM wParam, LPARAM lParam)
+{
+    m_eventBus.Dispatch();
+    return 0;
+}
+
+void CLiveBroadcastingDlg::OnEIDJoinChannelSuccess(const AgoraEvent& event)
 {
     m_btnJoinChannel.EnableWindow(TRUE);
 	m_joinChannel = true;
     m_btnJoinChannel.SetWindowText(commonCtrlLeaveChannel);
 
     CString strInfo;
-    strInfo.Format(_T("%s:join success, uid=%u"), getCurrentTime(), wParam);
+    strInfo.Format(_T("%s:join success, uid=%u"), getCurrentTime(), event.uid);
     m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
 
-    m_videoWnds[0].SetUID(wParam);
-    m_lstUids.push_back(wParam);
+    //the local user is pinned to the first view.
+    m_participants.Clear();
+    m_participants.AddUser(event.uid, true);
+    ApplyViewChanges();
 
     //notify parent window
     ::PostMessage(GetParent()->GetSafeHwnd(), WM_MSGID(EID_JOINCHANNEL_SUCCESS), TRUE, 0);
-    return 0;
 }
 
-LRESULT CLiveBroadcastingDlg::OnEIDLeaveChannel(WPARAM wParam, LPARAM lParam)
+void CLiveBroadcastingDlg::OnEIDLeaveChannel(const AgoraEvent& event)
 {
     m_btnJoinChannel.EnableWindow(TRUE);
 	m_joinChannel = false;
@@ -524,67 +552,43 @@ LRESULT CLiveBroadcastingDlg::OnEIDLeaveChannel(WPARAM wParam, LPARAM lParam)
     CString strInfo;
     strInfo.Format(_T("leave channel success %s"), getCurrentTime());
     m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
-    m_lstUids.clear();
+    m_participants.Clear();
     for (int i = 0; i < m_maxVideoCount; i++) {
         m_videoWnds[i].SetUID(0);
     }
 
     //notify parent window
     ::PostMessage(GetParent()->GetSafeHwnd(), WM_MSGID(EID_JOINCHANNEL_SUCCESS), FALSE, 0);
-    return 0;
 }
 
-LRESULT CLiveBroadcastingDlg::OnEIDUserJoined(WPARAM wParam, LPARAM lParam)
+void CLiveBroadcastingDlg::OnEIDUserJoined(const AgoraEvent& event)
 {
-    if (m_lstUids.size() == m_maxVideoCount)
-        return 0;
     CString strInfo;
-    strInfo.Format(_T("%u joined"), wParam);
+    strInfo.Format(_T("%u joined"), event.uid);
     m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
 
-    m_lstUids.push_back(wParam);
-    for (int i = 0; i < m_maxVideoCount; i++) {
-        if (m_videoWnds[i].GetUID() == 0) {
-            VideoCanvas canvas;
-            canvas.uid  = wParam;
-            canvas.view = m_videoWnds[i].GetSafeHwnd();
-            canvas.renderMode = RENDER_MODE_FIT;
-			m_videoWnds[i].SetUID(wParam);
-            //setup remote video in engine to the canvas.
-            m_rtcEngine->setupRemoteVideo(canvas);
-            break;
-        }
-    }
-    return 0;
+    //users beyond the visible views are tracked and shown once a view frees up.
+    m_participants.AddUser(event.uid);
+    ApplyViewChanges();
 }
 
-LRESULT CLiveBroadcastingDlg::OnEIDUserOffline(WPARAM wParam, LPARAM lParam)
+void CLiveBroadcastingDlg::OnEIDUserOffline(const AgoraEvent& event)
 {
-    uid_t remoteUid = (uid_t)wParam;
-    VideoCanvas canvas;
-    canvas.uid = remoteUid;
-    canvas.view = NULL;
-    m_rtcEngine->setupRemoteVideo(canvas);
+    uid_t remoteUid = event.uid;
     CString strInfo;
-    strInfo.Format(_T("%u offline, reason:%d"), remoteUid, lParam);
+    strInfo.Format(_T("%u offline, reason:%d"), remoteUid, event.data.params[0]);
     m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
 
-    for (int i = 0; i < m_maxVideoCount; i++){
-        if (m_videoWnds[i].GetUID() == remoteUid) {
-            m_videoWnds[i].SetUID(0);
-            m_videoWnds[i].Invalidate();
-            break;
-        }
-    }
+    //unbinds the user and gives its view to the next hidden user.
+    m_participants.RemoveUser(remoteUid);
+    ApplyViewChanges();
+}
 
-    for (auto iter = m_lstUids.begin();
-        iter != m_lstUids.end(); iter++){
-        if (*iter == remoteUid) {
-            m_lstUids.erase(iter);
-            break;
-        }
-    }
-    return 0;
+void CLiveBroadcastingDlg::OnEIDActiveSpeaker(const AgoraEvent& event)
+{
+    //a hidden speaker takes the view of the user that spoke least recently.
+    m_participants.OnActiveSpeaker(event.uid);
+    ApplyViewChanges();
 }
 
 LRESULT CLiveBroadcastingDlg::OnEIDAudioDeviceStateChanged(const char* deviceId, int deviceType, int deviceState)
@@ -839,25 +843,18 @@ void CLiveBroadcastingDlg::OnSelchangeComboBackgroundType()
 	SetVideoSource();
 }
 
-LRESULT CLiveBroadcastingDlg::OnEIDNetworkQuality(WPARAM wParam, LPARAM lParam) {
-	PNetworkQuality quality = (PNetworkQuality)wParam;
+void CLiveBroadcastingDlg::OnEIDNetworkQuality(const AgoraEvent& event) {
 	CString strInfo = _T("===onNetworkQuality===");
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
-	strInfo.Format(_T("uid:%u"), quality->uid);
+	strInfo.Format(_T("uid:%u"), event.uid);
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
-	strInfo.Format(_T("txQuality:%d"), quality->txQuality);
+	strInfo.Format(_T("txQuality:%d"), event.data.params[0]);
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
-	strInfo.Format(_T("rxQuality:%u"), quality->rxQuality);
+	strInfo.Format(_T("rxQuality:%u"), event.data.params[1]);
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
-
-	if (quality) {
-		delete quality;
-		quality = nullptr;
-	}
-	return 0;
 }
-LRESULT CLiveBroadcastingDlg::onEIDRtcStats(WPARAM wParam, LPARAM lParam) {
-	RtcStats* stats = (RtcStats*)wParam;
+void CLiveBroadcastingDlg::onEIDRtcStats(const AgoraEvent& event) {
+	const RtcStats* stats = &event.data.rtcStats;
 	CString strInfo = _T("===onRtcStats===");
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
 	strInfo.Format(_T("duration:%u"), stats->duration);
@@ -918,16 +915,10 @@ LRESULT CLiveBroadcastingDlg::onEIDRtcStats(WPARAM wParam, LPARAM lParam) {
 	strInfo.Format(_T("rxPacketLossRate:%u"), stats->rxPacketLossRate);
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
 
-
-	if (stats) {
-		delete stats;
-		stats = nullptr;
-	}
-	return 0;
 }
 
-LRESULT CLiveBroadcastingDlg::onEIDLocalAudioStats(WPARAM wParam, LPARAM lParam) {
-	LocalAudioStats* stats = (LocalAudioStats*)wParam;
+void CLiveBroadcastingDlg::onEIDLocalAudioStats(const AgoraEvent& event) {
+	const LocalAudioStats* stats = &event.data.localAudioStats;
 	CString strInfo = _T("===onLocalAudioStats===");
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
 
@@ -941,17 +932,11 @@ LRESULT CLiveBroadcastingDlg::onEIDLocalAudioStats(WPARAM wParam, LPARAM lParam)
 	strInfo.Format(_T("txPacketLossRate:%u"), stats->txPacketLossRate);
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
 
-
-	if (stats) {
-		delete stats;
-		stats = nullptr;
-	}
-	return 0;
 }
 
-LRESULT CLiveBroadcastingDlg::onEIDLocalAudioStateChanged(WPARAM wParam, LPARAM lParam) {
-	LOCAL_AUDIO_STREAM_STATE state = (LOCAL_AUDIO_STREAM_STATE)wParam;
-	LOCAL_AUDIO_STREAM_ERROR error = (LOCAL_AUDIO_STREAM_ERROR)lParam;
+void CLiveBroadcastingDlg::onEIDLocalAudioStateChanged(const AgoraEvent& event) {
+	LOCAL_AUDIO_STREAM_STATE state = (LOCAL_AUDIO_STREAM_STATE)event.data.params[0];
+	LOCAL_AUDIO_STREAM_ERROR error = (LOCAL_AUDIO_STREAM_ERROR)event.data.params[1];
 	CString strInfo = _T("===onLocalAudioStateChanged===");
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
 
@@ -959,10 +944,9 @@ LRESULT CLiveBroadcastingDlg::onEIDLocalAudioStateChanged(WPARAM wParam, LPARAM
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
 	strInfo.Format(_T("error:%d"), error);
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
-	return 0;
 }
-LRESULT CLiveBroadcastingDlg::onEIDRemoteAudioStats(WPARAM wParam, LPARAM lParam) {
-	RemoteAudioStats* stats = (RemoteAudioStats*)wParam;
+void CLiveBroadcastingDlg::onEIDRemoteAudioStats(const AgoraEvent& event) {
+	const RemoteAudioStats* stats = &event.data.remoteAudioStats;
 	CString strInfo = _T("===onRemoteAudioStats===");
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
 
@@ -995,30 +979,22 @@ LRESULT CLiveBroadcastingDlg::onEIDRemoteAudioStats(WPARAM wParam, LPARAM lParam
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
 
 	strInfo.Format(_T("publishDuration:%d"), stats->publishDuration);
-	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
-	if (stats) {
-		delete stats;
-		stats = nullptr;
-	}
-	return 0;
-}
-LRESULT CLiveBroadcastingDlg::onEIDRemoteAudioStateChanged(WPARAM wParam, LPARAM lParam) {
+	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);}
+void CLiveBroadcastingDlg::onEIDRemoteAudioStateChanged(const AgoraEvent& event) {
 	CString strInfo = _T("===onRemoteAudioStateChanged===");
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
-	PRemoteAudioState state = (PRemoteAudioState)wParam;
 
-	strInfo.Format(_T("elapsed:%d"), state->elapsed);
+	strInfo.Format(_T("elapsed:%d"), event.data.params[2]);
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
-	strInfo.Format(_T("uid:%u"), state->uid);
+	strInfo.Format(_T("uid:%u"), event.uid);
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
-	strInfo.Format(_T("state:%d"), state->state);
+	strInfo.Format(_T("state:%d"), event.data.params[0]);
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
-	strInfo.Format(_T("reason:%d"), state->reason);
+	strInfo.Format(_T("reason:%d"), event.data.params[1]);
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
-	return 0;
 }
-LRESULT CLiveBroadcastingDlg::onEIDLocalVideoStats(WPARAM wParam, LPARAM lParam) {
-	LocalVideoStats* stats = (LocalVideoStats*)wParam;
+void CLiveBroadcastingDlg::onEIDLocalVideoStats(const AgoraEvent& event) {
+	const LocalVideoStats* stats = &event.data.localVideoStats;
 	CString strInfo = _T("===onLocalVideoStats===");
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
 
@@ -1049,17 +1025,11 @@ LRESULT CLiveBroadcastingDlg::onEIDLocalVideoStats(WPARAM wParam, LPARAM lParam)
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
 	strInfo.Format(_T("codecType:%d"), stats->codecType);
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
-
-	if (stats) {
-		delete stats;
-		stats = nullptr;
-	}
-	return 0;
 }
-LRESULT CLiveBroadcastingDlg::onEIDLocalVideoStateChanged(WPARAM wParam, LPARAM lParam) {
+void CLiveBroadcastingDlg::onEIDLocalVideoStateChanged(const AgoraEvent& event) {
 
-	LOCAL_VIDEO_STREAM_STATE state = (LOCAL_VIDEO_STREAM_STATE)wParam;
-	LOCAL_VIDEO_STREAM_ERROR error = (LOCAL_VIDEO_STREAM_ERROR)lParam;
+	LOCAL_VIDEO_STREAM_STATE state = (LOCAL_VIDEO_STREAM_STATE)event.data.params[0];
+	LOCAL_VIDEO_STREAM_ERROR error = (LOCAL_VIDEO_STREAM_ERROR)event.data.params[1];
 	CString strInfo = _T("===onLocalVideoStateChanged===");
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
 
@@ -1067,10 +1037,9 @@ LRESULT CLiveBroadcastingDlg::onEIDLocalVideoStateChanged(WPARAM wParam, LPARAM
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
 	strInfo.Format(_T("error:%d"), error);
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
-	return 0;
 }
-LRESULT CLiveBroadcastingDlg::onEIDRemoteVideoStats(WPARAM wParam, LPARAM lParam) {
-	RemoteVideoStats* stats = (RemoteVideoStats*)wParam;
+void CLiveBroadcastingDlg::onEIDRemoteVideoStats(const AgoraEvent& event) {
+	const RemoteVideoStats* stats = &event.data.remoteVideoStats;
 	CString strInfo = _T("===onRemoteVideoStats===");
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
 
@@ -1106,27 +1075,19 @@ LRESULT CLiveBroadcastingDlg::onEIDRemoteVideoStats(WPARAM wParam, LPARAM lParam
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
 	strInfo.Format(_T("publishDuration:%d"), stats->publishDuration);
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
-
-	if (stats) {
-		delete stats;
-		stats = nullptr;
-	}
-	return 0;
 }
-LRESULT CLiveBroadcastingDlg::onEIDRemoteVideoStateChanged(WPARAM wParam, LPARAM lParam) {
+void CLiveBroadcastingDlg::onEIDRemoteVideoStateChanged(const AgoraEvent& event) {
 	CString strInfo = _T("===onRemoteVideoStateChanged===");
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
-	PRemoteVideoState state = (PRemoteVideoState)wParam;
 
-	strInfo.Format(_T("elapsed:%d"), state->elapsed);
+	strInfo.Format(_T("elapsed:%d"), event.data.params[2]);
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
-	strInfo.Format(_T("uid:%u"), state->uid);
+	strInfo.Format(_T("uid:%u"), event.uid);
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
-	strInfo.Format(_T("state:%d"), state->state);
+	strInfo.Format(_T("state:%d"), event.data.params[0]);
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
-	strInfo.Format(_T("reason:%d"), state->reason);
+	strInfo.Format(_T("reason:%d"), event.data.params[1]);
 	m_lstInfo.InsertString(m_lstInfo.GetCount(), strInfo);
-	return 0;
 }
 
 void CLiveBroadcastingDlg::OnBnClickedCheckReport()
@@ -1,6 +1,6 @@
 #pragma once
 #include "AGVideoWnd.h"
-#include <list>
+#include "ParticipantRegistry.h"
 // CLiveBroadcastingDlg dialog
 
 #define VIDEO_COUNT                     36
@@ -10,8 +10,8 @@ class CLiveBroadcastingRtcEngineEventHandler
     : public IRtcEngineEventHandler
 {
 public:
-    //set the message notify window handler
-    void SetMsgReceiver(HWND hWnd) { m_hMsgHanlder = hWnd; }
+    //sdk callbacks are posted to this event bus.
+    void SetEventBus(CAgoraEventBus* eventBus) { m_eventBus = eventBus; }
     /*
     note:
         Join the channel callback.This callback method indicates that the client 
@@ -71,100 +71,95 @@ public:
 	virtual void onAudioDeviceStateChanged(const char* deviceId, int deviceType, int deviceState) override;
 
 	virtual void onNetworkQuality(uid_t uid, int txQuality, int rxQuality) override {
-		if (m_hMsgHanlder&& report) {
-			PNetworkQuality quality = new NetworkQuality;
-			quality->uid = uid;
-			quality->txQuality = txQuality;
-			quality->txQuality = rxQuality;
-
-			::PostMessage(m_hMsgHanlder, WM_MSGID(EID_NETWORK_QUALITY), (WPARAM)quality, 0);
-
-		}
+		if (report)
+			PostEvent(EID_NETWORK_QUALITY, uid, txQuality, rxQuality);
 	}
 	virtual void onRtcStats(const RtcStats& stats) override {
-		if (m_hMsgHanlder&& report) {
-			RtcStats* s = new RtcStats;
-			*s = stats;
-
-			::PostMessage(m_hMsgHanlder, WM_MSGID(EID_RTC_STATS), (WPARAM)s, 0);
-
+		if (m_eventBus && report) {
+			AgoraEvent event;
+			event.type = EID_RTC_STATS;
+			event.data.rtcStats = stats;
+			m_eventBus->Post(event);
 		}
 	}
 
 
 	virtual void onLocalAudioStats(const LocalAudioStats& stats) override {
-		if (m_hMsgHanlder&& report) {
-			LocalAudioStats* s = new LocalAudioStats;
-			*s = stats;
-			::PostMessage(m_hMsgHanlder, WM_MSGID(EID_LOCAL_AUDIO_STATS), (WPARAM)s, 0);
-
+		if (m_eventBus && report) {
+			AgoraEvent event;
+			event.type = EID_LOCAL_AUDIO_STATS;
+			event.data.localAudioStats = stats;
+			m_eventBus->Post(event);
 		}
 	}
 
 	virtual void onLocalAudioStateChanged(LOCAL_AUDIO_STREAM_STATE state, LOCAL_AUDIO_STREAM_ERROR error) {
-		if (m_hMsgHanlder&& report) {
-			::PostMessage(m_hMsgHanlder, WM_MSGID(EID_LOCAL_AUDIO_STATE_CHANED), (WPARAM)state, (LPARAM)error);
-		}
+		if (report)
+			PostEvent(EID_LOCAL_AUDIO_STATE_CHANED, 0, state, error);
 	}
 
 	virtual void onRemoteAudioStats(const RemoteAudioStats& stats) {
-		if (m_hMsgHanlder&& report) {
-			RemoteAudioStats* s = new RemoteAudioStats;
-			*s = stats;
-			::PostMessage(m_hMsgHanlder, WM_MSGID(EID_REMOTE_AUDIO_STATS), (WPARAM)s, 0);
-
+		if (m_eventBus && report) {
+			AgoraEvent event;
+			event.type = EID_REMOTE_AUDIO_STATS;
+			event.uid = stats.uid;
+			event.data.remoteAudioStats = stats;
+			m_eventBus->Post(event);
 		}
 	}
 
 	virtual void onRemoteAudioStateChanged(uid_t uid, REMOTE_AUDIO_STATE state, REMOTE_AUDIO_STATE_REASON reason, int elapsed) {
-		if (m_hMsgHanlder&& report) {
-			PRemoteAudioState s = new RemoteAudioState;
-			s->elapsed = elapsed;
-			s->uid = uid;
-			s->state = state;
-			s->reason = reason;
-			::PostMessage(m_hMsgHanlder, WM_MSGID(EID_REMOTE_AUDIO_STATE_CHANGED), (WPARAM)s, 0);
-
-		}
+		if (report)
+			PostEvent(EID_REMOTE_AUDIO_STATE_CHANGED, uid, state, reason, elapsed);
 	}
 	virtual void onLocalVideoStats(const LocalVideoStats& stats) {
-		if (m_hMsgHanlder&& report) {
-			LocalVideoStats* s = new LocalVideoStats;
-			*s = stats;
-			::PostMessage(m_hMsgHanlder, WM_MSGID(EID_LOCAL_VIDEO_STATS), (WPARAM)s, 0);
-
+		if (m_eventBus && report) {
+			AgoraEvent event;
+			event.type = EID_LOCAL_VIDEO_STATS;
+			event.data.localVideoStats = stats;
+			m_eventBus->Post(event);
 		}
 	}
 
 	virtual void onLocalVideoStateChanged(LOCAL_VIDEO_STREAM_STATE state, LOCAL_VIDEO_STREAM_ERROR error) {
-		if (m_hMsgHanlder&& report) {
-			::PostMessage(m_hMsgHanlder, WM_MSGID(EID_LOCAL_VIDEO_STATE_CHANGED), (WPARAM)state, (LPARAM)error);
-		}
+		if (report)
+			PostEvent(EID_LOCAL_VIDEO_STATE_CHANGED, 0, state, error);
 	}
 	virtual void onRemoteVideoStats(const RemoteVideoStats& stats) {
-		if (m_hMsgHanlder&& report) {
-			RemoteVideoStats* s = new RemoteVideoStats;
-			*s = stats;
-			::PostMessage(m_hMsgHanlder, WM_MSGID(EID_REMOTE_VIDEO_STATS), (WPARAM)s, 0);
-
+		if (m_eventBus && report) {
+			AgoraEvent event;
+			event.type = EID_REMOTE_VIDEO_STATS;
+			event.uid = stats.uid;
+			event.data.remoteVideoStats = stats;
+			m_eventBus->Post(event);
 		}
 	}
 
 	virtual void onRemoteVideoStateChanged(uid_t uid, REMOTE_VIDEO_STATE state, REMOTE_VIDEO_STATE_REASON reason, int elapsed) {
-		if (m_hMsgHanlder&& report) {
-			PRemoteVideoState s = new RemoteVideoState;
-			s->elapsed = elapsed;
-			s->uid = uid;
-			s->state = state;
-			s->reason = reason;
-			::PostMessage(m_hMsgHanlder, WM_MSGID(EID_REMOTE_VIDEO_STATE_CHANED), (WPARAM)s, 0);
-
-		}
+		if (report)
+			PostEvent(EID_REMOTE_VIDEO_STATE_CHANED, uid, state, reason, elapsed);
+	}
+	virtual void onActiveSpeaker(uid_t uid) override {
+		PostEvent(EID_AUDIO_ACTIVE_SPEAKER, uid, 0);
 	}
 	void SetReport(bool b) { report = b; }
+
+	void PostEvent(int type, uid_t uid, int param0, int param1 = 0, int param2 = 0)
+	{
+		if (!m_eventBus)
+			return;
+		AgoraEvent event;
+		event.type = type;
+		event.uid = uid;
+		event.data.params[0] = param0;
+		event.data.params[1] = param1;
+		event.data.params[2] = param2;
+		m_eventBus->Post(event);
+	}
 private:
-    HWND m_hMsgHanlder;
-	bool report = false;
+	CAgoraEventBus* m_eventBus = nullptr;
+	//written on the UI thread, read on SDK threads.
+	std::atomic<bool> report{ false };
 };
 
 class CLiveBroadcastingDlg : public CDialogEx
@@ -200,22 +195,25 @@ public:
     afx_msg void OnSelchangeComboPersons();
     afx_msg void OnSelchangeComboRole();
     afx_msg void OnShowWindow(BOOL bShow, UINT nStatus);
+    //wakeup message of the event bus.
+    afx_msg LRESULT OnEIDEventBus(WPARAM wParam, LPARAM lParam);
     //Agora Event handler
-    afx_msg LRESULT OnEIDJoinChannelSuccess(WPARAM wParam, LPARAM lParam);
-    afx_msg LRESULT OnEIDLeaveChannel(WPARAM wParam, LPARAM lParam);
-    afx_msg LRESULT OnEIDUserJoined(WPARAM wParam, LPARAM lParam);
-    afx_msg LRESULT OnEIDUserOffline(WPARAM wParam, LPARAM lParam);
+    void OnEIDJoinChannelSuccess(const AgoraEvent& event);
+    void OnEIDLeaveChannel(const AgoraEvent& event);
+    void OnEIDUserJoined(const AgoraEvent& event);
+    void OnEIDUserOffline(const AgoraEvent& event);
+    void OnEIDActiveSpeaker(const AgoraEvent& event);
 	afx_msg LRESULT OnEIDAudioDeviceStateChanged(const char* deviceId, int deviceType, int deviceState);
-	afx_msg LRESULT OnEIDNetworkQuality(WPARAM wParam, LPARAM lParam);
-	afx_msg LRESULT onEIDRtcStats(WPARAM wParam, LPARAM lParam);
-	afx_msg LRESULT onEIDLocalAudioStats(WPARAM wParam, LPARAM lParam);
-	afx_msg LRESULT onEIDLocalAudioStateChanged(WPARAM wParam, LPARAM lParam);
-	afx_msg LRESULT onEIDRemoteAudioStats(WPARAM wParam, LPARAM lParam);
-	afx_msg LRESULT onEIDRemoteAudioStateChanged(WPARAM wParam, LPARAM lParam);
-	afx_msg LRESULT onEIDLocalVideoStats(WPARAM wParam, LPARAM lParam);
-	afx_msg LRESULT onEIDLocalVideoStateChanged(WPARAM wParam, LPARAM lParam);
-	afx_msg LRESULT onEIDRemoteVideoStats(WPARAM wParam, LPARAM lParam);
-	afx_msg LRESULT onEIDRemoteVideoStateChanged(WPARAM wParam, LPARAM lParam);
+	void OnEIDNetworkQuality(const AgoraEvent& event);
+	void onEIDRtcStats(const AgoraEvent& event);
+	void onEIDLocalAudioStats(const AgoraEvent& event);
+	void onEIDLocalAudioStateChanged(const AgoraEvent& event);
+	void onEIDRemoteAudioStats(const AgoraEvent& event);
+	void onEIDRemoteAudioStateChanged(const AgoraEvent& event);
+	void onEIDLocalVideoStats(const AgoraEvent& event);
+	void onEIDLocalVideoStateChanged(const AgoraEvent& event);
+	void onEIDRemoteVideoStats(const AgoraEvent& event);
+	void onEIDRemoteVideoStateChanged(const AgoraEvent& event);
 private:
     //set control text from config.
     void InitCtrlText();
@@ -225,16 +223,22 @@ private:
     void ShowVideoWnds();
     //render local video from SDK local capture.
     void RenderLocalVideo();
+    //bind and unbind remote video for the views the registry reassigned.
+    void ApplyViewChanges();
 
 
     IRtcEngine* m_rtcEngine = nullptr;
+    CAgoraEngineLease m_engineLease;
     CLiveBroadcastingRtcEngineEventHandler m_eventHandler;
+    CAgoraEventBus m_eventBus;
     bool m_joinChannel = false;
     bool m_initialize = false;
     //video wnd
     CAGVideoWnd m_videoWnds[VIDEO_COUNT];
     int m_maxVideoCount = 4;
-    std::list<uid_t> m_lstUids;
+    //all users in the channel, m_maxVideoCount of them visible.
+    CParticipantRegistry m_participants;
+    std::vector<CParticipantRegistry::ViewChange> m_viewChanges;
 	AAudioDeviceManager *m_audioDeviceManager = nullptr;
 	IAudioDeviceCollection* m_playbackDevices = nullptr;
 public:
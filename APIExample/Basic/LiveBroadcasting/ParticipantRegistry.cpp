@@ -0,0 +1,327 @@
+#include "ParticipantRegistry.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+//no stdafx.h, the registry is tested on its own.
+
+namespace {
+	int LowestBit(uint64_t bits)
+	{
+#if defined(_MSC_VER) && defined(_WIN64)
+		unsigned long index = 0;
+		_BitScanForward64(&index, bits);
+		return (int)index;
+#elif defined(_MSC_VER)
+		//no 64 bit scan on x86.
+		unsigned long index = 0;
+		if (_BitScanForward(&index, (unsigned long)bits))
+			return (int)index;
+		_BitScanForward(&index, (unsigned long)(bits >> 32));
+		return (int)index + 32;
+#else
+		return __builtin_ctzll(bits);
+#endif
+	}
+}
+
+CParticipantRegistry::CParticipantRegistry()
+{
+	m_buckets.assign(64, -1);
+	for (int i = 0; i < MAX_VIEWS; ++i)
+		m_viewRecord[i] = -1;
+}
+
+CParticipantRegistry::~CParticipantRegistry()
+{
+}
+
+uint32_t CParticipantRegistry::Hash(unsigned int uid)
+{
+	//uids are often small sequential numbers, spread them over the table.
+	uint32_t h = uid;
+	h ^= h >> 16;
+	h *= 0x7feb352d;
+	h ^= h >> 15;
+	h *= 0x846ca68b;
+	h ^= h >> 16;
+	return h;
+}
+
+int CParticipantRegistry::Find(unsigned int uid) const
+{
+	size_t mask = m_buckets.size() - 1;
+	for (size_t i = Hash(uid) & mask;; i = (i + 1) & mask) {
+		int record = m_buckets[i];
+		if (record < 0)
+			return -1;
+		if (m_records[record].uid == uid)
+			return record;
+	}
+}
+
+void CParticipantRegistry::Insert(int record)
+{
+	size_t mask = m_buckets.size() - 1;
+	size_t i = Hash(m_records[record].uid) & mask;
+	while (m_buckets[i] >= 0)
+		i = (i + 1) & mask;
+	m_buckets[i] = record;
+}
+
+//linear probing delete with backward shift, so no tombstones pile up under churn.
+void CParticipantRegistry::Erase(unsigned int uid)
+{
+	size_t mask = m_buckets.size() - 1;
+	size_t i = Hash(uid) & mask;
+	while (m_buckets[i] >= 0 && m_records[m_buckets[i]].uid != uid)
+		i = (i + 1) & mask;
+	if (m_buckets[i] < 0)
+		return;
+	size_t hole = i;
+	for (size_t j = (hole + 1) & mask; m_buckets[j] >= 0; j = (j + 1) & mask) {
+		size_t home = Hash(m_records[m_buckets[j]].uid) & mask;
+		//move j into the hole unless its home lies cyclically in (hole, j].
+		bool between = hole <= j ? (hole < home && home <= j) : (hole < home || home <= j);
+		if (!between) {
+			m_buckets[hole] = m_buckets[j];
+			hole = j;
+		}
+	}
+	m_buckets[hole] = -1;
+}
+
+void CParticipantRegistry::Grow()
+{
+	m_buckets.assign(m_buckets.size() * 2, -1);
+	for (size_t record = 0; record < m_records.size(); ++record) {
+		if (m_records[record].uid != 0)
+			Insert((int)record);
+	}
+}
+
+void CParticipantRegistry::PushFront(List& list, int record)
+{
+	Participant& p = m_records[record];
+	p.prev = -1;
+	p.next = list.head;
+	if (list.head >= 0)
+		m_records[list.head].prev = record;
+	else
+		list.tail = record;
+	list.head = record;
+}
+
+void CParticipantRegistry::PushBack(List& list, int record)
+{
+	Participant& p = m_records[record];
+	p.next = -1;
+	p.prev = list.tail;
+	if (list.tail >= 0)
+		m_records[list.tail].next = record;
+	else
+		list.head = record;
+	list.tail = record;
+}
+
+void CParticipantRegistry::Unlink(List& list, int record)
+{
+	Participant& p = m_records[record];
+	if (p.prev >= 0)
+		m_records[p.prev].next = p.next;
+	else
+		list.head = p.next;
+	if (p.next >= 0)
+		m_records[p.next].prev = p.prev;
+	else
+		list.tail = p.prev;
+	p.prev = p.next = -1;
+}
+
+int CParticipantRegistry::AllocView()
+{
+	return m_freeViews ? LowestBit(m_freeViews) : NO_VIEW;
+}
+
+void CParticipantRegistry::AssignView(int record, int view)
+{
+	Participant& p = m_records[record];
+	ViewChange change = { p.uid, p.view, view, p.pinned };
+	m_changes.push_back(change);
+	p.view = view;
+	m_viewRecord[view] = record;
+	m_freeViews &= ~(1ULL << view);
+}
+
+void CParticipantRegistry::ReleaseView(int record)
+{
+	Participant& p = m_records[record];
+	if (p.view == NO_VIEW)
+		return;
+	ViewChange change = { p.uid, p.view, NO_VIEW, p.pinned };
+	m_changes.push_back(change);
+	m_viewRecord[p.view] = -1;
+	if (p.view < m_viewCount)
+		m_freeViews |= 1ULL << p.view;
+	p.view = NO_VIEW;
+}
+
+//hand free views to hidden users, best candidate first.
+void CParticipantRegistry::FillFreeViews()
+{
+	while (m_freeViews && m_hidden.head >= 0) {
+		int record = m_hidden.head;
+		Unlink(m_hidden, record);
+		AssignView(record, AllocView());
+		if (!m_records[record].pinned)
+			PushFront(m_visible, record);
+	}
+}
+
+void CParticipantRegistry::SetViewCount(int count)
+{
+	if (count < 0)
+		count = 0;
+	if (count > MAX_VIEWS)
+		count = MAX_VIEWS;
+	//users in views that go away become the first to get a view back.
+	for (int view = m_viewCount - 1; view >= count; --view) {
+		int record = m_viewRecord[view];
+		if (record < 0)
+			continue;
+		if (!m_records[record].pinned)
+			Unlink(m_visible, record);
+		ReleaseView(record);
+		PushFront(m_hidden, record);
+	}
+	m_viewCount = count;
+	m_freeViews = 0;
+	for (int view = 0; view < count; ++view) {
+		if (m_viewRecord[view] < 0)
+			m_freeViews |= 1ULL << view;
+	}
+	FillFreeViews();
+}
+
+bool CParticipantRegistry::AddUser(unsigned int uid, bool pinned)
+{
+	if (uid == 0 || Find(uid) >= 0)
+		return false;
+	int record = m_freeRecord;
+	if (record >= 0) {
+		m_freeRecord = m_records[record].nextFree;
+		m_records[record] = Participant();
+	}
+	else {
+		record = (int)m_records.size();
+		m_records.push_back(Participant());
+	}
+	m_records[record].uid = uid;
+	m_records[record].pinned = pinned;
+	++m_userCount;
+	//keep the load factor at or below one half.
+	if ((size_t)m_userCount * 2 > m_buckets.size())
+		Grow();
+	else
+		Insert(record);
+
+	if (pinned)
+		PushFront(m_hidden, record);
+	else
+		PushBack(m_hidden, record);
+	FillFreeViews();
+	return true;
+}
+
+bool CParticipantRegistry::RemoveUser(unsigned int uid)
+{
+	int record = Find(uid);
+	if (record < 0)
+		return false;
+	Participant& p = m_records[record];
+	if (p.view != NO_VIEW) {
+		if (!p.pinned)
+			Unlink(m_visible, record);
+		ReleaseView(record);
+	}
+	else {
+		Unlink(m_hidden, record);
+	}
+	Erase(uid);
+	p.uid = 0;
+	p.nextFree = m_freeRecord;
+	m_freeRecord = record;
+	--m_userCount;
+	FillFreeViews();
+	return true;
+}
+
+void CParticipantRegistry::OnActiveSpeaker(unsigned int uid)
+{
+	int record = Find(uid);
+	if (record < 0 || m_records[record].pinned)
+		return;
+	if (m_records[record].view != NO_VIEW) {
+		Unlink(m_visible, record);
+		PushFront(m_visible, record);
+		return;
+	}
+	//take the view of the visible user that spoke least recently.
+	int view = AllocView();
+	if (view == NO_VIEW) {
+		int evicted = m_visible.tail;
+		if (evicted < 0)
+			return;
+		view = m_records[evicted].view;
+		Unlink(m_visible, evicted);
+		ReleaseView(evicted);
+		PushFront(m_hidden, evicted);
+	}
+	Unlink(m_hidden, record);
+	AssignView(record, view);
+	PushFront(m_visible, record);
+}
+
+void CParticipantRegistry::Clear()
+{
+	m_records.clear();
+	m_freeRecord = -1;
+	m_userCount = 0;
+	m_buckets.assign(64, -1);
+	m_visible = List();
+	m_hidden = List();
+	for (int i = 0; i < MAX_VIEWS; ++i)
+		m_viewRecord[i] = -1;
+	m_freeViews = 0;
+	for (int view = 0; view < m_viewCount; ++view)
+		m_freeViews |= 1ULL << view;
+	m_changes.clear();
+}
+
+int CParticipantRegistry::GetView(unsigned int uid) const
+{
+	int record = Find(uid);
+	return record < 0 ? NO_VIEW : m_records[record].view;
+}
+
+unsigned int CParticipantRegistry::GetViewUid(int view) const
+{
+	if (view < 0 || view >= MAX_VIEWS || m_viewRecord[view] < 0)
+		return 0;
+	return m_records[m_viewRecord[view]].uid;
+}
+
+int CParticipantRegistry::GetVisibleCount() const
+{
+	int count = 0;
+	for (int view = 0; view < m_viewCount; ++view) {
+		if (m_viewRecord[view] >= 0)
+			++count;
+	}
+	return count;
+}
+
+void CParticipantRegistry::TakeChanges(std::vector<ViewChange>& changes)
+{
+	changes.clear();
+	changes.swap(m_changes);
+}
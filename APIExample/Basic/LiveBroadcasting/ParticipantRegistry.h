@@ -0,0 +1,105 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/*
+	Tracks every user in the channel and which of the N video views each
+	one is shown in. Any number of users can be tracked, only N are
+	visible at a time:
+	- uid lookup is an open-addressing hash table into a record array;
+	- free views are a bitmap, the lowest free view is one bit scan away;
+	- visible users are kept in least-recently-spoken order and hidden
+	  users in the order they should get a view, both as intrusive lists.
+	A hidden active speaker takes the view of the visible user that spoke
+	least recently, and a view that frees up goes to the first hidden user.
+	Pinned users (the local user) keep their view.
+	Every view assignment is recorded as a ViewChange for the caller to
+	apply to its windows.
+*/
+class CParticipantRegistry
+{
+public:
+	enum {
+		MAX_VIEWS = 64,
+		NO_VIEW = -1,
+	};
+	struct ViewChange {
+		unsigned int uid;
+		int oldView;
+		int newView;
+		bool pinned;
+	};
+
+	CParticipantRegistry();
+	~CParticipantRegistry();
+
+	//number of usable views. users in views beyond the count are hidden.
+	void SetViewCount(int count);
+	int GetViewCount() const { return m_viewCount; }
+
+	//false if the uid is already tracked.
+	bool AddUser(unsigned int uid, bool pinned = false);
+	bool RemoveUser(unsigned int uid);
+	//the user is speaking: give it a view if hidden, mark it most recent if not.
+	void OnActiveSpeaker(unsigned int uid);
+	void Clear();
+
+	bool Contains(unsigned int uid) const { return Find(uid) >= 0; }
+	//view of the user, NO_VIEW if hidden or unknown.
+	int GetView(unsigned int uid) const;
+	//uid shown in the view, 0 if the view is free.
+	unsigned int GetViewUid(int view) const;
+	int GetUserCount() const { return m_userCount; }
+	int GetVisibleCount() const;
+
+	//move the pending view changes into changes.
+	void TakeChanges(std::vector<ViewChange>& changes);
+
+private:
+	struct Participant {
+		unsigned int uid = 0;
+		int view = NO_VIEW;
+		bool pinned = false;
+		//links in m_visible or m_hidden, -1 at the ends.
+		int prev = -1;
+		int next = -1;
+		//next record in the free list.
+		int nextFree = -1;
+	};
+	struct List {
+		int head = -1;
+		int tail = -1;
+	};
+
+	//hash table
+	static uint32_t Hash(unsigned int uid);
+	int Find(unsigned int uid) const;
+	void Insert(int record);
+	void Erase(unsigned int uid);
+	void Grow();
+
+	void PushFront(List& list, int record);
+	void PushBack(List& list, int record);
+	void Unlink(List& list, int record);
+
+	int AllocView();
+	void AssignView(int record, int view);
+	void ReleaseView(int record);
+	void FillFreeViews();
+
+	std::vector<Participant> m_records;
+	int m_freeRecord = -1;
+	int m_userCount = 0;
+	//record index per bucket, -1 for an empty bucket. size is a power of two.
+	std::vector<int> m_buckets;
+
+	List m_visible;
+	List m_hidden;
+	int m_viewCount = 0;
+	//bit set for every free view below m_viewCount.
+	uint64_t m_freeViews = 0;
+	int m_viewRecord[MAX_VIEWS];
+
+	std::vector<ViewChange> m_changes;
+};
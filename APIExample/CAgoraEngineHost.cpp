@@ -0,0 +1,303 @@
+#include "CAgoraEngineHost.h"
+//no stdafx.h, the host is tested against a mock engine.
+
+using namespace agora;
+using namespace agora::rtc;
+
+CAgoraEngineHost* CAgoraEngineHost::GetInstance()
+{
+	static CAgoraEngineHost host;
+	return &host;
+}
+
+CAgoraEngineHost::CAgoraEngineHost()
+{
+}
+
+CAgoraEngineHost::~CAgoraEngineHost()
+{
+}
+
+int CAgoraEngineHost::Attach(const RtcEngineContext& context, IRtcEngine** ppEngine)
+{
+	*ppEngine = nullptr;
+	std::string strAppId = context.appId ? context.appId : "";
+	//app id and area code are fixed at initialize, anything else can be
+	//changed on a running engine.
+	if (m_rtcEngine && (strAppId != m_strAppId || context.areaCode != m_areaCode)) {
+		if (m_leaseCount > 0)
+			return -ERR_REFUSED;
+		Shutdown();
+	}
+
+	if (!m_rtcEngine) {
+		m_rtcEngine = createAgoraRtcEngine();
+		if (!m_rtcEngine)
+			return -ERR_NOT_INITIALIZED;
+		RtcEngineContext hostContext = context;
+		hostContext.eventHandler = &m_hostEventHandler;
+		int ret = m_rtcEngine->initialize(hostContext);
+		if (ret != 0) {
+			m_rtcEngine->release(true);
+			m_rtcEngine = nullptr;
+			return ret;
+		}
+		m_strAppId = strAppId;
+		m_areaCode = context.areaCode;
+	}
+
+	if (context.eventHandler)
+		m_rtcEngine->registerEventHandler(context.eventHandler);
+	++m_leaseCount;
+	*ppEngine = m_rtcEngine;
+	return 0;
+}
+
+void CAgoraEngineHost::Detach(IRtcEngineEventHandler* eventHandler)
+{
+	if (!m_rtcEngine)
+		return;
+	if (m_leaseCount > 0)
+		--m_leaseCount;
+	//another scene still uses what is configured.
+	if (m_leaseCount == 0)
+		ResetEngineState();
+	if (eventHandler)
+		m_rtcEngine->unregisterEventHandler(eventHandler);
+}
+
+/*
+	Put the engine back into the state a freshly initialized engine has,
+	covering everything the scenes switch on. The calls are cheap no-ops
+	when the scene never touched the feature.
+*/
+void CAgoraEngineHost::ResetEngineState()
+{
+	m_rtcEngine->leaveChannel();
+	m_rtcEngine->stopPreview();
+	m_rtcEngine->stopEchoTest();
+	m_rtcEngine->stopLastmileProbeTest();
+	m_rtcEngine->stopAudioMixing();
+	m_rtcEngine->stopAllEffects();
+#if defined(_WIN32)
+	//only the desktop SDKs capture the screen.
+	m_rtcEngine->stopScreenCapture();
+#endif
+	m_rtcEngine->stopChannelMediaRelay();
+
+	VideoCanvas canvas;
+	canvas.uid = 0;
+	canvas.view = NULL;
+	m_rtcEngine->setupLocalVideo(canvas);
+
+	m_rtcEngine->muteLocalAudioStream(false);
+	m_rtcEngine->muteLocalVideoStream(false);
+	m_rtcEngine->muteAllRemoteAudioStreams(false);
+	m_rtcEngine->muteAllRemoteVideoStreams(false);
+	m_rtcEngine->enableDualStreamMode(false);
+
+	m_rtcEngine->registerPacketObserver(NULL);
+	m_rtcEngine->enableEncryption(false, EncryptionConfig());
+	m_rtcEngine->setBeautyEffectOptions(false, BeautyOptions());
+	m_rtcEngine->enableAudioVolumeIndication(0, 3, false);
+	m_rtcEngine->setExternalAudioSource(false, 0, 0);
+	m_rtcEngine->setExternalAudioSink(false, 0, 0);
+	ResetAudioFrameParameters(m_rtcEngine);
+
+	m_rtcEngine->setAudioEffectPreset(AUDIO_EFFECT_OFF);
+	m_rtcEngine->setVoiceBeautifierPreset(VOICE_BEAUTIFIER_OFF);
+	m_rtcEngine->setVoiceConversionPreset(VOICE_CONVERSION_OFF);
+	m_rtcEngine->setLocalVoicePitch(1.0);
+	m_rtcEngine->setAudioProfile(AUDIO_PROFILE_DEFAULT, AUDIO_SCENARIO_DEFAULT);
+	m_rtcEngine->setVideoEncoderConfiguration(VideoEncoderConfiguration());
+
+	agora::util::AutoPtr<agora::media::IMediaEngine> mediaEngine;
+	mediaEngine.queryInterface(m_rtcEngine, agora::AGORA_IID_MEDIA_ENGINE);
+	if (mediaEngine) {
+		mediaEngine->registerAudioFrameObserver(NULL);
+		mediaEngine->registerVideoFrameObserver(NULL);
+		mediaEngine->setExternalVideoSource(false, false);
+	}
+
+	m_rtcEngine->enableLocalVideo(true);
+	m_rtcEngine->disableVideo();
+	m_rtcEngine->enableAudio();
+	//the role only counts in live broadcasting, set it before leaving it.
+	m_rtcEngine->setClientRole(CLIENT_ROLE_AUDIENCE);
+	m_rtcEngine->setChannelProfile(CHANNEL_PROFILE_COMMUNICATION);
+}
+
+void CAgoraEngineHost::ResetAudioFrameParameters(IRtcEngine* engine)
+{
+	engine->setRecordingAudioFrameParameters(DEFAULT_AUDIO_FRAME_SAMPLE_RATE, DEFAULT_AUDIO_FRAME_CHANNELS,
+		RAW_AUDIO_FRAME_OP_MODE_READ_ONLY, DEFAULT_AUDIO_FRAME_SAMPLES);
+	engine->setPlaybackAudioFrameParameters(DEFAULT_AUDIO_FRAME_SAMPLE_RATE, DEFAULT_AUDIO_FRAME_CHANNELS,
+		RAW_AUDIO_FRAME_OP_MODE_READ_ONLY, DEFAULT_AUDIO_FRAME_SAMPLES);
+}
+
+void CAgoraEngineHost::Shutdown()
+{
+	if (!m_rtcEngine)
+		return;
+	m_rtcEngine->release(true);
+	m_rtcEngine = nullptr;
+	m_strAppId.clear();
+	m_areaCode = 0;
+	m_leaseCount = 0;
+}
+
+
+CAgoraEngineLease::CAgoraEngineLease()
+{
+}
+
+CAgoraEngineLease::~CAgoraEngineLease()
+{
+	Release();
+}
+
+int CAgoraEngineLease::Acquire(const RtcEngineContext& context)
+{
+	if (m_rtcEngine)
+		Release();
+	int ret = CAgoraEngineHost::GetInstance()->Attach(context, &m_rtcEngine);
+	if (ret == 0)
+		m_eventHandler = context.eventHandler;
+	return ret;
+}
+
+void CAgoraEngineLease::Release()
+{
+	if (!m_rtcEngine)
+		return;
+	for (auto it = m_cleanups.rbegin(); it != m_cleanups.rend(); ++it)
+		it->second(m_rtcEngine);
+	m_cleanups.clear();
+	CAgoraEngineHost::GetInstance()->Detach(m_eventHandler);
+	m_eventHandler = nullptr;
+	m_rtcEngine = nullptr;
+}
+
+int CAgoraEngineLease::RegisterPacketObserver(IPacketObserver* observer)
+{
+	if (!m_rtcEngine)
+		return -ERR_NOT_INITIALIZED;
+	int ret = m_rtcEngine->registerPacketObserver(observer);
+	if (ret == 0 && !observer)
+		SetCleanup("packetObserver", Cleanup());
+	else if (ret == 0)
+		SetCleanup("packetObserver", [](IRtcEngine* engine) { engine->registerPacketObserver(NULL); });
+	return ret;
+}
+
+int CAgoraEngineLease::RegisterAudioFrameObserver(agora::media::IAudioFrameObserver* observer)
+{
+	if (!m_rtcEngine)
+		return -ERR_NOT_INITIALIZED;
+	agora::util::AutoPtr<agora::media::IMediaEngine> mediaEngine;
+	mediaEngine.queryInterface(m_rtcEngine, agora::AGORA_IID_MEDIA_ENGINE);
+	if (!mediaEngine)
+		return -ERR_NOT_INITIALIZED;
+	int ret = mediaEngine->registerAudioFrameObserver(observer);
+	if (ret == 0 && !observer)
+		SetCleanup("audioFrameObserver", Cleanup());
+	else if (ret == 0) {
+		SetCleanup("audioFrameObserver", [](IRtcEngine* engine) {
+			agora::util::AutoPtr<agora::media::IMediaEngine> mediaEngine;
+			mediaEngine.queryInterface(engine, agora::AGORA_IID_MEDIA_ENGINE);
+			if (mediaEngine)
+				mediaEngine->registerAudioFrameObserver(NULL);
+		});
+	}
+	return ret;
+}
+
+int CAgoraEngineLease::RegisterVideoFrameObserver(agora::media::IVideoFrameObserver* observer)
+{
+	if (!m_rtcEngine)
+		return -ERR_NOT_INITIALIZED;
+	agora::util::AutoPtr<agora::media::IMediaEngine> mediaEngine;
+	mediaEngine.queryInterface(m_rtcEngine, agora::AGORA_IID_MEDIA_ENGINE);
+	if (!mediaEngine)
+		return -ERR_NOT_INITIALIZED;
+	int ret = mediaEngine->registerVideoFrameObserver(observer);
+	if (ret == 0 && !observer)
+		SetCleanup("videoFrameObserver", Cleanup());
+	else if (ret == 0) {
+		SetCleanup("videoFrameObserver", [](IRtcEngine* engine) {
+			agora::util::AutoPtr<agora::media::IMediaEngine> mediaEngine;
+			mediaEngine.queryInterface(engine, agora::AGORA_IID_MEDIA_ENGINE);
+			if (mediaEngine)
+				mediaEngine->registerVideoFrameObserver(NULL);
+		});
+	}
+	return ret;
+}
+
+int CAgoraEngineLease::RegisterMediaMetadataObserver(IMetadataObserver* observer, IMetadataObserver::METADATA_TYPE type)
+{
+	if (!m_rtcEngine)
+		return -ERR_NOT_INITIALIZED;
+	int ret = m_rtcEngine->registerMediaMetadataObserver(observer, type);
+	//one observer per metadata type.
+	std::string kind = "metadataObserver" + std::to_string((int)type);
+	if (ret == 0 && !observer)
+		SetCleanup(kind, Cleanup());
+	else if (ret == 0)
+		SetCleanup(kind, [type](IRtcEngine* engine) { engine->registerMediaMetadataObserver(NULL, type); });
+	return ret;
+}
+
+int CAgoraEngineLease::SetRecordingAudioFrameParameters(int sampleRate, int channel, RAW_AUDIO_FRAME_OP_MODE_TYPE mode, int samplesPerCall)
+{
+	if (!m_rtcEngine)
+		return -ERR_NOT_INITIALIZED;
+	int ret = m_rtcEngine->setRecordingAudioFrameParameters(sampleRate, channel, mode, samplesPerCall);
+	if (ret == 0) {
+		SetCleanup("recordingAudioFrameParameters", [](IRtcEngine* engine) {
+			engine->setRecordingAudioFrameParameters(CAgoraEngineHost::DEFAULT_AUDIO_FRAME_SAMPLE_RATE, CAgoraEngineHost::DEFAULT_AUDIO_FRAME_CHANNELS,
+				RAW_AUDIO_FRAME_OP_MODE_READ_ONLY, CAgoraEngineHost::DEFAULT_AUDIO_FRAME_SAMPLES);
+		});
+	}
+	return ret;
+}
+
+int CAgoraEngineLease::SetPlaybackAudioFrameParameters(int sampleRate, int channel, RAW_AUDIO_FRAME_OP_MODE_TYPE mode, int samplesPerCall)
+{
+	if (!m_rtcEngine)
+		return -ERR_NOT_INITIALIZED;
+	int ret = m_rtcEngine->setPlaybackAudioFrameParameters(sampleRate, channel, mode, samplesPerCall);
+	if (ret == 0) {
+		SetCleanup("playbackAudioFrameParameters", [](IRtcEngine* engine) {
+			engine->setPlaybackAudioFrameParameters(CAgoraEngineHost::DEFAULT_AUDIO_FRAME_SAMPLE_RATE, CAgoraEngineHost::DEFAULT_AUDIO_FRAME_CHANNELS,
+				RAW_AUDIO_FRAME_OP_MODE_READ_ONLY, CAgoraEngineHost::DEFAULT_AUDIO_FRAME_SAMPLES);
+		});
+	}
+	return ret;
+}
+
+int CAgoraEngineLease::SetParameters(const char* parameters, const char* restoreParameters)
+{
+	if (!m_rtcEngine)
+		return -ERR_NOT_INITIALIZED;
+	int ret = m_rtcEngine->setParameters(parameters);
+	if (ret == 0 && restoreParameters) {
+		//the restore value names what it restores, setting it again replaces it.
+		std::string strRestore = restoreParameters;
+		SetCleanup("parameters " + strRestore, [strRestore](IRtcEngine* engine) { engine->setParameters(strRestore.c_str()); });
+	}
+	return ret;
+}
+
+void CAgoraEngineLease::SetCleanup(const std::string& kind, Cleanup cleanup)
+{
+	for (auto it = m_cleanups.begin(); it != m_cleanups.end(); ++it) {
+		if (it->first == kind) {
+			m_cleanups.erase(it);
+			break;
+		}
+	}
+	//the latest install is undone first.
+	if (cleanup)
+		m_cleanups.emplace_back(kind, cleanup);
+}
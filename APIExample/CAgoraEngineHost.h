@@ -0,0 +1,99 @@
+#pragma once
+#include <IAgoraRtcEngine.h>
+#include <IAgoraMediaEngine.h>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+	One RtcEngine for the whole application.
+	Scenes used to create, initialize and release their own engine every
+	time they were shown. They now borrow the shared engine through a
+	CAgoraEngineLease: the lease registers the scene's event handler and
+	records what the scene installs, and on release undoes those installs.
+	When the last lease goes the engine is put back into its initial state
+	instead of being destroyed. The engine is only re-created when a scene asks for a different
+	app id or area code.
+*/
+class CAgoraEngineHost
+{
+public:
+	static CAgoraEngineHost* GetInstance();
+
+	//initialize the engine if needed and register context.eventHandler.
+	//same return value as IRtcEngine::initialize.
+	int Attach(const agora::rtc::RtcEngineContext& context, agora::rtc::IRtcEngine** ppEngine);
+	//unregister the handler; the last one out resets the engine to its
+	//initial state, the other scenes keep their configuration.
+	void Detach(agora::rtc::IRtcEngineEventHandler* eventHandler);
+	//release the engine for real, call when the application exits.
+	void Shutdown();
+
+	agora::rtc::IRtcEngine* GetEngine() const { return m_rtcEngine; }
+	int GetLeaseCount() const { return m_leaseCount; }
+
+	//the raw audio frame format of a fresh engine's observers, scenes that
+	//change it get it back when they leave.
+	enum {
+		DEFAULT_AUDIO_FRAME_SAMPLE_RATE = 44100,
+		DEFAULT_AUDIO_FRAME_CHANNELS = 2,
+		DEFAULT_AUDIO_FRAME_SAMPLES = 1024,
+	};
+	static void ResetAudioFrameParameters(agora::rtc::IRtcEngine* engine);
+
+private:
+	CAgoraEngineHost();
+	~CAgoraEngineHost();
+	void ResetEngineState();
+
+	agora::rtc::IRtcEngine* m_rtcEngine = nullptr;
+	//the engine needs a handler at initialize; scene handlers come and go
+	//through registerEventHandler.
+	agora::rtc::IRtcEngineEventHandler m_hostEventHandler;
+	std::string m_strAppId;
+	unsigned int m_areaCode = 0;
+	int m_leaseCount = 0;
+};
+
+/*
+	A scene's hold on the shared engine. Observers and parameters installed
+	through the lease are removed again by Release (or the destructor).
+	There is one cleanup per kind of install: installing it again replaces
+	the cleanup, removing it (a NULL observer) drops it.
+*/
+class CAgoraEngineLease
+{
+public:
+	CAgoraEngineLease();
+	~CAgoraEngineLease();
+
+	//borrow the engine, same return value as IRtcEngine::initialize.
+	int Acquire(const agora::rtc::RtcEngineContext& context);
+	//undo everything installed through the lease and give the engine back.
+	void Release();
+	bool IsHeld() const { return m_rtcEngine != nullptr; }
+	agora::rtc::IRtcEngine* GetEngine() const { return m_rtcEngine; }
+
+	typedef std::function<void(agora::rtc::IRtcEngine*)> Cleanup;
+
+	int RegisterPacketObserver(agora::rtc::IPacketObserver* observer);
+	int RegisterAudioFrameObserver(agora::media::IAudioFrameObserver* observer);
+	int RegisterVideoFrameObserver(agora::media::IVideoFrameObserver* observer);
+	int RegisterMediaMetadataObserver(agora::rtc::IMetadataObserver* observer, agora::rtc::IMetadataObserver::METADATA_TYPE type);
+	//the default format is set again when the lease is released.
+	int SetRecordingAudioFrameParameters(int sampleRate, int channel, agora::rtc::RAW_AUDIO_FRAME_OP_MODE_TYPE mode, int samplesPerCall);
+	int SetPlaybackAudioFrameParameters(int sampleRate, int channel, agora::rtc::RAW_AUDIO_FRAME_OP_MODE_TYPE mode, int samplesPerCall);
+	//restoreParameters is applied when the lease is released, once however
+	//often it was set.
+	int SetParameters(const char* parameters, const char* restoreParameters);
+	//any other restore step under its own kind, run in reverse order of
+	//the last install. an empty cleanup removes the kind.
+	void SetCleanup(const std::string& kind, Cleanup cleanup);
+	size_t GetCleanupCount() const { return m_cleanups.size(); }
+
+private:
+	agora::rtc::IRtcEngine* m_rtcEngine = nullptr;
+	agora::rtc::IRtcEngineEventHandler* m_eventHandler = nullptr;
+	std::vector<std::pair<std::string, Cleanup>> m_cleanups;
+};
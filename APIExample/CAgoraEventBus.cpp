@@ -0,0 +1,180 @@
+#include "CAgoraEventBus.h"
+#include "trace/Trace.h"
+#include <chrono>
+//no stdafx.h, the bus is tested on its own.
+
+namespace {
+	//the ring indexes with pos & (capacity - 1).
+	size_t RoundUpCapacity(size_t capacity)
+	{
+		size_t size = 2;
+		while (size < capacity)
+			size <<= 1;
+		return size;
+	}
+}
+
+CAgoraEventBus::CAgoraEventBus(size_t capacity)
+	: m_capacity(RoundUpCapacity(capacity))
+	, m_cells(new Cell[m_capacity])
+	, m_enqueuePos(0)
+	, m_wakePending(false)
+	, m_posted(0)
+	, m_dropped(0)
+{
+	for (size_t i = 0; i < m_capacity; ++i)
+		m_cells[i].sequence.store(i, std::memory_order_relaxed);
+	for (int i = 0; i < MAX_EVENT_TYPE; ++i)
+		m_coalesce[i] = false;
+	m_batch.reserve(m_capacity);
+	KeySlot empty = { 0, 0, 0 };
+	m_keySlots.assign(m_capacity * 2, empty);
+}
+
+CAgoraEventBus::~CAgoraEventBus()
+{
+}
+
+int64_t CAgoraEventBus::Now()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void CAgoraEventBus::SetWakeup(WakeupFunc wakeup)
+{
+	m_wakeup = wakeup;
+}
+
+void CAgoraEventBus::Subscribe(int type, EventHandler handler)
+{
+	if (type >= 0 && type < MAX_EVENT_TYPE)
+		m_handlers[type] = handler;
+}
+
+void CAgoraEventBus::SetCoalesce(int type, bool coalesce)
+{
+	if (type >= 0 && type < MAX_EVENT_TYPE)
+		m_coalesce[type] = coalesce;
+}
+
+/*
+	Bounded queue with a sequence number per cell: a cell whose sequence
+	equals the enqueue position is free for that position, one more means
+	it holds an event, and the consumer hands it back for the next lap by
+	adding the capacity.
+*/
+bool CAgoraEventBus::Post(const AgoraEvent& event)
+{
+	if (event.type < 0 || event.type >= MAX_EVENT_TYPE)
+		return false;
+	//every SDK callback of the scenes on the bus passes here.
+	AG_TRACE_SCOPE2("sdk", "CAgoraEventBus::Post", "type", event.type, "uid", event.uid);
+	Cell* cell = nullptr;
+	size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+	for (;;) {
+		cell = &m_cells[pos & (m_capacity - 1)];
+		size_t sequence = cell->sequence.load(std::memory_order_acquire);
+		intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+		if (diff == 0) {
+			if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				break;
+		}
+		else if (diff < 0) {
+			m_dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		else {
+			pos = m_enqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+	cell->event = event;
+	cell->event.postTime = Now();
+	cell->sequence.store(pos + 1, std::memory_order_release);
+	m_posted.fetch_add(1, std::memory_order_relaxed);
+
+	//only the first event after a drain wakes the consumer up.
+	if (!m_wakePending.exchange(true, std::memory_order_acq_rel) && m_wakeup)
+		m_wakeup();
+	return true;
+}
+
+bool CAgoraEventBus::Pop(AgoraEvent& event)
+{
+	Cell& cell = m_cells[m_dequeuePos & (m_capacity - 1)];
+	size_t sequence = cell.sequence.load(std::memory_order_acquire);
+	if ((intptr_t)sequence - (intptr_t)(m_dequeuePos + 1) < 0)
+		return false;
+	event = cell.event;
+	cell.sequence.store(m_dequeuePos + m_capacity, std::memory_order_release);
+	++m_dequeuePos;
+	return true;
+}
+
+CAgoraEventBus::KeySlot& CAgoraEventBus::FindKeySlot(uint64_t key)
+{
+	size_t mask = m_keySlots.size() - 1;
+	size_t i = (size_t)((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+	while (m_keySlots[i].batch == m_batchId && m_keySlots[i].key != key)
+		i = (i + 1) & mask;
+	return m_keySlots[i];
+}
+
+int CAgoraEventBus::Dispatch()
+{
+	AG_TRACE_SCOPE("ui", "CAgoraEventBus::Dispatch");
+	//clear the flag before draining, anything posted from now on wakes us again.
+	m_wakePending.exchange(false, std::memory_order_acq_rel);
+
+	m_batch.clear();
+	AgoraEvent event;
+	while (m_batch.size() < m_capacity && Pop(event))
+		m_batch.push_back(event);
+	//more than one ring worth arrived while draining, come back for the rest.
+	if (m_batch.size() == m_capacity && !m_wakePending.exchange(true, std::memory_order_acq_rel) && m_wakeup)
+		m_wakeup();
+
+	//a new batch id frees every key slot at once.
+	if (++m_batchId == 0) {
+		for (KeySlot& slot : m_keySlots)
+			slot.batch = 0;
+		m_batchId = 1;
+	}
+	//a later event of a coalesced type and uid replaces the earlier one.
+	for (size_t i = 0; i < m_batch.size(); ++i) {
+		AgoraEvent& e = m_batch[i];
+		if (!m_coalesce[e.type])
+			continue;
+		uint64_t key = ((uint64_t)e.type << 32) | e.uid;
+		KeySlot& slot = FindKeySlot(key);
+		if (slot.batch == m_batchId) {
+			m_batch[slot.index].type = -1;
+			++m_coalesced;
+		}
+		slot.key = key;
+		slot.batch = m_batchId;
+		slot.index = (uint32_t)i;
+	}
+
+	int delivered = 0;
+	int64_t now = Now();
+	for (const AgoraEvent& e : m_batch) {
+		if (e.type < 0)
+			continue;
+		if (now - e.postTime > m_maxLatency)
+			m_maxLatency = now - e.postTime;
+		if (m_handlers[e.type]) {
+			m_handlers[e.type](e);
+			++delivered;
+		}
+	}
+	return delivered;
+}
+
+void CAgoraEventBus::Clear()
+{
+	m_wakePending.exchange(false, std::memory_order_acq_rel);
+	AgoraEvent event;
+	while (Pop(event))
+		;
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include <IAgoraRtcEngine.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+//one SDK callback, copied by value into the event bus.
+struct AgoraEvent {
+	//EID_* code of the callback.
+	int type = 0;
+	unsigned int uid = 0;
+	//steady clock time in microseconds when the SDK thread posted the event.
+	int64_t postTime = 0;
+	union Payload {
+		Payload() {}
+		//small callbacks: elapsed, reason, state... see the posting handler.
+		int params[4];
+		agora::rtc::RtcStats rtcStats;
+		agora::rtc::LocalAudioStats localAudioStats;
+		agora::rtc::LocalVideoStats localVideoStats;
+		agora::rtc::RemoteVideoStats remoteVideoStats;
+		agora::rtc::RemoteAudioStats remoteAudioStats;
+	} data;
+};
+
+/*
+	Moves SDK callbacks to the UI thread without a heap allocation or a
+	window message per event.
+	SDK threads Post events into a fixed size ring (multi producer, single
+	consumer). The first event after the UI thread drained the ring calls
+	the wakeup function, usually a single PostMessage, and the UI thread
+	then Dispatches the whole batch to the subscribed handlers. Event types
+	marked for coalescing are delivered once per batch and uid, with the
+	latest value. When the ring is full the event is dropped and counted.
+*/
+class CAgoraEventBus
+{
+public:
+	typedef std::function<void(const AgoraEvent& event)> EventHandler;
+	typedef std::function<void()> WakeupFunc;
+	enum {
+		//default ring size, other sizes are rounded up to a power of two.
+		CAPACITY = 1024,
+		MAX_EVENT_TYPE = 256,
+	};
+
+	explicit CAgoraEventBus(size_t capacity = CAPACITY);
+	~CAgoraEventBus();
+
+	//called from the posting thread when a batch starts.
+	void SetWakeup(WakeupFunc wakeup);
+	//handler for one event type, called on the dispatching thread.
+	void Subscribe(int type, EventHandler handler);
+	//only deliver the latest event per uid of this type in a batch.
+	void SetCoalesce(int type, bool coalesce);
+
+	size_t GetCapacity() const { return m_capacity; }
+
+	//any thread. returns false if the ring was full and the event dropped.
+	bool Post(const AgoraEvent& event);
+	//dispatching thread. delivers everything queued, returns the number of
+	//events delivered.
+	int Dispatch();
+	//dispatching thread. drops everything queued.
+	void Clear();
+
+	uint64_t GetPostedCount() const { return m_posted.load(std::memory_order_relaxed); }
+	uint64_t GetDroppedCount() const { return m_dropped.load(std::memory_order_relaxed); }
+	uint64_t GetCoalescedCount() const { return m_coalesced; }
+	//largest post-to-dispatch delay seen, in microseconds.
+	int64_t GetMaxLatency() const { return m_maxLatency; }
+
+	static int64_t Now();
+
+private:
+	struct Cell {
+		std::atomic<size_t> sequence;
+		AgoraEvent event;
+	};
+	//where the latest event of a coalesced type and uid sits in m_batch.
+	//entries of an older batch are free.
+	struct KeySlot {
+		uint64_t key;
+		uint32_t batch;
+		uint32_t index;
+	};
+	bool Pop(AgoraEvent& event);
+	KeySlot& FindKeySlot(uint64_t key);
+
+	size_t m_capacity;
+	std::unique_ptr<Cell[]> m_cells;
+	std::atomic<size_t> m_enqueuePos;
+	size_t m_dequeuePos = 0;
+	std::atomic<bool> m_wakePending;
+	WakeupFunc m_wakeup;
+
+	EventHandler m_handlers[MAX_EVENT_TYPE];
+	bool m_coalesce[MAX_EVENT_TYPE];
+	//reused between batches so dispatching does not allocate.
+	std::vector<AgoraEvent> m_batch;
+	//open addressing, twice the ring size so probes stay short.
+	std::vector<KeySlot> m_keySlots;
+	uint32_t m_batchId = 0;
+
+	std::atomic<uint64_t> m_posted;
+	std::atomic<uint64_t> m_dropped;
+	uint64_t m_coalesced = 0;
+	int64_t m_maxLatency = 0;
+};
@@ -35,7 +35,7 @@ CConfig::CConfig()
     if (lcid == 2052) {//chinese  
         m_bChinese = true;
     }
-    
+    Reload();
 }
 
 
@@ -44,14 +44,85 @@ CConfig::~CConfig()
 }
 
 
-CString CConfig::GetStringValue(CString key)
+CString CConfig::GetStringValue(LPCTSTR key)
 {
-    CString strValue = _T("");
-    if (m_bChinese)
-        ::GetPrivateProfileString(_T("General"), key, _T("Unknown"), strValue.GetBuffer(MAX_PATH), MAX_PATH, m_strZhConfigFile);
-    else
-        ::GetPrivateProfileString(_T("General"), key, _T("Unknown"), strValue.GetBuffer(MAX_PATH), MAX_PATH, m_strEnConfigFile);
-    return strValue;
+    return GetStringValue(_T("General"), key, _T("Unknown"));
+}
+
+CString CConfig::GetStringValue(LPCTSTR lpSection, LPCTSTR lpKey, LPCTSTR lpDefault)
+{
+    int index = m_table.Find(lpSection, lpKey);
+    if (index == CStringTable::NOT_FOUND)
+        return lpDefault;
+    return m_values[index];
+}
+
+bool CConfig::Reload()
+{
+    CStringTable table;
+    WIN32_FILE_ATTRIBUTE_DATA attr = { 0 };
+    CString strFile = GetConfigFile();
+    ::GetFileAttributesEx(strFile, GetFileExInfoStandard, &attr);
+    if (!LoadConfigFile(strFile, table))
+        return false;
+    std::vector<CString> values(table.GetCount());
+    for (int i = 0; i < table.GetCount(); ++i)
+        values[i] = table.GetValue(i).c_str();
+    m_table.Swap(table);
+    m_values.swap(values);
+    m_ftLoaded = attr.ftLastWriteTime;
+    return true;
+}
+
+bool CConfig::ReloadIfChanged()
+{
+    WIN32_FILE_ATTRIBUTE_DATA attr = { 0 };
+    if (!::GetFileAttributesEx(GetConfigFile(), GetFileExInfoStandard, &attr))
+        return false;
+    if (::CompareFileTime(&attr.ftLastWriteTime, &m_ftLoaded) == 0)
+        return false;
+    return Reload();
+}
+
+/*
+    Same encodings as GetPrivateProfileString: ANSI files are read in the
+    system code page, UTF-16 and UTF-8 files need a BOM. CStringTable
+    applies the rest of its rules.
+*/
+bool CConfig::LoadConfigFile(LPCTSTR lpFile, CStringTable& table)
+{
+    HANDLE hFile = ::CreateFile(lpFile, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER fileSize = { 0 };
+    ::GetFileSizeEx(hFile, &fileSize);
+    std::vector<char> data((size_t)fileSize.QuadPart);
+    DWORD dwRead = 0;
+    BOOL bRead = data.empty() || ::ReadFile(hFile, &data[0], (DWORD)data.size(), &dwRead, NULL);
+    ::CloseHandle(hFile);
+    if (!bRead)
+        return false;
+    data.resize(dwRead);
+
+    std::wstring text;
+    if (data.size() >= 2 && (unsigned char)data[0] == 0xFF && (unsigned char)data[1] == 0xFE) {
+        text.assign((const wchar_t*)(&data[0] + 2), (data.size() - 2) / sizeof(wchar_t));
+    }
+    else if (!data.empty()) {
+        UINT codePage = CP_ACP;
+        size_t offset = 0;
+        if (data.size() >= 3 && (unsigned char)data[0] == 0xEF && (unsigned char)data[1] == 0xBB && (unsigned char)data[2] == 0xBF) {
+            codePage = CP_UTF8;
+            offset = 3;
+        }
+        int len = ::MultiByteToWideChar(codePage, 0, &data[0] + offset, (int)(data.size() - offset), NULL, 0);
+        text.resize(len);
+        if (len > 0)
+            ::MultiByteToWideChar(codePage, 0, &data[0] + offset, (int)(data.size() - offset), &text[0], len);
+    }
+
+    table.Parse(text.c_str(), text.size());
+    return true;
 }
 
 
@@ -1,4 +1,5 @@
 #pragma once
+#include "StringTable.h"
 #include <map>
 #include <vector>
 #define Str(key) CConfig::GetInstance()->GetStringValue(key) 
@@ -12,14 +13,34 @@ public:
     ~CConfig();
    
     static CConfig* GetInstance();
-    CString GetStringValue(CString key);
+    //value of key in the [General] section, "Unknown" when missing.
+    CString GetStringValue(LPCTSTR key);
+    CString GetStringValue(LPCTSTR lpSection, LPCTSTR lpKey, LPCTSTR lpDefault);
 	CString GetAPP_ID();
+
+    //parse the language file again.
+    bool Reload();
+    //reload only if the language file was written since the last load.
+    //returns true when the strings changed.
+    bool ReloadIfChanged();
 private:
-    
+    /*
+        The language file is parsed once into a CStringTable instead of
+        calling GetPrivateProfileString, which opens and scans the whole
+        file, for every key. A lookup hashes the section and key in place
+        and returns a copy of the CString kept for the entry, which only
+        shares its buffer.
+    */
+    bool LoadConfigFile(LPCTSTR lpFile, CStringTable& table);
+    CString GetConfigFile() const { return m_bChinese ? m_strZhConfigFile : m_strEnConfigFile; }
+
     CString m_strZhConfigFile;
 	CString m_strEnConfigFile;
     bool m_bChinese = false;
 
-    int hashSize = 1000;
+    CStringTable m_table;
+    //m_table's values by entry.
+    std::vector<CString> m_values;
+    FILETIME m_ftLoaded = { 0 };
 };
 
@@ -0,0 +1,134 @@
+#include "stdafx.h"
+#include "CSceneRegistry.h"
+
+CSceneRegistry::CSceneRegistry()
+{
+}
+
+CSceneRegistry::~CSceneRegistry()
+{
+	DestroyAll();
+}
+
+void CSceneRegistry::SetContainer(CWnd* pParent, const RECT& rcScene)
+{
+	m_pParent = pParent;
+	m_rcScene = rcScene;
+}
+
+void CSceneRegistry::Register(LPCTSTR lpSceneName, SceneFactory factory, SceneInit init, SceneUnInit uninit)
+{
+	SceneEntry entry;
+	entry.name = lpSceneName;
+	entry.factory = factory;
+	entry.init = init;
+	entry.uninit = uninit;
+	m_scenes.push_back(entry);
+}
+
+CSceneRegistry::SceneEntry* CSceneRegistry::FindScene(LPCTSTR lpSceneName)
+{
+	for (auto& entry : m_scenes) {
+		if (entry.name.Compare(lpSceneName) == 0)
+			return &entry;
+	}
+	return nullptr;
+}
+
+bool CSceneRegistry::CreateSceneDialog(SceneEntry& entry)
+{
+	if (entry.pDlg)
+		return true;
+	entry.pDlg = entry.factory(m_pParent);
+	if (!entry.pDlg)
+		return false;
+	entry.pDlg->MoveWindow(&m_rcScene);
+	entry.lastUsed = GetTickCount64();
+	return true;
+}
+
+void CSceneRegistry::DestroySceneDialog(SceneEntry& entry)
+{
+	if (!entry.pDlg)
+		return;
+	if (entry.showing) {
+		entry.uninit(entry.pDlg);
+		entry.showing = false;
+	}
+	entry.pDlg->DestroyWindow();
+	delete entry.pDlg;
+	entry.pDlg = nullptr;
+}
+
+CDialogEx* CSceneRegistry::ShowScene(LPCTSTR lpSceneName)
+{
+	SceneEntry* entry = FindScene(lpSceneName);
+	if (!entry || !CreateSceneDialog(*entry))
+		return nullptr;
+	if (entry->init)
+		entry->init(entry->pDlg);
+	entry->pDlg->ShowWindow(SW_SHOW);
+	entry->showing = true;
+	entry->lastUsed = GetTickCount64();
+	m_strMostRecent = entry->name;
+	return entry->pDlg;
+}
+
+void CSceneRegistry::HideScene(LPCTSTR lpSceneName)
+{
+	SceneEntry* entry = FindScene(lpSceneName);
+	//pre sel release first, scenes never shown have nothing to release.
+	if (!entry || !entry->pDlg || !entry->showing)
+		return;
+	entry->uninit(entry->pDlg);
+	entry->pDlg->ShowWindow(SW_HIDE);
+	entry->showing = false;
+	entry->lastUsed = GetTickCount64();
+}
+
+bool CSceneRegistry::PrewarmScene(LPCTSTR lpSceneName)
+{
+	SceneEntry* entry = FindScene(lpSceneName);
+	return entry && CreateSceneDialog(*entry);
+}
+
+int CSceneRegistry::PrewarmAll()
+{
+	int created = 0;
+	for (auto& entry : m_scenes) {
+		if (CreateSceneDialog(entry))
+			++created;
+	}
+	return created;
+}
+
+int CSceneRegistry::ReleaseIdleScenes(ULONGLONG idleTimeout)
+{
+	int released = 0;
+	ULONGLONG now = GetTickCount64();
+	for (auto& entry : m_scenes) {
+		if (!entry.pDlg || entry.showing)
+			continue;
+		if (now - entry.lastUsed < idleTimeout)
+			continue;
+		DestroySceneDialog(entry);
+		++released;
+	}
+	return released;
+}
+
+void CSceneRegistry::DestroyAll()
+{
+	for (auto& entry : m_scenes)
+		DestroySceneDialog(entry);
+}
+
+int CSceneRegistry::GetCreatedCount() const
+{
+	int count = 0;
+	for (auto& entry : m_scenes) {
+		if (entry.pDlg)
+			++count;
+	}
+	return count;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <afxdialogex.h>
+#include <functional>
+#include <vector>
+
+/*
+	Scene dialogs keyed by their tree item text.
+	A scene is only constructed and created the first time it is shown,
+	scenes that stay hidden longer than the idle timeout are destroyed
+	again, and the most recently used scene can be created ahead of time
+	so switching back to it after a restart is instant.
+*/
+class CSceneRegistry
+{
+public:
+	typedef std::function<CDialogEx*(CWnd* pParent)> SceneFactory;
+	typedef std::function<bool(CDialogEx*)> SceneInit;
+	typedef std::function<void(CDialogEx*)> SceneUnInit;
+
+	CSceneRegistry();
+	~CSceneRegistry();
+
+	//parent window of the scenes and the rect every scene is moved to.
+	void SetContainer(CWnd* pParent, const RECT& rcScene);
+
+	//register scene dialog T. T needs IDD, T(CWnd*), InitAgora and UnInitAgora.
+	//initOnShow false shows the scene without calling InitAgora.
+	template<class T>
+	void Register(LPCTSTR lpSceneName, bool initOnShow = true)
+	{
+		SceneFactory factory = [](CWnd* pParent) -> CDialogEx* {
+			T* pDlg = new T(pParent);
+			if (!pDlg->Create(T::IDD)) {
+				delete pDlg;
+				return nullptr;
+			}
+			return pDlg;
+		};
+		SceneInit init;
+		if (initOnShow)
+			init = [](CDialogEx* pDlg) { return static_cast<T*>(pDlg)->InitAgora(); };
+		SceneUnInit uninit = [](CDialogEx* pDlg) { static_cast<T*>(pDlg)->UnInitAgora(); };
+		Register(lpSceneName, factory, init, uninit);
+	}
+	void Register(LPCTSTR lpSceneName, SceneFactory factory, SceneInit init, SceneUnInit uninit);
+
+	//create the scene if needed, initialize and show it.
+	CDialogEx* ShowScene(LPCTSTR lpSceneName);
+	//uninitialize and hide the scene if it is showing.
+	void HideScene(LPCTSTR lpSceneName);
+	//create the scene without initializing or showing it.
+	bool PrewarmScene(LPCTSTR lpSceneName);
+	//create every scene the way startup did before the registry, to compare
+	//startup time and memory against. returns the number created.
+	int PrewarmAll();
+	//destroy hidden scenes not used for idleTimeout ms. returns the number destroyed.
+	int ReleaseIdleScenes(ULONGLONG idleTimeout);
+	void DestroyAll();
+
+	CString GetMostRecentScene() const { return m_strMostRecent; }
+	int GetCreatedCount() const;
+
+private:
+	struct SceneEntry {
+		CString name;
+		SceneFactory factory;
+		SceneInit init;
+		SceneUnInit uninit;
+		CDialogEx* pDlg = nullptr;
+		bool showing = false;
+		ULONGLONG lastUsed = 0;
+	};
+	SceneEntry* FindScene(LPCTSTR lpSceneName);
+	bool CreateSceneDialog(SceneEntry& entry);
+	void DestroySceneDialog(SceneEntry& entry);
+
+	std::vector<SceneEntry> m_scenes;
+	CWnd* m_pParent = nullptr;
+	RECT m_rcScene = { 0 };
+	CString m_strMostRecent;
+};
@@ -2,6 +2,7 @@
 #include "AGDShowAudioCapture.h"
 #include "DShowHelper.h"
 #include "CircleBuffer.hpp"
+#include "trace/Trace.h"
 #include <Dvdmedia.h>
 #include "..\Advanced\CustomAudioCapture\CAgoraCaptureAudioDlg.h"
 
@@ -630,6 +631,8 @@ void CAGDShowAudioCapture::Receive(bool video, IMediaSample *sample)
     if (FAILED(sample->GetPointer(&pBuffer)))
         return;
 
+	AG_TRACE_THREAD_NAME("dshow audio capture");
+	AG_TRACE_SCOPE1("capture", "CAGDShowAudioCapture::Receive", "size", size);
 	if (dlgCapture) {
 		dlgCapture->PushAudioFrame(pBuffer, size, GetTickCount64());
 	}
@@ -5,6 +5,7 @@
 #include "AgVideoBuffer.h"
 #include "DShowHelper.h"
 #include "libyuv.h"
+#include "trace/Trace.h"
 #ifdef DEBUG
 #pragma comment(lib, "yuv.lib")
 #pragma comment(lib, "jpeg-static.lib")
@@ -25,6 +26,8 @@ CAGDShowVideoCapture::CAGDShowVideoCapture()
 }
 
 CAGDShowVideoCapture::~CAGDShowVideoCapture() {
+  //no samples may arrive once the decode pipeline is gone.
+  Stop();
   Close();
   if (m_lpYUVBuffer) {
     delete[] m_lpYUVBuffer;
@@ -439,6 +442,21 @@ BOOL CAGDShowVideoCapture::CreateCaptureFilter() {
 
 BOOL CAGDShowVideoCapture::Start() {
   if (ConnectFilters()) {
+    m_convertFrames = 0;
+    m_convertNs = 0;
+    m_frameSequence = 0;
+    if (!m_sampleCallback &&
+        bmiHeader->biCompression == MAKEFOURCC('M', 'J', 'P', 'G'))
+      m_mjpegPipeline.Start(bmiHeader->biWidth, bmiHeader->biHeight,
+                            [this](const MjpegDecodedFrame &frame) {
+                              m_convertNs += frame.decodeNs;
+                              ++m_convertFrames;
+                              CAgVideoBuffer::GetInstance()->writeBuffer(
+                                  const_cast<BYTE *>(frame.data),
+                                  (int)frame.size,
+                                  (int)(frame.timestampUs / 1000),
+                                  frame.flowId);
+                            });
     control->Run();
     active = true;
     return TRUE;
@@ -449,10 +467,17 @@ BOOL CAGDShowVideoCapture::Start() {
 void CAGDShowVideoCapture::Stop() {
   if (active) {
     control->Stop();
+    m_mjpegPipeline.Stop();
     active = false;
   }
 }
 
+void CAGDShowVideoCapture::GetConvertStats(long long *frames,
+                                           long long *ns) const {
+  *frames = m_convertFrames;
+  *ns = m_convertNs;
+}
+
 void CAGDShowVideoCapture::GetDeviceName(LPTSTR deviceName,
                                          SIZE_T *nDeviceLen) {
   for (size_t i = 0; i < m_listDeviceInfo.GetCount(); ++i) {
@@ -535,15 +560,25 @@ BOOL CAGDShowVideoCapture::GetCurrentMediaType(AM_MEDIA_TYPE **lpAMMediaType) {
 }
 
 void CAGDShowVideoCapture::Receive(bool video, IMediaSample *sample) {
+  AG_TRACE_THREAD_NAME("dshow video capture");
   BYTE *pBuffer;
   if (!sample) return;
 
   int size = sample->GetActualDataLength();
   if (!size) return;
+  //the buffer timestamp; ticks repeat within a frame interval, so the flow
+  //id of the frame in the trace is its sequence.
+  DWORD tick = GetTickCount();
+  ULONGLONG sequence = m_frameSequence++;
+  AG_TRACE_SCOPE2("capture", "CAGDShowVideoCapture::Receive", "sequence", sequence, "size", size);
 
   if (FAILED(sample->GetPointer(&pBuffer))) return;
   long long startTime, stopTime;
   bool hasTime = SUCCEEDED(sample->GetTime(&startTime, &stopTime));
+  if (m_sampleCallback) {
+    m_sampleCallback(pBuffer, size, hasTime ? startTime : -1);
+    return;
+  }
 
 #ifdef DEBUG
   HANDLE hFile = INVALID_HANDLE_VALUE;
@@ -584,9 +619,19 @@ void CAGDShowVideoCapture::Receive(bool video, IMediaSample *sample) {
     ::CloseHandle(hFile);
   }
 #endif
+  if (m_mjpegPipeline.IsRunning()) {
+    //dropped when every decoder is busy, the graph must not wait on us.
+    AG_TRACE_FLOW_BEGIN("frame", "video frame", sequence);
+    m_mjpegPipeline.Submit(pBuffer, size, tick * 1000ll, sequence);
+    return;
+  }
   m_lpY = m_lpYUVBuffer;
   m_lpU = m_lpY + bmiHeader->biWidth * bmiHeader->biHeight;
   m_lpV = m_lpU + bmiHeader->biWidth * bmiHeader->biHeight / 4;
+  AG_TRACE_FLOW_BEGIN("frame", "video frame", sequence);
+  LARGE_INTEGER convertBegin, convertEnd, frequency;
+  QueryPerformanceCounter(&convertBegin);
+  AG_TRACE_BEGIN1("convert", "ToI420", "fourcc", bmiHeader->biCompression);
   switch (bmiHeader->biCompression) {
     case 0x00000000:  // RGB24
       RGB24ToI420(pBuffer, bmiHeader->biWidth * 3, m_lpY, bmiHeader->biWidth,
@@ -596,6 +641,13 @@ void CAGDShowVideoCapture::Receive(bool video, IMediaSample *sample) {
     case MAKEFOURCC('I', '4', '2', '0'):  // I420
       memcpy_s(m_lpYUVBuffer, 0x800000, pBuffer, size);
       break;
+    case MAKEFOURCC('N', 'V', '1', '2'):  // NV12
+      NV12ToI420(pBuffer, bmiHeader->biWidth,
+                 pBuffer + bmiHeader->biWidth * bmiHeader->biHeight,
+                 bmiHeader->biWidth, m_lpY, bmiHeader->biWidth, m_lpU,
+                 bmiHeader->biWidth / 2, m_lpV, bmiHeader->biWidth / 2,
+                 bmiHeader->biWidth, bmiHeader->biHeight);
+      break;
     case MAKEFOURCC('Y', 'U', 'Y', '2'):  // YUY2
       YUY2ToI420(pBuffer, bmiHeader->biWidth * 2, m_lpY, bmiHeader->biWidth,
                  m_lpU, bmiHeader->biWidth / 2, m_lpV, bmiHeader->biWidth / 2,
@@ -608,7 +660,7 @@ void CAGDShowVideoCapture::Receive(bool video, IMediaSample *sample) {
                  bmiHeader->biHeight);
       break;
     case MAKEFOURCC('U', 'Y', 'V', 'Y'):  // UYVY
-      UYVYToI420(pBuffer, bmiHeader->biWidth, m_lpY, bmiHeader->biWidth, m_lpU,
+      UYVYToI420(pBuffer, bmiHeader->biWidth * 2, m_lpY, bmiHeader->biWidth, m_lpU,
                  bmiHeader->biWidth / 2, m_lpV, bmiHeader->biWidth / 2,
                  bmiHeader->biWidth, bmiHeader->biHeight);
       break;
@@ -616,9 +668,15 @@ void CAGDShowVideoCapture::Receive(bool video, IMediaSample *sample) {
       ATLASSERT(FALSE);
       break;
   }
+  AG_TRACE_END("convert", "ToI420");
+  QueryPerformanceCounter(&convertEnd);
+  QueryPerformanceFrequency(&frequency);
+  m_convertNs += (convertEnd.QuadPart - convertBegin.QuadPart) * 1000000000ll /
+                 frequency.QuadPart;
+  ++m_convertFrames;
   SIZE_T nYUVSize = bmiHeader->biWidth * bmiHeader->biHeight * 3 / 2;
   if (!CAgVideoBuffer::GetInstance()->writeBuffer(m_lpYUVBuffer, nYUVSize,
-                                                  GetTickCount())) {
+                                                  tick, sequence)) {
     OutputDebugString(L"CAgVideoBuffer::GetInstance()->writeBuffer failed.");
     return;
   }
@@ -4,6 +4,9 @@
 #include <atlcoll.h>
 #include "IAGDShowDevice.h"
 #include "capture-filter.hpp"
+#include "capture/MjpegDecodePipeline.h"
+#include <atomic>
+#include <functional>
 #include <vector>
 class CAGDShowVideoCapture
     : public IDShowCaptureDevice
@@ -41,6 +44,14 @@ public:
    
     virtual BOOL GetAudioCap(int nIndex, WAVEFORMATEX *lpWaveInfo) { return FALSE; }
     virtual BOOL GetCurrentAudioCap(WAVEFORMATEX *lpWaveInfo) { return FALSE; }
+
+    //raw samples in the selected media cap, on the streaming thread. while a
+    //callback is set Receive hands it the sample instead of converting it
+    //into CAgVideoBuffer. set it before Start.
+    typedef std::function<void(const BYTE *data, int size, long long startTime)> SampleCallback;
+    void SetSampleCallback(SampleCallback callback) { m_sampleCallback = callback; }
+    //frames Receive converted into I420 since Start and the time that took.
+    void GetConvertStats(long long *frames, long long *ns) const;
 private:
     BOOL ConnectFilters();
     BOOL ConnectPins(const GUID &category, const GUID &type,
@@ -74,5 +85,13 @@ private:
     LPBYTE		m_lpY = nullptr;
     LPBYTE		m_lpU = nullptr;
     LPBYTE		m_lpV = nullptr;
+    SampleCallback m_sampleCallback;
+    std::atomic<long long> m_convertFrames{0};
+    std::atomic<long long> m_convertNs{0};
+    //MJPG samples are decoded on its workers instead of the streaming thread.
+    CMjpegDecodePipeline m_mjpegPipeline;
+    //counts the samples Receive got since Start, the frame's flow id in the
+    //trace. only the streaming thread touches it.
+    ULONGLONG m_frameSequence = 0;
 };
 
@@ -24,7 +24,7 @@ CAgVideoBuffer::~CAgVideoBuffer()
 void CAgVideoBuffer::SetVideoFormat(const BITMAPINFOHEADER *lpInfoHeader)
 {
     memcpy_s(&m_bmiHeader, sizeof(BITMAPINFOHEADER), lpInfoHeader, sizeof(BITMAPINFOHEADER));
-    m_nPackageSize = m_bmiHeader.biWidth*m_bmiHeader.biWidth * 3 / 2;
+    m_nPackageSize = m_bmiHeader.biWidth*abs(m_bmiHeader.biHeight) * 3 / 2;
     _ASSERT(m_nPackageSize <= VIDEO_BUF_SIZE);
 }
 
@@ -33,21 +33,23 @@ void CAgVideoBuffer::GetVideoFormat(BITMAPINFOHEADER *lpInfoHeader)
     memcpy_s(lpInfoHeader, sizeof(BITMAPINFOHEADER), &m_bmiHeader, sizeof(BITMAPINFOHEADER));
 }
 
-bool CAgVideoBuffer::writeBuffer(BYTE* buffer, int bufsize, int ts)
+bool CAgVideoBuffer::writeBuffer(BYTE* buffer, int bufsize, int ts, ULONGLONG seq)
 {
     if ((size_t)bufsize < m_nPackageSize)
         return false;
     std::lock_guard<std::mutex> buf_lock(buf_mutex);
     memcpy_s(videoBuffer, bufsize, buffer, bufsize);
     timestamp = ts;
+    sequence = seq;
     return true;
 }
-bool CAgVideoBuffer::readBuffer(BYTE* buffer, int bufsize, int& ts)
+bool CAgVideoBuffer::readBuffer(BYTE* buffer, int bufsize, int& ts, ULONGLONG& seq)
 {
     if ((size_t)bufsize < m_nPackageSize)
         return false;
     std::lock_guard<std::mutex> buf_lock(buf_mutex);
     memcpy_s(buffer, bufsize, videoBuffer, bufsize);
     ts = timestamp;
+    seq = sequence;
     return true;
 }
\ No newline at end of file
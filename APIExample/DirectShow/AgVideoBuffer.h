@@ -10,8 +10,9 @@ public:
     void SetVideoFormat(const BITMAPINFOHEADER *lpInfoHeader);
     void GetVideoFormat(BITMAPINFOHEADER *lpInfoHeader);
 
-    bool writeBuffer(BYTE* buffer, int bufsize, int ts);
-    bool readBuffer(BYTE* buffer, int bufsize, int& ts);
+    //sequence is the frame's flow id in the trace.
+    bool writeBuffer(BYTE* buffer, int bufsize, int ts, ULONGLONG sequence = 0);
+    bool readBuffer(BYTE* buffer, int bufsize, int& ts, ULONGLONG& sequence);
 
     static CAgVideoBuffer* GetInstance();
 private:
@@ -19,5 +20,6 @@ private:
     BITMAPINFOHEADER	m_bmiHeader;
     SIZE_T				m_nPackageSize;
     int                 timestamp;
+    ULONGLONG           sequence = 0;
 };
 
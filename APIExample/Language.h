@@ -61,6 +61,9 @@ extern wchar_t rtmpStreamingCtrlAdd[INFO_LEN];
 extern wchar_t rtmpStreamingCtrlRemove[INFO_LEN];
 extern wchar_t rtmpStreamingCtrlTransCoding[INFO_LEN];
 extern wchar_t rtmpStreamingCtrlRemoveAll[INFO_LEN];
+extern wchar_t rtmpStreamingCtrlLayoutGrid[INFO_LEN];
+extern wchar_t rtmpStreamingCtrlLayoutSpeaker[INFO_LEN];
+extern wchar_t rtmpStreamingCtrlLayoutPip[INFO_LEN];
 //rtmp stream state changed
 extern wchar_t agoraRtmpStateIdle[INFO_LEN];
 extern wchar_t agoraRtmpStateConnecting[INFO_LEN];
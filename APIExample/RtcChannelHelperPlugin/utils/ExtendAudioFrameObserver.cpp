@@ -2,6 +2,7 @@
 #include <stdio.h>
 
 CMeidaPlayerAudioFrameObserver::CMeidaPlayerAudioFrameObserver():agoraAudioBuf(new AudioCircularBuffer<char>(2048,true)), play_back_audio_circular_buffer_(new AudioCircularBuffer<char>(2048, true))
+	, sample_rate(48000), channels(2), re_sample_rate(48000), re_channels(2)
 {
 	
 }
@@ -119,6 +120,20 @@ bool  CMeidaPlayerAudioFrameObserver::onMixedAudioFrame(AudioFrame& audioFrame){
     return true;
 }
 void CMeidaPlayerAudioFrameObserver::pushAudioData(void *data,int len){
+	if (sample_rate != re_sample_rate || channels != re_channels) {
+		if (!resampler_.IsInitialized()
+			|| resampler_.GetInSampleRate() != sample_rate || resampler_.GetInChannels() != channels
+			|| resampler_.GetOutSampleRate() != re_sample_rate || resampler_.GetOutChannels() != re_channels) {
+			if (!resampler_.Init(sample_rate, channels, re_sample_rate, re_channels))
+				return;
+		}
+		int inSamples = len / (channels * sizeof(int16_t));
+		int outSamples = resampler_.GetOutputSamples(inSamples);
+		resample_buffer_.resize(outSamples * re_channels);
+		resampler_.Process((const int16_t*)data, inSamples, resample_buffer_.data(), outSamples);
+		data = resample_buffer_.data();
+		len = outSamples * re_channels * sizeof(int16_t);
+	}
 
 	mtx.lock();
 	agoraAudioBuf->Push((char *)data, len);
@@ -129,6 +144,7 @@ void CMeidaPlayerAudioFrameObserver::pushAudioData(void *data,int len){
 }
 void CMeidaPlayerAudioFrameObserver::reset(){
     agoraAudioBuf.reset(new AudioCircularBuffer<char>(2048, true));
+	resampler_.Reset();
 	play_back_audio_circular_buffer_.reset(new AudioCircularBuffer<char>(2048, true));
 }
 void CMeidaPlayerAudioFrameObserver::setAudioMixing(bool isAudioMix){
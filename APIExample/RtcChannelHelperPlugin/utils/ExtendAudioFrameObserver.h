@@ -6,6 +6,8 @@
 #include "AudioCircularBuffer.h"
 #include "scoped_ptr.h"
 #include <list>
+#include <vector>
+#include "dsp/AudioResampler.h"
 using namespace AgoraRTC;
 using namespace std;
 class CMeidaPlayerAudioFrameObserver:public agora::media::IAudioFrameObserver
@@ -23,11 +25,16 @@ private:
 	virtual bool onPlaybackAudioFrameBeforeMixing(unsigned int uid, AudioFrame& audioFrame);
 	scoped_ptr<AudioCircularBuffer<char>> agoraAudioBuf;
 	scoped_ptr<AudioCircularBuffer<char>> play_back_audio_circular_buffer_;
+	CAudioResampler resampler_;
+	std::vector<int16_t> resample_buffer_;
 
 public:
 	CMeidaPlayerAudioFrameObserver();
 	~CMeidaPlayerAudioFrameObserver();
+	//format of the data given to pushAudioData.
 	int sample_rate;
+	int channels;
+	//format of the sdk audio frames, pushed data is resampled to it.
 	int re_sample_rate;
 	int re_channels;
 	void pushAudioData(void *data, int len);
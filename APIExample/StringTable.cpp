@@ -0,0 +1,143 @@
+#include "StringTable.h"
+#include <wctype.h>
+//no stdafx.h, the table is tested and benchmarked on its own.
+
+namespace {
+	//the keys are ASCII, towlower is only asked for the rest.
+	inline wchar_t ToLower(wchar_t c)
+	{
+		if (c < 0x80)
+			return c >= L'A' && c <= L'Z' ? (wchar_t)(c + (L'a' - L'A')) : c;
+		return (wchar_t)towlower(c);
+	}
+
+	void Trim(const wchar_t* begin, const wchar_t* end, const wchar_t*& outBegin, const wchar_t*& outEnd)
+	{
+		while (begin < end && iswspace(*begin)) ++begin;
+		while (end > begin && iswspace(end[-1])) --end;
+		outBegin = begin;
+		outEnd = end;
+	}
+
+	std::wstring Lower(const wchar_t* begin, const wchar_t* end)
+	{
+		std::wstring lower(begin, end);
+		for (auto& c : lower)
+			c = ToLower(c);
+		return lower;
+	}
+}
+
+uint32_t CStringTable::Hash(const wchar_t* section, const wchar_t* key)
+{
+	//FNV-1a over the lower case "section\nkey".
+	uint32_t hash = 2166136261u;
+	for (const wchar_t* p = section; *p; ++p)
+		hash = (hash ^ (uint32_t)ToLower(*p)) * 16777619u;
+	hash = (hash ^ (uint32_t)L'\n') * 16777619u;
+	for (const wchar_t* p = key; *p; ++p)
+		hash = (hash ^ (uint32_t)ToLower(*p)) * 16777619u;
+	return hash;
+}
+
+bool CStringTable::EqualsLower(const std::wstring& lower, const wchar_t* text)
+{
+	size_t i = 0;
+	for (; i < lower.size(); ++i) {
+		if (!text[i] || ToLower(text[i]) != lower[i])
+			return false;
+	}
+	return !text[i];
+}
+
+size_t CStringTable::Probe(uint32_t hash, const wchar_t* section, const wchar_t* key) const
+{
+	size_t mask = m_slots.size() - 1;
+	for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+		uint32_t index = m_slots[slot];
+		if (!index)
+			return slot;
+		const Entry& entry = m_entries[index - 1];
+		if (entry.hash == hash && EqualsLower(entry.key, key) && EqualsLower(entry.section, section))
+			return slot;
+	}
+}
+
+void CStringTable::Rehash()
+{
+	size_t size = 16;
+	while (size < m_entries.size() * 2)
+		size *= 2;
+	m_slots.assign(size, 0);
+	size_t mask = size - 1;
+	for (size_t i = 0; i < m_entries.size(); ++i) {
+		size_t slot = m_entries[i].hash & mask;
+		while (m_slots[slot])
+			slot = (slot + 1) & mask;
+		m_slots[slot] = (uint32_t)(i + 1);
+	}
+}
+
+int CStringTable::Find(const wchar_t* section, const wchar_t* key) const
+{
+	if (m_slots.empty() || !section || !key)
+		return NOT_FOUND;
+	uint32_t index = m_slots[Probe(Hash(section, key), section, key)];
+	return index ? (int)index - 1 : NOT_FOUND;
+}
+
+void CStringTable::Parse(const wchar_t* text, size_t length)
+{
+	m_entries.clear();
+	Rehash();
+	std::wstring section;
+	bool inSection = false;
+	const wchar_t* p = text;
+	const wchar_t* textEnd = text + length;
+	while (p < textEnd) {
+		const wchar_t* lineEnd = p;
+		while (lineEnd < textEnd && *lineEnd != L'\n' && *lineEnd != L'\r') ++lineEnd;
+		const wchar_t *b, *e;
+		Trim(p, lineEnd, b, e);
+		p = lineEnd + 1;
+		if (b == e || *b == L';')
+			continue;
+		if (*b == L'[') {
+			const wchar_t* close = b + 1;
+			while (close < e && *close != L']') ++close;
+			Trim(b + 1, close, b, e);
+			section = Lower(b, e);
+			inSection = true;
+			continue;
+		}
+		const wchar_t* eq = b;
+		while (eq < e && *eq != L'=') ++eq;
+		if (!inSection || eq == e)
+			continue;
+		const wchar_t *kb, *ke, *vb, *ve;
+		Trim(b, eq, kb, ke);
+		Trim(eq + 1, e, vb, ve);
+		if (ve - vb >= 2 && (*vb == L'"' || *vb == L'\'') && ve[-1] == *vb) {
+			++vb;
+			--ve;
+		}
+		Entry entry;
+		entry.section = section;
+		entry.key = Lower(kb, ke);
+		entry.hash = Hash(entry.section.c_str(), entry.key.c_str());
+		size_t slot = Probe(entry.hash, entry.section.c_str(), entry.key.c_str());
+		if (m_slots[slot])
+			continue;
+		entry.value.assign(vb, ve);
+		m_entries.push_back(std::move(entry));
+		m_slots[slot] = (uint32_t)m_entries.size();
+		if (m_entries.size() * 2 > m_slots.size())
+			Rehash();
+	}
+}
+
+void CStringTable::Swap(CStringTable& other)
+{
+	m_entries.swap(other.m_entries);
+	m_slots.swap(other.m_slots);
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/*
+	The parsed language file behind CConfig. Parse runs once per load and
+	interns every "section / key" in lower case; Find hashes and compares
+	the caller's strings case-insensitively in place, so a lookup neither
+	allocates nor copies. Entries are numbered in file order, which lets
+	CConfig keep its CString values in a vector next to the table.
+*/
+class CStringTable
+{
+public:
+	enum { NOT_FOUND = -1 };
+
+	//the same rules as GetPrivateProfileString on already decoded text:
+	//names ignore case, blanks around names and values are dropped, one
+	//pair of quotes around a value is removed, ';' starts a comment line
+	//and the first of duplicate keys wins. replaces what was parsed before.
+	void Parse(const wchar_t* text, size_t length);
+
+	//the entry of key in section, NOT_FOUND when missing.
+	int Find(const wchar_t* section, const wchar_t* key) const;
+	const std::wstring& GetValue(int index) const { return m_entries[index].value; }
+	int GetCount() const { return (int)m_entries.size(); }
+	void Swap(CStringTable& other);
+
+private:
+	struct Entry {
+		//both lower case.
+		std::wstring section;
+		std::wstring key;
+		std::wstring value;
+		uint32_t hash;
+	};
+
+	static uint32_t Hash(const wchar_t* section, const wchar_t* key);
+	static bool EqualsLower(const std::wstring& lower, const wchar_t* text);
+	//the slot holding key, or the empty slot where it would go.
+	size_t Probe(uint32_t hash, const wchar_t* section, const wchar_t* key) const;
+	void Rehash();
+
+	std::vector<Entry> m_entries;
+	//open addressing, entry index + 1 or 0 for an empty slot. a power of
+	//two at least twice the entry count.
+	std::vector<uint32_t> m_slots;
+};
@@ -0,0 +1,463 @@
+#include "AudioFileReader.h"
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+//no stdafx.h, the reader also builds without MFC.
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	const uint16_t kWaveFormatPcm = 1;
+	const uint16_t kWaveFormatFloat = 3;
+	const uint16_t kWaveFormatExtensible = 0xFFFE;
+
+	uint16_t ReadLE16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+	uint32_t ReadLE32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+	int64_t NowNs()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void ConvertSamples(const uint8_t* src, AudioSampleFormat format, size_t count, int16_t* dst)
+	{
+		switch (format) {
+		case AUDIO_SAMPLE_PCM8:
+			for (size_t i = 0; i < count; ++i)
+				dst[i] = (int16_t)(((int32_t)src[i] - 128) << 8);
+			break;
+		case AUDIO_SAMPLE_PCM16:
+			memcpy(dst, src, count * sizeof(int16_t));
+			break;
+		case AUDIO_SAMPLE_PCM24:
+			for (size_t i = 0; i < count; ++i, src += 3)
+				dst[i] = (int16_t)((int32_t)((uint32_t)src[0] << 8 | (uint32_t)src[1] << 16 | (uint32_t)src[2] << 24) >> 16);
+			break;
+		case AUDIO_SAMPLE_PCM32:
+			for (size_t i = 0; i < count; ++i, src += 4)
+				dst[i] = (int16_t)((int32_t)ReadLE32(src) >> 16);
+			break;
+		case AUDIO_SAMPLE_FLOAT32:
+			for (size_t i = 0; i < count; ++i, src += 4) {
+				float f;
+				memcpy(&f, src, 4);
+				dst[i] = (int16_t)(std::max)(-32768.f, (std::min)(32767.f, f * 32768.f));
+			}
+			break;
+		}
+	}
+
+	//positional reads, so the read-ahead never shares a file pointer.
+	bool OpenFileSource(const std::string& path, CAudioFileReader::ReadFunction& read, uint64_t& size)
+	{
+#ifdef _WIN32
+		int length = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, NULL, 0);
+		if (length <= 1)
+			return false;
+		std::wstring wpath(length - 1, L'\0');
+		MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &wpath[0], length);
+		HANDLE file = CreateFileW(wpath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize)) {
+			CloseHandle(file);
+			return false;
+		}
+		std::shared_ptr<void> handle(file, CloseHandle);
+		size = (uint64_t)fileSize.QuadPart;
+		read = [handle](uint64_t offset, void* data, size_t bytes) -> size_t {
+			OVERLAPPED overlapped = {};
+			overlapped.Offset = (DWORD)offset;
+			overlapped.OffsetHigh = (DWORD)(offset >> 32);
+			DWORD done = 0;
+			if (!ReadFile(handle.get(), data, (DWORD)bytes, &done, &overlapped))
+				return 0;
+			return done;
+		};
+#else
+		int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+			return false;
+		struct stat st;
+		if (fstat(fd, &st) != 0) {
+			close(fd);
+			return false;
+		}
+#ifdef POSIX_FADV_SEQUENTIAL
+		posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+		std::shared_ptr<int> handle(new int(fd), [](int* p) { close(*p); delete p; });
+		size = (uint64_t)st.st_size;
+		read = [handle](uint64_t offset, void* data, size_t bytes) -> size_t {
+			size_t done = 0;
+			while (done < bytes) {
+				ssize_t n = pread(*handle, (uint8_t*)data + done, bytes - done, (off_t)(offset + done));
+				if (n <= 0)
+					break;
+				done += (size_t)n;
+			}
+			return done;
+		};
+#endif
+		return true;
+	}
+}
+
+int AudioFileFormat::GetBytesPerSample() const
+{
+	switch (sampleFormat) {
+	case AUDIO_SAMPLE_PCM8:
+		return 1;
+	case AUDIO_SAMPLE_PCM16:
+		return 2;
+	case AUDIO_SAMPLE_PCM24:
+		return 3;
+	default:
+		return 4;
+	}
+}
+
+CAudioFileReader::CAudioFileReader()
+{
+}
+
+CAudioFileReader::~CAudioFileReader()
+{
+	Close();
+}
+
+void CAudioFileReader::SetReadAhead(int blockFrames, int blockCount)
+{
+	m_blockFrames = (std::max)(blockFrames, 64);
+	//one block is read while the others play.
+	m_blockCount = (std::max)(blockCount, 2);
+}
+
+bool CAudioFileReader::Open(const std::string& path, const AudioFileFormat* rawFormat)
+{
+	Close();
+	ReadFunction read;
+	uint64_t size = 0;
+	if (!OpenFileSource(path, read, size))
+		return false;
+	return Open(read, size, rawFormat);
+}
+
+bool CAudioFileReader::Open(ReadFunction read, uint64_t size, const AudioFileFormat* rawFormat)
+{
+	Close();
+	if (!read)
+		return false;
+	m_read = read;
+	m_size = size;
+	if (!ParseHeader(rawFormat) || m_frames <= 0) {
+		Close();
+		return false;
+	}
+
+	m_blocks.assign(m_blockCount, Block());
+	for (auto& block : m_blocks)
+		block.samples.resize((size_t)m_blockFrames * m_format.channels);
+	m_raw.resize((size_t)m_blockFrames * m_format.GetBytesPerFrame());
+	m_stats = AudioFileReaderStats();
+	m_stop = false;
+	Restart(0);
+	m_worker = std::thread(&CAudioFileReader::WorkerThread, this);
+	return true;
+}
+
+bool CAudioFileReader::ParseHeader(const AudioFileFormat* rawFormat)
+{
+	uint8_t header[40];
+	bool wave = m_size >= 12 && m_read(0, header, 12) == 12
+		&& memcmp(header, "RIFF", 4) == 0 && memcmp(header + 8, "WAVE", 4) == 0;
+	uint64_t dataBytes = 0;
+	if (wave) {
+		uint16_t format = 0, bits = 0;
+		bool haveFormat = false, haveData = false;
+		uint64_t pos = 12;
+		while (pos + 8 <= m_size && !haveData) {
+			if (m_read(pos, header, 8) != 8)
+				return false;
+			uint64_t size = ReadLE32(header + 4);
+			uint64_t body = pos + 8;
+			if (memcmp(header, "fmt ", 4) == 0 && size >= 16) {
+				size_t length = (size_t)(std::min)(size, (uint64_t)sizeof(header));
+				if (m_read(body, header, length) != length)
+					return false;
+				format = ReadLE16(header);
+				m_format.channels = ReadLE16(header + 2);
+				m_format.sampleRate = (int)ReadLE32(header + 4);
+				bits = ReadLE16(header + 14);
+				//the sub format GUID starts with the plain format tag.
+				if (format == kWaveFormatExtensible && length >= 26)
+					format = ReadLE16(header + 24);
+				haveFormat = true;
+			}
+			else if (memcmp(header, "data", 4) == 0) {
+				m_dataOffset = body;
+				//writers that stream often leave the size at 0 or too large.
+				dataBytes = size == 0 || body + size > m_size ? m_size - body : size;
+				haveData = true;
+			}
+			pos = body + size + (size & 1);
+		}
+		if (!haveFormat || !haveData)
+			return false;
+		if (format == kWaveFormatPcm && bits == 8)
+			m_format.sampleFormat = AUDIO_SAMPLE_PCM8;
+		else if (format == kWaveFormatPcm && bits == 16)
+			m_format.sampleFormat = AUDIO_SAMPLE_PCM16;
+		else if (format == kWaveFormatPcm && bits == 24)
+			m_format.sampleFormat = AUDIO_SAMPLE_PCM24;
+		else if (format == kWaveFormatPcm && bits == 32)
+			m_format.sampleFormat = AUDIO_SAMPLE_PCM32;
+		else if (format == kWaveFormatFloat && bits == 32)
+			m_format.sampleFormat = AUDIO_SAMPLE_FLOAT32;
+		else
+			return false;
+	}
+	else if (rawFormat) {
+		m_format = *rawFormat;
+		m_dataOffset = 0;
+		dataBytes = m_size;
+	}
+	else
+		return false;
+	if (m_format.sampleRate <= 0 || m_format.channels <= 0)
+		return false;
+	m_frames = (int64_t)(dataBytes / m_format.GetBytesPerFrame());
+	return true;
+}
+
+void CAudioFileReader::Close()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_space.notify_all();
+	m_decoded.notify_all();
+	if (m_worker.joinable())
+		m_worker.join();
+	m_read = nullptr;
+	m_size = 0;
+	m_format = AudioFileFormat();
+	m_dataOffset = 0;
+	m_frames = 0;
+	m_blocks.clear();
+	m_raw.clear();
+	m_filled = 0;
+}
+
+void CAudioFileReader::SetLoop(bool loop, int64_t startFrame, int64_t endFrame)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	int64_t position = GetPositionLocked();
+	m_loop = loop;
+	m_loopStart = startFrame;
+	m_loopEnd = endFrame;
+	//blocks read ahead may already have wrapped, or stopped, the old way.
+	if (!m_blocks.empty())
+		Restart(position);
+}
+
+void CAudioFileReader::Seek(int64_t frame)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_blocks.empty())
+		return;
+	++m_stats.seeks;
+	Restart(frame);
+}
+
+void CAudioFileReader::Restart(int64_t frame)
+{
+	m_readBlock = 0;
+	m_readOffset = 0;
+	m_writeBlock = 0;
+	m_filled = 0;
+	m_decodePosition = (std::max)((int64_t)0, (std::min)(frame, m_frames));
+	++m_generation;
+	m_endOfFile = false;
+	m_finished = false;
+	m_space.notify_one();
+}
+
+void CAudioFileReader::GetLoopRange(int64_t& start, int64_t& end) const
+{
+	end = m_loopEnd < 0 || m_loopEnd > m_frames ? m_frames : m_loopEnd;
+	start = (std::max)((int64_t)0, m_loopStart);
+	if (start >= end) {
+		start = 0;
+		end = m_frames;
+	}
+}
+
+int64_t CAudioFileReader::GetPosition() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return GetPositionLocked();
+}
+
+int64_t CAudioFileReader::GetPositionLocked() const
+{
+	if (m_filled == 0) {
+		int64_t start, end;
+		GetLoopRange(start, end);
+		return m_loop && m_decodePosition >= end ? start : m_decodePosition;
+	}
+	const Block& block = m_blocks[m_readBlock];
+	auto segment = block.segments.rbegin();
+	while (segment + 1 != block.segments.rend() && segment->first > m_readOffset)
+		++segment;
+	return segment->second + (m_readOffset - segment->first);
+}
+
+int64_t CAudioFileReader::GetBufferedLocked() const
+{
+	int64_t frames = -m_readOffset;
+	for (int i = 0; i < m_filled; ++i)
+		frames += m_blocks[(m_readBlock + i) % m_blockCount].frames;
+	return frames;
+}
+
+int CAudioFileReader::Read(int16_t* out, int frames)
+{
+	if (!out || frames <= 0)
+		return 0;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	int channels = m_format.channels;
+	int copied = 0;
+	while (copied < frames && m_filled > 0) {
+		Block& block = m_blocks[m_readBlock];
+		int run = (std::min)(block.frames - m_readOffset, frames - copied);
+		memcpy(out + (size_t)copied * channels, block.samples.data() + (size_t)m_readOffset * channels,
+			(size_t)run * channels * sizeof(int16_t));
+		copied += run;
+		m_readOffset += run;
+		if (m_readOffset >= block.frames) {
+			m_readOffset = 0;
+			m_readBlock = (m_readBlock + 1) % m_blockCount;
+			--m_filled;
+			m_space.notify_one();
+		}
+	}
+	if (m_filled == 0 && m_endOfFile)
+		m_finished = true;
+	if (copied < frames) {
+		memset(out + (size_t)copied * channels, 0, (size_t)(frames - copied) * channels * sizeof(int16_t));
+		if (!m_finished && channels > 0) {
+			++m_stats.underruns;
+			m_stats.underrunFrames += frames - copied;
+		}
+	}
+	return copied;
+}
+
+bool CAudioFileReader::IsFinished() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_finished;
+}
+
+bool CAudioFileReader::WaitBuffered(int64_t frames, int timeoutMs)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	frames = (std::min)(frames, (int64_t)m_blockFrames * (m_blockCount - 1));
+	return m_decoded.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this, frames] {
+		return m_stop || m_endOfFile || GetBufferedLocked() >= frames;
+	}) && !m_stop;
+}
+
+AudioFileReaderStats CAudioFileReader::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	AudioFileReaderStats stats = m_stats;
+	stats.bufferedFrames = m_blocks.empty() ? 0 : GetBufferedLocked();
+	return stats;
+}
+
+bool CAudioFileReader::Decode(Block& block, int64_t& position, bool loop, int64_t loopStart, int64_t loopEnd, AudioFileReaderStats& io)
+{
+	const int channels = m_format.channels;
+	const int frameBytes = m_format.GetBytesPerFrame();
+	const int64_t end = loop ? loopEnd : m_frames;
+	block.frames = 0;
+	block.segments.clear();
+	while (block.frames < m_blockFrames) {
+		if (position >= end) {
+			if (!loop)
+				return false;
+			position = loopStart;
+			++io.loops;
+			block.segments.emplace_back(block.frames, position);
+		}
+		if (block.segments.empty())
+			block.segments.emplace_back(0, position);
+		int run = (int)(std::min)((int64_t)(m_blockFrames - block.frames), end - position);
+		int64_t start = NowNs();
+		size_t bytes = m_read(m_dataOffset + (uint64_t)position * frameBytes, m_raw.data(), (size_t)run * frameBytes);
+		int64_t elapsed = NowNs() - start;
+		++io.reads;
+		io.bytesRead += bytes;
+		io.readNsTotal += elapsed;
+		io.readNsMax = (std::max)(io.readNsMax, elapsed);
+
+		int got = (int)(bytes / frameBytes);
+		ConvertSamples(m_raw.data(), m_format.sampleFormat, (size_t)got * channels,
+			block.samples.data() + (size_t)block.frames * channels);
+		block.frames += got;
+		position += got;
+		//a truncated file or a failing source ends the stream instead of
+		//looping over a hole.
+		if (got < run)
+			return false;
+	}
+	return true;
+}
+
+void CAudioFileReader::WorkerThread()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true) {
+		m_space.wait(lock, [this] { return m_stop || (!m_endOfFile && m_filled < m_blockCount); });
+		if (m_stop)
+			break;
+		uint64_t generation = m_generation;
+		Block& block = m_blocks[m_writeBlock];
+		int64_t position = m_decodePosition;
+		bool loop = m_loop;
+		int64_t loopStart, loopEnd;
+		GetLoopRange(loopStart, loopEnd);
+		lock.unlock();
+
+		AudioFileReaderStats io;
+		bool more = Decode(block, position, loop, loopStart, loopEnd, io);
+
+		lock.lock();
+		m_stats.reads += io.reads;
+		m_stats.bytesRead += io.bytesRead;
+		m_stats.readNsTotal += io.readNsTotal;
+		m_stats.readNsMax = (std::max)(m_stats.readNsMax, io.readNsMax);
+		//a Seek while reading, the block is from the old position.
+		if (generation != m_generation)
+			continue;
+		m_stats.loops += io.loops;
+		if (block.frames > 0) {
+			m_writeBlock = (m_writeBlock + 1) % m_blockCount;
+			++m_filled;
+		}
+		m_decodePosition = position;
+		m_endOfFile = !more;
+		m_decoded.notify_all();
+	}
+}
@@ -0,0 +1,159 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+enum AudioSampleFormat {
+	//unsigned.
+	AUDIO_SAMPLE_PCM8 = 0,
+	AUDIO_SAMPLE_PCM16,
+	AUDIO_SAMPLE_PCM24,
+	AUDIO_SAMPLE_PCM32,
+	AUDIO_SAMPLE_FLOAT32,
+};
+
+//layout of the samples in a file, always interleaved little endian.
+struct AudioFileFormat {
+	int sampleRate = 0;
+	int channels = 0;
+	AudioSampleFormat sampleFormat = AUDIO_SAMPLE_PCM16;
+
+	int GetBytesPerSample() const;
+	int GetBytesPerFrame() const { return GetBytesPerSample() * channels; }
+};
+
+struct AudioFileReaderStats {
+	//source reads of the read-ahead thread.
+	uint64_t reads = 0;
+	uint64_t bytesRead = 0;
+	int64_t readNsTotal = 0;
+	int64_t readNsMax = 0;
+	//Read calls that found the ring empty before the end of the file, and
+	//the frames of silence they returned.
+	uint64_t underruns = 0;
+	uint64_t underrunFrames = 0;
+	uint64_t loops = 0;
+	uint64_t seeks = 0;
+	//decoded frames waiting in the ring.
+	int64_t bufferedFrames = 0;
+
+	double GetReadMsAverage() const { return reads ? readNsTotal / 1e6 / reads : 0; }
+};
+
+/*
+	Streams a long WAV or headerless PCM file as PCM16 without loading it.
+	A read-ahead thread reads and converts the file into a ring of decoded
+	blocks; Read copies from the ring without ever waiting on the disk, so
+	it can run on a real-time thread and a slow read only shows up as an
+	underrun once the whole ring is used up.
+	Seek is sample accurate: the ring is dropped and reading restarts at
+	the exact frame. A loop wraps inside the read-ahead, the first frame of
+	the loop follows the last one in the same block, so there is no gap.
+	The source is a file or any ReadFunction, which is also how throttled
+	or network sources are plugged in.
+*/
+class CAudioFileReader
+{
+public:
+	//reads size bytes at offset of the source, returns the bytes read.
+	typedef std::function<size_t(uint64_t offset, void* data, size_t size)> ReadFunction;
+
+	enum {
+		DEFAULT_BLOCK_FRAMES = 4096,
+		DEFAULT_BLOCK_COUNT = 16,
+	};
+
+	CAudioFileReader();
+	~CAudioFileReader();
+
+	//size of the ring, takes effect with the next Open.
+	void SetReadAhead(int blockFrames, int blockCount);
+	//path is UTF-8. a RIFF/WAVE file describes its format, anything else is
+	//headerless PCM in rawFormat and fails to open without it.
+	bool Open(const std::string& path, const AudioFileFormat* rawFormat = nullptr);
+	//reads the size bytes of a file through read instead.
+	bool Open(ReadFunction read, uint64_t size, const AudioFileFormat* rawFormat = nullptr);
+	void Close();
+	bool IsOpen() const { return m_worker.joinable(); }
+
+	//format of the file; Read always returns PCM16 with its rate and channels.
+	const AudioFileFormat& GetFormat() const { return m_format; }
+	int64_t GetFrames() const { return m_frames; }
+
+	//loop frames [startFrame, endFrame), endFrame -1 for the end of the file.
+	void SetLoop(bool loop, int64_t startFrame = 0, int64_t endFrame = -1);
+	//the next Read starts exactly at frame.
+	void Seek(int64_t frame);
+	//the frame the next Read returns first.
+	int64_t GetPosition() const;
+
+	//copies up to frames interleaved PCM16 frames, fills the rest of out with
+	//silence and returns the frames copied. never blocks.
+	int Read(int16_t* out, int frames);
+	//a reader that does not loop returned the last frame.
+	bool IsFinished() const;
+	//waits up to timeoutMs until frames are buffered or the file ends, to
+	//start without an underrun.
+	bool WaitBuffered(int64_t frames, int timeoutMs);
+
+	AudioFileReaderStats GetStats() const;
+
+private:
+	struct Block {
+		std::vector<int16_t> samples;
+		int frames = 0;
+		//file frame of the block's frame offset, one per loop wrap inside it.
+		std::vector<std::pair<int, int64_t>> segments;
+	};
+
+	bool ParseHeader(const AudioFileFormat* rawFormat);
+	//the helpers below expect m_mutex to be held.
+	//drops the ring and continues reading at frame.
+	void Restart(int64_t frame);
+	//the loop range clamped to the file.
+	void GetLoopRange(int64_t& start, int64_t& end) const;
+	int64_t GetPositionLocked() const;
+	int64_t GetBufferedLocked() const;
+	//fills block from position, returns false at the end of the file. the
+	//reads are counted in io.
+	bool Decode(Block& block, int64_t& position, bool loop, int64_t loopStart, int64_t loopEnd, AudioFileReaderStats& io);
+	void WorkerThread();
+
+	ReadFunction m_read;
+	uint64_t m_size = 0;
+	AudioFileFormat m_format;
+	uint64_t m_dataOffset = 0;
+	int64_t m_frames = 0;
+	int m_blockFrames = DEFAULT_BLOCK_FRAMES;
+	int m_blockCount = DEFAULT_BLOCK_COUNT;
+	//raw bytes of one read, only touched by the worker.
+	std::vector<uint8_t> m_raw;
+
+	mutable std::mutex m_mutex;
+	//the worker waits for a free block, WaitBuffered for a decoded one.
+	std::condition_variable m_space;
+	std::condition_variable m_decoded;
+	std::vector<Block> m_blocks;
+	int m_readBlock = 0;
+	int m_readOffset = 0;
+	int m_writeBlock = 0;
+	int m_filled = 0;
+	//file frame the worker continues at.
+	int64_t m_decodePosition = 0;
+	//bumped by every Seek, blocks decoded before it are dropped.
+	uint64_t m_generation = 0;
+	bool m_loop = false;
+	int64_t m_loopStart = 0;
+	int64_t m_loopEnd = -1;
+	//the worker decoded the last frame / Read returned it.
+	bool m_endOfFile = false;
+	bool m_finished = false;
+	bool m_stop = false;
+	AudioFileReaderStats m_stats;
+	std::thread m_worker;
+};
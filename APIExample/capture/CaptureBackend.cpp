@@ -0,0 +1,87 @@
+#include "CaptureBackend.h"
+#include "FileCaptureBackend.h"
+#include <chrono>
+#include <stdio.h>
+#ifdef _WIN32
+#include "DShowCaptureBackend.h"
+#endif
+#ifdef __linux__
+#include "V4L2CaptureBackend.h"
+#endif
+
+std::unique_ptr<ICaptureBackend> CreateCaptureBackend(CAPTURE_BACKEND_TYPE type)
+{
+	switch (type) {
+	case CAPTURE_BACKEND_FILE:
+		return std::unique_ptr<ICaptureBackend>(new CFileCaptureBackend);
+#ifdef _WIN32
+	case CAPTURE_BACKEND_DSHOW:
+		return std::unique_ptr<ICaptureBackend>(new CDShowCaptureBackend);
+#endif
+#ifdef __linux__
+	case CAPTURE_BACKEND_V4L2:
+		return std::unique_ptr<ICaptureBackend>(new CV4L2CaptureBackend);
+#endif
+	default:
+		return nullptr;
+	}
+}
+
+bool GetCaptureDeviceFormats(CAPTURE_BACKEND_TYPE type, int device, std::vector<CaptureFormat>& formats)
+{
+	formats.clear();
+	std::unique_ptr<ICaptureBackend> backend = CreateCaptureBackend(type);
+	std::vector<CaptureDeviceInfo> devices;
+	if (!backend || !backend->EnumDevices(devices) || device < 0 || device >= (int)devices.size())
+		return false;
+	return backend->GetFormats(device, formats);
+}
+
+int64_t CaptureClockUs()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+size_t GetCaptureFrameSize(const CaptureFormat& format)
+{
+	size_t pixels = (size_t)format.width * format.height;
+	switch (format.fourcc) {
+	case CAPTURE_FOURCC_I420:
+	case CAPTURE_FOURCC_NV12:
+		return pixels * 3 / 2;
+	case CAPTURE_FOURCC_YUY2:
+	case CAPTURE_FOURCC_UYVY:
+		return pixels * 2;
+	case CAPTURE_FOURCC_BGR24:
+		return pixels * 3;
+	case CAPTURE_FOURCC_RGBA:
+		return pixels * 4;
+	default:
+		return 0;
+	}
+}
+
+bool IsSameCaptureFormat(const CaptureFormat& a, const CaptureFormat& b)
+{
+	if (a.media != b.media || a.fourcc != b.fourcc)
+		return false;
+	if (a.media == CAPTURE_MEDIA_AUDIO)
+		return a.sampleRate == b.sampleRate && a.channels == b.channels;
+	return a.width == b.width && a.height == b.height && a.fps == b.fps;
+}
+
+std::string DescribeCaptureFormat(const CaptureFormat& format)
+{
+	char fourcc[5] = { 0 };
+	for (int i = 0; i < 4; ++i) {
+		char c = (char)(format.fourcc >> (i * 8));
+		fourcc[i] = c >= 32 && c < 127 ? c : '?';
+	}
+	char text[64];
+	if (format.media == CAPTURE_MEDIA_AUDIO)
+		snprintf(text, sizeof(text), "%s %dHz %dch", fourcc, format.sampleRate, format.channels);
+	else
+		snprintf(text, sizeof(text), "%s %dx%d@%d", fourcc, format.width, format.height, format.fps);
+	return text;
+}
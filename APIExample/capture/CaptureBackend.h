@@ -0,0 +1,111 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#define CAPTURE_FOURCC(a, b, c, d) \
+	((uint32_t)(uint8_t)(a) | ((uint32_t)(uint8_t)(b) << 8) | ((uint32_t)(uint8_t)(c) << 16) | ((uint32_t)(uint8_t)(d) << 24))
+
+//pixel and sample formats, the DirectShow fourcc where there is one.
+//backends map their own codes to these.
+enum : uint32_t {
+	CAPTURE_FOURCC_I420 = CAPTURE_FOURCC('I', '4', '2', '0'),
+	CAPTURE_FOURCC_NV12 = CAPTURE_FOURCC('N', 'V', '1', '2'),
+	CAPTURE_FOURCC_YUY2 = CAPTURE_FOURCC('Y', 'U', 'Y', '2'),
+	CAPTURE_FOURCC_UYVY = CAPTURE_FOURCC('U', 'Y', 'V', 'Y'),
+	CAPTURE_FOURCC_MJPG = CAPTURE_FOURCC('M', 'J', 'P', 'G'),
+	//packed B, G, R. DirectShow RGB24 is bottom-up.
+	CAPTURE_FOURCC_BGR24 = CAPTURE_FOURCC('B', 'G', 'R', '3'),
+	CAPTURE_FOURCC_RGBA = CAPTURE_FOURCC('R', 'G', 'B', 'A'),
+	//interleaved 16 bit little endian PCM.
+	CAPTURE_FOURCC_PCM16 = CAPTURE_FOURCC('S', '1', '6', 'L'),
+};
+
+enum CAPTURE_MEDIA {
+	CAPTURE_MEDIA_VIDEO,
+	CAPTURE_MEDIA_AUDIO,
+};
+
+enum CAPTURE_BACKEND_TYPE {
+	CAPTURE_BACKEND_DSHOW,
+	CAPTURE_BACKEND_V4L2,
+	CAPTURE_BACKEND_FILE,
+};
+
+struct CaptureDeviceInfo {
+	//backend specific: device path, file path.
+	std::string id;
+	//UTF-8, for display.
+	std::string name;
+	CAPTURE_MEDIA media = CAPTURE_MEDIA_VIDEO;
+};
+
+struct CaptureFormat {
+	CAPTURE_MEDIA media = CAPTURE_MEDIA_VIDEO;
+	uint32_t fourcc = 0;
+	//video
+	int width = 0;
+	int height = 0;
+	int fps = 0;
+	//audio
+	int sampleRate = 0;
+	int channels = 0;
+};
+
+//a captured frame as the device delivered it. data points into the
+//backend's own buffer and is only valid during the callback.
+struct CaptureFrame {
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+	const CaptureFormat* format = nullptr;
+	//capture time on the CaptureClockUs clock.
+	int64_t timestampUs = 0;
+	//frame number from the device where it numbers its frames, gaps mean
+	//the device dropped frames. otherwise counts delivered frames from Start.
+	uint64_t sequence = 0;
+};
+
+/*
+	One way of getting frames out of capture devices. Usage:
+		EnumDevices -> GetFormats(device) -> Open(device, format)
+		-> Start(callback) ... Stop -> Close
+	Frames are handed to the callback on the backend's capture thread in
+	the opened format without any conversion or copy; the callback has to
+	be done with the data before it returns.
+*/
+class ICaptureBackend
+{
+public:
+	typedef std::function<void(const CaptureFrame& frame)> FrameCallback;
+
+	virtual ~ICaptureBackend() {}
+
+	virtual const char* GetName() const = 0;
+	virtual bool EnumDevices(std::vector<CaptureDeviceInfo>& devices) = 0;
+	//formats the device offers, in the order the device lists them.
+	virtual bool GetFormats(int device, std::vector<CaptureFormat>& formats) = 0;
+	//format must be one of GetFormats.
+	virtual bool Open(int device, const CaptureFormat& format) = 0;
+	virtual void Close() = 0;
+	virtual bool Start(FrameCallback callback) = 0;
+	//returns after the last callback has returned.
+	virtual void Stop() = 0;
+	virtual bool IsCapturing() const = 0;
+};
+
+//nullptr if the backend is not available on this platform.
+std::unique_ptr<ICaptureBackend> CreateCaptureBackend(CAPTURE_BACKEND_TYPE type);
+//formats of one device of a backend without opening it for capture,
+//false when the backend or the device is missing.
+bool GetCaptureDeviceFormats(CAPTURE_BACKEND_TYPE type, int device, std::vector<CaptureFormat>& formats);
+
+//monotonic microseconds, the clock of CaptureFrame::timestampUs.
+int64_t CaptureClockUs();
+//bytes of one frame of a raw format, 0 for compressed formats.
+size_t GetCaptureFrameSize(const CaptureFormat& format);
+bool IsSameCaptureFormat(const CaptureFormat& a, const CaptureFormat& b);
+//"I420 1280x720@30", "S16L 48000Hz 2ch".
+std::string DescribeCaptureFormat(const CaptureFormat& format);
@@ -0,0 +1,75 @@
+#define HAVE_JPEG
+
+#include "CaptureConverter.h"
+#include <string.h>
+#include "libyuv.h"
+#include "trace/Trace.h"
+
+bool CanConvertCaptureFormat(uint32_t fourcc)
+{
+	switch (fourcc) {
+	case CAPTURE_FOURCC_I420:
+	case CAPTURE_FOURCC_NV12:
+	case CAPTURE_FOURCC_YUY2:
+	case CAPTURE_FOURCC_UYVY:
+	case CAPTURE_FOURCC_MJPG:
+	case CAPTURE_FOURCC_BGR24:
+	case CAPTURE_FOURCC_RGBA:
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool IsNativeCaptureFormat(uint32_t fourcc)
+{
+	return fourcc == CAPTURE_FOURCC_I420 || fourcc == CAPTURE_FOURCC_NV12;
+}
+
+bool ConvertCaptureFrameToI420(const CaptureFormat& format, const uint8_t* data, size_t size, uint8_t* i420)
+{
+	int width = format.width;
+	int height = format.height;
+	if (format.media != CAPTURE_MEDIA_VIDEO || width <= 0 || height <= 0 || !data || !i420)
+		return false;
+	AG_TRACE_SCOPE2("convert", "ConvertCaptureFrameToI420", "fourcc", format.fourcc, "size", size);
+	size_t frameSize = GetCaptureFrameSize(format);
+	//raw formats have to deliver whole frames, MJPG is checked by the decoder.
+	if (format.fourcc != CAPTURE_FOURCC_MJPG && size < frameSize)
+		return false;
+
+	uint8_t* y = i420;
+	uint8_t* u = y + width * height;
+	uint8_t* v = u + (width / 2) * (height / 2);
+	int ret = -1;
+	switch (format.fourcc) {
+	case CAPTURE_FOURCC_I420:
+		memcpy(i420, data, frameSize);
+		ret = 0;
+		break;
+	case CAPTURE_FOURCC_NV12:
+		ret = libyuv::NV12ToI420(data, width, data + width * height, width,
+			y, width, u, width / 2, v, width / 2, width, height);
+		break;
+	case CAPTURE_FOURCC_YUY2:
+		ret = libyuv::YUY2ToI420(data, width * 2, y, width, u, width / 2, v, width / 2, width, height);
+		break;
+	case CAPTURE_FOURCC_UYVY:
+		ret = libyuv::UYVYToI420(data, width * 2, y, width, u, width / 2, v, width / 2, width, height);
+		break;
+	case CAPTURE_FOURCC_BGR24:
+		ret = libyuv::RGB24ToI420(data, width * 3, y, width, u, width / 2, v, width / 2, width, height);
+		break;
+	case CAPTURE_FOURCC_RGBA:
+		//libyuv names formats by the little endian word, R G B A bytes are ABGR.
+		ret = libyuv::ABGRToI420(data, width * 4, y, width, u, width / 2, v, width / 2, width, height);
+		break;
+	case CAPTURE_FOURCC_MJPG:
+		ret = libyuv::MJPGToI420(data, size, y, width, u, width / 2, v, width / 2,
+			width, height, width, height);
+		break;
+	default:
+		break;
+	}
+	return ret == 0;
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include "CaptureBackend.h"
+
+//whether ConvertCaptureFrameToI420 handles the format.
+bool CanConvertCaptureFormat(uint32_t fourcc);
+//formats the encoder takes without a conversion pass, I420 is copied and
+//NV12 only has its chroma deinterleaved.
+bool IsNativeCaptureFormat(uint32_t fourcc);
+
+//converts one captured video frame into tightly packed I420 of the same
+//size, i420 has width * height * 3 / 2 bytes. BGR24 is read top-down.
+bool ConvertCaptureFrameToI420(const CaptureFormat& format, const uint8_t* data, size_t size, uint8_t* i420);
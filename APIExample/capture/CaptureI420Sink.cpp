@@ -0,0 +1,62 @@
+#include "CaptureI420Sink.h"
+#include "CaptureConverter.h"
+#include "trace/Trace.h"
+
+CCaptureI420Sink::CCaptureI420Sink()
+{
+}
+
+CCaptureI420Sink::~CCaptureI420Sink()
+{
+	Stop();
+}
+
+bool CCaptureI420Sink::Start(const CaptureFormat& format, FrameCallback callback)
+{
+	if (format.media != CAPTURE_MEDIA_VIDEO || !CanConvertCaptureFormat(format.fourcc) || !callback)
+		return false;
+	Stop();
+	m_format = format;
+	m_callback = callback;
+	m_convertFrames = 0;
+	m_convertNs = 0;
+	if (format.fourcc == CAPTURE_FOURCC_MJPG) {
+		return m_mjpegPipeline.Start(format.width, format.height, [this](const MjpegDecodedFrame& frame) {
+			m_convertNs += frame.decodeNs;
+			++m_convertFrames;
+			m_callback(frame.data, frame.size, frame.timestampUs, frame.flowId);
+		});
+	}
+	m_i420.resize((size_t)format.width * format.height * 3 / 2);
+	return true;
+}
+
+void CCaptureI420Sink::Stop()
+{
+	m_mjpegPipeline.Stop();
+	m_callback = nullptr;
+}
+
+void CCaptureI420Sink::Push(const CaptureFrame& frame)
+{
+	if (!m_callback)
+		return;
+	AG_TRACE_FLOW_BEGIN("frame", "video frame", frame.sequence);
+	if (m_mjpegPipeline.IsRunning()) {
+		//dropped when every decoder is busy, the capture thread must not wait.
+		m_mjpegPipeline.Submit(frame.data, frame.size, frame.timestampUs, frame.sequence);
+		return;
+	}
+	int64_t begin = CaptureClockUs();
+	if (!ConvertCaptureFrameToI420(m_format, frame.data, frame.size, m_i420.data()))
+		return;
+	m_convertNs += (CaptureClockUs() - begin) * 1000;
+	++m_convertFrames;
+	m_callback(m_i420.data(), m_i420.size(), frame.timestampUs, frame.sequence);
+}
+
+void CCaptureI420Sink::GetConvertStats(long long* frames, long long* ns) const
+{
+	*frames = m_convertFrames;
+	*ns = m_convertNs;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include "CaptureBackend.h"
+#include "MjpegDecodePipeline.h"
+#include <atomic>
+#include <functional>
+#include <vector>
+
+/*
+	Turns the frames an ICaptureBackend delivers into I420 for the scenes
+	that push external video. Raw formats are converted on the backend's
+	capture thread; MJPG is handed to a CMjpegDecodePipeline so the capture
+	thread only copies the sample. Push is the backend's frame callback.
+*/
+class CCaptureI420Sink
+{
+public:
+	//tightly packed I420 of the started size, only valid during the call.
+	//timestampUs and sequence are those of the frame it was made from, the
+	//sequence is the frame's flow id in the trace.
+	typedef std::function<void(const uint8_t* i420, size_t size, int64_t timestampUs, uint64_t sequence)> FrameCallback;
+
+	CCaptureI420Sink();
+	~CCaptureI420Sink();
+
+	bool Start(const CaptureFormat& format, FrameCallback callback);
+	//call after the backend stopped, returns after the last callback.
+	void Stop();
+	//on the backend's capture thread.
+	void Push(const CaptureFrame& frame);
+
+	//frames converted since Start and the time that took.
+	void GetConvertStats(long long* frames, long long* ns) const;
+
+private:
+	CaptureFormat m_format;
+	FrameCallback m_callback;
+	std::vector<uint8_t> m_i420;
+	CMjpegDecodePipeline m_mjpegPipeline;
+	std::atomic<long long> m_convertFrames{ 0 };
+	std::atomic<long long> m_convertNs{ 0 };
+};
@@ -0,0 +1,268 @@
+#include "CaptureNegotiator.h"
+#include "CaptureConverter.h"
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace {
+	//live conversions keep moving the cost, a new sample weighs at least this.
+	const double MIN_UPDATE_WEIGHT = 0.05;
+
+	FILE* OpenCostFile(const std::string& path, bool write)
+	{
+#ifdef _WIN32
+		int len = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, NULL, 0);
+		if (len <= 0)
+			return NULL;
+		std::wstring wide(len, L'\0');
+		MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &wide[0], len);
+		FILE* file = NULL;
+		if (_wfopen_s(&file, wide.c_str(), write ? L"w" : L"r") != 0)
+			return NULL;
+		return file;
+#else
+		return fopen(path.c_str(), write ? "w" : "r");
+#endif
+	}
+
+	void FillSyntheticFrame(std::vector<uint8_t>& frame)
+	{
+		//a ramp with some noise so no converter gets to skip work.
+		uint32_t seed = 0x12345678;
+		for (size_t i = 0; i < frame.size(); ++i) {
+			seed = seed * 1664525 + 1013904223;
+			frame[i] = (uint8_t)((i & 0xff) ^ (seed >> 28));
+		}
+	}
+}
+
+const double CCaptureNegotiator::MJPG_BYTES_PER_PIXEL = 0.25;
+
+CCaptureCostModel::CCaptureCostModel()
+{
+}
+
+double CCaptureCostModel::GetEstimatedNsPerPixel(uint32_t fourcc)
+{
+	//libyuv SIMD paths on a desktop core.
+	switch (fourcc) {
+	case CAPTURE_FOURCC_I420:
+		return 0.15;
+	case CAPTURE_FOURCC_NV12:
+		return 0.25;
+	case CAPTURE_FOURCC_YUY2:
+	case CAPTURE_FOURCC_UYVY:
+		return 0.35;
+	case CAPTURE_FOURCC_RGBA:
+		return 0.8;
+	case CAPTURE_FOURCC_BGR24:
+		return 0.9;
+	case CAPTURE_FOURCC_MJPG:
+		return 4.0;
+	default:
+		return 10.0;
+	}
+}
+
+double CCaptureCostModel::GetNsPerPixel(uint32_t fourcc, bool* measured) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_costs.find(fourcc);
+	bool found = it != m_costs.end() && it->second.samples > 0;
+	if (measured)
+		*measured = found;
+	return found ? it->second.nsPerPixel : GetEstimatedNsPerPixel(fourcc);
+}
+
+bool CCaptureCostModel::IsMeasured(uint32_t fourcc) const
+{
+	bool measured = false;
+	GetNsPerPixel(fourcc, &measured);
+	return measured;
+}
+
+bool CCaptureCostModel::Measure(uint32_t fourcc)
+{
+	if (fourcc == CAPTURE_FOURCC_MJPG || !CanConvertCaptureFormat(fourcc))
+		return false;
+	CaptureFormat format;
+	format.fourcc = fourcc;
+	format.width = MEASURE_WIDTH;
+	format.height = MEASURE_HEIGHT;
+	format.fps = 30;
+	std::vector<uint8_t> frame(GetCaptureFrameSize(format));
+	std::vector<uint8_t> i420(MEASURE_WIDTH * MEASURE_HEIGHT * 3 / 2);
+	FillSyntheticFrame(frame);
+	//the first pass pays for page faults and cold caches.
+	if (!ConvertCaptureFrameToI420(format, frame.data(), frame.size(), i420.data()))
+		return false;
+
+	std::vector<int64_t> times;
+	for (int i = 0; i < MEASURE_FRAMES; ++i) {
+		auto begin = std::chrono::steady_clock::now();
+		ConvertCaptureFrameToI420(format, frame.data(), frame.size(), i420.data());
+		auto end = std::chrono::steady_clock::now();
+		times.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+	}
+	//the median, a preempted pass would skew the mean.
+	std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+	double nsPerPixel = (double)times[times.size() / 2] / (MEASURE_WIDTH * MEASURE_HEIGHT);
+	Update(fourcc, nsPerPixel, MEASURE_FRAMES);
+	return true;
+}
+
+void CCaptureCostModel::Report(uint32_t fourcc, int64_t pixels, int64_t ns, int64_t frames)
+{
+	if (pixels <= 0 || ns <= 0 || frames <= 0)
+		return;
+	Update(fourcc, (double)ns / ((double)pixels * frames), frames);
+}
+
+void CCaptureCostModel::Update(uint32_t fourcc, double nsPerPixel, int64_t samples)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Cost& cost = m_costs[fourcc];
+	if (cost.samples <= 0) {
+		cost.nsPerPixel = nsPerPixel;
+		cost.samples = samples;
+		return;
+	}
+	//an average over the first samples, then a moving one so the table
+	//follows the machine's current state.
+	double weight = std::max(MIN_UPDATE_WEIGHT, (double)samples / (cost.samples + samples));
+	cost.nsPerPixel += (nsPerPixel - cost.nsPerPixel) * weight;
+	cost.samples += samples;
+}
+
+bool CCaptureCostModel::Load(const std::string& path)
+{
+	FILE* file = OpenCostFile(path, false);
+	if (!file)
+		return false;
+	char line[128];
+	while (fgets(line, sizeof(line), file)) {
+		char name[5] = { 0 };
+		double nsPerPixel = 0;
+		long long samples = 0;
+		if (line[0] == '#' || sscanf(line, "%4s %lf %lld", name, &nsPerPixel, &samples) != 3)
+			continue;
+		if (strlen(name) != 4 || nsPerPixel <= 0 || samples <= 0)
+			continue;
+		uint32_t fourcc = CAPTURE_FOURCC(name[0], name[1], name[2], name[3]);
+		std::lock_guard<std::mutex> lock(m_mutex);
+		Cost& cost = m_costs[fourcc];
+		cost.nsPerPixel = nsPerPixel;
+		cost.samples = samples;
+	}
+	fclose(file);
+	return true;
+}
+
+bool CCaptureCostModel::Save(const std::string& path) const
+{
+	FILE* file = OpenCostFile(path, true);
+	if (!file)
+		return false;
+	fprintf(file, "#fourcc ns/pixel samples, conversion into I420 on this machine\n");
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (auto& it : m_costs) {
+			if (it.second.samples <= 0)
+				continue;
+			CaptureFormat format;
+			format.fourcc = it.first;
+			std::string name = DescribeCaptureFormat(format).substr(0, 4);
+			fprintf(file, "%s %.4f %lld\n", name.c_str(), it.second.nsPerPixel, (long long)it.second.samples);
+		}
+	}
+	bool ok = ferror(file) == 0;
+	fclose(file);
+	return ok;
+}
+
+CCaptureNegotiator::CCaptureNegotiator(CCaptureCostModel& costs)
+	: m_costs(costs)
+{
+}
+
+CaptureFormatPlan CCaptureNegotiator::Score(const CaptureFormat& format, const CaptureRequest& request) const
+{
+	CaptureFormatPlan plan;
+	plan.format = format;
+	plan.native = IsNativeCaptureFormat(format.fourcc);
+	double pixels = (double)format.width * format.height;
+	int fps = format.fps > 0 ? format.fps : request.fps;
+
+	double nsPerPixel = m_costs.GetNsPerPixel(format.fourcc, &plan.costMeasured);
+	plan.convertUsPerFrame = nsPerPixel * pixels / 1000;
+	plan.cpuPercent = plan.convertUsPerFrame * fps / 1e4;
+	if (format.fourcc == CAPTURE_FOURCC_MJPG)
+		plan.bandwidth = pixels * MJPG_BYTES_PER_PIXEL * fps;
+	else
+		plan.bandwidth = (double)GetCaptureFrameSize(format) * fps;
+
+	//short of the request is lost quality, over it is only wasted work,
+	//which the cpu term already charges for.
+	double requested = (double)std::max(request.width, 1) * std::max(request.height, 1);
+	double ratio = pixels / requested;
+	plan.fitPenalty = ratio < 1 ? (1 - ratio) * 4 : (ratio - 1) * 0.25;
+	double aspect = format.height > 0 ? (double)format.width / format.height : 0;
+	double requestedAspect = (double)std::max(request.width, 1) / std::max(request.height, 1);
+	plan.fitPenalty += fabs(aspect - requestedAspect) / requestedAspect;
+	if (request.fps > 0) {
+		if (fps < request.fps)
+			plan.fitPenalty += (double)(request.fps - fps) / request.fps * 3;
+		else
+			plan.fitPenalty += (double)(fps - request.fps) / request.fps * 0.2;
+	}
+
+	double cpuPenalty = plan.cpuPercent / 100 * 2;
+	if (plan.cpuPercent > request.cpuBudgetPercent)
+		cpuPenalty += (plan.cpuPercent - request.cpuBudgetPercent) / 100 * 10;
+	//a device only advertises what its link carries, so going past the
+	//budget is a mild preference for leaving room to other devices.
+	double bandwidthPenalty = 0;
+	if (request.maxBandwidth > 0 && plan.bandwidth > request.maxBandwidth)
+		bandwidthPenalty = (plan.bandwidth / request.maxBandwidth - 1) * 0.5;
+
+	plan.score = plan.fitPenalty + cpuPenalty + bandwidthPenalty;
+	return plan;
+}
+
+CaptureNegotiation CCaptureNegotiator::Negotiate(const std::vector<CaptureFormat>& formats,
+	const CaptureRequest& request, bool measure)
+{
+	CaptureNegotiation negotiation;
+	for (size_t i = 0; i < formats.size(); ++i) {
+		const CaptureFormat& format = formats[i];
+		if (format.media != CAPTURE_MEDIA_VIDEO || format.width <= 0 || format.height <= 0
+			|| !CanConvertCaptureFormat(format.fourcc))
+			continue;
+		if (measure && !m_costs.IsMeasured(format.fourcc))
+			m_costs.Measure(format.fourcc);
+		CaptureFormatPlan plan = Score(format, request);
+		plan.index = (int)i;
+		negotiation.candidates.push_back(plan);
+	}
+	//ties keep the device's order.
+	std::stable_sort(negotiation.candidates.begin(), negotiation.candidates.end(),
+		[](const CaptureFormatPlan& a, const CaptureFormatPlan& b) { return a.score < b.score; });
+	if (!negotiation.candidates.empty()) {
+		negotiation.valid = true;
+		negotiation.chosen = negotiation.candidates.front();
+	}
+	return negotiation;
+}
+
+std::string CCaptureNegotiator::DescribePlan(const CaptureFormatPlan& plan)
+{
+	char text[128];
+	snprintf(text, sizeof(text), " convert %.0fus/frame (%s) cpu %.1f%%",
+		plan.convertUsPerFrame, plan.costMeasured ? "measured" : "estimated", plan.cpuPercent);
+	return DescribeCaptureFormat(plan.format) + text;
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include "CaptureBackend.h"
+#include <map>
+#include <mutex>
+
+/*
+	What converting a capture format into I420 costs on this machine, in
+	nanoseconds per pixel. Raw formats are timed on synthetic frames the
+	first time they are needed; MJPG cannot be synthesized and is learned
+	from the conversions of live frames, which also keep refining the raw
+	formats. Until a format has been timed a built-in estimate stands in.
+	The table is kept in a small text file so it is measured once per
+	machine rather than every time a device is opened.
+*/
+class CCaptureCostModel
+{
+public:
+	enum {
+		MEASURE_WIDTH = 640,
+		MEASURE_HEIGHT = 480,
+		MEASURE_FRAMES = 10,
+	};
+
+	CCaptureCostModel();
+
+	//measured is false while the cost is still the estimate.
+	double GetNsPerPixel(uint32_t fourcc, bool* measured = nullptr) const;
+	bool IsMeasured(uint32_t fourcc) const;
+	//times ConvertCaptureFrameToI420 on synthetic frames. false for formats
+	//that cannot be synthesized or converted.
+	bool Measure(uint32_t fourcc);
+	//frames conversions of pixels each that took ns in total, on live frames.
+	void Report(uint32_t fourcc, int64_t pixels, int64_t ns, int64_t frames = 1);
+
+	//UTF-8 paths. a missing or unreadable file leaves the estimates.
+	bool Load(const std::string& path);
+	bool Save(const std::string& path) const;
+
+	static double GetEstimatedNsPerPixel(uint32_t fourcc);
+
+private:
+	struct Cost {
+		double nsPerPixel = 0;
+		//conversions timed, live and synthetic.
+		int64_t samples = 0;
+	};
+
+	void Update(uint32_t fourcc, double nsPerPixel, int64_t samples);
+
+	mutable std::mutex m_mutex;
+	std::map<uint32_t, Cost> m_costs;
+};
+
+//what the caller wants out of the camera.
+struct CaptureRequest {
+	int width = 1280;
+	int height = 720;
+	int fps = 30;
+	//share of one core the conversion may take before it is penalized.
+	double cpuBudgetPercent = 20;
+	//bytes per second the bus is comfortable with, a USB 2 camera link by
+	//default. 0 for no limit.
+	double maxBandwidth = 35e6;
+};
+
+//one advertised format with the numbers it was scored on; lower scores
+//are better.
+struct CaptureFormatPlan {
+	CaptureFormat format;
+	//position in the list given to Negotiate.
+	int index = -1;
+	double score = 0;
+	bool native = false;
+	//per-frame conversion into I420 and whether that is a measurement or
+	//still the estimate.
+	double convertUsPerFrame = 0;
+	bool costMeasured = false;
+	//conversion load at the format's frame rate, percent of one core.
+	double cpuPercent = 0;
+	//bytes per second over the bus, MJPG estimated.
+	double bandwidth = 0;
+	//how far resolution and frame rate miss the request.
+	double fitPenalty = 0;
+};
+
+struct CaptureNegotiation {
+	bool valid = false;
+	CaptureFormatPlan chosen;
+	//every format that can be converted, best first.
+	std::vector<CaptureFormatPlan> candidates;
+};
+
+/*
+	Picks the capture format that gets closest to the request for the least
+	work. A format's score adds up
+		fit:       falling short of the requested resolution or frame rate
+		           weighs heavily, overshooting only a little
+		cpu:       the cost model's conversion time at the format's rate,
+		           more steeply past the budget
+		bandwidth: bytes per second past what the bus is comfortable with
+	so native I420 / NV12 wins whenever the device offers it at a fitting
+	size, and otherwise the format that is cheapest to decode does.
+*/
+class CCaptureNegotiator
+{
+public:
+	//MJPG frames are about this many bytes per pixel at webcam quality.
+	static const double MJPG_BYTES_PER_PIXEL;
+
+	explicit CCaptureNegotiator(CCaptureCostModel& costs);
+
+	//measures formats that have no measurement yet when measure is true.
+	CaptureNegotiation Negotiate(const std::vector<CaptureFormat>& formats,
+		const CaptureRequest& request, bool measure = true);
+	CaptureFormatPlan Score(const CaptureFormat& format, const CaptureRequest& request) const;
+
+	//"NV12 1280x720@30 convert 180us/frame (measured) cpu 0.5%".
+	static std::string DescribePlan(const CaptureFormatPlan& plan);
+
+private:
+	CCaptureCostModel& m_costs;
+};
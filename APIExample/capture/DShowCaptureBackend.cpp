@@ -0,0 +1,184 @@
+#ifdef _WIN32
+#include "DShowCaptureBackend.h"
+
+namespace {
+	std::string ToUtf8(LPCTSTR text)
+	{
+#ifdef UNICODE
+		int len = WideCharToMultiByte(CP_UTF8, 0, text, -1, NULL, 0, NULL, NULL);
+		if (len <= 0)
+			return std::string();
+		std::string utf8(len, '\0');
+		WideCharToMultiByte(CP_UTF8, 0, text, -1, &utf8[0], len, NULL, NULL);
+		utf8.resize(len - 1);
+		return utf8;
+#else
+		return text;
+#endif
+	}
+
+	//0 for subtypes no CAPTURE_FOURCC stands for.
+	uint32_t ToCaptureFourcc(const BITMAPINFOHEADER& header)
+	{
+		if (header.biCompression == BI_RGB)
+			return header.biBitCount == 24 ? CAPTURE_FOURCC_BGR24 : 0;
+		switch (header.biCompression) {
+		case CAPTURE_FOURCC_I420:
+		case CAPTURE_FOURCC_NV12:
+		case CAPTURE_FOURCC_YUY2:
+		case CAPTURE_FOURCC_UYVY:
+		case CAPTURE_FOURCC_MJPG:
+			return header.biCompression;
+		default:
+			return 0;
+		}
+	}
+}
+
+CDShowCaptureBackend::CDShowCaptureBackend()
+	: m_capturing(false)
+{
+}
+
+CDShowCaptureBackend::~CDShowCaptureBackend()
+{
+	Close();
+	if (m_created)
+		m_capture.Close();
+}
+
+bool CDShowCaptureBackend::EnumDevices(std::vector<CaptureDeviceInfo>& devices)
+{
+	devices.clear();
+	if (!m_created)
+		m_created = m_capture.Create() != FALSE;
+	if (!m_created || !m_capture.EnumDeviceList())
+		return false;
+	for (int i = 0; i < m_capture.GetDeviceCount(); ++i) {
+		AGORA_DEVICE_INFO info;
+		if (!m_capture.GetDeviceInfo(i, &info))
+			continue;
+		CaptureDeviceInfo device;
+		device.id = ToUtf8(info.szDevicePath);
+		device.name = ToUtf8(info.szDeviceName);
+		device.media = CAPTURE_MEDIA_VIDEO;
+		devices.push_back(device);
+	}
+	return true;
+}
+
+bool CDShowCaptureBackend::OpenDevice(int device)
+{
+	if (device == m_device)
+		return true;
+	if (m_device >= 0)
+		Close();
+	if (!m_created || device < 0 || device >= m_capture.GetDeviceCount() || !m_capture.OpenDevice(device))
+		return false;
+	m_device = device;
+	return true;
+}
+
+void CDShowCaptureBackend::ListFormats(std::vector<CaptureFormat>& formats, std::vector<int>& capIndexes)
+{
+	formats.clear();
+	capIndexes.clear();
+	for (int i = 0; i < m_capture.GetMediaCapCount(); ++i) {
+		VIDEOINFOHEADER info;
+		if (!m_capture.GetVideoCap(i, &info))
+			continue;
+		CaptureFormat format;
+		format.media = CAPTURE_MEDIA_VIDEO;
+		format.fourcc = ToCaptureFourcc(info.bmiHeader);
+		if (!format.fourcc)
+			continue;
+		format.width = info.bmiHeader.biWidth;
+		format.height = abs(info.bmiHeader.biHeight);
+		//AvgTimePerFrame is in 100 ns units.
+		format.fps = info.AvgTimePerFrame > 0 ? (int)((10000000 + info.AvgTimePerFrame / 2) / info.AvgTimePerFrame) : 30;
+		formats.push_back(format);
+		capIndexes.push_back(i);
+	}
+}
+
+bool CDShowCaptureBackend::GetFormats(int device, std::vector<CaptureFormat>& formats)
+{
+	formats.clear();
+	if (!OpenDevice(device))
+		return false;
+	std::vector<int> capIndexes;
+	ListFormats(formats, capIndexes);
+	return true;
+}
+
+bool CDShowCaptureBackend::Open(int device, const CaptureFormat& format)
+{
+	Stop();
+	if (m_filterCreated) {
+		m_capture.RemoveCaptureFilter();
+		m_filterCreated = false;
+	}
+	if (!OpenDevice(device))
+		return false;
+	std::vector<CaptureFormat> formats;
+	std::vector<int> capIndexes;
+	ListFormats(formats, capIndexes);
+	for (size_t i = 0; i < formats.size(); ++i) {
+		if (!IsSameCaptureFormat(formats[i], format))
+			continue;
+		if (!m_capture.SelectMediaCap(capIndexes[i]) || !m_capture.CreateCaptureFilter())
+			return false;
+		m_filterCreated = true;
+		m_format = formats[i];
+		return true;
+	}
+	return false;
+}
+
+void CDShowCaptureBackend::Close()
+{
+	Stop();
+	if (m_filterCreated) {
+		m_capture.RemoveCaptureFilter();
+		m_filterCreated = false;
+	}
+	if (m_device >= 0) {
+		m_capture.CloseDevice();
+		m_device = -1;
+	}
+}
+
+bool CDShowCaptureBackend::Start(FrameCallback callback)
+{
+	if (!m_filterCreated || m_capturing || !callback)
+		return false;
+	m_callback = callback;
+	m_sequence = 0;
+	m_capture.SetSampleCallback([this](const BYTE* data, int size, long long) {
+		CaptureFrame frame;
+		frame.data = data;
+		frame.size = size;
+		frame.format = &m_format;
+		frame.timestampUs = CaptureClockUs();
+		frame.sequence = m_sequence++;
+		m_callback(frame);
+	});
+	if (!m_capture.Start()) {
+		m_capture.SetSampleCallback(nullptr);
+		return false;
+	}
+	m_capturing = true;
+	return true;
+}
+
+void CDShowCaptureBackend::Stop()
+{
+	if (!m_capturing)
+		return;
+	//IMediaControl::Stop returns after the streaming thread stopped.
+	m_capture.Stop();
+	m_capture.SetSampleCallback(nullptr);
+	m_callback = nullptr;
+	m_capturing = false;
+}
+#endif
@@ -0,0 +1,42 @@
+#pragma once
+#ifdef _WIN32
+#include "CaptureBackend.h"
+#include "DirectShow/AGDShowVideoCapture.h"
+#include <atomic>
+
+/*
+	CAGDShowVideoCapture behind ICaptureBackend. Formats come from the
+	device's media caps; the callback receives the DirectShow sample
+	buffer itself instead of the I420 copy the scenes get through
+	CAgVideoBuffer.
+*/
+class CDShowCaptureBackend : public ICaptureBackend
+{
+public:
+	CDShowCaptureBackend();
+	virtual ~CDShowCaptureBackend();
+
+	virtual const char* GetName() const override { return "dshow"; }
+	virtual bool EnumDevices(std::vector<CaptureDeviceInfo>& devices) override;
+	virtual bool GetFormats(int device, std::vector<CaptureFormat>& formats) override;
+	virtual bool Open(int device, const CaptureFormat& format) override;
+	virtual void Close() override;
+	virtual bool Start(FrameCallback callback) override;
+	virtual void Stop() override;
+	virtual bool IsCapturing() const override { return m_capturing; }
+
+private:
+	//formats of the open device and the media cap index of each.
+	bool OpenDevice(int device);
+	void ListFormats(std::vector<CaptureFormat>& formats, std::vector<int>& capIndexes);
+
+	CAGDShowVideoCapture m_capture;
+	bool m_created = false;
+	int m_device = -1;
+	bool m_filterCreated = false;
+	CaptureFormat m_format;
+	uint64_t m_sequence = 0;
+	FrameCallback m_callback;
+	std::atomic<bool> m_capturing;
+};
+#endif
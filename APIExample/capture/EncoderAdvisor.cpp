@@ -0,0 +1,216 @@
+#include "EncoderAdvisor.h"
+#include "CaptureConverter.h"
+#include "CaptureNegotiator.h"
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+
+namespace {
+	struct Size {
+		int width;
+		int height;
+	};
+
+	//common encoder resolutions, biggest first.
+	const Size WIDE_LADDER[] = {
+		{ 1920, 1080 }, { 1280, 720 }, { 960, 540 }, { 848, 480 }, { 640, 360 }, { 424, 240 }, { 320, 180 },
+	};
+	const Size STANDARD_LADDER[] = {
+		{ 1440, 1080 }, { 960, 720 }, { 640, 480 }, { 480, 360 }, { 320, 240 }, { 160, 120 },
+	};
+	const int FRAME_RATES[] = { 60, 30, 24, 15, 10, 7 };
+
+	//the capture thread has to keep up with jitter and delivery as well.
+	const double CAPTURE_THREAD_BUDGET = 0.5;
+	//scaling down to the encoder size, about one filter pass of the output.
+	const double SCALE_FILTER_PASSES = 1.0;
+	//I420 copies of a frame on its way into the encoder: conversion, the
+	//push into the SDK and the SDK's own queue.
+	const double I420_COPIES = 3.0;
+
+	const char* DescribeDegradation(agora::rtc::DEGRADATION_PREFERENCE preference)
+	{
+		switch (preference) {
+		case agora::rtc::MAINTAIN_QUALITY:
+			return "MAINTAIN_QUALITY";
+		case agora::rtc::MAINTAIN_FRAMERATE:
+			return "MAINTAIN_FRAMERATE";
+		case agora::rtc::MAINTAIN_BALANCED:
+			return "MAINTAIN_BALANCED";
+		default:
+			return "?";
+		}
+	}
+}
+
+const double CEncoderAdvisor::ENCODER_FILTER_PASSES = 40.0;
+
+CEncoderAdvisor::CEncoderAdvisor(const HostProfile& profile, const CCaptureCostModel* costs)
+	: m_profile(profile)
+	, m_costs(costs)
+{
+}
+
+int CEncoderAdvisor::GetBaseBitrateKbps(int width, int height, int fps)
+{
+	//the SDK's table follows 400kbps for 640x360@15 scaled by pixels^0.75
+	//and frame rate^0.6, within 10% on every row.
+	double pixels = (double)std::max(width, 1) * std::max(height, 1);
+	double kbps = 400 * pow(pixels / (640 * 360), 0.75) * pow(std::max(fps, 1) / 15.0, 0.6);
+	return (int)(kbps / 10 + 0.5) * 10;
+}
+
+double CEncoderAdvisor::GetConvertNsPerPixel(uint32_t fourcc) const
+{
+	bool measured = false;
+	if (m_costs) {
+		double nsPerPixel = m_costs->GetNsPerPixel(fourcc, &measured);
+		if (measured)
+			return nsPerPixel;
+	}
+	auto it = m_profile.convertNsPerPixel.find(fourcc);
+	if (it != m_profile.convertNsPerPixel.end())
+		return it->second;
+	return CCaptureCostModel::GetEstimatedNsPerPixel(fourcc);
+}
+
+EncoderEstimate CEncoderAdvisor::Estimate(int width, int height, int fps,
+	const std::vector<CaptureFormat>& formats, const EncoderAdviceRequest& request) const
+{
+	EncoderEstimate estimate;
+	estimate.width = width;
+	estimate.height = height;
+	estimate.fps = fps;
+	estimate.baseKbps = GetBaseBitrateKbps(width, height, fps);
+	double pixels = (double)width * height;
+	double filterNs = m_profile.filterNsPerPixel;
+
+	//the cheapest format that covers the size and rate, a bigger one is
+	//cropped and scaled down.
+	double captureNs = -1;
+	for (size_t i = 0; i < formats.size(); ++i) {
+		const CaptureFormat& format = formats[i];
+		int formatFps = format.fps > 0 ? format.fps : request.maxFps;
+		if (format.media != CAPTURE_MEDIA_VIDEO || format.width < width || format.height < height
+			|| formatFps < fps || !CanConvertCaptureFormat(format.fourcc))
+			continue;
+		double capturePixels = (double)format.width * format.height;
+		double ns = GetConvertNsPerPixel(format.fourcc) * capturePixels;
+		if (capturePixels > pixels)
+			ns += SCALE_FILTER_PASSES * filterNs * pixels;
+		if (captureNs < 0 || ns < captureNs) {
+			captureNs = ns;
+			estimate.captureIndex = (int)i;
+			estimate.captureFormat = format;
+		}
+	}
+	if (formats.empty()) {
+		estimate.captureFormat.fourcc = CAPTURE_FOURCC_NV12;
+		estimate.captureFormat.width = width;
+		estimate.captureFormat.height = height;
+		estimate.captureFormat.fps = fps;
+		captureNs = GetConvertNsPerPixel(CAPTURE_FOURCC_NV12) * pixels;
+	}
+	if (captureNs < 0) {
+		estimate.limit = "camera";
+		return estimate;
+	}
+
+	captureNs += request.filterPasses * filterNs * pixels;
+	double encodeNs = ENCODER_FILTER_PASSES * filterNs * pixels;
+	estimate.captureUsPerFrame = captureNs / 1000;
+	estimate.cpuPercent = (captureNs + encodeNs) * fps / (std::max(m_profile.cores, 1) * 1e9) * 100;
+
+	const CaptureFormat& capture = estimate.captureFormat;
+	double captureBytes = capture.fourcc == CAPTURE_FOURCC_MJPG
+		? (double)capture.width * capture.height * CCaptureNegotiator::MJPG_BYTES_PER_PIXEL
+		: (double)GetCaptureFrameSize(capture);
+	double bytesPerFrame = captureBytes + pixels * 1.5 * I420_COPIES;
+	estimate.memoryPercent = bytesPerFrame * fps / (std::max(m_profile.memcpyGBps, 0.1) * 1e9) * 100;
+
+	if (captureNs * fps / 1e9 > CAPTURE_THREAD_BUDGET)
+		estimate.limit = "capture thread";
+	else if (estimate.cpuPercent > request.cpuBudgetPercent)
+		estimate.limit = "cpu";
+	else if (estimate.memoryPercent > request.memoryBudgetPercent)
+		estimate.limit = "memory";
+	return estimate;
+}
+
+EncoderAdvice CEncoderAdvisor::Advise(const std::vector<CaptureFormat>& formats, const EncoderAdviceRequest& request) const
+{
+	EncoderAdvice advice;
+	if (!m_profile.IsValid())
+		return advice;
+
+	bool wide = request.maxHeight > 0 && (double)request.maxWidth / request.maxHeight > 1.5;
+	const Size* ladder = wide ? WIDE_LADDER : STANDARD_LADDER;
+	int ladderSize = wide ? (int)(sizeof(WIDE_LADDER) / sizeof(Size)) : (int)(sizeof(STANDARD_LADDER) / sizeof(Size));
+	std::vector<EncoderEstimate> estimates;
+	for (int i = 0; i < ladderSize; ++i) {
+		if (ladder[i].width > request.maxWidth || ladder[i].height > request.maxHeight)
+			continue;
+		for (int fps : FRAME_RATES) {
+			if (fps <= request.maxFps)
+				estimates.push_back(Estimate(ladder[i].width, ladder[i].height, fps, formats, request));
+		}
+	}
+	if (estimates.empty())
+		return advice;
+	std::stable_sort(estimates.begin(), estimates.end(),
+		[](const EncoderEstimate& a, const EncoderEstimate& b) { return a.baseKbps > b.baseKbps; });
+
+	//the frame rate floor first, any frame rate when nothing fits above it.
+	const EncoderEstimate* chosen = nullptr;
+	for (int pass = 0; pass < 2 && !chosen; ++pass) {
+		for (auto& estimate : estimates) {
+			if (!*estimate.limit && (pass == 1 || estimate.fps >= request.minFps)) {
+				chosen = &estimate;
+				break;
+			}
+		}
+	}
+	//nothing fits: the cheapest one, which still says why it does not.
+	if (!chosen)
+		chosen = &estimates.back();
+	for (auto& estimate : estimates) {
+		if (estimate.baseKbps > chosen->baseKbps && *estimate.limit
+			&& (chosen->fps < request.minFps || estimate.fps >= request.minFps))
+			advice.limitedBy = estimate.limit;
+	}
+
+	advice.valid = true;
+	advice.estimate = *chosen;
+	agora::rtc::VideoEncoderConfiguration& config = advice.config;
+	config.dimensions.width = chosen->width;
+	config.dimensions.height = chosen->height;
+	config.frameRate = (agora::rtc::FRAME_RATE)chosen->fps;
+	//the SDK scales the table's bitrate with the channel profile itself.
+	config.bitrate = agora::rtc::STANDARD_BITRATE;
+	if (chosen->fps <= request.minFps)
+		config.degradationPreference = agora::rtc::MAINTAIN_FRAMERATE;
+	else if (m_profile.cores <= 2 || chosen->cpuPercent > request.cpuBudgetPercent * 2 / 3)
+		config.degradationPreference = agora::rtc::MAINTAIN_BALANCED;
+	else
+		config.degradationPreference = agora::rtc::MAINTAIN_QUALITY;
+	return advice;
+}
+
+std::string CEncoderAdvisor::DescribeAdvice(const EncoderAdvice& advice)
+{
+	if (!advice.valid)
+		return "no advice";
+	const EncoderEstimate& estimate = advice.estimate;
+	char text[256];
+	snprintf(text, sizeof(text), "%dx%d@%d %dkbps %s, %s capture %.1fms/frame cpu %.0f%% memory %.1f%%",
+		estimate.width, estimate.height, estimate.fps, estimate.baseKbps,
+		DescribeDegradation(advice.config.degradationPreference),
+		DescribeCaptureFormat(estimate.captureFormat).c_str(),
+		estimate.captureUsPerFrame / 1000, estimate.cpuPercent, estimate.memoryPercent);
+	std::string description = text;
+	if (*estimate.limit)
+		description += std::string(", over the ") + estimate.limit + " budget";
+	else if (*advice.limitedBy)
+		description += std::string(", limited by ") + advice.limitedBy;
+	return description;
+}
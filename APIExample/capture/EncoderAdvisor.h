@@ -0,0 +1,97 @@
+#pragma once
+#include "CaptureBackend.h"
+#include "HostBenchmark.h"
+#include <IAgoraRtcEngine.h>
+
+class CCaptureCostModel;
+
+//what the app wants out of the encoder at most.
+struct EncoderAdviceRequest {
+	int maxWidth = 1920;
+	int maxHeight = 1080;
+	int maxFps = 30;
+	//below this frame rate the resolution goes down first.
+	int minFps = 15;
+	//share of all cores conversion, filters and encoding may take.
+	double cpuBudgetPercent = 50;
+	//share of the memcpy bandwidth the frame copies may take.
+	double memoryBudgetPercent = 10;
+	//full-frame filter passes per frame before encoding, such as a beauty
+	//filter, each costing about one benchmark filter pass.
+	int filterPasses = 0;
+};
+
+//the numbers one encoder resolution and frame rate were judged on.
+struct EncoderEstimate {
+	int width = 0;
+	int height = 0;
+	int fps = 0;
+	//the capture format that feeds it, index in the list given to Advise,
+	//-1 when no list was given or none fits.
+	int captureIndex = -1;
+	CaptureFormat captureFormat;
+	//per frame on the capture thread: conversion, scaling and filters.
+	double captureUsPerFrame = 0;
+	//all work at the frame rate including the encoder, percent of all cores.
+	double cpuPercent = 0;
+	//frame copies at the frame rate, percent of the memcpy bandwidth.
+	double memoryPercent = 0;
+	//base bitrate of the SDK's table for this resolution and frame rate.
+	int baseKbps = 0;
+	//"" when it fits, otherwise "camera", "cpu", "capture thread" or
+	//"memory".
+	const char* limit = "";
+};
+
+struct EncoderAdvice {
+	bool valid = false;
+	agora::rtc::VideoEncoderConfiguration config;
+	EncoderEstimate estimate;
+	//what kept the next larger candidate out, "" when the request did.
+	const char* limitedBy = "";
+};
+
+/*
+	Recommends an encoder configuration from a host benchmark and the
+	formats the camera offers. Each candidate of a 16:9 or 4:3 ladder,
+	biggest first, is costed as
+		capture thread: conversion of the cheapest capture format that
+		                covers it, scaling down and the filter passes
+		cpu:            that plus the encoder, modelled as a fixed number
+		                of filter passes per pixel, against all cores
+		memory:         the frame copies against memcpy bandwidth
+	and the one with the highest SDK base bitrate, the SDK's own measure of
+	how much a resolution and frame rate carry, that fits every budget
+	wins. The frame rate is kept at minFps or above before resolution is
+	traded for it. The degradation preference follows from the headroom:
+	plenty keeps quality, a tight cpu balances and a frame rate already at
+	the floor keeps the frame rate.
+*/
+class CEncoderAdvisor
+{
+public:
+	//a software encoder at real-time settings does about the work of this
+	//many 3x3 filter passes per pixel.
+	static const double ENCODER_FILTER_PASSES;
+
+	//costs, when given, replaces the profile's conversion numbers with the
+	//ones learned from live frames, which is the only source for MJPG.
+	explicit CEncoderAdvisor(const HostProfile& profile, const CCaptureCostModel* costs = nullptr);
+
+	//formats may be empty when the camera is unknown, capture is then
+	//taken as native NV12 at the encoder size.
+	EncoderAdvice Advise(const std::vector<CaptureFormat>& formats, const EncoderAdviceRequest& request) const;
+	EncoderEstimate Estimate(int width, int height, int fps,
+		const std::vector<CaptureFormat>& formats, const EncoderAdviceRequest& request) const;
+
+	//base bitrate of the SDK's table, interpolated between its rows.
+	static int GetBaseBitrateKbps(int width, int height, int fps);
+	//"1280x720@30 1710kbps MAINTAIN_QUALITY, NV12 1280x720@30, capture 1.2ms/frame cpu 23% memory 2%, limited by cpu".
+	static std::string DescribeAdvice(const EncoderAdvice& advice);
+
+private:
+	double GetConvertNsPerPixel(uint32_t fourcc) const;
+
+	HostProfile m_profile;
+	const CCaptureCostModel* m_costs;
+};
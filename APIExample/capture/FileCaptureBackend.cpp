@@ -0,0 +1,217 @@
+#include "FileCaptureBackend.h"
+#include <chrono>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace {
+#ifdef _WIN32
+	std::wstring ToWide(const std::string& utf8)
+	{
+		int len = MultiByteToWideChar(CP_UTF8, 0, utf8.c_str(), -1, NULL, 0);
+		if (len <= 0)
+			return std::wstring();
+		std::wstring wide(len, L'\0');
+		MultiByteToWideChar(CP_UTF8, 0, utf8.c_str(), -1, &wide[0], len);
+		wide.resize(len - 1);
+		return wide;
+	}
+#endif
+
+	std::string GetFileName(const std::string& path)
+	{
+		size_t pos = path.find_last_of("/\\");
+		return pos == std::string::npos ? path : path.substr(pos + 1);
+	}
+}
+
+CFileCaptureBackend::CFileCaptureBackend()
+	: m_capturing(false)
+{
+}
+
+CFileCaptureBackend::~CFileCaptureBackend()
+{
+	Close();
+}
+
+bool CFileCaptureBackend::AddVideoFile(const std::string& path, RawVideoFormat format, int width, int height, int fps)
+{
+	if (CRawVideoFile::GetFrameSize(format, width, height) == 0 || fps <= 0)
+		return false;
+	FileDevice device;
+	device.info.id = path;
+	device.info.name = GetFileName(path);
+	device.info.media = CAPTURE_MEDIA_VIDEO;
+	device.format.media = CAPTURE_MEDIA_VIDEO;
+	switch (format) {
+	case RAW_VIDEO_I420:
+		device.format.fourcc = CAPTURE_FOURCC_I420;
+		break;
+	case RAW_VIDEO_NV12:
+		device.format.fourcc = CAPTURE_FOURCC_NV12;
+		break;
+	case RAW_VIDEO_RGBA:
+		device.format.fourcc = CAPTURE_FOURCC_RGBA;
+		break;
+	}
+	device.format.width = width;
+	device.format.height = height;
+	device.format.fps = fps;
+	device.rawFormat = format;
+	m_devices.push_back(device);
+	return true;
+}
+
+bool CFileCaptureBackend::AddAudioFile(const std::string& path, int sampleRate, int channels)
+{
+	if (sampleRate <= 0 || sampleRate % (1000 / AUDIO_FRAME_MS) || channels <= 0)
+		return false;
+	FileDevice device;
+	device.info.id = path;
+	device.info.name = GetFileName(path);
+	device.info.media = CAPTURE_MEDIA_AUDIO;
+	device.format.media = CAPTURE_MEDIA_AUDIO;
+	device.format.fourcc = CAPTURE_FOURCC_PCM16;
+	device.format.sampleRate = sampleRate;
+	device.format.channels = channels;
+	device.rawFormat = RAW_VIDEO_I420;
+	m_devices.push_back(device);
+	return true;
+}
+
+bool CFileCaptureBackend::EnumDevices(std::vector<CaptureDeviceInfo>& devices)
+{
+	devices.clear();
+	for (auto& device : m_devices)
+		devices.push_back(device.info);
+	return true;
+}
+
+bool CFileCaptureBackend::GetFormats(int device, std::vector<CaptureFormat>& formats)
+{
+	formats.clear();
+	if (device < 0 || device >= (int)m_devices.size())
+		return false;
+	formats.push_back(m_devices[device].format);
+	return true;
+}
+
+bool CFileCaptureBackend::Open(int device, const CaptureFormat& format)
+{
+	Close();
+	if (device < 0 || device >= (int)m_devices.size() || !IsSameCaptureFormat(format, m_devices[device].format))
+		return false;
+	const FileDevice& file = m_devices[device];
+	if (file.info.media == CAPTURE_MEDIA_VIDEO) {
+		std::shared_ptr<CRawVideoFile> video = std::make_shared<CRawVideoFile>();
+#ifdef _WIN32
+		bool opened = video->Open(ToWide(file.info.id).c_str(), file.rawFormat, format.width, format.height);
+#else
+		bool opened = video->Open(file.info.id.c_str(), file.rawFormat, format.width, format.height);
+#endif
+		if (!opened)
+			return false;
+		m_videoFile = video;
+	}
+	else {
+		AudioFileFormat raw;
+		raw.sampleRate = format.sampleRate;
+		raw.channels = format.channels;
+		if (!m_audioReader.Open(file.info.id, &raw))
+			return false;
+		//a WAV file brings its own format, it has to be the device's.
+		const AudioFileFormat& actual = m_audioReader.GetFormat();
+		if (actual.sampleRate != format.sampleRate || actual.channels != format.channels) {
+			m_audioReader.Close();
+			return false;
+		}
+	}
+	m_opened = device;
+	m_format = file.format;
+	return true;
+}
+
+void CFileCaptureBackend::Close()
+{
+	Stop();
+	m_videoFile.reset();
+	m_audioReader.Close();
+	m_opened = -1;
+}
+
+bool CFileCaptureBackend::Start(FrameCallback callback)
+{
+	if (m_opened < 0 || m_capturing || !callback)
+		return false;
+	m_callback = callback;
+	m_capturing = true;
+	if (m_format.media == CAPTURE_MEDIA_VIDEO)
+		m_thread = std::thread(&CFileCaptureBackend::RunVideo, this);
+	else
+		m_thread = std::thread(&CFileCaptureBackend::RunAudio, this);
+	return true;
+}
+
+void CFileCaptureBackend::Stop()
+{
+	m_capturing = false;
+	if (m_thread.joinable())
+		m_thread.join();
+	m_callback = nullptr;
+}
+
+void CFileCaptureBackend::RunVideo()
+{
+	CRawVideoReader reader(m_videoFile);
+	reader.SetFrameRate(m_format.fps);
+	reader.SetLoop(m_loop);
+	uint64_t sequence = 0;
+	while (m_capturing && !reader.IsFinished()) {
+		int64_t nowMs = CaptureClockUs() / 1000;
+		RawVideoFrame raw;
+		if (reader.NextFrame(nowMs, raw)) {
+			CaptureFrame frame;
+			frame.data = raw.data;
+			frame.size = raw.size;
+			frame.format = &m_format;
+			frame.timestampUs = CaptureClockUs();
+			frame.sequence = sequence++;
+			m_callback(frame);
+		}
+		int64_t wait = reader.GetWaitMs(CaptureClockUs() / 1000);
+		std::this_thread::sleep_for(std::chrono::milliseconds(wait > 0 ? wait : 1));
+	}
+}
+
+void CFileCaptureBackend::RunAudio()
+{
+	using namespace std::chrono;
+	const int frames = m_format.sampleRate / (1000 / AUDIO_FRAME_MS);
+	std::vector<int16_t> samples((size_t)frames * m_format.channels);
+	const milliseconds period(AUDIO_FRAME_MS);
+	//every Start plays the file from the beginning.
+	m_audioReader.SetLoop(m_loop);
+	m_audioReader.Seek(0);
+	m_audioReader.WaitBuffered(frames, AUDIO_FRAME_MS * 10);
+	steady_clock::time_point next = steady_clock::now();
+	uint64_t sequence = 0;
+	while (m_capturing) {
+		//a read-ahead underrun is delivered as silence, a device keeps its clock too.
+		if (m_audioReader.Read(samples.data(), frames) == 0 && m_audioReader.IsFinished())
+			break;
+		CaptureFrame frame;
+		frame.data = (const uint8_t*)samples.data();
+		frame.size = samples.size() * sizeof(int16_t);
+		frame.format = &m_format;
+		frame.timestampUs = CaptureClockUs();
+		frame.sequence = sequence++;
+		m_callback(frame);
+
+		next += period;
+		//a device does not deliver a backlog after a stall either.
+		if (steady_clock::now() - next > period * 10)
+			next = steady_clock::now();
+		std::this_thread::sleep_until(next);
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include "CaptureBackend.h"
+#include "AudioFileReader.h"
+#include "Advanced/MediaIOCustomVideoCaptrue/RawVideoFile.h"
+#include <atomic>
+#include <thread>
+
+/*
+	Replays raw files as capture devices, one device per added file, for
+	runs without a camera or microphone. Video files are memory mapped
+	(CRawVideoFile) and frames are delivered straight from the mapping at
+	the file's frame rate; PCM and WAV files are streamed through
+	CAudioFileReader and delivered in 10 ms frames. Both loop by default.
+*/
+class CFileCaptureBackend : public ICaptureBackend
+{
+public:
+	enum {
+		AUDIO_FRAME_MS = 10,
+	};
+
+	CFileCaptureBackend();
+	virtual ~CFileCaptureBackend();
+
+	//paths are UTF-8. the files are opened by Open, not here.
+	bool AddVideoFile(const std::string& path, RawVideoFormat format, int width, int height, int fps);
+	//headerless interleaved PCM16, or a WAV file of that format.
+	bool AddAudioFile(const std::string& path, int sampleRate, int channels);
+	//at the end of a file that does not loop the capture thread stops
+	//delivering, Stop still has to be called.
+	void SetLoop(bool loop) { m_loop = loop; }
+
+	virtual const char* GetName() const override { return "file"; }
+	virtual bool EnumDevices(std::vector<CaptureDeviceInfo>& devices) override;
+	virtual bool GetFormats(int device, std::vector<CaptureFormat>& formats) override;
+	virtual bool Open(int device, const CaptureFormat& format) override;
+	virtual void Close() override;
+	virtual bool Start(FrameCallback callback) override;
+	virtual void Stop() override;
+	virtual bool IsCapturing() const override { return m_capturing; }
+
+private:
+	struct FileDevice {
+		CaptureDeviceInfo info;
+		CaptureFormat format;
+		RawVideoFormat rawFormat;
+	};
+
+	void RunVideo();
+	void RunAudio();
+
+	std::vector<FileDevice> m_devices;
+	bool m_loop = true;
+
+	int m_opened = -1;
+	CaptureFormat m_format;
+	std::shared_ptr<CRawVideoFile> m_videoFile;
+	CAudioFileReader m_audioReader;
+
+	FrameCallback m_callback;
+	std::thread m_thread;
+	std::atomic<bool> m_capturing;
+};
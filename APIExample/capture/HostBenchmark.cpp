@@ -0,0 +1,276 @@
+#include "HostBenchmark.h"
+//no stdafx.h, the benchmark also runs standalone without MFC.
+#include "CaptureNegotiator.h"
+#include "../dsp/CpuFeatures.h"
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+#if !defined(_MSC_VER) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#endif
+
+namespace {
+	//bump when a measurement changes so old caches are redone.
+	const int PROFILE_VERSION = 1;
+	const int RUNS = 5;
+	//larger than any last level cache, so memcpy measures memory.
+	const size_t MEMCPY_BYTES = 32 << 20;
+	const int FILTER_WIDTH = 1280;
+	const int FILTER_HEIGHT = 720;
+	const uint32_t RAW_FORMATS[] = {
+		CAPTURE_FOURCC_I420, CAPTURE_FOURCC_NV12, CAPTURE_FOURCC_YUY2,
+		CAPTURE_FOURCC_UYVY, CAPTURE_FOURCC_RGBA, CAPTURE_FOURCC_BGR24,
+	};
+
+	int64_t NowNs()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	int64_t Median(std::vector<int64_t> times)
+	{
+		std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+		return times[times.size() / 2];
+	}
+
+	FILE* OpenProfileFile(const std::string& path, bool write)
+	{
+#ifdef _WIN32
+		int len = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, NULL, 0);
+		if (len <= 0)
+			return NULL;
+		std::wstring wide(len, L'\0');
+		MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &wide[0], len);
+		FILE* file = NULL;
+		if (_wfopen_s(&file, wide.c_str(), write ? L"w" : L"r") != 0)
+			return NULL;
+		return file;
+#else
+		return fopen(path.c_str(), write ? "w" : "r");
+#endif
+	}
+
+	std::string GetCpuBrand()
+	{
+		unsigned int regs[12] = { 0 };
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+		int info[4] = { 0 };
+		__cpuid(info, 0x80000000);
+		if ((unsigned int)info[0] < 0x80000004)
+			return "unknown cpu";
+		for (int i = 0; i < 3; ++i)
+			__cpuid((int*)&regs[i * 4], 0x80000002 + i);
+#elif defined(__x86_64__) || defined(__i386__)
+		if (__get_cpuid_max(0x80000000, nullptr) < 0x80000004)
+			return "unknown cpu";
+		for (unsigned int i = 0; i < 3; ++i)
+			__get_cpuid(0x80000002 + i, &regs[i * 4], &regs[i * 4 + 1], &regs[i * 4 + 2], &regs[i * 4 + 3]);
+#else
+		return "unknown cpu";
+#endif
+		char brand[sizeof(regs) + 1] = { 0 };
+		memcpy(brand, regs, sizeof(regs));
+		std::string text = brand;
+		size_t begin = text.find_first_not_of(' ');
+		size_t end = text.find_last_not_of(' ');
+		return begin == std::string::npos ? "unknown cpu" : text.substr(begin, end - begin + 1);
+	}
+
+	std::string GetHostName()
+	{
+		char name[256] = { 0 };
+#ifdef _WIN32
+		DWORD size = sizeof(name);
+		if (!GetComputerNameA(name, &size))
+			return "";
+#else
+		if (gethostname(name, sizeof(name) - 1) != 0)
+			return "";
+#endif
+		return name;
+	}
+
+	double MeasureMemcpy()
+	{
+		std::vector<uint8_t> src(MEMCPY_BYTES, 1), dst(MEMCPY_BYTES, 0);
+		memcpy(dst.data(), src.data(), MEMCPY_BYTES);
+		std::vector<int64_t> times;
+		for (int i = 0; i < RUNS; ++i) {
+			src[i] = (uint8_t)i;
+			int64_t begin = NowNs();
+			memcpy(dst.data(), src.data(), MEMCPY_BYTES);
+			times.push_back(NowNs() - begin);
+		}
+		//keeps the copies from being optimized away.
+		volatile uint8_t sink = dst[RUNS - 1];
+		(void)sink;
+		return (double)MEMCPY_BYTES / std::max<int64_t>(Median(times), 1);
+	}
+
+	//a 3x3 box filter in plain loops the compiler vectorizes, about what a
+	//portable blur or beauty pass costs per pixel.
+	void BoxFilter3x3(const uint8_t* src, uint8_t* dst, int width, int height)
+	{
+		std::vector<uint16_t> rows(width * 3);
+		for (int y = 0; y < height; ++y) {
+			const uint8_t* lines[3] = {
+				src + (size_t)std::max(y - 1, 0) * width,
+				src + (size_t)y * width,
+				src + (size_t)std::min(y + 1, height - 1) * width,
+			};
+			uint16_t* sum = rows.data();
+			for (int x = 0; x < width; ++x)
+				sum[x] = (uint16_t)(lines[0][x] + lines[1][x] + lines[2][x]);
+			uint8_t* out = dst + (size_t)y * width;
+			out[0] = (uint8_t)((sum[0] * 2 + sum[1]) * 7282 >> 16);
+			for (int x = 1; x < width - 1; ++x)
+				out[x] = (uint8_t)((sum[x - 1] + sum[x] + sum[x + 1]) * 7282 >> 16);
+			out[width - 1] = (uint8_t)((sum[width - 2] + sum[width - 1] * 2) * 7282 >> 16);
+		}
+	}
+
+	double MeasureFilter()
+	{
+		std::vector<uint8_t> src((size_t)FILTER_WIDTH * FILTER_HEIGHT), dst(src.size());
+		uint32_t seed = 0x12345678;
+		for (size_t i = 0; i < src.size(); ++i) {
+			seed = seed * 1664525 + 1013904223;
+			src[i] = (uint8_t)(seed >> 24);
+		}
+		BoxFilter3x3(src.data(), dst.data(), FILTER_WIDTH, FILTER_HEIGHT);
+		std::vector<int64_t> times;
+		for (int i = 0; i < RUNS; ++i) {
+			int64_t begin = NowNs();
+			BoxFilter3x3(src.data(), dst.data(), FILTER_WIDTH, FILTER_HEIGHT);
+			times.push_back(NowNs() - begin);
+		}
+		volatile uint8_t sink = dst[dst.size() / 2];
+		(void)sink;
+		return (double)Median(times) / ((double)FILTER_WIDTH * FILTER_HEIGHT);
+	}
+}
+
+std::string GetHostMachineId()
+{
+	char cores[32];
+	snprintf(cores, sizeof(cores), " / %u cores / ", std::thread::hardware_concurrency());
+	return GetCpuBrand() + cores + GetHostName();
+}
+
+HostProfile RunHostBenchmark()
+{
+	int64_t begin = NowNs();
+	HostProfile profile;
+	profile.machine = GetHostMachineId();
+	profile.cores = (int)std::max(1u, std::thread::hardware_concurrency());
+	profile.avx2 = AgHasAVX2();
+	profile.memcpyGBps = MeasureMemcpy();
+	profile.filterNsPerPixel = MeasureFilter();
+	CCaptureCostModel costs;
+	for (uint32_t fourcc : RAW_FORMATS) {
+		if (costs.Measure(fourcc))
+			profile.convertNsPerPixel[fourcc] = costs.GetNsPerPixel(fourcc);
+	}
+	profile.benchmarkMs = (NowNs() - begin) / 1000000;
+	return profile;
+}
+
+bool LoadHostProfile(const std::string& path, HostProfile& profile)
+{
+	FILE* file = OpenProfileFile(path, false);
+	if (!file)
+		return false;
+	HostProfile loaded;
+	int version = 0;
+	char line[512];
+	while (fgets(line, sizeof(line), file)) {
+		line[strcspn(line, "\r\n")] = 0;
+		char name[5] = { 0 };
+		double value = 0;
+		int number = 0;
+		long long ms = 0;
+		if (line[0] == '#')
+			continue;
+		else if (strncmp(line, "machine ", 8) == 0)
+			loaded.machine = line + 8;
+		else if (sscanf(line, "version %d", &version) == 1)
+			continue;
+		else if (sscanf(line, "cores %d", &number) == 1)
+			loaded.cores = number;
+		else if (sscanf(line, "avx2 %d", &number) == 1)
+			loaded.avx2 = number != 0;
+		else if (sscanf(line, "memcpy %lf", &value) == 1)
+			loaded.memcpyGBps = value;
+		else if (sscanf(line, "filter %lf", &value) == 1)
+			loaded.filterNsPerPixel = value;
+		else if (sscanf(line, "benchmark %lld", &ms) == 1)
+			loaded.benchmarkMs = ms;
+		else if (sscanf(line, "convert %4s %lf", name, &value) == 2 && strlen(name) == 4 && value > 0)
+			loaded.convertNsPerPixel[CAPTURE_FOURCC(name[0], name[1], name[2], name[3])] = value;
+	}
+	fclose(file);
+	if (version != PROFILE_VERSION || !loaded.IsValid() || loaded.machine != GetHostMachineId())
+		return false;
+	profile = loaded;
+	return true;
+}
+
+bool SaveHostProfile(const std::string& path, const HostProfile& profile)
+{
+	FILE* file = OpenProfileFile(path, true);
+	if (!file)
+		return false;
+	fprintf(file, "#host benchmark, delete the file to measure again\n");
+	fprintf(file, "version %d\n", PROFILE_VERSION);
+	fprintf(file, "machine %s\n", profile.machine.c_str());
+	fprintf(file, "cores %d\n", profile.cores);
+	fprintf(file, "avx2 %d\n", profile.avx2 ? 1 : 0);
+	fprintf(file, "memcpy %.3f\n", profile.memcpyGBps);
+	fprintf(file, "filter %.4f\n", profile.filterNsPerPixel);
+	for (auto& it : profile.convertNsPerPixel) {
+		CaptureFormat format;
+		format.fourcc = it.first;
+		fprintf(file, "convert %s %.4f\n", DescribeCaptureFormat(format).substr(0, 4).c_str(), it.second);
+	}
+	fprintf(file, "benchmark %lld\n", (long long)profile.benchmarkMs);
+	bool ok = ferror(file) == 0;
+	fclose(file);
+	return ok;
+}
+
+HostProfile GetHostProfile(const std::string& path, bool* cached)
+{
+	HostProfile profile;
+	bool loaded = LoadHostProfile(path, profile);
+	if (!loaded) {
+		profile = RunHostBenchmark();
+		SaveHostProfile(path, profile);
+	}
+	if (cached)
+		*cached = loaded;
+	return profile;
+}
+
+std::string DescribeHostProfile(const HostProfile& profile)
+{
+	char text[128];
+	snprintf(text, sizeof(text), "%d cores%s, memcpy %.1fGB/s, filter %.2fns/px",
+		profile.cores, profile.avx2 ? " avx2" : "", profile.memcpyGBps, profile.filterNsPerPixel);
+	std::string description = text;
+	for (auto& it : profile.convertNsPerPixel) {
+		CaptureFormat format;
+		format.fourcc = it.first;
+		snprintf(text, sizeof(text), ", %s %.2fns/px", DescribeCaptureFormat(format).substr(0, 4).c_str(), it.second);
+		description += text;
+	}
+	return description;
+}
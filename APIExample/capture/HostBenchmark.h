@@ -0,0 +1,45 @@
+#pragma once
+#include <map>
+#include <stdint.h>
+#include <string>
+
+//what this machine manages, as RunHostBenchmark measured it.
+struct HostProfile {
+	//CPU brand, logical cores and host name; a profile of another machine
+	//is not loaded.
+	std::string machine;
+	int cores = 0;
+	bool avx2 = false;
+	//memcpy between buffers larger than the caches, GB/s.
+	double memcpyGBps = 0;
+	//one 3x3 filter pass over a luma plane, the kind of pass a blur or
+	//beauty filter makes, ns per pixel on one core.
+	double filterNsPerPixel = 0;
+	//conversion of the raw capture formats into I420, ns per pixel.
+	std::map<uint32_t, double> convertNsPerPixel;
+	//wall time of the benchmark.
+	int64_t benchmarkMs = 0;
+
+	bool IsValid() const { return cores > 0 && memcpyGBps > 0 && filterNsPerPixel > 0; }
+};
+
+//"<cpu brand> / <cores> cores / <host name>".
+std::string GetHostMachineId();
+
+/*
+	Times memcpy, a filter pass and every raw capture conversion on
+	synthetic buffers, each the median of a few runs so a preempted run
+	does not count. Takes a few hundred milliseconds and runs on the
+	calling thread; anything else busy on the machine shows up in the
+	numbers, so run it before starting capture or encoding.
+*/
+HostProfile RunHostBenchmark();
+
+//UTF-8 paths. Load fails on a missing file and on one written by another
+//machine or another version of the benchmark.
+bool LoadHostProfile(const std::string& path, HostProfile& profile);
+bool SaveHostProfile(const std::string& path, const HostProfile& profile);
+//the profile cached in path, or a new benchmark that is then cached.
+HostProfile GetHostProfile(const std::string& path, bool* cached = nullptr);
+//"8 cores avx2, memcpy 12.1GB/s, filter 0.42ns/px, NV12 0.21ns/px ...".
+std::string DescribeHostProfile(const HostProfile& profile);
@@ -0,0 +1,190 @@
+#include "MjpegDecodePipeline.h"
+#include "CaptureConverter.h"
+#include "trace/Trace.h"
+#include <algorithm>
+#include <chrono>
+#include <string.h>
+
+namespace {
+	bool DecodeWithLibyuv(const uint8_t* jpeg, size_t size, uint8_t* i420, int width, int height)
+	{
+		CaptureFormat format;
+		format.fourcc = CAPTURE_FOURCC_MJPG;
+		format.width = width;
+		format.height = height;
+		return ConvertCaptureFrameToI420(format, jpeg, size, i420);
+	}
+}
+
+CMjpegDecodePipeline::CMjpegDecodePipeline(int workers, int slots)
+{
+	if (workers <= 0) {
+		//leave a core to the capture thread and the encoder.
+		int cores = (int)std::thread::hardware_concurrency();
+		workers = cores > 1 ? cores - 1 : 1;
+	}
+	m_workerCount = std::min(workers, (int)MAX_WORKERS);
+	m_slotCount = slots > 0 ? slots : m_workerCount * 2;
+	m_decoder = DecodeWithLibyuv;
+}
+
+CMjpegDecodePipeline::~CMjpegDecodePipeline()
+{
+	Stop();
+}
+
+void CMjpegDecodePipeline::SetDecoder(DecodeFunction decoder)
+{
+	if (!m_running && decoder)
+		m_decoder = decoder;
+}
+
+bool CMjpegDecodePipeline::Start(int width, int height, FrameCallback callback)
+{
+	if (m_running || width <= 0 || height <= 0 || !callback)
+		return false;
+	m_width = width;
+	m_height = height;
+	m_callback = callback;
+	size_t frameSize = (size_t)width * height * 3 / 2;
+	m_slots.clear();
+	m_free.clear();
+	for (int i = 0; i < m_slotCount; ++i) {
+		m_slots.emplace_back(new Slot);
+		m_slots.back()->i420.resize(frameSize);
+		m_free.push_back(m_slots.back().get());
+	}
+	m_pending.clear();
+	m_order.clear();
+	m_delivering = false;
+	m_sequence = 0;
+	m_stats = MjpegPipelineStats();
+	m_running = true;
+	for (int i = 0; i < m_workerCount; ++i)
+		m_workers.emplace_back(&CMjpegDecodePipeline::Run, this);
+	return true;
+}
+
+void CMjpegDecodePipeline::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_running)
+			return;
+		m_running = false;
+	}
+	m_wake.notify_all();
+	for (auto& worker : m_workers)
+		worker.join();
+	m_workers.clear();
+	m_pending.clear();
+	m_order.clear();
+	m_callback = nullptr;
+}
+
+bool CMjpegDecodePipeline::Submit(const uint8_t* jpeg, size_t size, int64_t timestampUs, uint64_t flowId)
+{
+	if (!jpeg || !size)
+		return false;
+	Slot* slot = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_running)
+			return false;
+		++m_stats.submitted;
+		//every slot is being decoded or waits to be delivered.
+		if (m_free.empty()) {
+			++m_stats.dropped;
+			++m_sequence;
+			return false;
+		}
+		slot = m_free.back();
+		m_free.pop_back();
+		slot->sequence = m_sequence++;
+		slot->timestampUs = timestampUs;
+		slot->flowId = flowId;
+		slot->done = false;
+		slot->ok = false;
+		//a free slot is not touched by the workers, fill it outside the lock.
+	}
+	//capacity grows to the largest sample seen and then stays.
+	slot->jpeg.assign(jpeg, jpeg + size);
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_running) {
+			m_free.push_back(slot);
+			return false;
+		}
+		m_pending.push_back(slot);
+		m_order.push_back(slot);
+		m_stats.peakInFlight = std::max(m_stats.peakInFlight, (int)m_order.size());
+	}
+	m_wake.notify_one();
+	return true;
+}
+
+MjpegPipelineStats CMjpegDecodePipeline::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
+
+void CMjpegDecodePipeline::Run()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true) {
+		m_wake.wait(lock, [this] { return !m_running || !m_pending.empty(); });
+		if (!m_running)
+			return;
+		Slot* slot = m_pending.front();
+		m_pending.pop_front();
+		lock.unlock();
+
+		auto begin = std::chrono::steady_clock::now();
+		bool ok;
+		{
+			AG_TRACE_SCOPE2("convert", "DecodeMjpeg", "sequence", slot->sequence, "size", slot->jpeg.size());
+			AG_TRACE_FLOW_STEP("frame", "video frame", slot->flowId);
+			ok = m_decoder(slot->jpeg.data(), slot->jpeg.size(), slot->i420.data(), m_width, m_height);
+		}
+		auto end = std::chrono::steady_clock::now();
+
+		lock.lock();
+		slot->decodeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+		slot->ok = ok;
+		slot->done = true;
+		m_stats.decodeNs += slot->decodeNs;
+		if (!ok)
+			++m_stats.failed;
+		//one worker delivers at a time, the others go back to decoding and
+		//leave their frames to it.
+		if (!m_delivering)
+			Deliver(lock);
+	}
+}
+
+void CMjpegDecodePipeline::Deliver(std::unique_lock<std::mutex>& lock)
+{
+	m_delivering = true;
+	while (m_running && !m_order.empty() && m_order.front()->done) {
+		Slot* slot = m_order.front();
+		m_order.pop_front();
+		if (slot->ok) {
+			MjpegDecodedFrame frame;
+			frame.data = slot->i420.data();
+			frame.size = slot->i420.size();
+			frame.width = m_width;
+			frame.height = m_height;
+			frame.timestampUs = slot->timestampUs;
+			frame.sequence = slot->sequence;
+			frame.flowId = slot->flowId;
+			frame.decodeNs = slot->decodeNs;
+			++m_stats.delivered;
+			lock.unlock();
+			m_callback(frame);
+			lock.lock();
+		}
+		m_free.push_back(slot);
+	}
+	m_delivering = false;
+}
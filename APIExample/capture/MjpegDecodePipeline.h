@@ -0,0 +1,118 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+//a decoded frame as the pipeline hands it out. data is tightly packed I420
+//owned by the pipeline and only valid during the callback.
+struct MjpegDecodedFrame {
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+	int width = 0;
+	int height = 0;
+	int64_t timestampUs = 0;
+	//order of Submit, dropped frames leave gaps.
+	uint64_t sequence = 0;
+	//what the frame was submitted with, its flow id in the trace.
+	uint64_t flowId = 0;
+	//time the decoder spent on this frame.
+	int64_t decodeNs = 0;
+};
+
+struct MjpegPipelineStats {
+	uint64_t submitted = 0;
+	//refused by Submit because every frame slot was in flight.
+	uint64_t dropped = 0;
+	//corrupt or truncated samples the decoder gave up on.
+	uint64_t failed = 0;
+	uint64_t delivered = 0;
+	int64_t decodeNs = 0;
+	//most frames in flight at once.
+	int peakInFlight = 0;
+};
+
+/*
+	Decodes MJPEG samples on a pool of worker threads so the thread that
+	captures them only copies the compressed data and returns. Frames are
+	decoded in parallel but delivered in the order they were submitted,
+	one callback at a time, from whichever worker completes the oldest
+	frame. There is a fixed number of frame slots; when all of them are in
+	flight Submit drops the new sample instead of waiting, so a slow
+	machine loses frames rather than stalling the capture graph.
+*/
+class CMjpegDecodePipeline
+{
+public:
+	//decodes one JPEG into width x height I420.
+	typedef std::function<bool(const uint8_t* jpeg, size_t size, uint8_t* i420, int width, int height)> DecodeFunction;
+	typedef std::function<void(const MjpegDecodedFrame& frame)> FrameCallback;
+
+	enum {
+		MAX_WORKERS = 8,
+	};
+
+	//workers 0 picks one per spare core up to MAX_WORKERS. slots 0 gives
+	//two per worker: one decoding and one waiting.
+	CMjpegDecodePipeline(int workers = 0, int slots = 0);
+	~CMjpegDecodePipeline();
+
+	//libyuv's MJPGToI420 unless set before Start.
+	void SetDecoder(DecodeFunction decoder);
+	bool Start(int width, int height, FrameCallback callback);
+	//frames still in flight are discarded. returns after the last callback.
+	void Stop();
+	bool IsRunning() const { return m_running; }
+
+	//copies the sample; false if it was dropped. flowId follows the frame
+	//through the trace, the capture's frame sequence.
+	bool Submit(const uint8_t* jpeg, size_t size, int64_t timestampUs, uint64_t flowId = 0);
+
+	int GetWorkerCount() const { return m_workerCount; }
+	MjpegPipelineStats GetStats() const;
+
+private:
+	struct Slot {
+		std::vector<uint8_t> jpeg;
+		std::vector<uint8_t> i420;
+		int64_t timestampUs = 0;
+		uint64_t sequence = 0;
+		uint64_t flowId = 0;
+		int64_t decodeNs = 0;
+		bool done = false;
+		bool ok = false;
+	};
+
+	void Run();
+	//hands out finished frames at the head of m_order. called with the lock
+	//held, which it drops around the callbacks.
+	void Deliver(std::unique_lock<std::mutex>& lock);
+
+	int m_workerCount;
+	int m_slotCount;
+	DecodeFunction m_decoder;
+	FrameCallback m_callback;
+	int m_width = 0;
+	int m_height = 0;
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::vector<std::unique_ptr<Slot>> m_slots;
+	std::vector<Slot*> m_free;
+	//waiting for a worker, oldest first.
+	std::deque<Slot*> m_pending;
+	//every slot in flight in submit order.
+	std::deque<Slot*> m_order;
+	bool m_delivering = false;
+	//also read by Submit's caller through IsRunning.
+	std::atomic<bool> m_running{ false };
+	uint64_t m_sequence = 0;
+	MjpegPipelineStats m_stats;
+	std::vector<std::thread> m_workers;
+};
@@ -0,0 +1,325 @@
+#ifdef __linux__
+#include "V4L2CaptureBackend.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/videodev2.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+	const int POLL_TIMEOUT_MS = 100;
+	//used when the driver does not list frame intervals.
+	const int DEFAULT_FPS = 30;
+
+	int Ioctl(int fd, unsigned long request, void* arg)
+	{
+		int ret;
+		do {
+			ret = ioctl(fd, request, arg);
+		} while (ret == -1 && errno == EINTR);
+		return ret;
+	}
+
+	int OpenDevice(const std::string& path)
+	{
+		return open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+	}
+
+	void AddIntervals(int fd, uint32_t pixelformat, uint32_t fourcc, int width, int height, std::vector<CaptureFormat>& formats)
+	{
+		CaptureFormat format;
+		format.media = CAPTURE_MEDIA_VIDEO;
+		format.fourcc = fourcc;
+		format.width = width;
+		format.height = height;
+		size_t before = formats.size();
+		v4l2_frmivalenum interval;
+		memset(&interval, 0, sizeof(interval));
+		interval.pixel_format = pixelformat;
+		interval.width = width;
+		interval.height = height;
+		while (Ioctl(fd, VIDIOC_ENUM_FRAMEINTERVALS, &interval) == 0) {
+			if (interval.type == V4L2_FRMIVAL_TYPE_DISCRETE) {
+				if (interval.discrete.numerator) {
+					format.fps = (int)((interval.discrete.denominator + interval.discrete.numerator / 2) / interval.discrete.numerator);
+					formats.push_back(format);
+				}
+			}
+			else {
+				//continuous or stepwise: the fastest rate only.
+				if (interval.stepwise.min.numerator) {
+					format.fps = (int)(interval.stepwise.min.denominator / interval.stepwise.min.numerator);
+					formats.push_back(format);
+				}
+				break;
+			}
+			++interval.index;
+		}
+		if (formats.size() == before) {
+			format.fps = DEFAULT_FPS;
+			formats.push_back(format);
+		}
+	}
+}
+
+CV4L2CaptureBackend::CV4L2CaptureBackend()
+	: m_capturing(false)
+{
+}
+
+CV4L2CaptureBackend::~CV4L2CaptureBackend()
+{
+	Close();
+}
+
+uint32_t CV4L2CaptureBackend::ToV4L2Format(uint32_t fourcc)
+{
+	switch (fourcc) {
+	case CAPTURE_FOURCC_I420: return V4L2_PIX_FMT_YUV420;
+	case CAPTURE_FOURCC_NV12: return V4L2_PIX_FMT_NV12;
+	case CAPTURE_FOURCC_YUY2: return V4L2_PIX_FMT_YUYV;
+	case CAPTURE_FOURCC_UYVY: return V4L2_PIX_FMT_UYVY;
+	case CAPTURE_FOURCC_MJPG: return V4L2_PIX_FMT_MJPEG;
+	case CAPTURE_FOURCC_BGR24: return V4L2_PIX_FMT_BGR24;
+	case CAPTURE_FOURCC_RGBA: return V4L2_PIX_FMT_RGBA32;
+	default: return 0;
+	}
+}
+
+uint32_t CV4L2CaptureBackend::FromV4L2Format(uint32_t pixelformat)
+{
+	switch (pixelformat) {
+	case V4L2_PIX_FMT_YUV420: return CAPTURE_FOURCC_I420;
+	case V4L2_PIX_FMT_NV12: return CAPTURE_FOURCC_NV12;
+	case V4L2_PIX_FMT_YUYV: return CAPTURE_FOURCC_YUY2;
+	case V4L2_PIX_FMT_UYVY: return CAPTURE_FOURCC_UYVY;
+	case V4L2_PIX_FMT_MJPEG: return CAPTURE_FOURCC_MJPG;
+	case V4L2_PIX_FMT_BGR24: return CAPTURE_FOURCC_BGR24;
+	case V4L2_PIX_FMT_RGBA32: return CAPTURE_FOURCC_RGBA;
+	default: return 0;
+	}
+}
+
+bool CV4L2CaptureBackend::EnumDevices(std::vector<CaptureDeviceInfo>& devices)
+{
+	m_devices.clear();
+	for (int i = 0; i < MAX_DEVICES; ++i) {
+		char path[32];
+		snprintf(path, sizeof(path), "/dev/video%d", i);
+		int fd = OpenDevice(path);
+		if (fd < 0)
+			continue;
+		v4l2_capability cap;
+		memset(&cap, 0, sizeof(cap));
+		if (Ioctl(fd, VIDIOC_QUERYCAP, &cap) == 0) {
+			uint32_t caps = (cap.capabilities & V4L2_CAP_DEVICE_CAPS) ? cap.device_caps : cap.capabilities;
+			if ((caps & V4L2_CAP_VIDEO_CAPTURE) && (caps & V4L2_CAP_STREAMING)) {
+				CaptureDeviceInfo info;
+				info.id = path;
+				info.name = (const char*)cap.card;
+				info.media = CAPTURE_MEDIA_VIDEO;
+				m_devices.push_back(info);
+			}
+		}
+		close(fd);
+	}
+	devices = m_devices;
+	return true;
+}
+
+bool CV4L2CaptureBackend::GetFormats(int device, std::vector<CaptureFormat>& formats)
+{
+	formats.clear();
+	if (device < 0 || device >= (int)m_devices.size())
+		return false;
+	int fd = OpenDevice(m_devices[device].id);
+	if (fd < 0)
+		return false;
+	v4l2_fmtdesc desc;
+	memset(&desc, 0, sizeof(desc));
+	desc.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	while (Ioctl(fd, VIDIOC_ENUM_FMT, &desc) == 0) {
+		uint32_t fourcc = FromV4L2Format(desc.pixelformat);
+		if (fourcc) {
+			v4l2_frmsizeenum size;
+			memset(&size, 0, sizeof(size));
+			size.pixel_format = desc.pixelformat;
+			while (Ioctl(fd, VIDIOC_ENUM_FRAMESIZES, &size) == 0) {
+				if (size.type == V4L2_FRMSIZE_TYPE_DISCRETE) {
+					AddIntervals(fd, desc.pixelformat, fourcc, size.discrete.width, size.discrete.height, formats);
+				}
+				else {
+					//continuous or stepwise: the largest size only.
+					AddIntervals(fd, desc.pixelformat, fourcc, size.stepwise.max_width, size.stepwise.max_height, formats);
+					break;
+				}
+				++size.index;
+			}
+		}
+		++desc.index;
+	}
+	close(fd);
+	return true;
+}
+
+bool CV4L2CaptureBackend::Open(int device, const CaptureFormat& format)
+{
+	Close();
+	uint32_t pixelformat = ToV4L2Format(format.fourcc);
+	if (device < 0 || device >= (int)m_devices.size() || format.media != CAPTURE_MEDIA_VIDEO || !pixelformat)
+		return false;
+	m_fd = OpenDevice(m_devices[device].id);
+	if (m_fd < 0)
+		return false;
+
+	v4l2_format fmt;
+	memset(&fmt, 0, sizeof(fmt));
+	fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	fmt.fmt.pix.width = format.width;
+	fmt.fmt.pix.height = format.height;
+	fmt.fmt.pix.pixelformat = pixelformat;
+	fmt.fmt.pix.field = V4L2_FIELD_ANY;
+	//the driver may adjust the format, only take it as asked.
+	if (Ioctl(m_fd, VIDIOC_S_FMT, &fmt) != 0 || fmt.fmt.pix.pixelformat != pixelformat
+		|| (int)fmt.fmt.pix.width != format.width || (int)fmt.fmt.pix.height != format.height) {
+		Close();
+		return false;
+	}
+	//not every driver lets the rate be set, that is not an error.
+	v4l2_streamparm parm;
+	memset(&parm, 0, sizeof(parm));
+	parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	parm.parm.capture.timeperframe.numerator = 1;
+	parm.parm.capture.timeperframe.denominator = format.fps > 0 ? format.fps : DEFAULT_FPS;
+	Ioctl(m_fd, VIDIOC_S_PARM, &parm);
+
+	v4l2_requestbuffers req;
+	memset(&req, 0, sizeof(req));
+	req.count = BUFFER_COUNT;
+	req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	req.memory = V4L2_MEMORY_MMAP;
+	if (Ioctl(m_fd, VIDIOC_REQBUFS, &req) != 0 || req.count == 0) {
+		Close();
+		return false;
+	}
+	m_bufferCount = req.count < BUFFER_COUNT ? (int)req.count : (int)BUFFER_COUNT;
+	for (int i = 0; i < m_bufferCount; ++i) {
+		v4l2_buffer buf;
+		memset(&buf, 0, sizeof(buf));
+		buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		buf.memory = V4L2_MEMORY_MMAP;
+		buf.index = i;
+		if (Ioctl(m_fd, VIDIOC_QUERYBUF, &buf) != 0) {
+			Close();
+			return false;
+		}
+		void* start = mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, buf.m.offset);
+		if (start == MAP_FAILED) {
+			Close();
+			return false;
+		}
+		m_buffers[i].start = start;
+		m_buffers[i].length = buf.length;
+	}
+	m_format = format;
+	return true;
+}
+
+void CV4L2CaptureBackend::ReleaseBuffers()
+{
+	for (int i = 0; i < m_bufferCount; ++i) {
+		if (m_buffers[i].start)
+			munmap(m_buffers[i].start, m_buffers[i].length);
+		m_buffers[i] = Buffer();
+	}
+	m_bufferCount = 0;
+}
+
+void CV4L2CaptureBackend::Close()
+{
+	Stop();
+	ReleaseBuffers();
+	if (m_fd >= 0) {
+		close(m_fd);
+		m_fd = -1;
+	}
+}
+
+bool CV4L2CaptureBackend::Start(FrameCallback callback)
+{
+	if (m_fd < 0 || m_capturing || !callback)
+		return false;
+	for (int i = 0; i < m_bufferCount; ++i) {
+		v4l2_buffer buf;
+		memset(&buf, 0, sizeof(buf));
+		buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		buf.memory = V4L2_MEMORY_MMAP;
+		buf.index = i;
+		if (Ioctl(m_fd, VIDIOC_QBUF, &buf) != 0)
+			return false;
+	}
+	int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	if (Ioctl(m_fd, VIDIOC_STREAMON, &type) != 0)
+		return false;
+	m_callback = callback;
+	m_capturing = true;
+	m_thread = std::thread(&CV4L2CaptureBackend::Run, this);
+	return true;
+}
+
+void CV4L2CaptureBackend::Stop()
+{
+	if (!m_capturing)
+		return;
+	m_capturing = false;
+	if (m_thread.joinable())
+		m_thread.join();
+	//STREAMOFF also takes back every queued buffer.
+	int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	Ioctl(m_fd, VIDIOC_STREAMOFF, &type);
+	m_callback = nullptr;
+}
+
+void CV4L2CaptureBackend::Run()
+{
+	while (m_capturing) {
+		pollfd pfd;
+		pfd.fd = m_fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		int ready = poll(&pfd, 1, POLL_TIMEOUT_MS);
+		if (ready < 0 && errno != EINTR)
+			break;
+		if (ready <= 0)
+			continue;
+
+		v4l2_buffer buf;
+		memset(&buf, 0, sizeof(buf));
+		buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		buf.memory = V4L2_MEMORY_MMAP;
+		if (Ioctl(m_fd, VIDIOC_DQBUF, &buf) != 0) {
+			if (errno == EAGAIN)
+				continue;
+			break;
+		}
+		if (buf.index < (uint32_t)m_bufferCount && !(buf.flags & V4L2_BUF_FLAG_ERROR)) {
+			CaptureFrame frame;
+			frame.data = (const uint8_t*)m_buffers[buf.index].start;
+			frame.size = buf.bytesused;
+			frame.format = &m_format;
+			//monotonic driver timestamps are on the CaptureClockUs clock.
+			if ((buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC)
+				frame.timestampUs = (int64_t)buf.timestamp.tv_sec * 1000000 + buf.timestamp.tv_usec;
+			else
+				frame.timestampUs = CaptureClockUs();
+			frame.sequence = buf.sequence;
+			m_callback(frame);
+		}
+		Ioctl(m_fd, VIDIOC_QBUF, &buf);
+	}
+}
+#endif
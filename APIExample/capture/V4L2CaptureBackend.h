@@ -0,0 +1,60 @@
+#pragma once
+#ifdef __linux__
+#include "CaptureBackend.h"
+#include <atomic>
+#include <thread>
+
+/*
+	Video4Linux2 capture: /dev/video* devices that can stream, formats
+	from VIDIOC_ENUM_FMT / ENUM_FRAMESIZES / ENUM_FRAMEINTERVALS, and
+	mmap streaming with BUFFER_COUNT driver buffers. A dequeued buffer is
+	handed to the callback as is and queued back when the callback
+	returns. Works with v4l2loopback devices fed from a file, which is
+	how it runs on machines without cameras.
+*/
+class CV4L2CaptureBackend : public ICaptureBackend
+{
+public:
+	enum {
+		MAX_DEVICES = 64,
+		BUFFER_COUNT = 4,
+	};
+
+	CV4L2CaptureBackend();
+	virtual ~CV4L2CaptureBackend();
+
+	virtual const char* GetName() const override { return "v4l2"; }
+	virtual bool EnumDevices(std::vector<CaptureDeviceInfo>& devices) override;
+	virtual bool GetFormats(int device, std::vector<CaptureFormat>& formats) override;
+	virtual bool Open(int device, const CaptureFormat& format) override;
+	virtual void Close() override;
+	virtual bool Start(FrameCallback callback) override;
+	virtual void Stop() override;
+	virtual bool IsCapturing() const override { return m_capturing; }
+
+	//the device's code for one of the CAPTURE_FOURCC formats and back, 0 if
+	//there is none.
+	static uint32_t ToV4L2Format(uint32_t fourcc);
+	static uint32_t FromV4L2Format(uint32_t pixelformat);
+
+private:
+	struct Buffer {
+		void* start = nullptr;
+		size_t length = 0;
+	};
+
+	void Run();
+	void ReleaseBuffers();
+
+	std::vector<CaptureDeviceInfo> m_devices;
+
+	int m_fd = -1;
+	CaptureFormat m_format;
+	Buffer m_buffers[BUFFER_COUNT];
+	int m_bufferCount = 0;
+
+	FrameCallback m_callback;
+	std::thread m_thread;
+	std::atomic<bool> m_capturing;
+};
+#endif
@@ -0,0 +1,247 @@
+#include "ChaCha20Poly1305.h"
+#include <string.h>
+
+namespace {
+	const uint32_t kSigma[4] = { 0x61707865, 0x3320646e, 0x79622d32, 0x6b206574 };
+	const uint32_t kLimbMask = 0x3ffffff;
+
+	inline uint32_t LoadLE32(const uint8_t* p)
+	{
+		return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+	}
+
+	inline void StoreLE32(uint8_t* p, uint32_t v)
+	{
+		p[0] = (uint8_t)v;
+		p[1] = (uint8_t)(v >> 8);
+		p[2] = (uint8_t)(v >> 16);
+		p[3] = (uint8_t)(v >> 24);
+	}
+
+	inline uint32_t Rotl(uint32_t x, int n)
+	{
+		return (x << n) | (x >> (32 - n));
+	}
+
+#define AG_QUARTER_ROUND(a, b, c, d) \
+	a += b; d = Rotl(d ^ a, 16); \
+	c += d; b = Rotl(b ^ c, 12); \
+	a += b; d = Rotl(d ^ a, 8); \
+	c += d; b = Rotl(b ^ c, 7);
+
+	//one 64 byte keystream block, then the counter moves on.
+	void ChaChaBlock(uint32_t state[16], uint8_t out[64])
+	{
+		uint32_t x[16];
+		memcpy(x, state, sizeof(x));
+		for (int i = 0; i < 10; ++i) {
+			AG_QUARTER_ROUND(x[0], x[4], x[8], x[12]);
+			AG_QUARTER_ROUND(x[1], x[5], x[9], x[13]);
+			AG_QUARTER_ROUND(x[2], x[6], x[10], x[14]);
+			AG_QUARTER_ROUND(x[3], x[7], x[11], x[15]);
+			AG_QUARTER_ROUND(x[0], x[5], x[10], x[15]);
+			AG_QUARTER_ROUND(x[1], x[6], x[11], x[12]);
+			AG_QUARTER_ROUND(x[2], x[7], x[8], x[13]);
+			AG_QUARTER_ROUND(x[3], x[4], x[9], x[14]);
+		}
+		for (int i = 0; i < 16; ++i)
+			StoreLE32(out + 4 * i, x[i] + state[i]);
+		++state[12];
+	}
+
+#undef AG_QUARTER_ROUND
+
+	//dst = src ^ keystream from the state's counter on.
+	void ChaChaXor(uint32_t state[16], const uint8_t* src, uint8_t* dst, size_t size)
+	{
+		uint8_t block[64];
+		while (size) {
+			ChaChaBlock(state, block);
+			size_t n = size < 64 ? size : 64;
+			for (size_t i = 0; i < n; ++i)
+				dst[i] = src[i] ^ block[i];
+			src += n;
+			dst += n;
+			size -= n;
+		}
+		memset(block, 0, sizeof(block));
+	}
+
+	//Poly1305 in five 26 bit limbs (the "donna" 32 bit layout).
+	class CPoly1305
+	{
+	public:
+		explicit CPoly1305(const uint8_t key[32])
+		{
+			m_r[0] = LoadLE32(key + 0) & 0x3ffffff;
+			m_r[1] = (LoadLE32(key + 3) >> 2) & 0x3ffff03;
+			m_r[2] = (LoadLE32(key + 6) >> 4) & 0x3ffc0ff;
+			m_r[3] = (LoadLE32(key + 9) >> 6) & 0x3f03fff;
+			m_r[4] = (LoadLE32(key + 12) >> 8) & 0x00fffff;
+			for (int i = 0; i < 4; ++i)
+				m_pad[i] = LoadLE32(key + 16 + 4 * i);
+			memset(m_h, 0, sizeof(m_h));
+		}
+
+		//whole blocks of message, a shorter tail is padded with zeros as
+		//the AEAD construction wants.
+		void UpdatePadded(const uint8_t* m, size_t size)
+		{
+			size_t whole = size & ~(size_t)15;
+			Blocks(m, whole);
+			if (size > whole) {
+				uint8_t block[16] = { 0 };
+				memcpy(block, m + whole, size - whole);
+				Blocks(block, 16);
+			}
+		}
+
+		void Finish(uint8_t tag[16])
+		{
+			uint32_t h0 = m_h[0], h1 = m_h[1], h2 = m_h[2], h3 = m_h[3], h4 = m_h[4];
+			uint32_t c = h1 >> 26; h1 &= kLimbMask;
+			h2 += c; c = h2 >> 26; h2 &= kLimbMask;
+			h3 += c; c = h3 >> 26; h3 &= kLimbMask;
+			h4 += c; c = h4 >> 26; h4 &= kLimbMask;
+			h0 += c * 5; c = h0 >> 26; h0 &= kLimbMask;
+			h1 += c;
+
+			//h - p, taken when it does not go negative.
+			uint32_t g0 = h0 + 5; c = g0 >> 26; g0 &= kLimbMask;
+			uint32_t g1 = h1 + c; c = g1 >> 26; g1 &= kLimbMask;
+			uint32_t g2 = h2 + c; c = g2 >> 26; g2 &= kLimbMask;
+			uint32_t g3 = h3 + c; c = g3 >> 26; g3 &= kLimbMask;
+			uint32_t g4 = h4 + c - (1u << 26);
+			uint32_t mask = (g4 >> 31) - 1;
+			h0 = (h0 & ~mask) | (g0 & mask);
+			h1 = (h1 & ~mask) | (g1 & mask);
+			h2 = (h2 & ~mask) | (g2 & mask);
+			h3 = (h3 & ~mask) | (g3 & mask);
+			h4 = (h4 & ~mask) | (g4 & mask);
+
+			//to 4 words, plus the pad.
+			uint32_t w0 = h0 | (h1 << 26);
+			uint32_t w1 = (h1 >> 6) | (h2 << 20);
+			uint32_t w2 = (h2 >> 12) | (h3 << 14);
+			uint32_t w3 = (h3 >> 18) | (h4 << 8);
+			uint64_t f = (uint64_t)w0 + m_pad[0];
+			StoreLE32(tag + 0, (uint32_t)f);
+			f = (uint64_t)w1 + m_pad[1] + (f >> 32);
+			StoreLE32(tag + 4, (uint32_t)f);
+			f = (uint64_t)w2 + m_pad[2] + (f >> 32);
+			StoreLE32(tag + 8, (uint32_t)f);
+			f = (uint64_t)w3 + m_pad[3] + (f >> 32);
+			StoreLE32(tag + 12, (uint32_t)f);
+		}
+
+	private:
+		void Blocks(const uint8_t* m, size_t size)
+		{
+			const uint32_t r0 = m_r[0], r1 = m_r[1], r2 = m_r[2], r3 = m_r[3], r4 = m_r[4];
+			const uint32_t s1 = r1 * 5, s2 = r2 * 5, s3 = r3 * 5, s4 = r4 * 5;
+			uint32_t h0 = m_h[0], h1 = m_h[1], h2 = m_h[2], h3 = m_h[3], h4 = m_h[4];
+			for (; size >= 16; m += 16, size -= 16) {
+				h0 += LoadLE32(m + 0) & kLimbMask;
+				h1 += (LoadLE32(m + 3) >> 2) & kLimbMask;
+				h2 += (LoadLE32(m + 6) >> 4) & kLimbMask;
+				h3 += (LoadLE32(m + 9) >> 6) & kLimbMask;
+				h4 += (LoadLE32(m + 12) >> 8) | (1u << 24);
+
+				uint64_t d0 = (uint64_t)h0 * r0 + (uint64_t)h1 * s4 + (uint64_t)h2 * s3 + (uint64_t)h3 * s2 + (uint64_t)h4 * s1;
+				uint64_t d1 = (uint64_t)h0 * r1 + (uint64_t)h1 * r0 + (uint64_t)h2 * s4 + (uint64_t)h3 * s3 + (uint64_t)h4 * s2;
+				uint64_t d2 = (uint64_t)h0 * r2 + (uint64_t)h1 * r1 + (uint64_t)h2 * r0 + (uint64_t)h3 * s4 + (uint64_t)h4 * s3;
+				uint64_t d3 = (uint64_t)h0 * r3 + (uint64_t)h1 * r2 + (uint64_t)h2 * r1 + (uint64_t)h3 * r0 + (uint64_t)h4 * s4;
+				uint64_t d4 = (uint64_t)h0 * r4 + (uint64_t)h1 * r3 + (uint64_t)h2 * r2 + (uint64_t)h3 * r1 + (uint64_t)h4 * r0;
+
+				uint32_t c = (uint32_t)(d0 >> 26); h0 = (uint32_t)d0 & kLimbMask;
+				d1 += c; c = (uint32_t)(d1 >> 26); h1 = (uint32_t)d1 & kLimbMask;
+				d2 += c; c = (uint32_t)(d2 >> 26); h2 = (uint32_t)d2 & kLimbMask;
+				d3 += c; c = (uint32_t)(d3 >> 26); h3 = (uint32_t)d3 & kLimbMask;
+				d4 += c; c = (uint32_t)(d4 >> 26); h4 = (uint32_t)d4 & kLimbMask;
+				h0 += c * 5; c = h0 >> 26; h0 &= kLimbMask;
+				h1 += c;
+			}
+			m_h[0] = h0;
+			m_h[1] = h1;
+			m_h[2] = h2;
+			m_h[3] = h3;
+			m_h[4] = h4;
+		}
+
+		uint32_t m_r[5];
+		uint32_t m_h[5];
+		uint32_t m_pad[4];
+	};
+}
+
+void CChaCha20Poly1305::SetKey(const uint8_t key[KEY_SIZE])
+{
+	for (int i = 0; i < 8; ++i)
+		m_key[i] = LoadLE32(key + 4 * i);
+}
+
+void CChaCha20Poly1305::Clear()
+{
+	memset(m_key, 0, sizeof(m_key));
+}
+
+void CChaCha20Poly1305::InitState(uint32_t state[16], const uint8_t nonce[NONCE_SIZE]) const
+{
+	memcpy(state, kSigma, sizeof(kSigma));
+	memcpy(state + 4, m_key, sizeof(m_key));
+	state[12] = 0;
+	state[13] = LoadLE32(nonce);
+	state[14] = LoadLE32(nonce + 4);
+	state[15] = LoadLE32(nonce + 8);
+}
+
+void CChaCha20Poly1305::ComputeTag(const uint32_t state[16], const uint8_t* aad, size_t aadSize,
+	const uint8_t* cipher, size_t size, uint8_t tag[TAG_SIZE]) const
+{
+	//the one time Poly1305 key is the first half of keystream block 0.
+	uint32_t keyState[16];
+	memcpy(keyState, state, sizeof(keyState));
+	keyState[12] = 0;
+	uint8_t block[64];
+	ChaChaBlock(keyState, block);
+	CPoly1305 poly(block);
+	poly.UpdatePadded(aad, aadSize);
+	poly.UpdatePadded(cipher, size);
+	uint8_t lengths[16];
+	StoreLE32(lengths + 0, (uint32_t)aadSize);
+	StoreLE32(lengths + 4, (uint32_t)((uint64_t)aadSize >> 32));
+	StoreLE32(lengths + 8, (uint32_t)size);
+	StoreLE32(lengths + 12, (uint32_t)((uint64_t)size >> 32));
+	poly.UpdatePadded(lengths, sizeof(lengths));
+	poly.Finish(tag);
+	memset(block, 0, sizeof(block));
+}
+
+void CChaCha20Poly1305::Seal(const uint8_t nonce[NONCE_SIZE], const uint8_t* aad, size_t aadSize,
+	const uint8_t* src, size_t size, uint8_t* dst, uint8_t tag[TAG_SIZE]) const
+{
+	uint32_t state[16];
+	InitState(state, nonce);
+	//the payload starts at block 1.
+	state[12] = 1;
+	ChaChaXor(state, src, dst, size);
+	ComputeTag(state, aad, aadSize, dst, size, tag);
+}
+
+bool CChaCha20Poly1305::Open(const uint8_t nonce[NONCE_SIZE], const uint8_t* aad, size_t aadSize,
+	const uint8_t* src, size_t size, const uint8_t tag[TAG_SIZE], uint8_t* dst) const
+{
+	uint32_t state[16];
+	InitState(state, nonce);
+	uint8_t expected[TAG_SIZE];
+	ComputeTag(state, aad, aadSize, src, size, expected);
+	//constant time, a forger learns nothing from how long the check took.
+	uint8_t diff = 0;
+	for (int i = 0; i < TAG_SIZE; ++i)
+		diff |= expected[i] ^ tag[i];
+	if (diff)
+		return false;
+	state[12] = 1;
+	ChaChaXor(state, src, dst, size);
+	return true;
+}
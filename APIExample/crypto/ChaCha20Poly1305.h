@@ -0,0 +1,39 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+	ChaCha20-Poly1305 AEAD (RFC 8439). The key is expanded into the ChaCha
+	input words once by SetKey, so a keyed object is all a packet needs
+	and copying one is cheap. Each nonce must be used once per key.
+	Open checks the tag before it decrypts and leaves dst untouched when
+	the packet is not authentic.
+*/
+class CChaCha20Poly1305
+{
+public:
+	enum {
+		KEY_SIZE = 32,
+		NONCE_SIZE = 12,
+		TAG_SIZE = 16,
+	};
+
+	CChaCha20Poly1305() { Clear(); }
+
+	void SetKey(const uint8_t key[KEY_SIZE]);
+	void Clear();
+
+	//dst may be src.
+	void Seal(const uint8_t nonce[NONCE_SIZE], const uint8_t* aad, size_t aadSize,
+		const uint8_t* src, size_t size, uint8_t* dst, uint8_t tag[TAG_SIZE]) const;
+	bool Open(const uint8_t nonce[NONCE_SIZE], const uint8_t* aad, size_t aadSize,
+		const uint8_t* src, size_t size, const uint8_t tag[TAG_SIZE], uint8_t* dst) const;
+
+private:
+	//the 16 input words with the counter and nonce filled in.
+	void InitState(uint32_t state[16], const uint8_t nonce[NONCE_SIZE]) const;
+	void ComputeTag(const uint32_t state[16], const uint8_t* aad, size_t aadSize,
+		const uint8_t* cipher, size_t size, uint8_t tag[TAG_SIZE]) const;
+
+	uint32_t m_key[8];
+};
@@ -0,0 +1,193 @@
+#include "KeyRotatingPacketObserver.h"
+#include "trace/Trace.h"
+#include <chrono>
+#include <random>
+#include <string.h>
+
+namespace {
+	int64_t NowNs()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void StoreBE(uint8_t* p, uint64_t v, int bytes)
+	{
+		for (int i = bytes - 1; i >= 0; --i, v >>= 8)
+			p[i] = (uint8_t)v;
+	}
+
+	uint64_t LoadBE(const uint8_t* p, int bytes)
+	{
+		uint64_t v = 0;
+		for (int i = 0; i < bytes; ++i)
+			v = (v << 8) | p[i];
+		return v;
+	}
+}
+
+CKeyRotatingPacketObserver::CKeyRotatingPacketObserver()
+	: m_counter(0)
+{
+	std::random_device random;
+	m_sender = ((uint64_t)random() << 32) | random();
+	//the engine expects packet buffers of at least 2048 bytes.
+	m_sendAudio.reserve(2048);
+	m_sendVideo.reserve(2048);
+	m_receiveAudio.reserve(2048);
+	m_receiveVideo.reserve(2048);
+}
+
+bool CKeyRotatingPacketObserver::Seal(std::vector<uint8_t>& buffer, Packet& packet)
+{
+	int64_t start = NowNs();
+	uint32_t epoch;
+	CChaCha20Poly1305 cipher;
+	//no key, no media: sending in the clear is never the fallback.
+	if (!m_schedule.GetSendKey(CMediaKeySchedule::NowMs(), &epoch, &cipher))
+		return false;
+	size_t size = packet.size;
+	buffer.resize(size + OVERHEAD);
+	uint8_t* header = buffer.data();
+	uint64_t counter = m_counter.fetch_add(1);
+	StoreBE(header, epoch, 4);
+	StoreBE(header + 4, m_sender + (counter >> 32), 8);
+	StoreBE(header + 12, counter, 4);
+	cipher.Seal(header + 4, header, HEADER_SIZE, packet.buffer, size,
+		header + HEADER_SIZE, header + HEADER_SIZE + size);
+	cipher.Clear();
+	packet.buffer = buffer.data();
+	packet.size = (unsigned int)buffer.size();
+	int64_t ns = NowNs() - start;
+
+	std::lock_guard<std::mutex> lock(m_statsMutex);
+	if (m_stats.sent && epoch != m_stats.sendEpoch)
+		++m_stats.rotations;
+	m_stats.sendEpoch = epoch;
+	++m_stats.sent;
+	m_stats.bytesSent += size;
+	m_stats.nsSealTotal += ns;
+	return true;
+}
+
+bool CKeyRotatingPacketObserver::Open(std::vector<uint8_t>& buffer, Packet& packet)
+{
+	int64_t start = NowNs();
+	if (packet.size < OVERHEAD) {
+		std::lock_guard<std::mutex> lock(m_statsMutex);
+		++m_stats.rejectedFormat;
+		return false;
+	}
+	const uint8_t* header = packet.buffer;
+	size_t size = packet.size - OVERHEAD;
+	CChaCha20Poly1305 cipher;
+	if (!m_schedule.GetReceiveKey((uint32_t)LoadBE(header, 4), CMediaKeySchedule::NowMs(), &cipher)) {
+		std::lock_guard<std::mutex> lock(m_statsMutex);
+		++m_stats.rejectedEpoch;
+		return false;
+	}
+	if (buffer.capacity() < 2048)
+		buffer.reserve(2048);
+	buffer.resize(size);
+	bool authentic = cipher.Open(header + 4, header, HEADER_SIZE, header + HEADER_SIZE, size,
+		header + HEADER_SIZE + size, buffer.data());
+	cipher.Clear();
+	int64_t ns = NowNs() - start;
+
+	std::lock_guard<std::mutex> lock(m_statsMutex);
+	if (!authentic) {
+		++m_stats.rejectedTag;
+		return false;
+	}
+	//only authentic packets move the window, forged ones cannot push it.
+	if (!AcceptCounterLocked(LoadBE(header + 4, 8), (uint32_t)LoadBE(header + 12, 4))) {
+		++m_stats.rejectedReplay;
+		return false;
+	}
+	packet.buffer = buffer.data();
+	packet.size = (unsigned int)size;
+	++m_stats.received;
+	m_stats.bytesReceived += size;
+	m_stats.nsOpenTotal += ns;
+	return true;
+}
+
+bool CKeyRotatingPacketObserver::AcceptCounterLocked(uint64_t sender, uint32_t counter)
+{
+	ReplayWindow* window = nullptr;
+	ReplayWindow* oldest = &m_replay[0];
+	for (ReplayWindow& candidate : m_replay) {
+		if (candidate.valid && candidate.sender == sender) {
+			window = &candidate;
+			break;
+		}
+		if (!candidate.valid || (oldest->valid && candidate.lastUse < oldest->lastUse))
+			oldest = &candidate;
+	}
+	//a counter past the newest is always new.
+	bool newer = true;
+	if (!window) {
+		window = oldest;
+		window->valid = true;
+		window->sender = sender;
+		window->newest = counter;
+		memset(window->seen, 0, sizeof(window->seen));
+	}
+	else if (counter > window->newest) {
+		//the counters passed over have not been seen.
+		if (counter - window->newest >= REPLAY_WINDOW)
+			memset(window->seen, 0, sizeof(window->seen));
+		else {
+			for (uint32_t skipped = window->newest + 1; skipped != counter; ++skipped)
+				window->seen[skipped / 64 % (REPLAY_WINDOW / 64)] &= ~(1ull << (skipped % 64));
+		}
+		window->newest = counter;
+	}
+	else if (window->newest - counter >= REPLAY_WINDOW)
+		return false;
+	else
+		newer = false;
+	uint64_t& word = window->seen[counter / 64 % (REPLAY_WINDOW / 64)];
+	uint64_t bit = 1ull << (counter % 64);
+	if (!newer && (word & bit))
+		return false;
+	word |= bit;
+	window->lastUse = ++m_replayUses;
+	return true;
+}
+
+bool CKeyRotatingPacketObserver::onSendAudioPacket(Packet& packet)
+{
+	AG_TRACE_SCOPE1("sdk", "onSendAudioPacket", "size", packet.size);
+	return Seal(m_sendAudio, packet);
+}
+
+bool CKeyRotatingPacketObserver::onSendVideoPacket(Packet& packet)
+{
+	AG_TRACE_SCOPE1("sdk", "onSendVideoPacket", "size", packet.size);
+	return Seal(m_sendVideo, packet);
+}
+
+bool CKeyRotatingPacketObserver::onReceiveAudioPacket(Packet& packet)
+{
+	AG_TRACE_SCOPE1("sdk", "onReceiveAudioPacket", "size", packet.size);
+	return Open(m_receiveAudio, packet);
+}
+
+bool CKeyRotatingPacketObserver::onReceiveVideoPacket(Packet& packet)
+{
+	AG_TRACE_SCOPE1("sdk", "onReceiveVideoPacket", "size", packet.size);
+	return Open(m_receiveVideo, packet);
+}
+
+KeyRotationPacketStats CKeyRotatingPacketObserver::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_statsMutex);
+	return m_stats;
+}
+
+void CKeyRotatingPacketObserver::ResetStats()
+{
+	std::lock_guard<std::mutex> lock(m_statsMutex);
+	m_stats = KeyRotationPacketStats();
+}
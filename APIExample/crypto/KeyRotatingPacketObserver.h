@@ -0,0 +1,99 @@
+#pragma once
+#include "MediaKeySchedule.h"
+#include <IAgoraRtcEngine.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+struct KeyRotationPacketStats {
+	uint64_t sent = 0;
+	uint64_t received = 0;
+	//received packets dropped: too short, an epoch outside its window, a
+	//tag that does not match, or a counter seen before or too far behind.
+	uint64_t rejectedFormat = 0;
+	uint64_t rejectedEpoch = 0;
+	uint64_t rejectedTag = 0;
+	uint64_t rejectedReplay = 0;
+	uint64_t bytesSent = 0;
+	uint64_t bytesReceived = 0;
+	int64_t nsSealTotal = 0;
+	int64_t nsOpenTotal = 0;
+	//epoch of the last packet sent, and how often it changed.
+	uint32_t sendEpoch = 0;
+	uint64_t rotations = 0;
+
+	double GetSealMBps() const { return nsSealTotal ? bytesSent * 1e3 / nsSealTotal : 0; }
+	double GetOpenMBps() const { return nsOpenTotal ? bytesReceived * 1e3 / nsOpenTotal : 0; }
+};
+
+/*
+	An IPacketObserver that encrypts every packet with ChaCha20-Poly1305
+	under the key of the current CMediaKeySchedule epoch. Each packet
+	carries a 16 byte header, sent in the clear and authenticated:
+		epoch     4 bytes, big endian
+		sender    8 bytes, random per observer
+		counter   4 bytes, big endian, one per packet sent
+	and the 16 byte tag after the payload. Sender and counter are the
+	nonce. When the counter wraps the sender moves on by one, so an
+	observer never repeats a nonce, and two clients only collide when
+	they draw the same 64 bit sender. A receiver picks the key by the
+	epoch, so during the overlap packets of the old and the new epoch
+	decrypt side by side. Packets that do not authenticate are dropped,
+	and so are authentic ones whose counter was seen before or is
+	REPLAY_WINDOW or more behind the sender's newest.
+*/
+class CKeyRotatingPacketObserver : public agora::rtc::IPacketObserver
+{
+public:
+	enum {
+		HEADER_SIZE = 16,
+		OVERHEAD = HEADER_SIZE + CChaCha20Poly1305::TAG_SIZE,
+		//counters a packet may trail the newest one of its sender by, for
+		//reordering between the audio and video paths and in the network.
+		REPLAY_WINDOW = 1024,
+		//senders with a replay window, the least recently heard goes.
+		REPLAY_SENDERS = 64,
+	};
+
+	CKeyRotatingPacketObserver();
+
+	CMediaKeySchedule& GetSchedule() { return m_schedule; }
+	KeyRotationPacketStats GetStats() const;
+	void ResetStats();
+
+	virtual bool onSendAudioPacket(Packet& packet) override;
+	virtual bool onSendVideoPacket(Packet& packet) override;
+	virtual bool onReceiveAudioPacket(Packet& packet) override;
+	virtual bool onReceiveVideoPacket(Packet& packet) override;
+
+private:
+	struct ReplayWindow {
+		bool valid = false;
+		uint64_t sender = 0;
+		uint32_t newest = 0;
+		//bit counter % REPLAY_WINDOW is set for the counters seen.
+		uint64_t seen[REPLAY_WINDOW / 64];
+		uint64_t lastUse = 0;
+	};
+
+	bool Seal(std::vector<uint8_t>& buffer, Packet& packet);
+	bool Open(std::vector<uint8_t>& buffer, Packet& packet);
+	//marks the counter seen, false when it was or is out of the window.
+	bool AcceptCounterLocked(uint64_t sender, uint32_t counter);
+
+	CMediaKeySchedule m_schedule;
+	uint64_t m_sender = 0;
+	//the low 32 bits are the counter sent, the high ones are added to the
+	//sender.
+	std::atomic<uint64_t> m_counter;
+	//guards the stats and the replay windows.
+	mutable std::mutex m_statsMutex;
+	KeyRotationPacketStats m_stats;
+	ReplayWindow m_replay[REPLAY_SENDERS];
+	uint64_t m_replayUses = 0;
+	//what the engine is handed for each of the four paths.
+	std::vector<uint8_t> m_sendAudio;
+	std::vector<uint8_t> m_sendVideo;
+	std::vector<uint8_t> m_receiveAudio;
+	std::vector<uint8_t> m_receiveVideo;
+};
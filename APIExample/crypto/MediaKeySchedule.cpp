@@ -0,0 +1,150 @@
+#include "MediaKeySchedule.h"
+#include <chrono>
+#include <string.h>
+
+namespace {
+	const char kEpochLabel[] = "/media-epoch/";
+
+	int64_t NowNs()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+}
+
+bool CMediaKeySchedule::SetConfig(const MediaKeyScheduleConfig& config)
+{
+	if (config.masterSecret.empty() || config.epochMs < 1000
+		|| config.overlapMs < 0 || config.overlapMs > config.epochMs
+		|| config.lookahead < 1 || config.lookahead > 4)
+		return false;
+	uint8_t prk[CSha256::DIGEST_SIZE];
+	HkdfExtract(config.salt.data(), config.salt.size(), config.masterSecret.data(), config.masterSecret.size(), prk);
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_prk.SetKey(prk, sizeof(prk));
+	memset(prk, 0, sizeof(prk));
+	m_config = config;
+	//the prk is all the keys need, no copy of the secret is kept.
+	m_config.masterSecret.assign(m_config.masterSecret.size(), '\0');
+	m_config.masterSecret.clear();
+	for (Slot& slot : m_slots) {
+		slot.valid = false;
+		slot.cipher.Clear();
+	}
+	m_ready = true;
+	return true;
+}
+
+void CMediaKeySchedule::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_ready = false;
+	m_prk.SetKey(nullptr, 0);
+	for (Slot& slot : m_slots) {
+		slot.valid = false;
+		slot.cipher.Clear();
+	}
+}
+
+bool CMediaKeySchedule::IsReady() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_ready;
+}
+
+int64_t CMediaKeySchedule::GetEpochMs() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_config.epochMs;
+}
+
+int64_t CMediaKeySchedule::NowMs()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+uint32_t CMediaKeySchedule::GetEpoch(int64_t nowMs) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return (uint32_t)(nowMs / m_config.epochMs);
+}
+
+void CMediaKeySchedule::Advance(int64_t nowMs)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_ready)
+		return;
+	uint32_t epoch = (uint32_t)(nowMs / m_config.epochMs);
+	for (uint32_t e = epoch ? epoch - 1 : 0; e <= epoch + (uint32_t)m_config.lookahead; ++e)
+		GetKeyLocked(e, false);
+}
+
+bool CMediaKeySchedule::GetSendKey(int64_t nowMs, uint32_t* epoch, CChaCha20Poly1305* cipher)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_ready)
+		return false;
+	*epoch = (uint32_t)(nowMs / m_config.epochMs);
+	*cipher = GetKeyLocked(*epoch, true);
+	return true;
+}
+
+bool CMediaKeySchedule::GetReceiveKey(uint32_t epoch, int64_t nowMs, CChaCha20Poly1305* cipher)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_ready || !IsAcceptedLocked(epoch, nowMs))
+		return false;
+	*cipher = GetKeyLocked(epoch, true);
+	return true;
+}
+
+bool CMediaKeySchedule::IsAcceptedLocked(uint32_t epoch, int64_t nowMs) const
+{
+	int64_t start = (int64_t)epoch * m_config.epochMs;
+	return nowMs >= start - m_config.overlapMs && nowMs < start + m_config.epochMs + m_config.overlapMs;
+}
+
+const CChaCha20Poly1305& CMediaKeySchedule::GetKeyLocked(uint32_t epoch, bool packetPath)
+{
+	Slot& slot = m_slots[epoch % SLOTS];
+	if (!slot.valid || slot.epoch != epoch) {
+		if (packetPath)
+			++m_stats.misses;
+		DeriveLocked(epoch, slot);
+	}
+	return slot.cipher;
+}
+
+void CMediaKeySchedule::DeriveLocked(uint32_t epoch, Slot& slot)
+{
+	int64_t start = NowNs();
+	//context | label | epoch big endian.
+	std::string info = m_config.context;
+	info.append(kEpochLabel, sizeof(kEpochLabel) - 1);
+	for (int shift = 24; shift >= 0; shift -= 8)
+		info.push_back((char)(uint8_t)(epoch >> shift));
+	uint8_t key[CChaCha20Poly1305::KEY_SIZE];
+	HkdfExpand(m_prk, info.data(), info.size(), key, sizeof(key));
+	slot.cipher.SetKey(key);
+	memset(key, 0, sizeof(key));
+	slot.epoch = epoch;
+	slot.valid = true;
+	int64_t ns = NowNs() - start;
+	++m_stats.derivations;
+	m_stats.nsDeriveTotal += ns;
+	if (ns > m_stats.nsDeriveMax)
+		m_stats.nsDeriveMax = ns;
+}
+
+MediaKeyScheduleStats CMediaKeySchedule::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
+
+void CMediaKeySchedule::ResetStats()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stats = MediaKeyScheduleStats();
+}
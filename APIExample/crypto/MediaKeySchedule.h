@@ -0,0 +1,95 @@
+#pragma once
+#include "ChaCha20Poly1305.h"
+#include "Sha256.h"
+#include <mutex>
+#include <stdint.h>
+#include <string>
+
+struct MediaKeyScheduleConfig {
+	//shared by everyone in the channel, never sent.
+	std::string masterSecret;
+	//public and the same for everyone, like the KDF salt from the server.
+	std::string salt;
+	//binds the keys to one use, like the channel name.
+	std::string context;
+	//every client moves to the next key at the same wall clock times, at
+	//multiples of epochMs since 1970. At least a second, which keeps the
+	//epoch numbers in 32 bits.
+	int64_t epochMs = 60000;
+	//how long before and after its epoch a key is still accepted, for
+	//clock differences between clients and packets in flight. At most
+	//epochMs.
+	int64_t overlapMs = 5000;
+	//epochs derived ahead of the current one, 1 to 4.
+	int lookahead = 2;
+};
+
+struct MediaKeyScheduleStats {
+	uint64_t derivations = 0;
+	//keys the packet path had to derive itself because Advance was late.
+	uint64_t misses = 0;
+	int64_t nsDeriveTotal = 0;
+	int64_t nsDeriveMax = 0;
+
+	double GetDeriveUsAverage() const { return derivations ? nsDeriveTotal / 1e3 / derivations : 0; }
+};
+
+/*
+	Media keys by epoch, derived from a master secret:
+		prk       = HKDF-Extract(salt, masterSecret)
+		key(e)    = HKDF-Expand(prk, context | "/media-epoch/" | e, 32)
+	so every client computes the same key for an epoch without any key
+	exchange. The keys of the previous, current and next few epochs sit in
+	a small cache which Advance refills from a timer, so the packet path
+	only copies a keyed cipher out of it. A key is accepted overlapMs
+	either side of its epoch, which lets old and new keys both decrypt
+	across a rotation and makes the switch seamless.
+*/
+class CMediaKeySchedule
+{
+public:
+	enum {
+		SLOTS = 8,
+	};
+
+	//false, and nothing changes, for an empty secret or limits out of range.
+	bool SetConfig(const MediaKeyScheduleConfig& config);
+	//forgets the secret and every key.
+	void Clear();
+	bool IsReady() const;
+	int64_t GetEpochMs() const;
+
+	//wall clock, milliseconds since 1970.
+	static int64_t NowMs();
+	uint32_t GetEpoch(int64_t nowMs) const;
+	//derives the keys from the previous epoch to lookahead ahead.
+	void Advance(int64_t nowMs);
+
+	//the key to send with at nowMs.
+	bool GetSendKey(int64_t nowMs, uint32_t* epoch, CChaCha20Poly1305* cipher);
+	//the key of a received epoch, false outside its window.
+	bool GetReceiveKey(uint32_t epoch, int64_t nowMs, CChaCha20Poly1305* cipher);
+
+	MediaKeyScheduleStats GetStats() const;
+	void ResetStats();
+
+private:
+	struct Slot {
+		bool valid = false;
+		uint32_t epoch = 0;
+		CChaCha20Poly1305 cipher;
+	};
+
+	bool IsAcceptedLocked(uint32_t epoch, int64_t nowMs) const;
+	//from the cache, deriving on a miss.
+	const CChaCha20Poly1305& GetKeyLocked(uint32_t epoch, bool packetPath);
+	void DeriveLocked(uint32_t epoch, Slot& slot);
+
+	mutable std::mutex m_mutex;
+	bool m_ready = false;
+	MediaKeyScheduleConfig m_config;
+	CHmacSha256 m_prk;
+	//direct mapped by epoch % SLOTS.
+	Slot m_slots[SLOTS];
+	MediaKeyScheduleStats m_stats;
+};
@@ -0,0 +1,204 @@
+#include "Sha256.h"
+#include <string.h>
+
+namespace {
+	const uint32_t kRound[64] = {
+		0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+		0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+		0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+		0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+		0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+		0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+		0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+		0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+	};
+
+	inline uint32_t Rotr(uint32_t x, int n)
+	{
+		return (x >> n) | (x << (32 - n));
+	}
+
+	inline uint32_t LoadBE32(const uint8_t* p)
+	{
+		return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+	}
+
+	inline void StoreBE32(uint8_t* p, uint32_t v)
+	{
+		p[0] = (uint8_t)(v >> 24);
+		p[1] = (uint8_t)(v >> 16);
+		p[2] = (uint8_t)(v >> 8);
+		p[3] = (uint8_t)v;
+	}
+}
+
+void CSha256::Init()
+{
+	m_state[0] = 0x6a09e667;
+	m_state[1] = 0xbb67ae85;
+	m_state[2] = 0x3c6ef372;
+	m_state[3] = 0xa54ff53a;
+	m_state[4] = 0x510e527f;
+	m_state[5] = 0x9b05688c;
+	m_state[6] = 0x1f83d9ab;
+	m_state[7] = 0x5be0cd19;
+	m_length = 0;
+	m_blockUsed = 0;
+}
+
+void CSha256::Compress(const uint8_t block[BLOCK_SIZE])
+{
+	uint32_t w[64];
+	for (int i = 0; i < 16; ++i)
+		w[i] = LoadBE32(block + 4 * i);
+	for (int i = 16; i < 64; ++i) {
+		uint32_t s0 = Rotr(w[i - 15], 7) ^ Rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+		uint32_t s1 = Rotr(w[i - 2], 17) ^ Rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+		w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+	}
+	uint32_t a = m_state[0], b = m_state[1], c = m_state[2], d = m_state[3];
+	uint32_t e = m_state[4], f = m_state[5], g = m_state[6], h = m_state[7];
+	for (int i = 0; i < 64; ++i) {
+		uint32_t t1 = h + (Rotr(e, 6) ^ Rotr(e, 11) ^ Rotr(e, 25)) + ((e & f) ^ (~e & g)) + kRound[i] + w[i];
+		uint32_t t2 = (Rotr(a, 2) ^ Rotr(a, 13) ^ Rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+		h = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+	m_state[0] += a;
+	m_state[1] += b;
+	m_state[2] += c;
+	m_state[3] += d;
+	m_state[4] += e;
+	m_state[5] += f;
+	m_state[6] += g;
+	m_state[7] += h;
+}
+
+void CSha256::Update(const void* data, size_t size)
+{
+	if (!size)
+		return;
+	const uint8_t* p = static_cast<const uint8_t*>(data);
+	m_length += size;
+	if (m_blockUsed) {
+		size_t take = BLOCK_SIZE - m_blockUsed;
+		if (take > size)
+			take = size;
+		memcpy(m_block + m_blockUsed, p, take);
+		m_blockUsed += take;
+		p += take;
+		size -= take;
+		if (m_blockUsed < BLOCK_SIZE)
+			return;
+		Compress(m_block);
+		m_blockUsed = 0;
+	}
+	for (; size >= BLOCK_SIZE; p += BLOCK_SIZE, size -= BLOCK_SIZE)
+		Compress(p);
+	memcpy(m_block, p, size);
+	m_blockUsed = size;
+}
+
+void CSha256::Final(uint8_t digest[DIGEST_SIZE])
+{
+	uint64_t bits = m_length * 8;
+	uint8_t pad[BLOCK_SIZE + 8] = { 0x80 };
+	size_t padSize = (m_blockUsed < 56 ? 56 : 120) - m_blockUsed;
+	for (int i = 0; i < 8; ++i)
+		pad[padSize + i] = (uint8_t)(bits >> (56 - 8 * i));
+	Update(pad, padSize + 8);
+	for (int i = 0; i < 8; ++i)
+		StoreBE32(digest + 4 * i, m_state[i]);
+}
+
+void CSha256::Hash(const void* data, size_t size, uint8_t digest[DIGEST_SIZE])
+{
+	CSha256 sha;
+	sha.Update(data, size);
+	sha.Final(digest);
+}
+
+void CHmacSha256::SetKey(const void* key, size_t size)
+{
+	uint8_t block[CSha256::BLOCK_SIZE] = { 0 };
+	if (size > CSha256::BLOCK_SIZE)
+		CSha256::Hash(key, size, block);
+	else if (size)
+		memcpy(block, key, size);
+	uint8_t pad[CSha256::BLOCK_SIZE];
+	for (int i = 0; i < CSha256::BLOCK_SIZE; ++i)
+		pad[i] = block[i] ^ 0x36;
+	m_inner.Init();
+	m_inner.Update(pad, sizeof(pad));
+	for (int i = 0; i < CSha256::BLOCK_SIZE; ++i)
+		pad[i] = block[i] ^ 0x5c;
+	m_outer.Init();
+	m_outer.Update(pad, sizeof(pad));
+	memset(block, 0, sizeof(block));
+	memset(pad, 0, sizeof(pad));
+}
+
+void CHmacSha256::Compute(const void* data, size_t size, uint8_t mac[CSha256::DIGEST_SIZE]) const
+{
+	CSha256 sha = m_inner;
+	sha.Update(data, size);
+	Finish(sha, mac);
+}
+
+void CHmacSha256::Finish(CSha256& inner, uint8_t mac[CSha256::DIGEST_SIZE]) const
+{
+	uint8_t digest[CSha256::DIGEST_SIZE];
+	inner.Final(digest);
+	CSha256 sha = m_outer;
+	sha.Update(digest, sizeof(digest));
+	sha.Final(mac);
+}
+
+void HkdfExtract(const void* salt, size_t saltSize, const void* ikm, size_t ikmSize,
+	uint8_t prk[CSha256::DIGEST_SIZE])
+{
+	//no salt is a salt of DIGEST_SIZE zeros, which HMAC pads to the same key.
+	CHmacSha256 hmac;
+	hmac.SetKey(salt, saltSize);
+	hmac.Compute(ikm, ikmSize, prk);
+}
+
+bool HkdfExpand(const CHmacSha256& prk, const void* info, size_t infoSize, uint8_t* out, size_t outSize)
+{
+	if (outSize > 255 * CSha256::DIGEST_SIZE)
+		return false;
+	//T(i) = HMAC(prk, T(i - 1) | info | i), T(0) empty.
+	uint8_t t[CSha256::DIGEST_SIZE];
+	size_t tSize = 0;
+	for (uint8_t counter = 1; outSize; ++counter) {
+		CSha256 sha = prk.Begin();
+		sha.Update(t, tSize);
+		sha.Update(info, infoSize);
+		sha.Update(&counter, 1);
+		prk.Finish(sha, t);
+		tSize = CSha256::DIGEST_SIZE;
+		size_t take = outSize < tSize ? outSize : tSize;
+		memcpy(out, t, take);
+		out += take;
+		outSize -= take;
+	}
+	memset(t, 0, sizeof(t));
+	return true;
+}
+
+bool Hkdf(const void* salt, size_t saltSize, const void* ikm, size_t ikmSize,
+	const void* info, size_t infoSize, uint8_t* out, size_t outSize)
+{
+	uint8_t prk[CSha256::DIGEST_SIZE];
+	HkdfExtract(salt, saltSize, ikm, ikmSize, prk);
+	CHmacSha256 hmac;
+	hmac.SetKey(prk, sizeof(prk));
+	memset(prk, 0, sizeof(prk));
+	return HkdfExpand(hmac, info, infoSize, out, outSize);
+}
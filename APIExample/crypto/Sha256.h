@@ -0,0 +1,61 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+//FIPS 180-4 SHA-256.
+class CSha256
+{
+public:
+	enum {
+		DIGEST_SIZE = 32,
+		BLOCK_SIZE = 64,
+	};
+
+	CSha256() { Init(); }
+
+	void Init();
+	void Update(const void* data, size_t size);
+	void Final(uint8_t digest[DIGEST_SIZE]);
+
+	static void Hash(const void* data, size_t size, uint8_t digest[DIGEST_SIZE]);
+
+private:
+	void Compress(const uint8_t block[BLOCK_SIZE]);
+
+	uint32_t m_state[8];
+	uint64_t m_length = 0;
+	uint8_t m_block[BLOCK_SIZE];
+	size_t m_blockUsed = 0;
+};
+
+/*
+	HMAC-SHA256 (RFC 2104) with the key absorbed once: the inner and outer
+	pads are hashed by SetKey, so each Compute on a short message costs
+	only the two final compressions. Copyable, a copy is a keyed state.
+*/
+class CHmacSha256
+{
+public:
+	void SetKey(const void* key, size_t size);
+
+	void Compute(const void* data, size_t size, uint8_t mac[CSha256::DIGEST_SIZE]) const;
+	//a message in parts: sha = Begin(), sha.Update each part, Finish(sha).
+	CSha256 Begin() const { return m_inner; }
+	void Finish(CSha256& inner, uint8_t mac[CSha256::DIGEST_SIZE]) const;
+
+private:
+	CSha256 m_inner;
+	CSha256 m_outer;
+};
+
+/*
+	HKDF-SHA256 (RFC 5869). Extract turns the input keying material and a
+	salt into the pseudorandom key; Expand stretches it into up to 255 * 32
+	bytes bound to info. Expand with a CHmacSha256 keyed with the
+	pseudorandom key skips the pad hashing for each derivation.
+*/
+void HkdfExtract(const void* salt, size_t saltSize, const void* ikm, size_t ikmSize,
+	uint8_t prk[CSha256::DIGEST_SIZE]);
+bool HkdfExpand(const CHmacSha256& prk, const void* info, size_t infoSize, uint8_t* out, size_t outSize);
+bool Hkdf(const void* salt, size_t saltSize, const void* ikm, size_t ikmSize,
+	const void* info, size_t infoSize, uint8_t* out, size_t outSize);
@@ -0,0 +1,341 @@
+#include "AudioResampler.h"
+#include "CpuFeatures.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+namespace {
+	const double kPi = 3.14159265358979323846;
+	//the phase table is exact up to this many phases, above it neighbouring
+	//phases are linearly interpolated (e.g. 44100 <-> 47999).
+	const int kMaxPhases = 512;
+	//output samples kept in reserve so rounding of per-frame sample counts
+	//never underruns the caller.
+	const int kOutputSlack = 2;
+
+	int Gcd(int a, int b)
+	{
+		while (b) {
+			int t = a % b;
+			a = b;
+			b = t;
+		}
+		return a;
+	}
+
+	//zeroth order modified Bessel function of the first kind.
+	double BesselI0(double x)
+	{
+		double sum = 1.0, term = 1.0, half = x / 2.0;
+		for (int k = 1; k < 50; ++k) {
+			term *= (half / k) * (half / k);
+			sum += term;
+			if (term < sum * 1e-12)
+				break;
+		}
+		return sum;
+	}
+
+	float DotProductC(const float* a, const float* b, int n)
+	{
+		float s0 = 0.f, s1 = 0.f, s2 = 0.f, s3 = 0.f;
+		int i = 0;
+		for (; i + 4 <= n; i += 4) {
+			s0 += a[i] * b[i];
+			s1 += a[i + 1] * b[i + 1];
+			s2 += a[i + 2] * b[i + 2];
+			s3 += a[i + 3] * b[i + 3];
+		}
+		for (; i < n; ++i)
+			s0 += a[i] * b[i];
+		return (s0 + s1) + (s2 + s3);
+	}
+
+	//n is always a multiple of 8, see BuildFilterBank.
+	AG_TARGET_AVX2 float DotProductAVX2(const float* a, const float* b, int n)
+	{
+		__m256 acc0 = _mm256_setzero_ps();
+		__m256 acc1 = _mm256_setzero_ps();
+		int i = 0;
+		for (; i + 16 <= n; i += 16) {
+			acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+			acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+		}
+		if (i < n)
+			acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+		acc0 = _mm256_add_ps(acc0, acc1);
+		__m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc0), _mm256_extractf128_ps(acc0, 1));
+		sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+		sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 0x55));
+		return _mm_cvtss_f32(sum);
+	}
+
+	inline int16_t ClampToInt16(float v)
+	{
+		if (v >= 32767.f)
+			return 32767;
+		if (v <= -32768.f)
+			return -32768;
+		return (int16_t)lrintf(v);
+	}
+}
+
+CAudioResampler::CAudioResampler()
+{
+}
+
+CAudioResampler::~CAudioResampler()
+{
+}
+
+bool CAudioResampler::Init(int inSampleRate, int inChannels, int outSampleRate, int outChannels, Quality quality)
+{
+	m_initialized = false;
+	if (inSampleRate < MIN_SAMPLE_RATE || inSampleRate > MAX_SAMPLE_RATE
+		|| outSampleRate < MIN_SAMPLE_RATE || outSampleRate > MAX_SAMPLE_RATE)
+		return false;
+	if (inChannels <= 0 || inChannels > MAX_CHANNELS || outChannels <= 0 || outChannels > MAX_CHANNELS)
+		return false;
+
+	m_inSampleRate = inSampleRate;
+	m_inChannels = inChannels;
+	m_outSampleRate = outSampleRate;
+	m_outChannels = outChannels;
+	m_procChannels = (std::min)(inChannels, outChannels);
+
+	int gcd = Gcd(inSampleRate, outSampleRate);
+	m_interp = outSampleRate / gcd;
+	m_step = inSampleRate / gcd;
+	m_dot = AgHasAVX2() ? DotProductAVX2 : DotProductC;
+	BuildFilterBank(quality);
+	m_initialized = true;
+	Reset();
+	return true;
+}
+
+/*
+	Windowed-sinc prototype sampled at every phase offset. Phase p holds the
+	taps used when the output falls p/m_phases of an input sample after the
+	first tap, stored in history order so the inner loop is a plain dot
+	product. Downsampling lowers the cutoff to the output Nyquist and widens
+	the filter by the same factor to keep the transition band.
+*/
+void CAudioResampler::BuildFilterBank(Quality quality)
+{
+	static const int baseTaps[] = { 16, 32, 64 };
+	static const double beta[] = { 6.0, 8.0, 10.0 };
+	static const double rolloff[] = { 0.85, 0.91, 0.95 };
+
+	m_coeffs.clear();
+	if (m_interp == 1 && m_step == 1) {
+		m_taps = 0;
+		m_phases = 1;
+		m_interpolatePhases = false;
+		return;
+	}
+
+	double ratio = (std::min)(1.0, (double)m_outSampleRate / m_inSampleRate);
+	double cutoff = ratio * rolloff[quality];
+	int taps = (int)ceil(baseTaps[quality] / ratio);
+	m_taps = (taps + 7) & ~7;
+
+	m_interpolatePhases = m_interp > kMaxPhases;
+	m_phases = m_interpolatePhases ? kMaxPhases : m_interp;
+	//with interpolation one more phase is stored so phase f + 1 always exists.
+	int tablePhases = m_interpolatePhases ? m_phases + 1 : m_phases;
+	m_coeffs.resize((size_t)tablePhases * m_taps);
+
+	double half = m_taps / 2.0;
+	double i0Beta = BesselI0(beta[quality]);
+	for (int p = 0; p < tablePhases; ++p) {
+		float* coeffs = &m_coeffs[(size_t)p * m_taps];
+		double frac = (double)p / m_phases;
+		double sum = 0.0;
+		for (int i = 0; i < m_taps; ++i) {
+			//distance of tap i from the output position, in input samples.
+			double x = (m_taps - 1 - i) + frac - half;
+			double sinc = fabs(x) < 1e-9 ? 1.0 : sin(kPi * cutoff * x) / (kPi * cutoff * x);
+			double r = x / half;
+			double window = fabs(r) >= 1.0 ? 0.0 : BesselI0(beta[quality] * sqrt(1.0 - r * r)) / i0Beta;
+			double v = cutoff * sinc * window;
+			coeffs[i] = (float)v;
+			sum += v;
+		}
+		//unity gain at DC for every phase.
+		for (int i = 0; i < m_taps; ++i)
+			coeffs[i] = (float)(coeffs[i] / sum);
+	}
+}
+
+void CAudioResampler::Reset()
+{
+	m_base = 0;
+	m_phase = 0;
+	m_fifoRead = 0;
+	m_outRemainder = 0;
+	int slack = m_taps ? kOutputSlack : 0;
+	m_latency = (int)((double)m_taps / 2 * m_outSampleRate / (m_inSampleRate ? m_inSampleRate : 1) + 0.5) + slack;
+	for (int ch = 0; ch < MAX_CHANNELS; ++ch) {
+		m_history[ch].clear();
+		m_fifo[ch].clear();
+		if (ch < m_procChannels) {
+			//taps - 1 zeros of history, so the first output needs no lookahead.
+			m_history[ch].assign(m_taps ? m_taps - 1 : 0, 0.f);
+			m_fifo[ch].assign(slack, 0.f);
+		}
+	}
+}
+
+bool CAudioResampler::IsPassthrough() const
+{
+	return m_inSampleRate == m_outSampleRate && m_inChannels == m_outChannels;
+}
+
+int CAudioResampler::GetOutputSamples(int inSamples)
+{
+	if (!m_initialized || inSamples <= 0)
+		return 0;
+	int64_t total = (int64_t)inSamples * m_outSampleRate + m_outRemainder;
+	m_outRemainder = total % m_inSampleRate;
+	return (int)(total / m_inSampleRate);
+}
+
+//de-interleave into the filter channels, averaging when down-mixing.
+void CAudioResampler::AppendInput(const int16_t* input, int inSamples)
+{
+	for (int ch = 0; ch < m_procChannels; ++ch) {
+		std::vector<float>& history = m_history[ch];
+		size_t offset = history.size();
+		history.resize(offset + inSamples);
+		float* dst = &history[offset];
+		if (m_inChannels == m_procChannels) {
+			const int16_t* src = input + ch;
+			for (int i = 0; i < inSamples; ++i, src += m_inChannels)
+				dst[i] = *src;
+		}
+		else {
+			int sources = 0;
+			memset(dst, 0, sizeof(float) * inSamples);
+			for (int in = ch; in < m_inChannels; in += m_procChannels) {
+				const int16_t* src = input + in;
+				for (int i = 0; i < inSamples; ++i, src += m_inChannels)
+					dst[i] += *src;
+				++sources;
+			}
+			float scale = 1.f / sources;
+			for (int i = 0; i < inSamples; ++i)
+				dst[i] *= scale;
+		}
+	}
+}
+
+void CAudioResampler::Filter()
+{
+	int available = (int)m_history[0].size();
+	if (m_taps == 0) {
+		for (int ch = 0; ch < m_procChannels; ++ch) {
+			m_fifo[ch].insert(m_fifo[ch].end(), m_history[ch].begin(), m_history[ch].end());
+			m_history[ch].clear();
+		}
+		return;
+	}
+
+	int base = m_base;
+	int phase = m_phase;
+	int count = 0;
+	//count outputs first so the fifo is grown once per channel.
+	for (int b = base, p = phase; b + m_taps <= available; ++count) {
+		p += m_step;
+		b += p / m_interp;
+		p %= m_interp;
+	}
+
+	for (int ch = 0; ch < m_procChannels; ++ch) {
+		const float* history = m_history[ch].data();
+		std::vector<float>& fifo = m_fifo[ch];
+		size_t offset = fifo.size();
+		fifo.resize(offset + count);
+		float* out = &fifo[offset];
+		int b = base, p = phase;
+		for (int k = 0; k < count; ++k) {
+			if (!m_interpolatePhases) {
+				out[k] = m_dot(&m_coeffs[(size_t)p * m_taps], history + b, m_taps);
+			}
+			else {
+				int64_t pos = (int64_t)p * m_phases;
+				int f = (int)(pos / m_interp);
+				float w = (float)(pos - (int64_t)f * m_interp) / m_interp;
+				float y0 = m_dot(&m_coeffs[(size_t)f * m_taps], history + b, m_taps);
+				float y1 = m_dot(&m_coeffs[(size_t)(f + 1) * m_taps], history + b, m_taps);
+				out[k] = y0 + (y1 - y0) * w;
+			}
+			p += m_step;
+			b += p / m_interp;
+			p %= m_interp;
+		}
+		if (ch == m_procChannels - 1) {
+			m_base = b;
+			m_phase = p;
+		}
+	}
+
+	//drop history that no future output can reach.
+	if (m_base > 0) {
+		for (int ch = 0; ch < m_procChannels; ++ch) {
+			std::vector<float>& history = m_history[ch];
+			int consumed = (std::min)(m_base, (int)history.size());
+			history.erase(history.begin(), history.begin() + consumed);
+		}
+		m_base -= (std::min)(m_base, available);
+	}
+}
+
+//interleave the filtered channels, duplicating them when up-mixing.
+void CAudioResampler::WriteOutput(int16_t* output, int outSamples)
+{
+	int available = (int)(m_fifo[0].size() - m_fifoRead);
+	int copy = (std::min)(available, outSamples);
+	for (int ch = 0; ch < m_outChannels; ++ch) {
+		const float* src = m_fifo[ch % m_procChannels].data() + m_fifoRead;
+		int16_t* dst = output + ch;
+		for (int i = 0; i < copy; ++i, dst += m_outChannels)
+			*dst = ClampToInt16(src[i]);
+		for (int i = copy; i < outSamples; ++i, dst += m_outChannels)
+			*dst = 0;
+	}
+	m_fifoRead += copy;
+
+	//keep the delay fixed: anything beyond one frame plus the slack is late
+	//audio the caller is not asking for, drop the oldest part of it.
+	size_t keep = (size_t)outSamples + kOutputSlack;
+	size_t remain = m_fifo[0].size() - m_fifoRead;
+	if (remain > keep)
+		m_fifoRead += remain - keep;
+
+	if (m_fifoRead > 0 && m_fifoRead * 2 >= m_fifo[0].size()) {
+		for (int ch = 0; ch < m_procChannels; ++ch)
+			m_fifo[ch].erase(m_fifo[ch].begin(), m_fifo[ch].begin() + m_fifoRead);
+		m_fifoRead = 0;
+	}
+}
+
+int CAudioResampler::Process(const int16_t* input, int inSamples, int16_t* output, int outSamples)
+{
+	if (!m_initialized || outSamples <= 0)
+		return 0;
+	if (IsPassthrough()) {
+		int copy = (std::min)(inSamples, outSamples);
+		memcpy(output, input, sizeof(int16_t) * copy * m_outChannels);
+		if (copy < outSamples)
+			memset(output + copy * m_outChannels, 0, sizeof(int16_t) * (outSamples - copy) * m_outChannels);
+		return outSamples - copy;
+	}
+
+	if (input && inSamples > 0) {
+		AppendInput(input, inSamples);
+		Filter();
+	}
+	int available = (int)(m_fifo[0].size() - m_fifoRead);
+	WriteOutput(output, outSamples);
+	return available < outSamples ? outSamples - available : 0;
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/*
+	Streaming polyphase FIR resampler for interleaved PCM16.
+	Converts between any pair of sample rates in [8000, 96000] and
+	up/down-mixes channels on the way. The filter bank is computed once in
+	Init; Process works frame by frame and always returns exactly the number
+	of output samples asked for, so the delay through the resampler is
+	constant (GetLatencySamples).
+*/
+class CAudioResampler
+{
+public:
+	enum Quality {
+		QUALITY_LOW = 0,
+		QUALITY_MEDIUM,
+		QUALITY_HIGH,
+	};
+	enum {
+		MIN_SAMPLE_RATE = 8000,
+		MAX_SAMPLE_RATE = 96000,
+		MAX_CHANNELS = 8,
+	};
+
+	CAudioResampler();
+	~CAudioResampler();
+
+	//build the filter tables. returns false for unsupported formats.
+	bool Init(int inSampleRate, int inChannels, int outSampleRate, int outChannels, Quality quality = QUALITY_MEDIUM);
+	//drop all buffered audio and start over with the same configuration.
+	void Reset();
+	bool IsInitialized() const { return m_initialized; }
+	//sample rate and channels are equal, Process is a plain copy.
+	bool IsPassthrough() const;
+
+	/*
+		input:      interleaved PCM16, inSamples samples per channel.
+		output:     interleaved PCM16, receives exactly outSamples samples per channel.
+		return:     number of output samples per channel that had to be padded
+		            because not enough input was available (0 in steady state).
+	*/
+	int Process(const int16_t* input, int inSamples, int16_t* output, int outSamples);
+
+	//number of output samples per channel an output sample is delayed by.
+	int GetLatencySamples() const { return m_latency; }
+	//output samples per channel the next inSamples of input produce. the
+	//fraction left over carries into the next call, so a stream cut into
+	//any chunk size gets exactly the rate ratio and Process drops nothing.
+	int GetOutputSamples(int inSamples);
+
+	int GetInSampleRate() const { return m_inSampleRate; }
+	int GetInChannels() const { return m_inChannels; }
+	int GetOutSampleRate() const { return m_outSampleRate; }
+	int GetOutChannels() const { return m_outChannels; }
+
+private:
+	typedef float(*DotProductFunc)(const float* a, const float* b, int n);
+
+	void BuildFilterBank(Quality quality);
+	void AppendInput(const int16_t* input, int inSamples);
+	void Filter();
+	void WriteOutput(int16_t* output, int outSamples);
+
+	bool m_initialized = false;
+	int m_inSampleRate = 0;
+	int m_inChannels = 0;
+	int m_outSampleRate = 0;
+	int m_outChannels = 0;
+	//channels that actually go through the filter: min(in, out).
+	int m_procChannels = 0;
+
+	//output sample k is taken at input position k * m_step / m_interp.
+	int m_interp = 1;
+	int m_step = 1;
+	//number of precomputed phases; equals m_interp unless the ratio needs
+	//too many phases, in which case neighbouring phases are interpolated.
+	int m_phases = 1;
+	int m_taps = 0;
+	bool m_interpolatePhases = false;
+	std::vector<float> m_coeffs;
+	DotProductFunc m_dot = nullptr;
+
+	//filter position: history index of the first tap and phase in [0, m_interp).
+	int m_base = 0;
+	int m_phase = 0;
+	int m_latency = 0;
+	std::vector<float> m_history[MAX_CHANNELS];
+	std::vector<float> m_fifo[MAX_CHANNELS];
+	size_t m_fifoRead = 0;
+	//GetOutputSamples remainder, in units of 1 / m_inSampleRate samples.
+	int64_t m_outRemainder = 0;
+};
@@ -0,0 +1,555 @@
+#include "BeautyFilter.h"
+#include "CpuFeatures.h"
+#include "trace/Trace.h"
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <string.h>
+
+namespace {
+	//skin tones in Cb/Cr, the mask fades out over kSkinSoftness levels past the box.
+	const int kSkinCbMin = 77;
+	const int kSkinCbMax = 127;
+	const int kSkinCrMin = 133;
+	const int kSkinCrMax = 173;
+	const float kSkinSoftness = 4.0f;
+	//full redness moves Cr and Cb by this many levels.
+	const float kRednessCr = 16.0f;
+	const float kRednessCb = 6.0f;
+
+	int64_t NowNs()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	inline uint8_t RoundToByte(float value)
+	{
+		return (uint8_t)((std::min)((std::max)(value, 0.0f), 255.0f) + 0.5f);
+	}
+
+	void BoxVerticalC(float* dst, float* colsum, const float* add, const float* sub, const float* invX, float invY, int n)
+	{
+		for (int i = 0; i < n; ++i)
+			dst[i] = colsum[i] * invX[i] * invY;
+		if (add) {
+			for (int i = 0; i < n; ++i)
+				colsum[i] += add[i];
+		}
+		if (sub) {
+			for (int i = 0; i < n; ++i)
+				colsum[i] -= sub[i];
+		}
+	}
+
+	void CoefficientsC(float* meanI, float* meanII, float eps, int n)
+	{
+		for (int i = 0; i < n; ++i) {
+			float mean = meanI[i];
+			float variance = (std::max)(meanII[i] - mean * mean, 0.0f);
+			float a = variance / (variance + eps);
+			meanII[i] = a;
+			meanI[i] = mean - a * mean;
+		}
+	}
+
+	void LerpC(float* dst, const float* a, const float* b, float t, int n)
+	{
+		for (int i = 0; i < n; ++i)
+			dst[i] = a[i] + (b[i] - a[i]) * t;
+	}
+
+	void BlendC(uint8_t* y, const float* a, const float* b, const float* weight, int n)
+	{
+		for (int i = 0; i < n; ++i) {
+			float in = y[i];
+			y[i] = RoundToByte(in + weight[i] * (a[i] * in + b[i] - in));
+		}
+	}
+
+	void RednessC(uint8_t* u, uint8_t* v, const float* skin, float kv, float ku, int n)
+	{
+		for (int i = 0; i < n; ++i) {
+			v[i] = RoundToByte(v[i] + kv * skin[i]);
+			u[i] = RoundToByte(u[i] - ku * skin[i]);
+		}
+	}
+
+	AG_TARGET_AVX2 void BoxVerticalAVX2(float* dst, float* colsum, const float* add, const float* sub, const float* invX, float invY, int n)
+	{
+		__m256 scale = _mm256_set1_ps(invY);
+		int i = 0;
+		for (; i + 8 <= n; i += 8) {
+			__m256 sum = _mm256_loadu_ps(colsum + i);
+			_mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_mul_ps(sum, _mm256_loadu_ps(invX + i)), scale));
+			if (add)
+				sum = _mm256_add_ps(sum, _mm256_loadu_ps(add + i));
+			if (sub)
+				sum = _mm256_sub_ps(sum, _mm256_loadu_ps(sub + i));
+			_mm256_storeu_ps(colsum + i, sum);
+		}
+		if (i < n)
+			BoxVerticalC(dst + i, colsum + i, add ? add + i : nullptr, sub ? sub + i : nullptr, invX + i, invY, n - i);
+	}
+
+	AG_TARGET_AVX2 void CoefficientsAVX2(float* meanI, float* meanII, float eps, int n)
+	{
+		__m256 epsilon = _mm256_set1_ps(eps);
+		__m256 zero = _mm256_setzero_ps();
+		int i = 0;
+		for (; i + 8 <= n; i += 8) {
+			__m256 mean = _mm256_loadu_ps(meanI + i);
+			__m256 variance = _mm256_max_ps(_mm256_fnmadd_ps(mean, mean, _mm256_loadu_ps(meanII + i)), zero);
+			__m256 a = _mm256_div_ps(variance, _mm256_add_ps(variance, epsilon));
+			_mm256_storeu_ps(meanII + i, a);
+			_mm256_storeu_ps(meanI + i, _mm256_fnmadd_ps(a, mean, mean));
+		}
+		if (i < n)
+			CoefficientsC(meanI + i, meanII + i, eps, n - i);
+	}
+
+	AG_TARGET_AVX2 void LerpAVX2(float* dst, const float* a, const float* b, float t, int n)
+	{
+		__m256 weight = _mm256_set1_ps(t);
+		int i = 0;
+		for (; i + 8 <= n; i += 8) {
+			__m256 va = _mm256_loadu_ps(a + i);
+			_mm256_storeu_ps(dst + i, _mm256_fmadd_ps(_mm256_sub_ps(_mm256_loadu_ps(b + i), va), weight, va));
+		}
+		if (i < n)
+			LerpC(dst + i, a + i, b + i, t, n - i);
+	}
+
+	//8 floats to 8 bytes, rounded and saturated.
+	AG_TARGET_AVX2 inline void StoreBytes(uint8_t* dst, __m256 value)
+	{
+		__m256i words = _mm256_cvtps_epi32(value);
+		__m128i packed = _mm_packs_epi32(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+		_mm_storel_epi64((__m128i*)dst, _mm_packus_epi16(packed, packed));
+	}
+
+	AG_TARGET_AVX2 inline __m256 LoadBytes(const uint8_t* src)
+	{
+		return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)src)));
+	}
+
+	AG_TARGET_AVX2 void BlendAVX2(uint8_t* y, const float* a, const float* b, const float* weight, int n)
+	{
+		int i = 0;
+		for (; i + 8 <= n; i += 8) {
+			__m256 in = LoadBytes(y + i);
+			__m256 q = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), in, _mm256_loadu_ps(b + i));
+			StoreBytes(y + i, _mm256_fmadd_ps(_mm256_loadu_ps(weight + i), _mm256_sub_ps(q, in), in));
+		}
+		if (i < n)
+			BlendC(y + i, a + i, b + i, weight + i, n - i);
+	}
+
+	AG_TARGET_AVX2 void RednessAVX2(uint8_t* u, uint8_t* v, const float* skin, float kv, float ku, int n)
+	{
+		__m256 toV = _mm256_set1_ps(kv);
+		__m256 toU = _mm256_set1_ps(-ku);
+		int i = 0;
+		for (; i + 8 <= n; i += 8) {
+			__m256 mask = _mm256_loadu_ps(skin + i);
+			StoreBytes(v + i, _mm256_fmadd_ps(mask, toV, LoadBytes(v + i)));
+			StoreBytes(u + i, _mm256_fmadd_ps(mask, toU, LoadBytes(u + i)));
+		}
+		if (i < n)
+			RednessC(u + i, v + i, skin + i, kv, ku, n - i);
+	}
+}
+
+CBeautyFilter::CBeautyFilter()
+{
+	m_useAVX2 = AgHasAVX2();
+	SelectKernels(m_useAVX2);
+	for (int i = 0; i < 256; ++i)
+		m_lut[i] = (uint8_t)i;
+}
+
+void CBeautyFilter::SetOptions(const BeautyFilterOptions& options)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_options = options;
+	m_options.smoothness = (std::max)(0.0f, (std::min)(1.0f, options.smoothness));
+	m_options.lightening = (std::max)(0.0f, (std::min)(1.0f, options.lightening));
+	m_options.redness = (std::max)(0.0f, (std::min)(1.0f, options.redness));
+}
+
+BeautyFilterOptions CBeautyFilter::GetOptions() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_options;
+}
+
+void CBeautyFilter::SetUseAVX2(bool use)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_useAVX2 = use && AgHasAVX2();
+}
+
+void CBeautyFilter::SelectKernels(bool avx2)
+{
+	m_kernelsAVX2 = avx2;
+	m_kernels.boxVertical = avx2 ? BoxVerticalAVX2 : BoxVerticalC;
+	m_kernels.coefficients = avx2 ? CoefficientsAVX2 : CoefficientsC;
+	m_kernels.lerp = avx2 ? LerpAVX2 : LerpC;
+	m_kernels.blend = avx2 ? BlendAVX2 : BlendC;
+	m_kernels.redness = avx2 ? RednessAVX2 : RednessC;
+}
+
+BeautyFilterStats CBeautyFilter::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
+
+void CBeautyFilter::ResetStats()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stats = BeautyFilterStats();
+}
+
+void CBeautyFilter::Resize(int width, int height, int scale)
+{
+	m_width = width;
+	m_height = height;
+	m_scale = scale;
+	m_lowWidth = (width + scale - 1) / scale;
+	m_lowHeight = (height + scale - 1) / scale;
+	size_t lowSize = (size_t)m_lowWidth * m_lowHeight;
+	m_guide.assign(lowSize, 0);
+	m_guideSq.assign(lowSize, 0);
+	m_meanI.assign(lowSize, 0);
+	m_meanII.assign(lowSize, 0);
+	m_boxTemp.assign(lowSize, 0);
+	m_colsum.assign(m_lowWidth, 0);
+	m_invCount.assign(m_lowWidth, 0);
+
+	//pixel centers of the low resolution frame sit at (i + 0.5) * scale.
+	m_upIndex.resize(width);
+	m_upFrac.resize(width);
+	for (int x = 0; x < width; ++x) {
+		float position = (x + 0.5f) / scale - 0.5f;
+		int index = (std::min)((std::max)((int)floorf(position), 0), m_lowWidth - 2);
+		m_upIndex[x] = index;
+		m_upFrac[x] = (std::min)((std::max)(position - index, 0.0f), 1.0f);
+	}
+	for (int i = 0; i < 2; ++i) {
+		m_upCacheA[i].resize(width);
+		m_upCacheB[i].resize(width);
+	}
+	m_rowA.resize(width);
+	m_rowB.resize(width);
+	m_rowWeight.resize(width);
+	m_coefficientsValid = false;
+	m_skin.resize((size_t)((width + 1) / 2) * ((height + 1) / 2));
+}
+
+void CBeautyFilter::BuildLut(const BeautyFilterOptions& options)
+{
+	m_lutLightening = options.lightening;
+	m_lutContrast = options.contrast;
+	m_lutIdentity = options.lightening <= 0;
+	if (m_lutIdentity) {
+		for (int i = 0; i < 256; ++i)
+			m_lut[i] = (uint8_t)i;
+		return;
+	}
+	//log(1 + x * (beta - 1)) / log(beta) lifts the shadows and mid tones
+	//most, then a smoothstep blend adds or takes away contrast.
+	double beta = 1 + 8.0 * options.lightening;
+	double contrast = options.contrast == BEAUTY_FILTER_CONTRAST_LOW ? -0.5
+		: options.contrast == BEAUTY_FILTER_CONTRAST_HIGH ? 0.5 : 0;
+	contrast *= options.lightening;
+	for (int i = 0; i < 256; ++i) {
+		double x = i / 255.0;
+		double lifted = log(1 + x * (beta - 1)) / log(beta);
+		double curve = lifted * lifted * (3 - 2 * lifted);
+		double value = lifted + contrast * (curve - lifted);
+		m_lut[i] = RoundToByte((float)(value * 255));
+	}
+}
+
+void CBeautyFilter::BuildSkinMask(const uint8_t* u, int uStride, const uint8_t* v, int vStride, bool skinOnly)
+{
+	int chromaWidth = (m_width + 1) / 2;
+	int chromaHeight = (m_height + 1) / 2;
+	if (!skinOnly) {
+		std::fill(m_skin.begin(), m_skin.end(), 1.0f);
+		return;
+	}
+	for (int cy = 0; cy < chromaHeight; ++cy) {
+		const uint8_t* cb = u + (size_t)cy * uStride;
+		const uint8_t* cr = v + (size_t)cy * vStride;
+		float* mask = &m_skin[(size_t)cy * chromaWidth];
+		for (int cx = 0; cx < chromaWidth; ++cx) {
+			int inside = (std::min)((std::min)(cb[cx] - kSkinCbMin, kSkinCbMax - cb[cx]),
+				(std::min)(cr[cx] - kSkinCrMin, kSkinCrMax - cr[cx]));
+			float weight = (inside + kSkinSoftness) / (2 * kSkinSoftness);
+			mask[cx] = (std::min)((std::max)(weight, 0.0f), 1.0f);
+		}
+	}
+}
+
+//mean over a (2 * radius + 1)^2 window clipped to the plane, src and dst
+//may be the same plane.
+void CBeautyFilter::BoxFilter(const float* src, float* dst, int width, int height, int radius)
+{
+	for (int x = 0; x < width; ++x)
+		m_invCount[x] = 1.0f / ((std::min)(width - 1, x + radius) - (std::max)(0, x - radius) + 1);
+	//a running sum along each row, it is a chain of dependent adds that
+	//does not vectorize, but only runs at the low resolution.
+	for (int y = 0; y < height; ++y) {
+		const float* row = src + (size_t)y * width;
+		float* out = &m_boxTemp[(size_t)y * width];
+		float sum = 0;
+		for (int x = 0; x <= (std::min)(radius, width - 1); ++x)
+			sum += row[x];
+		//the window grows at the left edge, slides in the middle and
+		//shrinks at the right edge, no bounds checks per pixel.
+		int growEnd = (std::min)(radius, width);
+		int slideEnd = (std::max)(growEnd, width - radius - 1);
+		int x = 0;
+		for (; x < growEnd; ++x) {
+			out[x] = sum;
+			if (x + radius + 1 < width)
+				sum += row[x + radius + 1];
+		}
+		for (; x < slideEnd; ++x) {
+			out[x] = sum;
+			sum += row[x + radius + 1] - row[x - radius];
+		}
+		for (; x < width; ++x) {
+			out[x] = sum;
+			if (x - radius >= 0)
+				sum -= row[x - radius];
+		}
+	}
+	std::fill(m_colsum.begin(), m_colsum.end(), 0.0f);
+	for (int y = 0; y <= (std::min)(radius, height - 1); ++y) {
+		const float* row = &m_boxTemp[(size_t)y * width];
+		for (int x = 0; x < width; ++x)
+			m_colsum[x] += row[x];
+	}
+	for (int y = 0; y < height; ++y) {
+		float invY = 1.0f / ((std::min)(height - 1, y + radius) - (std::max)(0, y - radius) + 1);
+		const float* add = y + radius + 1 < height ? &m_boxTemp[(size_t)(y + radius + 1) * width] : nullptr;
+		const float* sub = y - radius >= 0 ? &m_boxTemp[(size_t)(y - radius) * width] : nullptr;
+		m_kernels.boxVertical(dst + (size_t)y * width, m_colsum.data(), add, sub, m_invCount.data(), invY, width);
+	}
+}
+
+const float* CBeautyFilter::GetUpsampledRow(std::vector<float>* cache, int* cacheRow, const std::vector<float>& plane, int ly)
+{
+	for (int i = 0; i < 2; ++i) {
+		if (cacheRow[i] == ly)
+			return cache[i].data();
+	}
+	//rows only move down, the older one goes.
+	int slot = cacheRow[0] < cacheRow[1] ? 0 : 1;
+	cacheRow[slot] = ly;
+	const float* row = &plane[(size_t)ly * m_lowWidth];
+	float* out = cache[slot].data();
+	for (int x = 0; x < m_width; ++x) {
+		int index = m_upIndex[x];
+		out[x] = row[index] + (row[index + 1] - row[index]) * m_upFrac[x];
+	}
+	return out;
+}
+
+void CBeautyFilter::ComputeCoefficients(const uint8_t* y, int yStride, const BeautyFilterOptions& options)
+{
+	int scale = m_scale;
+	int lowWidth = m_lowWidth;
+	int lowHeight = m_lowHeight;
+	//the window follows the frame size so the look does not change with
+	//the resolution.
+	int radius = 2 + m_height / 100;
+	int lowRadius = (std::max)(1, (radius + scale / 2) / scale);
+	//noise and pores vary by a few levels, edges by tens: eps sits between.
+	float sigma = 4 + 16 * options.smoothness;
+	float eps = sigma * sigma;
+
+	//box averaged guide.
+	for (int ly = 0; ly < lowHeight && scale == 1; ++ly) {
+		const uint8_t* row = y + (size_t)ly * yStride;
+		float* guide = &m_guide[(size_t)ly * lowWidth];
+		float* guideSq = &m_guideSq[(size_t)ly * lowWidth];
+		for (int lx = 0; lx < lowWidth; ++lx) {
+			guide[lx] = row[lx];
+			guideSq[lx] = (float)(row[lx] * row[lx]);
+		}
+	}
+	for (int ly = 0; ly < lowHeight && scale > 1; ++ly) {
+		int y0 = ly * scale;
+		int y1 = (std::min)(y0 + scale, m_height);
+		for (int lx = 0; lx < lowWidth; ++lx) {
+			int x0 = lx * scale;
+			int x1 = (std::min)(x0 + scale, m_width);
+			int sum = 0;
+			for (int sy = y0; sy < y1; ++sy) {
+				const uint8_t* row = y + (size_t)sy * yStride;
+				for (int sx = x0; sx < x1; ++sx)
+					sum += row[sx];
+			}
+			float value = (float)sum / ((y1 - y0) * (x1 - x0));
+			size_t index = (size_t)ly * lowWidth + lx;
+			m_guide[index] = value;
+			m_guideSq[index] = value * value;
+		}
+	}
+	BoxFilter(m_guide.data(), m_meanI.data(), lowWidth, lowHeight, lowRadius);
+	BoxFilter(m_guideSq.data(), m_meanII.data(), lowWidth, lowHeight, lowRadius);
+	for (int ly = 0; ly < lowHeight; ++ly) {
+		size_t offset = (size_t)ly * lowWidth;
+		m_kernels.coefficients(&m_meanI[offset], &m_meanII[offset], eps, lowWidth);
+	}
+	//means of a and b.
+	BoxFilter(m_meanII.data(), m_guide.data(), lowWidth, lowHeight, lowRadius);
+	BoxFilter(m_meanI.data(), m_guideSq.data(), lowWidth, lowHeight, lowRadius);
+	m_coefficientsValid = true;
+}
+
+void CBeautyFilter::Smooth(uint8_t* y, int yStride, const BeautyFilterOptions& options, bool refresh)
+{
+	if (refresh || !m_coefficientsValid)
+		ComputeCoefficients(y, yStride, options);
+	int scale = m_scale;
+	int lowWidth = m_lowWidth;
+	int lowHeight = m_lowHeight;
+	m_upRowA[0] = m_upRowA[1] = -1;
+	m_upRowB[0] = m_upRowB[1] = -1;
+	int chromaWidth = (m_width + 1) / 2;
+	for (int row = 0; row < m_height; ++row) {
+		const float* a;
+		const float* b;
+		if (scale == 1) {
+			a = &m_guide[(size_t)row * lowWidth];
+			b = &m_guideSq[(size_t)row * lowWidth];
+		}
+		else {
+			float position = (row + 0.5f) / scale - 0.5f;
+			int ly = (std::min)((std::max)((int)floorf(position), 0), lowHeight - 2);
+			float t = (std::min)((std::max)(position - ly, 0.0f), 1.0f);
+			const float* a0 = GetUpsampledRow(m_upCacheA, m_upRowA, m_guide, ly);
+			const float* a1 = GetUpsampledRow(m_upCacheA, m_upRowA, m_guide, ly + 1);
+			m_kernels.lerp(m_rowA.data(), a0, a1, t, m_width);
+			const float* b0 = GetUpsampledRow(m_upCacheB, m_upRowB, m_guideSq, ly);
+			const float* b1 = GetUpsampledRow(m_upCacheB, m_upRowB, m_guideSq, ly + 1);
+			m_kernels.lerp(m_rowB.data(), b0, b1, t, m_width);
+			a = m_rowA.data();
+			b = m_rowB.data();
+		}
+		if ((row & 1) == 0) {
+			const float* skin = &m_skin[(size_t)(row / 2) * chromaWidth];
+			for (int x = 0; x < m_width; ++x)
+				m_rowWeight[x] = options.smoothness * skin[x / 2];
+		}
+		m_kernels.blend(y + (size_t)row * yStride, a, b, m_rowWeight.data(), m_width);
+	}
+}
+
+bool CBeautyFilter::Process(uint8_t* y, int yStride, uint8_t* u, int uStride, uint8_t* v, int vStride, int width, int height)
+{
+	if (!y || !u || !v || width < 2 || height < 2)
+		return false;
+	AG_TRACE_SCOPE2("filter", "CBeautyFilter::Process", "width", width, "height", height);
+	int64_t begin = NowNs();
+	BeautyFilterOptions options;
+	bool useAVX2;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		options = m_options;
+		useAVX2 = m_useAVX2;
+	}
+	if (useAVX2 != m_kernelsAVX2)
+		SelectKernels(useAVX2);
+
+	//new options or a new frame size start from the quality asked for.
+	if (width != m_width || height != m_height
+		|| options.quality != m_budgetQuality || options.budgetMs != m_budgetMs) {
+		m_budgetQuality = options.quality;
+		m_budgetMs = options.budgetMs;
+		m_budgetScale = 1;
+		m_budgetReuse = false;
+		m_budgetFrames = 0;
+	}
+	int scale = options.quality == BEAUTY_FILTER_QUALITY_HIGH ? 1
+		: options.quality == BEAUTY_FILTER_QUALITY_BALANCED ? 2 : 4;
+	scale = (std::max)(scale, m_budgetScale);
+	//upsampling needs two low resolution rows and columns.
+	while (scale > 1 && (width / scale < 2 || height / scale < 2))
+		scale /= 2;
+	if (width != m_width || height != m_height || scale != m_scale)
+		Resize(width, height, scale);
+
+	bool smooth = options.smoothness > 0;
+	bool redden = options.redness > 0;
+	//skin moves little between two frames, the odd ones may blend with the
+	//coefficients of the even ones.
+	bool refresh = !m_budgetReuse || (m_frameIndex++ & 1) == 0;
+	bool reused = smooth && !refresh && m_coefficientsValid;
+	//the mask comes from the chroma before redness changes it.
+	if (smooth || redden)
+		BuildSkinMask(u, uStride, v, vStride, options.skinOnly);
+	if (smooth)
+		Smooth(y, yStride, options, refresh);
+	else
+		m_coefficientsValid = false;
+	if (options.lightening != m_lutLightening || options.contrast != m_lutContrast)
+		BuildLut(options);
+	if (!m_lutIdentity) {
+		//a byte table beats any gather, the row is still in cache.
+		for (int row = 0; row < height; ++row) {
+			uint8_t* luma = y + (size_t)row * yStride;
+			for (int x = 0; x < width; ++x)
+				luma[x] = m_lut[luma[x]];
+		}
+	}
+	if (redden) {
+		int chromaWidth = (width + 1) / 2;
+		for (int row = 0; row < (height + 1) / 2; ++row) {
+			m_kernels.redness(u + (size_t)row * uStride, v + (size_t)row * vStride,
+				&m_skin[(size_t)row * chromaWidth], options.redness * kRednessCr, options.redness * kRednessCb, chromaWidth);
+		}
+	}
+
+	int64_t elapsed = NowNs() - begin;
+	bool stepped = UpdateBudget(scale, elapsed);
+	std::lock_guard<std::mutex> lock(m_mutex);
+	++m_stats.frames;
+	m_stats.scale = scale;
+	m_stats.budgetSteps += stepped ? 1 : 0;
+	m_stats.reusedFrames += reused ? 1 : 0;
+	m_stats.nsTotal += elapsed;
+	m_stats.nsMax = (std::max)(m_stats.nsMax, elapsed);
+	m_stats.nsLast = elapsed;
+	m_stats.width = width;
+	m_stats.height = height;
+	m_stats.avx2 = m_kernelsAVX2;
+	return true;
+}
+
+bool CBeautyFilter::UpdateBudget(int scale, int64_t elapsedNs)
+{
+	if (m_budgetMs <= 0)
+		return false;
+	//averaged over about 8 frames, one slow frame is not a reason.
+	m_budgetAverageNs = m_budgetFrames ? m_budgetAverageNs + (elapsedNs - m_budgetAverageNs) / 8 : (double)elapsedNs;
+	if (++m_budgetFrames < 8 || m_budgetAverageNs <= m_budgetMs * 1e6)
+		return false;
+	//the average starts over at the new cost.
+	m_budgetFrames = 0;
+	int next = scale * 2;
+	if (next <= 4 && m_width / next >= 2 && m_height / next >= 2) {
+		m_budgetScale = next;
+		return true;
+	}
+	if (!m_budgetReuse) {
+		m_budgetReuse = true;
+		return true;
+	}
+	return false;
+}
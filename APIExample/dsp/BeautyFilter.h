@@ -0,0 +1,170 @@
+#pragma once
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+enum BEAUTY_FILTER_QUALITY {
+	//the smoothing runs on the full frame.
+	BEAUTY_FILTER_QUALITY_HIGH = 0,
+	//on a half size frame, a quarter of the work for the same look on skin.
+	BEAUTY_FILTER_QUALITY_BALANCED,
+	//on a quarter size frame, fine detail next to edges starts to smear.
+	BEAUTY_FILTER_QUALITY_FAST,
+};
+
+//same levels as the SDK's BeautyOptions::LIGHTENING_CONTRAST_LEVEL.
+enum BEAUTY_FILTER_CONTRAST {
+	BEAUTY_FILTER_CONTRAST_LOW = 0,
+	BEAUTY_FILTER_CONTRAST_NORMAL,
+	BEAUTY_FILTER_CONTRAST_HIGH,
+};
+
+//levels are 0 to 1, 0 turns the step off.
+struct BeautyFilterOptions {
+	float smoothness = 0.5f;
+	float lightening = 0.0f;
+	BEAUTY_FILTER_CONTRAST contrast = BEAUTY_FILTER_CONTRAST_NORMAL;
+	float redness = 0.0f;
+	//smooth and redden only where the chroma looks like skin.
+	bool skinOnly = true;
+	BEAUTY_FILTER_QUALITY quality = BEAUTY_FILTER_QUALITY_BALANCED;
+	//ms a frame may take, 0 for no limit. while frames average more the
+	//filter steps down a quality, and below fast it recomputes the
+	//smoothing only every other frame and blends with the last one's
+	//coefficients in between.
+	float budgetMs = 0;
+};
+
+struct BeautyFilterStats {
+	uint64_t frames = 0;
+	int64_t nsTotal = 0;
+	int64_t nsMax = 0;
+	int64_t nsLast = 0;
+	int width = 0;
+	int height = 0;
+	bool avx2 = false;
+	//the subsampling the last frame ran at, 1, 2 or 4, and the times the
+	//budget made the filter cheaper.
+	int scale = 0;
+	uint64_t budgetSteps = 0;
+	//frames blended with the previous frame's coefficients.
+	uint64_t reusedFrames = 0;
+
+	double GetMsAverage() const { return frames ? nsTotal / 1e6 / frames : 0; }
+};
+
+/*
+	Skin smoothing, lightening and redness on I420 frames in place, for an
+	IVideoFrameObserver::onCaptureVideoFrame or any other frame hook.
+		smoothing:  a self-guided filter on luma, which flattens small
+		            variations while edges, whose local variance is far
+		            above eps, pass through. The quality knob runs it on a
+		            2x or 4x subsampled frame and upsamples its linear
+		            coefficients, so the output keeps full resolution
+		lightening: a brightening log curve and an S shaped contrast
+		            adjustment, folded into one luma table
+		redness:    pushes Cr up and Cb down a little
+	A soft skin mask from the chroma weights smoothing and redness. The
+	box filters, the coefficients and the per pixel blends have AVX2
+	kernels picked at runtime, the scalar paths give the same result to
+	rounding. With a budget the filter gets cheaper on its own when a
+	frame size or a slow machine would hold up the capture thread.
+*/
+class CBeautyFilter
+{
+public:
+	CBeautyFilter();
+
+	//any thread, takes effect with the next frame.
+	void SetOptions(const BeautyFilterOptions& options);
+	BeautyFilterOptions GetOptions() const;
+	//for comparisons, ignored without AVX2 on the machine.
+	void SetUseAVX2(bool use);
+
+	//one frame at a time. false for frames smaller than 2x2.
+	bool Process(uint8_t* y, int yStride, uint8_t* u, int uStride, uint8_t* v, int vStride, int width, int height);
+
+	BeautyFilterStats GetStats() const;
+	void ResetStats();
+
+private:
+	struct Kernels {
+		//dst = colsum * invX * invY, then colsum += add - sub; add and sub may be null.
+		void(*boxVertical)(float* dst, float* colsum, const float* add, const float* sub, const float* invX, float invY, int n);
+		//meanI becomes b and meanII a of q = a * I + b.
+		void(*coefficients)(float* meanI, float* meanII, float eps, int n);
+		void(*lerp)(float* dst, const float* a, const float* b, float t, int n);
+		//y += weight * (a * y + b - y).
+		void(*blend)(uint8_t* y, const float* a, const float* b, const float* weight, int n);
+		//v += kv * skin, u -= ku * skin.
+		void(*redness)(uint8_t* u, uint8_t* v, const float* skin, float kv, float ku, int n);
+	};
+
+	void Resize(int width, int height, int scale);
+	void SelectKernels(bool avx2);
+	void BuildLut(const BeautyFilterOptions& options);
+	void BuildSkinMask(const uint8_t* u, int uStride, const uint8_t* v, int vStride, bool skinOnly);
+	void BoxFilter(const float* src, float* dst, int width, int height, int radius);
+	//the coefficients a and b of the guided filter into m_guide and m_guideSq.
+	void ComputeCoefficients(const uint8_t* y, int yStride, const BeautyFilterOptions& options);
+	void Smooth(uint8_t* y, int yStride, const BeautyFilterOptions& options, bool refresh);
+	//the average cost against the budget, true when it made the filter
+	//cheaper than the scale it ran at.
+	bool UpdateBudget(int scale, int64_t elapsedNs);
+	//row ly of a low resolution plane at full width, from a cache of the
+	//last two rows.
+	const float* GetUpsampledRow(std::vector<float>* cache, int* cacheRow, const std::vector<float>& plane, int ly);
+
+	mutable std::mutex m_mutex;
+	BeautyFilterOptions m_options;
+	bool m_useAVX2 = false;
+	BeautyFilterStats m_stats;
+	//only touched by Process.
+	Kernels m_kernels;
+	bool m_kernelsAVX2 = false;
+
+	int m_width = 0;
+	int m_height = 0;
+	int m_scale = 0;
+	int m_lowWidth = 0;
+	int m_lowHeight = 0;
+	//m_guide and m_guideSq hold the coefficients of an earlier frame.
+	bool m_coefficientsValid = false;
+
+	//what the budget has done for the current options and frame size: the
+	//least subsampling, and whether coefficients are reused.
+	int m_budgetScale = 1;
+	bool m_budgetReuse = false;
+	double m_budgetAverageNs = 0;
+	int m_budgetFrames = 0;
+	uint64_t m_frameIndex = 0;
+	BEAUTY_FILTER_QUALITY m_budgetQuality = BEAUTY_FILTER_QUALITY_HIGH;
+	float m_budgetMs = 0;
+	//low resolution planes. the guide and its square, their means, which
+	//become the coefficients b and a, and the means of those, which go
+	//back into the guide planes.
+	std::vector<float> m_guide;
+	std::vector<float> m_guideSq;
+	std::vector<float> m_meanI;
+	std::vector<float> m_meanII;
+	std::vector<float> m_boxTemp;
+	std::vector<float> m_colsum;
+	std::vector<float> m_invCount;
+	//horizontal upsampling of a low resolution row.
+	std::vector<int> m_upIndex;
+	std::vector<float> m_upFrac;
+	std::vector<float> m_upCacheA[2];
+	std::vector<float> m_upCacheB[2];
+	int m_upRowA[2] = { -1, -1 };
+	int m_upRowB[2] = { -1, -1 };
+	std::vector<float> m_rowA;
+	std::vector<float> m_rowB;
+	std::vector<float> m_rowWeight;
+	//chroma resolution, 0 to 1.
+	std::vector<float> m_skin;
+	uint8_t m_lut[256];
+	bool m_lutIdentity = true;
+	//lightening and contrast the table was built for, -1 before the first.
+	float m_lutLightening = -1;
+	BEAUTY_FILTER_CONTRAST m_lutContrast = BEAUTY_FILTER_CONTRAST_NORMAL;
+};
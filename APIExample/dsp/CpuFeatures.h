@@ -0,0 +1,41 @@
+#pragma once
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#include <immintrin.h>
+
+//functions compiled with AG_TARGET_AVX2 may use AVX2/FMA intrinsics and must
+//only be called after AgHasAVX2() returned true.
+#if defined(__GNUC__) || defined(__clang__)
+#define AG_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define AG_TARGET_AVX2
+#endif
+
+//runtime check for AVX2 + FMA with OS support for the YMM state.
+inline bool AgHasAVX2()
+{
+#if defined(_MSC_VER)
+	static const bool bHasAVX2 = []() {
+		int info[4] = { 0 };
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return false;
+		__cpuid(info, 1);
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool fma = (info[2] & (1 << 12)) != 0;
+		if (!osxsave || !fma)
+			return false;
+		if ((_xgetbv(0) & 0x6) != 0x6)
+			return false;
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+	}();
+	return bHasAVX2;
+#elif defined(__GNUC__) || defined(__clang__)
+	static const bool bHasAVX2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+	return bHasAVX2;
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,119 @@
+#include "HrtfSet.h"
+#include "RealFft.h"
+#include <math.h>
+#include <algorithm>
+
+namespace {
+	const double kPi = 3.14159265358979323846;
+	const double kHeadRadius = 0.0875;
+	const double kSpeedOfSound = 343.0;
+	//samples every response is delayed by, leaves room for the pre-ringing
+	//of the fractional delay.
+	const double kBulkDelay = 8.0;
+	//Brown-Duda head shadow: strongest at kShadowAngle from the ear, where
+	//the high frequencies drop to kMinShadow of their level.
+	const double kMinShadow = 0.1;
+	const double kShadowAngle = 150.0 * kPi / 180.0;
+
+	//one ear's response to a source in direction (x, y, z), as a spectrum.
+	void DesignEar(double x, double y, double z, double earX, int sampleRate,
+		int size, std::vector<float>& re, std::vector<float>& im)
+	{
+		double cosIncidence = (std::max)(-1.0, (std::min)(1.0, x * earX));
+		double incidence = acos(cosIncidence);
+		//Woodworth: straight path to the near side, around the head to the far.
+		double delay = incidence <= kPi / 2 ? -kHeadRadius / kSpeedOfSound * cosIncidence
+			: kHeadRadius / kSpeedOfSound * (incidence - kPi / 2);
+		double delaySamples = kBulkDelay + (delay + kHeadRadius / kSpeedOfSound) * sampleRate;
+		double alpha = (1 + kMinShadow / 2) + (1 - kMinShadow / 2) * cos(incidence / kShadowAngle * kPi);
+		double w0 = kSpeedOfSound / kHeadRadius;
+
+		double elevation = asin((std::max)(-1.0, (std::min)(1.0, z)));
+		double notchHz = 6000 + 4000 * (elevation + kPi / 4) / (kPi * 3 / 4);
+		double notchDepth = 0.6 * (1 - 0.5 * (std::max)(0.0, elevation) / (kPi / 2));
+		double behind = (std::max)(0.0, -y);
+
+		int bins = size / 2 + 1;
+		for (int k = 0; k < bins; ++k) {
+			double hz = (double)k * sampleRate / size;
+			double w = 2 * kPi * hz;
+			//(1 + j alpha w / 2w0) / (1 + j w / 2w0)
+			double nr = 1, ni = alpha * w / (2 * w0);
+			double dr = 1, di = w / (2 * w0);
+			double den = dr * dr + di * di;
+			double hr = (nr * dr + ni * di) / den;
+			double hi = (ni * dr - nr * di) / den;
+			double gain = 1 - notchDepth * exp(-pow((hz - notchHz) / 1500, 2));
+			gain *= 1 - 0.4 * behind * hz * hz / (hz * hz + 4000.0 * 4000.0);
+			double phase = -w * delaySamples / sampleRate;
+			double pr = cos(phase), pi = sin(phase);
+			re[k] = (float)(gain * (hr * pr - hi * pi));
+			im[k] = (float)(gain * (hr * pi + hi * pr));
+		}
+	}
+}
+
+CHrtfSet::CHrtfSet()
+{
+}
+
+bool CHrtfSet::Build(int sampleRate, int length)
+{
+	m_length = 0;
+	CRealFft fft;
+	if (sampleRate < 8000 || !fft.Init(length))
+		return false;
+	//the far ear's delay has to fit well inside the response.
+	if (kBulkDelay + 2 * kHeadRadius / kSpeedOfSound * sampleRate > length / 2)
+		return false;
+
+	int count = GetCount();
+	m_left.assign((size_t)count * length, 0.f);
+	m_right.assign((size_t)count * length, 0.f);
+	std::vector<float> re(fft.GetBins()), im(fft.GetBins());
+	std::vector<float> window(length, 1.f);
+	//fade out the last quarter, the tail is only model ringing.
+	int fade = length / 4;
+	for (int i = 0; i < fade; ++i)
+		window[length - fade + i] = (float)(0.5 + 0.5 * cos(kPi * (i + 1) / fade));
+
+	for (int index = 0; index < count; ++index) {
+		float azimuth, elevation;
+		GetDirection(index, &azimuth, &elevation);
+		double az = azimuth * kPi / 180, el = elevation * kPi / 180;
+		double x = cos(el) * sin(az), y = cos(el) * cos(az), z = sin(el);
+		float* left = &m_left[(size_t)index * length];
+		float* right = &m_right[(size_t)index * length];
+		DesignEar(x, y, z, -1.0, sampleRate, length, re, im);
+		fft.Inverse(re.data(), im.data(), left);
+		DesignEar(x, y, z, 1.0, sampleRate, length, re, im);
+		fft.Inverse(re.data(), im.data(), right);
+		for (int i = 0; i < length; ++i) {
+			left[i] *= window[i];
+			right[i] *= window[i];
+		}
+	}
+	m_sampleRate = sampleRate;
+	m_length = length;
+	return true;
+}
+
+int CHrtfSet::FindNearest(float azimuth, float elevation) const
+{
+	float az = fmodf(azimuth, 360.f);
+	if (az < 0)
+		az += 360.f;
+	int azIndex = (int)lrintf(az / AZIMUTH_STEP) % AZIMUTH_COUNT;
+	float el = (std::max)((float)MIN_ELEVATION, (std::min)((float)MAX_ELEVATION, elevation));
+	int elIndex = (int)lrintf((el - MIN_ELEVATION) / ELEVATION_STEP);
+	//straight up every azimuth is the same direction.
+	if (elIndex == ELEVATION_COUNT - 1)
+		azIndex = 0;
+	return elIndex * AZIMUTH_COUNT + azIndex;
+}
+
+void CHrtfSet::GetDirection(int index, float* azimuth, float* elevation) const
+{
+	*azimuth = (float)(index % AZIMUTH_COUNT * AZIMUTH_STEP);
+	*elevation = (float)(index / AZIMUTH_COUNT * ELEVATION_STEP + MIN_ELEVATION);
+}
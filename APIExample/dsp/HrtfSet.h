@@ -0,0 +1,50 @@
+#pragma once
+#include <stddef.h>
+#include <vector>
+
+/*
+	Head related impulse responses for a grid of directions, every
+	AZIMUTH_STEP degrees around and every ELEVATION_STEP degrees from
+	MIN_ELEVATION up to MAX_ELEVATION. Directions are in listener space:
+	azimuth 0 straight ahead growing clockwise (90 is the right ear),
+	elevation 0 at ear level and 90 straight up.
+
+	The responses come from a spherical head model instead of a measured
+	set: Woodworth's interaural time difference, the Brown-Duda one pole
+	one zero head shadow for each ear, and a pinna notch that moves up
+	with elevation. That keeps the application free of data files and
+	gives usable left/right and front/back cues.
+*/
+class CHrtfSet
+{
+public:
+	enum {
+		AZIMUTH_STEP = 5,
+		ELEVATION_STEP = 15,
+		MIN_ELEVATION = -45,
+		MAX_ELEVATION = 90,
+		AZIMUTH_COUNT = 360 / AZIMUTH_STEP,
+		ELEVATION_COUNT = (MAX_ELEVATION - MIN_ELEVATION) / ELEVATION_STEP + 1,
+	};
+
+	CHrtfSet();
+
+	//length taps per ear, a power of two.
+	bool Build(int sampleRate, int length);
+	bool IsBuilt() const { return m_length > 0; }
+	int GetSampleRate() const { return m_sampleRate; }
+	int GetLength() const { return m_length; }
+	int GetCount() const { return AZIMUTH_COUNT * ELEVATION_COUNT; }
+
+	//index of the grid direction closest to azimuth / elevation in degrees.
+	int FindNearest(float azimuth, float elevation) const;
+	void GetDirection(int index, float* azimuth, float* elevation) const;
+	const float* GetLeft(int index) const { return &m_left[(size_t)index * m_length]; }
+	const float* GetRight(int index) const { return &m_right[(size_t)index * m_length]; }
+
+private:
+	int m_sampleRate = 0;
+	int m_length = 0;
+	std::vector<float> m_left;
+	std::vector<float> m_right;
+};
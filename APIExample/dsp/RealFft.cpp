@@ -0,0 +1,130 @@
+#include "RealFft.h"
+#include <math.h>
+
+namespace {
+	const double kPi = 3.14159265358979323846;
+}
+
+CRealFft::CRealFft()
+{
+}
+
+bool CRealFft::Init(int size)
+{
+	if (size < MIN_SIZE || size > MAX_SIZE || (size & (size - 1)) != 0)
+		return false;
+	m_size = size;
+	m_half = size / 2;
+
+	int bits = 0;
+	while ((1 << bits) < m_half)
+		++bits;
+	m_bitReverse.resize(m_half);
+	for (int i = 0; i < m_half; ++i) {
+		int r = 0;
+		for (int b = 0; b < bits; ++b)
+			r |= ((i >> b) & 1) << (bits - 1 - b);
+		m_bitReverse[i] = r;
+	}
+	m_cos.resize(m_half / 2);
+	m_sin.resize(m_half / 2);
+	for (int k = 0; k < m_half / 2; ++k) {
+		m_cos[k] = (float)cos(2 * kPi * k / m_half);
+		m_sin[k] = (float)sin(2 * kPi * k / m_half);
+	}
+	m_splitCos.resize(m_half + 1);
+	m_splitSin.resize(m_half + 1);
+	for (int k = 0; k <= m_half; ++k) {
+		m_splitCos[k] = (float)cos(2 * kPi * k / m_size);
+		m_splitSin[k] = (float)sin(2 * kPi * k / m_size);
+	}
+	m_workRe.assign(m_half, 0.f);
+	m_workIm.assign(m_half, 0.f);
+	return true;
+}
+
+void CRealFft::Transform(float sign)
+{
+	float* re = m_workRe.data();
+	float* im = m_workIm.data();
+	for (int i = 0; i < m_half; ++i) {
+		int j = m_bitReverse[i];
+		if (j > i) {
+			float t = re[i]; re[i] = re[j]; re[j] = t;
+			t = im[i]; im[i] = im[j]; im[j] = t;
+		}
+	}
+	for (int len = 2; len <= m_half; len <<= 1) {
+		int half = len / 2;
+		int step = m_half / len;
+		for (int i = 0; i < m_half; i += len) {
+			for (int j = 0; j < half; ++j) {
+				float wr = m_cos[j * step];
+				float wi = sign * m_sin[j * step];
+				int a = i + j;
+				int b = a + half;
+				float tr = re[b] * wr - im[b] * wi;
+				float ti = re[b] * wi + im[b] * wr;
+				re[b] = re[a] - tr;
+				im[b] = im[a] - ti;
+				re[a] += tr;
+				im[a] += ti;
+			}
+		}
+	}
+}
+
+/*
+	The even samples go into the real and the odd ones into the imaginary
+	part of a half size transform Z. With E and O the spectra of the even
+	and odd samples
+		E[k] = (Z[k] + conj(Z[M - k])) / 2
+		O[k] = (Z[k] - conj(Z[M - k])) / 2i
+		X[k] = E[k] + e^(-2 pi i k / N) O[k]
+	and Inverse runs the same steps backwards.
+*/
+void CRealFft::Forward(const float* input, float* re, float* im)
+{
+	for (int i = 0; i < m_half; ++i) {
+		m_workRe[i] = input[2 * i];
+		m_workIm[i] = input[2 * i + 1];
+	}
+	Transform(-1.f);
+	for (int k = 0; k <= m_half; ++k) {
+		int a = k == m_half ? 0 : k;
+		int b = k == 0 ? 0 : m_half - k;
+		float ar = m_workRe[a], ai = m_workIm[a];
+		float br = m_workRe[b], bi = -m_workIm[b];
+		float evenRe = (ar + br) * 0.5f;
+		float evenIm = (ai + bi) * 0.5f;
+		float oddRe = (ai - bi) * 0.5f;
+		float oddIm = -(ar - br) * 0.5f;
+		float wr = m_splitCos[k], wi = -m_splitSin[k];
+		re[k] = evenRe + wr * oddRe - wi * oddIm;
+		im[k] = evenIm + wr * oddIm + wi * oddRe;
+	}
+}
+
+void CRealFft::Inverse(const float* re, const float* im, float* output)
+{
+	for (int k = 0; k < m_half; ++k) {
+		int m = m_half - k;
+		float ar = re[k], ai = k == 0 ? 0.f : im[k];
+		float br = re[m], bi = m == m_half ? 0.f : -im[m];
+		float evenRe = (ar + br) * 0.5f;
+		float evenIm = (ai + bi) * 0.5f;
+		float dr = (ar - br) * 0.5f;
+		float di = (ai - bi) * 0.5f;
+		float wr = m_splitCos[k], wi = m_splitSin[k];
+		float oddRe = dr * wr - di * wi;
+		float oddIm = dr * wi + di * wr;
+		m_workRe[k] = evenRe - oddIm;
+		m_workIm[k] = evenIm + oddRe;
+	}
+	Transform(1.f);
+	float scale = 1.f / m_half;
+	for (int i = 0; i < m_half; ++i) {
+		output[2 * i] = m_workRe[i] * scale;
+		output[2 * i + 1] = m_workIm[i] * scale;
+	}
+}
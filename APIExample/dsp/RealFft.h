@@ -0,0 +1,47 @@
+#pragma once
+#include <vector>
+
+/*
+	FFT of real signals with power of two sizes from MIN_SIZE to MAX_SIZE,
+	done as a half size complex radix-2 transform. Spectra hold the
+	GetBins() = size / 2 + 1 non-negative frequency bins as separate real
+	and imaginary arrays so that products of spectra are plain loops over
+	floats. Forward is unscaled and Inverse scales by 1 / size, the pair
+	gives back the input.
+*/
+class CRealFft
+{
+public:
+	enum {
+		MIN_SIZE = 8,
+		MAX_SIZE = 65536,
+	};
+
+	CRealFft();
+
+	bool Init(int size);
+	int GetSize() const { return m_size; }
+	int GetBins() const { return m_size / 2 + 1; }
+
+	//input: GetSize() samples. re, im: GetBins() values each.
+	void Forward(const float* input, float* re, float* im);
+	//re, im: GetBins() values each, the imaginary parts of the first and
+	//last bin are ignored. output: GetSize() samples.
+	void Inverse(const float* re, const float* im, float* output);
+
+private:
+	//in place on m_workRe / m_workIm, sign -1 forward, +1 inverse.
+	void Transform(float sign);
+
+	int m_size = 0;
+	int m_half = 0;
+	std::vector<int> m_bitReverse;
+	//e^(-2 pi i k / half) for the complex transform.
+	std::vector<float> m_cos;
+	std::vector<float> m_sin;
+	//e^(-2 pi i k / size) to split the half size transform.
+	std::vector<float> m_splitCos;
+	std::vector<float> m_splitSin;
+	std::vector<float> m_workRe;
+	std::vector<float> m_workIm;
+};
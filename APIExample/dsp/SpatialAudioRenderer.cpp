@@ -0,0 +1,410 @@
+#include "SpatialAudioRenderer.h"
+#include "CpuFeatures.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+namespace {
+	const double kPi = 3.14159265358979323846;
+	enum {
+		ACC_STEADY = 0,
+		ACC_FADE_OUT,
+		ACC_FADE_IN,
+		ACC_COUNT,
+	};
+
+	//acc += a * b on split complex arrays.
+	void MultiplyAddC(const float* aRe, const float* aIm, const float* bRe, const float* bIm,
+		float* accRe, float* accIm, int n)
+	{
+		for (int i = 0; i < n; ++i) {
+			accRe[i] += aRe[i] * bRe[i] - aIm[i] * bIm[i];
+			accIm[i] += aRe[i] * bIm[i] + aIm[i] * bRe[i];
+		}
+	}
+
+	AG_TARGET_AVX2 void MultiplyAddAVX2(const float* aRe, const float* aIm, const float* bRe, const float* bIm,
+		float* accRe, float* accIm, int n)
+	{
+		int i = 0;
+		for (; i + 8 <= n; i += 8) {
+			__m256 ar = _mm256_loadu_ps(aRe + i);
+			__m256 ai = _mm256_loadu_ps(aIm + i);
+			__m256 br = _mm256_loadu_ps(bRe + i);
+			__m256 bi = _mm256_loadu_ps(bIm + i);
+			__m256 re = _mm256_fmadd_ps(ar, br, _mm256_loadu_ps(accRe + i));
+			__m256 im = _mm256_fmadd_ps(ar, bi, _mm256_loadu_ps(accIm + i));
+			_mm256_storeu_ps(accRe + i, _mm256_fnmadd_ps(ai, bi, re));
+			_mm256_storeu_ps(accIm + i, _mm256_fmadd_ps(ai, br, im));
+		}
+		for (; i < n; ++i) {
+			accRe[i] += aRe[i] * bRe[i] - aIm[i] * bIm[i];
+			accIm[i] += aRe[i] * bIm[i] + aIm[i] * bRe[i];
+		}
+	}
+
+	inline int16_t ClampToInt16(float v)
+	{
+		if (v >= 32767.f)
+			return 32767;
+		if (v <= -32768.f)
+			return -32768;
+		return (int16_t)lrintf(v);
+	}
+}
+
+CSpatialAudioRenderer::CSpatialAudioRenderer()
+{
+}
+
+CSpatialAudioRenderer::~CSpatialAudioRenderer()
+{
+}
+
+bool CSpatialAudioRenderer::Init(int sampleRate)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_sampleRate = 0;
+	if (!m_hrtf.Build(sampleRate, HRIR_LENGTH) || !m_fft.Init(BLOCK_SIZE * 2))
+		return false;
+	m_bins = m_fft.GetBins();
+
+	int count = m_hrtf.GetCount();
+	size_t filterSize = (size_t)count * 2 * PARTITIONS * m_bins;
+	m_filterRe.assign(filterSize, 0.f);
+	m_filterIm.assign(filterSize, 0.f);
+	std::vector<float> padded(BLOCK_SIZE * 2);
+	for (int filter = 0; filter < count; ++filter) {
+		for (int ear = 0; ear < 2; ++ear) {
+			const float* response = ear == 0 ? m_hrtf.GetLeft(filter) : m_hrtf.GetRight(filter);
+			for (int partition = 0; partition < PARTITIONS; ++partition) {
+				std::fill(padded.begin(), padded.end(), 0.f);
+				memcpy(padded.data(), response + partition * BLOCK_SIZE, BLOCK_SIZE * sizeof(float));
+				size_t offset = (((size_t)filter * 2 + ear) * PARTITIONS + partition) * m_bins;
+				m_fft.Forward(padded.data(), &m_filterRe[offset], &m_filterIm[offset]);
+			}
+		}
+	}
+	m_multiplyAdd = AgHasAVX2() ? MultiplyAddAVX2 : MultiplyAddC;
+
+	for (int ear = 0; ear < 2; ++ear) {
+		for (int acc = 0; acc < ACC_COUNT; ++acc) {
+			m_accRe[ear][acc].assign(m_bins, 0.f);
+			m_accIm[ear][acc].assign(m_bins, 0.f);
+		}
+	}
+	for (int acc = 0; acc < ACC_COUNT; ++acc)
+		m_blockOut[acc].assign(BLOCK_SIZE * 2, 0.f);
+	m_crossfade.resize(BLOCK_SIZE);
+	m_ramp.resize(BLOCK_SIZE);
+	for (int i = 0; i < BLOCK_SIZE; ++i) {
+		m_crossfade[i] = (float)(0.5 - 0.5 * cos(kPi * (i + 1) / BLOCK_SIZE));
+		m_ramp[i] = (float)(i + 1) / BLOCK_SIZE;
+	}
+	m_sampleRate = sampleRate;
+	{
+		std::lock_guard<std::mutex> paramLock(m_paramMutex);
+		m_paramsChanged = true;
+	}
+	m_sources.clear();
+	m_pendingSamples = 0;
+	//the latency: one block of silence ahead of the first rendered block.
+	for (int ear = 0; ear < 2; ++ear)
+		m_output[ear].assign(BLOCK_SIZE * 8, 0.f);
+	m_outputSamples = BLOCK_SIZE;
+	return true;
+}
+
+void CSpatialAudioRenderer::Reset()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_sources.clear();
+	m_pendingSamples = 0;
+	for (int ear = 0; ear < 2; ++ear)
+		std::fill(m_output[ear].begin(), m_output[ear].end(), 0.f);
+	m_outputSamples = BLOCK_SIZE;
+}
+
+void CSpatialAudioRenderer::SetSourcePosition(unsigned int uid, float x, float y, float z)
+{
+	std::lock_guard<std::mutex> lock(m_paramMutex);
+	Position& position = m_positions[uid];
+	position.x = x;
+	position.y = y;
+	position.z = z;
+	m_paramsChanged = true;
+}
+
+void CSpatialAudioRenderer::SetDefaultPosition(float x, float y, float z)
+{
+	std::lock_guard<std::mutex> lock(m_paramMutex);
+	m_defaultPosition.x = x;
+	m_defaultPosition.y = y;
+	m_defaultPosition.z = z;
+	m_paramsChanged = true;
+}
+
+void CSpatialAudioRenderer::RemoveSource(unsigned int uid)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_paramMutex);
+		m_positions.erase(uid);
+		m_paramsChanged = true;
+	}
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_sources.erase(std::remove_if(m_sources.begin(), m_sources.end(),
+		[uid](const std::unique_ptr<Source>& source) { return source->uid == uid; }), m_sources.end());
+}
+
+void CSpatialAudioRenderer::SetDistanceModel(float refDistance, float maxDistance, float rolloff)
+{
+	std::lock_guard<std::mutex> lock(m_paramMutex);
+	m_refDistance = (std::max)(refDistance, 0.01f);
+	m_maxDistance = (std::max)(maxDistance, m_refDistance);
+	m_rolloff = (std::max)(rolloff, 0.f);
+	m_paramsChanged = true;
+}
+
+int CSpatialAudioRenderer::GetSourceCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return (int)m_sources.size();
+}
+
+CSpatialAudioRenderer::Source* CSpatialAudioRenderer::FindSource(unsigned int uid, bool create)
+{
+	for (auto& source : m_sources) {
+		if (source->uid == uid)
+			return source.get();
+	}
+	if (!create || m_sources.size() >= MAX_SOURCES)
+		return nullptr;
+	std::unique_ptr<Source> source(new Source);
+	source->uid = uid;
+	source->window.assign(BLOCK_SIZE * 2, 0.f);
+	source->historyRe.assign((size_t)PARTITIONS * m_bins, 0.f);
+	source->historyIm.assign((size_t)PARTITIONS * m_bins, 0.f);
+	source->pending.assign(m_pendingSamples, 0.f);
+	m_sources.push_back(std::move(source));
+	return m_sources.back().get();
+}
+
+void CSpatialAudioRenderer::SubmitSource(unsigned int uid, const int16_t* pcm, int samples, int channels)
+{
+	if (!pcm || samples <= 0 || channels <= 0)
+		return;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_sampleRate)
+		return;
+	Source* source = FindSource(uid, true);
+	if (!source)
+		return;
+	if ((int)source->frame.size() < source->frameSamples + samples)
+		source->frame.resize(source->frameSamples + samples);
+	float* frame = &source->frame[source->frameSamples];
+	float scale = 1.f / channels;
+	for (int i = 0; i < samples; ++i) {
+		int sum = 0;
+		for (int c = 0; c < channels; ++c)
+			sum += pcm[i * channels + c];
+		frame[i] = sum * scale;
+	}
+	source->frameSamples += samples;
+	source->idleFrames = 0;
+}
+
+//filter and gain each position asks for, redone only after a setter ran.
+void CSpatialAudioRenderer::UpdateTargets()
+{
+	std::lock_guard<std::mutex> lock(m_paramMutex);
+	if (!m_paramsChanged)
+		return;
+	auto target = [this](const Position& position, int* filter, float* gain) {
+		float horizontal = sqrtf(position.x * position.x + position.y * position.y);
+		float distance = sqrtf(horizontal * horizontal + position.z * position.z);
+		float azimuth = 0, elevation = 0;
+		if (distance > 1e-3f) {
+			azimuth = (float)(atan2(position.x, position.y) * 180 / kPi);
+			elevation = (float)(atan2(position.z, horizontal) * 180 / kPi);
+		}
+		*filter = m_hrtf.FindNearest(azimuth, elevation);
+		if (distance > m_maxDistance)
+			*gain = 0;
+		else
+			*gain = powf(m_refDistance / (std::max)(distance, m_refDistance), m_rolloff);
+	};
+	m_targetFilters.clear();
+	m_targetGains.clear();
+	for (auto& it : m_positions)
+		target(it.second, &m_targetFilters[it.first], &m_targetGains[it.first]);
+	target(m_defaultPosition, &m_defaultFilter, &m_defaultGain);
+	m_paramsChanged = false;
+}
+
+void CSpatialAudioRenderer::FilterSpectrum(int filter, int ear, int partition, const float** re, const float** im) const
+{
+	size_t offset = (((size_t)filter * 2 + ear) * PARTITIONS + partition) * m_bins;
+	*re = &m_filterRe[offset];
+	*im = &m_filterIm[offset];
+}
+
+void CSpatialAudioRenderer::Render(int16_t* output, int samples, int channels, bool replace)
+{
+	auto begin = std::chrono::steady_clock::now();
+	if (!output || samples <= 0 || channels <= 0)
+		return;
+	UpdateTargets();
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_sampleRate)
+		return;
+
+	//this frame's input joins what is left over from the last one; users
+	//that sent nothing contribute silence so everyone stays aligned.
+	for (size_t i = 0; i < m_sources.size();) {
+		Source* source = m_sources[i].get();
+		if (source->frameSamples == 0 && ++source->idleFrames > IDLE_FRAMES) {
+			m_sources.erase(m_sources.begin() + i);
+			continue;
+		}
+		if ((int)source->pending.size() < m_pendingSamples + samples)
+			source->pending.resize(m_pendingSamples + samples);
+		int copy = (std::min)(source->frameSamples, samples);
+		memcpy(&source->pending[m_pendingSamples], source->frame.data(), copy * sizeof(float));
+		std::fill(source->pending.begin() + m_pendingSamples + copy, source->pending.begin() + m_pendingSamples + samples, 0.f);
+		source->frameSamples = 0;
+		++i;
+	}
+	m_pendingSamples += samples;
+
+	int blocks = m_pendingSamples / BLOCK_SIZE;
+	if ((int)m_output[0].size() < m_outputSamples + blocks * BLOCK_SIZE) {
+		for (int ear = 0; ear < 2; ++ear)
+			m_output[ear].resize(m_outputSamples + blocks * BLOCK_SIZE);
+	}
+	m_blockOffset = 0;
+	for (int block = 0; block < blocks; ++block)
+		ProcessBlock();
+	int consumed = blocks * BLOCK_SIZE;
+	m_pendingSamples -= consumed;
+	for (auto& source : m_sources)
+		memmove(source->pending.data(), source->pending.data() + consumed, m_pendingSamples * sizeof(float));
+
+	//the block of latency keeps m_outputSamples >= samples.
+	int count = (std::min)(samples, m_outputSamples);
+	const float* left = m_output[0].data();
+	const float* right = m_output[1].data();
+	for (int i = 0; i < count; ++i) {
+		int16_t* out = output + i * channels;
+		if (channels == 1) {
+			float mono = (left[i] + right[i]) * 0.5f;
+			out[0] = ClampToInt16(replace ? mono : out[0] + mono);
+		}
+		else {
+			out[0] = ClampToInt16(replace ? left[i] : out[0] + left[i]);
+			out[1] = ClampToInt16(replace ? right[i] : out[1] + right[i]);
+		}
+	}
+	m_outputSamples -= count;
+	for (int ear = 0; ear < 2; ++ear)
+		memmove(m_output[ear].data(), m_output[ear].data() + count, m_outputSamples * sizeof(float));
+	m_lastRenderNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - begin).count();
+}
+
+void CSpatialAudioRenderer::ProcessBlock()
+{
+	bool used[ACC_COUNT] = { false, false, false };
+	for (int ear = 0; ear < 2; ++ear) {
+		for (int acc = 0; acc < ACC_COUNT; ++acc) {
+			std::fill(m_accRe[ear][acc].begin(), m_accRe[ear][acc].end(), 0.f);
+			std::fill(m_accIm[ear][acc].begin(), m_accIm[ear][acc].end(), 0.f);
+		}
+	}
+
+	for (auto& it : m_sources) {
+		Source* source = it.get();
+		auto filterIt = m_targetFilters.find(source->uid);
+		int targetFilter = filterIt != m_targetFilters.end() ? filterIt->second : m_defaultFilter;
+		auto gainIt = m_targetGains.find(source->uid);
+		float targetGain = gainIt != m_targetGains.end() ? gainIt->second : m_defaultGain;
+
+		//slide the overlap-save window and ramp the gain over the new block.
+		float* window = source->window.data();
+		memcpy(window, window + BLOCK_SIZE, BLOCK_SIZE * sizeof(float));
+		float* input = window + BLOCK_SIZE;
+		const float* pending = source->pending.data() + m_blockOffset;
+		float gain = source->gain;
+		float step = targetGain - gain;
+		bool silent = true;
+		for (int i = 0; i < BLOCK_SIZE; ++i) {
+			input[i] = pending[i] * (gain + step * m_ramp[i]);
+			silent = silent && input[i] == 0.f;
+		}
+		source->gain = targetGain;
+		source->silentBlocks = silent ? source->silentBlocks + 1 : 0;
+		//once the window and every stored spectrum are zero there is
+		//nothing to add until the source makes a sound again.
+		if (source->silentBlocks > PARTITIONS) {
+			source->filter = targetFilter;
+			continue;
+		}
+
+		int pos = source->historyPos;
+		float* historyRe = &source->historyRe[(size_t)pos * m_bins];
+		float* historyIm = &source->historyIm[(size_t)pos * m_bins];
+		m_fft.Forward(window, historyRe, historyIm);
+
+		int filter = source->filter < 0 ? targetFilter : source->filter;
+		bool fading = filter != targetFilter;
+		for (int partition = 0; partition < PARTITIONS; ++partition) {
+			int slot = (pos - partition + PARTITIONS) % PARTITIONS;
+			const float* xRe = &source->historyRe[(size_t)slot * m_bins];
+			const float* xIm = &source->historyIm[(size_t)slot * m_bins];
+			for (int ear = 0; ear < 2; ++ear) {
+				const float* hRe;
+				const float* hIm;
+				if (fading) {
+					FilterSpectrum(filter, ear, partition, &hRe, &hIm);
+					m_multiplyAdd(xRe, xIm, hRe, hIm, m_accRe[ear][ACC_FADE_OUT].data(), m_accIm[ear][ACC_FADE_OUT].data(), m_bins);
+					FilterSpectrum(targetFilter, ear, partition, &hRe, &hIm);
+					m_multiplyAdd(xRe, xIm, hRe, hIm, m_accRe[ear][ACC_FADE_IN].data(), m_accIm[ear][ACC_FADE_IN].data(), m_bins);
+				}
+				else {
+					FilterSpectrum(filter, ear, partition, &hRe, &hIm);
+					m_multiplyAdd(xRe, xIm, hRe, hIm, m_accRe[ear][ACC_STEADY].data(), m_accIm[ear][ACC_STEADY].data(), m_bins);
+				}
+			}
+		}
+		if (fading)
+			used[ACC_FADE_OUT] = used[ACC_FADE_IN] = true;
+		else
+			used[ACC_STEADY] = true;
+		source->filter = targetFilter;
+		source->historyPos = (pos + 1) % PARTITIONS;
+	}
+
+	//overlap-save keeps the second half of each inverse transform.
+	for (int ear = 0; ear < 2; ++ear) {
+		float* out = &m_output[ear][m_outputSamples];
+		std::fill(out, out + BLOCK_SIZE, 0.f);
+		for (int acc = 0; acc < ACC_COUNT; ++acc) {
+			if (!used[acc])
+				continue;
+			float* time = m_blockOut[acc].data();
+			m_fft.Inverse(m_accRe[ear][acc].data(), m_accIm[ear][acc].data(), time);
+			const float* valid = time + BLOCK_SIZE;
+			if (acc == ACC_STEADY) {
+				for (int i = 0; i < BLOCK_SIZE; ++i)
+					out[i] += valid[i];
+			}
+			else {
+				bool fadeIn = acc == ACC_FADE_IN;
+				for (int i = 0; i < BLOCK_SIZE; ++i)
+					out[i] += valid[i] * (fadeIn ? m_crossfade[i] : 1.f - m_crossfade[i]);
+			}
+		}
+	}
+	m_outputSamples += BLOCK_SIZE;
+	m_blockOffset += BLOCK_SIZE;
+}
@@ -0,0 +1,152 @@
+#pragma once
+#include "HrtfSet.h"
+#include "RealFft.h"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+/*
+	Places remote users around the listener. Each source is convolved with
+	the head related impulse responses of its direction (CHrtfSet) and
+	attenuated with distance; all sources are summed into a stereo mix.
+
+	Convolution is uniformly partitioned overlap-save: the responses are
+	cut into BLOCK_SIZE partitions whose spectra are computed once, every
+	source keeps the spectra of its last input blocks, and a block of
+	output is the sum of partition x input products. The products of all
+	sources are summed in the frequency domain so there are only two
+	inverse FFTs per block however many sources play. When a source moves
+	to another grid direction the old and the new response are
+	crossfaded over one block, gain changes are ramped the same way.
+
+	Usage, all on the audio thread except the position setters:
+		SubmitSource(uid, pcm) for each user's frame
+		Render(output) once per frame
+	Everything submitted between two Render calls belongs to the same
+	frame; sources that submitted nothing play silence. Output is delayed
+	by GetLatencySamples.
+
+	Coordinates are meters in listener space: x to the right, y ahead,
+	z up.
+*/
+class CSpatialAudioRenderer
+{
+public:
+	enum {
+		BLOCK_SIZE = 128,
+		HRIR_LENGTH = 256,
+		PARTITIONS = HRIR_LENGTH / BLOCK_SIZE,
+		MAX_SOURCES = 64,
+		//sources that have not submitted for this many frames are dropped.
+		IDLE_FRAMES = 300,
+	};
+
+	CSpatialAudioRenderer();
+	~CSpatialAudioRenderer();
+
+	bool Init(int sampleRate);
+	bool IsInitialized() const { return m_sampleRate > 0; }
+	int GetSampleRate() const { return m_sampleRate; }
+	int GetLatencySamples() const { return BLOCK_SIZE; }
+	//drops all sources and buffered audio, keeps positions.
+	void Reset();
+
+	void SetSourcePosition(unsigned int uid, float x, float y, float z);
+	//where sources without a position of their own play.
+	void SetDefaultPosition(float x, float y, float z);
+	void RemoveSource(unsigned int uid);
+	/*
+		gain = (refDistance / max(distance, refDistance)) ^ rolloff,
+		sources beyond maxDistance are muted and cost nothing.
+	*/
+	void SetDistanceModel(float refDistance, float maxDistance, float rolloff);
+
+	//interleaved PCM16 at the Init sample rate, channels are averaged.
+	void SubmitSource(unsigned int uid, const int16_t* pcm, int samples, int channels);
+	/*
+		writes samples of the mix into interleaved output. Stereo gets
+		left / right, mono their average, further channels stay as they
+		are. replace false adds the mix to what output holds.
+	*/
+	void Render(int16_t* output, int samples, int channels, bool replace);
+
+	int GetSourceCount() const;
+	//time the last Render took.
+	int64_t GetLastRenderNs() const { return m_lastRenderNs; }
+
+private:
+	struct Position {
+		float x = 0;
+		float y = 1;
+		float z = 0;
+	};
+
+	struct Source {
+		unsigned int uid = 0;
+		//this frame's samples, mono.
+		std::vector<float> frame;
+		int frameSamples = 0;
+		int idleFrames = 0;
+		//input not yet consumed by a block, same length for every source.
+		std::vector<float> pending;
+		//previous and current input block, the overlap-save window.
+		std::vector<float> window;
+		//spectra of the last PARTITIONS blocks, m_bins each.
+		std::vector<float> historyRe;
+		std::vector<float> historyIm;
+		int historyPos = 0;
+		//consecutive all zero blocks, history is clear once above PARTITIONS.
+		int silentBlocks = PARTITIONS + 1;
+		int filter = -1;
+		float gain = 0;
+	};
+
+	typedef void(*MultiplyAddFunc)(const float* aRe, const float* aIm,
+		const float* bRe, const float* bIm, float* accRe, float* accIm, int n);
+
+	Source* FindSource(unsigned int uid, bool create);
+	void UpdateTargets();
+	void ProcessBlock();
+	void FilterSpectrum(int filter, int ear, int partition, const float** re, const float** im) const;
+
+	int m_sampleRate = 0;
+	int m_bins = 0;
+	CHrtfSet m_hrtf;
+	CRealFft m_fft;
+	//partition spectra of every direction: [direction][ear][partition][bin].
+	std::vector<float> m_filterRe;
+	std::vector<float> m_filterIm;
+	MultiplyAddFunc m_multiplyAdd = nullptr;
+
+	//positions come from the UI thread.
+	mutable std::mutex m_paramMutex;
+	std::map<unsigned int, Position> m_positions;
+	Position m_defaultPosition;
+	float m_refDistance = 1.f;
+	float m_maxDistance = 50.f;
+	float m_rolloff = 1.f;
+	bool m_paramsChanged = true;
+
+	//audio thread state.
+	mutable std::mutex m_mutex;
+	std::vector<std::unique_ptr<Source>> m_sources;
+	//per source, from the positions at the last UpdateTargets.
+	std::map<unsigned int, int> m_targetFilters;
+	std::map<unsigned int, float> m_targetGains;
+	int m_defaultFilter = 0;
+	float m_defaultGain = 1.f;
+	int m_pendingSamples = 0;
+	//where in pending the next block starts.
+	int m_blockOffset = 0;
+	//[ear] steady sum, fading out and fading in products.
+	std::vector<float> m_accRe[2][3];
+	std::vector<float> m_accIm[2][3];
+	std::vector<float> m_blockOut[3];
+	std::vector<float> m_crossfade;
+	std::vector<float> m_ramp;
+	std::vector<float> m_output[2];
+	int m_outputSamples = 0;
+	int64_t m_lastRenderNs = 0;
+};
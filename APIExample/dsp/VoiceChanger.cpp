@@ -0,0 +1,638 @@
+#include "VoiceChanger.h"
+#include "CpuFeatures.h"
+#include "trace/Trace.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+namespace {
+	const double kPi = 3.14159265358979323846;
+	const float kTwoPi = (float)(2 * kPi);
+	//analysis hops per FFT frame.
+	const int kOverlap = 4;
+	//half width of the spectral envelope, about the harmonic spacing of a
+	//low voice.
+	const float kEnvelopeHz = 150.0f;
+	const float kLowShelfHz = 200.0f;
+	const float kHighShelfHz = 4000.0f;
+	const float kMidQ = 1.0f;
+	//delay lines at room 0.5, in ms.
+	const float kReverbLineMs[CVoiceReverb::LINES] = { 31.1f, 37.3f, 41.9f, 45.7f, 51.1f, 56.3f, 61.7f, 67.9f };
+	const float kReverbInputGain = 0.35f;
+	const float kReverbOutputGain = 0.35f;
+	const float kReverbOutputSigns[CVoiceReverb::LINES] = { 1, -1, 1, -1, 1, -1, 1, -1 };
+
+	int64_t NowNs()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	float Clamp(float value, float low, float high)
+	{
+		return (std::min)((std::max)(value, low), high);
+	}
+
+	bool IsPrime(int n)
+	{
+		if (n < 2)
+			return false;
+		for (int d = 2; d * d <= n; ++d) {
+			if (n % d == 0)
+				return false;
+		}
+		return true;
+	}
+
+	//largest value of src within radius, so the harmonic tops carry over
+	//the gaps between them.
+	void PeakHold(const float* src, float* dst, int n, int radius)
+	{
+		for (int i = 0; i < n; ++i) {
+			int end = (std::min)(n - 1, i + radius);
+			float peak = 0;
+			for (int j = (std::max)(0, i - radius); j <= end; ++j)
+				peak = (std::max)(peak, src[j]);
+			dst[i] = peak;
+		}
+	}
+
+	//box average of src into dst with a window clipped at the ends.
+	void Smooth(const float* src, float* dst, int n, int radius)
+	{
+		float sum = 0;
+		for (int i = 0; i <= (std::min)(radius, n - 1); ++i)
+			sum += src[i];
+		for (int i = 0; i < n; ++i) {
+			int count = (std::min)(n - 1, i + radius) - (std::max)(0, i - radius) + 1;
+			dst[i] = sum / count;
+			if (i + radius + 1 < n)
+				sum += src[i + radius + 1];
+			if (i - radius >= 0)
+				sum -= src[i - radius];
+		}
+	}
+
+	void MultiplyC(float* dst, const float* a, const float* b, int n)
+	{
+		for (int i = 0; i < n; ++i)
+			dst[i] = a[i] * b[i];
+	}
+
+	void MultiplyAddC(float* acc, const float* a, float scale, int n)
+	{
+		for (int i = 0; i < n; ++i)
+			acc[i] += a[i] * scale;
+	}
+
+	float DotC(const float* a, const float* b, int n)
+	{
+		float sum = 0;
+		for (int i = 0; i < n; ++i)
+			sum += a[i] * b[i];
+		return sum;
+	}
+
+	void MagnitudeC(float* magnitude, const float* re, const float* im, int n)
+	{
+		for (int i = 0; i < n; ++i)
+			magnitude[i] = sqrtf(re[i] * re[i] + im[i] * im[i]);
+	}
+
+	AG_TARGET_AVX2 void MultiplyAVX2(float* dst, const float* a, const float* b, int n)
+	{
+		int i = 0;
+		for (; i + 8 <= n; i += 8)
+			_mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+		if (i < n)
+			MultiplyC(dst + i, a + i, b + i, n - i);
+	}
+
+	AG_TARGET_AVX2 void MultiplyAddAVX2(float* acc, const float* a, float scale, int n)
+	{
+		__m256 s = _mm256_set1_ps(scale);
+		int i = 0;
+		for (; i + 8 <= n; i += 8)
+			_mm256_storeu_ps(acc + i, _mm256_fmadd_ps(_mm256_loadu_ps(a + i), s, _mm256_loadu_ps(acc + i)));
+		if (i < n)
+			MultiplyAddC(acc + i, a + i, scale, n - i);
+	}
+
+	AG_TARGET_AVX2 float DotAVX2(const float* a, const float* b, int n)
+	{
+		__m256 sum = _mm256_setzero_ps();
+		int i = 0;
+		for (; i + 8 <= n; i += 8)
+			sum = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum);
+		__m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+		half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+		half = _mm_add_ss(half, _mm_movehdup_ps(half));
+		return _mm_cvtss_f32(half) + (i < n ? DotC(a + i, b + i, n - i) : 0);
+	}
+
+	AG_TARGET_AVX2 void MagnitudeAVX2(float* magnitude, const float* re, const float* im, int n)
+	{
+		int i = 0;
+		for (; i + 8 <= n; i += 8) {
+			__m256 r = _mm256_loadu_ps(re + i);
+			__m256 m = _mm256_loadu_ps(im + i);
+			_mm256_storeu_ps(magnitude + i, _mm256_sqrt_ps(_mm256_fmadd_ps(r, r, _mm256_mul_ps(m, m))));
+		}
+		if (i < n)
+			MagnitudeC(magnitude + i, re + i, im + i, n - i);
+	}
+
+	//unnormalized 8 point Hadamard transform as three butterflies.
+	AG_TARGET_AVX2 inline __m256 Hadamard8(__m256 v)
+	{
+		const __m256 signs1 = _mm256_setr_ps(1, -1, 1, -1, 1, -1, 1, -1);
+		const __m256 signs2 = _mm256_setr_ps(1, 1, -1, -1, 1, 1, -1, -1);
+		const __m256 signs3 = _mm256_setr_ps(1, 1, 1, 1, -1, -1, -1, -1);
+		v = _mm256_fmadd_ps(v, signs1, _mm256_permute_ps(v, 0xB1));
+		v = _mm256_fmadd_ps(v, signs2, _mm256_permute_ps(v, 0x4E));
+		return _mm256_fmadd_ps(v, signs3, _mm256_permute2f128_ps(v, v, 1));
+	}
+
+	void Hadamard8C(float* v)
+	{
+		for (int width = 1; width < CVoiceReverb::LINES; width *= 2) {
+			for (int i = 0; i < CVoiceReverb::LINES; i += 2 * width) {
+				for (int j = i; j < i + width; ++j) {
+					float a = v[j];
+					float b = v[j + width];
+					v[j] = a + b;
+					v[j + width] = a - b;
+				}
+			}
+		}
+	}
+}
+
+bool CVoicePitchShifter::Init(int sampleRate)
+{
+	if (sampleRate < 8000 || sampleRate > 96000)
+		return false;
+	//the power of two nearest to 20 ms, long enough to resolve the
+	//harmonics of a low voice.
+	int size = 1 << (int)floor(log2(sampleRate / 50.0) + 0.5);
+	if (!m_fft.Init(size))
+		return false;
+	m_sampleRate = sampleRate;
+	m_fftSize = size;
+	m_hop = size / kOverlap;
+	m_bins = size / 2 + 1;
+	m_envelopeRadius = (std::max)(1, (int)(kEnvelopeHz * size / sampleRate + 0.5f));
+	m_window.resize(size);
+	for (int i = 0; i < size; ++i)
+		m_window[i] = (float)(0.5 - 0.5 * cos(2 * kPi * i / size));
+	m_inFifo.resize(size);
+	m_outFifo.resize(m_hop);
+	m_accum.resize(size);
+	m_frame.resize(size);
+	for (auto* bins : { &m_re, &m_im, &m_magnitude, &m_frequency, &m_envelope, &m_smoothTemp,
+		&m_lastPhase, &m_sumPhase, &m_synMagnitude, &m_synFrequency })
+		bins->resize(m_bins);
+	SetUseAVX2(AgHasAVX2());
+	Reset();
+	return true;
+}
+
+void CVoicePitchShifter::Reset()
+{
+	std::fill(m_inFifo.begin(), m_inFifo.end(), 0.0f);
+	std::fill(m_outFifo.begin(), m_outFifo.end(), 0.0f);
+	std::fill(m_accum.begin(), m_accum.end(), 0.0f);
+	std::fill(m_lastPhase.begin(), m_lastPhase.end(), 0.0f);
+	std::fill(m_sumPhase.begin(), m_sumPhase.end(), 0.0f);
+	m_rover = m_fftSize - m_hop;
+}
+
+void CVoicePitchShifter::SetShift(float pitchSemitones, float formantSemitones)
+{
+	pitchSemitones = Clamp(pitchSemitones, -12, 12);
+	formantSemitones = Clamp(formantSemitones, -12, 12);
+	bool active = fabsf(pitchSemitones) > 0.01f || fabsf(formantSemitones) > 0.01f;
+	//a shifter coming back starts from silence, not from old audio.
+	if (active && !m_active)
+		Reset();
+	m_active = active;
+	m_pitchRatio = powf(2, pitchSemitones / 12);
+	m_formantRatio = powf(2, formantSemitones / 12);
+}
+
+void CVoicePitchShifter::SetUseAVX2(bool use)
+{
+	m_avx2 = use && AgHasAVX2();
+	m_multiply = m_avx2 ? MultiplyAVX2 : MultiplyC;
+	m_multiplyAdd = m_avx2 ? MultiplyAddAVX2 : MultiplyAddC;
+	m_dot = m_avx2 ? DotAVX2 : DotC;
+	m_magnitudeOf = m_avx2 ? MagnitudeAVX2 : MagnitudeC;
+}
+
+void CVoicePitchShifter::Process(float* samples, int n)
+{
+	if (!m_fftSize)
+		return;
+	//the fifo keeps the last fftSize - hop samples between frames.
+	int kept = m_fftSize - m_hop;
+	int done = 0;
+	while (done < n) {
+		int count = (std::min)(n - done, m_fftSize - m_rover);
+		memcpy(&m_inFifo[m_rover], samples + done, count * sizeof(float));
+		memcpy(samples + done, &m_outFifo[m_rover - kept], count * sizeof(float));
+		m_rover += count;
+		done += count;
+		if (m_rover >= m_fftSize) {
+			ProcessFrame();
+			m_rover = kept;
+		}
+	}
+}
+
+void CVoicePitchShifter::ProcessFrame()
+{
+	int size = m_fftSize;
+	int bins = m_bins;
+	m_multiply(m_frame.data(), m_inFifo.data(), m_window.data(), size);
+	float inEnergy = m_dot(m_frame.data(), m_frame.data(), size);
+	m_fft.Forward(m_frame.data(), m_re.data(), m_im.data());
+	m_magnitudeOf(m_magnitude.data(), m_re.data(), m_im.data(), bins);
+
+	//true frequency of each bin, in bins, from its phase advance over a hop.
+	float expected = kTwoPi / kOverlap;
+	for (int k = 0; k < bins; ++k) {
+		float phase = atan2f(m_im[k], m_re[k]);
+		float delta = phase - m_lastPhase[k] - k * expected;
+		m_lastPhase[k] = phase;
+		delta -= kTwoPi * floorf(delta / kTwoPi + 0.5f);
+		m_frequency[k] = k + delta * kOverlap / kTwoPi;
+	}
+
+	//the envelope through the harmonic peaks, then smoothed.
+	PeakHold(m_magnitude.data(), m_smoothTemp.data(), bins, m_envelopeRadius);
+	Smooth(m_smoothTemp.data(), m_envelope.data(), bins, m_envelopeRadius);
+	float envelopeFloor = 1e-6f;
+	for (int k = 0; k < bins; ++k)
+		envelopeFloor = (std::max)(envelopeFloor, m_envelope[k] * 1e-6f);
+
+	std::fill(m_synMagnitude.begin(), m_synMagnitude.end(), 0.0f);
+	std::fill(m_synFrequency.begin(), m_synFrequency.end(), 0.0f);
+	for (int k = 0; k < bins; ++k)
+		m_smoothTemp[k] = m_magnitude[k] / (std::max)(m_envelope[k], envelopeFloor);
+	//bins that land on the same one add up.
+	for (int k = 0; k < bins; ++k) {
+		int target = (int)(k * m_pitchRatio + 0.5f);
+		if (target >= bins)
+			break;
+		m_synMagnitude[target] += m_smoothTemp[k];
+		m_synFrequency[target] = m_frequency[k] * m_pitchRatio;
+	}
+	for (int k = 0; k < bins; ++k) {
+		//the envelope read at k / formant ratio puts the formants at
+		//their frequency times that ratio.
+		float position = k / m_formantRatio;
+		int index = (int)position;
+		float envelope = 0;
+		if (index < bins - 1)
+			envelope = m_envelope[index] + (m_envelope[index + 1] - m_envelope[index]) * (position - index);
+		float magnitude = m_synMagnitude[k] * envelope;
+		float phase = m_sumPhase[k] + m_synFrequency[k] * expected;
+		phase -= kTwoPi * floorf(phase / kTwoPi);
+		m_sumPhase[k] = phase;
+		m_re[k] = magnitude * cosf(phase);
+		m_im[k] = magnitude * sinf(phase);
+	}
+	m_fft.Inverse(m_re.data(), m_im.data(), m_frame.data());
+
+	//moved bins no longer overlap add back to the input level, more so the
+	//further up they go: each frame gets the windowed energy it came with.
+	m_multiply(m_frame.data(), m_frame.data(), m_window.data(), size);
+	float outEnergy = m_dot(m_frame.data(), m_frame.data(), size);
+	float gain = outEnergy > 1e-12f ? Clamp(sqrtf(inEnergy / outEnergy), 0.25f, 4.0f) : 1.0f;
+	//Hann analysis and synthesis windows at 4x overlap add up to 1.5.
+	m_multiplyAdd(m_accum.data(), m_frame.data(), gain / 1.5f, size);
+	memcpy(m_outFifo.data(), m_accum.data(), m_hop * sizeof(float));
+	memmove(m_accum.data(), m_accum.data() + m_hop, (size - m_hop) * sizeof(float));
+	std::fill(m_accum.end() - m_hop, m_accum.end(), 0.0f);
+	memmove(m_inFifo.data(), m_inFifo.data() + m_hop, (size - m_hop) * sizeof(float));
+}
+
+bool CVoiceEqualizer::Init(int sampleRate)
+{
+	if (sampleRate < 8000 || sampleRate > 96000)
+		return false;
+	m_sampleRate = sampleRate;
+	Reset();
+	return true;
+}
+
+void CVoiceEqualizer::Reset()
+{
+	for (auto& stage : m_stages)
+		stage.z1 = stage.z2 = 0;
+}
+
+void CVoiceEqualizer::SetGains(float lowDb, float midDb, float midHz, float highDb)
+{
+	if (!m_sampleRate)
+		return;
+	float gains[3] = { Clamp(lowDb, -24, 24), Clamp(midDb, -24, 24), Clamp(highDb, -24, 24) };
+	float nyquistSafe = 0.4f * m_sampleRate;
+	float frequencies[3] = { kLowShelfHz, Clamp(midHz, 100, nyquistSafe), (std::min)(kHighShelfHz, nyquistSafe) };
+	m_stageCount = 0;
+	//RBJ cookbook shelves with slope 1 and a peak of kMidQ.
+	for (int i = 0; i < 3; ++i) {
+		Biquad& stage = m_stages[i];
+		bool enabled = fabsf(gains[i]) > 0.05f;
+		if (enabled != stage.enabled)
+			stage.z1 = stage.z2 = 0;
+		stage.enabled = enabled;
+		if (!enabled)
+			continue;
+		++m_stageCount;
+		double a = pow(10.0, gains[i] / 40.0);
+		double w0 = 2 * kPi * frequencies[i] / m_sampleRate;
+		double cosw = cos(w0);
+		double b0, b1, b2, a0, a1, a2;
+		if (i == 1) {
+			double alpha = sin(w0) / (2 * kMidQ);
+			b0 = 1 + alpha * a;
+			b1 = -2 * cosw;
+			b2 = 1 - alpha * a;
+			a0 = 1 + alpha / a;
+			a1 = -2 * cosw;
+			a2 = 1 - alpha / a;
+		}
+		else {
+			double shelf = 2 * sqrt(a) * sin(w0) / 2 * sqrt(2.0);
+			double sign = i == 0 ? 1 : -1;
+			b0 = a * ((a + 1) - sign * (a - 1) * cosw + shelf);
+			b1 = sign * 2 * a * ((a - 1) - sign * (a + 1) * cosw);
+			b2 = a * ((a + 1) - sign * (a - 1) * cosw - shelf);
+			a0 = (a + 1) + sign * (a - 1) * cosw + shelf;
+			a1 = -sign * 2 * ((a - 1) + sign * (a + 1) * cosw);
+			a2 = (a + 1) + sign * (a - 1) * cosw - shelf;
+		}
+		stage.b0 = (float)(b0 / a0);
+		stage.b1 = (float)(b1 / a0);
+		stage.b2 = (float)(b2 / a0);
+		stage.a1 = (float)(a1 / a0);
+		stage.a2 = (float)(a2 / a0);
+	}
+}
+
+//transposed direct form II, a recursion per sample that stays scalar.
+void CVoiceEqualizer::Process(float* samples, int n)
+{
+	for (auto& stage : m_stages) {
+		if (!stage.enabled)
+			continue;
+		float z1 = stage.z1;
+		float z2 = stage.z2;
+		for (int i = 0; i < n; ++i) {
+			float x = samples[i];
+			float y = stage.b0 * x + z1;
+			z1 = stage.b1 * x - stage.a1 * y + z2;
+			z2 = stage.b2 * x - stage.a2 * y;
+			samples[i] = y;
+		}
+		stage.z1 = z1;
+		stage.z2 = z2;
+	}
+}
+
+bool CVoiceReverb::Init(int sampleRate)
+{
+	if (sampleRate < 8000 || sampleRate > 96000)
+		return false;
+	m_sampleRate = sampleRate;
+	//the longest lines room 1 can ask for.
+	for (int l = 0; l < LINES; ++l)
+		m_lines[l].assign((size_t)(kReverbLineMs[l] * 1.6f * sampleRate / 1000) + 64, 0.0f);
+	m_room = -1;
+	SetParameters(m_mix, 1.2f, 0.5f, 0.5f);
+	SetUseAVX2(AgHasAVX2());
+	return true;
+}
+
+void CVoiceReverb::Reset()
+{
+	for (int l = 0; l < LINES; ++l) {
+		std::fill(m_lines[l].begin(), m_lines[l].end(), 0.0f);
+		m_positions[l] = 0;
+		m_lowpass[l] = 0;
+	}
+}
+
+void CVoiceReverb::SetParameters(float mix, float time, float room, float damping)
+{
+	if (!m_sampleRate)
+		return;
+	m_mix = Clamp(mix, 0, 1);
+	time = Clamp(time, 0.1f, 10);
+	room = Clamp(room, 0, 1);
+	if (room != m_room) {
+		//new lengths, the old tail would not fit them.
+		m_room = room;
+		float scale = 0.4f + 1.2f * room;
+		for (int l = 0; l < LINES; ++l) {
+			int length = (std::max)(2, (int)(kReverbLineMs[l] * scale * m_sampleRate / 1000));
+			while (!IsPrime(length))
+				++length;
+			m_lengths[l] = (std::min)(length, (int)m_lines[l].size());
+		}
+		Reset();
+	}
+	//each trip through a line loses 60 dB * length / (time * rate).
+	for (int l = 0; l < LINES; ++l)
+		m_gains[l] = (float)pow(10.0, -3.0 * m_lengths[l] / (time * m_sampleRate)) / sqrtf((float)LINES);
+	m_damping = 0.7f * Clamp(damping, 0, 1);
+}
+
+void CVoiceReverb::SetUseAVX2(bool use)
+{
+	m_avx2 = use && AgHasAVX2();
+}
+
+void CVoiceReverb::Process(float* samples, int n)
+{
+	if (m_avx2)
+		ProcessAVX2(samples, n);
+	else
+		ProcessC(samples, n);
+}
+
+void CVoiceReverb::ProcessC(float* samples, int n)
+{
+	float dry = 1 - 0.5f * m_mix;
+	float wetGain = m_mix * kReverbOutputGain;
+	float pass = 1 - m_damping;
+	float lines[LINES];
+	for (int i = 0; i < n; ++i) {
+		float x = samples[i];
+		float wet = 0;
+		for (int l = 0; l < LINES; ++l) {
+			m_lowpass[l] += (m_lines[l][m_positions[l]] - m_lowpass[l]) * pass;
+			wet += m_lowpass[l] * kReverbOutputSigns[l];
+			lines[l] = m_lowpass[l];
+		}
+		Hadamard8C(lines);
+		for (int l = 0; l < LINES; ++l) {
+			m_lines[l][m_positions[l]] = lines[l] * m_gains[l] + x * kReverbInputGain;
+			if (++m_positions[l] == m_lengths[l])
+				m_positions[l] = 0;
+		}
+		samples[i] = x * dry + wet * wetGain;
+	}
+}
+
+AG_TARGET_AVX2 void CVoiceReverb::ProcessAVX2(float* samples, int n)
+{
+	float dry = 1 - 0.5f * m_mix;
+	float wetGain = m_mix * kReverbOutputGain;
+	__m256 pass = _mm256_set1_ps(1 - m_damping);
+	__m256 gains = _mm256_loadu_ps(m_gains);
+	__m256 outputSigns = _mm256_loadu_ps(kReverbOutputSigns);
+	__m256 lowpass = _mm256_loadu_ps(m_lowpass);
+	float* lines[LINES];
+	for (int l = 0; l < LINES; ++l)
+		lines[l] = m_lines[l].data();
+	alignas(32) float taps[LINES];
+	for (int i = 0; i < n; ++i) {
+		float x = samples[i];
+		//the eight reads and writes are scattered, the math between is not.
+		for (int l = 0; l < LINES; ++l)
+			taps[l] = lines[l][m_positions[l]];
+		lowpass = _mm256_fmadd_ps(_mm256_sub_ps(_mm256_load_ps(taps), lowpass), pass, lowpass);
+		__m256 out = _mm256_mul_ps(lowpass, outputSigns);
+		__m128 half = _mm_add_ps(_mm256_castps256_ps128(out), _mm256_extractf128_ps(out, 1));
+		half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+		half = _mm_add_ss(half, _mm_movehdup_ps(half));
+		float wet = _mm_cvtss_f32(half);
+		__m256 feedback = _mm256_fmadd_ps(Hadamard8(lowpass), gains, _mm256_set1_ps(x * kReverbInputGain));
+		_mm256_store_ps(taps, feedback);
+		for (int l = 0; l < LINES; ++l) {
+			lines[l][m_positions[l]] = taps[l];
+			if (++m_positions[l] == m_lengths[l])
+				m_positions[l] = 0;
+		}
+		samples[i] = x * dry + wet * wetGain;
+	}
+	_mm256_storeu_ps(m_lowpass, lowpass);
+}
+
+CVoiceChanger::CVoiceChanger()
+{
+	m_useAVX2.store(AgHasAVX2(), std::memory_order_relaxed);
+}
+
+void CVoiceChanger::SetOptions(const VoiceChangerOptions& options)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_options = options;
+	m_optionBuffers[m_optionsBack] = options;
+	//release publishes the buffer, acquire takes back the one Process let go.
+	m_optionsBack = m_optionsMiddle.exchange(m_optionsBack | OPTIONS_FRESH, std::memory_order_acq_rel) & OPTIONS_INDEX;
+}
+
+VoiceChangerOptions CVoiceChanger::GetOptions() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_options;
+}
+
+void CVoiceChanger::SetUseAVX2(bool use)
+{
+	m_useAVX2.store(use && AgHasAVX2(), std::memory_order_relaxed);
+}
+
+int CVoiceChanger::GetLatencySamples() const
+{
+	return m_latencySamples.load(std::memory_order_relaxed);
+}
+
+VoiceChangerStats CVoiceChanger::GetStats() const
+{
+	VoiceChangerStats stats;
+	stats.frames = m_frames.load(std::memory_order_relaxed);
+	stats.samples = m_samples.load(std::memory_order_relaxed);
+	stats.nsTotal = m_nsTotal.load(std::memory_order_relaxed);
+	stats.nsMax = m_nsMax.load(std::memory_order_relaxed);
+	stats.sampleRate = m_statsSampleRate.load(std::memory_order_relaxed);
+	stats.latencySamples = m_latencySamples.load(std::memory_order_relaxed);
+	stats.avx2 = m_statsAVX2.load(std::memory_order_relaxed);
+	return stats;
+}
+
+void CVoiceChanger::ResetStats()
+{
+	m_frames.store(0, std::memory_order_relaxed);
+	m_samples.store(0, std::memory_order_relaxed);
+	m_nsTotal.store(0, std::memory_order_relaxed);
+	m_nsMax.store(0, std::memory_order_relaxed);
+}
+
+bool CVoiceChanger::Process(int16_t* pcm, int samples, int channels, int sampleRate)
+{
+	if (!pcm || samples <= 0 || channels <= 0 || sampleRate < 8000 || sampleRate > 96000)
+		return false;
+	AG_TRACE_SCOPE2("filter", "CVoiceChanger::Process", "samples", samples, "channels", channels);
+	int64_t begin = NowNs();
+	bool changed = false;
+	if (m_optionsMiddle.load(std::memory_order_relaxed) & OPTIONS_FRESH) {
+		m_optionsFront = m_optionsMiddle.exchange(m_optionsFront, std::memory_order_acq_rel) & OPTIONS_INDEX;
+		changed = true;
+	}
+	const VoiceChangerOptions& options = m_optionBuffers[m_optionsFront];
+	bool useAVX2 = m_useAVX2.load(std::memory_order_relaxed);
+	if (sampleRate != m_sampleRate) {
+		if (!m_pitch.Init(sampleRate) || !m_equalizer.Init(sampleRate) || !m_reverb.Init(sampleRate))
+			return false;
+		m_sampleRate = sampleRate;
+		changed = true;
+	}
+	if (changed) {
+		m_pitch.SetShift(options.pitchSemitones, options.formantSemitones);
+		m_equalizer.SetGains(options.eqLowDb, options.eqMidDb, options.eqMidHz, options.eqHighDb);
+		m_reverb.SetParameters(options.reverbMix, options.reverbTime, options.reverbRoom, options.reverbDamping);
+	}
+	m_pitch.SetUseAVX2(useAVX2);
+	m_reverb.SetUseAVX2(useAVX2);
+
+	bool active = m_pitch.IsActive() || m_equalizer.IsActive() || m_reverb.IsActive();
+	if (active) {
+		m_mono.resize(samples);
+		float scale = 1.0f / (32768.0f * channels);
+		for (int i = 0; i < samples; ++i) {
+			int sum = 0;
+			for (int c = 0; c < channels; ++c)
+				sum += pcm[i * channels + c];
+			m_mono[i] = sum * scale;
+		}
+		if (m_pitch.IsActive())
+			m_pitch.Process(m_mono.data(), samples);
+		if (m_equalizer.IsActive())
+			m_equalizer.Process(m_mono.data(), samples);
+		if (m_reverb.IsActive())
+			m_reverb.Process(m_mono.data(), samples);
+		for (int i = 0; i < samples; ++i) {
+			float value = Clamp(m_mono[i] * 32768.0f, -32768.0f, 32767.0f);
+			int16_t sample = (int16_t)lrintf(value);
+			for (int c = 0; c < channels; ++c)
+				pcm[i * channels + c] = sample;
+		}
+	}
+
+	int64_t elapsed = NowNs() - begin;
+	//fetch_add so a ResetStats in between is not undone.
+	m_frames.fetch_add(1, std::memory_order_relaxed);
+	m_samples.fetch_add(samples, std::memory_order_relaxed);
+	m_nsTotal.fetch_add(elapsed, std::memory_order_relaxed);
+	if (elapsed > m_nsMax.load(std::memory_order_relaxed))
+		m_nsMax.store(elapsed, std::memory_order_relaxed);
+	m_statsSampleRate.store(sampleRate, std::memory_order_relaxed);
+	m_latencySamples.store(m_pitch.IsActive() ? m_pitch.GetLatencySamples() : 0, std::memory_order_relaxed);
+	m_statsAVX2.store(useAVX2, std::memory_order_relaxed);
+	return true;
+}
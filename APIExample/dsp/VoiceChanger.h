@@ -0,0 +1,237 @@
+#pragma once
+#include "RealFft.h"
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+//all levels 0 turn their node off, a chain with every node off is a copy.
+struct VoiceChangerOptions {
+	//-12 to 12.
+	float pitchSemitones = 0;
+	//-12 to 12, where the formants go. 0 keeps them so the voice stays the
+	//same person, equal to pitchSemitones moves them with the pitch like a
+	//tape played faster or slower.
+	float formantSemitones = 0;
+	//low shelf at 200 Hz, peak at eqMidHz, high shelf at 4 kHz, -24 to 24 dB.
+	float eqLowDb = 0;
+	float eqMidDb = 0;
+	float eqMidHz = 1500;
+	float eqHighDb = 0;
+	//0 dry to 1 mostly wet.
+	float reverbMix = 0;
+	//seconds for the tail to fall by 60 dB.
+	float reverbTime = 1.2f;
+	//0 a small room to 1 a hall, scales the delay lines.
+	float reverbRoom = 0.5f;
+	//0 bright to 1 dark, how fast the tail loses its highs.
+	float reverbDamping = 0.5f;
+};
+
+struct VoiceChangerStats {
+	uint64_t frames = 0;
+	uint64_t samples = 0;
+	int64_t nsTotal = 0;
+	int64_t nsMax = 0;
+	int sampleRate = 0;
+	int latencySamples = 0;
+	bool avx2 = false;
+
+	double GetMsAverage() const { return frames ? nsTotal / 1e6 / frames : 0; }
+	//processing time against the audio it processed, 1% = 100x real time.
+	double GetLoadPercent() const { return samples && sampleRate ? nsTotal / 1e7 * sampleRate / samples : 0; }
+};
+
+/*
+	Pitch shifting by phase vocoder with a fixed delay of GetLatencySamples,
+	one FFT frame of about 20 ms. Each hop of a quarter frame is
+	windowed and analysed into bins of magnitude and true frequency; the
+	bins are moved to frequency * pitch ratio and resynthesised with
+	accumulated phases.
+	Formants: the spectral envelope, a smoothed line through the harmonic
+	peaks, is divided out before the move and put back stretched by
+	the formant ratio, so the harmonics move while the vowel colour stays
+	or moves on its own.
+*/
+class CVoicePitchShifter
+{
+public:
+	bool Init(int sampleRate);
+	void Reset();
+	void SetShift(float pitchSemitones, float formantSemitones);
+	//false when both shifts are 0 and Process would only delay.
+	bool IsActive() const { return m_active; }
+	int GetLatencySamples() const { return m_fftSize; }
+	void SetUseAVX2(bool use);
+
+	//mono, in place.
+	void Process(float* samples, int n);
+
+private:
+	void ProcessFrame();
+
+	int m_sampleRate = 0;
+	int m_fftSize = 0;
+	int m_hop = 0;
+	int m_bins = 0;
+	bool m_active = false;
+	float m_pitchRatio = 1;
+	float m_formantRatio = 1;
+	//envelope smoothing, half width in bins.
+	int m_envelopeRadius = 1;
+	CRealFft m_fft;
+	std::vector<float> m_window;
+	std::vector<float> m_inFifo;
+	std::vector<float> m_outFifo;
+	std::vector<float> m_accum;
+	//where the next input sample goes in m_inFifo, from fftSize - hop to fftSize.
+	int m_rover = 0;
+	std::vector<float> m_frame;
+	std::vector<float> m_re;
+	std::vector<float> m_im;
+	std::vector<float> m_magnitude;
+	std::vector<float> m_frequency;
+	std::vector<float> m_envelope;
+	std::vector<float> m_smoothTemp;
+	std::vector<float> m_lastPhase;
+	std::vector<float> m_sumPhase;
+	std::vector<float> m_synMagnitude;
+	std::vector<float> m_synFrequency;
+	void(*m_multiply)(float* dst, const float* a, const float* b, int n) = nullptr;
+	void(*m_multiplyAdd)(float* acc, const float* a, float scale, int n) = nullptr;
+	float(*m_dot)(const float* a, const float* b, int n) = nullptr;
+	void(*m_magnitudeOf)(float* magnitude, const float* re, const float* im, int n) = nullptr;
+	bool m_avx2 = false;
+};
+
+//low shelf, peak and high shelf biquads in series, no delay.
+class CVoiceEqualizer
+{
+public:
+	bool Init(int sampleRate);
+	void Reset();
+	void SetGains(float lowDb, float midDb, float midHz, float highDb);
+	bool IsActive() const { return m_stageCount > 0; }
+
+	void Process(float* samples, int n);
+
+private:
+	struct Biquad {
+		bool enabled = false;
+		float b0 = 1;
+		float b1 = 0;
+		float b2 = 0;
+		float a1 = 0;
+		float a2 = 0;
+		float z1 = 0;
+		float z2 = 0;
+	};
+
+	int m_sampleRate = 0;
+	//low shelf, peak, high shelf.
+	Biquad m_stages[3];
+	int m_stageCount = 0;
+};
+
+/*
+	Feedback delay network reverb: eight delay lines of mutually prime
+	lengths fed back through an 8x8 Hadamard matrix, each with a one pole
+	low pass for damping and a gain that sets the decay time. Eight lines
+	are one AVX register, the per sample matrix is three add/subtract
+	butterflies. No delay on the dry signal.
+*/
+class CVoiceReverb
+{
+public:
+	enum {
+		LINES = 8,
+	};
+
+	bool Init(int sampleRate);
+	void Reset();
+	void SetParameters(float mix, float time, float room, float damping);
+	bool IsActive() const { return m_mix > 0; }
+	void SetUseAVX2(bool use);
+
+	void Process(float* samples, int n);
+
+private:
+	void ProcessC(float* samples, int n);
+	void ProcessAVX2(float* samples, int n);
+
+	int m_sampleRate = 0;
+	float m_mix = 0;
+	float m_room = -1;
+	std::vector<float> m_lines[LINES];
+	int m_lengths[LINES] = { 0 };
+	int m_positions[LINES] = { 0 };
+	float m_gains[LINES] = { 0 };
+	float m_lowpass[LINES] = { 0 };
+	//one pole coefficient, 0 passes everything.
+	float m_damping = 0;
+	bool m_avx2 = false;
+};
+
+/*
+	Voice changer for a record audio frame observer: pitch shifter,
+	equalizer and reverb in series on PCM16 frames of any size, processed
+	in place. Nodes whose options are neutral are skipped; the delay of the
+	chain is that of the pitch shifter while it runs and 0 otherwise.
+	Options may be set from any thread and take effect with the next frame.
+	Process never locks: options are handed over through three buffers and
+	an atomic index, the stats are relaxed atomics.
+*/
+class CVoiceChanger
+{
+public:
+	CVoiceChanger();
+
+	void SetOptions(const VoiceChangerOptions& options);
+	VoiceChangerOptions GetOptions() const;
+	//for comparisons, ignored without AVX2 on the machine.
+	void SetUseAVX2(bool use);
+
+	//interleaved PCM16, channels are mixed to mono, processed and written
+	//back to every channel. A new sample rate starts the nodes over.
+	bool Process(int16_t* pcm, int samples, int channels, int sampleRate);
+	int GetLatencySamples() const;
+
+	//each field is current, together they may be a frame apart.
+	VoiceChangerStats GetStats() const;
+	void ResetStats();
+
+private:
+	enum {
+		OPTIONS_INDEX = 3,
+		//the middle buffer holds options Process has not taken yet.
+		OPTIONS_FRESH = 4,
+	};
+
+	//control side, Process never takes it.
+	mutable std::mutex m_mutex;
+	VoiceChangerOptions m_options;
+	//SetOptions writes m_optionBuffers[m_optionsBack] and swaps it into
+	//the middle, Process swaps the middle with m_optionsFront when it is
+	//fresh. no buffer is ever read and written at once.
+	VoiceChangerOptions m_optionBuffers[3];
+	int m_optionsBack = 0;
+	std::atomic<int> m_optionsMiddle{ 1 };
+	std::atomic<bool> m_useAVX2{ false };
+
+	//written by Process only.
+	std::atomic<uint64_t> m_frames{ 0 };
+	std::atomic<uint64_t> m_samples{ 0 };
+	std::atomic<int64_t> m_nsTotal{ 0 };
+	std::atomic<int64_t> m_nsMax{ 0 };
+	std::atomic<int> m_statsSampleRate{ 0 };
+	std::atomic<int> m_latencySamples{ 0 };
+	std::atomic<bool> m_statsAVX2{ false };
+
+	//audio thread.
+	int m_optionsFront = 2;
+	int m_sampleRate = 0;
+	CVoicePitchShifter m_pitch;
+	CVoiceEqualizer m_equalizer;
+	CVoiceReverb m_reverb;
+	std::vector<float> m_mono;
+};
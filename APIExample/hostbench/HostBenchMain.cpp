@@ -0,0 +1,108 @@
+#include "capture/EncoderAdvisor.h"
+#include "capture/HostBenchmark.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+//no stdafx.h, the runner is built without MFC, see CMakeLists.txt.
+
+/*
+	Headless runner of the host benchmark and the encoder advice:
+
+	apiexample_hostbench [--profile PATH] [--size WxH] [--fps N]
+		[--min-fps N] [--cpu PERCENT] [--filters N]
+		[--camera FOURCC:WxH@FPS]...
+
+	Runs RunHostBenchmark, or loads the profile cached in --profile and
+	writes it there after a fresh run, prints what it measured and the
+	encoder configuration CEncoderAdvisor picks for the request with the
+	cameras given, native NV12 at the encoder size when none are.
+*/
+namespace {
+	struct Options {
+		std::string profilePath;
+		EncoderAdviceRequest request;
+		std::vector<CaptureFormat> formats;
+	};
+
+	void PrintUsage()
+	{
+		fprintf(stderr,
+			"usage: apiexample_hostbench [--profile PATH] [--size WxH] [--fps N]\n"
+			"    [--min-fps N] [--cpu PERCENT] [--filters N]\n"
+			"    [--camera FOURCC:WxH@FPS]...\n");
+	}
+
+	bool ParseCamera(const char* value, CaptureFormat& format)
+	{
+		char name[5] = { 0 };
+		if (sscanf(value, "%4[^:]:%dx%d@%d", name, &format.width, &format.height, &format.fps) != 4 || strlen(name) != 4)
+			return false;
+		format.fourcc = CAPTURE_FOURCC(name[0], name[1], name[2], name[3]);
+		return format.width > 0 && format.height > 0 && format.fps > 0;
+	}
+
+	bool ParseOptions(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; ++i) {
+			const char* arg = argv[i];
+			const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+			if (!value)
+				return false;
+			++i;
+			if (!strcmp(arg, "--profile"))
+				options.profilePath = value;
+			else if (!strcmp(arg, "--size")) {
+				if (sscanf(value, "%dx%d", &options.request.maxWidth, &options.request.maxHeight) != 2)
+					return false;
+			}
+			else if (!strcmp(arg, "--fps"))
+				options.request.maxFps = atoi(value);
+			else if (!strcmp(arg, "--min-fps"))
+				options.request.minFps = atoi(value);
+			else if (!strcmp(arg, "--cpu"))
+				options.request.cpuBudgetPercent = atof(value);
+			else if (!strcmp(arg, "--filters"))
+				options.request.filterPasses = atoi(value);
+			else if (!strcmp(arg, "--camera")) {
+				CaptureFormat format;
+				if (!ParseCamera(value, format))
+					return false;
+				options.formats.push_back(format);
+			}
+			else
+				return false;
+		}
+		return options.request.maxWidth > 0 && options.request.maxHeight > 0
+			&& options.request.maxFps > 0 && options.request.cpuBudgetPercent > 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options)) {
+		PrintUsage();
+		return 2;
+	}
+	bool cached = false;
+	HostProfile profile = options.profilePath.empty()
+		? RunHostBenchmark() : GetHostProfile(options.profilePath, &cached);
+	printf("%s\n", profile.machine.c_str());
+	printf("%s\n", DescribeHostProfile(profile).c_str());
+	if (cached)
+		printf("cached in %s\n", options.profilePath.c_str());
+	else
+		printf("measured in %lld ms\n", (long long)profile.benchmarkMs);
+	if (!profile.IsValid()) {
+		fprintf(stderr, "the benchmark measured nothing\n");
+		return 1;
+	}
+
+	CEncoderAdvisor advisor(profile);
+	for (const CaptureFormat& format : options.formats)
+		printf("camera %s\n", DescribeCaptureFormat(format).c_str());
+	EncoderAdvice advice = advisor.Advise(options.formats, options.request);
+	printf("advised: %s\n", CEncoderAdvisor::DescribeAdvice(advice).c_str());
+	return advice.valid ? 0 : 1;
+}
@@ -0,0 +1,204 @@
+#include "LoadGenerator.h"
+#include "StubMediaEngine.h"
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+//no stdafx.h, the runner is built without MFC, see CMakeLists.txt.
+
+/*
+	Headless runner of CLoadGenerator against the stub engine:
+
+	apiexample_loadgen [--video N] [--audio N] [--size WxH] [--fps N]
+		[--pattern bars|gradient|noise] [--path push|consume]
+		[--rate HZ] [--channels N] [--signal tone|noise]
+		[--limit VIDEO_FPS,AUDIO_FPS] [--seconds N] [--ramp] [--check]
+
+	Runs the sources for --seconds and prints a row per source every
+	second and at the end. --ramp adds one more video source per run until
+	one falls behind and reports how many kept up. --check exits with 1
+	when a source fell behind, for scripts.
+*/
+namespace {
+	struct Options {
+		int videoSources = 1;
+		int audioSources = 1;
+		LoadVideoConfig video;
+		LoadAudioConfig audio;
+		int videoLimit = 0;
+		int audioLimit = 0;
+		int seconds = 10;
+		bool ramp = false;
+		bool check = false;
+	};
+
+	//a source keeps up if it reaches 95% of its rate without dropping.
+	const double KEEP_UP_RATIO = 0.95;
+
+	void PrintUsage()
+	{
+		fprintf(stderr,
+			"usage: apiexample_loadgen [--video N] [--audio N] [--size WxH] [--fps N]\n"
+			"    [--pattern bars|gradient|noise] [--path push|consume]\n"
+			"    [--rate HZ] [--channels N] [--signal tone|noise]\n"
+			"    [--limit VIDEO_FPS,AUDIO_FPS] [--seconds N] [--ramp] [--check]\n");
+	}
+
+	bool ParseOptions(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; ++i) {
+			const char* arg = argv[i];
+			const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+			if (!strcmp(arg, "--ramp")) {
+				options.ramp = true;
+				continue;
+			}
+			if (!strcmp(arg, "--check")) {
+				options.check = true;
+				continue;
+			}
+			if (!value)
+				return false;
+			++i;
+			if (!strcmp(arg, "--video"))
+				options.videoSources = atoi(value);
+			else if (!strcmp(arg, "--audio"))
+				options.audioSources = atoi(value);
+			else if (!strcmp(arg, "--size")) {
+				if (sscanf(value, "%dx%d", &options.video.width, &options.video.height) != 2)
+					return false;
+			}
+			else if (!strcmp(arg, "--fps"))
+				options.video.fps = atoi(value);
+			else if (!strcmp(arg, "--pattern")) {
+				if (!strcmp(value, "bars"))
+					options.video.pattern = LOAD_PATTERN_BARS;
+				else if (!strcmp(value, "gradient"))
+					options.video.pattern = LOAD_PATTERN_GRADIENT;
+				else if (!strcmp(value, "noise"))
+					options.video.pattern = LOAD_PATTERN_NOISE;
+				else
+					return false;
+			}
+			else if (!strcmp(arg, "--path")) {
+				if (!strcmp(value, "push"))
+					options.video.path = LOAD_PUSH_VIDEO_FRAME;
+				else if (!strcmp(value, "consume"))
+					options.video.path = LOAD_CONSUME_RAW_FRAME;
+				else
+					return false;
+			}
+			else if (!strcmp(arg, "--rate"))
+				options.audio.sampleRate = atoi(value);
+			else if (!strcmp(arg, "--channels"))
+				options.audio.channels = atoi(value);
+			else if (!strcmp(arg, "--signal")) {
+				if (!strcmp(value, "tone"))
+					options.audio.signal = LOAD_AUDIO_TONE;
+				else if (!strcmp(value, "noise"))
+					options.audio.signal = LOAD_AUDIO_NOISE;
+				else
+					return false;
+			}
+			else if (!strcmp(arg, "--limit")) {
+				if (sscanf(value, "%d,%d", &options.videoLimit, &options.audioLimit) != 2)
+					return false;
+			}
+			else if (!strcmp(arg, "--seconds"))
+				options.seconds = atoi(value);
+			else
+				return false;
+		}
+		return options.videoSources >= 0 && options.audioSources >= 0
+			&& options.videoSources + options.audioSources > 0 && options.seconds > 0;
+	}
+
+	void PrintStats(const std::vector<LoadSourceStats>& stats, int second)
+	{
+		printf("--- %d s\n", second);
+		printf("%-28s %8s %8s %9s %8s %8s %7s %9s\n",
+			"source", "target", "rate", "frames", "dropped", "rejected", "cpu %", "us/frame");
+		for (const LoadSourceStats& row : stats) {
+			printf("%-28s %8.1f %8.1f %9llu %8llu %8llu %7.1f %9.1f\n",
+				row.name.c_str(), row.targetRate, row.achievedRate, (unsigned long long)row.frames,
+				(unsigned long long)row.dropped, (unsigned long long)row.rejected, row.cpuPercent, row.cpuUsPerFrame);
+		}
+		fflush(stdout);
+	}
+
+	bool KeptUp(const std::vector<LoadSourceStats>& stats)
+	{
+		for (const LoadSourceStats& row : stats) {
+			if (row.dropped || row.achievedRate < row.targetRate * KEEP_UP_RATIO)
+				return false;
+		}
+		return true;
+	}
+
+	//one run of the given sources, false if one fell behind.
+	bool Run(const Options& options, int videoSources, bool printEverySecond)
+	{
+		CStubMediaEngine engine;
+		engine.SetRateLimit(options.videoLimit, options.audioLimit);
+		CStubVideoFrameConsumer consumer;
+		CLoadGenerator generator;
+		generator.SetSinks(&engine, &consumer);
+		for (int i = 0; i < videoSources; ++i) {
+			if (!generator.AddVideoSource(options.video)) {
+				fprintf(stderr, "invalid video source %dx%d@%d\n", options.video.width, options.video.height, options.video.fps);
+				return false;
+			}
+		}
+		for (int i = 0; i < options.audioSources; ++i) {
+			LoadAudioConfig audio = options.audio;
+			audio.sourcePos = i;
+			if (!generator.AddAudioSource(audio)) {
+				fprintf(stderr, "invalid audio source %d Hz, %d channels\n", audio.sampleRate, audio.channels);
+				return false;
+			}
+		}
+		if (!generator.Start())
+			return false;
+		std::vector<LoadSourceStats> stats;
+		std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+		for (int second = 1; second <= options.seconds; ++second) {
+			next += std::chrono::seconds(1);
+			std::this_thread::sleep_until(next);
+			if (printEverySecond && second < options.seconds) {
+				generator.GetStats(stats);
+				PrintStats(stats, second);
+			}
+		}
+		generator.Stop();
+		generator.GetStats(stats);
+		PrintStats(stats, options.seconds);
+		printf("stub engine: %llu video, %llu audio frames, %llu rejected, %.1f MB; consumer: %llu frames\n",
+			(unsigned long long)engine.GetVideoFrames(), (unsigned long long)engine.GetAudioFrames(),
+			(unsigned long long)engine.GetRejected(), engine.GetBytes() / 1e6, (unsigned long long)consumer.GetFrames());
+		bool keptUp = KeptUp(stats);
+		printf("%d video, %d audio sources %s\n", videoSources, options.audioSources, keptUp ? "kept up" : "fell behind");
+		return keptUp;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options)) {
+		PrintUsage();
+		return 2;
+	}
+	if (!options.ramp)
+		return Run(options, options.videoSources, true) || !options.check ? 0 : 1;
+
+	//one more video source per run until one falls behind.
+	int keptUp = 0;
+	for (int videoSources = 1; videoSources <= 256; ++videoSources) {
+		if (!Run(options, videoSources, false))
+			break;
+		keptUp = videoSources;
+	}
+	printf("%d video sources of %dx%d@%d kept up\n", keptUp, options.video.width, options.video.height, options.video.fps);
+	return keptUp > 0 || !options.check ? 0 : 1;
+}
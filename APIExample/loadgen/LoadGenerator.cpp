@@ -0,0 +1,340 @@
+#include "LoadGenerator.h"
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+using namespace agora::media;
+using namespace std::chrono;
+
+namespace {
+	const double PI = 3.14159265358979323846;
+	//quarter of full scale, loud enough to be heard without clipping when mixed.
+	const double AUDIO_AMPLITUDE = 8192.0;
+
+	//CPU time of the calling thread in ns.
+	int64_t ThreadCpuNs()
+	{
+#ifdef _WIN32
+		FILETIME creation, exit, kernel, user;
+		if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+			return 0;
+		ULARGE_INTEGER k, u;
+		k.LowPart = kernel.dwLowDateTime;
+		k.HighPart = kernel.dwHighDateTime;
+		u.LowPart = user.dwLowDateTime;
+		u.HighPart = user.dwHighDateTime;
+		return (int64_t)(k.QuadPart + u.QuadPart) * 100;
+#else
+		timespec ts;
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+		return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+	}
+
+	inline uint32_t XorShift(uint32_t& state)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+
+	//SMPTE style bars: white, yellow, cyan, green, magenta, red, blue, black.
+	const uint8_t BAR_Y[8] = { 235, 210, 170, 145, 106, 81, 41, 16 };
+	const uint8_t BAR_U[8] = { 128, 16, 166, 54, 202, 90, 240, 128 };
+	const uint8_t BAR_V[8] = { 128, 146, 16, 34, 222, 240, 110, 128 };
+}
+
+struct CLoadGenerator::Source {
+	bool video = false;
+	LoadVideoConfig videoConfig;
+	LoadAudioConfig audioConfig;
+	std::string name;
+	int fps = 0;
+	std::thread thread;
+
+	std::vector<uint8_t> buffer;
+	ExternalVideoFrame videoFrame;
+	IAudioFrameObserver::AudioFrame audioFrame;
+	double phase = 0.0;
+	uint32_t noise = 0x9E3779B9;
+
+	std::atomic<uint64_t> frames;
+	std::atomic<uint64_t> dropped;
+	std::atomic<uint64_t> rejected;
+	std::atomic<int64_t> cpuNs;
+	//steady_clock ns of the start and stop of the run, stop is 0 while running.
+	std::atomic<int64_t> startNs;
+	std::atomic<int64_t> stopNs;
+
+	Source() : frames(0), dropped(0), rejected(0), cpuNs(0), startNs(0), stopNs(0) {}
+};
+
+CLoadGenerator::CLoadGenerator()
+	: m_running(false)
+{
+}
+
+CLoadGenerator::~CLoadGenerator()
+{
+	Stop();
+}
+
+void CLoadGenerator::SetSinks(IMediaEngine* mediaEngine, agora::rtc::IVideoFrameConsumer* consumer)
+{
+	m_mediaEngine = mediaEngine;
+	m_consumer = consumer;
+}
+
+bool CLoadGenerator::AddVideoSource(const LoadVideoConfig& config)
+{
+	//I420 needs even sizes.
+	if (m_running || config.width <= 0 || config.height <= 0 || (config.width & 1) || (config.height & 1)
+		|| config.fps <= 0 || config.fps > 120)
+		return false;
+	std::unique_ptr<Source> source(new Source);
+	source->video = true;
+	source->videoConfig = config;
+	source->fps = config.fps;
+	char name[64];
+	snprintf(name, sizeof(name), "video%d %dx%d@%d", (int)m_sources.size(), config.width, config.height, config.fps);
+	source->name = name;
+
+	size_t size = (size_t)config.width * config.height * 3 / 2;
+	source->buffer.assign(size, 128);
+	ExternalVideoFrame& frame = source->videoFrame;
+	frame.type = ExternalVideoFrame::VIDEO_BUFFER_RAW_DATA;
+	frame.format = ExternalVideoFrame::VIDEO_PIXEL_I420;
+	frame.buffer = source->buffer.data();
+	frame.stride = config.width;
+	frame.height = config.height;
+	frame.cropLeft = frame.cropTop = frame.cropRight = frame.cropBottom = 0;
+	frame.rotation = 0;
+	frame.timestamp = 0;
+	source->noise ^= (uint32_t)m_sources.size() * 0x85EBCA6B;
+	m_sources.push_back(std::move(source));
+	return true;
+}
+
+bool CLoadGenerator::AddAudioSource(const LoadAudioConfig& config)
+{
+	if (m_running || config.sampleRate < 8000 || config.sampleRate > 96000 || config.sampleRate % 100
+		|| config.channels < 1 || config.channels > 2)
+		return false;
+	std::unique_ptr<Source> source(new Source);
+	source->video = false;
+	source->audioConfig = config;
+	source->fps = 1000 / AUDIO_FRAME_MS;
+	char name[64];
+	snprintf(name, sizeof(name), "audio%d %dHz/%dch %s", (int)m_sources.size(), config.sampleRate, config.channels,
+		config.signal == LOAD_AUDIO_TONE ? "tone" : "noise");
+	source->name = name;
+
+	int samples = config.sampleRate * AUDIO_FRAME_MS / 1000;
+	source->buffer.assign((size_t)samples * config.channels * sizeof(int16_t), 0);
+	IAudioFrameObserver::AudioFrame& frame = source->audioFrame;
+	frame.type = IAudioFrameObserver::FRAME_TYPE_PCM16;
+	frame.samples = samples;
+	frame.bytesPerSample = sizeof(int16_t);
+	frame.channels = config.channels;
+	frame.samplesPerSec = config.sampleRate;
+	frame.buffer = source->buffer.data();
+	frame.renderTimeMs = 0;
+	frame.avsync_type = 0;
+	source->noise ^= (uint32_t)m_sources.size() * 0xC2B2AE35;
+	m_sources.push_back(std::move(source));
+	return true;
+}
+
+void CLoadGenerator::ClearSources()
+{
+	if (!m_running)
+		m_sources.clear();
+}
+
+bool CLoadGenerator::Start()
+{
+	if (m_running || m_sources.empty())
+		return false;
+	//every source needs the sink of its path.
+	for (auto& source : m_sources) {
+		bool consumer = source->video && source->videoConfig.path == LOAD_CONSUME_RAW_FRAME;
+		if (consumer ? !m_consumer : !m_mediaEngine)
+			return false;
+	}
+	m_running = true;
+	for (auto& source : m_sources) {
+		source->frames = 0;
+		source->dropped = 0;
+		source->rejected = 0;
+		source->cpuNs = 0;
+		source->startNs = duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+		source->stopNs = 0;
+		source->thread = std::thread(RunSource, this, source.get());
+	}
+	return true;
+}
+
+void CLoadGenerator::Stop()
+{
+	if (!m_running)
+		return;
+	m_running = false;
+	int64_t now = duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+	for (auto& source : m_sources) {
+		if (source->thread.joinable())
+			source->thread.join();
+		source->stopNs = now;
+	}
+}
+
+void CLoadGenerator::GetStats(std::vector<LoadSourceStats>& stats) const
+{
+	stats.clear();
+	int64_t now = duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+	for (auto& source : m_sources) {
+		LoadSourceStats row;
+		row.name = source->name;
+		row.video = source->video;
+		row.targetRate = source->video ? source->fps : 1000.0 / AUDIO_FRAME_MS;
+		row.frames = source->frames;
+		row.dropped = source->dropped;
+		row.rejected = source->rejected;
+		int64_t startNs = source->startNs;
+		int64_t stopNs = source->stopNs;
+		double seconds = startNs ? ((stopNs ? stopNs : now) - startNs) / 1e9 : 0.0;
+		int64_t cpuNs = source->cpuNs;
+		if (seconds > 0) {
+			row.achievedRate = row.frames / seconds;
+			row.cpuPercent = cpuNs / 1e7 / seconds;
+		}
+		//rejected frames were generated and pushed as well.
+		if (row.frames + row.rejected)
+			row.cpuUsPerFrame = cpuNs / 1e3 / (row.frames + row.rejected);
+		stats.push_back(row);
+	}
+}
+
+void CLoadGenerator::RunSource(CLoadGenerator* self, Source* source)
+{
+	const nanoseconds period(1000000000LL / source->fps);
+	const steady_clock::time_point start = steady_clock::now();
+	const int64_t cpuStart = ThreadCpuNs();
+	steady_clock::time_point next = start;
+	uint32_t frameIndex = 0;
+	while (self->m_running) {
+		if (source->video)
+			self->RenderVideo(*source, frameIndex);
+		else
+			self->RenderAudio(*source);
+		int64_t timestampMs = duration_cast<milliseconds>(next - start).count();
+		if (self->PushFrame(*source, timestampMs) < 0)
+			++source->rejected;
+		else
+			++source->frames;
+		source->cpuNs = ThreadCpuNs() - cpuStart;
+
+		next += period;
+		++frameIndex;
+		nanoseconds behind = steady_clock::now() - next;
+		if (behind > period * (int)LATE_FRAMES) {
+			//give up on the frames that are already too late.
+			int64_t missed = behind / period;
+			source->dropped += missed;
+			next += period * missed;
+			frameIndex += (uint32_t)missed;
+		}
+		std::this_thread::sleep_until(next);
+	}
+}
+
+void CLoadGenerator::RenderVideo(Source& source, uint32_t frameIndex)
+{
+	const int width = source.videoConfig.width;
+	const int height = source.videoConfig.height;
+	const int chromaWidth = width / 2;
+	uint8_t* y = source.buffer.data();
+	uint8_t* u = y + (size_t)width * height;
+	uint8_t* v = u + (size_t)chromaWidth * (height / 2);
+	switch (source.videoConfig.pattern) {
+	case LOAD_PATTERN_BARS: {
+		//every row is the same, render one and copy it.
+		int shift = (int)(frameIndex * 4 % (uint32_t)width);
+		for (int x = 0; x < width; ++x)
+			y[x] = BAR_Y[(x + shift) % width * 8 / width];
+		for (int x = 0; x < chromaWidth; ++x) {
+			int bar = (x * 2 + shift) % width * 8 / width;
+			u[x] = BAR_U[bar];
+			v[x] = BAR_V[bar];
+		}
+		for (int row = 1; row < height; ++row)
+			memcpy(y + (size_t)row * width, y, width);
+		for (int row = 1; row < height / 2; ++row) {
+			memcpy(u + (size_t)row * chromaWidth, u, chromaWidth);
+			memcpy(v + (size_t)row * chromaWidth, v, chromaWidth);
+		}
+		break;
+	}
+	case LOAD_PATTERN_GRADIENT:
+		for (int row = 0; row < height; ++row) {
+			uint8_t* line = y + (size_t)row * width;
+			uint32_t base = row + frameIndex * 2;
+			for (int x = 0; x < width; ++x)
+				line[x] = (uint8_t)(base + x);
+		}
+		break;
+	case LOAD_PATTERN_NOISE: {
+		uint32_t state = source.noise;
+		size_t words = (size_t)width * height / 4;
+		uint32_t* luma = (uint32_t*)y;
+		for (size_t i = 0; i < words; ++i)
+			luma[i] = XorShift(state);
+		source.noise = state;
+		break;
+	}
+	}
+}
+
+void CLoadGenerator::RenderAudio(Source& source)
+{
+	const LoadAudioConfig& config = source.audioConfig;
+	int16_t* pcm = (int16_t*)source.buffer.data();
+	int samples = source.audioFrame.samples;
+	if (config.signal == LOAD_AUDIO_TONE) {
+		double step = 2.0 * PI * config.toneHz / config.sampleRate;
+		for (int i = 0; i < samples; ++i) {
+			int16_t value = (int16_t)(AUDIO_AMPLITUDE * sin(source.phase));
+			for (int ch = 0; ch < config.channels; ++ch)
+				*pcm++ = value;
+			source.phase += step;
+		}
+		source.phase = fmod(source.phase, 2.0 * PI);
+	}
+	else {
+		uint32_t state = source.noise;
+		for (int i = 0; i < samples * config.channels; ++i)
+			pcm[i] = (int16_t)((int32_t)XorShift(state) >> 18);
+		source.noise = state;
+	}
+}
+
+int CLoadGenerator::PushFrame(Source& source, int64_t timestampMs)
+{
+	if (!source.video) {
+		source.audioFrame.renderTimeMs = timestampMs;
+		return m_mediaEngine->pushAudioFrame(source.audioConfig.sourcePos, &source.audioFrame);
+	}
+	if (source.videoConfig.path == LOAD_CONSUME_RAW_FRAME) {
+		m_consumer->consumeRawVideoFrame(source.buffer.data(), ExternalVideoFrame::VIDEO_PIXEL_I420,
+			source.videoConfig.width, source.videoConfig.height, 0, (long)timestampMs);
+		return 0;
+	}
+	source.videoFrame.timestamp = timestampMs;
+	return m_mediaEngine->pushVideoFrame(&source.videoFrame);
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <IAgoraMediaEngine.h>
+#include <IAgoraRtcEngine.h>
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum LoadVideoPattern {
+	//color bars scrolling one step per frame.
+	LOAD_PATTERN_BARS,
+	//luma gradient with a moving offset.
+	LOAD_PATTERN_GRADIENT,
+	//new random luma every frame, the worst case for an encoder.
+	LOAD_PATTERN_NOISE,
+};
+
+enum LoadVideoPath {
+	//IMediaEngine::pushVideoFrame, as the custom video capture scene does.
+	LOAD_PUSH_VIDEO_FRAME,
+	//IVideoFrameConsumer::consumeRawVideoFrame, as the MediaIO scene does.
+	LOAD_CONSUME_RAW_FRAME,
+};
+
+enum LoadAudioSignal {
+	LOAD_AUDIO_TONE,
+	LOAD_AUDIO_NOISE,
+};
+
+struct LoadVideoConfig {
+	int width = 1280;
+	int height = 720;
+	int fps = 15;
+	LoadVideoPattern pattern = LOAD_PATTERN_BARS;
+	LoadVideoPath path = LOAD_PUSH_VIDEO_FRAME;
+};
+
+//PCM16 pushed in 10 ms frames through IMediaEngine::pushAudioFrame.
+struct LoadAudioConfig {
+	int sampleRate = 48000;
+	int channels = 1;
+	LoadAudioSignal signal = LOAD_AUDIO_TONE;
+	int toneHz = 440;
+	int sourcePos = 0;
+};
+
+struct LoadSourceStats {
+	std::string name;
+	bool video = false;
+	//frames per second.
+	double targetRate = 0.0;
+	double achievedRate = 0.0;
+	uint64_t frames = 0;
+	//frames skipped because the source fell too far behind its clock.
+	uint64_t dropped = 0;
+	//frames the push call returned an error for.
+	uint64_t rejected = 0;
+	//CPU time of the source thread in percent of one core, generation and push.
+	double cpuPercent = 0.0;
+	//per generated frame, accepted or rejected.
+	double cpuUsPerFrame = 0.0;
+};
+
+/*
+	Pushes synthetic video and audio through the same calls the external
+	source scenes use, to find out how many sources one process keeps up
+	with. Every source runs on its own thread at a fixed frame rate:
+	generate the frame, push it, sleep until the next frame is due. A
+	source that falls more than LATE_FRAMES behind skips the missed frames
+	and counts them as dropped. The per source CPU time is the CPU time of
+	its thread.
+	Nothing in here depends on the UI or on a live engine, the sinks can
+	be the stubs in StubMediaEngine.h.
+*/
+class CLoadGenerator
+{
+public:
+	enum {
+		AUDIO_FRAME_MS = 10,
+		LATE_FRAMES = 3,
+	};
+
+	CLoadGenerator();
+	~CLoadGenerator();
+
+	//sinks of the pushes, the engine for pushVideoFrame and pushAudioFrame,
+	//the consumer for consumeRawVideoFrame. set before Start.
+	void SetSinks(agora::media::IMediaEngine* mediaEngine, agora::rtc::IVideoFrameConsumer* consumer);
+	//false while running or for an invalid configuration.
+	bool AddVideoSource(const LoadVideoConfig& config);
+	bool AddAudioSource(const LoadAudioConfig& config);
+	void ClearSources();
+	int GetSourceCount() const { return (int)m_sources.size(); }
+
+	bool Start();
+	void Stop();
+	bool IsRunning() const { return m_running; }
+
+	//any thread, one row per source in the order they were added.
+	void GetStats(std::vector<LoadSourceStats>& stats) const;
+
+private:
+	struct Source;
+
+	static void RunSource(CLoadGenerator* self, Source* source);
+	void RenderVideo(Source& source, uint32_t frameIndex);
+	void RenderAudio(Source& source);
+	int PushFrame(Source& source, int64_t timestampMs);
+
+	agora::media::IMediaEngine* m_mediaEngine = nullptr;
+	agora::rtc::IVideoFrameConsumer* m_consumer = nullptr;
+	std::vector<std::unique_ptr<Source>> m_sources;
+	std::atomic<bool> m_running;
+};
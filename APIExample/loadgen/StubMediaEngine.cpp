@@ -0,0 +1,130 @@
+#include "StubMediaEngine.h"
+#include <chrono>
+#include <string.h>
+#include <vector>
+
+using namespace agora::media;
+
+namespace {
+	//the engine error for a push rate its buffer can not keep up with.
+	const int ERR_TOO_OFTEN = -12;
+
+	int64_t NowMs()
+	{
+		return std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	size_t GetVideoFrameSize(ExternalVideoFrame::VIDEO_PIXEL_FORMAT format, int stride, int height)
+	{
+		switch (format) {
+		case ExternalVideoFrame::VIDEO_PIXEL_BGRA:
+		case ExternalVideoFrame::VIDEO_PIXEL_RGBA:
+		case ExternalVideoFrame::VIDEO_PIXEL_ARGB:
+			return (size_t)stride * height * 4;
+		case ExternalVideoFrame::VIDEO_PIXEL_I422:
+			return (size_t)stride * height * 2;
+		default:
+			return (size_t)stride * height * 3 / 2;
+		}
+	}
+
+	//copies the frame like the engine does when it queues it.
+	void CopyFrame(const void* data, size_t size)
+	{
+		thread_local std::vector<uint8_t> queue;
+		if (queue.size() < size)
+			queue.resize(size);
+		memcpy(queue.data(), data, size);
+	}
+}
+
+CStubMediaEngine::CStubMediaEngine()
+	: m_videoWindow(0)
+	, m_videoInWindow(0)
+	, m_audioWindow(0)
+	, m_audioInWindow(0)
+	, m_videoFrames(0)
+	, m_audioFrames(0)
+	, m_bytes(0)
+	, m_rejected(0)
+{
+}
+
+CStubMediaEngine::~CStubMediaEngine()
+{
+}
+
+void CStubMediaEngine::SetRateLimit(int videoFps, int audioFps)
+{
+	m_videoLimit = videoFps;
+	m_audioLimit = audioFps;
+}
+
+bool CStubMediaEngine::Admit(std::atomic<int64_t>& windowStart, std::atomic<int>& count, int limit)
+{
+	if (limit <= 0)
+		return true;
+	int64_t now = NowMs();
+	int64_t start = windowStart;
+	if (now - start >= 1000 && windowStart.compare_exchange_strong(start, now))
+		count = 0;
+	return ++count <= limit;
+}
+
+int CStubMediaEngine::pushAudioFrame(MEDIA_SOURCE_TYPE /*type*/, IAudioFrameObserver::AudioFrame* frame, bool /*wrap*/)
+{
+	return pushAudioFrame(0, frame);
+}
+
+int CStubMediaEngine::pushAudioFrame(IAudioFrameObserver::AudioFrame* frame)
+{
+	return pushAudioFrame(0, frame);
+}
+
+int CStubMediaEngine::pushAudioFrame(int32_t /*sourcePos*/, IAudioFrameObserver::AudioFrame* frame)
+{
+	if (!frame || !frame->buffer)
+		return -2;
+	if (!Admit(m_audioWindow, m_audioInWindow, m_audioLimit)) {
+		++m_rejected;
+		return ERR_TOO_OFTEN;
+	}
+	size_t size = (size_t)frame->samples * frame->channels * frame->bytesPerSample;
+	CopyFrame(frame->buffer, size);
+	++m_audioFrames;
+	m_bytes += size;
+	return 0;
+}
+
+int CStubMediaEngine::pushVideoFrame(ExternalVideoFrame* frame)
+{
+	if (!frame || !frame->buffer)
+		return -2;
+	if (!Admit(m_videoWindow, m_videoInWindow, m_videoLimit)) {
+		++m_rejected;
+		return ERR_TOO_OFTEN;
+	}
+	size_t size = GetVideoFrameSize(frame->format, frame->stride, frame->height);
+	CopyFrame(frame->buffer, size);
+	++m_videoFrames;
+	m_bytes += size;
+	return 0;
+}
+
+CStubVideoFrameConsumer::CStubVideoFrameConsumer()
+	: m_frames(0)
+	, m_bytes(0)
+{
+}
+
+void CStubVideoFrameConsumer::consumeRawVideoFrame(const unsigned char* buffer, ExternalVideoFrame::VIDEO_PIXEL_FORMAT frameType,
+	int width, int height, int /*rotation*/, long /*timestamp*/)
+{
+	if (!buffer)
+		return;
+	size_t size = GetVideoFrameSize(frameType, width, height);
+	CopyFrame(buffer, size);
+	++m_frames;
+	m_bytes += size;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <IAgoraMediaEngine.h>
+#include <IAgoraRtcEngine.h>
+#include <atomic>
+#include <stdint.h>
+
+/*
+	Stand-ins for the engine side of the push calls, for load runs without
+	an engine or a network. Every pushed frame is copied once, as the
+	engine copies it into its own queue, and counted. With a rate limit
+	the stub refuses frames over the limit within a second like the
+	engine does when its buffer overflows (ERR_TOO_OFTEN).
+*/
+class CStubMediaEngine : public agora::media::IMediaEngine
+{
+public:
+	CStubMediaEngine();
+	virtual ~CStubMediaEngine();
+
+	//frames per second accepted per kind, 0 for no limit.
+	void SetRateLimit(int videoFps, int audioFps);
+	uint64_t GetVideoFrames() const { return m_videoFrames; }
+	uint64_t GetAudioFrames() const { return m_audioFrames; }
+	uint64_t GetBytes() const { return m_bytes; }
+	uint64_t GetRejected() const { return m_rejected; }
+
+	virtual void release() override {}
+	virtual int registerAudioFrameObserver(agora::media::IAudioFrameObserver* /*observer*/) override { return 0; }
+	virtual int registerVideoFrameObserver(agora::media::IVideoFrameObserver* /*observer*/) override { return 0; }
+	virtual int registerVideoRenderFactory(agora::media::IExternalVideoRenderFactory* /*factory*/) override { return 0; }
+	virtual int pushAudioFrame(agora::media::MEDIA_SOURCE_TYPE type, agora::media::IAudioFrameObserver::AudioFrame* frame, bool wrap) override;
+	virtual int pushAudioFrame(agora::media::IAudioFrameObserver::AudioFrame* frame) override;
+	virtual int pushAudioFrame(int32_t sourcePos, agora::media::IAudioFrameObserver::AudioFrame* frame) override;
+	virtual int setExternalAudioSourceVolume(int32_t /*sourcePos*/, int32_t /*volume*/) override { return 0; }
+	virtual int pullAudioFrame(agora::media::IAudioFrameObserver::AudioFrame* /*frame*/) override { return -1; }
+	virtual int setExternalVideoSource(bool /*enable*/, bool /*useTexture*/) override { return 0; }
+	virtual int pushVideoFrame(agora::media::ExternalVideoFrame* frame) override;
+	virtual int registerVideoEncodedFrameObserver(agora::media::IVideoEncodedFrameObserver* /*observer*/) override { return 0; }
+
+private:
+	//true if the frame fits in the current one second window.
+	bool Admit(std::atomic<int64_t>& windowStart, std::atomic<int>& count, int limit);
+
+	int m_videoLimit = 0;
+	int m_audioLimit = 0;
+	std::atomic<int64_t> m_videoWindow;
+	std::atomic<int> m_videoInWindow;
+	std::atomic<int64_t> m_audioWindow;
+	std::atomic<int> m_audioInWindow;
+	std::atomic<uint64_t> m_videoFrames;
+	std::atomic<uint64_t> m_audioFrames;
+	std::atomic<uint64_t> m_bytes;
+	std::atomic<uint64_t> m_rejected;
+};
+
+class CStubVideoFrameConsumer : public agora::rtc::IVideoFrameConsumer
+{
+public:
+	CStubVideoFrameConsumer();
+
+	uint64_t GetFrames() const { return m_frames; }
+	uint64_t GetBytes() const { return m_bytes; }
+
+	virtual void consumeRawVideoFrame(const unsigned char* buffer, agora::media::ExternalVideoFrame::VIDEO_PIXEL_FORMAT frameType,
+		int width, int height, int rotation, long timestamp) override;
+
+private:
+	std::atomic<uint64_t> m_frames;
+	std::atomic<uint64_t> m_bytes;
+};
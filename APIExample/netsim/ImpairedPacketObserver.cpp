@@ -0,0 +1,83 @@
+#include "ImpairedPacketObserver.h"
+#include <chrono>
+
+namespace {
+	int64_t NowUs()
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+}
+
+CImpairedPacketObserver::CImpairedPacketObserver()
+{
+	//the engine expects packet buffers of at least 2048 bytes.
+	m_sendAudio.reserve(2048);
+	m_sendVideo.reserve(2048);
+	m_receiveAudio.reserve(2048);
+	m_receiveVideo.reserve(2048);
+}
+
+bool CImpairedPacketObserver::LoadScript(const std::string& text, std::string* error)
+{
+	ImpairmentScript script;
+	if (!ParseImpairmentScript(text, script, error))
+		return false;
+	m_uplink.SetScript(script.uplink, script.loopMs);
+	m_uplink.SetSeed(script.seed);
+	//a different sequence than the uplink's from the same seed.
+	m_downlink.SetScript(script.downlink, script.loopMs);
+	m_downlink.SetSeed(script.seed ^ 0x9E3779B9u);
+	Reset();
+	return true;
+}
+
+void CImpairedPacketObserver::Reset()
+{
+	m_uplink.Reset();
+	m_downlink.Reset();
+}
+
+bool CImpairedPacketObserver::Impair(CNetworkImpairment& link, int stream, std::vector<uint8_t>& buffer, Packet& packet)
+{
+	switch (link.Process(stream, packet.buffer, packet.size, NowUs(), buffer)) {
+	case IMPAIR_PASS:
+		return true;
+	case IMPAIR_REPLACE:
+		if (buffer.capacity() < 2048)
+			buffer.reserve(2048);
+		packet.buffer = buffer.data();
+		packet.size = (unsigned int)buffer.size();
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool CImpairedPacketObserver::onSendAudioPacket(Packet& packet)
+{
+	if (m_chained && !m_chained->onSendAudioPacket(packet))
+		return false;
+	return Impair(m_uplink, STREAM_AUDIO, m_sendAudio, packet);
+}
+
+bool CImpairedPacketObserver::onSendVideoPacket(Packet& packet)
+{
+	if (m_chained && !m_chained->onSendVideoPacket(packet))
+		return false;
+	return Impair(m_uplink, STREAM_VIDEO, m_sendVideo, packet);
+}
+
+bool CImpairedPacketObserver::onReceiveAudioPacket(Packet& packet)
+{
+	if (!Impair(m_downlink, STREAM_AUDIO, m_receiveAudio, packet))
+		return false;
+	return !m_chained || m_chained->onReceiveAudioPacket(packet);
+}
+
+bool CImpairedPacketObserver::onReceiveVideoPacket(Packet& packet)
+{
+	if (!Impair(m_downlink, STREAM_VIDEO, m_receiveVideo, packet))
+		return false;
+	return !m_chained || m_chained->onReceiveVideoPacket(packet);
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "NetworkImpairment.h"
+#include <IAgoraRtcEngine.h>
+#include <string>
+#include <vector>
+
+/*
+	An IPacketObserver that runs the packets the engine sends through an
+	uplink and the packets it receives through a downlink
+	CNetworkImpairment, for degraded network runs without a network.
+	Another observer, such as a custom encryption, can be chained: it sees
+	outgoing packets before the uplink and incoming ones after the
+	downlink, as it would on a real network.
+*/
+class CImpairedPacketObserver : public agora::rtc::IPacketObserver
+{
+public:
+	enum {
+		STREAM_AUDIO = 0,
+		STREAM_VIDEO,
+	};
+
+	CImpairedPacketObserver();
+
+	void SetChainedObserver(agora::rtc::IPacketObserver* observer) { m_chained = observer; }
+	CNetworkImpairment& GetUplink() { return m_uplink; }
+	CNetworkImpairment& GetDownlink() { return m_downlink; }
+	//parses the script and restarts both links with it.
+	bool LoadScript(const std::string& text, std::string* error = nullptr);
+	//restarts both links with their configuration or script.
+	void Reset();
+
+	virtual bool onSendAudioPacket(Packet& packet) override;
+	virtual bool onSendVideoPacket(Packet& packet) override;
+	virtual bool onReceiveAudioPacket(Packet& packet) override;
+	virtual bool onReceiveVideoPacket(Packet& packet) override;
+
+private:
+	//one packet through link, false if nothing goes out in its place.
+	static bool Impair(CNetworkImpairment& link, int stream, std::vector<uint8_t>& buffer, Packet& packet);
+
+	agora::rtc::IPacketObserver* m_chained = nullptr;
+	CNetworkImpairment m_uplink;
+	CNetworkImpairment m_downlink;
+	//what the engine is handed for each of the four paths.
+	std::vector<uint8_t> m_sendAudio;
+	std::vector<uint8_t> m_sendVideo;
+	std::vector<uint8_t> m_receiveAudio;
+	std::vector<uint8_t> m_receiveVideo;
+};
@@ -0,0 +1,385 @@
+#include "NetworkImpairment.h"
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <sstream>
+//no stdafx.h, the simulator also builds without MFC.
+
+namespace {
+	//0 to 1, or percent with a trailing %.
+	bool ParseProbability(const std::string& text, double& value)
+	{
+		if (text.empty())
+			return false;
+		char* end = nullptr;
+		value = strtod(text.c_str(), &end);
+		if (end == text.c_str())
+			return false;
+		if (*end == '%') {
+			value /= 100.0;
+			++end;
+		}
+		return *end == '\0' && value >= 0.0 && value <= 1.0;
+	}
+
+	bool ParseMs(const std::string& text, int& value)
+	{
+		char* end = nullptr;
+		long parsed = strtol(text.c_str(), &end, 10);
+		if (end == text.c_str() || parsed < 0 || parsed > 3600 * 1000)
+			return false;
+		if (strcmp(end, "ms") != 0 && *end != '\0')
+			return false;
+		value = (int)parsed;
+		return true;
+	}
+
+	std::vector<std::string> Split(const std::string& text, char separator)
+	{
+		std::vector<std::string> parts;
+		std::string part;
+		std::istringstream stream(text);
+		while (std::getline(stream, part, separator))
+			parts.push_back(part);
+		return parts;
+	}
+
+	bool ApplyKey(ImpairmentConfig& config, const std::string& key, const std::string& value)
+	{
+		if (key == "loss")
+			return ParseProbability(value, config.lossRate);
+		if (key == "ge") {
+			std::vector<std::string> parts = Split(value, ',');
+			if (parts.size() != 2 && parts.size() != 4)
+				return false;
+			config.geLossGood = 0.0;
+			config.geLossBad = 1.0;
+			return ParseProbability(parts[0], config.geGoodToBad)
+				&& ParseProbability(parts[1], config.geBadToGood)
+				&& (parts.size() == 2 || (ParseProbability(parts[2], config.geLossGood)
+					&& ParseProbability(parts[3], config.geLossBad)));
+		}
+		if (key == "delay")
+			return ParseMs(value, config.delayMs);
+		if (key == "jitter")
+			return ParseMs(value, config.jitterMs);
+		if (key == "reorder") {
+			std::vector<std::string> parts = Split(value, ',');
+			if (parts.empty() || parts.size() > 2)
+				return false;
+			return ParseProbability(parts[0], config.reorderRate)
+				&& (parts.size() == 1 || ParseMs(parts[1], config.reorderMs));
+		}
+		if (key == "rate") {
+			char* end = nullptr;
+			long rate = strtol(value.c_str(), &end, 10);
+			if (end == value.c_str() || rate < 0 || (*end != '\0' && strcmp(end, "kbps") != 0))
+				return false;
+			config.rateKbps = (int)rate;
+			return true;
+		}
+		if (key == "queue")
+			return ParseMs(value, config.queueMs);
+		if (key == "burst") {
+			std::vector<std::string> parts = Split(value, ',');
+			if (parts.empty() || parts.size() > 2)
+				return false;
+			std::vector<std::string> times = Split(parts[0], '/');
+			config.burstLoss = 1.0;
+			return times.size() == 2 && ParseMs(times[0], config.burstMs) && ParseMs(times[1], config.burstPeriodMs)
+				&& config.burstMs <= config.burstPeriodMs
+				&& (parts.size() == 1 || ParseProbability(parts[1], config.burstLoss));
+		}
+		return false;
+	}
+}
+
+bool ImpairmentConfig::IsTransparent() const
+{
+	return lossRate <= 0.0 && geGoodToBad <= 0.0 && delayMs == 0 && jitterMs == 0
+		&& reorderRate <= 0.0 && rateKbps == 0 && (burstMs == 0 || burstPeriodMs == 0);
+}
+
+bool ParseImpairmentScript(const std::string& text, ImpairmentScript& script, std::string* error)
+{
+	script = ImpairmentScript();
+	ImpairmentConfig uplink, downlink;
+	std::istringstream lines(text);
+	std::string line;
+	int lineNumber = 0;
+	int64_t lastMs = 0;
+	auto fail = [&](const std::string& message) {
+		if (error)
+			*error = "line " + std::to_string(lineNumber) + ": " + message;
+		return false;
+	};
+	while (std::getline(lines, line)) {
+		++lineNumber;
+		size_t comment = line.find('#');
+		if (comment != std::string::npos)
+			line.resize(comment);
+		std::istringstream words(line);
+		std::vector<std::string> tokens;
+		std::string token;
+		while (words >> token)
+			tokens.push_back(token);
+		if (tokens.empty())
+			continue;
+		if (tokens.size() == 1 && tokens[0].compare(0, 5, "seed=") == 0) {
+			script.seed = (uint32_t)strtoul(tokens[0].c_str() + 5, nullptr, 10);
+			continue;
+		}
+		if (script.loopMs > 0)
+			return fail("steps after loop");
+
+		char* end = nullptr;
+		double seconds = strtod(tokens[0].c_str(), &end);
+		if (end == tokens[0].c_str() || *end != '\0' || seconds < 0.0)
+			return fail("a step starts with its time in seconds");
+		int64_t atMs = (int64_t)(seconds * 1000.0 + 0.5);
+		if (atMs < lastMs)
+			return fail("steps have to be in time order");
+		lastMs = atMs;
+
+		size_t index = 1;
+		bool toUplink = true, toDownlink = true;
+		if (index < tokens.size() && (tokens[index] == "up" || tokens[index] == "down")) {
+			toUplink = tokens[index] == "up";
+			toDownlink = !toUplink;
+			++index;
+		}
+		if (index < tokens.size() && tokens[index] == "loop") {
+			if (index + 1 != tokens.size() || !toUplink || !toDownlink || atMs == 0)
+				return fail("loop takes a time above 0 and nothing else");
+			script.loopMs = atMs;
+			continue;
+		}
+		ImpairmentConfig up = uplink, down = downlink;
+		for (; index < tokens.size(); ++index) {
+			if (tokens[index] == "reset") {
+				up = ImpairmentConfig();
+				down = ImpairmentConfig();
+				continue;
+			}
+			size_t equals = tokens[index].find('=');
+			if (equals == std::string::npos)
+				return fail("expected key=value, got " + tokens[index]);
+			std::string key = tokens[index].substr(0, equals);
+			std::string value = tokens[index].substr(equals + 1);
+			if (!ApplyKey(up, key, value) || !ApplyKey(down, key, value))
+				return fail("bad key or value " + tokens[index]);
+		}
+		if (toUplink) {
+			uplink = up;
+			ImpairmentStep step;
+			step.atMs = atMs;
+			step.config = uplink;
+			script.uplink.push_back(step);
+		}
+		if (toDownlink) {
+			downlink = down;
+			ImpairmentStep step;
+			step.atMs = atMs;
+			step.config = downlink;
+			script.downlink.push_back(step);
+		}
+	}
+	return true;
+}
+
+CNetworkImpairment::CNetworkImpairment()
+	: m_random(1)
+{
+}
+
+void CNetworkImpairment::SetConfig(const ImpairmentConfig& config)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_script.clear();
+	m_step = -1;
+	m_config = config;
+}
+
+ImpairmentConfig CNetworkImpairment::GetConfig() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_config;
+}
+
+void CNetworkImpairment::SetScript(const std::vector<ImpairmentStep>& steps, int64_t loopMs)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_script = steps;
+	m_loopMs = loopMs;
+	//applied by the next packet, which also restarts the clock.
+	m_step = -2;
+	m_startUs = -1;
+	m_config = ImpairmentConfig();
+}
+
+void CNetworkImpairment::SetSeed(uint32_t seed)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_random.seed(seed);
+}
+
+void CNetworkImpairment::Reset()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (int stream = 0; stream < MAX_STREAMS; ++stream) {
+		for (auto& pending : m_pending[stream])
+			m_pool.push_back(std::move(pending.data));
+		m_pending[stream].clear();
+		m_lastReleaseUs[stream] = 0;
+		m_lastDelivered[stream] = 0;
+	}
+	if (!m_script.empty())
+		m_step = -2;
+	m_startUs = -1;
+	m_bad = false;
+	m_linkFreeUs = 0;
+	m_sequence = 0;
+	m_stats = ImpairmentStats();
+}
+
+void CNetworkImpairment::UpdateScript(int64_t nowUs)
+{
+	if (m_script.empty())
+		return;
+	int64_t ms = (nowUs - m_startUs) / 1000;
+	if (m_loopMs > 0)
+		ms %= m_loopMs;
+	int step = -1;
+	while (step + 1 < (int)m_script.size() && m_script[step + 1].atMs <= ms)
+		++step;
+	if (step != m_step) {
+		m_step = step;
+		m_config = step >= 0 ? m_script[step].config : ImpairmentConfig();
+	}
+}
+
+bool CNetworkImpairment::PassLoss(int64_t nowUs)
+{
+	if (m_config.burstMs > 0 && m_config.burstPeriodMs > 0) {
+		int64_t ms = (nowUs - m_startUs) / 1000 % m_config.burstPeriodMs;
+		if (ms < m_config.burstMs && Uniform() < m_config.burstLoss) {
+			++m_stats.burstLost;
+			return false;
+		}
+	}
+	double loss = m_config.lossRate;
+	if (m_config.geGoodToBad > 0.0) {
+		if (m_bad)
+			m_bad = Uniform() >= m_config.geBadToGood;
+		else
+			m_bad = Uniform() < m_config.geGoodToBad;
+		loss = m_bad ? m_config.geLossBad : m_config.geLossGood;
+	}
+	if (loss > 0.0 && Uniform() < loss) {
+		++m_stats.lost;
+		return false;
+	}
+	return true;
+}
+
+void CNetworkImpairment::Deliver(int stream, uint64_t sequence, int64_t arrivalUs, int64_t nowUs)
+{
+	++m_stats.delivered;
+	int64_t delay = nowUs - arrivalUs;
+	if (delay > 0) {
+		++m_stats.delayed;
+		m_stats.delayUsTotal += delay;
+		m_stats.delayUsMax = (std::max)(m_stats.delayUsMax, delay);
+	}
+	if (sequence < m_lastDelivered[stream])
+		++m_stats.reordered;
+	else
+		m_lastDelivered[stream] = sequence;
+}
+
+ImpairResult CNetworkImpairment::Process(int stream, const uint8_t* data, size_t size, int64_t nowUs, std::vector<uint8_t>& out)
+{
+	if (stream < 0 || stream >= MAX_STREAMS)
+		return IMPAIR_PASS;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_startUs < 0)
+		m_startUs = nowUs;
+	UpdateScript(nowUs);
+	++m_stats.packets;
+	m_stats.bytes += size;
+	uint64_t sequence = ++m_sequence;
+	std::deque<Pending>& pending = m_pending[stream];
+	if (m_config.IsTransparent() && pending.empty()) {
+		Deliver(stream, sequence, nowUs, nowUs);
+		return IMPAIR_PASS;
+	}
+
+	bool keep = PassLoss(nowUs);
+	int64_t departUs = nowUs;
+	if (keep && m_config.rateKbps > 0) {
+		int64_t startUs = (std::max)(nowUs, m_linkFreeUs);
+		if (startUs - nowUs > (int64_t)m_config.queueMs * 1000) {
+			++m_stats.queueLost;
+			keep = false;
+		}
+		else {
+			m_linkFreeUs = startUs + (int64_t)size * 8000 / m_config.rateKbps;
+			departUs = m_linkFreeUs;
+		}
+	}
+	if (keep) {
+		int64_t releaseUs = departUs + (int64_t)m_config.delayMs * 1000;
+		if (m_config.jitterMs > 0)
+			releaseUs += (int64_t)((Uniform() * 2.0 - 1.0) * m_config.jitterMs * 1000.0);
+		releaseUs = (std::max)(releaseUs, departUs);
+		if (m_config.reorderRate > 0.0 && Uniform() < m_config.reorderRate)
+			releaseUs += (int64_t)m_config.reorderMs * 1000;
+		else {
+			//jitter alone does not reorder.
+			releaseUs = (std::max)(releaseUs, m_lastReleaseUs[stream]);
+			m_lastReleaseUs[stream] = releaseUs;
+		}
+
+		if (releaseUs <= nowUs && pending.empty()) {
+			Deliver(stream, sequence, nowUs, nowUs);
+			return IMPAIR_PASS;
+		}
+		if (pending.size() >= MAX_PENDING)
+			++m_stats.queueLost;
+		else {
+			Pending held;
+			held.releaseUs = releaseUs;
+			held.arrivalUs = nowUs;
+			held.sequence = sequence;
+			if (!m_pool.empty()) {
+				held.data = std::move(m_pool.back());
+				m_pool.pop_back();
+			}
+			held.data.assign(data, data + size);
+			auto position = std::upper_bound(pending.begin(), pending.end(), releaseUs,
+				[](int64_t release, const Pending& other) { return release < other.releaseUs; });
+			pending.insert(position, std::move(held));
+		}
+	}
+
+	if (pending.empty() || pending.front().releaseUs > nowUs)
+		return IMPAIR_HOLD;
+	Pending& next = pending.front();
+	Deliver(stream, next.sequence, next.arrivalUs, nowUs);
+	//the caller's last packet is sent by now, its buffer goes back to the pool.
+	out.swap(next.data);
+	m_pool.push_back(std::move(next.data));
+	pending.pop_front();
+	return IMPAIR_REPLACE;
+}
+
+ImpairmentStats CNetworkImpairment::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	ImpairmentStats stats = m_stats;
+	stats.pending = 0;
+	for (int stream = 0; stream < MAX_STREAMS; ++stream)
+		stats.pending += m_pending[stream].size();
+	stats.step = m_script.empty() ? -1 : (std::max)(m_step, -1);
+	return stats;
+}
@@ -0,0 +1,171 @@
+#pragma once
+#include <deque>
+#include <mutex>
+#include <random>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+//what one link does to its packets. all zero is a perfect link.
+struct ImpairmentConfig {
+	//independent loss per packet, 0 to 1.
+	double lossRate = 0.0;
+	//Gilbert-Elliott loss, used instead of lossRate when geGoodToBad > 0:
+	//per packet the link moves good -> bad with geGoodToBad and back with
+	//geBadToGood, then loses the packet with the loss of its state.
+	double geGoodToBad = 0.0;
+	double geBadToGood = 1.0;
+	double geLossGood = 0.0;
+	double geLossBad = 1.0;
+	//one way delay, each packet varies by up to +-jitterMs. packets keep
+	//their order unless reordered on purpose.
+	int delayMs = 0;
+	int jitterMs = 0;
+	//share of packets held back reorderMs more so later ones overtake them.
+	double reorderRate = 0.0;
+	int reorderMs = 50;
+	//bandwidth cap, 0 for none. packets queue behind it and are dropped
+	//once they would wait more than queueMs.
+	int rateKbps = 0;
+	int queueMs = 300;
+	//an outage of burstMs every burstPeriodMs in which packets are lost
+	//with burstLoss.
+	int burstMs = 0;
+	int burstPeriodMs = 0;
+	double burstLoss = 1.0;
+
+	bool IsTransparent() const;
+};
+
+//a script step: the configuration of one link from atMs on.
+struct ImpairmentStep {
+	int64_t atMs = 0;
+	ImpairmentConfig config;
+};
+
+struct ImpairmentScript {
+	std::vector<ImpairmentStep> uplink;
+	std::vector<ImpairmentStep> downlink;
+	//the steps repeat with this period, 0 to stay in the last step.
+	int64_t loopMs = 0;
+	uint32_t seed = 1;
+};
+
+/*
+	Parses a script, one step per line:
+		<seconds> [up|down] key=value ...
+	A step changes only the keys it names, for both links unless up or
+	down is given, and holds until the next one. Keys: loss=2%,
+	ge=p,r[,lossGood,lossBad] (Gilbert-Elliott), delay=ms, jitter=ms,
+	reorder=2%[,ms], rate=kbps, queue=ms, burst=ms/periodMs[,loss%].
+	Probabilities are 0 to 1 or percent with a % sign. "<seconds> reset"
+	goes back to a perfect link, "<seconds> loop" repeats the script from
+	there, "seed=n" on its own line fixes the random numbers. # starts a
+	comment.
+*/
+bool ParseImpairmentScript(const std::string& text, ImpairmentScript& script, std::string* error = nullptr);
+
+enum ImpairResult {
+	//send the packet as it is.
+	IMPAIR_PASS = 0,
+	//send the packet in out instead, one that was held back earlier.
+	IMPAIR_REPLACE,
+	//send nothing: the packet was lost or is held back and nothing is due.
+	IMPAIR_HOLD,
+};
+
+struct ImpairmentStats {
+	uint64_t packets = 0;
+	uint64_t bytes = 0;
+	uint64_t delivered = 0;
+	//lost to the loss model, to a burst, and to the full queue of the cap.
+	uint64_t lost = 0;
+	uint64_t burstLost = 0;
+	uint64_t queueLost = 0;
+	//delivered later than they came, and after a packet that came later.
+	uint64_t delayed = 0;
+	uint64_t reordered = 0;
+	int64_t delayUsTotal = 0;
+	int64_t delayUsMax = 0;
+	//held back right now.
+	size_t pending = 0;
+	//script step in effect, -1 without a script.
+	int step = -1;
+
+	double GetLossRate() const { return packets ? (double)(lost + burstLost + queueLost) / packets : 0; }
+	double GetDelayMsAverage() const { return delivered ? delayUsTotal / 1e3 / delivered : 0; }
+};
+
+/*
+	One direction of a simulated network path for packets that pass a
+	synchronous hook, such as IPacketObserver. Each packet goes through
+	the burst outage, the loss model, the bandwidth cap and the delay, in
+	that order; streams (audio, video) share the link's state and cap but
+	are delivered in their own order.
+	A hook can replace a packet but not send an extra one, so a held back
+	packet leaves in the slot of a later packet of the same stream: the
+	delay is rounded up to the stream's packet interval and a stream that
+	stops sending keeps what it holds until it sends again.
+	Random numbers come from a seeded generator, the same packets at the
+	same times give the same run.
+*/
+class CNetworkImpairment
+{
+public:
+	enum {
+		MAX_STREAMS = 4,
+		//packets held back per stream before the oldest count as queue loss.
+		MAX_PENDING = 4096,
+	};
+
+	CNetworkImpairment();
+
+	//a fixed configuration, replaces a script.
+	void SetConfig(const ImpairmentConfig& config);
+	ImpairmentConfig GetConfig() const;
+	//steps run from the next packet on.
+	void SetScript(const std::vector<ImpairmentStep>& steps, int64_t loopMs);
+	void SetSeed(uint32_t seed);
+	//drops the held back packets and the counters, restarts a script.
+	void Reset();
+
+	//any thread. on IMPAIR_REPLACE out holds the packet to send; it keeps
+	//it until the next call for the same stream with the same out.
+	ImpairResult Process(int stream, const uint8_t* data, size_t size, int64_t nowUs, std::vector<uint8_t>& out);
+
+	ImpairmentStats GetStats() const;
+
+private:
+	struct Pending {
+		int64_t releaseUs = 0;
+		int64_t arrivalUs = 0;
+		uint64_t sequence = 0;
+		std::vector<uint8_t> data;
+	};
+
+	void UpdateScript(int64_t nowUs);
+	double Uniform() { return m_random() / 4294967296.0; }
+	//true if the packet survives the burst and the loss model.
+	bool PassLoss(int64_t nowUs);
+	void Deliver(int stream, uint64_t sequence, int64_t arrivalUs, int64_t nowUs);
+
+	mutable std::mutex m_mutex;
+	ImpairmentConfig m_config;
+	std::vector<ImpairmentStep> m_script;
+	int64_t m_loopMs = 0;
+	int m_step = -1;
+	//time of the first packet, the clock of scripts and bursts.
+	int64_t m_startUs = -1;
+
+	std::mt19937 m_random;
+	bool m_bad = false;
+	//when the capped link has sent everything queued so far.
+	int64_t m_linkFreeUs = 0;
+	uint64_t m_sequence = 0;
+	std::deque<Pending> m_pending[MAX_STREAMS];
+	int64_t m_lastReleaseUs[MAX_STREAMS] = {};
+	uint64_t m_lastDelivered[MAX_STREAMS] = {};
+	std::vector<std::vector<uint8_t>> m_pool;
+	ImpairmentStats m_stats;
+};
@@ -315,6 +315,11 @@
 #define IDC_BUTTON_ECHO_TEST2           1181
 #define IDC_CHECK_                      1182
 #define IDC_CHECK_REPORT                1182
+#define IDC_COMBO_TRANSCODING_LAYOUT    1183
+#define IDC_CHECK_ADAPTIVE_CAPTURE      1184
+#define IDC_CHECK_BEAUTY_IN_PROCESS     1185
+#define IDC_COMBO_BEAUTY_QUALITY        1186
+#define IDC_COMBO_CAPTURE_TARGET        1187
 
 // Next default values for new objects
 // 
@@ -322,7 +327,7 @@
 #ifndef APSTUDIO_READONLY_SYMBOLS
 #define _APS_NEXT_RESOURCE_VALUE        139
 #define _APS_NEXT_COMMAND_VALUE         32771
-#define _APS_NEXT_CONTROL_VALUE         1183
+#define _APS_NEXT_CONTROL_VALUE         1188
 #define _APS_NEXT_SYMED_VALUE           101
 #endif
 #endif
@@ -60,6 +60,9 @@ wchar_t rtmpStreamingCtrlTransCoding[INFO_LEN]	= { 0 };
 wchar_t rtmpStreamingCtrlAdd[INFO_LEN]			= { 0 };
 wchar_t rtmpStreamingCtrlRemove[INFO_LEN]		= { 0 };
 wchar_t rtmpStreamingCtrlRemoveAll[INFO_LEN]	= { 0 };
+wchar_t rtmpStreamingCtrlLayoutGrid[INFO_LEN]	= { 0 };
+wchar_t rtmpStreamingCtrlLayoutSpeaker[INFO_LEN]	= { 0 };
+wchar_t rtmpStreamingCtrlLayoutPip[INFO_LEN]	= { 0 };
 wchar_t agoraRtmpStateIdle[INFO_LEN]			= { 0 };
 wchar_t agoraRtmpStateConnecting[INFO_LEN]		= { 0 };
 wchar_t agoraRtmpStateRunning[INFO_LEN]			= { 0 };
@@ -446,6 +449,9 @@ void InitKeyInfomation()
     _tcscpy_s(rtmpStreamingCtrlRemove, INFO_LEN, Str(_T("RtmpStreaming.Ctrl.Remove")));
 	_tcscpy_s(rtmpStreamingCtrlTransCoding, INFO_LEN, Str(_T("RtmpStreaming.Ctrl.TransCoding")));
     _tcscpy_s(rtmpStreamingCtrlRemoveAll, INFO_LEN, Str(_T("RtmpStreaming.Ctrl.RemoveAll")));
+    _tcscpy_s(rtmpStreamingCtrlLayoutGrid, INFO_LEN, Str(_T("RtmpStreaming.Ctrl.LayoutGrid")));
+    _tcscpy_s(rtmpStreamingCtrlLayoutSpeaker, INFO_LEN, Str(_T("RtmpStreaming.Ctrl.LayoutSpeaker")));
+    _tcscpy_s(rtmpStreamingCtrlLayoutPip, INFO_LEN, Str(_T("RtmpStreaming.Ctrl.LayoutPip")));
     //rtmp state changed
     _tcscpy_s(agoraRtmpStateIdle, INFO_LEN, Str(_T("Agora.RtmpStateChange.IDLE")));
     _tcscpy_s(agoraRtmpStateConnecting, INFO_LEN, Str(_T("Agora.RtmpStateChange.Connecting")));
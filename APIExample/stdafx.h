@@ -59,6 +59,8 @@
 using namespace agora;
 using namespace agora::rtc;
 using namespace agora::media;
+#include "CAgoraEngineHost.h"
+#include "CAgoraEventBus.h"
 #define WM_MSGID(code) (WM_USER+0x200+code)
 //Agora Event Handler Message and structure
 #define EID_JOINCHANNEL_SUCCESS						0x00000001
@@ -170,6 +172,14 @@ typedef struct _tagRemoteVideoState {
 #define EID_LOCAL_AUDIO_STATS                        0x00000024
 #define EID_LOCAL_AUDIO_STATE_CHANED                0x00000025
 #define EID_REMOTE_AUDIO_STATE_CHANGED               0x00000027
+//wakeup message of CAgoraEventBus, the events themselves travel in the bus.
+#define EID_EVENT_BUS                               0x00000030
+//the screen share sampling thread picked new capture parameters.
+#define EID_ADAPTIVE_CAPTURE_TARGET                 0x00000031
+//the effect cache finished a load, lParam is the path to delete.
+#define EID_EFFECT_READY                            0x00000032
+//the host benchmark thread finished, lParam is the HostProfile to delete.
+#define EID_HOST_PROFILE                            0x00000033
 
 #define EID_SCREENSHARE_START 0x00000022
 #define EID_SCREENSHARE_STOP	0x00000023
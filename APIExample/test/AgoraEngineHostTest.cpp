@@ -0,0 +1,233 @@
+#include "CAgoraEngineHost.h"
+#include "NullRtcEngine.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+using namespace agora;
+using namespace agora::rtc;
+
+namespace {
+	class CMockMediaEngine : public agora::media::IMediaEngine
+	{
+	public:
+		void release() override {}
+		int registerAudioFrameObserver(agora::media::IAudioFrameObserver* observer) override { audioObserver = observer; return 0; }
+		int registerVideoFrameObserver(agora::media::IVideoFrameObserver* observer) override { videoObserver = observer; return 0; }
+		int registerVideoRenderFactory(agora::media::IExternalVideoRenderFactory* /*factory*/) override { return 0; }
+		int pushAudioFrame(agora::media::MEDIA_SOURCE_TYPE /*type*/, agora::media::IAudioFrameObserver::AudioFrame* /*frame*/, bool /*wrap*/) override { return 0; }
+		int pushAudioFrame(agora::media::IAudioFrameObserver::AudioFrame* /*frame*/) override { return 0; }
+		int pushAudioFrame(int32_t /*sourcePos*/, agora::media::IAudioFrameObserver::AudioFrame* /*frame*/) override { return 0; }
+		int setExternalAudioSourceVolume(int32_t /*sourcePos*/, int32_t /*volume*/) override { return 0; }
+		int pullAudioFrame(agora::media::IAudioFrameObserver::AudioFrame* /*frame*/) override { return 0; }
+		int setExternalVideoSource(bool /*enable*/, bool /*useTexture*/) override { return 0; }
+		int pushVideoFrame(agora::media::ExternalVideoFrame* /*frame*/) override { return 0; }
+		int registerVideoEncodedFrameObserver(agora::media::IVideoEncodedFrameObserver* /*observer*/) override { return 0; }
+
+		agora::media::IAudioFrameObserver* audioObserver = nullptr;
+		agora::media::IVideoFrameObserver* videoObserver = nullptr;
+	};
+
+	//records what the host and the leases leave behind on the engine.
+	class CMockRtcEngine : public CNullRtcEngine
+	{
+	public:
+		int initialize(const RtcEngineContext& /*context*/) override { ++initialized; return 0; }
+		int leaveChannel() override { ++resets; return 0; }
+		bool registerEventHandler(IRtcEngineEventHandler* eventHandler) override
+		{
+			handlers.push_back(eventHandler);
+			return true;
+		}
+		bool unregisterEventHandler(IRtcEngineEventHandler* eventHandler) override
+		{
+			auto it = std::find(handlers.begin(), handlers.end(), eventHandler);
+			if (it == handlers.end())
+				return false;
+			handlers.erase(it);
+			return true;
+		}
+		int registerPacketObserver(IPacketObserver* observer) override { packetObserver = observer; return 0; }
+		int setParameters(const char* parameters) override { this->parameters.push_back(parameters); return 0; }
+		int setRecordingAudioFrameParameters(int sampleRate, int /*channel*/, RAW_AUDIO_FRAME_OP_MODE_TYPE /*mode*/, int /*samplesPerCall*/) override
+		{
+			recordingSampleRate = sampleRate;
+			return 0;
+		}
+		int queryInterface(INTERFACE_ID_TYPE iid, void** inter) override
+		{
+			if (iid != agora::AGORA_IID_MEDIA_ENGINE)
+				return -ERR_NOT_SUPPORTED;
+			*inter = &mediaEngine;
+			return 0;
+		}
+
+		int initialized = 0;
+		int resets = 0;
+		std::vector<IRtcEngineEventHandler*> handlers;
+		IPacketObserver* packetObserver = nullptr;
+		std::vector<std::string> parameters;
+		int recordingSampleRate = 0;
+		CMockMediaEngine mediaEngine;
+	};
+
+	//every engine the host created, the last one is the live one.
+	std::vector<std::unique_ptr<CMockRtcEngine>> g_engines;
+	int g_released = 0;
+
+	class CNullPacketObserver : public IPacketObserver
+	{
+	public:
+		bool onSendAudioPacket(Packet& /*packet*/) override { return true; }
+		bool onSendVideoPacket(Packet& /*packet*/) override { return true; }
+		bool onReceiveAudioPacket(Packet& /*packet*/) override { return true; }
+		bool onReceiveVideoPacket(Packet& /*packet*/) override { return true; }
+	};
+
+	class CEngineHostFixture : public ::testing::Test
+	{
+	protected:
+		void SetUp() override
+		{
+			CAgoraEngineHost::GetInstance()->Shutdown();
+			g_engines.clear();
+			g_released = 0;
+		}
+		void TearDown() override { CAgoraEngineHost::GetInstance()->Shutdown(); }
+
+		RtcEngineContext MakeContext(IRtcEngineEventHandler* eventHandler, const char* appId = "app")
+		{
+			RtcEngineContext context;
+			context.appId = appId;
+			context.eventHandler = eventHandler;
+			return context;
+		}
+		CMockRtcEngine& Engine() { return *g_engines.back(); }
+	};
+}
+
+//the SDK entry points the host calls, answered by the mock.
+AGORA_API IRtcEngine* AGORA_CALL createAgoraRtcEngine()
+{
+	g_engines.emplace_back(new CMockRtcEngine());
+	return g_engines.back().get();
+}
+
+void IRtcEngine::release(bool /*sync*/)
+{
+	++g_released;
+}
+
+TEST_F(CEngineHostFixture, SharesOneEngineAcrossLeases)
+{
+	IRtcEngineEventHandler first, second;
+	CAgoraEngineLease leaseA, leaseB;
+	ASSERT_EQ(0, leaseA.Acquire(MakeContext(&first)));
+	ASSERT_EQ(0, leaseB.Acquire(MakeContext(&second)));
+	ASSERT_EQ(1u, g_engines.size());
+	EXPECT_EQ(1, Engine().initialized);
+	EXPECT_EQ(leaseA.GetEngine(), leaseB.GetEngine());
+	EXPECT_EQ(2, CAgoraEngineHost::GetInstance()->GetLeaseCount());
+	EXPECT_EQ(2u, Engine().handlers.size());
+}
+
+TEST_F(CEngineHostFixture, OnlyTheLastLeaseResetsTheEngine)
+{
+	IRtcEngineEventHandler first, second;
+	CAgoraEngineLease leaseA, leaseB;
+	ASSERT_EQ(0, leaseA.Acquire(MakeContext(&first)));
+	ASSERT_EQ(0, leaseB.Acquire(MakeContext(&second)));
+	CNullPacketObserver observer;
+	ASSERT_EQ(0, leaseB.RegisterPacketObserver(&observer));
+
+	leaseA.Release();
+	EXPECT_EQ(0, Engine().resets);
+	EXPECT_EQ(&observer, Engine().packetObserver);
+	ASSERT_EQ(1u, Engine().handlers.size());
+	EXPECT_EQ(&second, Engine().handlers[0]);
+
+	leaseB.Release();
+	EXPECT_EQ(1, Engine().resets);
+	EXPECT_EQ(nullptr, Engine().packetObserver);
+	EXPECT_TRUE(Engine().handlers.empty());
+	EXPECT_EQ(0, CAgoraEngineHost::GetInstance()->GetLeaseCount());
+	//given back, not destroyed.
+	EXPECT_EQ(0, g_released);
+}
+
+TEST_F(CEngineHostFixture, KeepsOneCleanupPerKind)
+{
+	IRtcEngineEventHandler handler;
+	CAgoraEngineLease lease;
+	ASSERT_EQ(0, lease.Acquire(MakeContext(&handler)));
+	CNullPacketObserver observer;
+	for (int i = 0; i < 100; ++i) {
+		ASSERT_EQ(0, lease.RegisterPacketObserver(&observer));
+		ASSERT_EQ(0, lease.RegisterPacketObserver(NULL));
+		ASSERT_EQ(0, lease.SetRecordingAudioFrameParameters(48000, 1, RAW_AUDIO_FRAME_OP_MODE_READ_WRITE, 480));
+		ASSERT_EQ(0, lease.SetParameters("{\"che.audio.test\":true}", "{\"che.audio.test\":false}"));
+	}
+	//the observer was removed last, the two settings are undone once each.
+	EXPECT_EQ(2u, lease.GetCleanupCount());
+	ASSERT_EQ(0, lease.RegisterPacketObserver(&observer));
+	EXPECT_EQ(3u, lease.GetCleanupCount());
+
+	Engine().parameters.clear();
+	lease.Release();
+	EXPECT_EQ(nullptr, Engine().packetObserver);
+	EXPECT_EQ((int)CAgoraEngineHost::DEFAULT_AUDIO_FRAME_SAMPLE_RATE, Engine().recordingSampleRate);
+	//the restore value is applied once, however often it was set.
+	ASSERT_EQ(1u, Engine().parameters.size());
+	EXPECT_EQ("{\"che.audio.test\":false}", Engine().parameters[0]);
+}
+
+TEST_F(CEngineHostFixture, RecreatesForAnotherAppIdOnlyWhenIdle)
+{
+	IRtcEngineEventHandler first, second;
+	CAgoraEngineLease leaseA, leaseB;
+	ASSERT_EQ(0, leaseA.Acquire(MakeContext(&first, "app")));
+	EXPECT_EQ(-ERR_REFUSED, leaseB.Acquire(MakeContext(&second, "other")));
+	EXPECT_FALSE(leaseB.IsHeld());
+	leaseA.Release();
+	ASSERT_EQ(0, leaseB.Acquire(MakeContext(&second, "other")));
+	EXPECT_EQ(2u, g_engines.size());
+	EXPECT_EQ(1, g_released);
+}
+
+//what a scene switch costs the host itself: the leaving scene releases
+//what it installed, the next one acquires and installs its observers.
+TEST_F(CEngineHostFixture, MeasuresSceneSwitches)
+{
+	IRtcEngineEventHandler handlers[2];
+	CNullPacketObserver observer;
+	CAgoraEngineLease leases[2];
+	const int switches = 10000;
+	std::vector<double> us;
+	us.reserve(switches);
+	ASSERT_EQ(0, leases[0].Acquire(MakeContext(&handlers[0])));
+	for (int i = 1; i <= switches; ++i) {
+		CAgoraEngineLease& leaving = leases[(i - 1) % 2];
+		CAgoraEngineLease& entering = leases[i % 2];
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		leaving.Release();
+		ASSERT_EQ(0, entering.Acquire(MakeContext(&handlers[i % 2])));
+		entering.RegisterPacketObserver(&observer);
+		entering.SetRecordingAudioFrameParameters(48000, 1, RAW_AUDIO_FRAME_OP_MODE_READ_WRITE, 480);
+		us.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1e6);
+	}
+	EXPECT_EQ(1u, g_engines.size());
+	EXPECT_EQ(switches, Engine().resets);
+	EXPECT_EQ(1u, Engine().handlers.size());
+	double total = 0;
+	for (double value : us)
+		total += value;
+	std::sort(us.begin(), us.end());
+	printf("scene switch against the mock engine: %.2f us mean, p99 %.2f us, max %.2f us\n",
+		total / switches, us[switches * 99 / 100], us.back());
+	//the host's share of a switch stays far below a frame.
+	EXPECT_LT(total / switches, 1000.0);
+}
@@ -0,0 +1,236 @@
+#include "CAgoraEventBus.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+namespace {
+	enum {
+		EVENT_STATE = 1,
+		EVENT_STATS = 2,
+	};
+
+	AgoraEvent MakeEvent(int type, unsigned int uid, int value)
+	{
+		AgoraEvent event;
+		event.type = type;
+		event.uid = uid;
+		event.data.params[0] = value;
+		return event;
+	}
+
+	//dispatches on its own thread whenever the bus wakes it, like the UI
+	//thread does on the wakeup message.
+	class CConsumer
+	{
+	public:
+		explicit CConsumer(CAgoraEventBus& bus) : m_bus(bus)
+		{
+			m_bus.SetWakeup([this]() {
+				std::lock_guard<std::mutex> lock(m_mutex);
+				++m_wakeups;
+				m_cv.notify_one();
+			});
+			m_thread = std::thread([this]() { Run(); });
+		}
+		~CConsumer() { Stop(); }
+
+		void Stop()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_stop = true;
+				m_cv.notify_one();
+			}
+			if (m_thread.joinable())
+				m_thread.join();
+			m_bus.Dispatch();
+		}
+		uint64_t GetWakeups() const { return m_wakeups; }
+
+	private:
+		void Run()
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			for (;;) {
+				m_cv.wait(lock, [this]() { return m_stop || m_wakeups != m_handled; });
+				if (m_stop)
+					return;
+				m_handled = m_wakeups;
+				lock.unlock();
+				m_bus.Dispatch();
+				lock.lock();
+			}
+		}
+
+		CAgoraEventBus& m_bus;
+		std::mutex m_mutex;
+		std::condition_variable m_cv;
+		uint64_t m_wakeups = 0;
+		uint64_t m_handled = 0;
+		bool m_stop = false;
+		std::thread m_thread;
+	};
+}
+
+TEST(AgoraEventBusTest, CapacityIsRoundedUpToAPowerOfTwo)
+{
+	EXPECT_EQ(1024u, CAgoraEventBus(1000).GetCapacity());
+	EXPECT_EQ(1024u, CAgoraEventBus(1024).GetCapacity());
+	EXPECT_EQ(4u, CAgoraEventBus(3).GetCapacity());
+	EXPECT_EQ(2u, CAgoraEventBus(0).GetCapacity());
+
+	//a ring of 3 used to mask with 2 and lose every other cell.
+	CAgoraEventBus bus(3);
+	std::vector<int> values;
+	bus.Subscribe(EVENT_STATE, [&](const AgoraEvent& event) { values.push_back(event.data.params[0]); });
+	for (int i = 0; i < 4; ++i)
+		EXPECT_TRUE(bus.Post(MakeEvent(EVENT_STATE, 1, i)));
+	EXPECT_FALSE(bus.Post(MakeEvent(EVENT_STATE, 1, 4)));
+	EXPECT_EQ(4, bus.Dispatch());
+	EXPECT_EQ(std::vector<int>({ 0, 1, 2, 3 }), values);
+}
+
+TEST(AgoraEventBusTest, WakesOncePerBatch)
+{
+	CAgoraEventBus bus;
+	int wakeups = 0;
+	bus.SetWakeup([&]() { ++wakeups; });
+	for (int i = 0; i < 10; ++i)
+		bus.Post(MakeEvent(EVENT_STATE, 1, i));
+	EXPECT_EQ(1, wakeups);
+	EXPECT_EQ(0, bus.Dispatch());
+	bus.Post(MakeEvent(EVENT_STATE, 1, 0));
+	EXPECT_EQ(2, wakeups);
+	bus.Clear();
+	bus.Post(MakeEvent(EVENT_STATE, 1, 0));
+	EXPECT_EQ(3, wakeups);
+}
+
+TEST(AgoraEventBusTest, FullRingDropsAndCounts)
+{
+	CAgoraEventBus bus(16);
+	int delivered = 0;
+	bus.Subscribe(EVENT_STATE, [&](const AgoraEvent&) { ++delivered; });
+	for (int i = 0; i < 20; ++i)
+		bus.Post(MakeEvent(EVENT_STATE, 1, i));
+	EXPECT_EQ(16u, bus.GetPostedCount());
+	EXPECT_EQ(4u, bus.GetDroppedCount());
+	EXPECT_EQ(16, bus.Dispatch());
+	//the ring has room again.
+	EXPECT_TRUE(bus.Post(MakeEvent(EVENT_STATE, 1, 0)));
+	EXPECT_EQ(1, bus.Dispatch());
+	EXPECT_EQ(17, delivered);
+}
+
+TEST(AgoraEventBusTest, CoalescesToTheLatestPerUid)
+{
+	CAgoraEventBus bus;
+	bus.SetCoalesce(EVENT_STATS, true);
+	std::vector<std::pair<unsigned int, int>> seen;
+	bus.Subscribe(EVENT_STATS, [&](const AgoraEvent& event) { seen.push_back(std::make_pair(event.uid, event.data.params[0])); });
+	bus.Subscribe(EVENT_STATE, [&](const AgoraEvent& event) { seen.push_back(std::make_pair(event.uid, -event.data.params[0])); });
+
+	bus.Post(MakeEvent(EVENT_STATS, 1, 10));
+	bus.Post(MakeEvent(EVENT_STATS, 2, 20));
+	bus.Post(MakeEvent(EVENT_STATE, 1, 1));
+	bus.Post(MakeEvent(EVENT_STATE, 1, 2));
+	bus.Post(MakeEvent(EVENT_STATS, 1, 11));
+	bus.Post(MakeEvent(EVENT_STATS, 1, 12));
+	EXPECT_EQ(4, bus.Dispatch());
+	EXPECT_EQ(2u, bus.GetCoalescedCount());
+	//state events are all kept, stats keep the place of their latest post.
+	std::vector<std::pair<unsigned int, int>> expected = { { 2, 20 }, { 1, -1 }, { 1, -2 }, { 1, 12 } };
+	EXPECT_EQ(expected, seen);
+
+	//the next batch starts over.
+	seen.clear();
+	bus.Post(MakeEvent(EVENT_STATS, 1, 13));
+	EXPECT_EQ(1, bus.Dispatch());
+	EXPECT_EQ(13, seen[0].second);
+}
+
+TEST(AgoraEventBusTest, CoalescesAFullRingOfUids)
+{
+	CAgoraEventBus bus;
+	bus.SetCoalesce(EVENT_STATS, true);
+	std::vector<int> last(256, -1);
+	bus.Subscribe(EVENT_STATS, [&](const AgoraEvent& event) { last[event.uid] = event.data.params[0]; });
+	for (int round = 0; round < 4; ++round) {
+		for (unsigned int uid = 0; uid < 256; ++uid)
+			ASSERT_TRUE(bus.Post(MakeEvent(EVENT_STATS, uid, round)));
+	}
+	EXPECT_EQ(256, bus.Dispatch());
+	for (int value : last)
+		EXPECT_EQ(3, value);
+}
+
+//4 SDK threads post 100k events a second between them for a second while
+//the consumer dispatches on wakeup. reports the drop rate and latency.
+TEST(AgoraEventBusTest, MultiProducerStressAt100kEventsPerSecond)
+{
+	const int producers = 4;
+	const int eventsPerSecond = 100000;
+	const int seconds = 1;
+	//each producer posts a burst every millisecond.
+	const int burst = eventsPerSecond / producers / 1000;
+
+	CAgoraEventBus bus;
+	std::vector<int> nextValue(producers, 0);
+	std::vector<int64_t> latencies;
+	latencies.reserve((size_t)eventsPerSecond * seconds);
+	bool ordered = true;
+	bus.Subscribe(EVENT_STATE, [&](const AgoraEvent& event) {
+		latencies.push_back(CAgoraEventBus::Now() - event.postTime);
+		//events of one producer arrive in the order posted, dropped ones aside.
+		if (event.data.params[1] < nextValue[event.uid])
+			ordered = false;
+		nextValue[event.uid] = event.data.params[1] + 1;
+	});
+
+	CConsumer consumer(bus);
+	std::atomic<uint64_t> attempted(0);
+	std::vector<std::thread> threads;
+	for (int p = 0; p < producers; ++p) {
+		threads.emplace_back([&, p]() {
+			std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+			int sequence = 0;
+			for (int ms = 0; ms < seconds * 1000; ++ms) {
+				for (int i = 0; i < burst; ++i) {
+					AgoraEvent event = MakeEvent(EVENT_STATE, p, 0);
+					event.data.params[1] = sequence++;
+					bus.Post(event);
+				}
+				attempted.fetch_add(burst);
+				next += std::chrono::milliseconds(1);
+				std::this_thread::sleep_until(next);
+			}
+		});
+	}
+	for (std::thread& thread : threads)
+		thread.join();
+	consumer.Stop();
+
+	uint64_t total = attempted.load();
+	ASSERT_EQ((uint64_t)eventsPerSecond * seconds, total);
+	EXPECT_EQ(total, bus.GetPostedCount() + bus.GetDroppedCount());
+	EXPECT_EQ(bus.GetPostedCount(), latencies.size());
+	EXPECT_TRUE(ordered);
+
+	std::sort(latencies.begin(), latencies.end());
+	double dropRate = 100.0 * bus.GetDroppedCount() / total;
+	int64_t p50 = latencies.empty() ? 0 : latencies[latencies.size() / 2];
+	int64_t p99 = latencies.empty() ? 0 : latencies[latencies.size() * 99 / 100];
+	printf("posted %llu, dropped %llu (%.3f%%), wakeups %llu, latency p50 %lld us, p99 %lld us, max %lld us\n",
+		(unsigned long long)bus.GetPostedCount(), (unsigned long long)bus.GetDroppedCount(), dropRate,
+		(unsigned long long)consumer.GetWakeups(), (long long)p50, (long long)p99, (long long)bus.GetMaxLatency());
+	//a ring of 1024 holds 10 ms of this load, a consumer that keeps up drops nothing.
+	EXPECT_LT(dropRate, 1.0);
+	//batching: far fewer wakeups than events.
+	EXPECT_LT(consumer.GetWakeups(), total / 4);
+}
@@ -0,0 +1,184 @@
+#include "dsp/AudioResampler.h"
+#include <gtest/gtest.h>
+#include <math.h>
+#include <vector>
+
+namespace {
+	const double kPi = 3.14159265358979323846;
+
+	//interleaved sine of frequency hz, the same on every channel.
+	class CSineSource
+	{
+	public:
+		CSineSource(int sampleRate, int channels, double hz)
+			: m_sampleRate(sampleRate), m_channels(channels), m_hz(hz) {}
+		void Read(int16_t* out, int samples)
+		{
+			for (int i = 0; i < samples; ++i, ++m_position) {
+				int16_t v = (int16_t)lrint(10000.0 * sin(2 * kPi * m_hz * m_position / m_sampleRate));
+				for (int ch = 0; ch < m_channels; ++ch)
+					*out++ = v;
+			}
+		}
+
+	private:
+		int m_sampleRate;
+		int m_channels;
+		double m_hz;
+		int64_t m_position = 0;
+	};
+
+	//SNR of signal against the best fitting sine of frequency hz, so the
+	//delay through the resampler does not matter.
+	double SineSnrDb(const std::vector<double>& signal, int sampleRate, double hz)
+	{
+		double ss = 0, cc = 0, sc = 0, ys = 0, yc = 0;
+		for (size_t n = 0; n < signal.size(); ++n) {
+			double s = sin(2 * kPi * hz * n / sampleRate), c = cos(2 * kPi * hz * n / sampleRate);
+			ss += s * s;
+			cc += c * c;
+			sc += s * c;
+			ys += signal[n] * s;
+			yc += signal[n] * c;
+		}
+		double det = ss * cc - sc * sc;
+		double a = (ys * cc - yc * sc) / det;
+		double b = (yc * ss - ys * sc) / det;
+		double power = 0, noise = 0;
+		for (size_t n = 0; n < signal.size(); ++n) {
+			double fit = a * sin(2 * kPi * hz * n / sampleRate) + b * cos(2 * kPi * hz * n / sampleRate);
+			power += fit * fit;
+			noise += (signal[n] - fit) * (signal[n] - fit);
+		}
+		return 10 * log10(power / (noise > 0 ? noise : 1e-30));
+	}
+
+	//resamples seconds of a sine in chunks of inChunk samples, sizing each
+	//output with GetOutputSamples, and returns channel ch past the filter delay.
+	std::vector<double> Resample(int inRate, int inChannels, int outRate, int outChannels,
+		CAudioResampler::Quality quality, int inChunk, double hz, int ch = 0, int* padded = nullptr, int seconds = 1)
+	{
+		CAudioResampler resampler;
+		EXPECT_TRUE(resampler.Init(inRate, inChannels, outRate, outChannels, quality));
+		CSineSource source(inRate, inChannels, hz);
+		std::vector<int16_t> in((size_t)inChunk * inChannels);
+		std::vector<int16_t> out;
+		std::vector<double> signal;
+		int totalPadded = 0;
+		for (int64_t read = 0; read < (int64_t)inRate * seconds; read += inChunk) {
+			source.Read(in.data(), inChunk);
+			int outSamples = resampler.GetOutputSamples(inChunk);
+			out.resize((size_t)outSamples * outChannels);
+			int pad = resampler.Process(in.data(), inChunk, out.data(), outSamples);
+			if (read > inRate / 10)
+				totalPadded += pad;
+			for (int i = 0; i < outSamples; ++i)
+				signal.push_back(out[(size_t)i * outChannels + ch]);
+		}
+		if (padded)
+			*padded = totalPadded;
+		//skip the delay and the filter's start up.
+		signal.erase(signal.begin(), signal.begin() + (std::min)(signal.size(), (size_t)resampler.GetLatencySamples() * 4));
+		return signal;
+	}
+}
+
+TEST(AudioResamplerTest, RejectsUnsupportedFormats)
+{
+	CAudioResampler resampler;
+	EXPECT_FALSE(resampler.Init(4000, 1, 48000, 1));
+	EXPECT_FALSE(resampler.Init(48000, 1, 192000, 1));
+	EXPECT_FALSE(resampler.Init(48000, 0, 48000, 1));
+	EXPECT_FALSE(resampler.Init(48000, 1, 48000, CAudioResampler::MAX_CHANNELS + 1));
+	EXPECT_FALSE(resampler.IsInitialized());
+	EXPECT_TRUE(resampler.Init(8000, 1, 96000, 8));
+}
+
+TEST(AudioResamplerTest, PassthroughCopies)
+{
+	CAudioResampler resampler;
+	ASSERT_TRUE(resampler.Init(48000, 2, 48000, 2));
+	EXPECT_TRUE(resampler.IsPassthrough());
+	std::vector<int16_t> in(960), out(960);
+	for (size_t i = 0; i < in.size(); ++i)
+		in[i] = (int16_t)(i * 7);
+	EXPECT_EQ(0, resampler.Process(in.data(), 480, out.data(), 480));
+	EXPECT_EQ(in, out);
+}
+
+TEST(AudioResamplerTest, SnrAgainstReferenceSine)
+{
+	struct Case {
+		int inRate, outRate;
+		CAudioResampler::Quality quality;
+		double minSnrDb;
+	};
+	const Case cases[] = {
+		{ 44100, 48000, CAudioResampler::QUALITY_LOW, 55 },
+		{ 44100, 48000, CAudioResampler::QUALITY_MEDIUM, 60 },
+		{ 44100, 48000, CAudioResampler::QUALITY_HIGH, 60 },
+		{ 48000, 44100, CAudioResampler::QUALITY_MEDIUM, 60 },
+		{ 8000, 48000, CAudioResampler::QUALITY_MEDIUM, 55 },
+		{ 96000, 8000, CAudioResampler::QUALITY_MEDIUM, 55 },
+		{ 16000, 44100, CAudioResampler::QUALITY_HIGH, 60 },
+		//more phases than the table holds, neighbours are interpolated.
+		{ 44100, 47999, CAudioResampler::QUALITY_MEDIUM, 55 },
+	};
+	for (const Case& c : cases) {
+		std::vector<double> signal = Resample(c.inRate, 1, c.outRate, 1, c.quality, c.inRate / 100, 997);
+		EXPECT_GT(SineSnrDb(signal, c.outRate, 997), c.minSnrDb) << c.inRate << " -> " << c.outRate << " quality " << c.quality;
+	}
+}
+
+TEST(AudioResamplerTest, ChunksOfAnySizeLoseNoSamples)
+{
+	//1024 in at 44.1 kHz is 1114.5 out at 48 kHz; rounding every chunk down
+	//grew the delay by half a sample a chunk until, after about a minute,
+	//samples were dropped. a fixed delay keeps one sine fitting it all.
+	const int chunks[] = { 1024, 441, 97, 4096 };
+	for (int chunk : chunks) {
+		int padded = 0;
+		std::vector<double> signal = Resample(44100, 2, 48000, 2, CAudioResampler::QUALITY_MEDIUM, chunk, 997, 1, &padded, 90);
+		EXPECT_GT(SineSnrDb(signal, 48000, 997), 60) << "chunk " << chunk;
+		EXPECT_EQ(0, padded) << "chunk " << chunk;
+	}
+}
+
+TEST(AudioResamplerTest, OutputSamplesAddUpToTheRatio)
+{
+	CAudioResampler resampler;
+	ASSERT_TRUE(resampler.Init(44100, 1, 48000, 1));
+	int64_t in = 0, out = 0;
+	for (int i = 0; i < 1000; ++i) {
+		int chunk = 1 + (i * 37) % 2000;
+		in += chunk;
+		out += resampler.GetOutputSamples(chunk);
+		ASSERT_EQ(in * 48000 / 44100, out);
+	}
+	resampler.Reset();
+	EXPECT_EQ(1114, resampler.GetOutputSamples(1024));
+	EXPECT_EQ(1115, resampler.GetOutputSamples(1024));
+}
+
+TEST(AudioResamplerTest, MixesChannels)
+{
+	//left and right of opposite sign average to silence on the way to mono.
+	CAudioResampler down;
+	ASSERT_TRUE(down.Init(48000, 2, 16000, 1));
+	std::vector<int16_t> in(960), out(160);
+	for (int i = 0; i < 480; ++i) {
+		in[i * 2] = (int16_t)(i % 100 * 50);
+		in[i * 2 + 1] = (int16_t)-(i % 100 * 50);
+	}
+	for (int i = 0; i < 10; ++i) {
+		down.Process(in.data(), 480, out.data(), 160);
+		for (int16_t v : out)
+			ASSERT_LE(abs(v), 1);
+	}
+
+	//mono goes to both channels of stereo.
+	std::vector<double> left = Resample(16000, 1, 48000, 2, CAudioResampler::QUALITY_MEDIUM, 160, 440, 0);
+	std::vector<double> right = Resample(16000, 1, 48000, 2, CAudioResampler::QUALITY_MEDIUM, 160, 440, 1);
+	EXPECT_EQ(left, right);
+	EXPECT_GT(SineSnrDb(right, 48000, 440), 60);
+}
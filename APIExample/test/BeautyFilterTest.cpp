@@ -0,0 +1,138 @@
+#include "dsp/BeautyFilter.h"
+#include "dsp/CpuFeatures.h"
+#include <gtest/gtest.h>
+#include <random>
+#include <stdlib.h>
+#include <vector>
+
+namespace {
+	//a contiguous I420 frame, skin toned chroma over noisy luma.
+	struct Frame {
+		int width, height;
+		std::vector<uint8_t> data;
+
+		Frame(int w, int h) : width(w), height(h), data((size_t)w * h + 2 * (size_t)ChromaWidth(w) * ((h + 1) / 2))
+		{
+			std::mt19937 random(w * 31 + h);
+			for (size_t i = 0; i < (size_t)w * h; ++i)
+				data[i] = (uint8_t)(120 + random() % 16);
+			std::fill(data.begin() + (size_t)w * h, data.begin() + (size_t)w * h + ChromaSize(), (uint8_t)105);
+			std::fill(data.begin() + (size_t)w * h + ChromaSize(), data.end(), (uint8_t)150);
+		}
+		static int ChromaWidth(int w) { return (w + 1) / 2; }
+		size_t ChromaSize() const { return (size_t)ChromaWidth(width) * ((height + 1) / 2); }
+		bool Process(CBeautyFilter& filter)
+		{
+			uint8_t* y = data.data();
+			uint8_t* u = y + (size_t)width * height;
+			uint8_t* v = u + ChromaSize();
+			return filter.Process(y, width, u, ChromaWidth(width), v, ChromaWidth(width), width, height);
+		}
+	};
+
+	BeautyFilterOptions AllOn(BEAUTY_FILTER_QUALITY quality)
+	{
+		BeautyFilterOptions options;
+		options.smoothness = 0.7f;
+		options.lightening = 0.5f;
+		options.redness = 0.3f;
+		options.quality = quality;
+		return options;
+	}
+}
+
+TEST(BeautyFilterTest, SimdAndScalarMatchToRounding)
+{
+	if (!AgHasAVX2())
+		GTEST_SKIP() << "no AVX2";
+	const int sizes[][2] = { { 2, 2 }, { 33, 7 }, { 64, 48 }, { 161, 91 } };
+	for (auto& size : sizes) {
+		for (int quality = BEAUTY_FILTER_QUALITY_HIGH; quality <= BEAUTY_FILTER_QUALITY_FAST; ++quality) {
+			Frame simd(size[0], size[1]);
+			Frame scalar(size[0], size[1]);
+			CBeautyFilter simdFilter;
+			CBeautyFilter scalarFilter;
+			scalarFilter.SetUseAVX2(false);
+			simdFilter.SetOptions(AllOn((BEAUTY_FILTER_QUALITY)quality));
+			scalarFilter.SetOptions(AllOn((BEAUTY_FILTER_QUALITY)quality));
+			ASSERT_TRUE(simd.Process(simdFilter));
+			ASSERT_TRUE(scalar.Process(scalarFilter));
+			for (size_t i = 0; i < simd.data.size(); ++i)
+				ASSERT_LE(abs(simd.data[i] - scalar.data[i]), 1) << size[0] << "x" << size[1] << " quality " << quality << " at " << i;
+		}
+	}
+}
+
+TEST(BeautyFilterTest, SmoothsSkin)
+{
+	Frame frame(64, 48);
+	auto variance = [&]() {
+		double sum = 0, sumSq = 0;
+		for (int i = 0; i < 64 * 48; ++i) {
+			sum += frame.data[i];
+			sumSq += frame.data[i] * frame.data[i];
+		}
+		double mean = sum / (64 * 48);
+		return sumSq / (64 * 48) - mean * mean;
+	};
+	double before = variance();
+	CBeautyFilter filter;
+	BeautyFilterOptions options;
+	options.smoothness = 1.0f;
+	options.quality = BEAUTY_FILTER_QUALITY_HIGH;
+	filter.SetOptions(options);
+	ASSERT_TRUE(frame.Process(filter));
+	EXPECT_LT(variance(), before / 2);
+}
+
+TEST(BeautyFilterTest, KeepsTheQualityWithoutABudget)
+{
+	Frame frame(64, 48);
+	CBeautyFilter filter;
+	filter.SetOptions(AllOn(BEAUTY_FILTER_QUALITY_HIGH));
+	for (int i = 0; i < 40; ++i)
+		ASSERT_TRUE(frame.Process(filter));
+	BeautyFilterStats stats = filter.GetStats();
+	EXPECT_EQ(1, stats.scale);
+	EXPECT_EQ(0u, stats.budgetSteps);
+	EXPECT_EQ(0u, stats.reusedFrames);
+}
+
+TEST(BeautyFilterTest, StepsDownWhileOverTheBudget)
+{
+	Frame frame(64, 48);
+	CBeautyFilter filter;
+	BeautyFilterOptions options = AllOn(BEAUTY_FILTER_QUALITY_HIGH);
+	//no frame fits, every 8 frames is one step: balanced, fast, then
+	//reusing coefficients on every other frame.
+	options.budgetMs = 1e-6f;
+	filter.SetOptions(options);
+	for (int i = 0; i < 40; ++i)
+		ASSERT_TRUE(frame.Process(filter));
+	BeautyFilterStats stats = filter.GetStats();
+	EXPECT_EQ(4, stats.scale);
+	EXPECT_EQ(3u, stats.budgetSteps);
+	EXPECT_GT(stats.reusedFrames, 0u);
+	EXPECT_LT(stats.reusedFrames, stats.frames / 2);
+
+	//new options start over at the quality asked for.
+	options.budgetMs = 1000;
+	filter.SetOptions(options);
+	ASSERT_TRUE(frame.Process(filter));
+	EXPECT_EQ(1, filter.GetStats().scale);
+}
+
+TEST(BeautyFilterTest, DoesNotStepPastTheSmallestFrame)
+{
+	Frame frame(6, 6);
+	CBeautyFilter filter;
+	BeautyFilterOptions options = AllOn(BEAUTY_FILTER_QUALITY_HIGH);
+	options.budgetMs = 1e-6f;
+	filter.SetOptions(options);
+	for (int i = 0; i < 40; ++i)
+		ASSERT_TRUE(frame.Process(filter));
+	BeautyFilterStats stats = filter.GetStats();
+	//6 / 4 is too small to upsample from, so balanced and then reuse.
+	EXPECT_EQ(2, stats.scale);
+	EXPECT_EQ(2u, stats.budgetSteps);
+}
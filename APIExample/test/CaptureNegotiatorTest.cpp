@@ -0,0 +1,237 @@
+#include "capture/CaptureNegotiator.h"
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <unistd.h>
+
+namespace {
+	CaptureFormat Format(uint32_t fourcc, int width, int height, int fps)
+	{
+		CaptureFormat format;
+		format.fourcc = fourcc;
+		format.width = width;
+		format.height = height;
+		format.fps = fps;
+		return format;
+	}
+
+	CaptureRequest Request(int width, int height, int fps)
+	{
+		CaptureRequest request;
+		request.width = width;
+		request.height = height;
+		request.fps = fps;
+		return request;
+	}
+
+	//what a typical USB 2 webcam lists.
+	std::vector<CaptureFormat> WebcamFormats()
+	{
+		return {
+			Format(CAPTURE_FOURCC_YUY2, 640, 360, 30),
+			Format(CAPTURE_FOURCC_YUY2, 1280, 720, 10),
+			Format(CAPTURE_FOURCC_YUY2, 1920, 1080, 5),
+			Format(CAPTURE_FOURCC_MJPG, 640, 360, 30),
+			Format(CAPTURE_FOURCC_MJPG, 1280, 720, 30),
+			Format(CAPTURE_FOURCC_MJPG, 1920, 1080, 30),
+		};
+	}
+
+	//negotiates on the built-in estimates, without timing anything.
+	CaptureFormat Choose(const std::vector<CaptureFormat>& formats, const CaptureRequest& request)
+	{
+		CCaptureCostModel costs;
+		CCaptureNegotiator negotiator(costs);
+		CaptureNegotiation negotiation = negotiator.Negotiate(formats, request, false);
+		EXPECT_TRUE(negotiation.valid);
+		return negotiation.chosen.format;
+	}
+}
+
+TEST(CaptureNegotiatorTest, NativeFormatsWinAtTheSameSize)
+{
+	std::vector<CaptureFormat> formats = {
+		Format(CAPTURE_FOURCC_MJPG, 1280, 720, 30),
+		Format(CAPTURE_FOURCC_YUY2, 1280, 720, 30),
+		Format(CAPTURE_FOURCC_NV12, 1280, 720, 30),
+		Format(CAPTURE_FOURCC_BGR24, 1280, 720, 30),
+	};
+	CaptureFormat chosen = Choose(formats, Request(1280, 720, 30));
+	EXPECT_EQ(CAPTURE_FOURCC_NV12, chosen.fourcc);
+	formats.push_back(Format(CAPTURE_FOURCC_I420, 1280, 720, 30));
+	EXPECT_EQ(CAPTURE_FOURCC_I420, Choose(formats, Request(1280, 720, 30)).fourcc);
+}
+
+TEST(CaptureNegotiatorTest, FollowsTheRequestedSizeAndRate)
+{
+	std::vector<CaptureFormat> formats = WebcamFormats();
+	//small requests get the cheap raw format, larger ones MJPG at the size
+	//asked for: YUY2 does not reach the rate there.
+	EXPECT_TRUE(IsSameCaptureFormat(Format(CAPTURE_FOURCC_YUY2, 640, 360, 30), Choose(formats, Request(640, 360, 30))));
+	EXPECT_TRUE(IsSameCaptureFormat(Format(CAPTURE_FOURCC_MJPG, 1280, 720, 30), Choose(formats, Request(1280, 720, 30))));
+	EXPECT_TRUE(IsSameCaptureFormat(Format(CAPTURE_FOURCC_MJPG, 1920, 1080, 30), Choose(formats, Request(1920, 1080, 30))));
+	//a slow request is happy with raw 720p at 10 fps.
+	EXPECT_TRUE(IsSameCaptureFormat(Format(CAPTURE_FOURCC_YUY2, 1280, 720, 10), Choose(formats, Request(1280, 720, 10))));
+}
+
+TEST(CaptureNegotiatorTest, FallingShortWeighsMoreThanOvershooting)
+{
+	CCaptureCostModel costs;
+	CCaptureNegotiator negotiator(costs);
+	CaptureRequest request = Request(1280, 720, 30);
+	CaptureFormatPlan exact = negotiator.Score(Format(CAPTURE_FOURCC_NV12, 1280, 720, 30), request);
+	CaptureFormatPlan smaller = negotiator.Score(Format(CAPTURE_FOURCC_NV12, 960, 540, 30), request);
+	CaptureFormatPlan larger = negotiator.Score(Format(CAPTURE_FOURCC_NV12, 1600, 900, 30), request);
+	CaptureFormatPlan slower = negotiator.Score(Format(CAPTURE_FOURCC_NV12, 1280, 720, 15), request);
+	CaptureFormatPlan faster = negotiator.Score(Format(CAPTURE_FOURCC_NV12, 1280, 720, 60), request);
+	EXPECT_DOUBLE_EQ(0, exact.fitPenalty);
+	EXPECT_LT(exact.score, larger.score);
+	EXPECT_LT(larger.score, smaller.score);
+	EXPECT_LT(exact.score, faster.score);
+	EXPECT_LT(faster.score, slower.score);
+	//another aspect ratio costs too.
+	CaptureFormatPlan square = negotiator.Score(Format(CAPTURE_FOURCC_NV12, 1280, 960, 30), request);
+	EXPECT_GT(square.fitPenalty, larger.fitPenalty);
+}
+
+TEST(CaptureNegotiatorTest, ScoresCpuAndBandwidth)
+{
+	CCaptureCostModel costs;
+	CCaptureNegotiator negotiator(costs);
+	CaptureFormatPlan yuy2 = negotiator.Score(Format(CAPTURE_FOURCC_YUY2, 1920, 1080, 30), Request(1920, 1080, 30));
+	EXPECT_FALSE(yuy2.native);
+	EXPECT_FALSE(yuy2.costMeasured);
+	EXPECT_DOUBLE_EQ(1920.0 * 1080 * 2 * 30, yuy2.bandwidth);
+	EXPECT_NEAR(0.35 * 1920 * 1080 / 1000, yuy2.convertUsPerFrame, 1e-9);
+	EXPECT_NEAR(yuy2.convertUsPerFrame * 30 / 1e4, yuy2.cpuPercent, 1e-9);
+	CaptureFormatPlan mjpg = negotiator.Score(Format(CAPTURE_FOURCC_MJPG, 1920, 1080, 30), Request(1920, 1080, 30));
+	EXPECT_DOUBLE_EQ(1920.0 * 1080 * CCaptureNegotiator::MJPG_BYTES_PER_PIXEL * 30, mjpg.bandwidth);
+	//raw 1080p30 is far past a USB 2 link, the MJPG decode is cheaper.
+	EXPECT_LT(mjpg.score, yuy2.score);
+
+	//without a bus limit the raw format is cheaper.
+	CaptureRequest unlimited = Request(1920, 1080, 30);
+	unlimited.maxBandwidth = 0;
+	EXPECT_GT(negotiator.Score(Format(CAPTURE_FOURCC_MJPG, 1920, 1080, 30), unlimited).score,
+		negotiator.Score(Format(CAPTURE_FOURCC_YUY2, 1920, 1080, 30), unlimited).score);
+	//and a tight cpu budget makes the decode dearer still.
+	CaptureRequest tight = Request(1920, 1080, 30);
+	tight.cpuBudgetPercent = 5;
+	EXPECT_GT(negotiator.Score(Format(CAPTURE_FOURCC_MJPG, 1920, 1080, 30), tight).score, mjpg.score);
+}
+
+TEST(CaptureNegotiatorTest, MeasuredCostsOverrideTheEstimates)
+{
+	std::vector<CaptureFormat> formats = {
+		Format(CAPTURE_FOURCC_NV12, 1280, 720, 30),
+		Format(CAPTURE_FOURCC_YUY2, 1280, 720, 30),
+	};
+	CCaptureCostModel costs;
+	CCaptureNegotiator negotiator(costs);
+	EXPECT_EQ(CAPTURE_FOURCC_NV12, negotiator.Negotiate(formats, Request(1280, 720, 30), false).chosen.format.fourcc);
+	//NV12 turns out to take 20 ms a frame on this machine.
+	costs.Report(CAPTURE_FOURCC_NV12, 1280 * 720, 20000000, 1);
+	EXPECT_TRUE(costs.IsMeasured(CAPTURE_FOURCC_NV12));
+	CaptureNegotiation negotiation = negotiator.Negotiate(formats, Request(1280, 720, 30), false);
+	EXPECT_EQ(CAPTURE_FOURCC_YUY2, negotiation.chosen.format.fourcc);
+	ASSERT_EQ(2u, negotiation.candidates.size());
+	EXPECT_TRUE(negotiation.candidates[1].costMeasured);
+	EXPECT_NEAR(20000, negotiation.candidates[1].convertUsPerFrame, 1e-6);
+}
+
+TEST(CaptureNegotiatorTest, SkipsWhatCannotBeConvertedAndKeepsListPositions)
+{
+	CaptureFormat audio;
+	audio.media = CAPTURE_MEDIA_AUDIO;
+	audio.fourcc = CAPTURE_FOURCC_PCM16;
+	audio.sampleRate = 48000;
+	audio.channels = 2;
+	std::vector<CaptureFormat> formats = {
+		audio,
+		Format(CAPTURE_FOURCC('H', '2', '6', '4'), 1280, 720, 30),
+		Format(CAPTURE_FOURCC_YUY2, 0, 720, 30),
+		Format(CAPTURE_FOURCC_YUY2, 640, 360, 30),
+		Format(CAPTURE_FOURCC_YUY2, 640, 360, 30),
+	};
+	CCaptureCostModel costs;
+	CCaptureNegotiator negotiator(costs);
+	CaptureNegotiation negotiation = negotiator.Negotiate(formats, Request(640, 360, 30), false);
+	ASSERT_TRUE(negotiation.valid);
+	ASSERT_EQ(2u, negotiation.candidates.size());
+	//ties keep the device's order.
+	EXPECT_EQ(3, negotiation.chosen.index);
+	EXPECT_EQ(4, negotiation.candidates[1].index);
+
+	EXPECT_FALSE(negotiator.Negotiate({ audio }, Request(640, 360, 30), false).valid);
+	EXPECT_FALSE(negotiator.Negotiate({}, Request(640, 360, 30), false).valid);
+}
+
+TEST(CaptureNegotiatorTest, MeasuresRawFormatsOnce)
+{
+	CCaptureCostModel costs;
+	CCaptureNegotiator negotiator(costs);
+	std::vector<CaptureFormat> formats = {
+		Format(CAPTURE_FOURCC_YUY2, 640, 480, 30),
+		Format(CAPTURE_FOURCC_MJPG, 640, 480, 30),
+	};
+	negotiator.Negotiate(formats, Request(640, 480, 30));
+	EXPECT_TRUE(costs.IsMeasured(CAPTURE_FOURCC_YUY2));
+	EXPECT_GT(costs.GetNsPerPixel(CAPTURE_FOURCC_YUY2), 0);
+	//MJPG cannot be synthesized, it is learned from live frames.
+	EXPECT_FALSE(costs.IsMeasured(CAPTURE_FOURCC_MJPG));
+	EXPECT_FALSE(costs.Measure(CAPTURE_FOURCC_MJPG));
+	EXPECT_DOUBLE_EQ(CCaptureCostModel::GetEstimatedNsPerPixel(CAPTURE_FOURCC_MJPG),
+		costs.GetNsPerPixel(CAPTURE_FOURCC_MJPG));
+}
+
+TEST(CaptureNegotiatorTest, LiveReportsMoveTheCost)
+{
+	CCaptureCostModel costs;
+	costs.Report(CAPTURE_FOURCC_MJPG, 1000, 2000, 10);
+	EXPECT_DOUBLE_EQ(0.2, costs.GetNsPerPixel(CAPTURE_FOURCC_MJPG));
+	//ten more frames at 0.4 weigh as much as the first ten.
+	costs.Report(CAPTURE_FOURCC_MJPG, 1000, 4000, 10);
+	EXPECT_DOUBLE_EQ(0.3, costs.GetNsPerPixel(CAPTURE_FOURCC_MJPG));
+	//a single frame still moves it by the minimum weight.
+	costs.Report(CAPTURE_FOURCC_MJPG, 1000, 1300, 1);
+	EXPECT_NEAR(0.3 + (1.3 - 0.3) * 0.05, costs.GetNsPerPixel(CAPTURE_FOURCC_MJPG), 1e-12);
+	//empty reports are ignored.
+	costs.Report(CAPTURE_FOURCC_NV12, 0, 1000, 1);
+	costs.Report(CAPTURE_FOURCC_NV12, 1000, 0, 1);
+	EXPECT_FALSE(costs.IsMeasured(CAPTURE_FOURCC_NV12));
+}
+
+TEST(CaptureNegotiatorTest, SavesAndLoadsTheCostTable)
+{
+	char path[] = "/tmp/CaptureNegotiatorTestXXXXXX";
+	int fd = mkstemp(path);
+	ASSERT_GE(fd, 0);
+	close(fd);
+	CCaptureCostModel costs;
+	costs.Report(CAPTURE_FOURCC_MJPG, 1000, 3500, 7);
+	costs.Report(CAPTURE_FOURCC_NV12, 1000, 250, 1);
+	ASSERT_TRUE(costs.Save(path));
+
+	//a broken line in between is skipped.
+	FILE* file = fopen(path, "a");
+	ASSERT_NE(nullptr, file);
+	fprintf(file, "YUY2 nonsense\nUYVY -1 5\n");
+	fclose(file);
+
+	CCaptureCostModel loaded;
+	ASSERT_TRUE(loaded.Load(path));
+	EXPECT_TRUE(loaded.IsMeasured(CAPTURE_FOURCC_MJPG));
+	EXPECT_NEAR(3.5 / 7, loaded.GetNsPerPixel(CAPTURE_FOURCC_MJPG), 1e-4);
+	EXPECT_NEAR(0.25, loaded.GetNsPerPixel(CAPTURE_FOURCC_NV12), 1e-4);
+	EXPECT_FALSE(loaded.IsMeasured(CAPTURE_FOURCC_YUY2));
+	EXPECT_FALSE(loaded.IsMeasured(CAPTURE_FOURCC_UYVY));
+	remove(path);
+	EXPECT_FALSE(loaded.Load(path));
+}
+
+TEST(CaptureNegotiatorTest, DescribesThePlan)
+{
+	CCaptureCostModel costs;
+	CCaptureNegotiator negotiator(costs);
+	CaptureFormatPlan plan = negotiator.Score(Format(CAPTURE_FOURCC_NV12, 1280, 720, 30), Request(1280, 720, 30));
+	EXPECT_EQ("NV12 1280x720@30 convert 230us/frame (estimated) cpu 0.7%", CCaptureNegotiator::DescribePlan(plan));
+}
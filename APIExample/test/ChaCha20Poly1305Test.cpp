@@ -0,0 +1,102 @@
+#include "crypto/ChaCha20Poly1305.h"
+#include <gtest/gtest.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace {
+	//RFC 8439 2.8.2.
+	const char kPlaintext[] = "Ladies and Gentlemen of the class of '99: If I could offer you only one tip "
+		"for the future, sunscreen would be it.";
+	const uint8_t kAad[] = { 0x50, 0x51, 0x52, 0x53, 0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7 };
+	const uint8_t kNonce[] = { 0x07, 0x00, 0x00, 0x00, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47 };
+	const uint8_t kCiphertext[] = {
+		0xd3, 0x1a, 0x8d, 0x34, 0x64, 0x8e, 0x60, 0xdb, 0x7b, 0x86, 0xaf, 0xbc, 0x53, 0xef, 0x7e, 0xc2,
+		0xa4, 0xad, 0xed, 0x51, 0x29, 0x6e, 0x08, 0xfe, 0xa9, 0xe2, 0xb5, 0xa7, 0x36, 0xee, 0x62, 0xd6,
+		0x3d, 0xbe, 0xa4, 0x5e, 0x8c, 0xa9, 0x67, 0x12, 0x82, 0xfa, 0xfb, 0x69, 0xda, 0x92, 0x72, 0x8b,
+		0x1a, 0x71, 0xde, 0x0a, 0x9e, 0x06, 0x0b, 0x29, 0x05, 0xd6, 0xa5, 0xb6, 0x7e, 0xcd, 0x3b, 0x36,
+		0x92, 0xdd, 0xbd, 0x7f, 0x2d, 0x77, 0x8b, 0x8c, 0x98, 0x03, 0xae, 0xe3, 0x28, 0x09, 0x1b, 0x58,
+		0xfa, 0xb3, 0x24, 0xe4, 0xfa, 0xd6, 0x75, 0x94, 0x55, 0x85, 0x80, 0x8b, 0x48, 0x31, 0xd7, 0xbc,
+		0x3f, 0xf4, 0xde, 0xf0, 0x8e, 0x4b, 0x7a, 0x9d, 0xe5, 0x76, 0xd2, 0x65, 0x86, 0xce, 0xc6, 0x4b,
+		0x61, 0x16,
+	};
+	const uint8_t kTag[] = { 0x1a, 0xe1, 0x0b, 0x59, 0x4f, 0x09, 0xe2, 0x6a, 0x7e, 0x90, 0x2e, 0xcb, 0xd0, 0x60, 0x06, 0x91 };
+
+	CChaCha20Poly1305 MakeCipher()
+	{
+		uint8_t key[CChaCha20Poly1305::KEY_SIZE];
+		for (int i = 0; i < CChaCha20Poly1305::KEY_SIZE; ++i)
+			key[i] = (uint8_t)(0x80 + i);
+		CChaCha20Poly1305 cipher;
+		cipher.SetKey(key);
+		return cipher;
+	}
+}
+
+TEST(ChaCha20Poly1305Test, SealsTheRfc8439Vector)
+{
+	size_t size = strlen(kPlaintext);
+	ASSERT_EQ(sizeof(kCiphertext), size);
+	std::vector<uint8_t> out(size);
+	uint8_t tag[CChaCha20Poly1305::TAG_SIZE];
+	MakeCipher().Seal(kNonce, kAad, sizeof(kAad), (const uint8_t*)kPlaintext, size, out.data(), tag);
+	EXPECT_EQ(0, memcmp(kCiphertext, out.data(), size));
+	EXPECT_EQ(0, memcmp(kTag, tag, sizeof(tag)));
+}
+
+TEST(ChaCha20Poly1305Test, OpensTheRfc8439Vector)
+{
+	std::vector<uint8_t> out(sizeof(kCiphertext));
+	ASSERT_TRUE(MakeCipher().Open(kNonce, kAad, sizeof(kAad), kCiphertext, sizeof(kCiphertext), kTag, out.data()));
+	EXPECT_EQ(std::string(kPlaintext), std::string(out.begin(), out.end()));
+}
+
+TEST(ChaCha20Poly1305Test, SealsInPlace)
+{
+	std::vector<uint8_t> data(kPlaintext, kPlaintext + strlen(kPlaintext));
+	uint8_t tag[CChaCha20Poly1305::TAG_SIZE];
+	MakeCipher().Seal(kNonce, kAad, sizeof(kAad), data.data(), data.size(), data.data(), tag);
+	EXPECT_EQ(0, memcmp(kCiphertext, data.data(), data.size()));
+	EXPECT_EQ(0, memcmp(kTag, tag, sizeof(tag)));
+}
+
+TEST(ChaCha20Poly1305Test, RejectsAnyChangeAndLeavesTheOutputAlone)
+{
+	CChaCha20Poly1305 cipher = MakeCipher();
+	std::vector<uint8_t> out(sizeof(kCiphertext), 0xee);
+	std::vector<uint8_t> untouched = out;
+	std::vector<uint8_t> ciphertext(kCiphertext, kCiphertext + sizeof(kCiphertext));
+	std::vector<uint8_t> aad(kAad, kAad + sizeof(kAad));
+	std::vector<uint8_t> tag(kTag, kTag + sizeof(kTag));
+	std::vector<uint8_t> nonce(kNonce, kNonce + sizeof(kNonce));
+	std::vector<uint8_t>* parts[] = { &ciphertext, &aad, &tag, &nonce };
+	for (std::vector<uint8_t>* part : parts) {
+		for (size_t i = 0; i < part->size(); i += 5) {
+			(*part)[i] ^= 0x01;
+			EXPECT_FALSE(cipher.Open(nonce.data(), aad.data(), aad.size(), ciphertext.data(), ciphertext.size(), tag.data(), out.data()));
+			(*part)[i] ^= 0x01;
+		}
+	}
+	EXPECT_EQ(untouched, out);
+	//a shorter message is a different one.
+	EXPECT_FALSE(cipher.Open(kNonce, kAad, sizeof(kAad), kCiphertext, sizeof(kCiphertext) - 1, kTag, out.data()));
+	//and a cleared key opens nothing.
+	cipher.Clear();
+	EXPECT_FALSE(cipher.Open(kNonce, kAad, sizeof(kAad), kCiphertext, sizeof(kCiphertext), kTag, out.data()));
+}
+
+TEST(ChaCha20Poly1305Test, RoundTripsEverySizeAroundTheBlocks)
+{
+	CChaCha20Poly1305 cipher = MakeCipher();
+	for (size_t size = 0; size <= 200; ++size) {
+		std::vector<uint8_t> plain(size);
+		for (size_t i = 0; i < size; ++i)
+			plain[i] = (uint8_t)(i * 13 + size);
+		std::vector<uint8_t> sealed(size);
+		std::vector<uint8_t> opened(size);
+		uint8_t tag[CChaCha20Poly1305::TAG_SIZE];
+		cipher.Seal(kNonce, nullptr, 0, plain.data(), size, sealed.data(), tag);
+		ASSERT_TRUE(cipher.Open(kNonce, nullptr, 0, sealed.data(), size, tag, opened.data())) << size;
+		EXPECT_EQ(plain, opened) << size;
+	}
+}
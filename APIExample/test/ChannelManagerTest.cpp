@@ -0,0 +1,299 @@
+#include "Advanced/MultiChannel/ChannelManager.h"
+#include <IAgoraRtcChannel.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+using namespace agora::rtc;
+
+namespace {
+	enum {
+		EVENT_JOINED = 1,
+		EVENT_USER_JOINED = 2,
+		EVENT_VIDEO_STATS = 3,
+	};
+
+	//posts into the manager the way the MultiChannel dialog's ChannelEventHandler does.
+	class CTestChannelEventHandler : public IChannelEventHandler
+	{
+	public:
+		CTestChannelEventHandler(CChannelManager& manager, ChannelHandle handle) : m_manager(manager), m_handle(handle) {}
+
+		void onJoinChannelSuccess(IChannel* /*rtcChannel*/, uid_t uid, int elapsed) override { Post(EVENT_JOINED, uid, elapsed); }
+		void onUserJoined(IChannel* /*rtcChannel*/, uid_t uid, int elapsed) override { Post(EVENT_USER_JOINED, uid, elapsed); }
+		void onRemoteVideoStats(IChannel* /*rtcChannel*/, const RemoteVideoStats& stats) override
+		{
+			AgoraEvent event;
+			event.type = EVENT_VIDEO_STATS;
+			event.uid = stats.uid;
+			event.data.remoteVideoStats = stats;
+			m_manager.PostEvent(m_handle, event);
+		}
+
+	private:
+		void Post(int type, uid_t uid, int param0)
+		{
+			AgoraEvent event;
+			event.type = type;
+			event.uid = uid;
+			event.data.params[0] = param0;
+			m_manager.PostEvent(m_handle, event);
+		}
+
+		CChannelManager& m_manager;
+		ChannelHandle m_handle;
+	};
+
+	//stands in for an IChannel: fires its callbacks from an SDK thread of
+	//its own, in bursts, like a channel with many users does.
+	class CMockChannel
+	{
+	public:
+		CMockChannel(IChannelEventHandler* handler, int burstSize, int burstIntervalMs, int bursts)
+			: m_handler(handler), m_burstSize(burstSize), m_burstIntervalMs(burstIntervalMs), m_bursts(bursts) {}
+
+		void Start() { m_thread = std::thread([this]() { Run(); }); }
+		void Join() { m_thread.join(); }
+		int GetFired() const { return m_fired; }
+
+	private:
+		void Run()
+		{
+			m_handler->onJoinChannelSuccess(nullptr, 1, 0);
+			++m_fired;
+			std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+			for (int burst = 0; burst < m_bursts; ++burst) {
+				for (int i = 0; i < m_burstSize; ++i) {
+					RemoteVideoStats stats;
+					stats.uid = 100 + i;
+					stats.delay = burst;
+					m_handler->onRemoteVideoStats(nullptr, stats);
+					++m_fired;
+				}
+				next += std::chrono::milliseconds(m_burstIntervalMs);
+				std::this_thread::sleep_until(next);
+			}
+		}
+
+		IChannelEventHandler* m_handler;
+		int m_burstSize;
+		int m_burstIntervalMs;
+		int m_bursts;
+		int m_fired = 0;
+		std::thread m_thread;
+	};
+
+	//the UI thread: dispatches whenever the manager wakes it.
+	class CUIThread
+	{
+	public:
+		explicit CUIThread(CChannelManager& manager) : m_manager(manager)
+		{
+			m_manager.SetWakeup([this]() {
+				std::lock_guard<std::mutex> lock(m_mutex);
+				++m_wakeups;
+				m_cv.notify_one();
+			});
+		}
+		~CUIThread() { Stop(); }
+
+		void Start() { m_thread = std::thread([this]() { Run(); }); }
+		void Stop()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_stop = true;
+				m_cv.notify_one();
+			}
+			if (m_thread.joinable())
+				m_thread.join();
+		}
+
+	private:
+		void Run()
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			for (;;) {
+				m_cv.wait(lock, [this]() { return m_stop || m_wakeups != m_handled; });
+				if (m_stop)
+					return;
+				m_handled = m_wakeups;
+				lock.unlock();
+				m_manager.Dispatch();
+				lock.lock();
+			}
+		}
+
+		CChannelManager& m_manager;
+		std::mutex m_mutex;
+		std::condition_variable m_cv;
+		uint64_t m_wakeups = 0;
+		uint64_t m_handled = 0;
+		bool m_stop = false;
+		std::thread m_thread;
+	};
+
+	AgoraEvent MakeEvent(int type, unsigned int uid)
+	{
+		AgoraEvent event;
+		event.type = type;
+		event.uid = uid;
+		return event;
+	}
+}
+
+TEST(ChannelManagerTest, HandlesAreStableAndStaleOnesAreRejected)
+{
+	CChannelManager manager;
+	ChannelHandle a = manager.AddChannel("a");
+	ChannelHandle b = manager.AddChannel("b");
+	ASSERT_NE(0u, a);
+	ASSERT_NE(0u, b);
+	EXPECT_EQ(0u, manager.AddChannel("a"));
+	EXPECT_EQ(a, manager.FindChannel("a"));
+	EXPECT_EQ("b", manager.GetChannelId(b));
+	EXPECT_EQ(2, manager.GetChannelCount());
+
+	ASSERT_TRUE(manager.RemoveChannel(a));
+	EXPECT_FALSE(manager.RemoveChannel(a));
+	EXPECT_FALSE(manager.IsValid(a));
+	EXPECT_EQ(0u, manager.FindChannel("a"));
+	//the slot is reused, the old handle does not reach the new channel.
+	ChannelHandle c = manager.AddChannel("c");
+	EXPECT_EQ(CChannelManager::GetSlot(a), CChannelManager::GetSlot(c));
+	EXPECT_NE(a, c);
+	EXPECT_FALSE(manager.PostEvent(a, MakeEvent(EVENT_JOINED, 1)));
+	EXPECT_TRUE(manager.PostEvent(c, MakeEvent(EVENT_JOINED, 1)));
+	EXPECT_EQ("", manager.GetChannelId(a));
+
+	manager.RemoveAll();
+	for (int i = 0; i < CChannelManager::MAX_CHANNELS; ++i)
+		ASSERT_NE(0u, manager.AddChannel(std::to_string(i)));
+	EXPECT_EQ(0u, manager.AddChannel("one too many"));
+}
+
+TEST(ChannelManagerTest, AFullQueueOnlyDropsItsOwnChannel)
+{
+	CChannelManager manager;
+	int wakeups = 0;
+	manager.SetWakeup([&]() { ++wakeups; });
+	std::vector<int> delivered(CChannelManager::MAX_CHANNELS, 0);
+	manager.Subscribe(EVENT_USER_JOINED, [&](ChannelHandle handle, const AgoraEvent&) { ++delivered[CChannelManager::GetSlot(handle)]; });
+	ChannelHandle noisy = manager.AddChannel("noisy");
+	ChannelHandle quiet = manager.AddChannel("quiet");
+	for (int i = 0; i < CChannelManager::QUEUE_CAPACITY * 2; ++i)
+		manager.PostEvent(noisy, MakeEvent(EVENT_USER_JOINED, i + 1));
+	EXPECT_TRUE(manager.PostEvent(quiet, MakeEvent(EVENT_USER_JOINED, 1)));
+	//both channels got ready before the UI ran: one wakeup.
+	EXPECT_EQ(1, wakeups);
+	EXPECT_EQ(CChannelManager::QUEUE_CAPACITY + 1, manager.Dispatch());
+	EXPECT_EQ(CChannelManager::QUEUE_CAPACITY, delivered[CChannelManager::GetSlot(noisy)]);
+	EXPECT_EQ(1, delivered[CChannelManager::GetSlot(quiet)]);
+
+	std::vector<ChannelView> views;
+	manager.GetChannelViews(views);
+	ASSERT_EQ(2u, views.size());
+	EXPECT_EQ((uint64_t)CChannelManager::QUEUE_CAPACITY, views[0].dropped);
+	EXPECT_EQ(0u, views[1].dropped);
+	EXPECT_EQ(1u, views[1].delivered);
+}
+
+TEST(ChannelManagerTest, WorkerChannelsRunWorkerHandlersOffTheUIThread)
+{
+	CChannelManager manager;
+	std::mutex mutex;
+	std::condition_variable cv;
+	int ready = 0;
+	manager.SetWakeup([&]() {
+		std::lock_guard<std::mutex> lock(mutex);
+		++ready;
+		cv.notify_one();
+	});
+	std::thread::id uiThread = std::this_thread::get_id();
+	std::atomic<int> workerCalls(0);
+	std::atomic<bool> onUIThread(false);
+	manager.SubscribeWorker(EVENT_VIDEO_STATS, [&](ChannelHandle, const AgoraEvent&) {
+		if (std::this_thread::get_id() == uiThread)
+			onUIThread = true;
+		++workerCalls;
+	});
+	int uiCalls = 0;
+	manager.Subscribe(EVENT_VIDEO_STATS, [&](ChannelHandle, const AgoraEvent&) { ++uiCalls; });
+	ChannelHandle handle = manager.AddChannel("worker", true);
+	for (int i = 0; i < 10; ++i)
+		manager.PostEvent(handle, MakeEvent(EVENT_VIDEO_STATS, i + 1));
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		ASSERT_TRUE(cv.wait_for(lock, std::chrono::seconds(5), [&]() { return workerCalls == 10; }));
+	}
+	while (uiCalls < 10) {
+		manager.Dispatch();
+		std::this_thread::yield();
+	}
+	EXPECT_EQ(10, workerCalls.load());
+	EXPECT_FALSE(onUIThread);
+	EXPECT_TRUE(manager.RemoveChannel(handle));
+}
+
+//32 mock channels, a quarter of them on their own worker, fire bursts of
+//stats through IChannelEventHandler while one noisy channel floods its
+//queue. prints the latency of every channel; the quiet ones must lose
+//nothing whatever the noisy one does.
+TEST(ChannelManagerTest, MockChannelsWithBurstyEvents)
+{
+	const int channels = 32;
+	const int noisy = 5;
+	CChannelManager manager;
+	std::vector<uint64_t> delivered(CChannelManager::MAX_CHANNELS, 0);
+	manager.Subscribe(EVENT_JOINED, [&](ChannelHandle handle, const AgoraEvent&) { ++delivered[CChannelManager::GetSlot(handle)]; });
+	manager.Subscribe(EVENT_VIDEO_STATS, [&](ChannelHandle handle, const AgoraEvent&) { ++delivered[CChannelManager::GetSlot(handle)]; });
+	CUIThread ui(manager);
+
+	std::vector<std::unique_ptr<CTestChannelEventHandler>> handlers;
+	std::vector<std::unique_ptr<CMockChannel>> mocks;
+	for (int i = 0; i < channels; ++i) {
+		ChannelHandle handle = manager.AddChannel("channel" + std::to_string(i), i % 4 == 3);
+		ASSERT_NE(0u, handle);
+		handlers.emplace_back(new CTestChannelEventHandler(manager, handle));
+		//the noisy channel posts 4 queues worth at once, the rest 16 users every 10 ms.
+		if (i == noisy)
+			mocks.emplace_back(new CMockChannel(handlers.back().get(), CChannelManager::QUEUE_CAPACITY * 4, 10, 50));
+		else
+			mocks.emplace_back(new CMockChannel(handlers.back().get(), 16, 10, 50));
+	}
+	ui.Start();
+	for (auto& mock : mocks)
+		mock->Start();
+	for (auto& mock : mocks)
+		mock->Join();
+	//let the workers and the UI drain.
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	ui.Stop();
+	manager.Dispatch();
+
+	std::vector<ChannelView> views;
+	manager.GetChannelViews(views);
+	ASSERT_EQ((size_t)channels, views.size());
+	printf("%-10s %6s %8s %8s %9s %12s\n", "channel", "worker", "posted", "dropped", "delivered", "max latency");
+	for (int i = 0; i < channels; ++i) {
+		const ChannelView& view = views[i];
+		printf("%-10s %6s %8llu %8llu %9llu %9lld us\n", view.channelId.c_str(), view.worker ? "yes" : "no",
+			(unsigned long long)view.posted, (unsigned long long)view.dropped, (unsigned long long)view.delivered, (long long)view.maxLatency);
+		EXPECT_EQ(view.delivered, delivered[CChannelManager::GetSlot(view.handle)]);
+		if (i == noisy) {
+			EXPECT_GT(view.dropped, 0u);
+			continue;
+		}
+		EXPECT_EQ((uint64_t)mocks[i]->GetFired(), view.posted) << view.channelId;
+		EXPECT_EQ(0u, view.dropped) << view.channelId;
+		EXPECT_EQ(view.posted, view.delivered) << view.channelId;
+	}
+	manager.RemoveAll();
+}
@@ -0,0 +1,314 @@
+#include "Advanced/CrossChannel/ChannelRelayPlanner.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace {
+	enum RelayCall {
+		CALL_START,
+		CALL_UPDATE,
+		CALL_STOP,
+	};
+
+	//records the calls the planner makes instead of the engine, and
+	//answers them with ret.
+	class CMockRelay : public IChannelRelayApi
+	{
+	public:
+		struct Call {
+			RelayCall type;
+			std::vector<std::string> channels;
+		};
+
+		int StartRelay(const std::vector<RelayDestination>& destinations) override { return Record(CALL_START, destinations); }
+		int UpdateRelay(const std::vector<RelayDestination>& destinations) override { return Record(CALL_UPDATE, destinations); }
+		int StopRelay() override { return Record(CALL_STOP, std::vector<RelayDestination>()); }
+
+		//the calls since the last Take.
+		std::vector<Call> Take()
+		{
+			std::vector<Call> calls;
+			calls.swap(m_calls);
+			return calls;
+		}
+
+		int ret = 0;
+
+	private:
+		int Record(RelayCall type, const std::vector<RelayDestination>& destinations)
+		{
+			Call call;
+			call.type = type;
+			for (const RelayDestination& destination : destinations)
+				call.channels.push_back(destination.channel);
+			m_calls.push_back(call);
+			return type == CALL_STOP ? 0 : ret;
+		}
+
+		std::vector<Call> m_calls;
+	};
+
+	RelayDestination Destination(const std::string& channel, int priority = 0, const std::string& token = "")
+	{
+		RelayDestination destination;
+		destination.channel = channel;
+		destination.priority = priority;
+		destination.token = token;
+		return destination;
+	}
+
+	//no jitter, so the backoff delays are exact.
+	class CRelayPlannerFixture : public ::testing::Test
+	{
+	protected:
+		CRelayPlannerFixture() : m_planner(&m_relay)
+		{
+			RelayPlannerConfig config;
+			config.backoffJitter = 0;
+			m_planner.SetConfig(config);
+			m_planner.SetEnabled(true);
+		}
+
+		//one call of the given type with the given channels, in any order.
+		void ExpectCall(RelayCall type, std::vector<std::string> channels)
+		{
+			std::vector<CMockRelay::Call> calls = m_relay.Take();
+			ASSERT_EQ(1u, calls.size());
+			EXPECT_EQ(type, calls[0].type);
+			std::sort(channels.begin(), channels.end());
+			std::sort(calls[0].channels.begin(), calls[0].channels.end());
+			EXPECT_EQ(channels, calls[0].channels);
+		}
+
+		void ExpectNoCall(int64_t nowMs)
+		{
+			EXPECT_FALSE(m_planner.Tick(nowMs));
+			EXPECT_TRUE(m_relay.Take().empty());
+		}
+
+		RELAY_DESTINATION_STATE StateOf(const std::string& channel, int64_t nowMs)
+		{
+			for (const RelayDestinationStatus& status : m_planner.GetStatus(nowMs)) {
+				if (status.destination.channel == channel)
+					return status.state;
+			}
+			ADD_FAILURE() << channel << " is not wanted";
+			return RELAY_DESTINATION_WAITING;
+		}
+
+		//starts the relay on the channels and has it acknowledged at nowMs.
+		void StartRunning(std::vector<std::string> channels, int64_t nowMs)
+		{
+			for (const std::string& channel : channels)
+				m_planner.SetDestination(Destination(channel));
+			ASSERT_TRUE(m_planner.Tick(nowMs));
+			ExpectCall(CALL_START, channels);
+			m_planner.OnRelayRunning(nowMs);
+			ASSERT_TRUE(m_planner.IsRunning());
+		}
+
+		CMockRelay m_relay;
+		CChannelRelayPlanner m_planner;
+	};
+}
+
+TEST_F(CRelayPlannerFixture, StartsOnceAndWaitsForTheAnswer)
+{
+	ExpectNoCall(0);
+	m_planner.SetDestination(Destination("a"));
+	m_planner.SetDestination(Destination("b"));
+	ASSERT_TRUE(m_planner.Tick(0));
+	ExpectCall(CALL_START, { "a", "b" });
+	EXPECT_EQ(RELAY_DESTINATION_PENDING, StateOf("a", 0));
+	ExpectNoCall(100);
+	m_planner.OnRelayRunning(200);
+	EXPECT_TRUE(m_planner.IsRunning());
+	EXPECT_EQ(2u, m_planner.GetActive().size());
+	EXPECT_EQ(RELAY_DESTINATION_ACTIVE, StateOf("b", 200));
+	ExpectNoCall(300);
+}
+
+TEST_F(CRelayPlannerFixture, FoldsABurstOfChangesIntoOneUpdate)
+{
+	StartRunning({ "a" }, 0);
+	m_planner.SetDestination(Destination("b"));
+	ASSERT_TRUE(m_planner.Tick(100));
+	ExpectCall(CALL_UPDATE, { "a", "b" });
+	//edits while the update is out wait for its answer.
+	m_planner.SetDestination(Destination("c"));
+	m_planner.SetDestination(Destination("d"));
+	m_planner.RemoveDestination("a");
+	ExpectNoCall(150);
+	m_planner.OnUpdateAccepted(200);
+	ASSERT_TRUE(m_planner.Tick(200));
+	ExpectCall(CALL_UPDATE, { "b", "c", "d" });
+	m_planner.OnUpdateAccepted(300);
+	ExpectNoCall(300);
+	EXPECT_EQ(2u, m_planner.GetStats().updates);
+}
+
+TEST_F(CRelayPlannerFixture, RelaysTheHighestPrioritiesThatFit)
+{
+	m_planner.SetDestination(Destination("low", 0));
+	m_planner.SetDestination(Destination("high", 5));
+	m_planner.SetDestination(Destination("first", 1));
+	m_planner.SetDestination(Destination("second", 1));
+	m_planner.SetDestination(Destination("third", 1));
+	ASSERT_TRUE(m_planner.Tick(0));
+	ExpectCall(CALL_START, { "high", "first", "second", "third" });
+	m_planner.OnRelayRunning(0);
+	EXPECT_EQ(RELAY_DESTINATION_WAITING, StateOf("low", 0));
+	//a higher priority pushes the lowest, newest one out.
+	m_planner.SetDestination(Destination("low", 3));
+	ASSERT_TRUE(m_planner.Tick(100));
+	ExpectCall(CALL_UPDATE, { "high", "low", "first", "second" });
+}
+
+TEST_F(CRelayPlannerFixture, BacksOffARefusedUpdate)
+{
+	StartRunning({ "a" }, 0);
+	m_planner.SetDestination(Destination("b"));
+	ASSERT_TRUE(m_planner.Tick(100));
+	ExpectCall(CALL_UPDATE, { "a", "b" });
+	m_planner.OnUpdateRefused(100);
+	//the relay keeps what it had, and retries after 1 s, then 2 s.
+	EXPECT_TRUE(m_planner.IsRunning());
+	EXPECT_EQ(1u, m_planner.GetActive().size());
+	ExpectNoCall(1099);
+	ASSERT_TRUE(m_planner.Tick(1100));
+	ExpectCall(CALL_UPDATE, { "a", "b" });
+	m_planner.OnUpdateRefused(1100);
+	ExpectNoCall(3099);
+	ASSERT_TRUE(m_planner.Tick(3100));
+	ExpectCall(CALL_UPDATE, { "a", "b" });
+	m_planner.OnUpdateAccepted(3100);
+	EXPECT_EQ(2u, m_planner.GetStats().refused);
+	EXPECT_EQ(2u, m_planner.GetActive().size());
+}
+
+TEST_F(CRelayPlannerFixture, RetriesAStartTheApiRejected)
+{
+	m_relay.ret = -1;
+	m_planner.SetDestination(Destination("a"));
+	ASSERT_TRUE(m_planner.Tick(0));
+	ExpectCall(CALL_START, { "a" });
+	EXPECT_FALSE(m_planner.IsRunning());
+	m_relay.ret = 0;
+	ExpectNoCall(999);
+	ASSERT_TRUE(m_planner.Tick(1000));
+	ExpectCall(CALL_START, { "a" });
+}
+
+TEST_F(CRelayPlannerFixture, StopsAStartThatTimedOut)
+{
+	m_planner.SetDestination(Destination("a"));
+	ASSERT_TRUE(m_planner.Tick(0));
+	ExpectCall(CALL_START, { "a" });
+	ExpectNoCall(9999);
+	ASSERT_TRUE(m_planner.Tick(10000));
+	ExpectCall(CALL_STOP, {});
+	EXPECT_EQ(1u, m_planner.GetStats().timeouts);
+	//a late answer to the abandoned start is ignored.
+	m_planner.OnRelayRunning(10500);
+	EXPECT_FALSE(m_planner.IsRunning());
+	ExpectNoCall(10999);
+	ASSERT_TRUE(m_planner.Tick(11000));
+	ExpectCall(CALL_START, { "a" });
+}
+
+TEST_F(CRelayPlannerFixture, BlamesTheOneDestinationJustAdded)
+{
+	StartRunning({ "a" }, 0);
+	//past the probation, a is trusted.
+	ExpectNoCall(6000);
+	m_planner.SetDestination(Destination("b"));
+	ASSERT_TRUE(m_planner.Tick(6000));
+	ExpectCall(CALL_UPDATE, { "a", "b" });
+	m_planner.OnRelayFailed(true, 6100);
+	ExpectCall(CALL_STOP, {});
+	EXPECT_EQ(RELAY_DESTINATION_BACKOFF, StateOf("b", 6100));
+	//a goes on right away, b after its backoff.
+	ASSERT_TRUE(m_planner.Tick(6100));
+	ExpectCall(CALL_START, { "a" });
+	m_planner.OnRelayRunning(6200);
+	ExpectNoCall(7099);
+	ASSERT_TRUE(m_planner.Tick(7100));
+	ExpectCall(CALL_UPDATE, { "a", "b" });
+	EXPECT_EQ(1u, m_planner.GetStats().destinationBackoffs);
+}
+
+TEST_F(CRelayPlannerFixture, FindsTheCulpritAmongDestinationsAddedTogether)
+{
+	m_planner.SetDestination(Destination("a"));
+	m_planner.SetDestination(Destination("b"));
+	m_planner.SetDestination(Destination("c"));
+	ASSERT_TRUE(m_planner.Tick(0));
+	ExpectCall(CALL_START, { "a", "b", "c" });
+	m_planner.OnRelayFailed(true, 100);
+	ExpectCall(CALL_STOP, {});
+	EXPECT_EQ(RELAY_DESTINATION_SUSPECT, StateOf("c", 100));
+	//the suspects come back one per call.
+	ASSERT_TRUE(m_planner.Tick(100));
+	ExpectCall(CALL_START, { "a" });
+	m_planner.OnRelayRunning(200);
+	ASSERT_TRUE(m_planner.Tick(200));
+	ExpectCall(CALL_UPDATE, { "a", "b" });
+	m_planner.OnUpdateAccepted(300);
+	ASSERT_TRUE(m_planner.Tick(300));
+	ExpectCall(CALL_UPDATE, { "a", "b", "c" });
+	//c was added last, it alone goes into backoff.
+	m_planner.OnRelayFailed(true, 400);
+	ExpectCall(CALL_STOP, {});
+	EXPECT_EQ(RELAY_DESTINATION_BACKOFF, StateOf("c", 400));
+	EXPECT_NE(RELAY_DESTINATION_BACKOFF, StateOf("a", 400));
+	EXPECT_NE(RELAY_DESTINATION_BACKOFF, StateOf("b", 400));
+	ASSERT_TRUE(m_planner.Tick(400));
+	ExpectCall(CALL_START, { "a" });
+}
+
+TEST_F(CRelayPlannerFixture, RetriesARelayFailureWithoutACulprit)
+{
+	StartRunning({ "a", "b" }, 0);
+	m_planner.OnRelayFailed(false, 100);
+	ExpectCall(CALL_STOP, {});
+	EXPECT_FALSE(m_planner.IsRunning());
+	ExpectNoCall(1099);
+	ASSERT_TRUE(m_planner.Tick(1100));
+	ExpectCall(CALL_START, { "a", "b" });
+}
+
+TEST_F(CRelayPlannerFixture, ANewTokenEndsTheBackoff)
+{
+	StartRunning({ "a" }, 0);
+	ExpectNoCall(6000);
+	m_planner.SetDestination(Destination("b", 0, "old"));
+	ASSERT_TRUE(m_planner.Tick(6000));
+	ExpectCall(CALL_UPDATE, { "a", "b" });
+	m_planner.OnRelayFailed(true, 6000);
+	ExpectCall(CALL_STOP, {});
+	ASSERT_TRUE(m_planner.Tick(6000));
+	ExpectCall(CALL_START, { "a" });
+	m_planner.OnRelayRunning(6000);
+	m_planner.SetDestination(Destination("b", 0, "new"));
+	ASSERT_TRUE(m_planner.Tick(6100));
+	ExpectCall(CALL_UPDATE, { "a", "b" });
+}
+
+TEST_F(CRelayPlannerFixture, StopsWhenDisabledOrEmpty)
+{
+	StartRunning({ "a" }, 0);
+	m_planner.SetEnabled(false);
+	ASSERT_TRUE(m_planner.Tick(100));
+	ExpectCall(CALL_STOP, {});
+	ExpectNoCall(200);
+	m_planner.SetEnabled(true);
+	ASSERT_TRUE(m_planner.Tick(300));
+	ExpectCall(CALL_START, { "a" });
+	m_planner.OnRelayRunning(300);
+	m_planner.RemoveDestination("a");
+	ASSERT_TRUE(m_planner.Tick(400));
+	ExpectCall(CALL_STOP, {});
+	EXPECT_FALSE(m_planner.IsRunning());
+	EXPECT_TRUE(m_planner.GetActive().empty());
+}
@@ -0,0 +1,180 @@
+#include "Advanced/MediaIOCustomVideoCaptrue/DirtyRegionDetector.h"
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+namespace {
+	//a contiguous I420 frame.
+	struct Frame {
+		int width, height;
+		std::vector<uint8_t> data;
+
+		Frame(int w, int h) : width(w), height(h), data((size_t)w * h + 2 * (size_t)ChromaWidth(w) * ((h + 1) / 2))
+		{
+			std::mt19937 random(w * 31 + h);
+			for (uint8_t& value : data)
+				value = (uint8_t)random();
+		}
+		static int ChromaWidth(int w) { return (w + 1) / 2; }
+		uint8_t& Y(int x, int y) { return data[(size_t)y * width + x]; }
+		uint8_t& U(int x, int y) { return data[(size_t)width * height + (size_t)y * ChromaWidth(width) + x]; }
+		uint8_t& V(int x, int y)
+		{
+			return data[(size_t)width * height + (size_t)ChromaWidth(width) * ((height + 1) / 2) + (size_t)y * ChromaWidth(width) + x];
+		}
+	};
+
+	bool SameRect(const DirtyRect& rect, int x, int y, int width, int height)
+	{
+		return rect.x == x && rect.y == y && rect.width == width && rect.height == height;
+	}
+}
+
+TEST(DirtyRegionDetectorTest, SimdAndScalarHashesMatch)
+{
+	std::mt19937 random(3);
+	std::vector<uint8_t> plane(64 * 64);
+	for (int i = 0; i < 1000; ++i) {
+		for (uint8_t& value : plane)
+			value = (uint8_t)random();
+		int offset = random() % 16;
+		const uint8_t* y = plane.data() + offset;
+		const uint8_t* u = plane.data() + 40 * 64 + offset / 2;
+		const uint8_t* v = plane.data() + 50 * 64 + offset;
+		ASSERT_EQ(CDirtyRegionDetector::HashBlockScalar(y, 64, u, 64, v, 64),
+			CDirtyRegionDetector::HashBlock(y, 64, u, 64, v, 64)) << i;
+	}
+}
+
+TEST(DirtyRegionDetectorTest, FirstFrameIsAllDirtyAndAStillFrameIsClean)
+{
+	Frame frame(640, 360);
+	CDirtyRegionDetector detector;
+	detector.Configure(frame.width, frame.height);
+	EXPECT_EQ(40 * 23, detector.Detect(frame.data.data()));
+	EXPECT_EQ(1u, detector.GetGeneration());
+	EXPECT_DOUBLE_EQ(1.0, detector.GetChangedRatio());
+	ASSERT_EQ(1u, detector.GetDirtyRects().size());
+	EXPECT_TRUE(SameRect(detector.GetDirtyRects()[0], 0, 0, 640, 360));
+
+	EXPECT_EQ(0, detector.Detect(frame.data.data()));
+	EXPECT_EQ(0, detector.GetChangedArea());
+	EXPECT_TRUE(detector.GetDirtyRects().empty());
+
+	//configuring again forgets the hashes.
+	detector.Configure(frame.width, frame.height);
+	EXPECT_EQ(40 * 23, detector.Detect(frame.data.data()));
+}
+
+TEST(DirtyRegionDetectorTest, SinglePixelAndChromaOnlyChangesDirtyOneBlock)
+{
+	Frame frame(640, 360);
+	CDirtyRegionDetector detector;
+	detector.Configure(frame.width, frame.height);
+	detector.Detect(frame.data.data());
+
+	++frame.Y(100, 50);
+	EXPECT_EQ(1, detector.Detect(frame.data.data()));
+	ASSERT_EQ(1u, detector.GetDirtyRects().size());
+	EXPECT_TRUE(SameRect(detector.GetDirtyRects()[0], 96, 48, 16, 16));
+	EXPECT_EQ(256, detector.GetChangedArea());
+
+	++frame.U(300, 170);
+	EXPECT_EQ(1, detector.Detect(frame.data.data()));
+	EXPECT_TRUE(SameRect(detector.GetDirtyRects()[0], 592, 336, 16, 16));
+
+	++frame.V(0, 0);
+	EXPECT_EQ(1, detector.Detect(frame.data.data()));
+	EXPECT_TRUE(SameRect(detector.GetDirtyRects()[0], 0, 0, 16, 16));
+}
+
+TEST(DirtyRegionDetectorTest, EdgeBlocksOnlyCountPixelsInsideTheFrame)
+{
+	//odd sizes: the last column of blocks is 5 wide, the last row 9 high.
+	Frame frame(101, 41);
+	CDirtyRegionDetector detector;
+	detector.Configure(frame.width, frame.height);
+	detector.Detect(frame.data.data());
+	++frame.Y(100, 40);
+	EXPECT_EQ(1, detector.Detect(frame.data.data()));
+	EXPECT_TRUE(SameRect(detector.GetDirtyRects()[0], 96, 32, 5, 9));
+	EXPECT_EQ(45, detector.GetChangedArea());
+	++frame.U(50, 20);
+	EXPECT_EQ(1, detector.Detect(frame.data.data()));
+	EXPECT_TRUE(SameRect(detector.GetDirtyRects()[0], 96, 32, 5, 9));
+}
+
+TEST(DirtyRegionDetectorTest, BlocksMergeIntoRectangles)
+{
+	Frame frame(320, 320);
+	CDirtyRegionDetector detector;
+	detector.Configure(frame.width, frame.height);
+	detector.Detect(frame.data.data());
+	//a 3x4 block area, and apart from it an L: a column of two blocks on a row of five.
+	for (int y = 0; y < 64; ++y) {
+		for (int x = 16; x < 64; ++x)
+			++frame.Y(x, y);
+	}
+	for (int y = 160; y < 192; ++y)
+		++frame.Y(200, y);
+	for (int x = 200; x < 260; ++x)
+		++frame.Y(x, 200);
+	EXPECT_EQ(12 + 2 + 5, detector.Detect(frame.data.data()));
+	const std::vector<DirtyRect>& rects = detector.GetDirtyRects();
+	ASSERT_EQ(3u, rects.size());
+	EXPECT_TRUE(SameRect(rects[0], 16, 0, 48, 64));
+	EXPECT_TRUE(SameRect(rects[1], 192, 160, 16, 32));
+	EXPECT_TRUE(SameRect(rects[2], 192, 192, 80, 16));
+}
+
+TEST(DirtyRegionDetectorTest, CollectsWhatChangedSinceAnEarlierGeneration)
+{
+	Frame frame(256, 256);
+	CDirtyRegionDetector detector;
+	detector.Configure(frame.width, frame.height);
+	detector.Detect(frame.data.data());
+	uint32_t seen = detector.GetGeneration();
+	++frame.Y(0, 0);
+	detector.Detect(frame.data.data());
+	++frame.Y(255, 255);
+	detector.Detect(frame.data.data());
+	detector.Detect(frame.data.data());
+	EXPECT_TRUE(detector.GetDirtyRects().empty());
+
+	std::vector<DirtyRect> rects;
+	detector.CollectDirtySince(seen, rects);
+	ASSERT_EQ(2u, rects.size());
+	EXPECT_TRUE(SameRect(rects[0], 0, 0, 16, 16));
+	EXPECT_TRUE(SameRect(rects[1], 240, 240, 16, 16));
+	detector.CollectDirtySince(seen + 1, rects);
+	ASSERT_EQ(1u, rects.size());
+	EXPECT_TRUE(SameRect(rects[0], 240, 240, 16, 16));
+	detector.CollectDirtySince(detector.GetGeneration(), rects);
+	EXPECT_TRUE(rects.empty());
+}
+
+TEST(DirtyRegionDetectorTest, PaddedPlanesHashLikeContiguousOnes)
+{
+	Frame frame(200, 120);
+	const int yStride = 256, cStride = 128;
+	std::vector<uint8_t> y((size_t)yStride * 120, 0xAA), u((size_t)cStride * 60, 0x55), v((size_t)cStride * 60, 0x33);
+	for (int row = 0; row < 120; ++row) {
+		for (int x = 0; x < 200; ++x)
+			y[(size_t)row * yStride + x] = frame.Y(x, row);
+	}
+	for (int row = 0; row < 60; ++row) {
+		for (int x = 0; x < 100; ++x) {
+			u[(size_t)row * cStride + x] = frame.U(x, row);
+			v[(size_t)row * cStride + x] = frame.V(x, row);
+		}
+	}
+	CDirtyRegionDetector detector;
+	detector.Configure(frame.width, frame.height);
+	detector.Detect(frame.data.data());
+	//the same picture with padding: nothing changed, the padding is not hashed.
+	EXPECT_EQ(0, detector.Detect(y.data(), yStride, u.data(), cStride, v.data(), cStride));
+	u[(size_t)59 * cStride + 127] = 0;
+	EXPECT_EQ(0, detector.Detect(y.data(), yStride, u.data(), cStride, v.data(), cStride));
+	y[(size_t)119 * yStride + 199] ^= 1;
+	EXPECT_EQ(1, detector.Detect(y.data(), yStride, u.data(), cStride, v.data(), cStride));
+}
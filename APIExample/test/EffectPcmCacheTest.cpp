@@ -0,0 +1,183 @@
+#include "Advanced/AudioEffect/EffectPcmCache.h"
+#include <gtest/gtest.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+	const int RATE = 48000;
+	//frames of every test clip and the size of its PCM file.
+	const int FRAMES = 4800;
+	const uint64_t FILE_BYTES = 64 + FRAMES * 2 * sizeof(int16_t);
+
+	//a temp directory of empty source files and a cache directory,
+	//removed again at the end. the decoder makes up the samples.
+	class CCacheFixture : public ::testing::Test
+	{
+	protected:
+		void SetUp() override
+		{
+			char dir[] = "/tmp/EffectPcmCacheTestXXXXXX";
+			ASSERT_NE(nullptr, mkdtemp(dir));
+			m_dir = dir;
+			m_cacheDir = m_dir + "/cache";
+			m_cache.SetDecoder([this](const std::string& path, EffectPcm& pcm) {
+				++m_decodes;
+				if (path.find("broken") != std::string::npos)
+					return false;
+				pcm.sampleRate = RATE;
+				pcm.channels = 2;
+				pcm.samples.assign(FRAMES * 2, 1000);
+				return true;
+			});
+		}
+		void TearDown() override
+		{
+			m_cache.Close();
+			for (const std::string& name : List(m_cacheDir))
+				remove((m_cacheDir + "/" + name).c_str());
+			rmdir(m_cacheDir.c_str());
+			for (const std::string& name : List(m_dir))
+				remove((m_dir + "/" + name).c_str());
+			rmdir(m_dir.c_str());
+		}
+
+		std::string Source(const char* name)
+		{
+			std::string path = m_dir + "/" + name;
+			FILE* file = fopen(path.c_str(), "wb");
+			if (file)
+				fclose(file);
+			return path;
+		}
+		static std::vector<std::string> List(const std::string& directory)
+		{
+			std::vector<std::string> names;
+			if (DIR* dir = opendir(directory.c_str())) {
+				while (dirent* entry = readdir(dir)) {
+					std::string name = entry->d_name;
+					if (name != "." && name != "..")
+						names.push_back(name);
+				}
+				closedir(dir);
+			}
+			return names;
+		}
+
+		std::string m_dir;
+		std::string m_cacheDir;
+		std::atomic<int> m_decodes{ 0 };
+		CEffectPcmCache m_cache;
+	};
+}
+
+TEST_F(CCacheFixture, DecodesOnceAndRemapsAfterReopening)
+{
+	ASSERT_TRUE(m_cache.Open(m_cacheDir, RATE, 2));
+	std::string source = Source("a.wav");
+	bool hit = true;
+	std::shared_ptr<const CEffectClip> clip = m_cache.Get(source, &hit);
+	ASSERT_NE(nullptr, clip);
+	EXPECT_FALSE(hit);
+	EXPECT_EQ(FRAMES, clip->GetFrames());
+	EXPECT_TRUE(clip->IsMapped());
+	EXPECT_EQ(1000, clip->GetSamples()[0]);
+	EXPECT_EQ(clip, m_cache.Get(source, &hit));
+	EXPECT_TRUE(hit);
+
+	m_cache.Close();
+	ASSERT_TRUE(m_cache.Open(m_cacheDir, RATE, 2));
+	ASSERT_NE(nullptr, m_cache.Get(source));
+	EffectCacheStats stats = m_cache.GetStats();
+	EXPECT_EQ(1u, stats.diskLoads);
+	EXPECT_EQ(0u, stats.decodes);
+	EXPECT_EQ(1, m_decodes.load());
+	EXPECT_EQ(FILE_BYTES, stats.diskBytes);
+}
+
+TEST_F(CCacheFixture, GetAsyncLoadsOnTheWorker)
+{
+	std::mutex mutex;
+	std::condition_variable ready;
+	std::vector<std::pair<std::string, bool>> loads;
+	m_cache.SetReadyCallback([&](const std::string& path, bool loaded) {
+		std::lock_guard<std::mutex> lock(mutex);
+		loads.emplace_back(path, loaded);
+		ready.notify_all();
+	});
+	ASSERT_TRUE(m_cache.Open(m_cacheDir, RATE, 2));
+	std::string source = Source("a.wav");
+	std::string broken = Source("broken.wav");
+	bool hit = true;
+	EXPECT_EQ(nullptr, m_cache.GetAsync(source, &hit));
+	EXPECT_FALSE(hit);
+	//a second miss while it loads queues nothing more.
+	EXPECT_EQ(nullptr, m_cache.GetAsync(source));
+	EXPECT_EQ(nullptr, m_cache.GetAsync(broken));
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		ASSERT_TRUE(ready.wait_for(lock, std::chrono::seconds(5), [&]() { return loads.size() >= 2; }));
+	}
+	ASSERT_EQ(2u, loads.size());
+	EXPECT_EQ(source, loads[0].first);
+	EXPECT_TRUE(loads[0].second);
+	EXPECT_EQ(broken, loads[1].first);
+	EXPECT_FALSE(loads[1].second);
+
+	EXPECT_NE(nullptr, m_cache.Find(source));
+	EXPECT_EQ(nullptr, m_cache.Find(broken));
+	EXPECT_NE(nullptr, m_cache.GetAsync(source, &hit));
+	EXPECT_TRUE(hit);
+	EffectCacheStats stats = m_cache.GetStats();
+	EXPECT_EQ(1u, stats.hits);
+	EXPECT_EQ(3u, stats.misses);
+	EXPECT_EQ(1u, stats.decodes);
+	EXPECT_EQ(1u, stats.failures);
+	EXPECT_EQ(2, m_decodes.load());
+}
+
+TEST_F(CCacheFixture, PrunesTheDiskToItsBudget)
+{
+	const uint64_t budget = FILE_BYTES * 5 / 2;
+	ASSERT_TRUE(m_cache.Open(m_cacheDir, RATE, 2, CEffectPcmCache::DEFAULT_MAX_BYTES, budget));
+	const char* names[] = { "a.wav", "b.wav", "c.wav", "d.wav" };
+	for (const char* name : names) {
+		std::string source = Source(name);
+		ASSERT_NE(nullptr, m_cache.Get(source));
+		//unloaded clips are no longer mapped, their files can go.
+		m_cache.Unload(source);
+	}
+	EffectCacheStats stats = m_cache.GetStats();
+	EXPECT_LE(stats.diskBytes, budget);
+	EXPECT_EQ(2u, stats.diskDeletes);
+	EXPECT_EQ(2u, List(m_cacheDir).size());
+
+	//a mapped clip is never deleted, even over budget.
+	m_cache.Close();
+	ASSERT_TRUE(m_cache.Open(m_cacheDir, RATE, 2, CEffectPcmCache::DEFAULT_MAX_BYTES, FILE_BYTES / 2));
+	EXPECT_EQ(0u, m_cache.GetStats().diskBytes);
+	std::shared_ptr<const CEffectClip> clip = m_cache.Get(Source("e.wav"));
+	ASSERT_NE(nullptr, clip);
+	EXPECT_EQ(FILE_BYTES, m_cache.GetStats().diskBytes);
+	EXPECT_EQ(1000, clip->GetSamples()[FRAMES * 2 - 1]);
+}
+
+TEST_F(CCacheFixture, OpenRemovesInterruptedWrites)
+{
+	ASSERT_EQ(0, mkdir(m_cacheDir.c_str(), 0755));
+	std::string temp = m_cacheDir + "/0123456789abcdef.pcm.tmp";
+	FILE* file = fopen(temp.c_str(), "wb");
+	ASSERT_NE(nullptr, file);
+	fputs("half a clip", file);
+	fclose(file);
+	ASSERT_TRUE(m_cache.Open(m_cacheDir, RATE, 2));
+	EXPECT_NE(0, access(temp.c_str(), F_OK));
+}
@@ -0,0 +1,296 @@
+#include "Advanced/AudioEffect/EffectVoiceMixer.h"
+#include <gtest/gtest.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+	const int RATE = 48000;
+	const int FRAME = RATE / 100;
+
+	//clips of one constant sample value, which the cache "decodes" from
+	//empty files in a temp directory removed again at the end.
+	class CClips
+	{
+	public:
+		CClips()
+		{
+			char dir[] = "/tmp/EffectVoiceMixerTestXXXXXX";
+			if (mkdtemp(dir))
+				m_dir = dir;
+			m_cache.SetDecoder([this](const std::string& path, EffectPcm& pcm) {
+				auto it = m_clips.find(path);
+				if (it == m_clips.end())
+					return false;
+				pcm.sampleRate = RATE;
+				pcm.channels = 2;
+				pcm.samples.assign((size_t)it->second.second * 2, it->second.first);
+				return true;
+			});
+			m_cache.Open(m_dir + "/cache", RATE, 2);
+		}
+		~CClips()
+		{
+			m_cache.Close();
+			RemoveAll(m_dir + "/cache");
+			RemoveAll(m_dir);
+		}
+
+		std::shared_ptr<const CEffectClip> Make(int16_t value, int frames)
+		{
+			std::string path = m_dir + "/" + std::to_string(m_clips.size()) + ".wav";
+			FILE* file = fopen(path.c_str(), "wb");
+			if (file)
+				fclose(file);
+			m_clips[path] = std::make_pair(value, frames);
+			return m_cache.Get(path);
+		}
+
+	private:
+		static void RemoveAll(const std::string& directory)
+		{
+			if (DIR* dir = opendir(directory.c_str())) {
+				while (dirent* entry = readdir(dir))
+					remove((directory + "/" + entry->d_name).c_str());
+				closedir(dir);
+			}
+			rmdir(directory.c_str());
+		}
+
+		std::string m_dir;
+		std::map<std::string, std::pair<int16_t, int>> m_clips;
+		CEffectPcmCache m_cache;
+	};
+
+	std::vector<int16_t> MixFrame(CEffectVoiceMixer& mixer, int channels, EffectMixTarget target)
+	{
+		std::vector<int16_t> frame((size_t)FRAME * channels);
+		mixer.Mix(frame.data(), FRAME, channels, RATE, target);
+		return frame;
+	}
+}
+
+TEST(EffectVoiceMixerTest, MixesIntoBothTargets)
+{
+	CClips clips;
+	std::shared_ptr<const CEffectClip> clip = clips.Make(1000, FRAME * 10);
+	ASSERT_NE(nullptr, clip);
+	CEffectVoiceMixer mixer;
+	ASSERT_TRUE(mixer.Play(1, clip, EffectVoiceParams(), CEffectVoiceMixer::NowNs()));
+	std::vector<int16_t> playback = MixFrame(mixer, 2, EFFECT_MIX_PLAYBACK);
+	EXPECT_EQ(1000, playback[0]);
+	EXPECT_EQ(1000, playback[FRAME * 2 - 1]);
+	std::vector<int16_t> record = MixFrame(mixer, 1, EFFECT_MIX_RECORD);
+	EXPECT_EQ(1000, record[0]);
+	EffectMixerStats stats = mixer.GetStats();
+	EXPECT_EQ(1u, stats.started);
+	//the first sample counts once, whichever target wrote it.
+	EXPECT_EQ(1u, stats.firstSamples);
+	EXPECT_GT(stats.firstSampleNsMax, 0);
+	EXPECT_EQ(1, stats.active);
+}
+
+TEST(EffectVoiceMixerTest, RecordOnlyGetsPublishedVoices)
+{
+	CClips clips;
+	CEffectVoiceMixer mixer;
+	EffectVoiceParams params;
+	params.publish = false;
+	params.pan = 1.f;
+	ASSERT_TRUE(mixer.Play(1, clips.Make(1000, FRAME * 10), params, CEffectVoiceMixer::NowNs()));
+	std::vector<int16_t> playback = MixFrame(mixer, 2, EFFECT_MIX_PLAYBACK);
+	EXPECT_EQ(0, playback[0]);
+	EXPECT_EQ(1000, playback[1]);
+	std::vector<int16_t> record = MixFrame(mixer, 2, EFFECT_MIX_RECORD);
+	EXPECT_EQ(std::vector<int16_t>(FRAME * 2), record);
+}
+
+TEST(EffectVoiceMixerTest, FinishesOnceEveryLiveTargetReachedItsEnd)
+{
+	CClips clips;
+	CEffectVoiceMixer mixer;
+	//the record target is live before the play.
+	MixFrame(mixer, 1, EFFECT_MIX_RECORD);
+	ASSERT_TRUE(mixer.Play(1, clips.Make(1000, FRAME), EffectVoiceParams(), CEffectVoiceMixer::NowNs()));
+	MixFrame(mixer, 2, EFFECT_MIX_PLAYBACK);
+	EXPECT_EQ(1, mixer.GetStats().active);
+	MixFrame(mixer, 1, EFFECT_MIX_RECORD);
+	EffectMixerStats stats = mixer.GetStats();
+	EXPECT_EQ(0, stats.active);
+	EXPECT_EQ(1u, stats.finished);
+	//nothing left to mix.
+	EXPECT_EQ(std::vector<int16_t>(FRAME * 2), MixFrame(mixer, 2, EFFECT_MIX_PLAYBACK));
+}
+
+TEST(EffectVoiceMixerTest, LoopsThenEnds)
+{
+	CClips clips;
+	CEffectVoiceMixer mixer;
+	EffectVoiceParams params;
+	params.loops = 2;
+	ASSERT_TRUE(mixer.Play(1, clips.Make(1000, FRAME / 2), params, CEffectVoiceMixer::NowNs()));
+	//three plays of half a frame.
+	std::vector<int16_t> first = MixFrame(mixer, 2, EFFECT_MIX_PLAYBACK);
+	EXPECT_EQ(1000, first[FRAME * 2 - 1]);
+	std::vector<int16_t> second = MixFrame(mixer, 2, EFFECT_MIX_PLAYBACK);
+	EXPECT_EQ(1000, second[FRAME - 1]);
+	EXPECT_EQ(0, second[FRAME]);
+	EXPECT_EQ(1u, mixer.GetStats().finished);
+}
+
+TEST(EffectVoiceMixerTest, StolenVoiceFadesOutWithinAFrame)
+{
+	CClips clips;
+	CEffectVoiceMixer mixer;
+	mixer.SetPolyphony(1, 1);
+	EffectVoiceParams params;
+	params.pan = -1.f;
+	ASSERT_TRUE(mixer.Play(1, clips.Make(8000, FRAME * 10), params, CEffectVoiceMixer::NowNs()));
+	MixFrame(mixer, 2, EFFECT_MIX_PLAYBACK);
+	//silent, so what is heard is the fade.
+	ASSERT_TRUE(mixer.Play(2, clips.Make(0, FRAME * 10), params, CEffectVoiceMixer::NowNs()));
+	EXPECT_EQ(1u, mixer.GetStats().stolen);
+	std::vector<int16_t> frame = MixFrame(mixer, 2, EFFECT_MIX_PLAYBACK);
+	const int fade = RATE * CEffectVoiceMixer::STEAL_FADE_MS / 1000;
+	EXPECT_EQ(8000, frame[0]);
+	for (int i = 1; i < fade; ++i)
+		EXPECT_LE(frame[i * 2], frame[(i - 1) * 2]) << i;
+	EXPECT_NEAR(4000, frame[fade / 2 * 2], 50);
+	EXPECT_EQ(0, frame[fade * 2]);
+	EXPECT_EQ(std::vector<int16_t>(FRAME * 2), MixFrame(mixer, 2, EFFECT_MIX_PLAYBACK));
+}
+
+TEST(EffectVoiceMixerTest, DropsPlaysBelowEveryVoicesPriority)
+{
+	CClips clips;
+	std::shared_ptr<const CEffectClip> clip = clips.Make(1000, FRAME * 10);
+	CEffectVoiceMixer mixer;
+	mixer.SetPolyphony(1, 4);
+	EffectVoiceParams params;
+	params.priority = 5;
+	ASSERT_TRUE(mixer.Play(1, clip, params, CEffectVoiceMixer::NowNs()));
+	params.priority = 1;
+	EXPECT_FALSE(mixer.Play(2, clip, params, CEffectVoiceMixer::NowNs()));
+	EffectMixerStats stats = mixer.GetStats();
+	EXPECT_EQ(1u, stats.dropped);
+	EXPECT_EQ(1, stats.active);
+}
+
+TEST(EffectVoiceMixerTest, PauseKeepsThePosition)
+{
+	CClips clips;
+	CEffectVoiceMixer mixer;
+	ASSERT_TRUE(mixer.Play(7, clips.Make(1000, FRAME * 2), EffectVoiceParams(), CEffectVoiceMixer::NowNs()));
+	MixFrame(mixer, 2, EFFECT_MIX_PLAYBACK);
+	mixer.Pause(7);
+	for (int i = 0; i < 3; ++i)
+		EXPECT_EQ(std::vector<int16_t>(FRAME * 2), MixFrame(mixer, 2, EFFECT_MIX_PLAYBACK));
+	mixer.Resume(7);
+	EXPECT_EQ(1000, MixFrame(mixer, 2, EFFECT_MIX_PLAYBACK)[FRAME * 2 - 1]);
+	EXPECT_EQ(1u, mixer.GetStats().finished);
+}
+
+TEST(EffectVoiceMixerTest, FreesStoppedVoicesOnceTheTargetsMovedOn)
+{
+	CClips clips;
+	std::shared_ptr<const CEffectClip> clip = clips.Make(1000, FRAME * 100);
+	long idle = clip.use_count();
+	CEffectVoiceMixer mixer;
+	ASSERT_TRUE(mixer.Play(1, clip, EffectVoiceParams(), CEffectVoiceMixer::NowNs()));
+	MixFrame(mixer, 2, EFFECT_MIX_PLAYBACK);
+	MixFrame(mixer, 1, EFFECT_MIX_RECORD);
+	mixer.StopAll();
+	//a target may still be fading it.
+	EXPECT_EQ(idle + 1, clip.use_count());
+	MixFrame(mixer, 2, EFFECT_MIX_PLAYBACK);
+	mixer.GetStats();
+	EXPECT_EQ(idle + 1, clip.use_count());
+	MixFrame(mixer, 1, EFFECT_MIX_RECORD);
+	mixer.GetStats();
+	EXPECT_EQ(idle, clip.use_count());
+
+	//a target that stopped mixing holds nothing.
+	ASSERT_TRUE(mixer.Play(1, clip, EffectVoiceParams(), CEffectVoiceMixer::NowNs()));
+	MixFrame(mixer, 2, EFFECT_MIX_PLAYBACK);
+	mixer.StopAll();
+	std::this_thread::sleep_for(std::chrono::milliseconds(CEffectVoiceMixer::TARGET_IDLE_MS + 50));
+	mixer.GetStats();
+	EXPECT_EQ(idle, clip.use_count());
+	//and starts over when it is mixed again.
+	EXPECT_EQ(std::vector<int16_t>(FRAME * 2), MixFrame(mixer, 2, EFFECT_MIX_PLAYBACK));
+}
+
+//both audio threads mix while the control side plays, steals and stops.
+TEST(EffectVoiceMixerTest, MixesWhileTheControlSidePlays)
+{
+	CClips clips;
+	std::vector<std::shared_ptr<const CEffectClip>> clip;
+	for (int i = 0; i < 4; ++i)
+		clip.push_back(clips.Make((int16_t)(1000 * (i + 1)), FRAME * (i + 1)));
+	long idle = clip[0].use_count();
+	CEffectVoiceMixer mixer;
+	mixer.SetPolyphony(4, 2);
+	std::atomic<bool> stop{ false };
+	std::atomic<int> frames{ 0 };
+	std::atomic<int> overflows{ 0 };
+	auto audio = [&](EffectMixTarget target, int channels) {
+		while (!stop) {
+			std::vector<int16_t> frame = MixFrame(mixer, channels, target);
+			for (int16_t sample : frame) {
+				//4 voices of at most 4000, each maybe fading out the one it replaced.
+				if (sample < 0 || sample > 32000)
+					++overflows;
+			}
+			++frames;
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+		}
+	};
+	std::thread playback(audio, EFFECT_MIX_PLAYBACK, 2);
+	std::thread record(audio, EFFECT_MIX_RECORD, 1);
+	uint32_t seed = 1;
+	for (int i = 0; i < 2000; ++i) {
+		seed = seed * 1664525u + 1013904223u;
+		int sound = (int)(seed >> 28) % 4;
+		EffectVoiceParams params;
+		params.loops = (int)(seed >> 20) % 3;
+		params.publish = (seed >> 16) & 1;
+		switch ((seed >> 8) % 8) {
+		case 0:
+			mixer.Stop(sound);
+			break;
+		case 1:
+			mixer.Pause(sound);
+			break;
+		case 2:
+			mixer.ResumeAll();
+			break;
+		case 3:
+			mixer.GetStats();
+			break;
+		default:
+			mixer.Play(sound, clip[sound], params, CEffectVoiceMixer::NowNs());
+			break;
+		}
+		if (i % 100 == 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	mixer.StopAll();
+	int mixed = frames;
+	while (frames < mixed + 10)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	stop = true;
+	playback.join();
+	record.join();
+	EffectMixerStats stats = mixer.GetStats();
+	EXPECT_EQ(0, overflows.load());
+	EXPECT_EQ(0, stats.active);
+	EXPECT_GT(stats.started, 0u);
+	EXPECT_EQ(idle, clip[0].use_count());
+}
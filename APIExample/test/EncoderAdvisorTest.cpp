@@ -0,0 +1,179 @@
+#include "capture/EncoderAdvisor.h"
+#include "capture/CaptureNegotiator.h"
+#include <gtest/gtest.h>
+#include <string.h>
+
+using namespace agora::rtc;
+
+namespace {
+	CaptureFormat Format(uint32_t fourcc, int width, int height, int fps)
+	{
+		CaptureFormat format;
+		format.fourcc = fourcc;
+		format.width = width;
+		format.height = height;
+		format.fps = fps;
+		return format;
+	}
+
+	//fixed numbers instead of a benchmark run, so the advice is the same
+	//on every machine.
+	HostProfile Profile(int cores, double filterNsPerPixel, double memcpyGBps = 10)
+	{
+		HostProfile profile;
+		profile.machine = "test";
+		profile.cores = cores;
+		profile.memcpyGBps = memcpyGBps;
+		profile.filterNsPerPixel = filterNsPerPixel;
+		profile.convertNsPerPixel[CAPTURE_FOURCC_NV12] = 0.05;
+		profile.convertNsPerPixel[CAPTURE_FOURCC_YUY2] = 0.1;
+		return profile;
+	}
+
+	//a desktop that encodes 1080p30 with room to spare.
+	HostProfile FastHost() { return Profile(8, 0.1); }
+	//one slow core, 1080p30 would take it several times over.
+	HostProfile SlowHost() { return Profile(1, 1.0); }
+}
+
+TEST(EncoderAdvisorTest, BaseBitrateFollowsTheSdkTable)
+{
+	EXPECT_EQ(400, CEncoderAdvisor::GetBaseBitrateKbps(640, 360, 15));
+	//the SDK lists 1710 and 3150.
+	EXPECT_NEAR(1710, CEncoderAdvisor::GetBaseBitrateKbps(1280, 720, 30), 20);
+	EXPECT_NEAR(3150, CEncoderAdvisor::GetBaseBitrateKbps(1920, 1080, 30), 20);
+	EXPECT_LT(CEncoderAdvisor::GetBaseBitrateKbps(1280, 720, 15), CEncoderAdvisor::GetBaseBitrateKbps(1280, 720, 30));
+	EXPECT_LT(CEncoderAdvisor::GetBaseBitrateKbps(960, 540, 30), CEncoderAdvisor::GetBaseBitrateKbps(1280, 720, 30));
+}
+
+TEST(EncoderAdvisorTest, FastHostGetsTheRequest)
+{
+	EncoderAdvice advice = CEncoderAdvisor(FastHost()).Advise({}, EncoderAdviceRequest());
+	ASSERT_TRUE(advice.valid);
+	EXPECT_EQ(1920, advice.config.dimensions.width);
+	EXPECT_EQ(1080, advice.config.dimensions.height);
+	EXPECT_EQ(FRAME_RATE_FPS_30, advice.config.frameRate);
+	EXPECT_EQ(STANDARD_BITRATE, advice.config.bitrate);
+	EXPECT_EQ(MAINTAIN_QUALITY, advice.config.degradationPreference);
+	//the request capped it, no budget did.
+	EXPECT_STREQ("", advice.limitedBy);
+	//no camera given: native NV12 at the encoder size.
+	EXPECT_EQ(CAPTURE_FOURCC_NV12, advice.estimate.captureFormat.fourcc);
+	EXPECT_EQ(-1, advice.estimate.captureIndex);
+}
+
+TEST(EncoderAdvisorTest, RequestCapsSizeAndRate)
+{
+	EncoderAdviceRequest request;
+	request.maxWidth = 640;
+	request.maxHeight = 480;
+	request.maxFps = 15;
+	EncoderAdvice advice = CEncoderAdvisor(FastHost()).Advise({}, request);
+	ASSERT_TRUE(advice.valid);
+	//4:3 asks for the standard ladder.
+	EXPECT_EQ(640, advice.config.dimensions.width);
+	EXPECT_EQ(480, advice.config.dimensions.height);
+	EXPECT_EQ(FRAME_RATE_FPS_15, advice.config.frameRate);
+}
+
+TEST(EncoderAdvisorTest, SlowCpuLowersResolutionBeforeFrameRate)
+{
+	EncoderAdviceRequest request;
+	EncoderAdvice advice = CEncoderAdvisor(SlowHost()).Advise({}, request);
+	ASSERT_TRUE(advice.valid);
+	EXPECT_LT(advice.config.dimensions.width, 1920);
+	EXPECT_GE(advice.estimate.fps, request.minFps);
+	EXPECT_LE(advice.estimate.cpuPercent, request.cpuBudgetPercent);
+	EXPECT_STREQ("", advice.estimate.limit);
+	EXPECT_STREQ("cpu", advice.limitedBy);
+	//one core never keeps quality.
+	EXPECT_NE(MAINTAIN_QUALITY, advice.config.degradationPreference);
+
+	//a smaller budget or more filter passes only ever take away.
+	EncoderAdviceRequest tighter = request;
+	tighter.cpuBudgetPercent = 10;
+	tighter.filterPasses = 2;
+	EncoderAdvice smaller = CEncoderAdvisor(SlowHost()).Advise({}, tighter);
+	ASSERT_TRUE(smaller.valid);
+	EXPECT_LT(smaller.estimate.baseKbps, advice.estimate.baseKbps);
+	EXPECT_LE(smaller.estimate.cpuPercent, tighter.cpuBudgetPercent);
+}
+
+TEST(EncoderAdvisorTest, FilterPassesCostCpu)
+{
+	CEncoderAdvisor advisor(SlowHost());
+	EncoderAdviceRequest plain, filtered;
+	filtered.filterPasses = 4;
+	EncoderEstimate a = advisor.Estimate(1280, 720, 30, {}, plain);
+	EncoderEstimate b = advisor.Estimate(1280, 720, 30, {}, filtered);
+	//each pass costs one benchmark filter pass per pixel.
+	EXPECT_NEAR(b.captureUsPerFrame - a.captureUsPerFrame, 4 * 1.0 * 1280 * 720 / 1000, 1);
+	EXPECT_GT(b.cpuPercent, a.cpuPercent);
+}
+
+TEST(EncoderAdvisorTest, CameraCapsTheResolution)
+{
+	std::vector<CaptureFormat> formats = { Format(CAPTURE_FOURCC_YUY2, 640, 480, 30) };
+	EncoderAdvice advice = CEncoderAdvisor(FastHost()).Advise(formats, EncoderAdviceRequest());
+	ASSERT_TRUE(advice.valid);
+	//640x360 cropped from 640x480 is the biggest 16:9 the camera covers.
+	EXPECT_EQ(640, advice.config.dimensions.width);
+	EXPECT_EQ(360, advice.config.dimensions.height);
+	EXPECT_EQ(0, advice.estimate.captureIndex);
+	EXPECT_STREQ("camera", advice.limitedBy);
+}
+
+TEST(EncoderAdvisorTest, CameraFrameRateBelowTheFloor)
+{
+	std::vector<CaptureFormat> formats = { Format(CAPTURE_FOURCC_YUY2, 1280, 720, 10) };
+	EncoderAdvice advice = CEncoderAdvisor(FastHost()).Advise(formats, EncoderAdviceRequest());
+	ASSERT_TRUE(advice.valid);
+	EXPECT_EQ(1280, advice.config.dimensions.width);
+	EXPECT_EQ(FRAME_RATE_FPS_10, advice.config.frameRate);
+	EXPECT_EQ(MAINTAIN_FRAMERATE, advice.config.degradationPreference);
+}
+
+TEST(EncoderAdvisorTest, CheapestCaptureFormatFeedsTheEncoder)
+{
+	std::vector<CaptureFormat> formats = {
+		Format(CAPTURE_FOURCC_MJPG, 1280, 720, 30),
+		Format(CAPTURE_FOURCC_YUY2, 1280, 720, 30),
+		Format(CAPTURE_FOURCC_NV12, 1920, 1080, 30),
+	};
+	CEncoderAdvisor advisor(FastHost());
+	EncoderEstimate estimate = advisor.Estimate(1280, 720, 30, formats, EncoderAdviceRequest());
+	//YUY2 at the size beats MJPG's estimate and NV12 scaled down.
+	EXPECT_EQ(1, estimate.captureIndex);
+
+	//MJPG learned from live frames to be cheap wins once known.
+	CCaptureCostModel costs;
+	costs.Report(CAPTURE_FOURCC_MJPG, 1280 * 720, 1280 * 720 / 100, 1000);
+	EncoderEstimate learned = CEncoderAdvisor(FastHost(), &costs).Estimate(1280, 720, 30, formats, EncoderAdviceRequest());
+	EXPECT_EQ(0, learned.captureIndex);
+	EXPECT_LT(learned.captureUsPerFrame, estimate.captureUsPerFrame);
+}
+
+TEST(EncoderAdvisorTest, SlowMemoryLimitsTheCopies)
+{
+	EncoderAdvice advice = CEncoderAdvisor(Profile(8, 0.1, 0.2)).Advise({}, EncoderAdviceRequest());
+	ASSERT_TRUE(advice.valid);
+	EXPECT_LT(advice.config.dimensions.width, 1920);
+	EXPECT_LE(advice.estimate.memoryPercent, EncoderAdviceRequest().memoryBudgetPercent);
+	EXPECT_STREQ("memory", advice.limitedBy);
+}
+
+TEST(EncoderAdvisorTest, NothingFitsStillSaysWhy)
+{
+	std::vector<CaptureFormat> formats = { Format(CAPTURE_FOURCC_YUY2, 160, 90, 30) };
+	EncoderAdvice advice = CEncoderAdvisor(FastHost()).Advise(formats, EncoderAdviceRequest());
+	ASSERT_TRUE(advice.valid);
+	EXPECT_STREQ("camera", advice.estimate.limit);
+	EXPECT_NE(std::string::npos, CEncoderAdvisor::DescribeAdvice(advice).find("over the camera budget"));
+}
+
+TEST(EncoderAdvisorTest, InvalidProfileGivesNoAdvice)
+{
+	EncoderAdvice advice = CEncoderAdvisor(HostProfile()).Advise({}, EncoderAdviceRequest());
+	EXPECT_FALSE(advice.valid);
+	EXPECT_EQ("no advice", CEncoderAdvisor::DescribeAdvice(advice));
+}
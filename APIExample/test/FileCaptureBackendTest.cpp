@@ -0,0 +1,322 @@
+#include "capture/FileCaptureBackend.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+	//a file in the temp directory, removed again at the end.
+	class CTempFile
+	{
+	public:
+		explicit CTempFile(const char* suffix = "")
+		{
+			char path[] = "/tmp/FileCaptureBackendTestXXXXXX";
+			int fd = mkstemp(path);
+			if (fd >= 0)
+				close(fd);
+			remove(path);
+			m_path = std::string(path) + suffix;
+		}
+		~CTempFile() { remove(m_path.c_str()); }
+
+		void Write(const void* data, size_t size)
+		{
+			FILE* file = fopen(m_path.c_str(), "wb");
+			ASSERT_NE(nullptr, file);
+			fwrite(data, 1, size, file);
+			fclose(file);
+		}
+		//frames whose every byte is the frame index.
+		void WriteVideo(size_t frameSize, int frames)
+		{
+			std::vector<uint8_t> data(frameSize * frames);
+			for (int i = 0; i < frames; ++i)
+				memset(&data[frameSize * i], i, frameSize);
+			Write(data.data(), data.size());
+		}
+		//a 16 bit PCM WAV file of the given samples.
+		void WriteWav(const std::vector<int16_t>& samples, int sampleRate, int channels)
+		{
+			std::vector<uint8_t> data(44 + samples.size() * 2);
+			uint32_t dataSize = (uint32_t)samples.size() * 2;
+			auto put16 = [&](size_t at, uint16_t value) { data[at] = (uint8_t)value; data[at + 1] = (uint8_t)(value >> 8); };
+			auto put32 = [&](size_t at, uint32_t value) { put16(at, (uint16_t)value); put16(at + 2, (uint16_t)(value >> 16)); };
+			memcpy(&data[0], "RIFF", 4);
+			put32(4, 36 + dataSize);
+			memcpy(&data[8], "WAVEfmt ", 8);
+			put32(16, 16);
+			put16(20, 1);
+			put16(22, (uint16_t)channels);
+			put32(24, (uint32_t)sampleRate);
+			put32(28, (uint32_t)(sampleRate * channels * 2));
+			put16(32, (uint16_t)(channels * 2));
+			put16(34, 16);
+			memcpy(&data[36], "data", 4);
+			put32(40, dataSize);
+			memcpy(&data[44], samples.data(), dataSize);
+			Write(data.data(), data.size());
+		}
+		const std::string& GetPath() const { return m_path; }
+
+	private:
+		std::string m_path;
+	};
+
+	//what the capture thread delivered.
+	struct Captured {
+		std::mutex mutex;
+		std::vector<std::vector<uint8_t>> frames;
+		std::vector<uint64_t> sequences;
+		std::vector<int64_t> timestamps;
+		const CaptureFormat* format = nullptr;
+
+		ICaptureBackend::FrameCallback Callback()
+		{
+			return [this](const CaptureFrame& frame) {
+				std::lock_guard<std::mutex> lock(mutex);
+				frames.emplace_back(frame.data, frame.data + frame.size);
+				sequences.push_back(frame.sequence);
+				timestamps.push_back(frame.timestampUs);
+				format = frame.format;
+			};
+		}
+		size_t Count()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			return frames.size();
+		}
+		//false if fewer than count frames arrived within timeoutMs.
+		bool WaitFor(size_t count, int timeoutMs)
+		{
+			auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+			while (Count() < count) {
+				if (std::chrono::steady_clock::now() > end)
+					return false;
+				std::this_thread::sleep_for(std::chrono::milliseconds(2));
+			}
+			return true;
+		}
+	};
+
+	CaptureFormat VideoFormat(uint32_t fourcc, int width, int height, int fps)
+	{
+		CaptureFormat format;
+		format.fourcc = fourcc;
+		format.width = width;
+		format.height = height;
+		format.fps = fps;
+		return format;
+	}
+
+	CaptureFormat AudioFormat(int sampleRate, int channels)
+	{
+		CaptureFormat format;
+		format.media = CAPTURE_MEDIA_AUDIO;
+		format.fourcc = CAPTURE_FOURCC_PCM16;
+		format.sampleRate = sampleRate;
+		format.channels = channels;
+		return format;
+	}
+}
+
+TEST(FileCaptureBackendTest, FormatHelpers)
+{
+	EXPECT_EQ(640u * 480 * 3 / 2, GetCaptureFrameSize(VideoFormat(CAPTURE_FOURCC_I420, 640, 480, 30)));
+	EXPECT_EQ(640u * 480 * 3 / 2, GetCaptureFrameSize(VideoFormat(CAPTURE_FOURCC_NV12, 640, 480, 30)));
+	EXPECT_EQ(640u * 480 * 2, GetCaptureFrameSize(VideoFormat(CAPTURE_FOURCC_YUY2, 640, 480, 30)));
+	EXPECT_EQ(640u * 480 * 3, GetCaptureFrameSize(VideoFormat(CAPTURE_FOURCC_BGR24, 640, 480, 30)));
+	EXPECT_EQ(640u * 480 * 4, GetCaptureFrameSize(VideoFormat(CAPTURE_FOURCC_RGBA, 640, 480, 30)));
+	EXPECT_EQ(0u, GetCaptureFrameSize(VideoFormat(CAPTURE_FOURCC_MJPG, 640, 480, 30)));
+
+	EXPECT_TRUE(IsSameCaptureFormat(VideoFormat(CAPTURE_FOURCC_I420, 640, 480, 30), VideoFormat(CAPTURE_FOURCC_I420, 640, 480, 30)));
+	EXPECT_FALSE(IsSameCaptureFormat(VideoFormat(CAPTURE_FOURCC_I420, 640, 480, 30), VideoFormat(CAPTURE_FOURCC_I420, 640, 480, 15)));
+	EXPECT_FALSE(IsSameCaptureFormat(VideoFormat(CAPTURE_FOURCC_I420, 640, 480, 30), VideoFormat(CAPTURE_FOURCC_NV12, 640, 480, 30)));
+	//audio formats ignore the video fields.
+	CaptureFormat audio = AudioFormat(48000, 2);
+	audio.width = 5;
+	EXPECT_TRUE(IsSameCaptureFormat(audio, AudioFormat(48000, 2)));
+	EXPECT_FALSE(IsSameCaptureFormat(audio, AudioFormat(48000, 1)));
+
+	EXPECT_EQ("I420 1280x720@30", DescribeCaptureFormat(VideoFormat(CAPTURE_FOURCC_I420, 1280, 720, 30)));
+	EXPECT_EQ("S16L 48000Hz 2ch", DescribeCaptureFormat(AudioFormat(48000, 2)));
+}
+
+TEST(FileCaptureBackendTest, CreatesTheBackendsOfThePlatform)
+{
+	std::unique_ptr<ICaptureBackend> file = CreateCaptureBackend(CAPTURE_BACKEND_FILE);
+	ASSERT_NE(nullptr, file);
+	EXPECT_STREQ("file", file->GetName());
+	EXPECT_EQ(nullptr, CreateCaptureBackend(CAPTURE_BACKEND_DSHOW));
+	std::unique_ptr<ICaptureBackend> v4l2 = CreateCaptureBackend(CAPTURE_BACKEND_V4L2);
+	ASSERT_NE(nullptr, v4l2);
+	EXPECT_STREQ("v4l2", v4l2->GetName());
+	//a new file backend has no devices.
+	std::vector<CaptureFormat> formats;
+	EXPECT_FALSE(GetCaptureDeviceFormats(CAPTURE_BACKEND_FILE, 0, formats));
+	EXPECT_FALSE(GetCaptureDeviceFormats(CAPTURE_BACKEND_DSHOW, 0, formats));
+}
+
+TEST(FileCaptureBackendTest, ListsEachAddedFileAsADevice)
+{
+	CFileCaptureBackend backend;
+	EXPECT_FALSE(backend.AddVideoFile("/tmp/x.yuv", RAW_VIDEO_I420, 0, 480, 30));
+	EXPECT_FALSE(backend.AddVideoFile("/tmp/x.yuv", RAW_VIDEO_I420, 640, 480, 0));
+	//10 ms frames need a rate divisible by 100.
+	EXPECT_FALSE(backend.AddAudioFile("/tmp/x.pcm", 44101, 1));
+	EXPECT_FALSE(backend.AddAudioFile("/tmp/x.pcm", 48000, 0));
+	ASSERT_TRUE(backend.AddVideoFile("/tmp/dir/camera.yuv", RAW_VIDEO_NV12, 640, 480, 15));
+	ASSERT_TRUE(backend.AddAudioFile("/tmp/dir/mic.wav", 16000, 1));
+
+	std::vector<CaptureDeviceInfo> devices;
+	ASSERT_TRUE(backend.EnumDevices(devices));
+	ASSERT_EQ(2u, devices.size());
+	EXPECT_EQ("/tmp/dir/camera.yuv", devices[0].id);
+	EXPECT_EQ("camera.yuv", devices[0].name);
+	EXPECT_EQ(CAPTURE_MEDIA_VIDEO, devices[0].media);
+	EXPECT_EQ("mic.wav", devices[1].name);
+	EXPECT_EQ(CAPTURE_MEDIA_AUDIO, devices[1].media);
+
+	std::vector<CaptureFormat> formats;
+	ASSERT_TRUE(backend.GetFormats(0, formats));
+	ASSERT_EQ(1u, formats.size());
+	EXPECT_TRUE(IsSameCaptureFormat(VideoFormat(CAPTURE_FOURCC_NV12, 640, 480, 15), formats[0]));
+	ASSERT_TRUE(backend.GetFormats(1, formats));
+	EXPECT_TRUE(IsSameCaptureFormat(AudioFormat(16000, 1), formats[0]));
+	EXPECT_FALSE(backend.GetFormats(2, formats));
+	EXPECT_TRUE(formats.empty());
+}
+
+TEST(FileCaptureBackendTest, OpensOnlyExistingFilesInTheirFormat)
+{
+	CTempFile video;
+	video.WriteVideo(64 * 48 * 3 / 2, 2);
+	CFileCaptureBackend backend;
+	ASSERT_TRUE(backend.AddVideoFile(video.GetPath(), RAW_VIDEO_I420, 64, 48, 30));
+	ASSERT_TRUE(backend.AddVideoFile("/tmp/FileCaptureBackendTest-missing.yuv", RAW_VIDEO_I420, 64, 48, 30));
+
+	EXPECT_FALSE(backend.Start([](const CaptureFrame&) {}));
+	EXPECT_FALSE(backend.Open(0, VideoFormat(CAPTURE_FOURCC_I420, 64, 48, 15)));
+	EXPECT_FALSE(backend.Open(1, VideoFormat(CAPTURE_FOURCC_I420, 64, 48, 30)));
+	EXPECT_FALSE(backend.Open(2, VideoFormat(CAPTURE_FOURCC_I420, 64, 48, 30)));
+	ASSERT_TRUE(backend.Open(0, VideoFormat(CAPTURE_FOURCC_I420, 64, 48, 30)));
+	EXPECT_FALSE(backend.Start(nullptr));
+	EXPECT_FALSE(backend.IsCapturing());
+	backend.Close();
+	EXPECT_FALSE(backend.Start([](const CaptureFrame&) {}));
+}
+
+TEST(FileCaptureBackendTest, DeliversVideoFramesInOrderAndLoops)
+{
+	const size_t frameSize = 64 * 48 * 3 / 2;
+	CTempFile video;
+	video.WriteVideo(frameSize, 3);
+	CFileCaptureBackend backend;
+	ASSERT_TRUE(backend.AddVideoFile(video.GetPath(), RAW_VIDEO_I420, 64, 48, 100));
+	ASSERT_TRUE(backend.Open(0, VideoFormat(CAPTURE_FOURCC_I420, 64, 48, 100)));
+
+	Captured captured;
+	int64_t start = CaptureClockUs();
+	ASSERT_TRUE(backend.Start(captured.Callback()));
+	EXPECT_TRUE(backend.IsCapturing());
+	ASSERT_TRUE(captured.WaitFor(7, 5000));
+	backend.Stop();
+	EXPECT_FALSE(backend.IsCapturing());
+	//no callback after Stop returned.
+	size_t count = captured.Count();
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	ASSERT_EQ(count, captured.Count());
+
+	EXPECT_NE(nullptr, captured.format);
+	for (size_t i = 0; i < count; ++i) {
+		ASSERT_EQ(frameSize, captured.frames[i].size());
+		//frame 0, 1, 2, 0, 1, ... with every byte its index.
+		EXPECT_EQ((uint8_t)(i % 3), captured.frames[i][0]) << i;
+		EXPECT_EQ((uint8_t)(i % 3), captured.frames[i][frameSize - 1]) << i;
+		EXPECT_EQ(i, captured.sequences[i]);
+		EXPECT_GE(captured.timestamps[i], start);
+		if (i) {
+			EXPECT_GE(captured.timestamps[i], captured.timestamps[i - 1]);
+		}
+	}
+}
+
+TEST(FileCaptureBackendTest, StopsDeliveringAtTheEndWithoutLoop)
+{
+	CTempFile video;
+	video.WriteVideo(32 * 32 * 4, 3);
+	CFileCaptureBackend backend;
+	backend.SetLoop(false);
+	ASSERT_TRUE(backend.AddVideoFile(video.GetPath(), RAW_VIDEO_RGBA, 32, 32, 100));
+	ASSERT_TRUE(backend.Open(0, VideoFormat(CAPTURE_FOURCC_RGBA, 32, 32, 100)));
+	Captured captured;
+	ASSERT_TRUE(backend.Start(captured.Callback()));
+	ASSERT_TRUE(captured.WaitFor(3, 5000));
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	backend.Stop();
+	ASSERT_EQ(3u, captured.Count());
+	EXPECT_EQ(2, captured.frames[2][0]);
+
+	//every Start plays the file from the beginning.
+	Captured again;
+	ASSERT_TRUE(backend.Start(again.Callback()));
+	ASSERT_TRUE(again.WaitFor(3, 5000));
+	backend.Stop();
+	EXPECT_EQ(0, again.frames[0][0]);
+}
+
+TEST(FileCaptureBackendTest, DeliversTenMillisecondAudioFrames)
+{
+	//two channels, 25 ms at 16 kHz: the sample value is its position.
+	std::vector<int16_t> samples(400 * 2);
+	for (size_t i = 0; i < samples.size(); ++i)
+		samples[i] = (int16_t)i;
+	CTempFile pcm;
+	pcm.Write(samples.data(), samples.size() * 2);
+	CFileCaptureBackend backend;
+	backend.SetLoop(false);
+	ASSERT_TRUE(backend.AddAudioFile(pcm.GetPath(), 16000, 2));
+	ASSERT_TRUE(backend.Open(0, AudioFormat(16000, 2)));
+
+	Captured captured;
+	ASSERT_TRUE(backend.Start(captured.Callback()));
+	ASSERT_TRUE(captured.WaitFor(3, 5000));
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	backend.Stop();
+	ASSERT_EQ(3u, captured.Count());
+	for (size_t f = 0; f < 3; ++f) {
+		const std::vector<uint8_t>& frame = captured.frames[f];
+		//160 frames of two samples.
+		ASSERT_EQ(160u * 2 * 2, frame.size());
+		const int16_t* data = (const int16_t*)frame.data();
+		for (size_t i = 0; i < 320; ++i) {
+			size_t at = f * 320 + i;
+			//the last frame is filled up with silence.
+			ASSERT_EQ(at < samples.size() ? samples[at] : 0, data[i]) << f << " " << i;
+		}
+	}
+}
+
+TEST(FileCaptureBackendTest, WavFilesHaveToMatchTheDeviceFormat)
+{
+	std::vector<int16_t> samples(480, 1000);
+	CTempFile wav(".wav");
+	wav.WriteWav(samples, 48000, 1);
+	CFileCaptureBackend backend;
+	ASSERT_TRUE(backend.AddAudioFile(wav.GetPath(), 48000, 2));
+	ASSERT_TRUE(backend.AddAudioFile(wav.GetPath(), 48000, 1));
+	EXPECT_FALSE(backend.Open(0, AudioFormat(48000, 2)));
+	ASSERT_TRUE(backend.Open(1, AudioFormat(48000, 1)));
+
+	Captured captured;
+	ASSERT_TRUE(backend.Start(captured.Callback()));
+	ASSERT_TRUE(captured.WaitFor(1, 5000));
+	backend.Stop();
+	ASSERT_EQ(480u * 2, captured.frames[0].size());
+	EXPECT_EQ(1000, ((const int16_t*)captured.frames[0].data())[479]);
+}
@@ -0,0 +1,179 @@
+#include "crypto/KeyRotatingPacketObserver.h"
+#include <gtest/gtest.h>
+#include <string.h>
+#include <vector>
+
+namespace {
+	typedef agora::rtc::IPacketObserver::Packet Packet;
+
+	void Configure(CKeyRotatingPacketObserver& observer, const char* secret = "secret")
+	{
+		MediaKeyScheduleConfig config;
+		config.masterSecret = secret;
+		config.salt = "salt";
+		config.context = "channel";
+		ASSERT_TRUE(observer.GetSchedule().SetConfig(config));
+		observer.GetSchedule().Advance(CMediaKeySchedule::NowMs());
+	}
+
+	//seals a payload and returns the wire bytes.
+	std::vector<uint8_t> Send(CKeyRotatingPacketObserver& sender, uint8_t fill, size_t size = 100, bool video = false)
+	{
+		std::vector<uint8_t> payload(size, fill);
+		Packet packet = { payload.data(), (unsigned int)payload.size() };
+		bool sent = video ? sender.onSendVideoPacket(packet) : sender.onSendAudioPacket(packet);
+		if (!sent)
+			return std::vector<uint8_t>();
+		return std::vector<uint8_t>(packet.buffer, packet.buffer + packet.size);
+	}
+
+	bool Receive(CKeyRotatingPacketObserver& receiver, const std::vector<uint8_t>& wire, std::vector<uint8_t>* payload = nullptr)
+	{
+		Packet packet = { wire.data(), (unsigned int)wire.size() };
+		if (!receiver.onReceiveAudioPacket(packet))
+			return false;
+		if (payload)
+			payload->assign(packet.buffer, packet.buffer + packet.size);
+		return true;
+	}
+
+	uint64_t SenderOf(const std::vector<uint8_t>& wire)
+	{
+		uint64_t sender = 0;
+		for (int i = 4; i < 12; ++i)
+			sender = sender << 8 | wire[i];
+		return sender;
+	}
+}
+
+TEST(KeyRotatingPacketObserverTest, RoundTripsBetweenClients)
+{
+	CKeyRotatingPacketObserver alice, bob;
+	Configure(alice);
+	Configure(bob);
+	std::vector<uint8_t> wire = Send(alice, 0x5a);
+	ASSERT_EQ(100u + CKeyRotatingPacketObserver::OVERHEAD, wire.size());
+	std::vector<uint8_t> payload;
+	ASSERT_TRUE(Receive(bob, wire, &payload));
+	EXPECT_EQ(std::vector<uint8_t>(100, 0x5a), payload);
+	EXPECT_EQ(1u, alice.GetStats().sent);
+	EXPECT_EQ(1u, bob.GetStats().received);
+}
+
+TEST(KeyRotatingPacketObserverTest, SendsNothingWithoutAKey)
+{
+	CKeyRotatingPacketObserver observer;
+	EXPECT_TRUE(Send(observer, 1).empty());
+}
+
+TEST(KeyRotatingPacketObserverTest, RejectsOtherSecretsAndTampering)
+{
+	CKeyRotatingPacketObserver alice, bob, eve;
+	Configure(alice);
+	Configure(bob);
+	Configure(eve, "guess");
+	EXPECT_FALSE(Receive(bob, Send(eve, 1)));
+	std::vector<uint8_t> wire = Send(alice, 2);
+	//the header is authenticated too.
+	for (size_t i = 0; i < wire.size(); i += 7) {
+		if (i < 4)
+			continue;
+		std::vector<uint8_t> changed = wire;
+		changed[i] ^= 0x80;
+		EXPECT_FALSE(Receive(bob, changed)) << i;
+	}
+	EXPECT_FALSE(Receive(bob, std::vector<uint8_t>(CKeyRotatingPacketObserver::OVERHEAD - 1)));
+	KeyRotationPacketStats stats = bob.GetStats();
+	EXPECT_EQ(1u, stats.rejectedFormat);
+	EXPECT_GT(stats.rejectedTag, 0u);
+	EXPECT_EQ(0u, stats.rejectedReplay);
+	EXPECT_TRUE(Receive(bob, wire));
+}
+
+TEST(KeyRotatingPacketObserverTest, UsesA64BitSender)
+{
+	CKeyRotatingPacketObserver a, b;
+	Configure(a);
+	Configure(b);
+	std::vector<uint8_t> first = Send(a, 1);
+	std::vector<uint8_t> second = Send(a, 1, 100, true);
+	//audio and video share the sender and count on.
+	EXPECT_EQ(SenderOf(first), SenderOf(second));
+	EXPECT_EQ(0, memcmp(&first[12], "\0\0\0\0", 4));
+	EXPECT_EQ(0, memcmp(&second[12], "\0\0\0\1", 4));
+	EXPECT_NE(SenderOf(first), SenderOf(Send(b, 1)));
+	EXPECT_NE(0u, SenderOf(first) >> 32);
+}
+
+TEST(KeyRotatingPacketObserverTest, RejectsReplays)
+{
+	CKeyRotatingPacketObserver alice, bob;
+	Configure(alice);
+	Configure(bob);
+	std::vector<std::vector<uint8_t>> wires;
+	for (int i = 0; i < 10; ++i)
+		wires.push_back(Send(alice, (uint8_t)i));
+	//in order, then every one of them again.
+	for (auto& wire : wires)
+		EXPECT_TRUE(Receive(bob, wire));
+	for (auto& wire : wires)
+		EXPECT_FALSE(Receive(bob, wire));
+	EXPECT_EQ(10u, bob.GetStats().rejectedReplay);
+	EXPECT_EQ(10u, bob.GetStats().received);
+}
+
+TEST(KeyRotatingPacketObserverTest, AcceptsReorderingWithinTheWindow)
+{
+	CKeyRotatingPacketObserver alice, bob;
+	Configure(alice);
+	Configure(bob);
+	const int count = CKeyRotatingPacketObserver::REPLAY_WINDOW + 10;
+	std::vector<std::vector<uint8_t>> wires;
+	for (int i = 0; i < count; ++i)
+		wires.push_back(Send(alice, (uint8_t)i));
+	//the newest first, the ones still in the window come late.
+	EXPECT_TRUE(Receive(bob, wires[count - 1]));
+	for (int i = count - 2; i >= 10; --i)
+		EXPECT_TRUE(Receive(bob, wires[i])) << i;
+	//REPLAY_WINDOW behind the newest is too old, even if never seen.
+	for (int i = 9; i >= 0; --i)
+		EXPECT_FALSE(Receive(bob, wires[i])) << i;
+	EXPECT_FALSE(Receive(bob, wires[count - 1]));
+	EXPECT_FALSE(Receive(bob, wires[500]));
+	EXPECT_EQ(12u, bob.GetStats().rejectedReplay);
+}
+
+TEST(KeyRotatingPacketObserverTest, ForgetsWhatAJumpPassedOver)
+{
+	CKeyRotatingPacketObserver alice, bob;
+	Configure(alice);
+	Configure(bob);
+	std::vector<std::vector<uint8_t>> wires;
+	for (int i = 0; i < 3 * CKeyRotatingPacketObserver::REPLAY_WINDOW; ++i)
+		wires.push_back(Send(alice, (uint8_t)i));
+	//counters that share a bit with ones seen before are still new.
+	EXPECT_TRUE(Receive(bob, wires[1]));
+	EXPECT_TRUE(Receive(bob, wires[1 + CKeyRotatingPacketObserver::REPLAY_WINDOW]));
+	EXPECT_TRUE(Receive(bob, wires[1 + 2 * CKeyRotatingPacketObserver::REPLAY_WINDOW]));
+	EXPECT_TRUE(Receive(bob, wires[2 * CKeyRotatingPacketObserver::REPLAY_WINDOW + 700]));
+	EXPECT_TRUE(Receive(bob, wires[2 * CKeyRotatingPacketObserver::REPLAY_WINDOW + 300]));
+	EXPECT_FALSE(Receive(bob, wires[2 * CKeyRotatingPacketObserver::REPLAY_WINDOW + 300]));
+	EXPECT_EQ(1u, bob.GetStats().rejectedReplay);
+}
+
+TEST(KeyRotatingPacketObserverTest, KeepsAWindowPerSender)
+{
+	const int senders = CKeyRotatingPacketObserver::REPLAY_SENDERS;
+	std::vector<CKeyRotatingPacketObserver> clients(senders);
+	CKeyRotatingPacketObserver receiver;
+	Configure(receiver);
+	std::vector<std::vector<uint8_t>> firsts;
+	for (auto& client : clients) {
+		Configure(client);
+		firsts.push_back(Send(client, 1));
+		EXPECT_TRUE(Receive(receiver, firsts.back()));
+	}
+	for (auto& first : firsts)
+		EXPECT_FALSE(Receive(receiver, first));
+	EXPECT_EQ((uint64_t)senders, receiver.GetStats().rejectedReplay);
+}
@@ -0,0 +1,415 @@
+#include "netsim/ImpairedPacketObserver.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+
+namespace {
+	//a packet whose payload says which stream and packet it is.
+	std::vector<uint8_t> MakePacket(int stream, int index, size_t size = 100)
+	{
+		std::vector<uint8_t> packet(size);
+		packet[0] = (uint8_t)stream;
+		packet[1] = (uint8_t)(index >> 8);
+		packet[2] = (uint8_t)index;
+		return packet;
+	}
+
+	int IndexOf(const std::vector<uint8_t>& packet)
+	{
+		return packet[1] << 8 | packet[2];
+	}
+
+	//sends count packets every intervalUs and returns the indexes that came
+	//out on the stream, in order.
+	std::vector<int> SendPackets(CNetworkImpairment& link, int count, int64_t intervalUs, int stream = 0, size_t size = 100)
+	{
+		std::vector<int> delivered;
+		std::vector<uint8_t> out;
+		for (int i = 0; i < count; ++i) {
+			std::vector<uint8_t> packet = MakePacket(stream, i, size);
+			switch (link.Process(stream, packet.data(), packet.size(), i * intervalUs, out)) {
+			case IMPAIR_PASS:
+				delivered.push_back(i);
+				break;
+			case IMPAIR_REPLACE:
+				EXPECT_EQ(stream, out[0]);
+				delivered.push_back(IndexOf(out));
+				break;
+			default:
+				break;
+			}
+		}
+		return delivered;
+	}
+
+	//the lengths of the runs of lost packets.
+	double AverageLossRun(const std::vector<int>& delivered, int count)
+	{
+		int runs = 0, lost = 0;
+		int expected = 0;
+		for (int index : delivered) {
+			if (index > expected) {
+				++runs;
+				lost += index - expected;
+			}
+			expected = index + 1;
+		}
+		if (count > expected) {
+			++runs;
+			lost += count - expected;
+		}
+		return runs ? (double)lost / runs : 0;
+	}
+}
+
+TEST(NetworkImpairmentTest, PerfectLinkPassesEverything)
+{
+	CNetworkImpairment link;
+	std::vector<int> delivered = SendPackets(link, 100, 20000);
+	EXPECT_EQ(100u, delivered.size());
+	ImpairmentStats stats = link.GetStats();
+	EXPECT_EQ(100u, stats.packets);
+	EXPECT_EQ(10000u, stats.bytes);
+	EXPECT_EQ(100u, stats.delivered);
+	EXPECT_EQ(0u, stats.delayed);
+	EXPECT_DOUBLE_EQ(0, stats.GetLossRate());
+	EXPECT_EQ(-1, stats.step);
+}
+
+TEST(NetworkImpairmentTest, RandomLossHitsItsRateAndRepeatsWithTheSeed)
+{
+	ImpairmentConfig config;
+	config.lossRate = 0.1;
+	CNetworkImpairment link, again;
+	link.SetConfig(config);
+	again.SetConfig(config);
+	link.SetSeed(42);
+	again.SetSeed(42);
+	std::vector<int> delivered = SendPackets(link, 20000, 10000);
+	EXPECT_EQ(delivered, SendPackets(again, 20000, 10000));
+	ImpairmentStats stats = link.GetStats();
+	EXPECT_NEAR(0.1, stats.GetLossRate(), 0.01);
+	EXPECT_EQ(stats.packets - stats.lost, stats.delivered);
+	//independent losses rarely come in a row.
+	EXPECT_LT(AverageLossRun(delivered, 20000), 1.3);
+}
+
+TEST(NetworkImpairmentTest, GilbertElliottLossComesInBursts)
+{
+	ImpairmentConfig config;
+	//bad one packet in 21, bursts of 5 on average.
+	config.geGoodToBad = 0.01;
+	config.geBadToGood = 0.2;
+	CNetworkImpairment link;
+	link.SetConfig(config);
+	std::vector<int> delivered = SendPackets(link, 50000, 10000);
+	EXPECT_NEAR(0.01 / 0.21, link.GetStats().GetLossRate(), 0.012);
+	EXPECT_GT(AverageLossRun(delivered, 50000), 3.5);
+}
+
+TEST(NetworkImpairmentTest, DelayHoldsPacketsBackInOrder)
+{
+	ImpairmentConfig config;
+	config.delayMs = 100;
+	CNetworkImpairment link;
+	link.SetConfig(config);
+	std::vector<int> delivered = SendPackets(link, 50, 20000);
+	//a packet leaves in the slot of the one sent 100 ms later.
+	ASSERT_EQ(45u, delivered.size());
+	for (int i = 0; i < 45; ++i)
+		EXPECT_EQ(i, delivered[i]);
+	ImpairmentStats stats = link.GetStats();
+	EXPECT_EQ(5u, stats.pending);
+	EXPECT_EQ(45u, stats.delayed);
+	EXPECT_DOUBLE_EQ(100, stats.GetDelayMsAverage());
+	EXPECT_EQ(100000, stats.delayUsMax);
+	EXPECT_EQ(0u, stats.reordered);
+
+	link.Reset();
+	stats = link.GetStats();
+	EXPECT_EQ(0u, stats.pending);
+	EXPECT_EQ(0u, stats.packets);
+}
+
+TEST(NetworkImpairmentTest, JitterAloneKeepsTheOrder)
+{
+	ImpairmentConfig config;
+	config.delayMs = 50;
+	config.jitterMs = 40;
+	CNetworkImpairment link;
+	link.SetConfig(config);
+	std::vector<int> delivered = SendPackets(link, 2000, 5000);
+	for (size_t i = 1; i < delivered.size(); ++i)
+		ASSERT_LT(delivered[i - 1], delivered[i]);
+	ImpairmentStats stats = link.GetStats();
+	EXPECT_EQ(0u, stats.reordered);
+	EXPECT_GT(stats.delayUsMax, 50000);
+	EXPECT_LE(stats.delayUsMax, 90000 + 5000 * 18);
+}
+
+TEST(NetworkImpairmentTest, ReorderLetsLaterPacketsOvertake)
+{
+	ImpairmentConfig config;
+	config.reorderRate = 0.1;
+	config.reorderMs = 50;
+	CNetworkImpairment link;
+	link.SetConfig(config);
+	std::vector<int> delivered = SendPackets(link, 2000, 10000);
+	ImpairmentStats stats = link.GetStats();
+	EXPECT_NEAR(200, (double)stats.reordered, 60);
+	int overtaken = 0;
+	for (size_t i = 1; i < delivered.size(); ++i)
+		overtaken += delivered[i] < delivered[i - 1];
+	//a packet that overtook may itself be overtaken by a held back one.
+	EXPECT_GT(overtaken, 0);
+	EXPECT_LE((uint64_t)overtaken, stats.reordered);
+	//nothing is lost, the last ones are still held.
+	EXPECT_EQ(2000u, delivered.size() + stats.pending);
+}
+
+TEST(NetworkImpairmentTest, RateCapQueuesAndDropsPastTheQueue)
+{
+	ImpairmentConfig config;
+	//1000 bytes take 10 ms, they come every 5 ms.
+	config.rateKbps = 800;
+	config.queueMs = 100;
+	CNetworkImpairment link;
+	link.SetConfig(config);
+	std::vector<int> delivered = SendPackets(link, 2000, 5000, 0, 1000);
+	ImpairmentStats stats = link.GetStats();
+	EXPECT_NEAR(1000, (double)stats.queueLost, 30);
+	EXPECT_EQ(0u, stats.lost);
+	//what goes through leaves at the capped rate.
+	EXPECT_NEAR(1000, (double)delivered.size(), 30);
+	EXPECT_LE(stats.delayUsMax, 100000 + 10000 + 5000);
+	EXPECT_GT(stats.GetDelayMsAverage(), 90);
+}
+
+TEST(NetworkImpairmentTest, BurstsDropTheStartOfEachPeriod)
+{
+	ImpairmentConfig config;
+	config.burstMs = 100;
+	config.burstPeriodMs = 1000;
+	CNetworkImpairment link;
+	link.SetConfig(config);
+	std::vector<int> delivered = SendPackets(link, 500, 10000);
+	EXPECT_EQ(50u, link.GetStats().burstLost);
+	EXPECT_EQ(450u, delivered.size());
+	for (int index : delivered)
+		EXPECT_GE(index % 100, 10);
+}
+
+TEST(NetworkImpairmentTest, StreamsKeepTheirOwnOrder)
+{
+	ImpairmentConfig config;
+	config.delayMs = 40;
+	CNetworkImpairment link;
+	link.SetConfig(config);
+	std::vector<uint8_t> out[2];
+	std::vector<int> delivered[2];
+	//audio every 10 ms, video every 30 ms.
+	for (int t = 0; t < 3000; t += 10) {
+		for (int stream = 0; stream < 2; ++stream) {
+			if (stream == 1 && t % 30)
+				continue;
+			std::vector<uint8_t> packet = MakePacket(stream, t / (stream ? 30 : 10));
+			ImpairResult result = link.Process(stream, packet.data(), packet.size(), t * 1000, out[stream]);
+			ASSERT_NE(IMPAIR_PASS, result);
+			if (result == IMPAIR_REPLACE) {
+				ASSERT_EQ(stream, out[stream][0]);
+				delivered[stream].push_back(IndexOf(out[stream]));
+			}
+		}
+	}
+	for (int stream = 0; stream < 2; ++stream) {
+		ASSERT_FALSE(delivered[stream].empty());
+		for (size_t i = 0; i < delivered[stream].size(); ++i)
+			EXPECT_EQ((int)i, delivered[stream][i]);
+	}
+	//4 audio and 2 video packets are within the 40 ms.
+	EXPECT_EQ(6u, link.GetStats().pending);
+	std::vector<uint8_t> packet = MakePacket(0, 0);
+	EXPECT_EQ(IMPAIR_PASS, link.Process(CNetworkImpairment::MAX_STREAMS, packet.data(), packet.size(), 0, out[0]));
+}
+
+TEST(NetworkImpairmentTest, ParsesScripts)
+{
+	ImpairmentScript script;
+	std::string error;
+	ASSERT_TRUE(ParseImpairmentScript(
+		"# a congested uplink\n"
+		"seed=7\n"
+		"0 up loss=5% delay=20ms\n"
+		"0 down rate=500kbps queue=200\n"
+		"1.5 jitter=10 reorder=2%,30\n"
+		"2 up ge=1%,10% burst=200/1000,50%\n"
+		"3 reset delay=5\n"
+		"4 loop\n", script, &error)) << error;
+	EXPECT_EQ(7u, script.seed);
+	EXPECT_EQ(4000, script.loopMs);
+	ASSERT_EQ(4u, script.uplink.size());
+	ASSERT_EQ(3u, script.downlink.size());
+
+	const ImpairmentConfig& up0 = script.uplink[0].config;
+	EXPECT_DOUBLE_EQ(0.05, up0.lossRate);
+	EXPECT_EQ(20, up0.delayMs);
+	EXPECT_EQ(0, up0.rateKbps);
+	EXPECT_EQ(500, script.downlink[0].config.rateKbps);
+	EXPECT_EQ(200, script.downlink[0].config.queueMs);
+
+	//a step keeps what it does not name.
+	EXPECT_EQ(1500, script.uplink[1].atMs);
+	const ImpairmentConfig& up1 = script.uplink[1].config;
+	EXPECT_DOUBLE_EQ(0.05, up1.lossRate);
+	EXPECT_EQ(10, up1.jitterMs);
+	EXPECT_DOUBLE_EQ(0.02, up1.reorderRate);
+	EXPECT_EQ(30, up1.reorderMs);
+	EXPECT_EQ(500, script.downlink[1].config.rateKbps);
+	EXPECT_EQ(10, script.downlink[1].config.jitterMs);
+
+	const ImpairmentConfig& up2 = script.uplink[2].config;
+	EXPECT_DOUBLE_EQ(0.01, up2.geGoodToBad);
+	EXPECT_DOUBLE_EQ(0.1, up2.geBadToGood);
+	EXPECT_EQ(200, up2.burstMs);
+	EXPECT_EQ(1000, up2.burstPeriodMs);
+	EXPECT_DOUBLE_EQ(0.5, up2.burstLoss);
+
+	const ImpairmentConfig& up3 = script.uplink[3].config;
+	EXPECT_EQ(5, up3.delayMs);
+	EXPECT_DOUBLE_EQ(0, up3.lossRate);
+	EXPECT_EQ(0, script.downlink[2].config.rateKbps);
+}
+
+TEST(NetworkImpairmentTest, RejectsBadScripts)
+{
+	const struct {
+		const char* text;
+		const char* line;
+	} bad[] = {
+		{ "0 loss=2\n", "line 1" },
+		{ "0 delay=5\n# fine\n1 color=red\n", "line 3" },
+		{ "2 delay=5\n1 delay=1\n", "line 2" },
+		{ "0 loss=1%\n1 loop\n2 delay=1\n", "line 3" },
+		{ "0 loop\n", "line 1" },
+		{ "x delay=1\n", "line 1" },
+		{ "0 burst=500/100\n", "line 1" },
+		{ "0 ge=1%\n", "line 1" },
+		{ "0 delay\n", "line 1" },
+	};
+	for (auto& test : bad) {
+		ImpairmentScript script;
+		std::string error;
+		EXPECT_FALSE(ParseImpairmentScript(test.text, script, &error)) << test.text;
+		EXPECT_EQ(0u, error.find(test.line)) << test.text << " -> " << error;
+	}
+}
+
+TEST(NetworkImpairmentTest, ScriptStepsFollowTheClockAndLoop)
+{
+	ImpairmentScript script;
+	ASSERT_TRUE(ParseImpairmentScript("0 reset\n1 loss=100%\n2 reset\n3 loop\n", script));
+	CNetworkImpairment link;
+	link.SetScript(script.uplink, script.loopMs);
+	//one packet every 100 ms for two loops, the second second of each lost.
+	std::vector<int> delivered = SendPackets(link, 60, 100000);
+	EXPECT_EQ(40u, delivered.size());
+	for (int index : delivered)
+		EXPECT_NE(1, index / 10 % 3) << index;
+	ImpairmentStats stats = link.GetStats();
+	EXPECT_EQ(20u, stats.lost);
+	//the last packet, at 5.9 s, is in the loop's 2 s step.
+	EXPECT_EQ(2, stats.step);
+
+	//Reset starts the script over from the next packet.
+	link.Reset();
+	std::vector<uint8_t> out;
+	std::vector<uint8_t> packet = MakePacket(0, 0);
+	EXPECT_EQ(IMPAIR_PASS, link.Process(0, packet.data(), packet.size(), 100000000, out));
+	EXPECT_EQ(0, link.GetStats().step);
+	EXPECT_EQ(IMPAIR_HOLD, link.Process(0, packet.data(), packet.size(), 101000000, out));
+	EXPECT_EQ(1, link.GetStats().step);
+
+	//a fixed configuration replaces the script.
+	link.SetConfig(ImpairmentConfig());
+	EXPECT_EQ(-1, link.GetStats().step);
+}
+
+namespace {
+	//flips the first byte of what it sees and remembers the order.
+	class CFlipObserver : public agora::rtc::IPacketObserver
+	{
+	public:
+		virtual bool onSendAudioPacket(Packet& packet) override { return Flip(packet); }
+		virtual bool onSendVideoPacket(Packet& packet) override { return Flip(packet); }
+		virtual bool onReceiveAudioPacket(Packet& packet) override { return Flip(packet); }
+		virtual bool onReceiveVideoPacket(Packet& packet) override { return Flip(packet); }
+
+		std::vector<int> seen;
+		std::vector<uint8_t> buffer;
+
+	private:
+		bool Flip(Packet& packet)
+		{
+			buffer.assign(packet.buffer, packet.buffer + packet.size);
+			seen.push_back(buffer[2]);
+			buffer[0] ^= 0xFF;
+			packet.buffer = buffer.data();
+			return true;
+		}
+	};
+}
+
+TEST(NetworkImpairmentTest, ObserverImpairsBothWaysAroundTheChain)
+{
+	CImpairedPacketObserver observer;
+	CFlipObserver chained;
+	observer.SetChainedObserver(&chained);
+	ImpairmentConfig lost;
+	lost.lossRate = 1.0;
+	observer.GetUplink().SetConfig(lost);
+
+	//sent packets pass the chained observer before the uplink, which loses them.
+	std::vector<uint8_t> data = MakePacket(0, 1);
+	agora::rtc::IPacketObserver::Packet packet = { data.data(), (unsigned int)data.size() };
+	EXPECT_FALSE(observer.onSendAudioPacket(packet));
+	EXPECT_EQ(1u, chained.seen.size());
+	EXPECT_EQ(1u, observer.GetUplink().GetStats().lost);
+
+	//received ones pass the downlink first, here held back 1 ms.
+	ImpairmentConfig delayed;
+	delayed.delayMs = 1;
+	observer.GetDownlink().SetConfig(delayed);
+	std::vector<uint8_t> first = MakePacket(1, 2), second = MakePacket(1, 3);
+	packet = { first.data(), (unsigned int)first.size() };
+	EXPECT_FALSE(observer.onReceiveVideoPacket(packet));
+	EXPECT_EQ(1u, chained.seen.size());
+	std::this_thread::sleep_for(std::chrono::milliseconds(3));
+	packet = { second.data(), (unsigned int)second.size() };
+	EXPECT_TRUE(observer.onReceiveVideoPacket(packet));
+	//the held packet went out in the slot of the second, then through the chain.
+	ASSERT_EQ(2u, chained.seen.size());
+	EXPECT_EQ(2, chained.seen[1]);
+	EXPECT_EQ(chained.buffer.data(), packet.buffer);
+	EXPECT_EQ(0xFE, packet.buffer[0]);
+
+	observer.Reset();
+	EXPECT_EQ(0u, observer.GetDownlink().GetStats().packets);
+	EXPECT_EQ(0u, observer.GetUplink().GetStats().packets);
+}
+
+TEST(NetworkImpairmentTest, ObserverLoadsScripts)
+{
+	CImpairedPacketObserver observer;
+	std::string error;
+	EXPECT_FALSE(observer.LoadScript("0 rate=fast\n", &error));
+	EXPECT_EQ(0u, error.find("line 1"));
+	ASSERT_TRUE(observer.LoadScript("0 up loss=100%\n", &error)) << error;
+	std::vector<uint8_t> data = MakePacket(0, 0);
+	agora::rtc::IPacketObserver::Packet packet = { data.data(), (unsigned int)data.size() };
+	EXPECT_FALSE(observer.onSendVideoPacket(packet));
+	packet = { data.data(), (unsigned int)data.size() };
+	EXPECT_TRUE(observer.onReceiveVideoPacket(packet));
+	EXPECT_EQ(data.data(), packet.buffer);
+	EXPECT_EQ(0, observer.GetUplink().GetStats().step);
+	EXPECT_EQ(-1, observer.GetDownlink().GetStats().step);
+}
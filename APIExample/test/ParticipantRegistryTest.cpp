@@ -0,0 +1,202 @@
+#include "Basic/LiveBroadcasting/ParticipantRegistry.h"
+#include <gtest/gtest.h>
+#include <random>
+#include <set>
+#include <vector>
+
+namespace {
+	//the windows of the dialog, kept up to date only through TakeChanges.
+	class CViews
+	{
+	public:
+		CViews() : m_uids(CParticipantRegistry::MAX_VIEWS, 0) {}
+
+		void Apply(CParticipantRegistry& registry)
+		{
+			std::vector<CParticipantRegistry::ViewChange> changes;
+			registry.TakeChanges(changes);
+			for (const CParticipantRegistry::ViewChange& change : changes) {
+				if (change.oldView != CParticipantRegistry::NO_VIEW) {
+					ASSERT_EQ(change.uid, m_uids[change.oldView]);
+					m_uids[change.oldView] = 0;
+				}
+				if (change.newView != CParticipantRegistry::NO_VIEW) {
+					ASSERT_EQ(0u, m_uids[change.newView]) << "view " << change.newView << " still taken";
+					m_uids[change.newView] = change.uid;
+				}
+			}
+		}
+		unsigned int Get(int view) const { return m_uids[view]; }
+
+	private:
+		std::vector<unsigned int> m_uids;
+	};
+
+	//every user is in at most one view, views are filled while users are hidden.
+	void CheckInvariants(const CParticipantRegistry& registry, const std::set<unsigned int>& users, const CViews& views)
+	{
+		ASSERT_EQ((int)users.size(), registry.GetUserCount());
+		int visible = 0;
+		std::set<unsigned int> shown;
+		for (int view = 0; view < registry.GetViewCount(); ++view) {
+			unsigned int uid = registry.GetViewUid(view);
+			ASSERT_EQ(uid, views.Get(view)) << "view " << view;
+			if (uid == 0)
+				continue;
+			++visible;
+			ASSERT_TRUE(users.count(uid));
+			ASSERT_TRUE(shown.insert(uid).second);
+			ASSERT_EQ(view, registry.GetView(uid));
+		}
+		ASSERT_EQ(visible, registry.GetVisibleCount());
+		ASSERT_EQ((std::min)((int)users.size(), registry.GetViewCount()), visible);
+		for (unsigned int uid : users) {
+			ASSERT_TRUE(registry.Contains(uid));
+			if (!shown.count(uid)) {
+				ASSERT_EQ(CParticipantRegistry::NO_VIEW, registry.GetView(uid));
+			}
+		}
+	}
+}
+
+TEST(ParticipantRegistryTest, FillsViewsInOrderAndHidesTheRest)
+{
+	CParticipantRegistry registry;
+	registry.SetViewCount(4);
+	CViews views;
+	ASSERT_TRUE(registry.AddUser(100, true));
+	for (unsigned int uid = 1; uid <= 5; ++uid)
+		ASSERT_TRUE(registry.AddUser(uid));
+	views.Apply(registry);
+	EXPECT_EQ(100u, registry.GetViewUid(0));
+	EXPECT_EQ(1u, registry.GetViewUid(1));
+	EXPECT_EQ(2u, registry.GetViewUid(2));
+	EXPECT_EQ(3u, registry.GetViewUid(3));
+	EXPECT_EQ(CParticipantRegistry::NO_VIEW, registry.GetView(4));
+	EXPECT_EQ(6, registry.GetUserCount());
+	EXPECT_EQ(4, registry.GetVisibleCount());
+
+	EXPECT_FALSE(registry.AddUser(3));
+	EXPECT_FALSE(registry.AddUser(0));
+	EXPECT_FALSE(registry.RemoveUser(42));
+
+	//a freed view goes to the first hidden user.
+	ASSERT_TRUE(registry.RemoveUser(2));
+	views.Apply(registry);
+	EXPECT_EQ(4u, registry.GetViewUid(2));
+	EXPECT_EQ(CParticipantRegistry::NO_VIEW, registry.GetView(5));
+}
+
+TEST(ParticipantRegistryTest, HiddenSpeakerTakesTheLeastRecentView)
+{
+	CParticipantRegistry registry;
+	registry.SetViewCount(4);
+	CViews views;
+	registry.AddUser(100, true);
+	for (unsigned int uid = 1; uid <= 6; ++uid)
+		registry.AddUser(uid);
+	views.Apply(registry);
+	//1, 2, 3 visible. 2 and 3 speak, so 1 spoke least recently.
+	registry.OnActiveSpeaker(2);
+	registry.OnActiveSpeaker(3);
+	int view = registry.GetView(1);
+	registry.OnActiveSpeaker(5);
+	views.Apply(registry);
+	EXPECT_EQ(view, registry.GetView(5));
+	EXPECT_EQ(CParticipantRegistry::NO_VIEW, registry.GetView(1));
+
+	//the pinned local user never gives its view away.
+	for (unsigned int uid = 1; uid <= 6; ++uid)
+		registry.OnActiveSpeaker(uid);
+	views.Apply(registry);
+	EXPECT_EQ(0, registry.GetView(100));
+	registry.OnActiveSpeaker(100);
+	registry.OnActiveSpeaker(999);
+	EXPECT_EQ(0, registry.GetView(100));
+}
+
+TEST(ParticipantRegistryTest, ShrinkingViewsHidesUsersFirstInLine)
+{
+	CParticipantRegistry registry;
+	registry.SetViewCount(9);
+	CViews views;
+	for (unsigned int uid = 1; uid <= 12; ++uid)
+		registry.AddUser(uid);
+	views.Apply(registry);
+	registry.SetViewCount(4);
+	views.Apply(registry);
+	EXPECT_EQ(4, registry.GetVisibleCount());
+	//growing again brings back the users that lost their view, not 10..12.
+	registry.SetViewCount(9);
+	views.Apply(registry);
+	for (unsigned int uid = 1; uid <= 9; ++uid)
+		EXPECT_NE(CParticipantRegistry::NO_VIEW, registry.GetView(uid)) << uid;
+}
+
+TEST(ParticipantRegistryTest, ViewsAbove32Work)
+{
+	//the free view bitmap is 64 bits, x86 scans it in two halves.
+	CParticipantRegistry registry;
+	registry.SetViewCount(CParticipantRegistry::MAX_VIEWS);
+	CViews views;
+	for (unsigned int uid = 1; uid <= 64; ++uid)
+		registry.AddUser(uid);
+	views.Apply(registry);
+	for (int view = 0; view < 64; ++view)
+		EXPECT_EQ((unsigned int)view + 1, registry.GetViewUid(view));
+	registry.RemoveUser(50);
+	registry.AddUser(1000);
+	views.Apply(registry);
+	EXPECT_EQ(49, registry.GetView(1000));
+}
+
+TEST(ParticipantRegistryTest, RandomChurnKeepsTheViewsConsistent)
+{
+	std::mt19937 random(7);
+	CParticipantRegistry registry;
+	CViews views;
+	std::set<unsigned int> users;
+	registry.SetViewCount(9);
+	for (int step = 0; step < 20000; ++step) {
+		int op = random() % 100;
+		unsigned int uid = 1 + random() % 300;
+		if (op < 45) {
+			ASSERT_EQ(!users.count(uid), registry.AddUser(uid));
+			users.insert(uid);
+		}
+		else if (op < 80) {
+			ASSERT_EQ(users.count(uid) != 0, registry.RemoveUser(uid));
+			users.erase(uid);
+		}
+		else if (op < 98) {
+			registry.OnActiveSpeaker(uid);
+			if (users.count(uid)) {
+				ASSERT_NE(CParticipantRegistry::NO_VIEW, registry.GetView(uid));
+			}
+		}
+		else {
+			registry.SetViewCount(1 + random() % 16);
+		}
+		views.Apply(registry);
+		CheckInvariants(registry, users, views);
+		if (HasFatalFailure())
+			return;
+	}
+	registry.Clear();
+	EXPECT_EQ(0, registry.GetUserCount());
+	EXPECT_EQ(0, registry.GetVisibleCount());
+}
+
+TEST(ParticipantRegistryTest, TracksThousandsOfUsers)
+{
+	CParticipantRegistry registry;
+	registry.SetViewCount(16);
+	for (unsigned int uid = 1; uid <= 10000; ++uid)
+		ASSERT_TRUE(registry.AddUser(uid * 7919));
+	for (unsigned int uid = 1; uid <= 10000; uid += 2)
+		ASSERT_TRUE(registry.RemoveUser(uid * 7919));
+	EXPECT_EQ(5000, registry.GetUserCount());
+	for (unsigned int uid = 1; uid <= 10000; ++uid)
+		EXPECT_EQ(uid % 2 == 0, registry.Contains(uid * 7919));
+	EXPECT_EQ(16, registry.GetVisibleCount());
+}
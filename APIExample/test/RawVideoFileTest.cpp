@@ -0,0 +1,267 @@
+#include "Advanced/MediaIOCustomVideoCaptrue/RawVideoFile.h"
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+	//a raw video file in the temp directory, removed again at the end.
+	class CTempVideo
+	{
+	public:
+		CTempVideo()
+		{
+			char path[] = "/tmp/RawVideoFileTestXXXXXX";
+			int fd = mkstemp(path);
+			if (fd >= 0)
+				close(fd);
+			m_path = path;
+		}
+		~CTempVideo() { remove(m_path.c_str()); }
+
+		//frames whose every byte is (frame index + byte offset) & 0xFF, then extra bytes.
+		void Write(size_t frameSize, int frames, size_t extra = 0)
+		{
+			FILE* file = fopen(m_path.c_str(), "wb");
+			ASSERT_NE(nullptr, file);
+			std::vector<uint8_t> frame(frameSize);
+			for (int i = 0; i < frames; ++i) {
+				for (size_t b = 0; b < frameSize; ++b)
+					frame[b] = (uint8_t)(i + b);
+				fwrite(frame.data(), 1, frameSize, file);
+			}
+			std::vector<uint8_t> tail(extra, 0xEE);
+			fwrite(tail.data(), 1, extra, file);
+			fclose(file);
+		}
+		//a sparse file of the given size, only the given frame written.
+		void WriteSparse(int64_t size, size_t frameSize, int64_t frame)
+		{
+			FILE* file = fopen(m_path.c_str(), "wb");
+			ASSERT_NE(nullptr, file);
+			ASSERT_EQ(0, ftruncate(fileno(file), (off_t)size));
+			std::vector<uint8_t> data(frameSize);
+			for (size_t b = 0; b < frameSize; ++b)
+				data[b] = (uint8_t)(frame + b);
+			ASSERT_EQ(0, fseeko(file, (off_t)(frame * (int64_t)frameSize), SEEK_SET));
+			fwrite(data.data(), 1, frameSize, file);
+			fclose(file);
+		}
+		const char* GetPath() const { return m_path.c_str(); }
+
+	private:
+		std::string m_path;
+	};
+
+	bool FrameHolds(const RawVideoFrame& frame, int index)
+	{
+		for (size_t b = 0; b < frame.size; ++b) {
+			if (frame.data[b] != (uint8_t)(index + b))
+				return false;
+		}
+		return true;
+	}
+}
+
+TEST(RawVideoFileTest, FrameSizes)
+{
+	EXPECT_EQ(1920u * 1080 * 3 / 2, CRawVideoFile::GetFrameSize(RAW_VIDEO_I420, 1920, 1080));
+	EXPECT_EQ(1920u * 1080 * 3 / 2, CRawVideoFile::GetFrameSize(RAW_VIDEO_NV12, 1920, 1080));
+	EXPECT_EQ(1920u * 1080 * 4, CRawVideoFile::GetFrameSize(RAW_VIDEO_RGBA, 1920, 1080));
+	//odd sizes round the chroma planes up.
+	EXPECT_EQ(33u * 17 + 2 * 17 * 9, CRawVideoFile::GetFrameSize(RAW_VIDEO_I420, 33, 17));
+	EXPECT_EQ(0u, CRawVideoFile::GetFrameSize(RAW_VIDEO_I420, 0, 17));
+}
+
+TEST(RawVideoFileTest, OpensWholeFramesOnly)
+{
+	CTempVideo video;
+	size_t frameSize = CRawVideoFile::GetFrameSize(RAW_VIDEO_I420, 64, 48);
+	video.Write(frameSize, 10, frameSize / 2);
+	CRawVideoFile file;
+	ASSERT_TRUE(file.Open(video.GetPath(), RAW_VIDEO_I420, 64, 48));
+	EXPECT_TRUE(file.IsOpen());
+	EXPECT_EQ(10, file.GetFrameCount());
+	EXPECT_EQ(frameSize, file.GetFrameSize());
+	//less than a frame, or a missing file, does not open.
+	EXPECT_FALSE(file.Open(video.GetPath(), RAW_VIDEO_RGBA, 640, 480));
+	EXPECT_FALSE(file.IsOpen());
+	EXPECT_FALSE(file.Open("/nonexistent/screen.yuv", RAW_VIDEO_I420, 64, 48));
+}
+
+TEST(RawVideoFileTest, PlanesOfEachFormat)
+{
+	CTempVideo video;
+	video.Write(CRawVideoFile::GetFrameSize(RAW_VIDEO_RGBA, 33, 17), 3);
+	struct Case {
+		RawVideoFormat format;
+		size_t plane1, plane2;
+		int strides[3];
+	};
+	const Case cases[] = {
+		{ RAW_VIDEO_I420, 33 * 17, 33 * 17 + 17 * 9, { 33, 17, 17 } },
+		{ RAW_VIDEO_NV12, 33 * 17, 0, { 33, 34, 0 } },
+		{ RAW_VIDEO_RGBA, 0, 0, { 132, 0, 0 } },
+	};
+	for (const Case& c : cases) {
+		std::shared_ptr<CRawVideoFile> file = std::make_shared<CRawVideoFile>();
+		ASSERT_TRUE(file->Open(video.GetPath(), c.format, 33, 17));
+		CRawVideoWindow window(file);
+		RawVideoFrame frame;
+		ASSERT_TRUE(window.GetFrame(file->GetFrameCount() - 1, frame));
+		EXPECT_EQ(c.format, frame.format);
+		EXPECT_EQ(frame.data, frame.planes[0]);
+		EXPECT_EQ(c.plane1 ? frame.data + c.plane1 : nullptr, frame.planes[1]);
+		EXPECT_EQ(c.plane2 ? frame.data + c.plane2 : nullptr, frame.planes[2]);
+		for (int p = 0; p < 3; ++p)
+			EXPECT_EQ(c.strides[p], frame.strides[p]) << c.format << " plane " << p;
+		EXPECT_FALSE(window.GetFrame(file->GetFrameCount(), frame));
+		EXPECT_FALSE(window.GetFrame(-1, frame));
+	}
+}
+
+TEST(RawVideoFileTest, WindowSlidesOverFramesNotPageAligned)
+{
+	//frames of 1173 bytes never line up with pages, a window holds 5.
+	CTempVideo video;
+	size_t frameSize = CRawVideoFile::GetFrameSize(RAW_VIDEO_I420, 33, 17);
+	video.Write(frameSize, 23);
+	std::shared_ptr<CRawVideoFile> file = std::make_shared<CRawVideoFile>();
+	ASSERT_TRUE(file->Open(video.GetPath(), RAW_VIDEO_I420, 33, 17));
+	CRawVideoWindow window(file, frameSize * 5 + 100);
+	EXPECT_EQ(5, window.GetWindowFrames());
+	RawVideoFrame frame;
+	for (int i = 0; i < 23; ++i) {
+		ASSERT_TRUE(window.GetFrame(i, frame));
+		EXPECT_EQ(i, frame.index);
+		EXPECT_TRUE(FrameHolds(frame, i)) << i;
+	}
+	//0, 5, 10, 15 and 20: the last window is short.
+	EXPECT_EQ(5u, window.GetMapCount());
+	//inside the window nothing is mapped again, outside it moves.
+	ASSERT_TRUE(window.GetFrame(21, frame));
+	EXPECT_EQ(5u, window.GetMapCount());
+	ASSERT_TRUE(window.GetFrame(3, frame));
+	EXPECT_TRUE(FrameHolds(frame, 3));
+	EXPECT_EQ(6u, window.GetMapCount());
+
+	//a window smaller than a frame still holds one.
+	CRawVideoWindow tiny(file, 10);
+	EXPECT_EQ(1, tiny.GetWindowFrames());
+	ASSERT_TRUE(tiny.GetFrame(22, frame));
+	EXPECT_TRUE(FrameHolds(frame, 22));
+}
+
+TEST(RawVideoFileTest, MapsFramesPast4GB)
+{
+	//a sparse 4.6 GB file, a 1080p frame read at an offset past 4 GB
+	//through a window of a few frames.
+	CTempVideo video;
+	size_t frameSize = CRawVideoFile::GetFrameSize(RAW_VIDEO_I420, 1920, 1080);
+	const int64_t frames = 1500;
+	const int64_t last = frames - 1;
+	video.WriteSparse(frames * (int64_t)frameSize, frameSize, last);
+	std::shared_ptr<CRawVideoFile> file = std::make_shared<CRawVideoFile>();
+	ASSERT_TRUE(file->Open(video.GetPath(), RAW_VIDEO_I420, 1920, 1080));
+	EXPECT_EQ(frames, file->GetFrameCount());
+	CRawVideoWindow window(file, frameSize * 4);
+	RawVideoFrame frame;
+	ASSERT_TRUE(window.GetFrame((int)last, frame));
+	EXPECT_TRUE(FrameHolds(frame, (int)last));
+	ASSERT_TRUE(window.GetFrame(0, frame));
+	EXPECT_EQ(0, frame.data[0]);
+}
+
+TEST(RawVideoFileTest, ReaderPacesAndLoops)
+{
+	CTempVideo video;
+	size_t frameSize = CRawVideoFile::GetFrameSize(RAW_VIDEO_I420, 32, 32);
+	video.Write(frameSize, 7);
+	std::shared_ptr<CRawVideoFile> file = std::make_shared<CRawVideoFile>();
+	ASSERT_TRUE(file->Open(video.GetPath(), RAW_VIDEO_I420, 32, 32));
+	CRawVideoReader reader(file);
+	reader.SetFrameRate(15);
+	//2 s polled every ms: frames at 0, 66, 133, ... 1933 ms and 2000 ms.
+	int delivered = 0;
+	int expectedIndex = 0;
+	for (int64_t now = 1000; now <= 3000; ++now) {
+		RawVideoFrame frame;
+		if (reader.NextFrame(now, frame)) {
+			ASSERT_EQ(expectedIndex, frame.index);
+			ASSERT_TRUE(FrameHolds(frame, frame.index));
+			expectedIndex = (expectedIndex + 1) % 7;
+			++delivered;
+		}
+		else {
+			EXPECT_GT(reader.GetWaitMs(now), 0);
+		}
+	}
+	EXPECT_EQ(31, delivered);
+	EXPECT_EQ(0u, reader.GetLateCount());
+	EXPECT_FALSE(reader.IsFinished());
+}
+
+TEST(RawVideoFileTest, ReaderStopsAtTheEndAndResyncsAfterAStall)
+{
+	CTempVideo video;
+	size_t frameSize = CRawVideoFile::GetFrameSize(RAW_VIDEO_I420, 32, 32);
+	video.Write(frameSize, 7);
+	std::shared_ptr<CRawVideoFile> file = std::make_shared<CRawVideoFile>();
+	ASSERT_TRUE(file->Open(video.GetPath(), RAW_VIDEO_I420, 32, 32));
+
+	CRawVideoReader once(file);
+	once.SetLoop(false);
+	once.SetFrameRate(10);
+	EXPECT_FALSE(once.Seek(7));
+	ASSERT_TRUE(once.Seek(5));
+	RawVideoFrame frame;
+	int64_t now = 0;
+	ASSERT_TRUE(once.NextFrame(now, frame));
+	EXPECT_EQ(5, frame.index);
+	ASSERT_TRUE(once.NextFrame(now += 100, frame));
+	EXPECT_EQ(6, frame.index);
+	EXPECT_TRUE(once.IsFinished());
+	EXPECT_FALSE(once.NextFrame(now += 100, frame));
+
+	//a reader stalled for a second takes the next frame now and goes on
+	//from there instead of delivering the missed ones in a burst.
+	CRawVideoReader stalled(file);
+	stalled.SetFrameRate(10);
+	now = 0;
+	ASSERT_TRUE(stalled.NextFrame(now, frame));
+	now += 1000;
+	ASSERT_TRUE(stalled.NextFrame(now, frame));
+	EXPECT_EQ(1u, stalled.GetLateCount());
+	EXPECT_FALSE(stalled.NextFrame(now + 1, frame));
+	EXPECT_EQ(99, stalled.GetWaitMs(now + 1));
+	EXPECT_EQ(2u, stalled.GetDeliveredCount());
+}
+
+TEST(RawVideoFileTest, ReadersShareOneFile)
+{
+	CTempVideo video;
+	size_t frameSize = CRawVideoFile::GetFrameSize(RAW_VIDEO_NV12, 16, 16);
+	video.Write(frameSize, 50);
+	std::shared_ptr<CRawVideoFile> file = std::make_shared<CRawVideoFile>();
+	ASSERT_TRUE(file->Open(video.GetPath(), RAW_VIDEO_NV12, 16, 16));
+	std::vector<std::unique_ptr<CRawVideoReader>> readers;
+	for (int r = 0; r < 8; ++r) {
+		readers.emplace_back(new CRawVideoReader(file));
+		readers.back()->SetFrameRate(1000);
+		readers.back()->Seek(r * 6);
+	}
+	for (int64_t now = 0; now < 200; ++now) {
+		for (int r = 0; r < 8; ++r) {
+			RawVideoFrame frame;
+			ASSERT_TRUE(readers[r]->NextFrame(now, frame));
+			ASSERT_EQ((r * 6 + now) % 50, frame.index);
+			ASSERT_TRUE(FrameHolds(frame, frame.index));
+		}
+	}
+	//the readers keep the file alive.
+	file.reset();
+	RawVideoFrame frame;
+	EXPECT_TRUE(readers[0]->NextFrame(200, frame));
+}
@@ -0,0 +1,346 @@
+#include "Advanced/ScreenShare/ScreenShareController.h"
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <vector>
+
+namespace {
+	//the dialog samples a 128x72 luma thumbnail of the shared area every 200 ms.
+	const int WIDTH = 128;
+	const int HEIGHT = 72;
+	const int64_t INTERVAL = 200;
+
+	typedef std::vector<uint8_t> Frame;
+
+	uint32_t Hash(uint32_t a, uint32_t b, uint32_t c)
+	{
+		uint32_t h = a * 0x9E3779B1u ^ b * 0x85EBCA77u ^ c * 0xC2B2AE3Du;
+		h ^= h >> 15;
+		h *= 0x2C1B3C6Du;
+		h ^= h >> 12;
+		return h;
+	}
+
+	//a page of text: dark glyphs on a light background, lines of text
+	//separated by blank rows, a margin around it.
+	void DrawText(Frame& frame, uint32_t document, int firstLine, int scrollPixels, int lines)
+	{
+		for (int y = 0; y < HEIGHT; ++y) {
+			//text rows are 6 pixels, 4 of them glyphs.
+			int docY = y + scrollPixels;
+			int line = docY / 6;
+			bool glyphRow = docY % 6 < 4 && line - firstLine < lines;
+			for (int x = 0; x < WIDTH; ++x) {
+				uint8_t value = 235;
+				if (glyphRow && x >= 8 && x < WIDTH - 8) {
+					//glyphs are 3 pixels wide, some lines end early.
+					uint32_t h = Hash(document, (uint32_t)line, (uint32_t)(x / 3));
+					int lineLength = 40 + (int)(Hash(document, (uint32_t)line, 0) % (WIDTH - 56));
+					if (x < 8 + lineLength && h % 3 != 0)
+						value = 30;
+				}
+				frame[(size_t)y * WIDTH + x] = value;
+			}
+		}
+	}
+
+	//video: every sample shows a different picture.
+	void DrawVideo(Frame& frame, int index)
+	{
+		for (int y = 0; y < HEIGHT; ++y) {
+			for (int x = 0; x < WIDTH; ++x)
+				frame[(size_t)y * WIDTH + x] = (uint8_t)(Hash((uint32_t)index, (uint32_t)(y / 4), (uint32_t)(x / 4)) & 0xFF);
+		}
+	}
+
+	//a recorded share session, one entry per sample.
+	struct Recording {
+		std::vector<Frame> frames;
+		std::vector<int> cpu;
+
+		void Add(const Frame& frame, int cpuUsage = 30)
+		{
+			frames.push_back(frame);
+			cpu.push_back(cpuUsage);
+		}
+		int64_t Duration() const { return (int64_t)frames.size() * INTERVAL; }
+		//samples for ms milliseconds.
+		static int Samples(int64_t ms) { return (int)(ms / INTERVAL); }
+
+		//a slide deck: one page for pageMs each.
+		void AddSlides(int pages, int64_t pageMs, uint32_t firstPage = 1)
+		{
+			Frame frame(WIDTH * HEIGHT);
+			for (int page = 0; page < pages; ++page) {
+				DrawText(frame, firstPage + page, 0, 0, 6 + page % 5);
+				for (int i = 0; i < Samples(pageMs); ++i)
+					Add(frame);
+			}
+		}
+		//an editor: one more glyph is typed every sample.
+		void AddTyping(int64_t ms)
+		{
+			Frame frame(WIDTH * HEIGHT);
+			DrawText(frame, 77, 0, 0, 8);
+			for (int i = 0; i < Samples(ms); ++i) {
+				int x = 8 + (i * 3) % (WIDTH - 16);
+				int y = 50 + (i * 3) / (WIDTH - 16) % 3 * 6;
+				for (int dy = 0; dy < 4; ++dy) {
+					for (int dx = 0; dx < 2; ++dx)
+						frame[(size_t)(y + dy) * WIDTH + x + dx] = 30;
+				}
+				Add(frame);
+			}
+		}
+		//a document scrolled by pixelsPerSample.
+		void AddScrolling(int64_t ms, int pixelsPerSample)
+		{
+			Frame frame(WIDTH * HEIGHT);
+			for (int i = 0; i < Samples(ms); ++i) {
+				DrawText(frame, 500, 0, i * pixelsPerSample, 1 << 20);
+				Add(frame);
+			}
+		}
+		void AddVideo(int64_t ms, int cpuUsage = 30)
+		{
+			Frame frame(WIDTH * HEIGHT);
+			int first = (int)frames.size();
+			for (int i = 0; i < Samples(ms); ++i) {
+				DrawVideo(frame, first + i);
+				Add(frame, cpuUsage);
+			}
+		}
+	};
+
+	//the mode after every sample, fed the way the dialog's sampling thread does.
+	struct Replay {
+		std::vector<CScreenShareController::Mode> modes;
+		std::vector<int> cpuLevels;
+		std::vector<ScreenShareProfile> targets;
+		int changes = 0;
+
+		Replay(CScreenShareController& controller, const Recording& recording)
+		{
+			for (size_t i = 0; i < recording.frames.size(); ++i) {
+				int64_t now = (int64_t)(i + 1) * INTERVAL;
+				controller.OnLumaFrame(recording.frames[i].data(), WIDTH, HEIGHT, WIDTH, now);
+				controller.OnCpuUsage(recording.cpu[i], now);
+				if (controller.Evaluate(now))
+					++changes;
+				modes.push_back(controller.GetMode());
+				cpuLevels.push_back(controller.GetCpuLevel());
+				targets.push_back(controller.GetTarget());
+			}
+		}
+		CScreenShareController::Mode ModeAt(int64_t ms) const { return modes[Recording::Samples(ms) - 1]; }
+		//first time at or after fromMs the mode is mode, -1 if never.
+		int64_t FirstAt(CScreenShareController::Mode mode, int64_t fromMs) const
+		{
+			for (size_t i = Recording::Samples(fromMs); i < modes.size(); ++i) {
+				if (modes[i] == mode)
+					return (int64_t)(i + 1) * INTERVAL;
+			}
+			return -1;
+		}
+		int Switches() const
+		{
+			int switches = 0;
+			for (size_t i = 1; i < modes.size(); ++i)
+				switches += modes[i] != modes[i - 1];
+			return switches;
+		}
+	};
+
+	void SetDefaultProfiles(CScreenShareController& controller)
+	{
+		ScreenShareProfile staticProfile, motionProfile;
+		staticProfile.width = 1920;
+		staticProfile.height = 1080;
+		staticProfile.frameRate = 5;
+		staticProfile.bitrate = 2000;
+		motionProfile.width = 1280;
+		motionProfile.height = 720;
+		motionProfile.frameRate = 15;
+		motionProfile.bitrate = 2000;
+		controller.SetProfiles(staticProfile, motionProfile);
+		controller.Reset();
+	}
+}
+
+TEST(ScreenShareControllerTest, SlidesStayStatic)
+{
+	//every page flip changes most of the screen for a single sample.
+	Recording recording;
+	recording.AddSlides(12, 5000);
+	CScreenShareController controller;
+	SetDefaultProfiles(controller);
+	Replay replay(controller, recording);
+	EXPECT_EQ(0, replay.Switches());
+	EXPECT_EQ(CScreenShareController::MODE_STATIC, replay.modes.back());
+	EXPECT_EQ(1920, replay.targets.back().width);
+	EXPECT_EQ(5, replay.targets.back().frameRate);
+	//the first evaluation reports the initial target, nothing after it.
+	EXPECT_EQ(1, replay.changes);
+}
+
+TEST(ScreenShareControllerTest, FastSlideFlippingStaysStatic)
+{
+	//paging through a deck looking for a slide, a page a second.
+	Recording recording;
+	recording.AddSlides(20, 1000);
+	CScreenShareController controller;
+	SetDefaultProfiles(controller);
+	Replay replay(controller, recording);
+	EXPECT_EQ(0, replay.Switches());
+}
+
+TEST(ScreenShareControllerTest, TypingInAnEditorStaysStatic)
+{
+	Recording recording;
+	recording.AddTyping(30000);
+	CScreenShareController controller;
+	SetDefaultProfiles(controller);
+	Replay replay(controller, recording);
+	EXPECT_EQ(0, replay.Switches());
+	EXPECT_LT(controller.GetChangeRate(), 0.02);
+}
+
+TEST(ScreenShareControllerTest, ScrollingSwitchesToMotionAndBack)
+{
+	Recording recording;
+	recording.AddSlides(1, 5000);
+	recording.AddScrolling(6000, 3);
+	recording.AddSlides(1, 10000, 9);
+	CScreenShareController controller;
+	SetDefaultProfiles(controller);
+	Replay replay(controller, recording);
+
+	//motion well within 1.5 s of the scrolling starting.
+	int64_t entered = replay.FirstAt(CScreenShareController::MODE_MOTION, 5000);
+	ASSERT_GT(entered, 0);
+	EXPECT_LE(entered - 5000, 1500);
+	EXPECT_EQ(CScreenShareController::MODE_MOTION, replay.ModeAt(10800));
+	EXPECT_EQ(1280, replay.targets[Recording::Samples(10800) - 1].width);
+	EXPECT_EQ(15, replay.targets[Recording::Samples(10800) - 1].frameRate);
+
+	//back to static within 6 s of the screen going still, not before 3 s.
+	int64_t left = replay.FirstAt(CScreenShareController::MODE_STATIC, 11000);
+	ASSERT_GT(left, 0);
+	EXPECT_GE(left - 11000, 3000);
+	EXPECT_LE(left - 11000, 6000);
+	EXPECT_EQ(2, replay.Switches());
+}
+
+TEST(ScreenShareControllerTest, ShortScrollsDoNotFlap)
+{
+	//scrolling to the next paragraph: 400 ms of scrolling every 4 s.
+	Recording recording;
+	for (int i = 0; i < 8; ++i) {
+		recording.AddScrolling(400, 6);
+		recording.AddSlides(1, 3600, 20 + i);
+	}
+	CScreenShareController controller;
+	SetDefaultProfiles(controller);
+	Replay replay(controller, recording);
+	EXPECT_EQ(0, replay.Switches());
+}
+
+TEST(ScreenShareControllerTest, VideoStaysInMotionThroughStillScenes)
+{
+	//a clip with a 2 s still scene in the middle stays in motion.
+	Recording recording;
+	recording.AddSlides(1, 3000);
+	recording.AddVideo(8000);
+	recording.AddSlides(1, 2000, 3);
+	recording.AddVideo(8000);
+	CScreenShareController controller;
+	SetDefaultProfiles(controller);
+	Replay replay(controller, recording);
+	int64_t entered = replay.FirstAt(CScreenShareController::MODE_MOTION, 3000);
+	ASSERT_GT(entered, 0);
+	EXPECT_LE(entered - 3000, 1500);
+	EXPECT_EQ(1, replay.Switches());
+	EXPECT_GT(controller.GetChangeRate(), 0.5);
+}
+
+TEST(ScreenShareControllerTest, CpuOverBudgetStepsDownAndRecovers)
+{
+	CScreenShareController controller;
+	SetDefaultProfiles(controller);
+	controller.SetCpuBudget(70);
+	Recording recording;
+	//video at 90% CPU for 6 s, then 30% for 20 s.
+	recording.AddVideo(6000, 90);
+	recording.AddVideo(20000, 30);
+	Replay replay(controller, recording);
+
+	//one level per 2 s over budget, never past the last one.
+	EXPECT_EQ(0, replay.cpuLevels[Recording::Samples(1800) - 1]);
+	EXPECT_EQ(1, replay.cpuLevels[Recording::Samples(2200) - 1]);
+	EXPECT_EQ(2, replay.cpuLevels[Recording::Samples(4200) - 1]);
+	EXPECT_EQ(2, replay.cpuLevels[Recording::Samples(6000) - 1]);
+	const ScreenShareProfile& reduced = replay.targets[Recording::Samples(6000) - 1];
+	EXPECT_EQ(720, reduced.width);
+	EXPECT_EQ(404, reduced.height);
+	EXPECT_EQ(6, reduced.frameRate);
+	EXPECT_EQ(632, reduced.bitrate);
+
+	//one level back per 8 s with headroom.
+	EXPECT_EQ(2, replay.cpuLevels[Recording::Samples(13800) - 1]);
+	EXPECT_EQ(1, replay.cpuLevels[Recording::Samples(14200) - 1]);
+	EXPECT_EQ(0, replay.cpuLevels[Recording::Samples(22200) - 1]);
+	EXPECT_EQ(1280, replay.targets.back().width);
+	EXPECT_EQ(15, replay.targets.back().frameRate);
+}
+
+TEST(ScreenShareControllerTest, CpuInsideTheHeadroomHoldsTheLevel)
+{
+	CScreenShareController controller;
+	SetDefaultProfiles(controller);
+	controller.SetCpuBudget(70);
+	Frame still(WIDTH * HEIGHT);
+	DrawText(still, 1, 0, 0, 8);
+	//over budget for 3 s, then between budget - headroom and budget.
+	Recording recording;
+	for (int i = 0; i < Recording::Samples(3000); ++i)
+		recording.Add(still, 90);
+	for (int i = 0; i < Recording::Samples(20000); ++i)
+		recording.Add(still, 62);
+	Replay replay(controller, recording);
+	EXPECT_EQ(1, replay.cpuLevels.back());
+	//a spike that does not last resets the timer.
+	Recording spiky;
+	for (int i = 0; i < Recording::Samples(20000); ++i)
+		spiky.Add(still, i % 8 < 7 ? 90 : 40);
+	controller.Reset();
+	Replay spikyReplay(controller, spiky);
+	EXPECT_EQ(0, spikyReplay.cpuLevels.back());
+}
+
+TEST(ScreenShareControllerTest, OddFrameSizesAndReset)
+{
+	CScreenShareController controller;
+	SetDefaultProfiles(controller);
+	//too small to make a thumbnail of, ignored.
+	std::vector<uint8_t> tiny(16 * 9, 100);
+	controller.OnLumaFrame(tiny.data(), 16, 9, 16, 0);
+	EXPECT_TRUE(controller.Evaluate(0));
+	EXPECT_FALSE(controller.Evaluate(200));
+
+	//padded rows and sizes that do not divide into the cells.
+	const int width = 333, height = 101, stride = 352;
+	std::vector<uint8_t> frame((size_t)stride * height);
+	for (int i = 0; i < 30; ++i) {
+		for (int y = 0; y < height; ++y) {
+			for (int x = 0; x < stride; ++x)
+				frame[(size_t)y * stride + x] = x < width ? (uint8_t)(Hash(i, y / 5, x / 5) & 0xFF) : 0;
+		}
+		controller.OnLumaFrame(frame.data(), width, height, stride, i * INTERVAL);
+		controller.Evaluate(i * INTERVAL);
+	}
+	EXPECT_EQ(CScreenShareController::MODE_MOTION, controller.GetMode());
+	controller.Reset();
+	EXPECT_EQ(CScreenShareController::MODE_STATIC, controller.GetMode());
+	EXPECT_EQ(0.0, controller.GetChangeRate());
+	EXPECT_TRUE(controller.Evaluate(0));
+	EXPECT_EQ(1920, controller.GetTarget().width);
+}
@@ -0,0 +1,136 @@
+#include "crypto/Sha256.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+//FIPS 180-4 examples for SHA-256, RFC 4231 for HMAC-SHA256 and RFC 5869
+//for HKDF-SHA256.
+
+namespace {
+	std::vector<uint8_t> FromHex(const char* hex)
+	{
+		std::vector<uint8_t> bytes;
+		for (; hex[0] && hex[1]; hex += 2)
+			bytes.push_back((uint8_t)std::stoi(std::string(hex, 2), nullptr, 16));
+		return bytes;
+	}
+
+	std::string ToHex(const uint8_t* bytes, size_t size)
+	{
+		static const char digits[] = "0123456789abcdef";
+		std::string hex;
+		for (size_t i = 0; i < size; ++i) {
+			hex += digits[bytes[i] >> 4];
+			hex += digits[bytes[i] & 15];
+		}
+		return hex;
+	}
+
+	std::string Sha256Hex(const std::string& message)
+	{
+		uint8_t digest[CSha256::DIGEST_SIZE];
+		CSha256::Hash(message.data(), message.size(), digest);
+		return ToHex(digest, sizeof(digest));
+	}
+
+	std::string HmacHex(const std::vector<uint8_t>& key, const std::string& message)
+	{
+		CHmacSha256 hmac;
+		hmac.SetKey(key.data(), key.size());
+		uint8_t mac[CSha256::DIGEST_SIZE];
+		hmac.Compute(message.data(), message.size(), mac);
+		return ToHex(mac, sizeof(mac));
+	}
+}
+
+TEST(Sha256Test, MatchesTheFips180Examples)
+{
+	EXPECT_EQ("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855", Sha256Hex(""));
+	EXPECT_EQ("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", Sha256Hex("abc"));
+	EXPECT_EQ("248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+		Sha256Hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"));
+	EXPECT_EQ("cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1",
+		Sha256Hex("abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu"));
+	EXPECT_EQ("cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0", Sha256Hex(std::string(1000000, 'a')));
+}
+
+TEST(Sha256Test, HashesInPartsAsInOne)
+{
+	std::string message(1000, 'x');
+	for (size_t i = 0; i < message.size(); ++i)
+		message[i] = (char)(i * 7);
+	uint8_t whole[CSha256::DIGEST_SIZE];
+	CSha256::Hash(message.data(), message.size(), whole);
+	//splits on and around the block boundary.
+	const size_t splits[] = { 1, 55, 56, 63, 64, 65, 127, 500 };
+	for (size_t split : splits) {
+		CSha256 sha;
+		sha.Update(message.data(), split);
+		sha.Update(message.data() + split, message.size() - split);
+		uint8_t parts[CSha256::DIGEST_SIZE];
+		sha.Final(parts);
+		EXPECT_EQ(ToHex(whole, sizeof(whole)), ToHex(parts, sizeof(parts))) << split;
+	}
+}
+
+TEST(Sha256Test, MatchesTheRfc4231HmacVectors)
+{
+	EXPECT_EQ("b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7",
+		HmacHex(std::vector<uint8_t>(20, 0x0b), "Hi There"));
+	EXPECT_EQ("5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843",
+		HmacHex(FromHex("4a656665"), "what do ya want for nothing?"));
+	//a key longer than the block is hashed first.
+	EXPECT_EQ("60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54",
+		HmacHex(std::vector<uint8_t>(131, 0xaa), "Test Using Larger Than Block-Size Key - Hash Key First"));
+}
+
+TEST(Sha256Test, MatchesTheRfc5869HkdfVectors)
+{
+	const struct {
+		const char* ikm;
+		const char* salt;
+		const char* info;
+		const char* prk;
+		const char* okm;
+	} cases[] = {
+		{ "0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b", "000102030405060708090a0b0c", "f0f1f2f3f4f5f6f7f8f9",
+			"077709362c2e32df0ddc3f0dc47bba6390b6c73bb50f9c3122ec844ad7c2b3e5",
+			"3cb25f25faacd57a90434f64d0362f2a2d2d0a90cf1a5a4c5db02d56ecc4c5bf34007208d5b887185865" },
+		{ "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f202122232425262728292a2b2c2d2e2f"
+			"303132333435363738393a3b3c3d3e3f404142434445464748494a4b4c4d4e4f",
+			"606162636465666768696a6b6c6d6e6f707172737475767778797a7b7c7d7e7f808182838485868788898a8b8c8d8e8f"
+			"909192939495969798999a9b9c9d9e9fa0a1a2a3a4a5a6a7a8a9aaabacadaeaf",
+			"b0b1b2b3b4b5b6b7b8b9babbbcbdbebfc0c1c2c3c4c5c6c7c8c9cacbcccdcecfd0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+			"e0e1e2e3e4e5e6e7e8e9eaebecedeeeff0f1f2f3f4f5f6f7f8f9fafbfcfdfeff",
+			"06a6b88c5853361a06104c9ceb35b45cef760014904671014a193f40c15fc244",
+			"b11e398dc80327a1c8e7f78c596a49344f012eda2d4efad8a050cc4c19afa97c59045a99cac7827271cb41c65e590e09"
+			"da3275600c2f09b8367793a9aca3db71cc30c58179ec3e87c14c01d5c1f3434f1d87" },
+		//no salt and no info.
+		{ "0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b", "", "",
+			"19ef24a32c717b167f33a91d6f648bdf96596776afdb6377ac434c1c293ccb04",
+			"8da4e775a563c18f715f802a063c5a31b8a11f5c5ee1879ec3454e5f3c738d2d9d201395faa4b61a96c8" },
+	};
+	for (auto& test : cases) {
+		std::vector<uint8_t> ikm = FromHex(test.ikm);
+		std::vector<uint8_t> salt = FromHex(test.salt);
+		std::vector<uint8_t> info = FromHex(test.info);
+		uint8_t prk[CSha256::DIGEST_SIZE];
+		HkdfExtract(salt.data(), salt.size(), ikm.data(), ikm.size(), prk);
+		EXPECT_EQ(test.prk, ToHex(prk, sizeof(prk)));
+		std::vector<uint8_t> okm(strlen(test.okm) / 2);
+		ASSERT_TRUE(Hkdf(salt.data(), salt.size(), ikm.data(), ikm.size(), info.data(), info.size(), okm.data(), okm.size()));
+		EXPECT_EQ(test.okm, ToHex(okm.data(), okm.size()));
+		//the keyed expand gives the same bytes.
+		CHmacSha256 keyed;
+		keyed.SetKey(prk, sizeof(prk));
+		std::vector<uint8_t> expanded(okm.size());
+		ASSERT_TRUE(HkdfExpand(keyed, info.data(), info.size(), expanded.data(), expanded.size()));
+		EXPECT_EQ(okm, expanded);
+	}
+	//at most 255 blocks.
+	uint8_t prk[CSha256::DIGEST_SIZE] = { 0 };
+	CHmacSha256 keyed;
+	keyed.SetKey(prk, sizeof(prk));
+	std::vector<uint8_t> tooLong(255 * CSha256::DIGEST_SIZE + 1);
+	EXPECT_FALSE(HkdfExpand(keyed, nullptr, 0, tooLong.data(), tooLong.size()));
+}
@@ -0,0 +1,132 @@
+#include "StringTable.h"
+#include <gtest/gtest.h>
+#include <ctype.h>
+#include <set>
+#include <sstream>
+#include <stdio.h>
+#include <string>
+
+namespace {
+	CStringTable ParseText(const std::wstring& text)
+	{
+		CStringTable table;
+		table.Parse(text.c_str(), text.size());
+		return table;
+	}
+
+	std::wstring Value(const CStringTable& table, const wchar_t* section, const wchar_t* key)
+	{
+		int index = table.Find(section, key);
+		return index == CStringTable::NOT_FOUND ? L"<missing>" : table.GetValue(index);
+	}
+
+	std::string Trim(const std::string& text)
+	{
+		size_t begin = 0, end = text.size();
+		while (begin < end && isspace((unsigned char)text[begin])) ++begin;
+		while (end > begin && isspace((unsigned char)text[end - 1])) --end;
+		return text.substr(begin, end - begin);
+	}
+
+	//en.ini from the sources, it is ASCII.
+	bool ReadFile(const char* path, std::string& data)
+	{
+		FILE* file = fopen(path, "rb");
+		if (!file)
+			return false;
+		char buffer[4096];
+		size_t read;
+		while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+			data.append(buffer, read);
+		fclose(file);
+		return true;
+	}
+}
+
+TEST(StringTableTest, FollowsTheProfileRules)
+{
+	CStringTable table = ParseText(
+		L"Orphan=before any section\r\n"
+		L"[General]\r\n"
+		L"  Scene.Name  =  Live Broadcasting  \r\n"
+		L"; Scene.Name=commented out\n"
+		L"Quoted=\"  kept blanks  \"\n"
+		L"Single='x'\n"
+		L"Half=\"open\n"
+		L"scene.name=duplicate\n"
+		L"NoValue=\n"
+		L"not a pair\n"
+		L"[ Other ]\n"
+		L"Scene.Name=other section");
+	EXPECT_EQ(L"Live Broadcasting", Value(table, L"General", L"Scene.Name"));
+	EXPECT_EQ(L"  kept blanks  ", Value(table, L"General", L"Quoted"));
+	EXPECT_EQ(L"x", Value(table, L"General", L"Single"));
+	EXPECT_EQ(L"\"open", Value(table, L"General", L"Half"));
+	EXPECT_EQ(L"", Value(table, L"General", L"NoValue"));
+	EXPECT_EQ(L"other section", Value(table, L"Other", L"Scene.Name"));
+	EXPECT_EQ(CStringTable::NOT_FOUND, table.Find(L"General", L"Orphan"));
+	EXPECT_EQ(CStringTable::NOT_FOUND, table.Find(L"General", L"not a pair"));
+	EXPECT_EQ(6, table.GetCount());
+}
+
+TEST(StringTableTest, IgnoresCaseOnLookup)
+{
+	CStringTable table = ParseText(L"[General]\nLive.Broadcasting=Live\n");
+	EXPECT_EQ(L"Live", Value(table, L"general", L"live.broadcasting"));
+	EXPECT_EQ(L"Live", Value(table, L"GENERAL", L"LIVE.BROADCASTING"));
+	EXPECT_EQ(CStringTable::NOT_FOUND, table.Find(L"General", L"Live.Broadcast"));
+	EXPECT_EQ(CStringTable::NOT_FOUND, table.Find(L"General", L"Live.Broadcasting2"));
+	EXPECT_EQ(CStringTable::NOT_FOUND, table.Find(L"Genera", L"Live.Broadcasting"));
+	EXPECT_EQ(CStringTable::NOT_FOUND, table.Find(nullptr, L"Live.Broadcasting"));
+}
+
+TEST(StringTableTest, GrowsAndReloads)
+{
+	std::wstring text = L"[General]\n";
+	for (int i = 0; i < 5000; ++i)
+		text += L"Key" + std::to_wstring(i) + L"=" + std::to_wstring(i * 7) + L"\n";
+	CStringTable table = ParseText(text);
+	ASSERT_EQ(5000, table.GetCount());
+	for (int i = 0; i < 5000; ++i)
+		ASSERT_EQ(std::to_wstring(i * 7), Value(table, L"General", (L"key" + std::to_wstring(i)).c_str())) << i;
+
+	//a reload replaces everything.
+	std::wstring reloaded = L"[General]\nKey1=new\n";
+	table.Parse(reloaded.c_str(), reloaded.size());
+	EXPECT_EQ(1, table.GetCount());
+	EXPECT_EQ(L"new", Value(table, L"General", L"Key1"));
+	EXPECT_EQ(CStringTable::NOT_FOUND, table.Find(L"General", L"Key2"));
+	CStringTable empty;
+	EXPECT_EQ(CStringTable::NOT_FOUND, empty.Find(L"General", L"Key1"));
+	empty.Swap(table);
+	EXPECT_EQ(L"new", Value(empty, L"General", L"Key1"));
+	EXPECT_EQ(0, table.GetCount());
+}
+
+//every line of the shipped en.ini comes back, with its value.
+TEST(StringTableTest, FindsEveryKeyOfEnIni)
+{
+	std::string ini;
+	ASSERT_TRUE(ReadFile(APIEXAMPLE_SOURCE_DIR "/en.ini", ini));
+	CStringTable table = ParseText(std::wstring(ini.begin(), ini.end()));
+	std::istringstream lines(ini);
+	std::string line;
+	std::set<std::string> seen;
+	int keys = 0;
+	while (std::getline(lines, line)) {
+		size_t eq = line.find('=');
+		if (eq == std::string::npos)
+			continue;
+		std::string key = Trim(line.substr(0, eq)), value = Trim(line.substr(eq + 1));
+		//a few keys are there twice, the first one counts.
+		std::string lower = key;
+		for (auto& c : lower)
+			c = (char)tolower((unsigned char)c);
+		if (!seen.insert(lower).second)
+			continue;
+		++keys;
+		EXPECT_EQ(std::wstring(value.begin(), value.end()), Value(table, L"General", std::wstring(key.begin(), key.end()).c_str())) << key;
+	}
+	EXPECT_GT(keys, 200);
+	EXPECT_EQ(keys, table.GetCount());
+}
@@ -0,0 +1,396 @@
+#include "trace/Trace.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <functional>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace {
+	//just enough JSON to read back what ExportChromeTrace writes.
+	struct Json {
+		enum Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+		Type type = NUL;
+		double number = 0;
+		std::string text;
+		std::vector<Json> items;
+		std::vector<std::pair<std::string, Json>> members;
+
+		const Json* Find(const char* key) const
+		{
+			for (auto& member : members) {
+				if (member.first == key)
+					return &member.second;
+			}
+			return nullptr;
+		}
+		double Number(const char* key) const
+		{
+			const Json* value = Find(key);
+			return value && value->type == NUMBER ? value->number : -1;
+		}
+		std::string Text(const char* key) const
+		{
+			const Json* value = Find(key);
+			return value && value->type == STRING ? value->text : "";
+		}
+	};
+
+	class CJsonParser
+	{
+	public:
+		explicit CJsonParser(const std::string& text) : m_p(text.c_str()), m_end(text.c_str() + text.size()) {}
+
+		//the whole text is one value.
+		bool Parse(Json& value)
+		{
+			if (!ParseValue(value))
+				return false;
+			SkipBlanks();
+			return m_p == m_end;
+		}
+
+	private:
+		void SkipBlanks()
+		{
+			while (m_p < m_end && (*m_p == ' ' || *m_p == '\n' || *m_p == '\r' || *m_p == '\t'))
+				++m_p;
+		}
+		bool Expect(char c)
+		{
+			SkipBlanks();
+			if (m_p == m_end || *m_p != c)
+				return false;
+			++m_p;
+			return true;
+		}
+		bool ParseString(std::string& text)
+		{
+			if (!Expect('"'))
+				return false;
+			text.clear();
+			while (m_p < m_end && *m_p != '"') {
+				char c = *m_p++;
+				if (c != '\\') {
+					text.push_back(c);
+					continue;
+				}
+				if (m_p == m_end)
+					return false;
+				c = *m_p++;
+				if (c == 'u') {
+					if (m_end - m_p < 4)
+						return false;
+					text.push_back((char)strtol(std::string(m_p, 4).c_str(), nullptr, 16));
+					m_p += 4;
+				}
+				else if (c == 'n')
+					text.push_back('\n');
+				else if (c == '"' || c == '\\' || c == '/')
+					text.push_back(c);
+				else
+					return false;
+			}
+			return Expect('"');
+		}
+		bool ParseValue(Json& value)
+		{
+			SkipBlanks();
+			if (m_p == m_end)
+				return false;
+			if (*m_p == '{') {
+				++m_p;
+				value.type = Json::OBJECT;
+				SkipBlanks();
+				if (m_p < m_end && *m_p == '}')
+					return ++m_p, true;
+				do {
+					std::pair<std::string, Json> member;
+					if (!ParseString(member.first) || !Expect(':') || !ParseValue(member.second))
+						return false;
+					value.members.push_back(std::move(member));
+				} while (Expect(','));
+				return Expect('}');
+			}
+			if (*m_p == '[') {
+				++m_p;
+				value.type = Json::ARRAY;
+				SkipBlanks();
+				if (m_p < m_end && *m_p == ']')
+					return ++m_p, true;
+				do {
+					value.items.emplace_back();
+					if (!ParseValue(value.items.back()))
+						return false;
+				} while (Expect(','));
+				return Expect(']');
+			}
+			if (*m_p == '"') {
+				value.type = Json::STRING;
+				return ParseString(value.text);
+			}
+			for (const char* word : { "true", "false", "null" }) {
+				size_t length = strlen(word);
+				if ((size_t)(m_end - m_p) >= length && strncmp(m_p, word, length) == 0) {
+					value.type = *word == 'n' ? Json::NUL : Json::BOOLEAN;
+					m_p += length;
+					return true;
+				}
+			}
+			char* numberEnd = nullptr;
+			value.type = Json::NUMBER;
+			value.number = strtod(m_p, &numberEnd);
+			if (numberEnd == m_p || numberEnd > m_end)
+				return false;
+			m_p = numberEnd;
+			return true;
+		}
+
+		const char* m_p;
+		const char* m_end;
+	};
+
+	//the exported trace, parsed.
+	Json ExportTrace()
+	{
+		std::string text;
+		CTracer::GetInstance()->ExportChromeTrace(text);
+		Json trace;
+		EXPECT_TRUE(CJsonParser(text).Parse(trace)) << text.substr(0, 512);
+		return trace;
+	}
+
+	const std::vector<Json>& Events(const Json& trace)
+	{
+		static const std::vector<Json> none;
+		const Json* events = trace.Find("traceEvents");
+		return events && events->type == Json::ARRAY ? events->items : none;
+	}
+
+	//the events of the thread that was given name, in the order written.
+	std::vector<const Json*> ThreadEvents(const Json& trace, const std::string& name)
+	{
+		double tid = -1;
+		for (const Json& event : Events(trace)) {
+			const Json* args = event.Find("args");
+			if (event.Text("name") == "thread_name" && args && args->Text("name") == name)
+				tid = event.Number("tid");
+		}
+		std::vector<const Json*> events;
+		for (const Json& event : Events(trace)) {
+			if (event.Number("tid") == tid && event.Text("ph") != "M")
+				events.push_back(&event);
+		}
+		return events;
+	}
+
+	void RunThread(const std::string& name, std::function<void()> body)
+	{
+		std::thread thread([&] {
+			CTracer::GetInstance()->SetThreadName(name);
+			body();
+		});
+		thread.join();
+	}
+
+	class CTraceFixture : public ::testing::Test
+	{
+	protected:
+		void SetUp() override
+		{
+			CTracer::GetInstance()->SetEnabled(true);
+			CTracer::GetInstance()->Clear();
+		}
+		void TearDown() override
+		{
+			CTracer::GetInstance()->SetEnabled(false);
+			CTracer::GetInstance()->Clear();
+		}
+	};
+}
+
+TEST_F(CTraceFixture, WritesChromeTraceJson)
+{
+	CTracer* tracer = CTracer::GetInstance();
+	uint16_t scope = tracer->RegisterEvent("capture", "convert", "width", "height");
+	uint16_t marker = tracer->RegisterEvent("capture", "say \"hi\"\\", "frame");
+	uint16_t counter = tracer->RegisterEvent("push", "queue");
+	uint16_t flow = tracer->RegisterEvent("flow", "frame");
+	EXPECT_EQ(scope, tracer->RegisterEvent("capture", "convert"));
+	RunThread("writer", [&] {
+		int64_t now = CTracer::NowNs();
+		tracer->Write(scope, 'X', now, 2500, 1280, 720);
+		tracer->Write(marker, 'B', now, 0, 7, 0);
+		tracer->Write(marker, 'E', now + 1000, 0, 0, 0);
+		tracer->Write(marker, 'i', now, 0, 8, 0);
+		tracer->Write(counter, 'C', now, 0, 42, 0);
+		tracer->Write(flow, 's', now, 0, 99, 0);
+		tracer->Write(flow, 't', now, 0, 99, 0);
+		tracer->Write(flow, 'f', now, 0, 99, 0);
+		//0 is the event that is not written.
+		tracer->Write(0, 'i', now, 0, 0, 0);
+	});
+
+	char path[] = "/tmp/TraceTestXXXXXX";
+	int fd = mkstemp(path);
+	ASSERT_GE(fd, 0);
+	close(fd);
+	ASSERT_TRUE(tracer->WriteChromeTrace(path));
+	std::string text;
+	FILE* file = fopen(path, "rb");
+	ASSERT_NE(nullptr, file);
+	char buffer[4096];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		text.append(buffer, read);
+	fclose(file);
+	remove(path);
+
+	Json trace;
+	ASSERT_TRUE(CJsonParser(text).Parse(trace)) << text;
+	EXPECT_EQ("ms", trace.Text("displayTimeUnit"));
+	ASSERT_FALSE(Events(trace).empty());
+	EXPECT_EQ("process_name", Events(trace)[0].Text("name"));
+	std::vector<const Json*> events = ThreadEvents(trace, "writer");
+	ASSERT_EQ(8u, events.size());
+
+	const Json& complete = *events[0];
+	EXPECT_EQ("X", complete.Text("ph"));
+	EXPECT_EQ("capture", complete.Text("cat"));
+	EXPECT_EQ("convert", complete.Text("name"));
+	EXPECT_EQ(1, complete.Number("pid"));
+	EXPECT_GE(complete.Number("ts"), 0);
+	EXPECT_DOUBLE_EQ(2.5, complete.Number("dur"));
+	ASSERT_NE(nullptr, complete.Find("args"));
+	EXPECT_EQ(1280, complete.Find("args")->Number("width"));
+	EXPECT_EQ(720, complete.Find("args")->Number("height"));
+
+	EXPECT_EQ("B", events[1]->Text("ph"));
+	EXPECT_EQ("say \"hi\"\\", events[1]->Text("name"));
+	EXPECT_EQ(7, events[1]->Find("args")->Number("frame"));
+	EXPECT_EQ("E", events[2]->Text("ph"));
+	EXPECT_EQ(nullptr, events[2]->Find("args"));
+	EXPECT_NEAR(1.0, events[2]->Number("ts") - events[1]->Number("ts"), 1e-3);
+	EXPECT_EQ("i", events[3]->Text("ph"));
+	EXPECT_EQ("t", events[3]->Text("s"));
+	EXPECT_EQ("C", events[4]->Text("ph"));
+	EXPECT_EQ(42, events[4]->Find("args")->Number("value"));
+	const char* flows[] = { "s", "t", "f" };
+	for (int i = 0; i < 3; ++i) {
+		EXPECT_EQ(flows[i], events[5 + i]->Text("ph"));
+		EXPECT_EQ(99, events[5 + i]->Number("id"));
+	}
+	EXPECT_EQ("e", events[7]->Text("bp"));
+}
+
+TEST_F(CTraceFixture, WrapsAroundAndCountsOverwritten)
+{
+	CTracer* tracer = CTracer::GetInstance();
+	uint16_t counter = tracer->RegisterEvent("test", "wrap");
+	const int extra = 100;
+	RunThread("wrap", [&] {
+		for (int i = 0; i < CTracer::BUFFER_RECORDS + extra; ++i)
+			tracer->Write(counter, 'C', CTracer::NowNs(), 0, i, 0);
+	});
+	TraceStats stats = tracer->GetStats();
+	EXPECT_EQ((uint64_t)CTracer::BUFFER_RECORDS, stats.records);
+	EXPECT_EQ((uint64_t)extra, stats.overwritten);
+	EXPECT_EQ(0u, stats.dropped);
+
+	//the newest ring full, oldest first.
+	Json trace = ExportTrace();
+	std::vector<const Json*> events = ThreadEvents(trace, "wrap");
+	ASSERT_EQ((size_t)CTracer::BUFFER_RECORDS, events.size());
+	for (size_t i = 0; i < events.size(); ++i)
+		ASSERT_EQ((double)(extra + i), events[i]->Find("args")->Number("value")) << i;
+
+	tracer->Clear();
+	stats = tracer->GetStats();
+	EXPECT_EQ(0u, stats.records);
+	EXPECT_EQ(0u, stats.overwritten);
+	EXPECT_TRUE(ThreadEvents(ExportTrace(), "wrap").empty());
+}
+
+//the owner wraps its ring many times over while traces are exported:
+//every record that comes out is whole and they follow each other.
+TEST_F(CTraceFixture, SnapshotsWhileAWriterRuns)
+{
+	CTracer* tracer = CTracer::GetInstance();
+	uint16_t scope = tracer->RegisterEvent("test", "busy", "n", "check");
+	std::atomic<bool> stop{ false };
+	std::atomic<int64_t> written{ 0 };
+	std::thread writer([&] {
+		tracer->SetThreadName("busy");
+		for (int64_t n = 0; !stop.load(std::memory_order_relaxed); ++n) {
+			//every field derived from n, a torn record mixes two of them.
+			tracer->Write(scope, 'X', n * 1000, n * 1000, n, (int32_t)(n * 7));
+			written.store(n + 1, std::memory_order_relaxed);
+		}
+	});
+	while (written.load() < 4 * CTracer::BUFFER_RECORDS)
+		std::this_thread::yield();
+
+	int snapshots = 0;
+	for (int round = 0; round < 20; ++round) {
+		Json trace = ExportTrace();
+		std::vector<const Json*> events = ThreadEvents(trace, "busy");
+		if (events.empty())
+			continue;
+		++snapshots;
+		ASSERT_LE(events.size(), (size_t)CTracer::BUFFER_RECORDS);
+		double previous = -1;
+		for (const Json* event : events) {
+			const Json* args = event->Find("args");
+			ASSERT_NE(nullptr, args);
+			double n = args->Number("n");
+			ASSERT_EQ((double)(int32_t)((int64_t)n * 7), args->Number("check")) << n;
+			ASSERT_DOUBLE_EQ(n, event->Number("dur")) << n;
+			if (previous >= 0) {
+				ASSERT_EQ(previous + 1, n);
+			}
+			previous = n;
+		}
+	}
+	stop = true;
+	writer.join();
+	EXPECT_GT(snapshots, 0);
+	EXPECT_GT(tracer->GetStats().overwritten, 0u);
+}
+
+//a thread that ended gives its buffer to the next one once all are
+//taken, the one holding the fewest records first.
+TEST_F(CTraceFixture, ReusesTheBuffersOfEndedThreads)
+{
+	CTracer* tracer = CTracer::GetInstance();
+	uint16_t instant = tracer->RegisterEvent("test", "reuse", "thread");
+	int threadsBefore = tracer->GetStats().threads;
+	RunThread("long", [&] {
+		for (int i = 0; i < 1000; ++i)
+			tracer->Write(instant, 'i', CTracer::NowNs(), 0, -1, 0);
+	});
+	const int shortThreads = CTracer::MAX_BUFFERS + 8;
+	for (int t = 0; t < shortThreads; ++t) {
+		RunThread("short " + std::to_string(t), [&] {
+			tracer->Write(instant, 'i', CTracer::NowNs(), 0, t, 0);
+		});
+	}
+	TraceStats stats = tracer->GetStats();
+	EXPECT_EQ(threadsBefore + 1 + shortThreads, stats.threads);
+	EXPECT_EQ(0u, stats.dropped);
+
+	Json trace = ExportTrace();
+	int buffers = 0;
+	for (const Json& event : Events(trace))
+		buffers += event.Text("name") == "thread_name";
+	EXPECT_LE(buffers, (int)CTracer::MAX_BUFFERS);
+	//the long run outlived the churn, the last short thread is there.
+	EXPECT_EQ(1000u, ThreadEvents(trace, "long").size());
+	std::vector<const Json*> events = ThreadEvents(trace, "short " + std::to_string(shortThreads - 1));
+	ASSERT_EQ(1u, events.size());
+	EXPECT_EQ(shortThreads - 1, events[0]->Find("args")->Number("thread"));
+}
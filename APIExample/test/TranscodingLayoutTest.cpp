@@ -0,0 +1,175 @@
+#include "Advanced/RTMPStream/TranscodingLayout.h"
+#include <gtest/gtest.h>
+
+namespace {
+	const LayoutTile* FindTile(const CTranscodingLayout& layout, unsigned int uid)
+	{
+		for (const LayoutTile& tile : layout.GetTiles()) {
+			if (tile.uid == uid)
+				return &tile;
+		}
+		return nullptr;
+	}
+
+	bool SameGeometry(const LayoutTile& a, const LayoutTile& b)
+	{
+		return a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height;
+	}
+
+	bool Overlap(const LayoutTile& a, const LayoutTile& b)
+	{
+		return a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height && b.y < a.y + a.height;
+	}
+}
+
+TEST(TranscodingLayoutTest, GridCoversTheCanvasWithoutOverlap)
+{
+	CTranscodingLayout layout;
+	layout.SetCanvas(1280, 720);
+	for (unsigned int uid = 1; uid <= CTranscodingLayout::MAX_USERS; ++uid) {
+		ASSERT_TRUE(layout.AddUser(uid));
+		const std::vector<LayoutTile>& tiles = layout.GetTiles();
+		ASSERT_EQ(uid, tiles.size());
+		long long area = 0;
+		for (size_t i = 0; i < tiles.size(); ++i) {
+			EXPECT_GE(tiles[i].x, 0);
+			EXPECT_GE(tiles[i].y, 0);
+			EXPECT_LE(tiles[i].x + tiles[i].width, 1280);
+			EXPECT_LE(tiles[i].y + tiles[i].height, 720);
+			area += (long long)tiles[i].width * tiles[i].height;
+			for (size_t j = i + 1; j < tiles.size(); ++j)
+				EXPECT_FALSE(Overlap(tiles[i], tiles[j])) << uid << " users, tiles " << i << " and " << j;
+		}
+		//a square number of users fills the canvas.
+		if (uid == 1 || uid == 4 || uid == 9 || uid == 16) {
+			EXPECT_EQ(1280LL * 720, area) << uid << " users";
+		}
+	}
+	EXPECT_FALSE(layout.AddUser(CTranscodingLayout::MAX_USERS + 1));
+	EXPECT_FALSE(layout.AddUser(1));
+	EXPECT_FALSE(layout.AddUser(0));
+}
+
+TEST(TranscodingLayoutTest, JoinsAndLeavesKeepOtherTilesInPlace)
+{
+	CTranscodingLayout layout;
+	layout.SetCanvas(1280, 720);
+	for (unsigned int uid = 1; uid <= 5; ++uid)
+		layout.AddUser(uid);
+	//a 3x2 grid with one free cell: joining fills it and nobody moves.
+	std::vector<LayoutTile> before = layout.GetTiles();
+	ASSERT_TRUE(layout.AddUser(6));
+	for (const LayoutTile& tile : before)
+		EXPECT_TRUE(SameGeometry(tile, *FindTile(layout, tile.uid))) << tile.uid;
+
+	//leaving leaves a hole, the grid keeps its shape.
+	before = layout.GetTiles();
+	ASSERT_TRUE(layout.RemoveUser(3));
+	EXPECT_EQ(nullptr, FindTile(layout, 3));
+	for (const LayoutTile& tile : before) {
+		if (tile.uid != 3) {
+			EXPECT_TRUE(SameGeometry(tile, *FindTile(layout, tile.uid))) << tile.uid;
+		}
+	}
+	//the next join takes the hole.
+	ASSERT_TRUE(layout.AddUser(7));
+	EXPECT_TRUE(SameGeometry(*FindTile(layout, 7), before[2]));
+}
+
+TEST(TranscodingLayoutTest, ShrinkingGridMovesOnlyUsersOutsideIt)
+{
+	CTranscodingLayout layout;
+	layout.SetCanvas(1200, 1200);
+	for (unsigned int uid = 1; uid <= 5; ++uid)
+		layout.AddUser(uid);
+	//5 users in 3x2, 4 users fit 2x2: the user in the last cell fills the hole.
+	ASSERT_TRUE(layout.RemoveUser(2));
+	ASSERT_EQ(4u, layout.GetTiles().size());
+	for (const LayoutTile& tile : layout.GetTiles()) {
+		EXPECT_EQ(600, tile.width);
+		EXPECT_EQ(600, tile.height);
+	}
+	EXPECT_EQ(600, FindTile(layout, 5)->x);
+	EXPECT_EQ(0, FindTile(layout, 5)->y);
+}
+
+TEST(TranscodingLayoutTest, SpeakerTakesTheMainTile)
+{
+	CTranscodingLayout layout;
+	layout.SetCanvas(1280, 720);
+	layout.SetTemplate(CTranscodingLayout::LAYOUT_SPEAKER);
+	for (unsigned int uid = 1; uid <= 4; ++uid)
+		layout.AddUser(uid);
+	EXPECT_EQ(1u, layout.GetSpeaker());
+	const LayoutTile* main = FindTile(layout, 1);
+	EXPECT_EQ(1280, main->width);
+	EXPECT_EQ(540, main->height);
+
+	ASSERT_TRUE(layout.SetSpeaker(3));
+	EXPECT_EQ(3u, layout.GetSpeaker());
+	EXPECT_EQ(540, FindTile(layout, 3)->height);
+	//the other three share a 2x2 grid in the strip below.
+	EXPECT_EQ(90, FindTile(layout, 1)->height);
+	EXPECT_GE(FindTile(layout, 1)->y, 540);
+	EXPECT_FALSE(layout.SetSpeaker(99));
+
+	//the speaker leaving hands the main tile to someone.
+	ASSERT_TRUE(layout.RemoveUser(3));
+	EXPECT_NE(0u, layout.GetSpeaker());
+	EXPECT_EQ(540, FindTile(layout, layout.GetSpeaker())->height);
+}
+
+TEST(TranscodingLayoutTest, PipOverlaysLeaveTheHostVisible)
+{
+	CTranscodingLayout layout;
+	layout.SetCanvas(1280, 720);
+	layout.SetTemplate(CTranscodingLayout::LAYOUT_PIP);
+	for (unsigned int uid = 1; uid <= CTranscodingLayout::MAX_USERS; ++uid) {
+		ASSERT_TRUE(layout.AddUser(uid));
+		const LayoutTile* host = FindTile(layout, 1);
+		EXPECT_EQ(1280, host->width);
+		EXPECT_EQ(720, host->height);
+		EXPECT_EQ(0, host->zOrder);
+		int top = 720;
+		const std::vector<LayoutTile>& tiles = layout.GetTiles();
+		for (size_t i = 0; i < tiles.size(); ++i) {
+			if (tiles[i].uid == 1)
+				continue;
+			EXPECT_EQ(1, tiles[i].zOrder);
+			EXPECT_LE(tiles[i].width, 1280 / CTranscodingLayout::PIP_COLUMNS);
+			EXPECT_GE(tiles[i].x, 0);
+			EXPECT_LE(tiles[i].x + tiles[i].width, 1280);
+			top = (std::min)(top, tiles[i].y);
+			for (size_t j = i + 1; j < tiles.size(); ++j) {
+				if (tiles[j].uid != 1) {
+					EXPECT_FALSE(Overlap(tiles[i], tiles[j])) << uid << " users";
+				}
+			}
+		}
+		//the overlays stay in the bottom quarter.
+		EXPECT_GE(top, 720 - 720 / CTranscodingLayout::PIP_COLUMNS) << uid << " users";
+	}
+}
+
+TEST(TranscodingLayoutTest, CommitReportsOnlyGeometryChanges)
+{
+	CTranscodingLayout layout;
+	layout.SetCanvas(1280, 720);
+	EXPECT_FALSE(layout.CommitChanges());
+	layout.AddUser(1);
+	layout.AddUser(2);
+	EXPECT_TRUE(layout.CommitChanges());
+	EXPECT_FALSE(layout.CommitChanges());
+	//already the speaker, nothing moves.
+	layout.SetSpeaker(1);
+	EXPECT_FALSE(layout.CommitChanges());
+	layout.SetTemplate(CTranscodingLayout::LAYOUT_GRID);
+	EXPECT_FALSE(layout.CommitChanges());
+	EXPECT_FALSE(layout.AddUser(2));
+	EXPECT_FALSE(layout.CommitChanges());
+	layout.SetTemplate(CTranscodingLayout::LAYOUT_PIP);
+	EXPECT_TRUE(layout.CommitChanges());
+	layout.Clear();
+	EXPECT_EQ(0, layout.GetUserCount());
+	EXPECT_TRUE(layout.GetTiles().empty());
+}
@@ -0,0 +1,105 @@
+#include "capture/V4L2CaptureBackend.h"
+#include <gtest/gtest.h>
+#include <linux/videodev2.h>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+//without a camera or a v4l2loopback device the capture test is skipped,
+//the rest runs everywhere.
+
+TEST(V4L2CaptureBackendTest, MapsTheCaptureFormats)
+{
+	const uint32_t fourccs[] = { CAPTURE_FOURCC_I420, CAPTURE_FOURCC_NV12, CAPTURE_FOURCC_YUY2,
+		CAPTURE_FOURCC_UYVY, CAPTURE_FOURCC_MJPG, CAPTURE_FOURCC_BGR24, CAPTURE_FOURCC_RGBA };
+	for (uint32_t fourcc : fourccs) {
+		uint32_t pixelformat = CV4L2CaptureBackend::ToV4L2Format(fourcc);
+		EXPECT_NE(0u, pixelformat) << fourcc;
+		EXPECT_EQ(fourcc, CV4L2CaptureBackend::FromV4L2Format(pixelformat)) << fourcc;
+	}
+	EXPECT_EQ((uint32_t)V4L2_PIX_FMT_YUYV, CV4L2CaptureBackend::ToV4L2Format(CAPTURE_FOURCC_YUY2));
+	EXPECT_EQ((uint32_t)V4L2_PIX_FMT_YUV420, CV4L2CaptureBackend::ToV4L2Format(CAPTURE_FOURCC_I420));
+	EXPECT_EQ(0u, CV4L2CaptureBackend::ToV4L2Format(CAPTURE_FOURCC_PCM16));
+	EXPECT_EQ(0u, CV4L2CaptureBackend::FromV4L2Format(V4L2_PIX_FMT_H264));
+}
+
+TEST(V4L2CaptureBackendTest, RefusesDevicesItDidNotList)
+{
+	CV4L2CaptureBackend backend;
+	std::vector<CaptureDeviceInfo> devices;
+	ASSERT_TRUE(backend.EnumDevices(devices));
+	for (const CaptureDeviceInfo& device : devices) {
+		EXPECT_EQ(0u, device.id.find("/dev/video"));
+		EXPECT_EQ(CAPTURE_MEDIA_VIDEO, device.media);
+	}
+	int missing = (int)devices.size();
+	std::vector<CaptureFormat> formats;
+	EXPECT_FALSE(backend.GetFormats(missing, formats));
+	EXPECT_FALSE(backend.GetFormats(-1, formats));
+	CaptureFormat format;
+	format.fourcc = CAPTURE_FOURCC_YUY2;
+	format.width = 640;
+	format.height = 480;
+	format.fps = 30;
+	EXPECT_FALSE(backend.Open(missing, format));
+	EXPECT_FALSE(backend.Start([](const CaptureFrame&) {}));
+	EXPECT_FALSE(backend.IsCapturing());
+	//Stop and Close without a device are harmless.
+	backend.Stop();
+	backend.Close();
+}
+
+TEST(V4L2CaptureBackendTest, CapturesFromTheFirstDevice)
+{
+	CV4L2CaptureBackend backend;
+	std::vector<CaptureDeviceInfo> devices;
+	ASSERT_TRUE(backend.EnumDevices(devices));
+	if (devices.empty())
+		GTEST_SKIP() << "no V4L2 capture device";
+	std::vector<CaptureFormat> formats;
+	ASSERT_TRUE(backend.GetFormats(0, formats));
+	ASSERT_FALSE(formats.empty());
+	//a raw format, so the frame size can be checked.
+	const CaptureFormat* raw = nullptr;
+	for (const CaptureFormat& format : formats) {
+		if (GetCaptureFrameSize(format)) {
+			raw = &format;
+			break;
+		}
+	}
+	if (!raw)
+		GTEST_SKIP() << "no raw format on " << devices[0].name;
+	ASSERT_TRUE(backend.Open(0, *raw)) << DescribeCaptureFormat(*raw);
+
+	std::mutex mutex;
+	std::vector<CaptureFrame> frames;
+	int64_t start = CaptureClockUs();
+	ASSERT_TRUE(backend.Start([&](const CaptureFrame& frame) {
+		std::lock_guard<std::mutex> lock(mutex);
+		frames.push_back(frame);
+	}));
+	EXPECT_TRUE(backend.IsCapturing());
+	auto end = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+	for (;;) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (frames.size() >= 5)
+				break;
+		}
+		ASSERT_LT(std::chrono::steady_clock::now(), end) << "no frames from " << devices[0].name;
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	backend.Stop();
+	EXPECT_FALSE(backend.IsCapturing());
+	for (size_t i = 0; i < frames.size(); ++i) {
+		EXPECT_GE(frames[i].size, GetCaptureFrameSize(*raw));
+		EXPECT_TRUE(IsSameCaptureFormat(*raw, *frames[i].format));
+		//driver timestamps are on the CaptureClockUs clock.
+		EXPECT_GT(frames[i].timestampUs, start - 1000000);
+		EXPECT_LT(frames[i].timestampUs, CaptureClockUs());
+		if (i) {
+			EXPECT_GT(frames[i].sequence, frames[i - 1].sequence);
+		}
+	}
+	backend.Close();
+}
@@ -0,0 +1,278 @@
+#include "dsp/VoiceChanger.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <math.h>
+#include <thread>
+#include <vector>
+
+namespace {
+	const int kRate = 48000;
+	//a 10 ms frame, what the record observer gets.
+	const int kFrame = kRate / 100;
+	const double kPi = 3.14159265358979323846;
+
+	std::vector<int16_t> Sine(double hz, int samples, int channels = 1, double amplitude = 8000)
+	{
+		std::vector<int16_t> pcm((size_t)samples * channels);
+		for (int i = 0; i < samples; ++i) {
+			for (int c = 0; c < channels; ++c)
+				pcm[(size_t)i * channels + c] = (int16_t)lrint(amplitude * sin(2 * kPi * hz * i / kRate));
+		}
+		return pcm;
+	}
+
+	//runs pcm through the changer in 10 ms frames, as the SDK would.
+	void ProcessFrames(CVoiceChanger& changer, std::vector<int16_t>& pcm, int channels = 1, int rate = kRate)
+	{
+		int frame = rate / 100;
+		int samples = (int)(pcm.size() / channels);
+		for (int i = 0; i + frame <= samples; i += frame)
+			ASSERT_TRUE(changer.Process(pcm.data() + (size_t)i * channels, frame, channels, rate));
+	}
+
+	//rising zero crossings per second over [begin, end).
+	double Frequency(const std::vector<int16_t>& pcm, int begin, int end)
+	{
+		int first = -1, last = -1, crossings = 0;
+		for (int i = begin + 1; i < end; ++i) {
+			if (pcm[i - 1] < 0 && pcm[i] >= 0) {
+				if (first < 0)
+					first = i;
+				else
+					++crossings;
+				last = i;
+			}
+		}
+		return crossings ? (double)crossings * kRate / (last - first) : 0;
+	}
+
+	double Rms(const std::vector<int16_t>& pcm, int begin, int end)
+	{
+		double sum = 0;
+		for (int i = begin; i < end; ++i)
+			sum += (double)pcm[i] * pcm[i];
+		return sqrt(sum / (end - begin));
+	}
+
+	VoiceChangerOptions Options(float pitch, float formant, float low, float mid, float midHz, float high,
+		float mix, float time, float room, float damping)
+	{
+		VoiceChangerOptions options;
+		options.pitchSemitones = pitch;
+		options.formantSemitones = formant;
+		options.eqLowDb = low;
+		options.eqMidDb = mid;
+		options.eqMidHz = midHz;
+		options.eqHighDb = high;
+		options.reverbMix = mix;
+		options.reverbTime = time;
+		options.reverbRoom = room;
+		options.reverbDamping = damping;
+		return options;
+	}
+}
+
+TEST(VoiceChangerTest, NeutralChainIsACopy)
+{
+	CVoiceChanger changer;
+	std::vector<int16_t> pcm = Sine(440, kRate / 2), original = pcm;
+	ProcessFrames(changer, pcm);
+	EXPECT_EQ(original, pcm);
+	EXPECT_EQ(0, changer.GetLatencySamples());
+	VoiceChangerStats stats = changer.GetStats();
+	EXPECT_EQ(50u, stats.frames);
+	EXPECT_EQ((uint64_t)kRate / 2, stats.samples);
+	EXPECT_EQ(kRate, stats.sampleRate);
+}
+
+TEST(VoiceChangerTest, RejectsBadFrames)
+{
+	CVoiceChanger changer;
+	std::vector<int16_t> pcm(kFrame);
+	EXPECT_FALSE(changer.Process(nullptr, kFrame, 1, kRate));
+	EXPECT_FALSE(changer.Process(pcm.data(), 0, 1, kRate));
+	EXPECT_FALSE(changer.Process(pcm.data(), kFrame, 0, kRate));
+	EXPECT_FALSE(changer.Process(pcm.data(), kFrame, 1, 4000));
+	EXPECT_EQ(0u, changer.GetStats().frames);
+}
+
+//the pitch shifter delays by one FFT frame of about 20 ms, nothing else
+//in the chain does.
+TEST(VoiceChangerTest, LatencyIsThePitchShifters)
+{
+	CVoiceChanger changer;
+	changer.SetOptions(Options(0, 0, -6, 3, 1500, 2, 0.3f, 1.2f, 0.5f, 0.5f));
+	std::vector<int16_t> pcm(kFrame);
+	ASSERT_TRUE(changer.Process(pcm.data(), kFrame, 1, kRate));
+	EXPECT_EQ(0, changer.GetLatencySamples());
+
+	changer.SetOptions(Options(4, 0, 0, 0, 1500, 0, 0, 1.2f, 0.5f, 0.5f));
+	ASSERT_TRUE(changer.Process(pcm.data(), kFrame, 1, kRate));
+	int latency = changer.GetLatencySamples();
+	EXPECT_EQ(1024, latency);
+	EXPECT_NEAR(20.0, latency * 1000.0 / kRate, 2.0);
+
+	//at 16 kHz the frame is 16 ms.
+	std::vector<int16_t> narrow(160);
+	ASSERT_TRUE(changer.Process(narrow.data(), 160, 1, 16000));
+	EXPECT_EQ(256, changer.GetLatencySamples());
+	EXPECT_EQ(16000, changer.GetStats().sampleRate);
+}
+
+//the reported latency is the delay the audio really has: a shift too
+//small to hear leaves noise as it was, only later by that much.
+TEST(VoiceChangerTest, OutputIsDelayedByTheLatency)
+{
+	CVoiceChanger changer;
+	changer.SetOptions(Options(0.01f, 0.01f, 0, 0, 1500, 0, 0, 1.2f, 0.5f, 0.5f));
+	std::vector<int16_t> pcm(kRate);
+	uint32_t seed = 1;
+	for (auto& sample : pcm) {
+		seed = seed * 1664525u + 1013904223u;
+		sample = (int16_t)((int32_t)(seed >> 16) - 32768) / 4;
+	}
+	std::vector<int16_t> input = pcm;
+	ProcessFrames(changer, pcm);
+	int latency = changer.GetLatencySamples();
+
+	int bestLag = -1;
+	double best = 0;
+	for (int lag = 0; lag <= 2 * latency; ++lag) {
+		double sum = 0;
+		for (int i = kRate / 4; i < kRate / 2; ++i)
+			sum += (double)input[i] * pcm[i + lag];
+		if (sum > best) {
+			best = sum;
+			bestLag = lag;
+		}
+	}
+	EXPECT_NEAR(latency, bestLag, 2);
+}
+
+TEST(VoiceChangerTest, PitchMovesTheTone)
+{
+	for (float semitones : { 12.0f, 4.0f, -5.0f }) {
+		CVoiceChanger changer;
+		//formants moved along, a plain tone stays a plain tone.
+		changer.SetOptions(Options(semitones, semitones, 0, 0, 1500, 0, 0, 1.2f, 0.5f, 0.5f));
+		std::vector<int16_t> pcm = Sine(300, kRate);
+		ProcessFrames(changer, pcm);
+		double expected = 300 * pow(2.0, semitones / 12.0);
+		EXPECT_NEAR(expected, Frequency(pcm, kRate / 4, kRate), expected * 0.03) << semitones;
+		EXPECT_GT(Rms(pcm, kRate / 4, kRate), 8000 / sqrt(2.0) / 4) << semitones;
+	}
+}
+
+TEST(VoiceChangerTest, EqualizerShapesWithoutDelay)
+{
+	CVoiceChanger changer;
+	//the radio preset: lows and highs cut, the mids lifted.
+	changer.SetOptions(Options(0, 0, -18, 8, 1800, -18, 0, 1.2f, 0.5f, 0.5f));
+	std::vector<int16_t> low = Sine(80, kRate / 2, 1, 4000), mid = Sine(1800, kRate / 2, 1, 4000);
+	ProcessFrames(changer, low);
+	CVoiceChanger midChanger;
+	midChanger.SetOptions(changer.GetOptions());
+	ProcessFrames(midChanger, mid);
+	double in = 4000 / sqrt(2.0);
+	EXPECT_LT(Rms(low, kRate / 4, kRate / 2), in / 4);
+	EXPECT_GT(Rms(mid, kRate / 4, kRate / 2), in * 1.5);
+	EXPECT_EQ(0, changer.GetLatencySamples());
+}
+
+TEST(VoiceChangerTest, ReverbLeavesATail)
+{
+	CVoiceChanger changer;
+	//the hall preset.
+	changer.SetOptions(Options(0, 0, 0, 0, 1500, 0, 0.45f, 2.2f, 0.9f, 0.4f));
+	std::vector<int16_t> pcm(kRate);
+	std::vector<int16_t> burst = Sine(500, kRate / 10);
+	std::copy(burst.begin(), burst.end(), pcm.begin());
+	ProcessFrames(changer, pcm);
+	EXPECT_EQ(0, changer.GetLatencySamples());
+	//half a second after the burst ended there is still sound, and less
+	//of it later on.
+	double early = Rms(pcm, kRate / 5, kRate * 2 / 5), late = Rms(pcm, kRate * 3 / 5, kRate * 4 / 5);
+	EXPECT_GT(early, 10.0);
+	EXPECT_LT(late, early);
+}
+
+//every preset of the scene through the whole chain, stereo as the
+//observer is usually set up: finite output, identical channels, the
+//latency of the pitch shifter exactly when it runs.
+TEST(VoiceChangerTest, PresetChains)
+{
+	struct Preset {
+		const char* name;
+		VoiceChangerOptions options;
+	} presets[] = {
+		{ "deep", Options(-3, -2, 3, 0, 1500, 0, 0, 1.2f, 0.5f, 0.5f) },
+		{ "child", Options(6, 4, 0, 0, 1500, 2, 0, 1.2f, 0.5f, 0.5f) },
+		{ "monster", Options(-8, -5, 4, 0, 1500, 0, 0.2f, 1.5f, 0.8f, 0.6f) },
+		{ "higher", Options(4, 0, 0, 0, 1500, 0, 0, 1.2f, 0.5f, 0.5f) },
+		{ "radio", Options(0, 0, -18, 8, 1800, -18, 0, 1.2f, 0.5f, 0.5f) },
+		{ "ktv", Options(0, 0, 0, 0, 1500, 2, 0.3f, 1.2f, 0.5f, 0.5f) },
+		{ "hall", Options(0, 0, 0, 0, 1500, 0, 0.45f, 2.2f, 0.9f, 0.4f) },
+	};
+	CVoiceChanger changer;
+	for (const Preset& preset : presets) {
+		changer.SetOptions(preset.options);
+		std::vector<int16_t> pcm = Sine(220, kRate / 2, 2);
+		ProcessFrames(changer, pcm, 2);
+		bool pitched = preset.options.pitchSemitones != 0 || preset.options.formantSemitones != 0;
+		EXPECT_EQ(pitched ? 1024 : 0, changer.GetLatencySamples()) << preset.name;
+		double energy = 0;
+		for (size_t i = 0; i < pcm.size(); i += 2) {
+			ASSERT_EQ(pcm[i], pcm[i + 1]) << preset.name;
+			energy += (double)pcm[i] * pcm[i];
+		}
+		EXPECT_GT(energy, 0) << preset.name;
+	}
+	//back to neutral is a copy again.
+	changer.SetOptions(VoiceChangerOptions());
+	std::vector<int16_t> pcm = Sine(220, kFrame, 2), original = pcm;
+	ProcessFrames(changer, pcm, 2);
+	EXPECT_EQ(original, pcm);
+	EXPECT_EQ(0, changer.GetLatencySamples());
+}
+
+TEST(VoiceChangerTest, ScalarAndAVX2Agree)
+{
+	VoiceChangerOptions options = Options(-8, -5, 4, 0, 1500, 0, 0.2f, 1.5f, 0.8f, 0.6f);
+	CVoiceChanger scalar, simd;
+	scalar.SetUseAVX2(false);
+	scalar.SetOptions(options);
+	simd.SetOptions(options);
+	std::vector<int16_t> a = Sine(220, kRate / 2), b = a;
+	ProcessFrames(scalar, a);
+	ProcessFrames(simd, b);
+	EXPECT_FALSE(scalar.GetStats().avx2);
+	for (size_t i = 0; i < a.size(); ++i)
+		ASSERT_NEAR(a[i], b[i], 8) << i;
+}
+
+//options changed from another thread while frames run: every frame is
+//processed with one whole set of options, and the last set wins.
+TEST(VoiceChangerTest, OptionsChangeWhileProcessing)
+{
+	CVoiceChanger changer;
+	std::atomic<bool> done{ false };
+	std::thread control([&] {
+		for (int i = 0; !done.load(); ++i) {
+			changer.SetOptions(Options((float)(i % 13 - 6), 0, (float)(i % 7), 0, 1500, 0, (i % 3) * 0.2f, 1.2f, 0.5f, 0.5f));
+			changer.GetStats();
+			std::this_thread::yield();
+		}
+	});
+	std::vector<int16_t> pcm = Sine(220, kRate * 2);
+	ProcessFrames(changer, pcm);
+	done = true;
+	control.join();
+	EXPECT_EQ(200u, changer.GetStats().frames);
+
+	changer.SetOptions(VoiceChangerOptions());
+	std::vector<int16_t> frame = Sine(220, kFrame), original = frame;
+	ASSERT_TRUE(changer.Process(frame.data(), kFrame, 1, kRate));
+	EXPECT_EQ(original, frame);
+	changer.ResetStats();
+	EXPECT_EQ(0u, changer.GetStats().frames);
+}
@@ -0,0 +1,107 @@
+#include "capture/AudioFileReader.h"
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+//a real-time consumer pulls 10 ms every 10 ms of a 48 kHz stereo file
+//behind a throttled source, per disk and read-ahead ring size, and counts
+//the underruns. the source is in memory, the throttle is per read latency
+//plus transfer time at the bandwidth, and an occasional stall.
+
+namespace {
+	struct Disk {
+		const char* name;
+		double latencyMs;
+		double megabytesPerSecond;
+		//every stallEvery-th read takes stallMs longer, 0 for never.
+		int stallEvery;
+		double stallMs;
+	};
+
+	struct Ring {
+		int blockFrames;
+		int blockCount;
+	};
+
+	AudioFileReaderStats Bench(const std::vector<int16_t>& pcm, const AudioFileFormat& format,
+		const Disk& disk, const Ring& ring, int seconds)
+	{
+		int reads = 0;
+		CAudioFileReader::ReadFunction read = [&](uint64_t offset, void* data, size_t size) -> size_t {
+			double ms = disk.latencyMs + size / (disk.megabytesPerSecond * 1e3);
+			if (disk.stallEvery && ++reads % disk.stallEvery == 0)
+				ms += disk.stallMs;
+			std::this_thread::sleep_for(std::chrono::microseconds((int64_t)(ms * 1e3)));
+			uint64_t bytes = pcm.size() * sizeof(int16_t);
+			if (offset >= bytes)
+				return 0;
+			size = (size_t)(std::min)((uint64_t)size, bytes - offset);
+			memcpy(data, (const uint8_t*)pcm.data() + offset, size);
+			return size;
+		};
+		CAudioFileReader reader;
+		reader.SetReadAhead(ring.blockFrames, ring.blockCount);
+		if (!reader.Open(read, pcm.size() * sizeof(int16_t), &format))
+			return AudioFileReaderStats();
+		reader.SetLoop(true);
+		//as the capture dialog starts: on a filled read-ahead, up to 500 ms.
+		reader.WaitBuffered(format.sampleRate / 10, 500);
+		int frames = format.sampleRate / 100;
+		std::vector<int16_t> out((size_t)frames * format.channels);
+		std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+		for (int i = 0; i < seconds * 100; ++i) {
+			reader.Read(out.data(), frames);
+			next += std::chrono::milliseconds(10);
+			std::this_thread::sleep_until(next);
+		}
+		AudioFileReaderStats stats = reader.GetStats();
+		reader.Close();
+		return stats;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	int seconds = argc > 1 ? atoi(argv[1]) : 4;
+	if (seconds <= 0)
+		seconds = 4;
+	AudioFileFormat format;
+	format.sampleRate = 48000;
+	format.channels = 2;
+	format.sampleFormat = AUDIO_SAMPLE_PCM16;
+	//longer than a run, so the loop wrap is not what is measured.
+	std::vector<int16_t> pcm((size_t)format.sampleRate * format.channels * (seconds + 2));
+	for (size_t i = 0; i < pcm.size(); ++i)
+		pcm[i] = (int16_t)(i * 7);
+
+	const Disk disks[] = {
+		{ "ssd", 0.1, 500, 0, 0 },
+		{ "hdd", 8, 80, 0, 0 },
+		{ "usb2", 15, 8, 0, 0 },
+		{ "nas", 2, 50, 20, 300 },
+	};
+	const Ring rings[] = { { 1024, 2 }, { 4096, 4 }, { 4096, 16 } };
+	printf("%d s per run, underruns (reads, max read ms)\n%-6s", seconds, "disk");
+	for (const Ring& ring : rings) {
+		char name[32];
+		snprintf(name, sizeof(name), "%dx%d", ring.blockCount, ring.blockFrames);
+		printf("  %-22s", name);
+	}
+	printf("\n");
+	for (const Disk& disk : disks) {
+		printf("%-6s", disk.name);
+		for (const Ring& ring : rings) {
+			AudioFileReaderStats stats = Bench(pcm, format, disk, ring, seconds);
+			char cell[64];
+			snprintf(cell, sizeof(cell), "%llu (%llu, %.1f)", (unsigned long long)stats.underruns,
+				(unsigned long long)stats.reads, stats.readNsMax / 1e6);
+			printf("  %-22s", cell);
+			fflush(stdout);
+		}
+		printf("\n");
+	}
+	return 0;
+}
@@ -0,0 +1,33 @@
+#include "dsp/AudioResampler.h"
+#include <chrono>
+#include <stdio.h>
+#include <vector>
+
+//seconds of audio resampled per second of one core, 10 ms frames.
+static void Bench(int inRate, int outRate, int channels, CAudioResampler::Quality quality)
+{
+	CAudioResampler resampler;
+	if (!resampler.Init(inRate, channels, outRate, channels, quality))
+		return;
+	int inSamples = inRate / 100;
+	std::vector<int16_t> in((size_t)inSamples * channels), out((size_t)(outRate / 100 + 1) * channels);
+	for (size_t i = 0; i < in.size(); ++i)
+		in[i] = (int16_t)((i * 2654435761u) >> 20);
+	const int frames = 6000;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int i = 0; i < frames; ++i)
+		resampler.Process(in.data(), inSamples, out.data(), resampler.GetOutputSamples(inSamples));
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("%6d -> %6d  %d ch  quality %d  %8.1fx realtime  %6.2f us/frame\n",
+		inRate, outRate, channels, (int)quality, frames / 100.0 / seconds, seconds * 1e6 / frames);
+}
+
+int main()
+{
+	const int rates[][2] = { { 44100, 48000 }, { 48000, 44100 }, { 16000, 48000 }, { 96000, 8000 }, { 44100, 47999 } };
+	for (auto& rate : rates) {
+		for (int quality = CAudioResampler::QUALITY_LOW; quality <= CAudioResampler::QUALITY_HIGH; ++quality)
+			Bench(rate[0], rate[1], 2, (CAudioResampler::Quality)quality);
+	}
+	return 0;
+}
@@ -0,0 +1,101 @@
+#include "Advanced/MediaIOCustomVideoCaptrue/DirtyRegionDetector.h"
+#include <chrono>
+#include <stdio.h>
+#include <vector>
+
+namespace {
+	std::vector<uint8_t> MakeFrame(int width, int height)
+	{
+		std::vector<uint8_t> frame((size_t)width * height * 3 / 2);
+		for (size_t i = 0; i < frame.size(); ++i)
+			frame[i] = (uint8_t)((i * 2654435761u) >> 24);
+		return frame;
+	}
+
+	//changes a square of about the given share of the frame, in another place each time.
+	void Touch(std::vector<uint8_t>& frame, int width, int height, double share, int index)
+	{
+		if (share <= 0)
+			return;
+		int side = (int)(width * share) < width ? (int)(width * share) : width;
+		int rows = (int)(height * share) < height ? (int)(height * share) : height;
+		if (share >= 1.0) {
+			side = width;
+			rows = height;
+		}
+		int x0 = (index * 97) % (width - side + 1);
+		int y0 = (index * 53) % (height - rows + 1);
+		for (int y = y0; y < y0 + rows; ++y) {
+			for (int x = x0; x < x0 + side; ++x)
+				frame[(size_t)y * width + x] += 1;
+		}
+	}
+
+	//ms per Detect on frames where the given share of width and height changes.
+	void BenchDetect(const char* name, int width, int height, double share)
+	{
+		std::vector<uint8_t> frame = MakeFrame(width, height);
+		CDirtyRegionDetector detector;
+		detector.Configure(width, height);
+		detector.Detect(frame.data());
+		const int frames = width > 1920 ? 100 : 300;
+		int dirty = 0;
+		size_t rects = 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int i = 0; i < frames; ++i) {
+			Touch(frame, width, height, share, i);
+			dirty += detector.Detect(frame.data());
+			rects += detector.GetDirtyRects().size();
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		printf("%-5s %-18s %8.3f ms/frame  %6.1f dirty blocks  %5.1f rects\n",
+			name, share <= 0 ? "unchanged" : share >= 1.0 ? "all changed" : share > 0.2 ? "a quarter changed" : "a corner changed",
+			seconds * 1e3 / frames, (double)dirty / frames, (double)rects / frames);
+	}
+
+	//ms to hash every full block of a frame, SIMD against scalar.
+	void BenchHash(const char* name, int width, int height)
+	{
+		std::vector<uint8_t> frame = MakeFrame(width, height);
+		const uint8_t* y = frame.data();
+		const uint8_t* u = y + (size_t)width * height;
+		const uint8_t* v = u + (size_t)(width / 2) * (height / 2);
+		const int B = CDirtyRegionDetector::BLOCK_SIZE;
+		const int frames = width > 1920 ? 100 : 300;
+		uint64_t sink = 0;
+		double ms[2];
+		for (int scalar = 0; scalar < 2; ++scalar) {
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			for (int i = 0; i < frames; ++i) {
+				for (int by = 0; by + B <= height; by += B) {
+					for (int bx = 0; bx + B <= width; bx += B) {
+						const uint8_t* py = y + (size_t)by * width + bx;
+						const uint8_t* pu = u + (size_t)(by / 2) * (width / 2) + bx / 2;
+						const uint8_t* pv = v + (size_t)(by / 2) * (width / 2) + bx / 2;
+						sink += scalar ? CDirtyRegionDetector::HashBlockScalar(py, width, pu, width / 2, pv, width / 2)
+							: CDirtyRegionDetector::HashBlock(py, width, pu, width / 2, pv, width / 2);
+					}
+				}
+			}
+			ms[scalar] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1e3 / frames;
+		}
+		printf("%-5s hash all blocks   %8.3f ms/frame SIMD  %8.3f ms/frame scalar  (%llx)\n",
+			name, ms[0], ms[1], (unsigned long long)(sink & 0xF));
+	}
+}
+
+int main()
+{
+	const struct {
+		const char* name;
+		int width, height;
+	} sizes[] = { { "1080p", 1920, 1080 }, { "4K", 3840, 2160 } };
+	for (auto& size : sizes) {
+		BenchHash(size.name, size.width, size.height);
+		BenchDetect(size.name, size.width, size.height, 0.0);
+		BenchDetect(size.name, size.width, size.height, 0.05);
+		BenchDetect(size.name, size.width, size.height, 0.5);
+		BenchDetect(size.name, size.width, size.height, 1.0);
+	}
+	return 0;
+}
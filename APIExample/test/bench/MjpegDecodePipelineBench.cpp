@@ -0,0 +1,195 @@
+#define HAVE_JPEG
+#include "capture/CaptureConverter.h"
+#include "capture/MjpegDecodePipeline.h"
+#include <libyuv.h>
+#include <chrono>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef HAVE_LIBJPEG
+#include <jpeglib.h>
+#endif
+
+//decodes a recorded MJPEG stream, concatenated JPEG frames as
+//"ffmpeg -f v4l2 -input_format mjpeg -i /dev/video0 -c copy -f mjpeg rec.mjpeg"
+//writes them, inline on the calling thread as Receive used to and through
+//the pipeline at the camera's rate. without a recording it encodes
+//synthetic 1080p and 4K frames.
+
+namespace {
+	typedef std::vector<std::vector<uint8_t>> Frames;
+
+	//splits at the start of image markers, a JPEG's entropy coded data
+	//never contains 0xFF 0xD8.
+	Frames SplitStream(const std::vector<uint8_t>& stream)
+	{
+		Frames frames;
+		size_t begin = std::string::npos;
+		for (size_t i = 0; i + 2 < stream.size(); ++i) {
+			if (stream[i] != 0xFF || stream[i + 1] != 0xD8 || stream[i + 2] != 0xFF)
+				continue;
+			if (begin != std::string::npos)
+				frames.emplace_back(stream.begin() + begin, stream.begin() + i);
+			begin = i;
+		}
+		if (begin != std::string::npos)
+			frames.emplace_back(stream.begin() + begin, stream.end());
+		return frames;
+	}
+
+	bool ReadStream(const char* path, Frames& frames, int& width, int& height)
+	{
+		FILE* file = fopen(path, "rb");
+		if (!file)
+			return false;
+		std::vector<uint8_t> stream;
+		uint8_t buffer[1 << 16];
+		size_t read;
+		while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+			stream.insert(stream.end(), buffer, buffer + read);
+		fclose(file);
+		frames = SplitStream(stream);
+		return !frames.empty() && libyuv::MJPGSize(frames[0].data(), frames[0].size(), &width, &height) == 0;
+	}
+
+#ifdef HAVE_LIBJPEG
+	//a moving gradient with some texture so the entropy coder has work.
+	std::vector<uint8_t> EncodeFrame(int width, int height, int index)
+	{
+		std::vector<uint8_t> rgb((size_t)width * height * 3);
+		for (int y = 0; y < height; ++y) {
+			for (int x = 0; x < width; ++x) {
+				uint8_t* p = &rgb[((size_t)y * width + x) * 3];
+				uint32_t noise = ((uint32_t)(x * 31 + y * 17 + index) * 2654435761u) >> 28;
+				p[0] = (uint8_t)(x + index * 4 + noise);
+				p[1] = (uint8_t)(y + noise * 3);
+				p[2] = (uint8_t)((x ^ y) + index);
+			}
+		}
+		jpeg_compress_struct cinfo;
+		jpeg_error_mgr jerr;
+		cinfo.err = jpeg_std_error(&jerr);
+		jpeg_create_compress(&cinfo);
+		unsigned char* out = nullptr;
+		unsigned long size = 0;
+		jpeg_mem_dest(&cinfo, &out, &size);
+		cinfo.image_width = width;
+		cinfo.image_height = height;
+		cinfo.input_components = 3;
+		cinfo.in_color_space = JCS_RGB;
+		jpeg_set_defaults(&cinfo);
+		//webcams send 4:2:2 at about this quality.
+		jpeg_set_quality(&cinfo, 80, TRUE);
+		cinfo.comp_info[0].h_samp_factor = 2;
+		cinfo.comp_info[0].v_samp_factor = 1;
+		jpeg_start_compress(&cinfo, TRUE);
+		while (cinfo.next_scanline < cinfo.image_height) {
+			JSAMPROW row = &rgb[(size_t)cinfo.next_scanline * width * 3];
+			jpeg_write_scanlines(&cinfo, &row, 1);
+		}
+		jpeg_finish_compress(&cinfo);
+		std::vector<uint8_t> jpeg(out, out + size);
+		free(out);
+		jpeg_destroy_compress(&cinfo);
+		return jpeg;
+	}
+
+	Frames EncodeFrames(int width, int height, int count)
+	{
+		Frames frames;
+		for (int i = 0; i < count; ++i)
+			frames.push_back(EncodeFrame(width, height, i));
+		return frames;
+	}
+#endif
+
+	//ms per frame decoding on the calling thread, the most fps that allows.
+	void BenchInline(const char* name, const Frames& frames, int width, int height)
+	{
+		CaptureFormat format;
+		format.fourcc = CAPTURE_FOURCC_MJPG;
+		format.width = width;
+		format.height = height;
+		std::vector<uint8_t> i420((size_t)width * height * 3 / 2);
+		const int passes = width > 1920 ? 2 : 4;
+		int decoded = 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int pass = 0; pass < passes; ++pass) {
+			for (const auto& frame : frames)
+				decoded += ConvertCaptureFrameToI420(format, frame.data(), frame.size(), i420.data());
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		int total = passes * (int)frames.size();
+		printf("%-5s inline            %8.2f ms/frame  %6.1f fps max  %d/%d decoded\n",
+			name, seconds * 1e3 / total, total / seconds, decoded, total);
+	}
+
+	//submits at fps for the given seconds, as a camera would, and reports
+	//what came out the other end.
+	void BenchPipeline(const char* name, const Frames& frames, int width, int height, int workers, int fps, int seconds)
+	{
+		CMjpegDecodePipeline pipeline(workers);
+		uint64_t expected = 0;
+		uint64_t outOfOrder = 0;
+		pipeline.Start(width, height, [&](const MjpegDecodedFrame& frame) {
+			if (frame.sequence < expected)
+				++outOfOrder;
+			expected = frame.sequence + 1;
+		});
+		const int total = fps * seconds;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int i = 0; i < total; ++i) {
+			std::this_thread::sleep_until(start + std::chrono::microseconds((int64_t)i * 1000000 / fps));
+			const auto& frame = frames[i % frames.size()];
+			pipeline.Submit(frame.data(), frame.size(), (int64_t)i * 1000000 / fps);
+		}
+		//the last frames in flight.
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		pipeline.Stop();
+		MjpegPipelineStats stats = pipeline.GetStats();
+		printf("%-5s %d worker%s @%2d fps  %8.2f ms/frame  %6.1f fps out  %5llu dropped  peak %d in flight%s\n",
+			name, pipeline.GetWorkerCount(), pipeline.GetWorkerCount() > 1 ? "s" : " ", fps,
+			stats.delivered ? stats.decodeNs / 1e6 / stats.delivered : 0.0,
+			(double)stats.delivered / seconds, (unsigned long long)stats.dropped, stats.peakInFlight,
+			outOfOrder ? "  OUT OF ORDER" : "");
+	}
+
+	void Bench(const char* name, const Frames& frames, int width, int height)
+	{
+		BenchInline(name, frames, width, height);
+		int cores = (int)std::thread::hardware_concurrency();
+		for (int workers = 1; workers <= CMjpegDecodePipeline::MAX_WORKERS; workers *= 2) {
+			BenchPipeline(name, frames, width, height, workers, 30, 3);
+			if (workers >= cores)
+				break;
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc > 1) {
+		Frames frames;
+		int width = 0, height = 0;
+		if (!ReadStream(argv[1], frames, width, height)) {
+			fprintf(stderr, "%s is not an MJPEG stream\n", argv[1]);
+			return 1;
+		}
+		printf("%s: %d frames %dx%d\n", argv[1], (int)frames.size(), width, height);
+		Bench("file", frames, width, height);
+		return 0;
+	}
+#ifdef HAVE_LIBJPEG
+	const struct {
+		const char* name;
+		int width, height;
+	} sizes[] = { { "1080p", 1920, 1080 }, { "4K", 3840, 2160 } };
+	for (auto& size : sizes)
+		Bench(size.name, EncodeFrames(size.width, size.height, 15), size.width, size.height);
+	return 0;
+#else
+	fprintf(stderr, "usage: %s <recorded.mjpeg>\n", argv[0]);
+	return 2;
+#endif
+}
@@ -0,0 +1,59 @@
+#include "dsp/SpatialAudioRenderer.h"
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+//ms per 10 ms playback frame with n remote users talking, positions moving
+//every few frames so the filter crossfades are part of the cost.
+static void Bench(int sources, int sampleRate)
+{
+	CSpatialAudioRenderer renderer;
+	if (!renderer.Init(sampleRate))
+		return;
+	renderer.SetDistanceModel(1.0f, 40.0f, 0.5f);
+	const int samples = sampleRate / 100;
+	std::vector<std::vector<int16_t>> pcm(sources, std::vector<int16_t>(samples));
+	uint32_t seed = 1;
+	for (auto& source : pcm) {
+		for (auto& sample : source) {
+			seed = seed * 1664525u + 1013904223u;
+			sample = (int16_t)((int32_t)seed >> 19);
+		}
+	}
+	std::vector<int16_t> output(samples * 2);
+	const int frames = 1000;
+	std::vector<double> ms;
+	ms.reserve(frames);
+	for (int frame = 0; frame < frames; ++frame) {
+		if (frame % 10 == 0) {
+			for (int i = 0; i < sources; ++i) {
+				double angle = (i * 360.0 / sources + frame * 0.5) * 3.14159265358979 / 180.0;
+				float distance = 1.0f + (i % 8) * 3.0f;
+				renderer.SetSourcePosition(i + 1, (float)(sin(angle) * distance), (float)(cos(angle) * distance), 0);
+			}
+		}
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int i = 0; i < sources; ++i)
+			renderer.SubmitSource(i + 1, pcm[i].data(), samples, 1);
+		renderer.Render(output.data(), samples, 2, true);
+		ms.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1e3);
+	}
+	double total = 0;
+	for (double value : ms)
+		total += value;
+	std::sort(ms.begin(), ms.end());
+	printf("%6d Hz  %2d sources  %6.3f ms/frame  p99 %6.3f ms  max %6.3f ms\n",
+		sampleRate, sources, total / frames, ms[frames * 99 / 100], ms.back());
+}
+
+int main()
+{
+	const int sources[] = { 1, 4, 8, 16, 32, 64 };
+	for (int count : sources)
+		Bench(count, 48000);
+	Bench(16, 44100);
+	Bench(16, 16000);
+	return 0;
+}
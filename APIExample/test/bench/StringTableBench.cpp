@@ -0,0 +1,128 @@
+#include "StringTable.h"
+#include <chrono>
+#include <regex>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <wctype.h>
+
+//the language strings at startup: InitKeyInfomation asks for every Str key
+//in stdafx.cpp once. "parse once" reads and parses en.ini and looks the keys
+//up in the table as CConfig does now; "rescan per key" reopens and scans
+//the file for each key as GetPrivateProfileString did.
+
+namespace {
+	bool ReadFile(const std::string& path, std::string& data)
+	{
+		data.clear();
+		FILE* file = fopen(path.c_str(), "rb");
+		if (!file)
+			return false;
+		char buffer[4096];
+		size_t read;
+		while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+			data.append(buffer, read);
+		fclose(file);
+		return true;
+	}
+
+	bool EqualsNoCase(const wchar_t* begin, const wchar_t* end, const std::wstring& text)
+	{
+		if ((size_t)(end - begin) != text.size())
+			return false;
+		for (size_t i = 0; i < text.size(); ++i) {
+			if (towlower(begin[i]) != towlower(text[i]))
+				return false;
+		}
+		return true;
+	}
+
+	//what the profile API does per call: read the file and scan it until
+	//the key of the section turns up.
+	std::wstring RescanFile(const std::string& path, const std::wstring& section, const std::wstring& key)
+	{
+		std::string data;
+		ReadFile(path, data);
+		std::wstring text(data.begin(), data.end());
+		const wchar_t* p = text.c_str();
+		const wchar_t* end = p + text.size();
+		bool inSection = false;
+		while (p < end) {
+			const wchar_t* lineEnd = p;
+			while (lineEnd < end && *lineEnd != L'\n' && *lineEnd != L'\r') ++lineEnd;
+			const wchar_t* b = p;
+			while (b < lineEnd && iswspace(*b)) ++b;
+			p = lineEnd + 1;
+			if (b < lineEnd && *b == L'[') {
+				const wchar_t* close = b + 1;
+				while (close < lineEnd && *close != L']') ++close;
+				inSection = EqualsNoCase(b + 1, close, section);
+				continue;
+			}
+			if (!inSection)
+				continue;
+			const wchar_t* eq = b;
+			while (eq < lineEnd && *eq != L'=') ++eq;
+			const wchar_t* ke = eq;
+			while (ke > b && iswspace(ke[-1])) --ke;
+			if (eq < lineEnd && EqualsNoCase(b, ke, key))
+				return std::wstring(eq + 1, lineEnd);
+		}
+		return L"Unknown";
+	}
+
+	double Seconds(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	std::string dir = argc > 1 ? argv[1] : APIEXAMPLE_SOURCE_DIR;
+	std::string ini = dir + "/en.ini";
+	std::string data, source;
+	if (!ReadFile(ini, data) || !ReadFile(dir + "/stdafx.cpp", source)) {
+		fprintf(stderr, "usage: %s [directory with en.ini and stdafx.cpp]\n", argv[0]);
+		return 2;
+	}
+	std::vector<std::wstring> keys;
+	std::regex str("Str\\(_T\\(\"([^\"]+)\"\\)\\)");
+	for (std::sregex_iterator it(source.begin(), source.end(), str), end; it != end; ++it) {
+		std::string key = (*it)[1];
+		keys.emplace_back(key.begin(), key.end());
+	}
+	printf("%s: %d bytes, %d keys looked up at startup\n", ini.c_str(), (int)data.size(), (int)keys.size());
+
+	const int runs = 200;
+	double parse = 0, lookup = 0;
+	size_t found = 0;
+	for (int run = 0; run < runs; ++run) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		//en.ini is ASCII, widening is its decode.
+		ReadFile(ini, data);
+		std::wstring text(data.begin(), data.end());
+		CStringTable table;
+		table.Parse(text.c_str(), text.size());
+		parse += Seconds(start);
+		start = std::chrono::steady_clock::now();
+		for (const auto& key : keys)
+			found += table.Find(L"General", key.c_str()) != CStringTable::NOT_FOUND;
+		lookup += Seconds(start);
+	}
+	printf("parse once       %8.1f us load  %6.1f ns/lookup  %8.1f us startup  (%d/%d found)\n",
+		parse / runs * 1e6, lookup / runs / keys.size() * 1e9, (parse + lookup) / runs * 1e6,
+		(int)(found / runs), (int)keys.size());
+
+	const int rescanRuns = 10;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	size_t bytes = 0;
+	for (int run = 0; run < rescanRuns; ++run) {
+		for (const auto& key : keys)
+			bytes += RescanFile(ini, L"General", key).size();
+	}
+	double rescan = Seconds(start) / rescanRuns;
+	printf("rescan per key                  %6.1f us/lookup  %8.1f us startup\n",
+		rescan / keys.size() * 1e6, rescan * 1e6);
+	return bytes ? 0 : 1;
+}
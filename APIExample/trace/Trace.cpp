@@ -0,0 +1,352 @@
+#include "Trace.h"
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+//no stdafx.h, the tracer is used from the capture and dsp code too.
+
+static_assert(sizeof(TraceRecord) == 32, "a TraceRecord fills the four words of a slot");
+
+//gives the thread's buffer back when the thread ends.
+struct TraceThread {
+	CTracer::Buffer* buffer = nullptr;
+	~TraceThread()
+	{
+		if (buffer)
+			buffer->retired.store(true, std::memory_order_release);
+	}
+};
+
+namespace {
+	thread_local TraceThread t_traceThread;
+
+	FILE* OpenTraceFile(const std::string& path)
+	{
+#ifdef _WIN32
+		int len = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, NULL, 0);
+		if (len <= 0)
+			return NULL;
+		std::wstring wide(len, L'\0');
+		MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &wide[0], len);
+		FILE* file = NULL;
+		if (_wfopen_s(&file, wide.c_str(), L"wb") != 0)
+			return NULL;
+		return file;
+#else
+		return fopen(path.c_str(), "wb");
+#endif
+	}
+
+	void AppendJsonString(std::string& json, const char* text)
+	{
+		json.push_back('"');
+		for (const char* p = text; *p; ++p) {
+			unsigned char c = (unsigned char)*p;
+			if (c == '"' || c == '\\') {
+				json.push_back('\\');
+				json.push_back((char)c);
+			}
+			else if (c < 0x20) {
+				char escaped[8];
+				snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+				json += escaped;
+			}
+			else
+				json.push_back((char)c);
+		}
+		json.push_back('"');
+	}
+}
+
+std::atomic<bool> CTracer::s_enabled(false);
+thread_local CTracer::Buffer* CTracer::s_threadBuffer = nullptr;
+
+CTracer::CTracer()
+	: m_eventCount(0)
+	, m_dropped(0)
+	, m_originNs(NowNs())
+{
+}
+
+CTracer* CTracer::GetInstance()
+{
+	//never destroyed, threads may still trace while the process exits.
+	static CTracer* tracer = new CTracer();
+	return tracer;
+}
+
+int64_t CTracer::NowNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void CTracer::SetEnabled(bool enabled)
+{
+	s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void CTracer::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (auto& buffer : m_buffers)
+		buffer->cleared.store(buffer->written.load(std::memory_order_acquire), std::memory_order_relaxed);
+	m_dropped.store(0, std::memory_order_relaxed);
+}
+
+uint16_t CTracer::RegisterEvent(const char* category, const char* name, const char* arg0, const char* arg1)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	int count = m_eventCount.load(std::memory_order_relaxed);
+	for (int i = 0; i < count; ++i) {
+		if (strcmp(m_events[i].category, category) == 0 && strcmp(m_events[i].name, name) == 0)
+			return (uint16_t)(i + 1);
+	}
+	if (count == MAX_EVENTS)
+		return 0;
+	EventInfo& info = m_events[count];
+	info.category = category;
+	info.name = name;
+	info.args[0] = arg0;
+	info.args[1] = arg1;
+	m_eventCount.store(count + 1, std::memory_order_release);
+	//ids start at 1, 0 is the event that is not written.
+	return (uint16_t)(count + 1);
+}
+
+CTracer::Buffer* CTracer::AcquireBuffer()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Buffer* buffer = nullptr;
+	if (m_buffers.size() < MAX_BUFFERS) {
+		m_buffers.emplace_back(new Buffer());
+		buffer = m_buffers.back().get();
+		buffer->slots.reset(new Slot[BUFFER_RECORDS]);
+		buffer->written.store(0, std::memory_order_relaxed);
+		buffer->cleared.store(0, std::memory_order_relaxed);
+	}
+	else {
+		//the records of ended threads are kept until a new thread needs
+		//the buffer, then the fewest go, so a churn of short threads does
+		//not push out a long capture run.
+		uint64_t fewest = UINT64_MAX;
+		for (auto& retired : m_buffers) {
+			if (!retired->retired.load(std::memory_order_acquire))
+				continue;
+			uint64_t kept = retired->written.load(std::memory_order_relaxed) - retired->cleared.load(std::memory_order_relaxed);
+			if (kept < fewest) {
+				fewest = kept;
+				buffer = retired.get();
+			}
+		}
+		if (!buffer)
+			return nullptr;
+		buffer->cleared.store(buffer->written.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	}
+	buffer->retired.store(false, std::memory_order_relaxed);
+	buffer->tid = m_nextTid++;
+	buffer->threadName.clear();
+	return buffer;
+}
+
+CTracer::Buffer* CTracer::GetThreadBuffer()
+{
+	if (!s_threadBuffer) {
+		s_threadBuffer = AcquireBuffer();
+		t_traceThread.buffer = s_threadBuffer;
+	}
+	return s_threadBuffer;
+}
+
+void CTracer::SetThreadName(const std::string& name)
+{
+	Buffer* buffer = GetThreadBuffer();
+	if (!buffer)
+		return;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	buffer->threadName = name;
+}
+
+void CTracer::Write(uint16_t event, char phase, int64_t ns, int64_t durationNs, int64_t arg0, int32_t arg1)
+{
+	if (!event)
+		return;
+	Buffer* buffer = GetThreadBuffer();
+	if (!buffer) {
+		m_dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	TraceRecord record;
+	record.ns = ns;
+	record.durationNs = durationNs;
+	record.arg0 = arg0;
+	record.arg1 = arg1;
+	record.event = event;
+	record.phase = phase;
+	record.reserved = 0;
+	uint64_t words[4];
+	memcpy(words, &record, sizeof(words));
+
+	uint64_t index = buffer->written.load(std::memory_order_relaxed);
+	Slot& slot = buffer->slots[index & (BUFFER_RECORDS - 1)];
+	slot.sequence.store(index * 2 + 1, std::memory_order_relaxed);
+	//the odd stamp is seen before any word of the new record.
+	std::atomic_thread_fence(std::memory_order_release);
+	for (int i = 0; i < 4; ++i)
+		slot.words[i].store(words[i], std::memory_order_relaxed);
+	slot.sequence.store(index * 2 + 2, std::memory_order_release);
+	buffer->written.store(index + 1, std::memory_order_release);
+}
+
+void CTracer::TakeSnapshots(std::vector<Snapshot>& snapshots) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	snapshots.resize(m_buffers.size());
+	for (size_t i = 0; i < m_buffers.size(); ++i) {
+		const Buffer& buffer = *m_buffers[i];
+		Snapshot& snapshot = snapshots[i];
+		snapshot.tid = buffer.tid;
+		snapshot.threadName = buffer.threadName;
+		uint64_t end = buffer.written.load(std::memory_order_acquire);
+		uint64_t begin = (std::max)(buffer.cleared.load(std::memory_order_relaxed),
+			end > BUFFER_RECORDS ? end - BUFFER_RECORDS : 0);
+		snapshot.records.clear();
+		snapshot.records.reserve((size_t)(end - begin));
+		//the owner keeps writing while we copy, without waiting for us. a
+		//slot it has moved on to, or is in the middle of, has another stamp
+		//before or after the copy and is left out.
+		for (uint64_t index = begin; index < end; ++index) {
+			const Slot& slot = buffer.slots[index & (BUFFER_RECORDS - 1)];
+			uint64_t stamp = slot.sequence.load(std::memory_order_acquire);
+			if (stamp != index * 2 + 2)
+				continue;
+			uint64_t words[4];
+			for (int w = 0; w < 4; ++w)
+				words[w] = slot.words[w].load(std::memory_order_relaxed);
+			//keeps the loads above from moving past the second stamp.
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot.sequence.load(std::memory_order_relaxed) != stamp)
+				continue;
+			TraceRecord record;
+			memcpy(&record, words, sizeof(record));
+			snapshot.records.push_back(record);
+		}
+	}
+}
+
+void CTracer::ExportChromeTrace(std::string& json) const
+{
+	std::vector<Snapshot> snapshots;
+	TakeSnapshots(snapshots);
+	int eventCount = m_eventCount.load(std::memory_order_acquire);
+
+	size_t records = 0;
+	for (const Snapshot& snapshot : snapshots)
+		records += snapshot.records.size();
+	json.clear();
+	json.reserve(records * 160 + 1024);
+	json += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	json += "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"APIExample\"}}";
+	char text[256];
+	for (const Snapshot& snapshot : snapshots) {
+		json += ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,";
+		snprintf(text, sizeof(text), "\"tid\":%d,\"args\":{\"name\":", snapshot.tid);
+		json += text;
+		if (snapshot.threadName.empty()) {
+			snprintf(text, sizeof(text), "thread %d", snapshot.tid);
+			AppendJsonString(json, text);
+		}
+		else
+			AppendJsonString(json, snapshot.threadName.c_str());
+		json += "}}";
+
+		for (const TraceRecord& record : snapshot.records) {
+			if (record.event < 1 || record.event > eventCount)
+				continue;
+			const EventInfo& info = m_events[record.event - 1];
+			json += ",\n{\"ph\":\"";
+			json.push_back(record.phase);
+			json += "\",\"cat\":";
+			AppendJsonString(json, info.category);
+			json += ",\"name\":";
+			AppendJsonString(json, info.name);
+			snprintf(text, sizeof(text), ",\"pid\":1,\"tid\":%d,\"ts\":%.3f",
+				snapshot.tid, (record.ns - m_originNs) / 1e3);
+			json += text;
+			switch (record.phase) {
+			case 'X':
+				snprintf(text, sizeof(text), ",\"dur\":%.3f", record.durationNs / 1e3);
+				json += text;
+				break;
+			case 'i':
+				json += ",\"s\":\"t\"";
+				break;
+			case 'E':
+				//the arguments went with 'B'.
+				json.push_back('}');
+				continue;
+			case 'C':
+				snprintf(text, sizeof(text), ",\"args\":{\"value\":%lld}}", (long long)record.arg0);
+				json += text;
+				continue;
+			case 's':
+			case 't':
+			case 'f':
+				snprintf(text, sizeof(text), ",\"id\":%lld%s}", (long long)record.arg0,
+					record.phase == 'f' ? ",\"bp\":\"e\"" : "");
+				json += text;
+				continue;
+			}
+			if (info.args[0] || info.args[1]) {
+				json += ",\"args\":{";
+				if (info.args[0]) {
+					AppendJsonString(json, info.args[0]);
+					snprintf(text, sizeof(text), ":%lld", (long long)record.arg0);
+					json += text;
+				}
+				if (info.args[1]) {
+					if (info.args[0])
+						json.push_back(',');
+					AppendJsonString(json, info.args[1]);
+					snprintf(text, sizeof(text), ":%d", record.arg1);
+					json += text;
+				}
+				json.push_back('}');
+			}
+			json.push_back('}');
+		}
+	}
+	json += "\n]}\n";
+}
+
+bool CTracer::WriteChromeTrace(const std::string& path) const
+{
+	std::string json;
+	ExportChromeTrace(json);
+	FILE* file = OpenTraceFile(path);
+	if (!file)
+		return false;
+	bool ok = fwrite(json.data(), 1, json.size(), file) == json.size();
+	return fclose(file) == 0 && ok;
+}
+
+TraceStats CTracer::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	TraceStats stats;
+	stats.threads = m_nextTid - 1;
+	for (auto& buffer : m_buffers) {
+		uint64_t end = buffer->written.load(std::memory_order_acquire);
+		uint64_t kept = end - buffer->cleared.load(std::memory_order_relaxed);
+		if (kept > BUFFER_RECORDS) {
+			stats.overwritten += kept - BUFFER_RECORDS;
+			kept = BUFFER_RECORDS;
+		}
+		stats.records += kept;
+	}
+	stats.dropped = m_dropped.load(std::memory_order_relaxed);
+	return stats;
+}
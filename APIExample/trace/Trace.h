@@ -0,0 +1,250 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+//0 compiles every AG_TRACE_* trace point out, CTracer itself stays.
+#ifndef AG_TRACE
+#define AG_TRACE 1
+#endif
+
+//one trace event as written by a thread, 32 bytes.
+struct TraceRecord {
+	//steady clock nanoseconds.
+	int64_t ns;
+	//complete events: how long the scope took.
+	int64_t durationNs;
+	//first argument, the value of counters and the id of flow events.
+	int64_t arg0;
+	int32_t arg1;
+	//from CTracer::RegisterEvent.
+	uint16_t event;
+	//Chrome trace phase: 'X' complete, 'B' 'E' begin and end, 'i' instant,
+	//'C' counter, 's' 't' 'f' flow start, step and end.
+	char phase;
+	uint8_t reserved;
+};
+
+struct TraceStats {
+	//threads that ever traced.
+	int threads = 0;
+	//records still in the buffers.
+	uint64_t records = 0;
+	//records written over because a thread's buffer was full.
+	uint64_t overwritten = 0;
+	//events lost because more threads traced at once than there are buffers.
+	uint64_t dropped = 0;
+};
+
+/*
+	Structured tracing for the capture, convert, filter and push paths and
+	the SDK callbacks. Each thread writes fixed size records into its own
+	ring buffer without locks. Every slot is a seqlock: a stamp marks it
+	as being written, the record goes in as atomic words and a second
+	stamp names the record's index, so a reader copying the ring while the
+	owner wraps around keeps only records whose stamp did not change.
+	Names and argument names live once in an event table, so a trace point
+	costs a clock read and a 40 byte slot. A full ring overwrites its
+	oldest records. ExportChromeTrace copies the rings out while
+	threads keep tracing and writes the Chrome trace event JSON that
+	chrome://tracing and ui.perfetto.dev open; flow events with the same
+	id link the slices one frame passed through across threads.
+	Recording is off until SetEnabled(true); a disabled trace point costs
+	a relaxed load.
+*/
+class CTracer
+{
+public:
+	enum {
+		//records per thread, a power of two.
+		BUFFER_RECORDS = 8192,
+		//threads tracing at once; a thread that ended keeps its records
+		//until no buffer is left for a new one.
+		MAX_BUFFERS = 64,
+		MAX_EVENTS = 1024,
+	};
+
+	static CTracer* GetInstance();
+
+	static bool IsEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+	void SetEnabled(bool enabled);
+	//forgets every record, the event table and thread names stay.
+	void Clear();
+
+	//category, name and argument names must be string literals, they are
+	//kept by pointer. argument names may be nullptr. returns the same id
+	//for the same category and name, 0 when the table is full.
+	uint16_t RegisterEvent(const char* category, const char* name, const char* arg0 = nullptr, const char* arg1 = nullptr);
+	//names the calling thread in the exported trace.
+	void SetThreadName(const std::string& name);
+
+	//steady clock nanoseconds, the clock of TraceRecord::ns.
+	static int64_t NowNs();
+	//the calling thread's record. the AG_TRACE_* macros call this.
+	void Write(uint16_t event, char phase, int64_t ns, int64_t durationNs, int64_t arg0, int32_t arg1);
+
+	//Chrome trace event format, timestamps in microseconds.
+	void ExportChromeTrace(std::string& json) const;
+	//path is UTF-8.
+	bool WriteChromeTrace(const std::string& path) const;
+	TraceStats GetStats() const;
+
+private:
+	struct EventInfo {
+		const char* category = nullptr;
+		const char* name = nullptr;
+		const char* args[2] = { nullptr, nullptr };
+	};
+	//one record of a ring. sequence is index * 2 + 1 while the owner
+	//writes the record of index and index * 2 + 2 once it is complete.
+	struct Slot {
+		std::atomic<uint64_t> sequence{ 0 };
+		//the TraceRecord, in words a reader may load while it changes.
+		std::atomic<uint64_t> words[4] = {};
+	};
+	struct Buffer {
+		std::unique_ptr<Slot[]> slots;
+		//written by the owning thread only.
+		std::atomic<uint64_t> written;
+		//records before this index were cleared.
+		std::atomic<uint64_t> cleared;
+		//the owning thread ended.
+		std::atomic<bool> retired;
+		int tid = 0;
+		//under m_mutex.
+		std::string threadName;
+	};
+	struct Snapshot {
+		int tid;
+		std::string threadName;
+		std::vector<TraceRecord> records;
+	};
+
+	CTracer();
+	Buffer* GetThreadBuffer();
+	Buffer* AcquireBuffer();
+	//the records of every buffer, leaving out what the owner overwrote or
+	//was writing while they were copied.
+	void TakeSnapshots(std::vector<Snapshot>& snapshots) const;
+
+	static std::atomic<bool> s_enabled;
+	//the calling thread's buffer, TraceThread hands it back at thread exit.
+	static thread_local Buffer* s_threadBuffer;
+
+	mutable std::mutex m_mutex;
+	EventInfo m_events[MAX_EVENTS];
+	std::atomic<int> m_eventCount;
+	std::vector<std::unique_ptr<Buffer>> m_buffers;
+	int m_nextTid = 1;
+	std::atomic<uint64_t> m_dropped;
+	int64_t m_originNs;
+
+	friend struct TraceThread;
+};
+
+//times the enclosing scope into one complete event.
+class CTraceScope
+{
+public:
+	CTraceScope(uint16_t event, int64_t arg0 = 0, int32_t arg1 = 0)
+	{
+		m_event = CTracer::IsEnabled() ? event : 0;
+		if (m_event) {
+			m_arg0 = arg0;
+			m_arg1 = arg1;
+			m_startNs = CTracer::NowNs();
+		}
+	}
+	~CTraceScope()
+	{
+		if (m_event)
+			CTracer::GetInstance()->Write(m_event, 'X', m_startNs, CTracer::NowNs() - m_startNs, m_arg0, m_arg1);
+	}
+
+private:
+	CTraceScope(const CTraceScope&);
+	CTraceScope& operator=(const CTraceScope&);
+
+	uint16_t m_event;
+	int64_t m_arg0 = 0;
+	int32_t m_arg1 = 0;
+	int64_t m_startNs = 0;
+};
+
+inline void AgTraceWrite(uint16_t event, char phase, int64_t arg0, int32_t arg1)
+{
+	if (CTracer::IsEnabled())
+		CTracer::GetInstance()->Write(event, phase, CTracer::NowNs(), 0, arg0, arg1);
+}
+
+#define AG_TRACE_CONCAT2(a, b) a##b
+#define AG_TRACE_CONCAT(a, b) AG_TRACE_CONCAT2(a, b)
+#define AG_TRACE_EVENT_ID(category, name, arg0Name, arg1Name) \
+	static const uint16_t AG_TRACE_CONCAT(agTraceEvent, __LINE__) = \
+		CTracer::GetInstance()->RegisterEvent(category, name, arg0Name, arg1Name)
+
+#if AG_TRACE
+//a slice for the rest of the enclosing scope. one per line.
+#define AG_TRACE_SCOPE(category, name) \
+	AG_TRACE_EVENT_ID(category, name, nullptr, nullptr); \
+	CTraceScope AG_TRACE_CONCAT(agTraceScope, __LINE__)(AG_TRACE_CONCAT(agTraceEvent, __LINE__))
+#define AG_TRACE_SCOPE1(category, name, arg0Name, arg0) \
+	AG_TRACE_EVENT_ID(category, name, arg0Name, nullptr); \
+	CTraceScope AG_TRACE_CONCAT(agTraceScope, __LINE__)(AG_TRACE_CONCAT(agTraceEvent, __LINE__), (int64_t)(arg0))
+#define AG_TRACE_SCOPE2(category, name, arg0Name, arg0, arg1Name, arg1) \
+	AG_TRACE_EVENT_ID(category, name, arg0Name, arg1Name); \
+	CTraceScope AG_TRACE_CONCAT(agTraceScope, __LINE__)(AG_TRACE_CONCAT(agTraceEvent, __LINE__), (int64_t)(arg0), (int32_t)(arg1))
+//a slice between two points of the same scope, where a block would move
+//the code in between.
+#define AG_TRACE_BEGIN1(category, name, arg0Name, arg0) \
+	do { \
+		AG_TRACE_EVENT_ID(category, name, arg0Name, nullptr); \
+		AgTraceWrite(AG_TRACE_CONCAT(agTraceEvent, __LINE__), 'B', (int64_t)(arg0), 0); \
+	} while (0)
+#define AG_TRACE_END(category, name) \
+	do { \
+		AG_TRACE_EVENT_ID(category, name, nullptr, nullptr); \
+		AgTraceWrite(AG_TRACE_CONCAT(agTraceEvent, __LINE__), 'E', 0, 0); \
+	} while (0)
+#define AG_TRACE_INSTANT2(category, name, arg0Name, arg0, arg1Name, arg1) \
+	do { \
+		AG_TRACE_EVENT_ID(category, name, arg0Name, arg1Name); \
+		AgTraceWrite(AG_TRACE_CONCAT(agTraceEvent, __LINE__), 'i', (int64_t)(arg0), (int32_t)(arg1)); \
+	} while (0)
+#define AG_TRACE_COUNTER(category, name, value) \
+	do { \
+		AG_TRACE_EVENT_ID(category, name, nullptr, nullptr); \
+		AgTraceWrite(AG_TRACE_CONCAT(agTraceEvent, __LINE__), 'C', (int64_t)(value), 0); \
+	} while (0)
+//flow events tie the enclosing slices of one frame together across
+//threads; id is the same at every step, usually the frame's capture sequence.
+#define AG_TRACE_FLOW(category, name, phase, id) \
+	do { \
+		AG_TRACE_EVENT_ID(category, name, nullptr, nullptr); \
+		AgTraceWrite(AG_TRACE_CONCAT(agTraceEvent, __LINE__), phase, (int64_t)(id), 0); \
+	} while (0)
+#define AG_TRACE_FLOW_BEGIN(category, name, id) AG_TRACE_FLOW(category, name, 's', id)
+#define AG_TRACE_FLOW_STEP(category, name, id) AG_TRACE_FLOW(category, name, 't', id)
+#define AG_TRACE_FLOW_END(category, name, id) AG_TRACE_FLOW(category, name, 'f', id)
+//names the calling thread once.
+#define AG_TRACE_THREAD_NAME(name) \
+	do { \
+		static thread_local bool agTraceNamed = (CTracer::GetInstance()->SetThreadName(name), true); \
+		(void)agTraceNamed; \
+	} while (0)
+#else
+#define AG_TRACE_SCOPE(category, name)
+#define AG_TRACE_SCOPE1(category, name, arg0Name, arg0)
+#define AG_TRACE_SCOPE2(category, name, arg0Name, arg0, arg1Name, arg1)
+#define AG_TRACE_BEGIN1(category, name, arg0Name, arg0) do {} while (0)
+#define AG_TRACE_END(category, name) do {} while (0)
+#define AG_TRACE_INSTANT2(category, name, arg0Name, arg0, arg1Name, arg1) do {} while (0)
+#define AG_TRACE_COUNTER(category, name, value) do {} while (0)
+#define AG_TRACE_FLOW_BEGIN(category, name, id) do {} while (0)
+#define AG_TRACE_FLOW_STEP(category, name, id) do {} while (0)
+#define AG_TRACE_FLOW_END(category, name, id) do {} while (0)
+#define AG_TRACE_THREAD_NAME(name) do {} while (0)
+#endif